@@ -0,0 +1,224 @@
+/*
+ * ana_sim.c
+ *
+ *  Simulated ADC: the board-Ana.c API over the scan bookkeeping of
+ *  board-AnaScan.c. The tests set the raw input of each channel, a scan
+ *  writes them in scan order into the buffer of each converter and completes
+ *  the converters as the DMA completion interrupts do
+ */
+
+#include <string.h>
+#include "board.h"
+#include "board-Ana.h"
+#include "board-AnaScan.h"
+#include "sim_isr.h"
+#include "sim_board.h"
+
+typedef struct {
+	uint8_t			adc;					// 0 = ADC0, 1 = ADC1
+	uint8_t			adc_channel;
+	float				gain;
+	float				offset;
+	bool				calib_offset;
+} SIM_ADC_Channel_t;
+
+static SIM_ADC_Channel_t	sim_adc_channel[BOARD_ADC_NumberOfChannels] =
+{
+	{ 1,ADC_CH0, 0.0008332F,30036.9F,true },			// LIFT-SUC-CUR, A
+	{ 1,ADC_CH1, 0.0008332F,30036.9F,true },			// LIFT-BR-CUR, A
+	{ 0,ADC_CH2, 0.0008332F,30036.9F,true },			// PUMP-CUR, A
+	{ 0,ADC_CH3, 0.0008332F,30036.9F,true },			// BRUSH-CUR, A
+	{ 0,ADC_CH4, 0.0008332F,30036.9F,true },			// SUCT-CUR, A
+	{ 0,ADC_CH5, 0.0005127031F,0,false },				// VB-SAFETY, V
+	{ 0,ADC_CH6, 0.0005127031F,0,false },				// VB-SENSE, V
+	{ 1,ADC_CH7, 0.0000549325F,0,false },				// 3V3-RAIL, V
+	{ 1,ADC_CH8, 0.0000842298F,0,false },				// 5V-RAIL, V
+	{ 0,ADC_CH9, 0.0001684596F,0,false },				// 10V-RAIL, V
+	{ 0,ADC_CH10,0.0005127031F,0,false },				// VB-OUT, V
+	{ 0,ADC_CH11,0.0005127031F,0,false },				// VB-OUT-SW, V
+	{ 0,ADC_CH12,0.0005127031F,0,false },				// VB_24V_A_KEY_SNS, V
+	{ 0,ADC_CH13,0.0005127031F,0,false },				// VB_24V_RELAY2, V
+	{ 1,ADC_TEMP_SENSOR,0.00001831F,0,false }			// internal temperature sensor
+};
+
+static const char *adc_channel_names[BOARD_ADC_NumberOfChannels] =
+{
+	"Lift-Suction-Current",
+	"Lift-Brush-Current",
+	"Pump Current",
+	"Brush Current",
+	"Suction Current",
+	"Safety Voltage Sense",
+	"Battery Voltage Sense",
+	"3.3V-Rail Voltage",
+	"5V-Rail Voltage",
+	"10V-Rail Voltage",
+	"24V-Out Voltage Sense",
+	"24V-Out-SW Voltage Sense",
+	"24V_A_Key_SNS Voltage Sense",
+	"24V_Relay2 Voltage Sense",
+	"Temperature Sensor"
+};
+
+static ADC_Scan_t				ADC_ScanState;
+static uint16_t				ADC_conv_offset_calib[BOARD_ADC_NumberOfChannels];
+static uint16_t				sim_adc_input[BOARD_ADC_NumberOfChannels];
+static bool						sim_adc_scan_enabled;
+static void						(*ADC_ScanCallback)(void) = NULL;
+static SIM_ADC_ConversionHook_t	sim_adc_hook;
+static void						*sim_adc_hook_ctx;
+
+void BOARD_InitVREF(void)
+{
+}
+
+int BOARD_InitADC(void)
+{
+ADC_ScanChannel_t		table[BOARD_ADC_NumberOfChannels];
+
+	memset(ADC_conv_offset_calib,0,sizeof(ADC_conv_offset_calib));
+	for (int i = 0;i < BOARD_ADC_NumberOfChannels;i++)
+	{
+		table[i].adc = sim_adc_channel[i].adc;
+		table[i].adc_channel = sim_adc_channel[i].adc_channel;
+		table[i].channel = i;
+	}
+	return ADC_ScanInit(&ADC_ScanState,table,BOARD_ADC_NumberOfChannels) ? 1 : 0;
+}
+
+void BOARD_ADC_EnableScan(bool enable)
+{
+	sim_adc_scan_enabled = enable;
+}
+
+void BOARD_ADC_RegisterScanCallback(void (*callback)(void))
+{
+	ADC_ScanCallback = callback;
+}
+
+uint32_t BOARD_ADC_GetScanCount(void)
+{
+	return ADC_ScanState.scans;
+}
+
+bool BOARD_ADC_InitAverager(int samples)
+{
+	(void)samples;
+	return true;
+}
+
+const char * BOARD_getADCchannelName(unsigned channel)
+{
+	if (channel >= BOARD_ADC_NumberOfChannels)
+		return NULL;
+	return adc_channel_names[channel];
+}
+
+bool BOARD_get_ADC(uint8_t channel,uint16_t *value)
+{
+	return ADC_ScanGet(&ADC_ScanState,channel,value);
+}
+
+bool BOARD_get_ADC_float(uint8_t channel,float *value)
+{
+uint16_t		raw;
+
+	if (!BOARD_get_ADC(channel,&raw))
+		return false;
+	if (channel == ADC_TEMP_SENSOR_CHANNEL)
+	{
+		float Vtemp = raw * ADC_REF_VOLTAGE / ADC_MAX_VALUE;
+		*value = 25.0F - (Vtemp - ADC_VTEMP25) / ADC_VTEMP_SLOPE;
+	}
+	else
+		*value = (raw - sim_adc_channel[channel].offset) * sim_adc_channel[channel].gain;
+	return true;
+}
+
+uint32_t BOARD_get_ADC_clock(ADC_Type *ADC)
+{
+	(void)ADC;
+	return CLOCK_GetCoreSysClkFreq();
+}
+
+bool BOARD_calib_ADC_channel_offset(uint8_t channel)
+{
+unsigned		sum = 0;
+uint16_t		value;
+
+	if (channel >= BOARD_ADC_NumberOfChannels)
+		return false;
+	BOARD_Reset_ADC_Trigger();
+	for (int i = 0;i < 100;i++)
+	{
+		while (!BOARD_getADC_Trigger())
+			;
+		BOARD_Reset_ADC_Trigger();
+		if (!BOARD_get_ADC(channel,&value))
+			return false;
+		sum += value;
+	}
+	ADC_conv_offset_calib[channel] = sum / 100;
+	if (sim_adc_channel[channel].calib_offset)
+		sim_adc_channel[channel].offset = sum / 100.0F;
+	return true;
+}
+
+unsigned BOARD_getOffsetCalibValue(uint8_t channel)
+{
+	if (channel >= BOARD_ADC_NumberOfChannels)
+		return 0;
+	return ADC_conv_offset_calib[channel];
+}
+
+bool BOARD_getValueAndOffset(uint8_t channel,uint16_t *value,uint16_t *offset)
+{
+	if (!BOARD_get_ADC(channel,value))
+		return false;
+	*offset = ADC_conv_offset_calib[channel];
+	return true;
+}
+
+bool SIM_ADC_SetInput(uint8_t channel,uint16_t raw)
+{
+	if (channel >= BOARD_ADC_NumberOfChannels)
+		return false;
+	sim_adc_input[channel] = raw;
+	return true;
+}
+
+void SIM_ADC_Scan(void)
+{
+uint32_t		prev;
+bool			done = false;
+
+	if (!sim_adc_scan_enabled || ADC_ScanState.n_channels == 0)
+		return;
+	for (unsigned adc = 0;adc < ADC_SCAN_N_ADC;adc++)
+	{
+		uint16_t *buffer = ADC_ScanWriteBuffer(&ADC_ScanState,adc);
+
+		if (ADC_ScanCount(&ADC_ScanState,adc) == 0)
+			continue;
+		for (unsigned ch = 0;ch < BOARD_ADC_NumberOfChannels;ch++)
+		{
+			if (sim_adc_channel[ch].adc != adc)
+				continue;
+			buffer[ADC_ScanState.slot[ch] - ADC_ScanState.first[adc]] = sim_adc_input[ch];
+			if (sim_adc_hook != NULL)
+				sim_adc_hook(adc,ch,sim_adc_hook_ctx);
+		}
+		prev = SIM_ISR_Enter(adc == 0 ? DMA2_IRQn : DMA4_IRQn);
+		done = ADC_ScanComplete(&ADC_ScanState,adc);
+		if (done && ADC_ScanCallback != NULL)
+			ADC_ScanCallback();
+		SIM_ISR_Exit(prev);
+	}
+}
+
+void SIM_ADC_SetConversionHook(SIM_ADC_ConversionHook_t hook,void *ctx)
+{
+	sim_adc_hook = NULL;
+	sim_adc_hook_ctx = ctx;
+	sim_adc_hook = hook;
+}
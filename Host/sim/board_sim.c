@@ -0,0 +1,624 @@
+/*
+ * board_sim.c
+ *
+ *  Simulated board: the board.c API over plain state. The PWM outputs, the
+ *  pumps and the relays keep the values set by the firmware and the timer
+ *  interrupts are played by the tests. The system time is in systime_sim.c
+ */
+
+#include <string.h>
+#include "board.h"
+#include "board-Ana.h"
+#include "board-DigIO.h"
+#include "pin_mux.h"
+#include "clock_config.h"
+#include "peripherals.h"
+#include "crc.h"
+#include "CAN.h"
+#include "I2C.h"
+#include "EEPROM.h"
+#include "FRAM.h"
+#include "TMP100.h"
+#include "sim_clock.h"
+#include "sim_isr.h"
+#include "sim_board.h"
+
+typedef struct {
+	unsigned			pwm;					// 1/1000
+	eDirMode_t		DirMode;
+	unsigned			dutycycle[2];		// outputs 1 and 2, 1/1000
+	bool				enabled;				// nSLEEP
+	uint8_t			TimerIndex;
+	const char		*Name;
+} SIM_PWMControl_t;
+
+static SIM_PWMControl_t		sim_pwm[N_PWM_CONTROL_CHANNELS] =
+{
+	{ .TimerIndex = 0, .Name = "BRUSH" },
+	{ .TimerIndex = 0, .Name = "SUCTION" },
+	{ .TimerIndex = 1, .Name = "LIFT-BRUSH" },
+	{ .TimerIndex = 1, .Name = "LIFT-SUCT" },
+	{ .TimerIndex = 1, .Name = "PUMP1" },
+	{ .TimerIndex = 1, .Name = "PUMP2" }
+};
+
+static uint32_t				sim_pwm_frequency[N_PWM_FTM_TIMER_CHANNELS] =
+{
+	PWM_FREQUENCY_FTM0_HZ,
+	PWM_FREQUENCY_FTM1_HZ,
+	PWM_FREQUENCY_FTM3_HZ
+};
+
+static PumpCtrl_t				sim_pump[2];
+static PumpCtrlClMgr_t		sim_pump_clmgr;
+static bool						sim_relay[2];
+static uint8_t					sim_test_wd;
+static uint16_t				sim_own_address;
+static bool						sim_irq_callback = true;
+static volatile bool			sim_adc_trigger;
+static void						(*sim_pwm_handler)(unsigned channel);
+static void						(*sim_timer_handler[2])(uint64_t value,uint32_t flags);
+
+// -------------------------------------------------------------------------------
+// Initialization
+// -------------------------------------------------------------------------------
+
+void BOARD_InitBootPins(void)
+{
+}
+
+/*!
+ ******************************************************************************
+ *	Clock registers in the BOARD_BootClockRUN configuration: PEE from the 24 MHz
+ * crystal
+ ******************************************************************************
+*/
+void BOARD_InitBootClocks(void)
+{
+	MCG->C1 = MCG_C1_IRCLKEN_MASK;
+	MCG->C5 = MCG_C5_PRDIV0(7) | MCG_C5_PLLCLKEN0_MASK;
+	MCG->C6 = MCG_C6_VDIV0(8) | MCG_C6_PLLS_MASK;
+	MCG->C7 = MCG_C7_OSCSEL(0);
+	MCG->S = MCG_S_CLKST(3) | MCG_S_PLLST_MASK | MCG_S_LOCK0_MASK | MCG_S_OSCINIT0_MASK;
+	SIM->CLKDIV1 = 0x1130000U;
+	SIM->SOPT2 = SIM_SOPT2_PLLFLLSEL(1);
+	CLOCK_SetXtal0Freq(BOARD_XTAL0_CLK_HZ);
+}
+
+/*!
+ ******************************************************************************
+ *	The boot loader leaves the clocks so, the static constructors of the
+ * application (UCDevice) already read the clock frequencies. A separate
+ * function: GCC drops the priority of an already declared constructor
+ ******************************************************************************
+*/
+__attribute__((constructor(101))) static void SIM_Board_BootLoader(void)
+{
+	BOARD_InitBootClocks();
+}
+
+void BOARD_InitBootPeripherals(void)
+{
+}
+
+/*!
+ ******************************************************************************
+ *	Initializes the simulated board and the drivers above it, in the order of
+ * the board.c BOARD_Init
+ ******************************************************************************
+*/
+bool BOARD_Init(void)
+{
+	BOARD_InitDigIO();
+	BOARD_InitVREF();
+	BOARD_InitADC();
+	CRC_init();
+	BOARD_InitCAN(CAN_CHANNEL);
+	I2C_Bus_Init();
+	EEPROM_Initialize();
+	InitializeFRAM();
+	TMP100_Init();
+	return true;
+}
+
+int BOARD_InitCAN(unsigned channel)
+{
+	return CAN_init(channel) ? 1 : 0;
+}
+
+void CAN0_ORed_Message_buffer_IRQHandler(void)
+{
+	CAN_MessageIRQhandler(0);
+}
+
+void CAN0_Error_IRQHandler(void)
+{
+	CAN_ErrorIRQhandler(0);
+}
+
+bool BOARD_PowerUpSupplyRails(void)
+{
+	return true;
+}
+
+bool BOARD_PowerDownSupplyRails(void)
+{
+	return true;
+}
+
+void BOARD_InitDebugConsole(void)
+{
+}
+
+bool BOARD_GetStackAndHeapInfo(bool getZIregions,uint32_t *stack_base,uint32_t *stack_size,
+		uint32_t *heap_base,uint32_t *heap_size)
+{
+	(void)getZIregions;
+	*stack_base = *stack_size = *heap_base = *heap_size = 0;
+	return false;
+}
+
+// -------------------------------------------------------------------------------
+// Timers and their interrupts
+// -------------------------------------------------------------------------------
+
+void BOARD_FTM0_start(void) {}
+void BOARD_FTM0_stop(void) {}
+void BOARD_FTM0_enable_isr(void) {}
+void BOARD_FTM0_disable_isr(void) {}
+void BOARD_FTM1_start(void) {}
+void BOARD_FTM1_stop(void) {}
+void BOARD_FTM1_enable_isr(void) {}
+void BOARD_FTM1_disable_isr(void) {}
+void BOARD_FTM2_start(void) {}
+void BOARD_FTM2_stop(void) {}
+void BOARD_FTM2_enable_isr(void) {}
+void BOARD_FTM2_disable_isr(void) {}
+void BOARD_FTM3_start(void) {}
+void BOARD_FTM3_stop(void) {}
+void BOARD_FTM3_enable_isr(void) {}
+void BOARD_FTM3_disable_isr(void) {}
+
+bool BOARD_RegisterPWM_FTM_Callback(void(*IRQHandler)(unsigned channel))
+{
+	sim_pwm_handler = IRQHandler;
+	return true;
+}
+
+bool BOARD_RegisterFTM_Callback(uint8_t channel,void(*IRQHandler)(uint64_t value,uint32_t flags))
+{
+	if (channel > 1)
+		return false;
+	sim_timer_handler[channel] = IRQHandler;
+	return true;
+}
+
+void BOARD_Ena_CUC_IRQ_Callback(bool enable)
+{
+	sim_irq_callback = enable;
+}
+
+void SIM_Board_PWMInterrupt(unsigned channel)
+{
+uint32_t		prev = SIM_ISR_Enter(FTM0_IRQn);
+
+	if (sim_irq_callback && sim_pwm_handler != NULL)
+		sim_pwm_handler(channel);
+	SIM_ISR_Exit(prev);
+}
+
+void SIM_Board_TimerInterrupt(uint8_t channel,uint64_t value,uint32_t flags)
+{
+uint32_t		prev;
+
+	if (channel > 1)
+		return;
+	prev = SIM_ISR_Enter(channel == 0 ? FTM1_IRQn : FTM2_IRQn);
+	if (sim_irq_callback && sim_timer_handler[channel] != NULL)
+		sim_timer_handler[channel](value,flags);
+	SIM_ISR_Exit(prev);
+}
+
+// -------------------------------------------------------------------------------
+// PWM
+// -------------------------------------------------------------------------------
+
+bool BOARD_Set_PWM_FTM_Frequency(unsigned channel,uint32_t frequency)
+{
+	if (channel >= N_PWM_FTM_TIMER_CHANNELS || frequency == 0)
+		return false;
+	sim_pwm_frequency[channel] = frequency;
+	return true;
+}
+
+int BOARD_Get_PWM_FTM_Frequency(unsigned channel)
+{
+	if (channel >= N_PWM_FTM_TIMER_CHANNELS)
+		return -1;
+	return (int)sim_pwm_frequency[channel];
+}
+
+int BOARD_Get_PWM_FTM_Period(unsigned channel)
+{
+	if (channel >= N_PWM_FTM_TIMER_CHANNELS)
+		return -1;
+	return (int)(1000000UL / sim_pwm_frequency[channel]);
+}
+
+bool BOARD_SetPWMControl(unsigned channel,unsigned pwm,eDirMode_t DirMode)
+{
+SIM_PWMControl_t	*ctrl;
+
+	if (channel >= N_PWM_CONTROL_CHANNELS)
+		return false;
+	ctrl = &sim_pwm[channel];
+	switch (DirMode)
+	{
+		case eDirModeRight:
+			ctrl->pwm = pwm;
+			ctrl->dutycycle[0] = pwm;
+			ctrl->dutycycle[1] = 0;
+			ctrl->enabled = true;
+			break;
+		case eDirModeLeft:
+			ctrl->pwm = pwm;
+			ctrl->dutycycle[0] = 0;
+			ctrl->dutycycle[1] = pwm;
+			ctrl->enabled = true;
+			break;
+		case eDirModeBrake:
+			ctrl->dutycycle[0] = ctrl->dutycycle[1] = 0;
+			ctrl->enabled = true;
+			break;
+		case eDirModeHighZ:
+			ctrl->dutycycle[0] = ctrl->dutycycle[1] = 1000;
+			ctrl->enabled = true;
+			break;
+		case eDirModeSleep:
+			ctrl->enabled = false;
+			break;
+		default:
+			return false;
+	}
+	ctrl->DirMode = DirMode;
+	return true;
+}
+
+bool BOARD_GetPWMControl(unsigned channel,unsigned *pwm,eDirMode_t *DirMode,
+	unsigned *dutycycle1,unsigned *dutycycle2)
+{
+	if (channel >= N_PWM_CONTROL_CHANNELS)
+		return false;
+	*pwm = sim_pwm[channel].pwm;
+	*DirMode = sim_pwm[channel].DirMode;
+	*dutycycle1 = sim_pwm[channel].dutycycle[0];
+	*dutycycle2 = sim_pwm[channel].dutycycle[1];
+	return true;
+}
+
+bool BOARD_CheckPWMControl(unsigned channel)
+{
+	return channel < N_PWM_CONTROL_CHANNELS;
+}
+
+void BOARD_EnablePWM(void)
+{
+	for (int i = 0;i < N_PWM_CONTROL_CHANNELS;i++)
+		sim_pwm[i].enabled = true;
+}
+
+void BOARD_DisablePWM(void)
+{
+	for (int i = 0;i < N_PWM_CONTROL_CHANNELS;i++)
+		sim_pwm[i].enabled = false;
+}
+
+bool BOARD_EnablePWMchannel(unsigned channel)
+{
+	if (channel >= N_PWM_CONTROL_CHANNELS)
+		return false;
+	sim_pwm[channel].enabled = true;
+	return true;
+}
+
+bool BOARD_DisablePWMchannel(unsigned channel)
+{
+	if (channel >= N_PWM_CONTROL_CHANNELS)
+		return false;
+	sim_pwm[channel].enabled = false;
+	return true;
+}
+
+bool BOARD_GetPWMchannelStatus(unsigned channel,uint8_t *status)
+{
+	if (channel >= N_PWM_CONTROL_CHANNELS)
+		return false;
+	*status = (sim_pwm[channel].enabled ? (1 << 0) : 0) | (1 << 1);	// no fault
+	return true;
+}
+
+bool BOARD_GetPWMdirection(unsigned channel,eDirMode_t *DirMode)
+{
+	if (channel >= N_PWM_CONTROL_CHANNELS)
+		return false;
+	*DirMode = sim_pwm[channel].DirMode;
+	return true;
+}
+
+bool BOARD_GetPWMTimer(unsigned channel,uint8_t *timer)
+{
+	if (channel >= N_PWM_CONTROL_CHANNELS)
+		return false;
+	*timer = sim_pwm[channel].TimerIndex;
+	return true;
+}
+
+const char * BOARD_GetPWMName(unsigned channel)
+{
+	if (channel >= N_PWM_CONTROL_CHANNELS)
+		return NULL;
+	return sim_pwm[channel].Name;
+}
+
+bool BOARD_GetPWM_CounterPeriod(unsigned channel,uint32_t *period)
+{
+	if (channel >= N_PWM_CONTROL_CHANNELS)
+		return false;
+	*period = CLOCK_GetBusClkFreq() / sim_pwm_frequency[sim_pwm[channel].TimerIndex];
+	return true;
+}
+
+bool BOARD_GetPWMStatus(unsigned channel,uint32_t *status)
+{
+	if (channel >= N_PWM_CONTROL_CHANNELS)
+		return false;
+	*status = 0;				// no fault
+	return true;
+}
+
+bool SIM_Board_GetPWMOutputs(unsigned channel,unsigned *dutycycle1,unsigned *dutycycle2,bool *enabled)
+{
+	if (channel >= N_PWM_CONTROL_CHANNELS)
+		return false;
+	*dutycycle1 = sim_pwm[channel].dutycycle[0];
+	*dutycycle2 = sim_pwm[channel].dutycycle[1];
+	*enabled = sim_pwm[channel].enabled;
+	return true;
+}
+
+// -------------------------------------------------------------------------------
+// Pumps and cleaning manager
+// -------------------------------------------------------------------------------
+
+bool BOARD_SetPumpFreqPulse(uint8_t channel,uint16_t frequency,uint16_t pulselen)
+{
+	if (channel > 1)
+		return false;
+	if (frequency < 1)
+		frequency = 1;
+	if (pulselen < 1)
+		pulselen = 1;
+	sim_pump[channel].frequency = frequency;
+	sim_pump[channel].pulse = pulselen;
+	sim_pump[channel].period = 1000 / frequency;
+	sim_pump[channel].period_ctr = 0;
+	if (sim_pump[channel].period < 1)
+	{
+		sim_pump[channel].enable = false;
+		return false;
+	}
+	return true;
+}
+
+bool BOARD_GetPumpFreqPulse(uint8_t channel,uint16_t *frequency,uint16_t *pulselen)
+{
+	if (channel > 1)
+		return false;
+	*frequency = sim_pump[channel].frequency;
+	*pulselen = sim_pump[channel].pulse;
+	return true;
+}
+
+bool BOARD_SetPumpPWM(uint8_t channel,uint16_t PWMvalue)
+{
+	if (channel > 1)
+		return false;
+	sim_pump[channel].pwm_on = PWMvalue > 1000 ? 1000 : PWMvalue;
+	return true;
+}
+
+bool BOARD_SetWaterPumpParams(uint8_t channel,uint16_t period,uint16_t pulselen,uint16_t PWMvalue)
+{
+	if (channel > 1 || period == 0)
+		return false;
+	sim_pump[channel].frequency = 1000000 / period;
+	sim_pump[channel].pulse = pulselen / 1000;
+	sim_pump[channel].period = period / 1000;
+	sim_pump[channel].period_ctr = 0;
+	sim_pump[channel].pwm_on = PWMvalue > 1000 ? 1000 : PWMvalue;
+	return sim_pump[channel].period >= 1;
+}
+
+bool BOARD_EnablePump(uint8_t channel,bool OnOff)
+{
+	if (channel > 1)
+		return false;
+	sim_pump[channel].enable = OnOff;
+	sim_pwm[PWM_CONTROL_PUMP1 + channel].enabled = OnOff;
+	return true;
+}
+
+bool BOARD_GetPumpStatus(uint8_t channel,bool *OnOff)
+{
+	if (channel > 1)
+		return false;
+	*OnOff = sim_pump[channel].enable;
+	return true;
+}
+
+bool BOARD_ClMngr_SetParameters(uint16_t ActDur,uint16_t PulseDur,uint16_t DeactDur,
+	uint32_t Period,uint16_t PWM)
+{
+int			resttime = (int)Period - (ActDur + PulseDur + DeactDur) * 2;
+
+	sim_pump_clmgr.active_dur_p1 = sim_pump_clmgr.active_dur_p2 = ActDur;
+	sim_pump_clmgr.pulse_dur_p1 = sim_pump_clmgr.pulse_dur_p2 = PulseDur;
+	sim_pump_clmgr.deactive_dur_p1 = sim_pump_clmgr.deactive_dur_p2 = DeactDur;
+	sim_pump_clmgr.period = Period;
+	sim_pump_clmgr.wait = resttime < 0 ? 0 : resttime;
+	sim_pump_clmgr.PWM_on = PWM > 1000 ? 1000 : PWM;
+	return true;
+}
+
+bool BOARD_ClMngr_EnaPumpCtrl(bool Enable)
+{
+	sim_pump_clmgr.PumpCtrlByClMgr = Enable;
+	return true;
+}
+
+bool BOARD_ClMngr_EnaClFuidValveCtrl(bool Enable)
+{
+	sim_pump_clmgr.ValveCtrlByClMgr = Enable;
+	return true;
+}
+
+bool BOARD_isPumpClMgrEnabled(void)
+{
+	return sim_pump_clmgr.PumpCtrlByClMgr;
+}
+
+bool BOARD_isValveClMgrEnabled(void)
+{
+	return sim_pump_clmgr.ValveCtrlByClMgr;
+}
+
+// -------------------------------------------------------------------------------
+// Relays, watchdog, address
+// -------------------------------------------------------------------------------
+
+bool ControlRelay1(bool Status,uint32_t ChargeDel,bool ForceStat)
+{
+	(void)ChargeDel;
+	(void)ForceStat;
+	sim_relay[0] = Status;
+	if (!Status)
+		sim_relay[1] = false;
+	return true;
+}
+
+bool ControlRelay2(bool Status,bool ForceStat)
+{
+	(void)ForceStat;
+	sim_relay[1] = Status && sim_relay[0];
+	return true;
+}
+
+void HandleRelay1(void)
+{
+}
+
+bool CheckVB1_Voltage(uint8_t *vb1_status)
+{
+	*vb1_status = RELAY_VB1_STATUS_VB1;
+	return true;
+}
+
+bool BOARD_TestRelayStatus(void)
+{
+uint16_t		value;
+
+	if (!BOARD_get_ADC(ADC_VB_24V_RELAY2,&value))
+		return false;
+	return value >= RELAY1_VB1_THRESHOLD;
+}
+
+bool BOARD_GetRelayStatus(uint8_t *status,float *VB1_rail)
+{
+uint16_t		value;
+
+	if (!BOARD_get_ADC_float(ADC_VB_SENSE,VB1_rail))
+		return false;
+	if (!BOARD_get_ADC(ADC_VB_SENSE,&value))
+		return false;
+	*status = sim_relay[0] ? (1 << 0) : 0;
+	*status |= sim_relay[1] ? (1 << 1) : 0;
+	*status |= value >= RELAY1_VB1_THRESHOLD ? (1 << 2) : 0;
+	return true;
+}
+
+bool BOARD_Set_Test_Ext_WD(uint8_t flag)
+{
+	sim_test_wd = flag;
+	return true;
+}
+
+bool BOARD_Init_WDOG(void) { return true; }
+bool BOARD_Enable_WDOG(void) { return true; }
+bool BOARD_Disable_WDOG(void) { return true; }
+uint32_t BOARD_WDOG_getStatus(void) { return 0; }
+bool BOARD_WDOG_clearStatus(uint32_t mask) { (void)mask; return true; }
+bool BOARD_WDOG_setTimeOut(uint32_t timeout) { (void)timeout; return true; }
+bool BOARD_WDOG_Unlock(void) { return true; }
+void BOARD_WDOG_Feed(void) {}
+
+void BOARD_SetOwnAddress(uint16_t address)
+{
+	sim_own_address = address;
+}
+
+uint16_t BOARD_GetOwnAddress(void)
+{
+	return sim_own_address;
+}
+
+// -------------------------------------------------------------------------------
+// Waits on the PIT0 jiffies of systime_sim.c
+// -------------------------------------------------------------------------------
+
+uint64_t DiffTime(unsigned tm)
+{
+	return Now() - tm;
+}
+
+/*!
+ ******************************************************************************
+ *	Busy wait of tm PIT0 periods: the simulated time elapses at once
+ ******************************************************************************
+*/
+void SleepBM(unsigned tm)
+{
+	SIM_Clock_Sleep((uint64_t)tm * PIT0_PERIOD * 1000000ULL);
+}
+
+// -------------------------------------------------------------------------------
+// ADC scan trigger
+// -------------------------------------------------------------------------------
+
+static void BOARD_ADC_ScanDone(void)
+{
+	sim_adc_trigger = true;
+}
+
+void BOARD_EnaADC_Timer(bool flag)
+{
+	BOARD_ADC_RegisterScanCallback(BOARD_ADC_ScanDone);
+	BOARD_ADC_EnableScan(flag);
+}
+
+void BOARD_Reset_ADC_Trigger(void)
+{
+	sim_adc_trigger = false;
+}
+
+/*!
+ ******************************************************************************
+ *	Polls the end of a scan, the simulated converter scans once per poll so
+ * that the busy waits of the firmware end
+ ******************************************************************************
+*/
+bool BOARD_getADC_Trigger(void)
+{
+	if (!sim_adc_trigger)
+		SIM_ADC_Scan();
+	return sim_adc_trigger;
+}
@@ -0,0 +1,369 @@
+/*
+ * can_sim.c
+ *
+ *  Simulated CAN controller: a model of the FlexCAN below CAN.c. The driver
+ *  functions used by CAN.c work on the RX FIFO with its Type A filter table
+ *  and individual masks, the TX mailboxes and the interrupt flags (write one
+ *  to clear) and raise the CAN interrupt through the simulated NVIC. The test
+ *  is the rest of the bus: the pending TX mailboxes are sent in the order of
+ *  the bus arbitration, lowest ID and then lowest mailbox first, at once or
+ *  after the test releases the bus
+ */
+
+#include <string.h>
+#include "CAN.h"
+#include "sim_clock.h"
+#include "sim_can.h"
+
+#define SIM_CAN_MAX_MB				16
+#define SIM_CAN_FIFO_DEPTH			6					// frames in the RX FIFO
+#define SIM_CAN_FIFO_WARNING		5					// frames at which the warning flag is set
+#define SIM_CAN_MAX_FILTERS		128
+
+typedef struct
+{
+	CAN_Type					*base;
+	IRQn_Type				irq;
+	SIM_NVIC_Handler_t	handler;
+	uint32_t					filter[SIM_CAN_MAX_FILTERS];
+	unsigned					n_filters;
+	bool						fifo_enabled;
+	flexcan_frame_t		fifo[SIM_CAN_FIFO_DEPTH];
+	unsigned					fifo_out;
+	unsigned					fifo_count;
+	flexcan_frame_t		tx[SIM_CAN_MAX_MB];
+	uint32_t					tx_pending;				// mailboxes with a frame to be sent
+	bool						hold;						// the bus is taken by other nodes
+	bool						sending;
+	SIM_CAN_Frame_t		log[SIM_CAN_TX_LOG_DEPTH];
+	uint32_t					log_in;
+	uint32_t					log_out;
+} SIM_FlexCAN_t;
+
+void CAN0_ORed_Message_buffer_IRQHandler(void);
+
+static SIM_FlexCAN_t			sim_can[CAN_NR_IF] = {
+	{ .base = CAN0,.irq = CAN0_ORed_Message_buffer_IRQn,.handler = CAN0_ORed_Message_buffer_IRQHandler }
+};
+static SIM_CAN_TxHook_t		sim_tx_hook;
+static void						*sim_tx_hook_ctx;
+
+static SIM_FlexCAN_t *SIM_CAN_Get(CAN_Type *base)
+{
+	for (unsigned i = 0;i < CAN_NR_IF;i++)
+		if (sim_can[i].base == base)
+			return &sim_can[i];
+	return NULL;
+}
+
+/*!
+ ******************************************************************************
+ *	Arbitration field of a frame in the order it is sent: base ID, RTR or SRR,
+ * IDE, ID extension, RTR of an extended frame. The lower value wins the bus
+ ******************************************************************************
+*/
+static uint32_t SIM_CAN_Arbitration(const flexcan_frame_t *frame)
+{
+uint32_t		key = ((frame->id >> CAN_ID_STD_SHIFT) & 0x7FF) << 21;
+bool			remote = frame->type == kFLEXCAN_FrameTypeRemote;
+
+	if (frame->format == kFLEXCAN_FrameFormatExtend)
+		return key | (1u << 20) | (1u << 19) | ((frame->id & 0x3FFFF) << 1) | (remote ? 1 : 0);
+	return key | (remote ? 1u << 20 : 0);
+}
+
+/*!
+ ******************************************************************************
+ *	The interrupt line: any flag with its interrupt enabled
+ ******************************************************************************
+*/
+static void SIM_CAN_Update(SIM_FlexCAN_t *can)
+{
+	if ((can->base->IFLAG1 & can->base->IMASK1) != 0)
+		SIM_NVIC_Raise(can->irq,can->handler);
+}
+
+/*!
+ ******************************************************************************
+ *	Sends the pending TX mailboxes unless the bus is held. The mailboxes
+ * written by the interrupt of a transmission take part in the next
+ * arbitration
+ ******************************************************************************
+*/
+static void SIM_CAN_Send(SIM_FlexCAN_t *can)
+{
+SIM_CAN_Frame_t		*log;
+flexcan_frame_t		*frame;
+int						mb;
+
+	if (can->sending)
+		return;
+	can->sending = true;
+	while (!can->hold && can->tx_pending != 0)
+	{
+		mb = -1;
+		for (int i = 0;i < SIM_CAN_MAX_MB;i++)
+		{
+			if ((can->tx_pending & (1u << i)) != 0 &&
+				 (mb < 0 || SIM_CAN_Arbitration(&can->tx[i]) < SIM_CAN_Arbitration(&can->tx[mb])))
+				mb = i;
+		}
+		frame = &can->tx[mb];
+		can->tx_pending &= ~(1u << mb);
+		if (can->log_in - can->log_out == SIM_CAN_TX_LOG_DEPTH)
+			can->log_out++;			// the test did not take the oldest frame
+		log = &can->log[can->log_in++ & (SIM_CAN_TX_LOG_DEPTH - 1)];
+		memset(log,0,sizeof(*log));
+		log->msg.isExtID = frame->format == kFLEXCAN_FrameFormatExtend;
+		log->msg.ID = log->msg.isExtID ? frame->id : frame->id >> CAN_ID_STD_SHIFT;
+		log->msg.len = frame->length;
+		for (int i = 0;i < frame->length;i++)
+			log->msg.payload[i] = (uint8_t)((i < 4 ? frame->dataWord0 : frame->dataWord1) >> (24 - 8 * (i & 3)));
+		log->remote = frame->type == kFLEXCAN_FrameTypeRemote;
+		log->time_ns = SIM_Clock_ns();
+		if (sim_tx_hook != NULL)
+			sim_tx_hook((unsigned)(can - sim_can),log,sim_tx_hook_ctx);
+		can->base->IFLAG1 |= 1u << mb;
+		SIM_CAN_Update(can);
+	}
+	can->sending = false;
+}
+
+// -------------------------------------------------------------------------------
+// FlexCAN driver
+// -------------------------------------------------------------------------------
+
+void FLEXCAN_GetDefaultConfig(flexcan_config_t *config)
+{
+	memset(config,0,sizeof(*config));
+	config->clkSrc = kFLEXCAN_ClkSrcOsc;
+	config->baudRate = 1000000U;
+	config->maxMbNum = SIM_CAN_MAX_MB;
+}
+
+/*!
+ ******************************************************************************
+ *	Reset of the controller: the FIFO, the filters and the mailboxes are
+ * cleared, the masks compare all ID bits. The controller stays in freeze mode
+ * as far as CAN.c can tell
+ ******************************************************************************
+*/
+void FLEXCAN_Init(CAN_Type *base,const flexcan_config_t *config,uint32_t sourceClock_Hz)
+{
+SIM_FlexCAN_t	*can = SIM_CAN_Get(base);
+
+	(void)sourceClock_Hz;
+	if (can == NULL)
+		return;
+	base->MCR = CAN_MCR_FRZACK_MASK | CAN_MCR_MAXMB(config->maxMbNum - 1);
+	base->IFLAG1 = 0;
+	base->IMASK1 = 0;
+	base->ESR1 = 0;
+	base->ECR = 0;
+	base->RXMGMASK = 0x3FFFFFFF;
+	base->RXFGMASK = 0x3FFFFFFF;
+	for (int i = 0;i < SIM_CAN_MAX_MB;i++)
+		base->RXIMR[i] = 0x3FFFFFFF;
+	can->n_filters = 0;
+	can->fifo_enabled = false;
+	can->fifo_out = 0;
+	can->fifo_count = 0;
+	can->tx_pending = 0;
+}
+
+void FLEXCAN_SetRxIndividualMask(CAN_Type *base,uint8_t maskIdx,uint32_t mask)
+{
+	if (maskIdx < SIM_CAN_MAX_MB)
+		base->RXIMR[maskIdx] = mask;
+}
+
+void FLEXCAN_SetRxFifoConfig(CAN_Type *base,const flexcan_rx_fifo_config_t *config,bool enable)
+{
+SIM_FlexCAN_t	*can = SIM_CAN_Get(base);
+
+	if (can == NULL)
+		return;
+	can->fifo_enabled = enable;
+	if (!enable)
+	{
+		base->MCR &= ~CAN_MCR_RFEN_MASK;
+		return;
+	}
+	base->MCR |= CAN_MCR_RFEN_MASK;
+	can->n_filters = config->idFilterNum < SIM_CAN_MAX_FILTERS ? config->idFilterNum : SIM_CAN_MAX_FILTERS;
+	memcpy(can->filter,config->idFilterTable,can->n_filters * sizeof(uint32_t));
+}
+
+void FLEXCAN_SetTxMbConfig(CAN_Type *base,uint8_t mbIdx,bool enable)
+{
+SIM_FlexCAN_t	*can = SIM_CAN_Get(base);
+
+	(void)enable;
+	if (can != NULL && mbIdx < SIM_CAN_MAX_MB)
+		can->tx_pending &= ~(1u << mbIdx);
+}
+
+status_t FLEXCAN_WriteTxMb(CAN_Type *base,uint8_t mbIdx,const flexcan_frame_t *txFrame)
+{
+SIM_FlexCAN_t	*can = SIM_CAN_Get(base);
+
+	if (can == NULL || mbIdx >= SIM_CAN_MAX_MB || (can->tx_pending & (1u << mbIdx)) != 0)
+		return kStatus_Fail;
+	can->tx[mbIdx] = *txFrame;
+	can->tx_pending |= 1u << mbIdx;
+	SIM_CAN_Send(can);
+	return kStatus_Success;
+}
+
+/*!
+ ******************************************************************************
+ *	Reads the output of the RX FIFO, it is released by clearing the frame
+ * available flag
+ ******************************************************************************
+*/
+status_t FLEXCAN_ReadRxFifo(CAN_Type *base,flexcan_frame_t *rxFrame)
+{
+SIM_FlexCAN_t	*can = SIM_CAN_Get(base);
+
+	if (can == NULL || !can->fifo_enabled || can->fifo_count == 0)
+		return kStatus_Fail;
+	*rxFrame = can->fifo[can->fifo_out];
+	return kStatus_Success;
+}
+
+void FLEXCAN_ClearStatusFlags(CAN_Type *base,uint32_t mask)
+{
+	base->ESR1 &= ~mask;
+}
+
+void FLEXCAN_ClearMbStatusFlags(CAN_Type *base,uint32_t mask)
+{
+SIM_FlexCAN_t	*can = SIM_CAN_Get(base);
+
+	base->IFLAG1 &= ~mask;
+	if (can == NULL)
+		return;
+	if ((mask & kFLEXCAN_RxFifoFrameAvlFlag) != 0 && can->fifo_enabled && can->fifo_count > 0)
+	{
+		can->fifo_out = (can->fifo_out + 1) % SIM_CAN_FIFO_DEPTH;
+		if (--can->fifo_count > 0)
+			base->IFLAG1 |= kFLEXCAN_RxFifoFrameAvlFlag;
+	}
+	SIM_CAN_Update(can);
+}
+
+void FLEXCAN_EnableMbInterrupts(CAN_Type *base,uint32_t mask)
+{
+SIM_FlexCAN_t	*can = SIM_CAN_Get(base);
+
+	base->IMASK1 |= mask;
+	if (can != NULL)
+		SIM_CAN_Update(can);
+}
+
+void FLEXCAN_DisableMbInterrupts(CAN_Type *base,uint32_t mask)
+{
+	base->IMASK1 &= ~mask;
+}
+
+// -------------------------------------------------------------------------------
+// Bus
+// -------------------------------------------------------------------------------
+
+/*!
+ ******************************************************************************
+ *	Checks a frame against the Type A filter table: each element under its
+ * individual mask, RTR and IDE in bits 31 and 30 of the element and the mask
+ ******************************************************************************
+*/
+static bool SIM_CAN_Accept(const SIM_FlexCAN_t *can,const flexcan_frame_t *frame)
+{
+uint32_t		word,mask;
+
+	if (frame->format == kFLEXCAN_FrameFormatExtend)
+		word = (1u << 30) | (frame->id << 1);
+	else
+		word = frame->id << 1;
+	if (frame->type == kFLEXCAN_FrameTypeRemote)
+		word |= 1u << 31;
+	for (unsigned i = 0;i < can->n_filters;i++)
+	{
+		mask = i < SIM_CAN_MAX_MB ? can->base->RXIMR[i] : can->base->RXFGMASK;
+		if (((word ^ can->filter[i]) & mask) == 0)
+			return true;
+	}
+	return false;
+}
+
+bool SIM_CAN_Receive(unsigned channel,uint32_t ID,bool isExtID,const uint8_t *payload,int len)
+{
+SIM_FlexCAN_t		*can;
+flexcan_frame_t	frame;
+CANstatistics_t	before,after;
+
+	if (channel >= CAN_NR_IF || len < 0 || len > 8)
+		return false;
+	can = &sim_can[channel];
+	memset(&frame,0,sizeof(frame));
+	frame.format = isExtID ? kFLEXCAN_FrameFormatExtend : kFLEXCAN_FrameFormatStandard;
+	frame.type = kFLEXCAN_FrameTypeData;
+	frame.id = isExtID ? FLEXCAN_ID_EXT(ID) : FLEXCAN_ID_STD(ID);
+	frame.length = len;
+	for (int i = 0;i < len;i++)
+	{
+		if (i < 4)
+			frame.dataWord0 |= (uint32_t)payload[i] << (24 - 8 * i);
+		else
+			frame.dataWord1 |= (uint32_t)payload[i] << (24 - 8 * (i - 4));
+	}
+	if (!can->fifo_enabled || !SIM_CAN_Accept(can,&frame))
+		return false;
+	if (can->fifo_count == SIM_CAN_FIFO_DEPTH)
+	{
+		can->base->IFLAG1 |= kFLEXCAN_RxFifoOverflowFlag;
+		SIM_CAN_Update(can);
+		return false;
+	}
+	CAN_GetStatistics(channel,&before);
+	can->fifo[(can->fifo_out + can->fifo_count++) % SIM_CAN_FIFO_DEPTH] = frame;
+	if (can->fifo_count >= SIM_CAN_FIFO_WARNING)
+		can->base->IFLAG1 |= kFLEXCAN_RxFifoWarningFlag;
+	can->base->IFLAG1 |= kFLEXCAN_RxFifoFrameAvlFlag;
+	SIM_CAN_Update(can);
+	CAN_GetStatistics(channel,&after);
+	return after.RX_Frames != before.RX_Frames;
+}
+
+void SIM_CAN_HoldBus(unsigned channel,bool hold)
+{
+	if (channel >= CAN_NR_IF)
+		return;
+	sim_can[channel].hold = hold;
+	SIM_CAN_Send(&sim_can[channel]);
+}
+
+bool SIM_CAN_Transmitted(unsigned channel,SIM_CAN_Frame_t *frame)
+{
+SIM_FlexCAN_t		*can;
+
+	if (channel >= CAN_NR_IF)
+		return false;
+	can = &sim_can[channel];
+	if (can->log_out == can->log_in)
+		return false;
+	*frame = can->log[can->log_out++ & (SIM_CAN_TX_LOG_DEPTH - 1)];
+	return true;
+}
+
+void SIM_CAN_ClearTransmitted(unsigned channel)
+{
+	if (channel < CAN_NR_IF)
+		sim_can[channel].log_out = sim_can[channel].log_in;
+}
+
+void SIM_CAN_SetTxHook(SIM_CAN_TxHook_t hook,void *ctx)
+{
+	sim_tx_hook = NULL;
+	sim_tx_hook_ctx = ctx;
+	sim_tx_hook = hook;
+}
@@ -0,0 +1,206 @@
+/*
+ * cmsis_os2.c
+ *
+ *  Subset of the CMSIS-RTOS2 API over the FreeRTOS API, as the CMSIS-FreeRTOS
+ *  layer of the target does it, on the deterministic kernel stand-in
+ */
+
+#include <stdbool.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "event_groups.h"
+#include "cmsis_os2.h"
+
+#define OS_EVENT_FLAGS_MASK		0x00FFFFFFU				// bits of an event group usable as flags
+
+static osKernelState_t			os_kernel_state = osKernelInactive;
+
+/*!
+ ******************************************************************************
+ *	Kernel
+ ******************************************************************************
+*/
+osStatus_t osKernelInitialize(void)
+{
+	if (os_kernel_state != osKernelInactive)
+		return osError;
+	os_kernel_state = osKernelReady;
+	return osOK;
+}
+
+osStatus_t osKernelStart(void)
+{
+	if (os_kernel_state != osKernelReady)
+		return osError;
+	os_kernel_state = osKernelRunning;
+	vTaskStartScheduler();
+	return osOK;
+}
+
+osKernelState_t osKernelGetState(void)
+{
+	return os_kernel_state;
+}
+
+uint32_t osKernelGetTickCount(void)
+{
+	return (uint32_t)xTaskGetTickCount();
+}
+
+uint32_t osKernelGetTickFreq(void)
+{
+	return configTICK_RATE_HZ;
+}
+
+/*!
+ ******************************************************************************
+ *	Threads, the priorities of CMSIS-RTOS2 are the FreeRTOS ones
+ ******************************************************************************
+*/
+osThreadId_t osThreadNew(osThreadFunc_t func,void *argument,const osThreadAttr_t *attr)
+{
+TaskHandle_t	handle = NULL;
+const char		*name = "";
+uint32_t			stack = configMINIMAL_STACK_SIZE;
+UBaseType_t		prio = (UBaseType_t)osPriorityNormal;
+
+	if (func == NULL)
+		return NULL;
+	if (attr != NULL)
+	{
+		if (attr->name != NULL)
+			name = attr->name;
+		if (attr->stack_size > 0)
+			stack = attr->stack_size / sizeof(StackType_t);
+		if (attr->priority != osPriorityNone)
+			prio = (UBaseType_t)attr->priority;
+	}
+	if (stack < configMINIMAL_STACK_SIZE)
+		stack = configMINIMAL_STACK_SIZE;
+	if (stack > UINT16_MAX)
+		stack = UINT16_MAX;
+	if (xTaskCreate((TaskFunction_t)func,name,(uint16_t)stack,argument,prio,&handle) != pdPASS)
+		return NULL;
+	return (osThreadId_t)handle;
+}
+
+osThreadId_t osThreadGetId(void)
+{
+	return (osThreadId_t)xTaskGetCurrentTaskHandle();
+}
+
+osThreadState_t osThreadGetState(osThreadId_t thread_id)
+{
+	if (thread_id == NULL)
+		return osThreadError;
+	switch (eTaskGetState((TaskHandle_t)thread_id))
+	{
+		case eRunning:		return osThreadRunning;
+		case eReady:		return osThreadReady;
+		case eBlocked:
+		case eSuspended:	return osThreadBlocked;
+		case eDeleted:		return osThreadTerminated;
+		default:				return osThreadError;
+	}
+}
+
+osStatus_t osThreadSuspend(osThreadId_t thread_id)
+{
+	if (thread_id == NULL)
+		return osErrorParameter;
+	vTaskSuspend((TaskHandle_t)thread_id);
+	return osOK;
+}
+
+osStatus_t osThreadResume(osThreadId_t thread_id)
+{
+	if (thread_id == NULL)
+		return osErrorParameter;
+	vTaskResume((TaskHandle_t)thread_id);
+	return osOK;
+}
+
+osStatus_t osThreadYield(void)
+{
+	taskYIELD();
+	return osOK;
+}
+
+__NO_RETURN void osThreadExit(void)
+{
+	vTaskDelete(NULL);
+	for (;;)
+		;
+}
+
+osStatus_t osDelay(uint32_t ticks)
+{
+	if (ticks != 0)
+		vTaskDelay((TickType_t)ticks);
+	return osOK;
+}
+
+osStatus_t osDelayUntil(uint32_t ticks)
+{
+TickType_t	now = xTaskGetTickCount();
+
+	if ((TickType_t)(ticks - now) > (TickType_t)0x7FFFFFFF)
+		return osErrorParameter;
+	vTaskDelay((TickType_t)(ticks - now));
+	return osOK;
+}
+
+/*!
+ ******************************************************************************
+ *	Event flags
+ ******************************************************************************
+*/
+osEventFlagsId_t osEventFlagsNew(const osEventFlagsAttr_t *attr)
+{
+	(void)attr;
+	return (osEventFlagsId_t)xEventGroupCreate();
+}
+
+uint32_t osEventFlagsSet(osEventFlagsId_t ef_id,uint32_t flags)
+{
+	if (ef_id == NULL || (flags & ~OS_EVENT_FLAGS_MASK) != 0)
+		return osFlagsErrorParameter;
+	return (uint32_t)xEventGroupSetBits((EventGroupHandle_t)ef_id,(EventBits_t)flags);
+}
+
+uint32_t osEventFlagsClear(osEventFlagsId_t ef_id,uint32_t flags)
+{
+	if (ef_id == NULL || (flags & ~OS_EVENT_FLAGS_MASK) != 0)
+		return osFlagsErrorParameter;
+	return (uint32_t)xEventGroupClearBits((EventGroupHandle_t)ef_id,(EventBits_t)flags);
+}
+
+uint32_t osEventFlagsGet(osEventFlagsId_t ef_id)
+{
+	if (ef_id == NULL)
+		return 0;
+	return (uint32_t)xEventGroupGetBits((EventGroupHandle_t)ef_id);
+}
+
+uint32_t osEventFlagsWait(osEventFlagsId_t ef_id,uint32_t flags,uint32_t options,uint32_t timeout)
+{
+EventBits_t	bits;
+bool			all = (options & osFlagsWaitAll) != 0;
+
+	if (ef_id == NULL || (flags & ~OS_EVENT_FLAGS_MASK) != 0)
+		return osFlagsErrorParameter;
+	bits = xEventGroupWaitBits((EventGroupHandle_t)ef_id,(EventBits_t)flags,
+		(options & osFlagsNoClear) ? pdFALSE : pdTRUE,all ? pdTRUE : pdFALSE,
+		timeout == osWaitForever ? portMAX_DELAY : (TickType_t)timeout);
+	if (all ? (bits & flags) != flags : (bits & flags) == 0)
+		return timeout != 0 ? osFlagsErrorTimeout : osFlagsErrorResource;
+	return (uint32_t)bits;
+}
+
+osStatus_t osEventFlagsDelete(osEventFlagsId_t ef_id)
+{
+	if (ef_id == NULL)
+		return osErrorParameter;
+	vEventGroupDelete((EventGroupHandle_t)ef_id);
+	return osOK;
+}
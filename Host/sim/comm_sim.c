@@ -0,0 +1,82 @@
+/*
+ * comm_sim.c
+ *
+ *  Command channels of the host build in place of uart.c and of the USB CDC
+ */
+
+#include <string.h>
+#include <stdbool.h>
+#include "uart.h"
+#include "virtual_com.h"
+#include "sim_comm.h"
+
+typedef struct
+{
+	uint8_t		data[SIM_COMM_PACKET_SIZE];
+	int			len;
+} SIM_Comm_Packet_t;
+
+static SIM_Comm_Packet_t	sim_packets[2][SIM_COMM_PACKETS];
+static uint32_t				sim_in[2];
+static uint32_t				sim_out[2];
+
+static void SIM_Comm_Put(int channel,const uint8_t *packet,int len)
+{
+SIM_Comm_Packet_t		*p = &sim_packets[channel][sim_in[channel] & (SIM_COMM_PACKETS - 1)];
+
+	if (len < 0)
+		return;
+	if (len > SIM_COMM_PACKET_SIZE)
+		len = SIM_COMM_PACKET_SIZE;
+	memcpy(p->data,packet,len);
+	p->len = len;
+	if (sim_in[channel] - sim_out[channel] == SIM_COMM_PACKETS)
+		sim_out[channel]++;
+	sim_in[channel]++;
+}
+
+int SIM_Comm_Sent(int channel,uint8_t *packet,int max)
+{
+SIM_Comm_Packet_t		*p;
+int						len;
+
+	if (channel < 0 || channel > SIM_COMM_USB || sim_out[channel] == sim_in[channel])
+		return -1;
+	p = &sim_packets[channel][sim_out[channel]++ & (SIM_COMM_PACKETS - 1)];
+	len = p->len < max ? p->len : max;
+	memcpy(packet,p->data,len);
+	return len;
+}
+
+void SIM_Comm_Clear(void)
+{
+	sim_out[SIM_COMM_UART] = sim_in[SIM_COMM_UART];
+	sim_out[SIM_COMM_USB] = sim_in[SIM_COMM_USB];
+}
+
+/*!
+ ******************************************************************************
+ *	Weak: a test linking uart.c on the eDMA/UART model (uart_sim.c) sends the
+ * packets on the simulated line instead
+ ******************************************************************************
+*/
+__attribute__((weak)) void UART_SendPacketCMD(uint8_t *packet,int len)
+{
+	SIM_Comm_Put(SIM_COMM_UART,packet,len);
+}
+
+void USB_SendPacketCMD(uint8_t *packet,int len)
+{
+	SIM_Comm_Put(SIM_COMM_USB,packet,len);
+}
+
+int usb_main_init(void)
+{
+	return 1;
+}
+
+bool USB_PutcharComm(uint8_t ch)
+{
+	(void)ch;
+	return true;
+}
@@ -0,0 +1,384 @@
+/*
+ * i2c_sim.c
+ *
+ *  Simulated I2C bus: I2C.c with the queue port on a model of the bus and its
+ *  slaves. The device functions are those of the driver, the interrupts of
+ *  the bus and of its timer are played by SIM_I2C_Run at their simulated time
+ */
+
+#include <string.h>
+#include "I2C.h"
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include "EEPROM.h"
+#include "FRAM.h"
+#include "TMP100.h"
+#include "sim_clock.h"
+#include "sim_isr.h"
+#include "sim_i2c.h"
+
+#define SIM_EEPROM_SIZE			0x10000
+#define SIM_EEPROM_WRITE_US		5000
+#define SIM_TMP100_REGS			4
+
+typedef struct
+{
+	SIM_I2C_Slave_t	*slave;			// addressed slave, NULL if none
+	bool					read;
+	uint32_t				sub_left;		// pointer bytes still expected
+	uint32_t				data;				// data bytes written in this transaction
+	bool					event;			// event pending
+	I2CQ_Event_t		type;
+	uint64_t				event_ns;
+	bool					timer;			// timer armed
+	uint64_t				timer_ns;
+	bool					running;			// SIM_I2C_Run is active
+	bool					hold;				// the interrupts are not played
+	I2CQ_Bus_t			queue;
+} SIM_I2C_Port_t;
+
+static uint8_t				sim_eeprom[SIM_EEPROM_SIZE];
+static uint8_t				sim_fram[FRAM_SIZE];
+static uint8_t				sim_tmp100[N_TMP100][SIM_TMP100_REGS * 2];
+
+static SIM_I2C_Slave_t	sim_slaves[SIM_I2C_MAX_SLAVES] = {
+	{ .address = EERPROM_I2C_ADDRESS,.sub_size = 2,.mem = sim_eeprom,.size = sizeof(sim_eeprom),
+	  .page_size = EEPROM_PAGE_SIZE,.write_cycle_us = SIM_EEPROM_WRITE_US },
+	{ .address = FRAM_address,.sub_size = 2,.mem = sim_fram,.size = sizeof(sim_fram) },
+	{ .address = TMP100_1_8BIT_ADDR,.sub_size = 1,.reg_size = 2,.mem = sim_tmp100[0],.size = sizeof(sim_tmp100[0]) },
+	{ .address = TMP100_2_8BIT_ADDR,.sub_size = 1,.reg_size = 2,.mem = sim_tmp100[1],.size = sizeof(sim_tmp100[1]) }
+};
+
+static SIM_I2C_Port_t	i2c_port;
+static bool					sim_erased;		// memories erased once, they keep their content over a reset of the board
+static I2C_Device_t		i2c_any;			// requests of I2C_WriteI2C and I2C_ReadI2C
+
+SIM_I2C_Slave_t *SIM_I2C_Slave(uint8_t address)
+{
+	for (int i = 0;i < SIM_I2C_MAX_SLAVES;i++)
+	{
+		if (sim_slaves[i].mem != NULL && sim_slaves[i].address == (address & 0xFE))
+			return &sim_slaves[i];
+	}
+	return NULL;
+}
+
+void SIM_I2C_Reset(void)
+{
+	for (int i = 0;i < SIM_I2C_MAX_SLAVES;i++)
+	{
+		SIM_I2C_Slave_t	*s = &sim_slaves[i];
+
+		if (s->mem == NULL)
+			continue;
+		memset(s->mem,s->write_cycle_us != 0 ? 0xFF : 0,s->size);
+		s->nak = false;
+		s->pointer = 0;
+		s->busy_until_ns = 0;
+		s->writes = 0;
+		s->bytes_written = 0;
+		s->reads = 0;
+	}
+}
+
+/*!
+ *********************************************************************************
+ * Schedules the event ending an operation of the port
+ *********************************************************************************
+*/
+static void SIM_I2C_Post(SIM_I2C_Port_t *port,I2CQ_Event_t type,uint32_t bytes)
+{
+	port->event = true;
+	port->type = type;
+	port->event_ns = SIM_Clock_ns() + (uint64_t)bytes * port->queue.config.byte_us * 1000;
+}
+
+static uint32_t SIM_I2C_Offset(const SIM_I2C_Slave_t *s)
+{
+	return (s->pointer * (s->reg_size != 0 ? s->reg_size : 1)) % s->size;
+}
+
+static void I2C_PortStart(void *ctx,uint8_t address)
+{
+SIM_I2C_Port_t		*port = (SIM_I2C_Port_t *)ctx;
+SIM_I2C_Slave_t	*s = SIM_I2C_Slave(address);
+
+	port->read = (address & 1) != 0;
+	if (s == NULL || s->nak || SIM_Clock_ns() < s->busy_until_ns)
+	{
+		port->slave = NULL;
+		SIM_I2C_Post(port,I2CQ_EV_NAK,1);
+		return;
+	}
+	port->slave = s;
+	port->sub_left = port->read ? 0 : s->sub_size;
+	if (!port->read)
+		port->data = 0;
+	SIM_I2C_Post(port,I2CQ_EV_DONE,1);
+}
+
+static void I2C_PortWrite(void *ctx,const uint8_t *data,uint32_t len)
+{
+SIM_I2C_Port_t		*port = (SIM_I2C_Port_t *)ctx;
+SIM_I2C_Slave_t	*s = port->slave;
+uint32_t				offset,page;
+
+	if (s == NULL || port->read)
+	{
+		SIM_I2C_Post(port,I2CQ_EV_NAK,1);
+		return;
+	}
+	for (uint32_t i = 0;i < len;i++)
+	{
+		if (port->sub_left > 0)
+		{
+			if (port->sub_left == s->sub_size)
+				s->pointer = 0;
+			s->pointer = (s->pointer << 8) | data[i];
+			port->sub_left--;
+			continue;
+		}
+		offset = SIM_I2C_Offset(s);
+		s->mem[offset] = data[i];
+		if (s->page_size != 0)
+		{
+			page = offset - offset % s->page_size;
+			s->pointer = page + (offset + 1 - page) % s->page_size;
+		}
+		else
+			s->pointer = (offset + 1) % s->size;
+		port->data++;
+		s->bytes_written++;
+	}
+	SIM_I2C_Post(port,I2CQ_EV_DONE,len);
+}
+
+static void I2C_PortRead(void *ctx,uint8_t *data,uint32_t len)
+{
+SIM_I2C_Port_t		*port = (SIM_I2C_Port_t *)ctx;
+SIM_I2C_Slave_t	*s = port->slave;
+uint32_t				offset;
+
+	if (s == NULL || !port->read)
+	{
+		SIM_I2C_Post(port,I2CQ_EV_NAK,1);
+		return;
+	}
+	offset = SIM_I2C_Offset(s);
+	for (uint32_t i = 0;i < len;i++)
+		data[i] = s->mem[(offset + i) % s->size];
+	if (s->reg_size == 0)
+		s->pointer = (offset + len) % s->size;
+	s->reads++;
+	SIM_I2C_Post(port,I2CQ_EV_DONE,len);
+}
+
+static void I2C_PortStop(void *ctx)
+{
+SIM_I2C_Port_t		*port = (SIM_I2C_Port_t *)ctx;
+SIM_I2C_Slave_t	*s = port->slave;
+
+	if (s != NULL && !port->read && port->data > 0)
+	{
+		s->writes++;
+		if (s->write_cycle_us != 0)
+			s->busy_until_ns = SIM_Clock_ns() + (uint64_t)s->write_cycle_us * 1000;
+	}
+	port->slave = NULL;
+	port->data = 0;
+	port->event = false;
+}
+
+static void I2C_PortTimer(void *ctx,uint32_t us)
+{
+SIM_I2C_Port_t		*port = (SIM_I2C_Port_t *)ctx;
+
+	port->timer = us != 0;
+	port->timer_ns = SIM_Clock_ns() + (uint64_t)us * 1000;
+}
+
+static uint32_t I2C_PortNow(void *ctx)
+{
+	(void)ctx;
+	return (uint32_t)(SIM_Clock_ns() / 1000);
+}
+
+/*!
+ *********************************************************************************
+ * Plays the interrupts of the bus (I2C1) and of its timer (PIT3) in the order of
+ * their simulated time, until the queue has nothing left to do
+ *********************************************************************************
+*/
+void SIM_I2C_Run(void)
+{
+SIM_I2C_Port_t		*port = &i2c_port;
+uint64_t				now,at;
+bool					timer;
+uint32_t				prev;
+
+	if (port->running || port->hold)
+		return;
+	port->running = true;
+	while (port->event || port->timer)
+	{
+		timer = !port->event || (port->timer && port->timer_ns < port->event_ns);
+		at = timer ? port->timer_ns : port->event_ns;
+		now = SIM_Clock_ns();
+		if (at > now)
+			SIM_Clock_Sleep(at - now);
+		if (timer)
+		{
+			port->timer = false;
+			prev = SIM_ISR_Enter(I2C_QUEUE_PIT_IRQn);
+			I2CQ_Event(&port->queue,I2CQ_EV_TIMER);
+		}
+		else
+		{
+			port->event = false;
+			prev = SIM_ISR_Enter(I2C_QUEUE_IRQn);
+			I2CQ_Event(&port->queue,port->type);
+		}
+		SIM_ISR_Exit(prev);
+	}
+	port->running = false;
+}
+
+void SIM_I2C_Hold(bool hold)
+{
+	i2c_port.hold = hold;
+	if (!hold)
+		SIM_I2C_Run();
+}
+
+/*!
+ *********************************************************************************
+ * End of a request of a device, wakes up the waiting task
+ *********************************************************************************
+*/
+static void I2C_DeviceDone(I2CQ_Request_t *req)
+{
+BaseType_t		xHigherPriorityTaskWoken = pdFALSE;
+
+	xSemaphoreGiveFromISR(((I2C_Device_t *)req->arg)->done,&xHigherPriorityTaskWoken);
+	portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
+bool I2C_WriteI2C(uint8_t slave_address,uint16_t sub_address,uint16_t sub_size,uint8_t *data,int len)
+{
+	if (len < 0)
+		return false;
+	return I2C_DeviceWrite(&i2c_any,slave_address,sub_address,sub_size,data,len);
+}
+
+bool I2C_ReadI2C(uint8_t slave_address,uint16_t sub_address,uint16_t sub_size,uint8_t *data,int len)
+{
+	if (len < 0)
+		return false;
+	return I2C_DeviceRead(&i2c_any,slave_address,sub_address,sub_size,data,len);
+}
+
+bool I2C_Bus_Init(void)
+{
+const I2CQ_Port_t		port = { I2C_PortStart,I2C_PortWrite,I2C_PortRead,I2C_PortStop,I2C_PortTimer,I2C_PortNow,&i2c_port };
+const I2CQ_Config_t	config = {
+	I2C_TIMEOUT_MS * 1000,
+	(9 * 1000000 + I2C1_BAUD_RATE - 1) / I2C1_BAUD_RATE,
+	I2C_QUEUE_POLL_US,
+	I2C_WRITE_CYCLE_MS * 1000
+};
+
+	if (!sim_erased)
+	{
+		SIM_I2C_Reset();
+		sim_erased = true;
+	}
+	memset(&i2c_port,0,sizeof(i2c_port));
+	I2CQ_Init(&i2c_port.queue,&port,&config);
+	return I2C_DeviceInit(&i2c_any,I2CQ_PRIO_NORMAL,0,0);
+}
+
+bool I2C_DeviceInit(I2C_Device_t *dev,uint8_t priority,uint8_t flags,uint16_t page_size)
+{
+	memset(dev,0,sizeof(*dev));
+	dev->req.priority = priority;
+	dev->req.page_size = page_size;
+	dev->req.callback = I2C_DeviceDone;
+	dev->req.arg = dev;
+	dev->req.status = I2C_Stat_Idle;
+	dev->flags = flags;
+	dev->mutex = xSemaphoreCreateMutex();
+	dev->done = xSemaphoreCreateBinary();
+	return dev->mutex != NULL && dev->done != NULL;
+}
+
+/*!
+ *********************************************************************************
+ * Queues a request of a device and waits until it is done, as the driver does.
+ * The bus runs until the queue is idle before the task waits
+ *********************************************************************************
+*/
+static bool I2C_DeviceTransfer(I2C_Device_t *dev,uint8_t flags,uint8_t slave_address,uint32_t sub_address,
+		unsigned sub_size,uint8_t *data,uint32_t len)
+{
+uint32_t		primask;
+bool			result;
+
+	if (xTaskGetSchedulerState() != taskSCHEDULER_RUNNING || dev->mutex == NULL)
+		return false;
+	if (xSemaphoreTake(dev->mutex,I2C_DEVICE_WAIT_MS / portTICK_PERIOD_MS) != pdTRUE)
+		return false;
+	dev->req.address = slave_address;
+	dev->req.flags = dev->flags | flags;
+	dev->req.sub_address = sub_address;
+	dev->req.sub_size = sub_size;
+	dev->req.data = data;
+	dev->req.len = len;
+	xSemaphoreTake(dev->done,0);
+	primask = DisableGlobalIRQ();
+	result = I2CQ_Submit(&i2c_port.queue,&dev->req);
+	EnableGlobalIRQ(primask);
+	SIM_I2C_Run();
+	if (result && xSemaphoreTake(dev->done,I2C_DEVICE_WAIT_MS / portTICK_PERIOD_MS) != pdTRUE)
+	{
+		primask = DisableGlobalIRQ();
+		if (I2CQ_Cancel(&i2c_port.queue,&dev->req))
+			dev->req.status = I2C_Stat_Timeout;
+		EnableGlobalIRQ(primask);
+	}
+	result = result && dev->req.status == I2C_Stat_Success;
+	xSemaphoreGive(dev->mutex);
+	return result;
+}
+
+bool I2C_DeviceRead(I2C_Device_t *dev,uint8_t slave_address,uint32_t sub_address,unsigned sub_size,uint8_t *data,uint32_t len)
+{
+	return I2C_DeviceTransfer(dev,I2CQ_READ,slave_address,sub_address,sub_size,data,len);
+}
+
+bool I2C_DeviceWrite(I2C_Device_t *dev,uint8_t slave_address,uint32_t sub_address,unsigned sub_size,uint8_t *data,uint32_t len)
+{
+	return I2C_DeviceTransfer(dev,0,slave_address,sub_address,sub_size,data,len);
+}
+
+bool I2C_Submit(I2CQ_Request_t *req)
+{
+uint32_t		primask;
+bool			result;
+
+	primask = DisableGlobalIRQ();
+	result = I2CQ_Submit(&i2c_port.queue,req);
+	EnableGlobalIRQ(primask);
+	SIM_I2C_Run();
+	return result;
+}
+
+bool I2C_Cancel(I2CQ_Request_t *req)
+{
+uint32_t		primask;
+bool			result;
+
+	primask = DisableGlobalIRQ();
+	result = I2CQ_Cancel(&i2c_port.queue,req);
+	EnableGlobalIRQ(primask);
+	return result;
+}
@@ -0,0 +1,178 @@
+/*
+ * cmsis_os2.h
+ *
+ *  Subset of the CMSIS-RTOS2 API used by the firmware, implemented over the
+ *  FreeRTOS API by Host/sim/cmsis_os2.c for the host build. The types and
+ *  values are the ones of the CMSIS-RTOS2 specification
+ */
+
+#ifndef CMSIS_OS2_H_
+#define CMSIS_OS2_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef __NO_RETURN
+	#define __NO_RETURN			__attribute__((__noreturn__))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+	osKernelInactive		=  0,
+	osKernelReady			=  1,
+	osKernelRunning		=  2,
+	osKernelLocked			=  3,
+	osKernelSuspended		=  4,
+	osKernelError			= -1,
+	osKernelReserved		= 0x7FFFFFFF
+} osKernelState_t;
+
+typedef enum {
+	osThreadInactive		=  0,
+	osThreadReady			=  1,
+	osThreadRunning		=  2,
+	osThreadBlocked		=  3,
+	osThreadTerminated	=  4,
+	osThreadError			= -1,
+	osThreadReserved		= 0x7FFFFFFF
+} osThreadState_t;
+
+typedef enum {
+	osPriorityNone				=  0,
+	osPriorityIdle				=  1,
+	osPriorityLow				=  8,
+	osPriorityLow1				=  8+1,
+	osPriorityLow2				=  8+2,
+	osPriorityLow3				=  8+3,
+	osPriorityLow4				=  8+4,
+	osPriorityLow5				=  8+5,
+	osPriorityLow6				=  8+6,
+	osPriorityLow7				=  8+7,
+	osPriorityBelowNormal	= 16,
+	osPriorityBelowNormal1	= 16+1,
+	osPriorityBelowNormal2	= 16+2,
+	osPriorityBelowNormal3	= 16+3,
+	osPriorityBelowNormal4	= 16+4,
+	osPriorityBelowNormal5	= 16+5,
+	osPriorityBelowNormal6	= 16+6,
+	osPriorityBelowNormal7	= 16+7,
+	osPriorityNormal			= 24,
+	osPriorityNormal1			= 24+1,
+	osPriorityNormal2			= 24+2,
+	osPriorityNormal3			= 24+3,
+	osPriorityNormal4			= 24+4,
+	osPriorityNormal5			= 24+5,
+	osPriorityNormal6			= 24+6,
+	osPriorityNormal7			= 24+7,
+	osPriorityAboveNormal	= 32,
+	osPriorityAboveNormal1	= 32+1,
+	osPriorityAboveNormal2	= 32+2,
+	osPriorityAboveNormal3	= 32+3,
+	osPriorityAboveNormal4	= 32+4,
+	osPriorityAboveNormal5	= 32+5,
+	osPriorityAboveNormal6	= 32+6,
+	osPriorityAboveNormal7	= 32+7,
+	osPriorityHigh				= 40,
+	osPriorityHigh1			= 40+1,
+	osPriorityHigh2			= 40+2,
+	osPriorityHigh3			= 40+3,
+	osPriorityHigh4			= 40+4,
+	osPriorityHigh5			= 40+5,
+	osPriorityHigh6			= 40+6,
+	osPriorityHigh7			= 40+7,
+	osPriorityRealtime		= 48,
+	osPriorityRealtime1		= 48+1,
+	osPriorityRealtime2		= 48+2,
+	osPriorityRealtime3		= 48+3,
+	osPriorityRealtime4		= 48+4,
+	osPriorityRealtime5		= 48+5,
+	osPriorityRealtime6		= 48+6,
+	osPriorityRealtime7		= 48+7,
+	osPriorityISR				= 56,
+	osPriorityError			= -1,
+	osPriorityReserved		= 0x7FFFFFFF
+} osPriority_t;
+
+typedef enum {
+	osOK						=  0,
+	osError					= -1,
+	osErrorTimeout			= -2,
+	osErrorResource		= -3,
+	osErrorParameter		= -4,
+	osErrorNoMemory		= -5,
+	osErrorISR				= -6,
+	osStatusReserved		= 0x7FFFFFFF
+} osStatus_t;
+
+typedef void (*osThreadFunc_t)(void *argument);
+
+typedef void *osThreadId_t;
+typedef void *osEventFlagsId_t;
+
+#define osWaitForever				0xFFFFFFFFU
+
+#define osFlagsWaitAny				0x00000000U
+#define osFlagsWaitAll				0x00000001U
+#define osFlagsNoClear				0x00000002U
+
+#define osFlagsError					0x80000000U
+#define osFlagsErrorUnknown		0xFFFFFFFFU
+#define osFlagsErrorTimeout		0xFFFFFFFEU
+#define osFlagsErrorResource		0xFFFFFFFDU
+#define osFlagsErrorParameter		0xFFFFFFFCU
+#define osFlagsErrorISR				0xFFFFFFFAU
+
+#define osThreadDetached			0x00000000U
+#define osThreadJoinable			0x00000001U
+
+typedef struct {
+	const char		*name;
+	uint32_t			attr_bits;
+	void				*cb_mem;
+	uint32_t			cb_size;
+	void				*stack_mem;
+	uint32_t			stack_size;
+	osPriority_t	priority;
+	uint32_t			tz_module;
+	uint32_t			reserved;
+} osThreadAttr_t;
+
+typedef struct {
+	const char		*name;
+	uint32_t			attr_bits;
+	void				*cb_mem;
+	uint32_t			cb_size;
+} osEventFlagsAttr_t;
+
+osStatus_t osKernelInitialize(void);
+osStatus_t osKernelStart(void);
+osKernelState_t osKernelGetState(void);
+uint32_t osKernelGetTickCount(void);
+uint32_t osKernelGetTickFreq(void);
+
+osThreadId_t osThreadNew(osThreadFunc_t func,void *argument,const osThreadAttr_t *attr);
+osThreadId_t osThreadGetId(void);
+osThreadState_t osThreadGetState(osThreadId_t thread_id);
+osStatus_t osThreadSuspend(osThreadId_t thread_id);
+osStatus_t osThreadResume(osThreadId_t thread_id);
+osStatus_t osThreadYield(void);
+__NO_RETURN void osThreadExit(void);
+
+osStatus_t osDelay(uint32_t ticks);
+osStatus_t osDelayUntil(uint32_t ticks);
+
+osEventFlagsId_t osEventFlagsNew(const osEventFlagsAttr_t *attr);
+uint32_t osEventFlagsSet(osEventFlagsId_t ef_id,uint32_t flags);
+uint32_t osEventFlagsClear(osEventFlagsId_t ef_id,uint32_t flags);
+uint32_t osEventFlagsGet(osEventFlagsId_t ef_id);
+uint32_t osEventFlagsWait(osEventFlagsId_t ef_id,uint32_t flags,uint32_t options,uint32_t timeout);
+osStatus_t osEventFlagsDelete(osEventFlagsId_t ef_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CMSIS_OS2_H_ */
@@ -0,0 +1,181 @@
+/*
+ * core_cm4.h
+ *
+ *  Host stand-in of the CMSIS Cortex-M4 core header: the core registers used
+ *  by the firmware are simulated, the intrinsics are no-ops or portable C
+ */
+
+#ifndef CORE_CM4_H_
+#define CORE_CM4_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+	#define __I					volatile
+#else
+	#define __I					volatile const
+#endif
+#define __O						volatile
+#define __IO					volatile
+#define __IM					volatile const
+#define __OM					volatile
+#define __IOM					volatile
+
+#ifndef __STATIC_INLINE
+	#define __STATIC_INLINE				static inline
+#endif
+#ifndef __STATIC_FORCEINLINE
+	#define __STATIC_FORCEINLINE		static inline
+#endif
+#ifndef __INLINE
+	#define __INLINE						inline
+#endif
+#ifndef __WEAK
+	#define __WEAK							__attribute__((weak))
+#endif
+#ifndef __PACKED
+	#define __PACKED						__attribute__((packed))
+#endif
+#ifndef __ALIGNED
+	#define __ALIGNED(x)				__attribute__((aligned(x)))
+#endif
+#ifndef __NO_RETURN
+	#define __NO_RETURN					__attribute__((__noreturn__))
+#endif
+#ifndef __USED
+	#define __USED							__attribute__((used))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ ******************************************************************************
+ *	Simulated core state, SIM_IPSR != 0 lets the code under test run as if it
+ *	were called from an interrupt handler
+ ******************************************************************************
+*/
+extern volatile uint32_t SIM_IPSR;
+extern volatile uint32_t SIM_PRIMASK;
+extern uint8_t SIM_NVIC_Enabled[128];
+extern uint8_t SIM_NVIC_Pending[128];
+extern uint8_t SIM_NVIC_Priority[128];
+
+/*!
+ ******************************************************************************
+ *	Interrupt requests of the simulated peripherals: the handler runs at once
+ * if the interrupt is enabled, PRIMASK is clear and no handler of the same or
+ * a higher priority is active, else it stays pending until that changes
+ ******************************************************************************
+*/
+typedef void (*SIM_NVIC_Handler_t)(void);
+
+void SIM_NVIC_Raise(IRQn_Type irq,SIM_NVIC_Handler_t handler);
+void SIM_NVIC_Dispatch(void);
+
+typedef struct {
+	__IOM uint32_t CTRL;
+	__IOM uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct {
+	__IOM uint32_t DHCSR;
+	__IOM uint32_t DEMCR;
+} CoreDebug_Type;
+
+typedef struct {
+	__IOM uint32_t CTRL;
+	__IOM uint32_t LOAD;
+	__IOM uint32_t VAL;
+	__IM  uint32_t CALIB;
+} SysTick_Type;
+
+typedef struct {
+	__IM  uint32_t CPUID;
+	__IOM uint32_t ICSR;
+	__IOM uint32_t VTOR;
+	__IOM uint32_t AIRCR;
+	__IOM uint32_t SCR;
+	__IOM uint32_t CCR;
+	__IOM uint8_t  SHP[12U];
+	__IOM uint32_t SHCSR;
+	__IOM uint32_t CFSR;
+	__IOM uint32_t HFSR;
+	__IOM uint32_t DFSR;
+	__IOM uint32_t MMFAR;
+	__IOM uint32_t BFAR;
+	__IOM uint32_t AFSR;
+	__IOM uint32_t CPACR;
+} SCB_Type;
+
+extern DWT_Type SIM_DWT;
+extern CoreDebug_Type SIM_CoreDebug;
+extern SysTick_Type SIM_SysTick;
+extern SCB_Type SIM_SCB;
+
+#define DWT									(&SIM_DWT)
+#define CoreDebug						(&SIM_CoreDebug)
+#define SysTick							(&SIM_SysTick)
+#define SCB									(&SIM_SCB)
+
+#define DWT_CTRL_CYCCNTENA_Msk		(1UL)
+#define CoreDebug_DEMCR_TRCENA_Msk	(1UL << 24)
+#define SCB_ICSR_VECTACTIVE_Msk		(0x1FFUL)
+#define SCB_AIRCR_SYSRESETREQ_Msk	(1UL << 2)
+#define SysTick_CTRL_ENABLE_Msk		(1UL)
+#define SysTick_CTRL_TICKINT_Msk		(1UL << 1)
+#define SysTick_CTRL_CLKSOURCE_Msk	(1UL << 2)
+
+void SIM_SystemReset(void);
+
+__STATIC_INLINE uint32_t __get_IPSR(void)			{ return SIM_IPSR; }
+__STATIC_INLINE uint32_t __get_PRIMASK(void)		{ return SIM_PRIMASK; }
+__STATIC_INLINE void __set_PRIMASK(uint32_t m)	{ SIM_PRIMASK = m; if (m == 0) SIM_NVIC_Dispatch(); }
+__STATIC_INLINE void __disable_irq(void)			{ SIM_PRIMASK = 1; }
+__STATIC_INLINE void __enable_irq(void)			{ SIM_PRIMASK = 0; SIM_NVIC_Dispatch(); }
+__STATIC_INLINE uint32_t __get_BASEPRI(void)		{ return 0; }
+__STATIC_INLINE void __set_BASEPRI(uint32_t v)	{ (void)v; }
+__STATIC_INLINE uint32_t __get_CONTROL(void)		{ return 0; }
+__STATIC_INLINE uint32_t __get_MSP(void)			{ return 0; }
+__STATIC_INLINE uint32_t __get_PSP(void)			{ return 0; }
+
+#define __NOP()								((void)0)
+#define __WFI()								((void)0)
+#define __WFE()								((void)0)
+#define __SEV()								((void)0)
+#define __BKPT(v)							((void)(v))
+#define __DSB()								__atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define __DMB()								__atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define __ISB()								__atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+__STATIC_INLINE uint32_t __REV(uint32_t v)		{ return __builtin_bswap32(v); }
+__STATIC_INLINE uint32_t __REV16(uint32_t v)	{ return ((v & 0x00FF00FFUL) << 8) | ((v >> 8) & 0x00FF00FFUL); }
+__STATIC_INLINE uint32_t __RBIT(uint32_t v)
+{
+	uint32_t r = 0;
+	for (int i = 0;i < 32;i++,v >>= 1)
+		r = (r << 1) | (v & 1);
+	return r;
+}
+__STATIC_INLINE uint8_t __CLZ(uint32_t v)		{ return v == 0 ? 32 : (uint8_t)__builtin_clz(v); }
+
+__STATIC_INLINE void NVIC_EnableIRQ(IRQn_Type irq)			{ if (irq >= 0) { SIM_NVIC_Enabled[irq] = 1; SIM_NVIC_Dispatch(); } }
+__STATIC_INLINE void NVIC_DisableIRQ(IRQn_Type irq)		{ if (irq >= 0) SIM_NVIC_Enabled[irq] = 0; }
+__STATIC_INLINE uint32_t NVIC_GetEnableIRQ(IRQn_Type irq)	{ return irq >= 0 ? SIM_NVIC_Enabled[irq] : 0; }
+__STATIC_INLINE void NVIC_SetPendingIRQ(IRQn_Type irq)	{ if (irq >= 0) SIM_NVIC_Pending[irq] = 1; }
+__STATIC_INLINE void NVIC_ClearPendingIRQ(IRQn_Type irq)	{ if (irq >= 0) SIM_NVIC_Pending[irq] = 0; }
+__STATIC_INLINE uint32_t NVIC_GetPendingIRQ(IRQn_Type irq)	{ return irq >= 0 ? SIM_NVIC_Pending[irq] : 0; }
+__STATIC_INLINE void NVIC_SetPriority(IRQn_Type irq,uint32_t prio)	{ if (irq >= 0) SIM_NVIC_Priority[irq] = (uint8_t)prio; }
+__STATIC_INLINE uint32_t NVIC_GetPriority(IRQn_Type irq)	{ return irq >= 0 ? SIM_NVIC_Priority[irq] : 0; }
+__STATIC_INLINE void NVIC_SetPriorityGrouping(uint32_t g)	{ (void)g; }
+__STATIC_INLINE uint32_t NVIC_GetPriorityGrouping(void)	{ return 0; }
+__STATIC_INLINE uint32_t NVIC_EncodePriority(uint32_t g,uint32_t pre,uint32_t sub)	{ (void)g; (void)sub; return pre; }
+__STATIC_INLINE void NVIC_SystemReset(void)					{ SIM_SystemReset(); }
+__STATIC_INLINE uint32_t SysTick_Config(uint32_t ticks)	{ SIM_SysTick.LOAD = ticks - 1; return 0; }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CORE_CM4_H_ */
@@ -0,0 +1,235 @@
+/*
+ * fsl_device_registers.h
+ *
+ *  Host stand-in of the device header: the register definitions of the
+ *  MK22FA12 are used unchanged, the peripherals are mapped to simulated
+ *  register blocks in RAM instead of their bus addresses
+ */
+
+#ifndef __FSL_DEVICE_REGISTERS_H__
+#define __FSL_DEVICE_REGISTERS_H__
+
+#define K22FA12_SERIES
+
+#include "MK22FA12.h"
+#include "MK22FA12_features.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+extern ADC_Type       SIM_ADC0;
+extern ADC_Type       SIM_ADC1;
+extern AIPS_Type      SIM_AIPS0;
+extern AIPS_Type      SIM_AIPS1;
+extern AXBS_Type      SIM_AXBS;
+extern CAN_Type       SIM_CAN0;
+extern CMP_Type       SIM_CMP0;
+extern CMP_Type       SIM_CMP1;
+extern CMP_Type       SIM_CMP2;
+extern CMT_Type       SIM_CMT;
+extern CRC_Type       SIM_CRC0;
+extern DAC_Type       SIM_DAC0;
+extern DAC_Type       SIM_DAC1;
+extern DMA_Type       SIM_DMA0;
+extern DMAMUX_Type    SIM_DMAMUX;
+extern EWM_Type       SIM_EWM;
+extern FB_Type        SIM_FB;
+extern FMC_Type       SIM_FMC;
+extern FTFE_Type      SIM_FTFE;
+extern FTM_Type       SIM_FTM0;
+extern FTM_Type       SIM_FTM1;
+extern FTM_Type       SIM_FTM2;
+extern FTM_Type       SIM_FTM3;
+extern GPIO_Type      SIM_GPIOA;
+extern GPIO_Type      SIM_GPIOB;
+extern GPIO_Type      SIM_GPIOC;
+extern GPIO_Type      SIM_GPIOD;
+extern GPIO_Type      SIM_GPIOE;
+extern I2C_Type       SIM_I2C0;
+extern I2C_Type       SIM_I2C1;
+extern I2C_Type       SIM_I2C2;
+extern I2S_Type       SIM_I2S0;
+extern LLWU_Type      SIM_LLWU;
+extern LPTMR_Type     SIM_LPTMR0;
+extern MCG_Type       SIM_MCG;
+extern MCM_Type       SIM_MCM;
+extern OSC_Type       SIM_OSC;
+extern PDB_Type       SIM_PDB0;
+extern PIT_Type       SIM_PIT;
+extern PMC_Type       SIM_PMC;
+/* the port blocks are as far apart as on the chip, IO.cpp gets the index of a
+   port from its address */
+#define SIM_PORT_SPACING     0x1000u
+extern uint8_t        SIM_PORT[5][SIM_PORT_SPACING];
+extern RCM_Type       SIM_RCM;
+extern RFSYS_Type     SIM_RFSYS;
+extern RFVBAT_Type    SIM_RFVBAT;
+extern RTC_Type       SIM_RTC;
+extern SDHC_Type      SIM_SDHC;
+extern SIM_Type       SIM_SIM;
+extern SMC_Type       SIM_SMC;
+extern SPI_Type       SIM_SPI0;
+extern SPI_Type       SIM_SPI1;
+extern SPI_Type       SIM_SPI2;
+extern SYSMPU_Type    SIM_SYSMPU;
+extern UART_Type      SIM_UART0;
+extern UART_Type      SIM_UART1;
+extern UART_Type      SIM_UART2;
+extern UART_Type      SIM_UART3;
+extern UART_Type      SIM_UART4;
+extern UART_Type      SIM_UART5;
+extern USB_Type       SIM_USB0;
+extern USBDCD_Type    SIM_USBDCD;
+extern VREF_Type      SIM_VREF;
+extern WDOG_Type      SIM_WDOG;
+
+#ifdef __cplusplus
+}
+#endif
+
+#undef ADC0
+#define ADC0                 (&SIM_ADC0)
+#undef ADC1
+#define ADC1                 (&SIM_ADC1)
+#undef AIPS0
+#define AIPS0                (&SIM_AIPS0)
+#undef AIPS1
+#define AIPS1                (&SIM_AIPS1)
+#undef AXBS
+#define AXBS                 (&SIM_AXBS)
+#undef CAN0
+#define CAN0                 (&SIM_CAN0)
+#undef CMP0
+#define CMP0                 (&SIM_CMP0)
+#undef CMP1
+#define CMP1                 (&SIM_CMP1)
+#undef CMP2
+#define CMP2                 (&SIM_CMP2)
+#undef CMT
+#define CMT                  (&SIM_CMT)
+#undef CRC0
+#define CRC0                 (&SIM_CRC0)
+#undef DAC0
+#define DAC0                 (&SIM_DAC0)
+#undef DAC1
+#define DAC1                 (&SIM_DAC1)
+#undef DMA0
+#define DMA0                 (&SIM_DMA0)
+#undef DMAMUX
+#define DMAMUX               (&SIM_DMAMUX)
+#undef EWM
+#define EWM                  (&SIM_EWM)
+#undef FB
+#define FB                   (&SIM_FB)
+#undef FMC
+#define FMC                  (&SIM_FMC)
+#undef FTFE
+#define FTFE                 (&SIM_FTFE)
+#undef FTM0
+#define FTM0                 (&SIM_FTM0)
+#undef FTM1
+#define FTM1                 (&SIM_FTM1)
+#undef FTM2
+#define FTM2                 (&SIM_FTM2)
+#undef FTM3
+#define FTM3                 (&SIM_FTM3)
+#undef GPIOA
+#define GPIOA                (&SIM_GPIOA)
+#undef GPIOB
+#define GPIOB                (&SIM_GPIOB)
+#undef GPIOC
+#define GPIOC                (&SIM_GPIOC)
+#undef GPIOD
+#define GPIOD                (&SIM_GPIOD)
+#undef GPIOE
+#define GPIOE                (&SIM_GPIOE)
+#undef I2C0
+#define I2C0                 (&SIM_I2C0)
+#undef I2C1
+#define I2C1                 (&SIM_I2C1)
+#undef I2C2
+#define I2C2                 (&SIM_I2C2)
+#undef I2S0
+#define I2S0                 (&SIM_I2S0)
+#undef LLWU
+#define LLWU                 (&SIM_LLWU)
+#undef LPTMR0
+#define LPTMR0               (&SIM_LPTMR0)
+#undef MCG
+#define MCG                  (&SIM_MCG)
+#undef MCM
+#define MCM                  (&SIM_MCM)
+#undef OSC
+#define OSC                  (&SIM_OSC)
+#undef PDB0
+#define PDB0                 (&SIM_PDB0)
+#undef PIT
+#define PIT                  (&SIM_PIT)
+#undef PMC
+#define PMC                  (&SIM_PMC)
+#undef PORTA
+#define PORTA                ((PORT_Type *)SIM_PORT[0])
+#undef PORTA_BASE
+#define PORTA_BASE           ((uint32_t)(uintptr_t)PORTA)
+#undef PORTB
+#define PORTB                ((PORT_Type *)SIM_PORT[1])
+#undef PORTB_BASE
+#define PORTB_BASE           ((uint32_t)(uintptr_t)PORTB)
+#undef PORTC
+#define PORTC                ((PORT_Type *)SIM_PORT[2])
+#undef PORTC_BASE
+#define PORTC_BASE           ((uint32_t)(uintptr_t)PORTC)
+#undef PORTD
+#define PORTD                ((PORT_Type *)SIM_PORT[3])
+#undef PORTD_BASE
+#define PORTD_BASE           ((uint32_t)(uintptr_t)PORTD)
+#undef PORTE
+#define PORTE                ((PORT_Type *)SIM_PORT[4])
+#undef PORTE_BASE
+#define PORTE_BASE           ((uint32_t)(uintptr_t)PORTE)
+#undef RCM
+#define RCM                  (&SIM_RCM)
+#undef RFSYS
+#define RFSYS                (&SIM_RFSYS)
+#undef RFVBAT
+#define RFVBAT               (&SIM_RFVBAT)
+#undef RTC
+#define RTC                  (&SIM_RTC)
+#undef SDHC
+#define SDHC                 (&SIM_SDHC)
+#undef SIM
+#define SIM                  (&SIM_SIM)
+#undef SIM_BASE
+#define SIM_BASE             ((uint32_t)(uintptr_t)&SIM_SIM)		// clock gates of fsl_clock.h, needs a non-PIE build
+#undef SMC
+#define SMC                  (&SIM_SMC)
+#undef SPI0
+#define SPI0                 (&SIM_SPI0)
+#undef SPI1
+#define SPI1                 (&SIM_SPI1)
+#undef SPI2
+#define SPI2                 (&SIM_SPI2)
+#undef SYSMPU
+#define SYSMPU               (&SIM_SYSMPU)
+#undef UART0
+#define UART0                (&SIM_UART0)
+#undef UART1
+#define UART1                (&SIM_UART1)
+#undef UART2
+#define UART2                (&SIM_UART2)
+#undef UART3
+#define UART3                (&SIM_UART3)
+#undef UART4
+#define UART4                (&SIM_UART4)
+#undef UART5
+#define UART5                (&SIM_UART5)
+#undef USB0
+#define USB0                 (&SIM_USB0)
+#undef USBDCD
+#define USBDCD               (&SIM_USBDCD)
+#undef VREF
+#define VREF                 (&SIM_VREF)
+#undef WDOG
+#define WDOG                 (&SIM_WDOG)
+
+#endif /* __FSL_DEVICE_REGISTERS_H__ */
@@ -0,0 +1,33 @@
+/*
+ * fsl_edma.h
+ *
+ *  Host stand-in of the eDMA driver header: the declarations of the SDK
+ *  driver are used unchanged. The inline functions which start and stop the
+ *  hardware requests of a channel by writing its number to a command register
+ *  are implemented by the eDMA/UART model (uart_sim.c), the simulated
+ *  registers are plain memory
+ */
+
+#ifndef SIM_FSL_EDMA_H_
+#define SIM_FSL_EDMA_H_
+
+#define EDMA_EnableChannelRequest			EDMA_EnableChannelRequest_Register
+#define EDMA_DisableChannelRequest		EDMA_DisableChannelRequest_Register
+
+#include_next "fsl_edma.h"
+
+#undef EDMA_EnableChannelRequest
+#undef EDMA_DisableChannelRequest
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* __cplusplus */
+
+void EDMA_EnableChannelRequest(DMA_Type *base,uint32_t channel);
+void EDMA_DisableChannelRequest(DMA_Type *base,uint32_t channel);
+
+#if defined(__cplusplus)
+}
+#endif /* __cplusplus */
+
+#endif /* SIM_FSL_EDMA_H_ */
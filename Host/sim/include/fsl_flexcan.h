@@ -0,0 +1,38 @@
+/*
+ * fsl_flexcan.h
+ *
+ *  Host stand-in of the FlexCAN driver header: the declarations of the SDK
+ *  driver are used unchanged. The inline functions which clear flags by
+ *  writing ones or change the interrupt line are implemented by the FlexCAN
+ *  model (can_sim.c), the simulated registers are plain memory
+ */
+
+#ifndef SIM_FSL_FLEXCAN_H_
+#define SIM_FSL_FLEXCAN_H_
+
+#define FLEXCAN_ClearStatusFlags			FLEXCAN_ClearStatusFlags_Register
+#define FLEXCAN_ClearMbStatusFlags		FLEXCAN_ClearMbStatusFlags_Register
+#define FLEXCAN_EnableMbInterrupts		FLEXCAN_EnableMbInterrupts_Register
+#define FLEXCAN_DisableMbInterrupts		FLEXCAN_DisableMbInterrupts_Register
+
+#include_next "fsl_flexcan.h"
+
+#undef FLEXCAN_ClearStatusFlags
+#undef FLEXCAN_ClearMbStatusFlags
+#undef FLEXCAN_EnableMbInterrupts
+#undef FLEXCAN_DisableMbInterrupts
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* __cplusplus */
+
+void FLEXCAN_ClearStatusFlags(CAN_Type *base,uint32_t mask);
+void FLEXCAN_ClearMbStatusFlags(CAN_Type *base,uint32_t mask);
+void FLEXCAN_EnableMbInterrupts(CAN_Type *base,uint32_t mask);
+void FLEXCAN_DisableMbInterrupts(CAN_Type *base,uint32_t mask);
+
+#if defined(__cplusplus)
+}
+#endif /* __cplusplus */
+
+#endif /* SIM_FSL_FLEXCAN_H_ */
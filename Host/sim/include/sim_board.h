@@ -0,0 +1,66 @@
+/*
+ * sim_board.h
+ *
+ *  Control of the simulated board (board.c, board-Ana.c) by the host tests
+ */
+
+#ifndef SIM_BOARD_H_
+#define SIM_BOARD_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*!
+ ******************************************************************************
+ *	Called after each conversion result written by a scan, as a task reading
+ * the channels between two DMA transfers
+ ******************************************************************************
+*/
+typedef void (*SIM_ADC_ConversionHook_t)(unsigned adc,unsigned channel,void *ctx);
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* __cplusplus */
+
+/*!
+ ******************************************************************************
+ *	Plays the PWM period interrupt of a PWM timer (FTM0 .. FTM3)
+ ******************************************************************************
+*/
+void SIM_Board_PWMInterrupt(unsigned channel);
+
+/*!
+ ******************************************************************************
+ *	Plays the input capture interrupt of the timers FTM1 (0) and FTM2 (1)
+ ******************************************************************************
+*/
+void SIM_Board_TimerInterrupt(uint8_t channel,uint64_t value,uint32_t flags);
+
+/*!
+ ******************************************************************************
+ *	Gets the duty cycles (1/1000) of both outputs of a PWM control
+ ******************************************************************************
+*/
+bool SIM_Board_GetPWMOutputs(unsigned channel,unsigned *dutycycle1,unsigned *dutycycle2,bool *enabled);
+
+/*!
+ ******************************************************************************
+ *	Sets the raw value of an ADC channel, taken by the next scan
+ ******************************************************************************
+*/
+bool SIM_ADC_SetInput(uint8_t channel,uint16_t raw);
+
+/*!
+ ******************************************************************************
+ *	Runs one scan of both converters, ends with the scan callback in
+ *	interrupt context
+ ******************************************************************************
+*/
+void SIM_ADC_Scan(void);
+void SIM_ADC_SetConversionHook(SIM_ADC_ConversionHook_t hook,void *ctx);
+
+#if defined(__cplusplus)
+}
+#endif /* __cplusplus */
+
+#endif /* SIM_BOARD_H_ */
@@ -0,0 +1,66 @@
+/*
+ * sim_can.h
+ *
+ *  Control of the simulated CAN controller (the FlexCAN model below CAN.c)
+ *  by the host tests: the test is the rest of the bus
+ */
+
+#ifndef SIM_CAN_H_
+#define SIM_CAN_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "CAN.h"
+
+#define SIM_CAN_TX_LOG_DEPTH		256			// transmitted frames kept for the test, power of two
+
+typedef struct
+{
+	CANmessage_t	msg;
+	bool				remote;
+	uint64_t			time_ns;						// simulated time of the transmission
+} SIM_CAN_Frame_t;
+
+/*!
+ ******************************************************************************
+ *	Called for each transmitted frame, from the context of the sender or of
+ * the CAN interrupt which has refilled the mailbox
+ ******************************************************************************
+*/
+typedef void (*SIM_CAN_TxHook_t)(unsigned channel,const SIM_CAN_Frame_t *frame,void *ctx);
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* __cplusplus */
+
+/*!
+ ******************************************************************************
+ *	A frame is sent by another node. If it passes the acceptance filters it is
+ * put into the RX FIFO, the CAN interrupt stores it in the RX message buffer
+ * \return		true if the frame has been stored by the interrupt at once
+ ******************************************************************************
+*/
+bool SIM_CAN_Receive(unsigned channel,uint32_t ID,bool isExtID,const uint8_t *payload,int len);
+
+/*!
+ ******************************************************************************
+ *	Other nodes take the bus: the TX mailboxes are not sent until it is
+ * released, then in the order of the arbitration
+ ******************************************************************************
+*/
+void SIM_CAN_HoldBus(unsigned channel,bool hold);
+
+/*!
+ ******************************************************************************
+ *	Gets the oldest transmitted frame not yet taken by the test
+ ******************************************************************************
+*/
+bool SIM_CAN_Transmitted(unsigned channel,SIM_CAN_Frame_t *frame);
+void SIM_CAN_ClearTransmitted(unsigned channel);
+void SIM_CAN_SetTxHook(SIM_CAN_TxHook_t hook,void *ctx);
+
+#if defined(__cplusplus)
+}
+#endif /* __cplusplus */
+
+#endif /* SIM_CAN_H_ */
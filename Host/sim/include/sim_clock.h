@@ -0,0 +1,36 @@
+/*
+ * sim_clock.h
+ *
+ *  Time base of the simulated peripherals: the PIT0 system time, the busy
+ *  waits and the duration of the I2C transfers
+ */
+
+#ifndef SIM_CLOCK_H_
+#define SIM_CLOCK_H_
+
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* __cplusplus */
+
+/*!
+ ******************************************************************************
+ *	Gets the simulated time in ns since the start of the program
+ ******************************************************************************
+*/
+uint64_t SIM_Clock_ns(void);
+
+/*!
+ ******************************************************************************
+ *	Lets the simulated time elapse, in place of a busy wait of the hardware
+ * \param[in]	ns		duration in ns
+ ******************************************************************************
+*/
+void SIM_Clock_Sleep(uint64_t ns);
+
+#if defined(__cplusplus)
+}
+#endif /* __cplusplus */
+
+#endif /* SIM_CLOCK_H_ */
@@ -0,0 +1,36 @@
+/*
+ * sim_comm.h
+ *
+ *  Command channels of the host build: the packets sent by the command
+ *  handler to the UART and to the USB CDC are kept for the test
+ */
+
+#ifndef SIM_COMM_H_
+#define SIM_COMM_H_
+
+#include <stdint.h>
+
+#define SIM_COMM_UART				0
+#define SIM_COMM_USB				1
+
+#define SIM_COMM_PACKETS			16			// packets kept per channel, power of two
+#define SIM_COMM_PACKET_SIZE		256
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* __cplusplus */
+
+/*!
+ ******************************************************************************
+ *	Gets the oldest packet sent on a channel and not yet taken
+ * \return		length of the packet, -1 if none
+ ******************************************************************************
+*/
+int SIM_Comm_Sent(int channel,uint8_t *packet,int max);
+void SIM_Comm_Clear(void);
+
+#if defined(__cplusplus)
+}
+#endif /* __cplusplus */
+
+#endif /* SIM_COMM_H_ */
@@ -0,0 +1,81 @@
+/*
+ * sim_i2c.h
+ *
+ *  Simulated I2C bus of the transaction queue (I2C.c) and its slaves
+ */
+
+#ifndef SIM_I2C_H_
+#define SIM_I2C_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SIM_I2C_MAX_SLAVES		8
+
+/*!
+ ******************************************************************************
+ *	A slave is a memory behind an address pointer, set by the first sub_size
+ * bytes of a write (MSB first). A register of reg_size bytes is addressed by
+ * one pointer step (TMP100). Writes wrap inside a page of page_size bytes,
+ * the slave does not acknowledge while in its write cycle
+ ******************************************************************************
+*/
+typedef struct
+{
+	uint8_t		address;				// 8 bit slave address
+	uint8_t		sub_size;
+	uint8_t		reg_size;				// bytes per pointer step, 0 is 1
+	bool			nak;					// fault injection: the slave does not answer
+	uint8_t		*mem;
+	uint32_t		size;
+	uint32_t		page_size;			// 0 if none
+	uint32_t		write_cycle_us;	// 0 if none
+	// state
+	uint32_t		pointer;
+	uint64_t		busy_until_ns;
+	uint32_t		writes;				// write transactions with data
+	uint32_t		bytes_written;
+	uint32_t		reads;
+} SIM_I2C_Slave_t;
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* __cplusplus */
+
+/*!
+ ******************************************************************************
+ *	Gets a slave of the bus by its address, the bus has the EEPROM, the FRAM
+ * and the two TMP100 of the board
+ ******************************************************************************
+*/
+SIM_I2C_Slave_t *SIM_I2C_Slave(uint8_t address);
+
+/*!
+ ******************************************************************************
+ *	Erases the memories of the slaves (EEPROM 0xFF, else 0) and clears their
+ * state
+ ******************************************************************************
+*/
+void SIM_I2C_Reset(void);
+
+/*!
+ ******************************************************************************
+ *	Runs the bus until the queue is idle: its interrupts are played at their
+ * simulated time. Called by the driver after each submit
+ ******************************************************************************
+*/
+void SIM_I2C_Run(void);
+
+/*!
+ ******************************************************************************
+ *	Holds the interrupts of the bus: the requests submitted meanwhile are only
+ * queued, the first one is started. The bus runs when it is released
+ ******************************************************************************
+*/
+void SIM_I2C_Hold(bool hold);
+
+#if defined(__cplusplus)
+}
+#endif /* __cplusplus */
+
+#endif /* SIM_I2C_H_ */
@@ -0,0 +1,33 @@
+/*
+ * sim_isr.h
+ *
+ *  Interrupt context of the simulated peripherals: the handlers run on the
+ *  thread of the caller with the IPSR of their exception number, so that the
+ *  code under test takes its FromISR paths
+ */
+
+#ifndef SIM_ISR_H_
+#define SIM_ISR_H_
+
+#include "fsl_device_registers.h"
+
+static inline uint32_t SIM_ISR_Enter(IRQn_Type irq)
+{
+uint32_t		prev = SIM_IPSR;
+
+	SIM_IPSR = (uint32_t)((int32_t)irq + 16);
+	return prev;
+}
+
+/*!
+ ******************************************************************************
+ *	Leaves the handler, the requests it has left pending are taken
+ ******************************************************************************
+*/
+static inline void SIM_ISR_Exit(uint32_t prev)
+{
+	SIM_IPSR = prev;
+	SIM_NVIC_Dispatch();
+}
+
+#endif /* SIM_ISR_H_ */
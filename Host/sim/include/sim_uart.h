@@ -0,0 +1,79 @@
+/*
+ * sim_uart.h
+ *
+ *  Control of the simulated command interface UART (UART0 and the eDMA
+ *  channels of uart.c) by the host tests: the test is the host at the other
+ *  end of the line
+ */
+
+#ifndef SIM_UART_H_
+#define SIM_UART_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SIM_UART_TX_LOG_SIZE		0x10000		// line bytes kept for the test, power of two
+
+typedef struct
+{
+	uint32_t		uart_irqs;						// UART0 interrupts (idle line and RX edge)
+	uint32_t		rx_dma_irqs;					// half and full RX ring
+	uint32_t		tx_dma_irqs;					// end of a TX segment
+	uint32_t		rx_bytes;
+	uint32_t		rx_lost;							// received without an active RX DMA request
+	uint32_t		tx_bytes;
+	uint64_t		tx_busy_ns;						// line time with a byte on the TX line
+} SIM_UART_Stats_t;
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* __cplusplus */
+
+/*!
+ ******************************************************************************
+ *	Time of a character on the line (start, 8 data and stop bit) at the baud
+ * rate programmed into UART0
+ ******************************************************************************
+*/
+uint64_t SIM_UART_ByteNs(void);
+
+/*!
+ ******************************************************************************
+ *	The host sends a burst: the bytes follow each other without a gap, the line
+ * is idle for a character after the last one. The simulated time elapses, the
+ * TX line runs meanwhile
+ ******************************************************************************
+*/
+void SIM_UART_Receive(const uint8_t *data,int len);
+
+/*!
+ ******************************************************************************
+ *	Sends the TX bytes due up to the simulated time, called from the tick hook
+ * of the test
+ ******************************************************************************
+*/
+void SIM_UART_Run(void);
+
+/*!
+ ******************************************************************************
+ *	Lets the simulated time elapse until the TX DMA has sent everything queued
+ ******************************************************************************
+*/
+void SIM_UART_Flush(void);
+
+/*!
+ ******************************************************************************
+ *	Takes the bytes sent on the TX line and not yet taken by the test
+ * \return		number of bytes
+ ******************************************************************************
+*/
+int SIM_UART_Sent(uint8_t *data,int max);
+
+const SIM_UART_Stats_t *SIM_UART_GetStats(void);
+void SIM_UART_ClearStats(void);
+
+#if defined(__cplusplus)
+}
+#endif /* __cplusplus */
+
+#endif /* SIM_UART_H_ */
@@ -0,0 +1,27 @@
+/*
+ * trcRecorder.h
+ *
+ *  Host stand-in of the Tracealyzer recorder: the types used by the firmware
+ *  and no-op calls, tracing is not available in the host build
+ */
+
+#ifndef TRC_RECORDER_H
+#define TRC_RECORDER_H
+
+#include <stdint.h>
+
+typedef const char		*traceString;
+typedef const void		*traceHandle;
+
+#define TRC_START								1
+#define TRC_START_AWAIT_HOST				2
+
+#define vTraceEnable(mode)							((void)(mode))
+#define xTraceRegisterString(label)				((traceString)(label))
+#define vTracePrint(chn,str)						((void)(chn),(void)(str))
+#define vTracePrintF(chn,...)						((void)(chn))
+#define xTraceSetISRProperties(name,prio)		((traceHandle)(name))
+#define vTraceStoreISRBegin(handle)				((void)(handle))
+#define vTraceStoreISREnd(pending)				((void)(pending))
+
+#endif /* TRC_RECORDER_H */
@@ -0,0 +1,60 @@
+/*
+ * FreeRTOS.h
+ *
+ *  Deterministic single thread stand-in of the FreeRTOS kernel for the host
+ *  unit tests. Tasks are registered but never run, the test calls the code
+ *  under test as if it ran in a task. A blocking call with a timeout advances
+ *  the simulated tick until the call succeeds or the timeout has elapsed,
+ *  the tick hook of sim_rtos.h plays the interrupts meanwhile
+ */
+
+#ifndef INC_FREERTOS_H
+#define INC_FREERTOS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <assert.h>
+#include "FreeRTOSConfig.h"
+
+typedef long							BaseType_t;
+typedef unsigned long				UBaseType_t;
+typedef uint32_t						TickType_t;
+typedef uint32_t						StackType_t;
+
+#define portMAX_DELAY					((TickType_t)0xFFFFFFFFUL)
+#define portTICK_PERIOD_MS			((TickType_t)1000 / configTICK_RATE_HZ)
+#define portTICK_RATE_MS				portTICK_PERIOD_MS
+#define pdMS_TO_TICKS(ms)				((TickType_t)(((TickType_t)(ms) * (TickType_t)configTICK_RATE_HZ) / (TickType_t)1000U))
+#define pdTICKS_TO_MS(ticks)			((TickType_t)(((uint64_t)(ticks) * 1000U) / configTICK_RATE_HZ))
+
+#define pdFALSE							((BaseType_t)0)
+#define pdTRUE							((BaseType_t)1)
+#define pdPASS							(pdTRUE)
+#define pdFAIL							(pdFALSE)
+#define errQUEUE_EMPTY				((BaseType_t)0)
+#define errQUEUE_FULL					((BaseType_t)0)
+
+#define configASSERT(x)				assert(x)
+
+#define portENABLE_INTERRUPTS()						((void)0)
+#define portDISABLE_INTERRUPTS()					((void)0)
+#define portYIELD()										((void)0)
+#define portYIELD_FROM_ISR(woken)					((void)(woken))
+#define portEND_SWITCHING_ISR(woken)				((void)(woken))
+#define portSET_INTERRUPT_MASK_FROM_ISR()		(0)
+#define portCLEAR_INTERRUPT_MASK_FROM_ISR(m)		((void)(m))
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void *pvPortMalloc(size_t size);
+void vPortFree(void *pv);
+size_t xPortGetFreeHeapSize(void);
+size_t xPortGetMinimumEverFreeHeapSize(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_FREERTOS_H */
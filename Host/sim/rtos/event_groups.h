@@ -0,0 +1,38 @@
+/*
+ * event_groups.h
+ *
+ *  Event group API of the deterministic kernel stand-in
+ */
+
+#ifndef EVENT_GROUPS_H
+#define EVENT_GROUPS_H
+
+#ifndef INC_FREERTOS_H
+	#error "include FreeRTOS.h must appear in source files before include event_groups.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct SIM_EventGroup;
+typedef struct SIM_EventGroup		*EventGroupHandle_t;
+typedef TickType_t					EventBits_t;
+
+EventGroupHandle_t xEventGroupCreate(void);
+void vEventGroupDelete(EventGroupHandle_t group);
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group,EventBits_t bits);
+BaseType_t xEventGroupSetBitsFromISR(EventGroupHandle_t group,EventBits_t bits,BaseType_t *woken);
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group,EventBits_t bits);
+BaseType_t xEventGroupClearBitsFromISR(EventGroupHandle_t group,EventBits_t bits);
+EventBits_t xEventGroupGetBitsFromISR(EventGroupHandle_t group);
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group,EventBits_t bits,BaseType_t clear_on_exit,
+	BaseType_t wait_for_all,TickType_t ticks);
+
+#define xEventGroupGetBits(group)						xEventGroupClearBits((group),0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EVENT_GROUPS_H */
@@ -0,0 +1,66 @@
+/*
+ * queue.h
+ *
+ *  Queue API of the deterministic kernel stand-in, the semaphores are queues
+ *  of items without data as in the kernel
+ */
+
+#ifndef QUEUE_H
+#define QUEUE_H
+
+#ifndef INC_FREERTOS_H
+	#error "include FreeRTOS.h must appear in source files before include queue.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct SIM_Queue;
+typedef struct SIM_Queue			*QueueHandle_t;
+
+#define queueQUEUE_TYPE_BASE					((uint8_t)0U)
+#define queueQUEUE_TYPE_MUTEX					((uint8_t)1U)
+#define queueQUEUE_TYPE_COUNTING_SEMAPHORE	((uint8_t)2U)
+#define queueQUEUE_TYPE_BINARY_SEMAPHORE		((uint8_t)3U)
+#define queueQUEUE_TYPE_RECURSIVE_MUTEX		((uint8_t)4U)
+
+#define queueSEND_TO_BACK			((BaseType_t)0)
+#define queueSEND_TO_FRONT			((BaseType_t)1)
+#define queueOVERWRITE				((BaseType_t)2)
+
+QueueHandle_t xQueueGenericCreate(UBaseType_t length,UBaseType_t item_size,uint8_t type);
+void vQueueDelete(QueueHandle_t queue);
+BaseType_t xQueueGenericSend(QueueHandle_t queue,const void *item,TickType_t ticks,BaseType_t position);
+BaseType_t xQueueGenericSendFromISR(QueueHandle_t queue,const void *item,BaseType_t *woken,BaseType_t position);
+BaseType_t xQueueReceive(QueueHandle_t queue,void *buffer,TickType_t ticks);
+BaseType_t xQueueReceiveFromISR(QueueHandle_t queue,void *buffer,BaseType_t *woken);
+BaseType_t xQueuePeek(QueueHandle_t queue,void *buffer,TickType_t ticks);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+UBaseType_t uxQueueMessagesWaitingFromISR(QueueHandle_t queue);
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue);
+BaseType_t xQueueGenericReset(QueueHandle_t queue,BaseType_t new_queue);
+
+/* semaphores, see semphr.h */
+QueueHandle_t xQueueCreateCountingSemaphore(UBaseType_t max_count,UBaseType_t initial_count);
+BaseType_t xQueueSemaphoreTake(QueueHandle_t queue,TickType_t ticks);
+BaseType_t xQueueGiveFromISR(QueueHandle_t queue,BaseType_t *woken);
+BaseType_t xQueueTakeMutexRecursive(QueueHandle_t mutex,TickType_t ticks);
+BaseType_t xQueueGiveMutexRecursive(QueueHandle_t mutex);
+
+#define xQueueCreate(length,item_size)				xQueueGenericCreate((length),(item_size),queueQUEUE_TYPE_BASE)
+#define xQueueSend(q,item,ticks)						xQueueGenericSend((q),(item),(ticks),queueSEND_TO_BACK)
+#define xQueueSendToBack(q,item,ticks)				xQueueGenericSend((q),(item),(ticks),queueSEND_TO_BACK)
+#define xQueueSendToFront(q,item,ticks)			xQueueGenericSend((q),(item),(ticks),queueSEND_TO_FRONT)
+#define xQueueOverwrite(q,item)						xQueueGenericSend((q),(item),0,queueOVERWRITE)
+#define xQueueSendFromISR(q,item,woken)			xQueueGenericSendFromISR((q),(item),(woken),queueSEND_TO_BACK)
+#define xQueueSendToBackFromISR(q,item,woken)	xQueueGenericSendFromISR((q),(item),(woken),queueSEND_TO_BACK)
+#define xQueueSendToFrontFromISR(q,item,woken)	xQueueGenericSendFromISR((q),(item),(woken),queueSEND_TO_FRONT)
+#define xQueueOverwriteFromISR(q,item,woken)		xQueueGenericSendFromISR((q),(item),(woken),queueOVERWRITE)
+#define xQueueReset(q)									xQueueGenericReset((q),pdFALSE)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* QUEUE_H */
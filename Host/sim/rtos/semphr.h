@@ -0,0 +1,31 @@
+/*
+ * semphr.h
+ *
+ *  Semaphore API of the deterministic kernel stand-in
+ */
+
+#ifndef SEMAPHORE_H
+#define SEMAPHORE_H
+
+#ifndef INC_FREERTOS_H
+	#error "include FreeRTOS.h must appear in source files before include semphr.h"
+#endif
+
+#include "queue.h"
+
+typedef QueueHandle_t SemaphoreHandle_t;
+
+#define xSemaphoreCreateBinary()							xQueueGenericCreate(1,0,queueQUEUE_TYPE_BINARY_SEMAPHORE)
+#define xSemaphoreCreateCounting(max,initial)		xQueueCreateCountingSemaphore((max),(initial))
+#define xSemaphoreCreateMutex()							xQueueGenericCreate(1,0,queueQUEUE_TYPE_MUTEX)
+#define xSemaphoreCreateRecursiveMutex()				xQueueGenericCreate(1,0,queueQUEUE_TYPE_RECURSIVE_MUTEX)
+#define vSemaphoreDelete(sem)								vQueueDelete((QueueHandle_t)(sem))
+#define xSemaphoreTake(sem,ticks)						xQueueSemaphoreTake((sem),(ticks))
+#define xSemaphoreGive(sem)								xQueueGenericSend((QueueHandle_t)(sem),NULL,0,queueSEND_TO_BACK)
+#define xSemaphoreTakeFromISR(sem,woken)				xQueueReceiveFromISR((QueueHandle_t)(sem),NULL,(woken))
+#define xSemaphoreGiveFromISR(sem,woken)				xQueueGiveFromISR((QueueHandle_t)(sem),(woken))
+#define xSemaphoreTakeRecursive(mutex,ticks)			xQueueTakeMutexRecursive((mutex),(ticks))
+#define xSemaphoreGiveRecursive(mutex)					xQueueGiveMutexRecursive((mutex))
+#define uxSemaphoreGetCount(sem)							uxQueueMessagesWaiting((QueueHandle_t)(sem))
+
+#endif /* SEMAPHORE_H */
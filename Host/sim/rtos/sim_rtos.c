@@ -0,0 +1,763 @@
+/*
+ * sim_rtos.c
+ *
+ *  Deterministic single thread stand-in of the FreeRTOS kernel
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+#include "event_groups.h"
+#include "timers.h"
+#include "fsl_device_registers.h"
+#include "sim_rtos.h"
+
+#define SIM_DEFAULT_MAX_WAIT		60000			// ticks a portMAX_DELAY wait gives up after
+
+struct SIM_Task {
+	struct SIM_Task	*next;
+	TaskFunction_t		code;
+	void					*parameter;
+	UBaseType_t			priority;
+	eTaskState			state;
+	uint32_t				notify_value;
+	bool					notify_pending;
+	char					name[configMAX_TASK_NAME_LEN];
+};
+
+struct SIM_Queue {
+	uint8_t				type;
+	UBaseType_t			length;
+	UBaseType_t			item_size;
+	UBaseType_t			count;
+	UBaseType_t			head;
+	UBaseType_t			recursion;
+	uint8_t				*data;
+};
+
+struct SIM_EventGroup {
+	EventBits_t			bits;
+};
+
+struct SIM_Timer {
+	struct SIM_Timer	*next;
+	TickType_t			period;
+	TickType_t			expiry;
+	bool					auto_reload;
+	bool					active;
+	void					*id;
+	TimerCallbackFunction_t	callback;
+};
+
+static struct SIM_Task	sim_main_task = { .name = "main", .state = eRunning };
+static struct SIM_Task	*sim_tasks;
+static struct SIM_Timer	*sim_timers;
+static TaskHandle_t		sim_current = &sim_main_task;
+static TickType_t			sim_ticks;
+static TickType_t			sim_max_wait = SIM_DEFAULT_MAX_WAIT;
+static BaseType_t			sim_scheduler = taskSCHEDULER_NOT_STARTED;
+static UBaseType_t		sim_suspend_all;
+static SIM_TickHook_t	sim_hook;
+static void					*sim_hook_ctx;
+static size_t				sim_heap_used;
+static size_t				sim_heap_peak;
+
+/*!
+ ******************************************************************************
+ *	Advances the simulated tick until the condition is true or the timeout has
+ *	elapsed, nothing can change while waiting in interrupt context
+ ******************************************************************************
+*/
+static bool SIM_Wait(TickType_t ticks,bool (*cond)(void *arg),void *arg)
+{
+TickType_t	waited = 0;
+
+	while (!cond(arg))
+	{
+		if (SIM_IPSR != 0 || waited >= ticks || (ticks == portMAX_DELAY && waited >= sim_max_wait))
+			return false;
+		SIM_RTOS_Advance(1);
+		waited++;
+	}
+	return true;
+}
+
+/*!
+ ******************************************************************************
+ *	Test control
+ ******************************************************************************
+*/
+void SIM_RTOS_Reset(void)
+{
+	sim_ticks = 0;
+	sim_hook = NULL;
+	sim_hook_ctx = NULL;
+	sim_max_wait = SIM_DEFAULT_MAX_WAIT;
+	sim_scheduler = taskSCHEDULER_NOT_STARTED;
+	sim_suspend_all = 0;
+	sim_current = &sim_main_task;
+	sim_main_task.notify_value = 0;
+	sim_main_task.notify_pending = false;
+}
+
+void SIM_RTOS_SetTickHook(SIM_TickHook_t hook,void *ctx)
+{
+	sim_hook = hook;
+	sim_hook_ctx = ctx;
+}
+
+void SIM_RTOS_Advance(TickType_t ticks)
+{
+uint32_t	ipsr;
+
+	while (ticks-- > 0)
+	{
+		sim_ticks++;
+		for (struct SIM_Timer *t = sim_timers;t != NULL;t = t->next)
+		{
+			if (!t->active || (TickType_t)(sim_ticks - t->expiry) > (TickType_t)0x7FFFFFFF)
+				continue;
+			if (t->auto_reload)
+				t->expiry += t->period;
+			else
+				t->active = false;
+			t->callback(t);
+		}
+		if (sim_hook != NULL)
+		{
+			// the hook runs in the SysTick exception, the interrupts it raises preempt it
+			ipsr = SIM_IPSR;
+			SIM_IPSR = 16 + SysTick_IRQn;
+			sim_hook(sim_ticks,sim_hook_ctx);
+			SIM_IPSR = ipsr;
+			SIM_NVIC_Dispatch();
+		}
+	}
+}
+
+void SIM_RTOS_SetMaxWait(TickType_t ticks)
+{
+	sim_max_wait = ticks;
+}
+
+void SIM_RTOS_SetSchedulerState(BaseType_t state)
+{
+	sim_scheduler = state;
+}
+
+void SIM_RTOS_SetCurrentTask(TaskHandle_t task)
+{
+	sim_current = task != NULL ? task : &sim_main_task;
+}
+
+TaskHandle_t SIM_RTOS_FindTask(const char *name)
+{
+	for (struct SIM_Task *t = sim_tasks;t != NULL;t = t->next)
+		if (strncmp(t->name,name,sizeof(t->name)) == 0)
+			return t;
+	return NULL;
+}
+
+TaskFunction_t SIM_RTOS_TaskFunction(TaskHandle_t task)
+{
+	return task->code;
+}
+
+void *SIM_RTOS_TaskParameter(TaskHandle_t task)
+{
+	return task->parameter;
+}
+
+uint32_t SIM_RTOS_PendingNotification(TaskHandle_t task)
+{
+	return task->notify_pending ? task->notify_value : 0;
+}
+
+/*!
+ ******************************************************************************
+ *	Heap, counted against configTOTAL_HEAP_SIZE
+ ******************************************************************************
+*/
+void *pvPortMalloc(size_t size)
+{
+size_t	*p;
+
+	if (sim_heap_used + size > configTOTAL_HEAP_SIZE || (p = malloc(size + sizeof(size_t))) == NULL)
+		return NULL;
+	*p = size;
+	sim_heap_used += size;
+	if (sim_heap_used > sim_heap_peak)
+		sim_heap_peak = sim_heap_used;
+	return p + 1;
+}
+
+void vPortFree(void *pv)
+{
+size_t	*p = (size_t *)pv - 1;
+
+	if (pv == NULL)
+		return;
+	sim_heap_used -= *p;
+	free(p);
+}
+
+size_t xPortGetFreeHeapSize(void)
+{
+	return configTOTAL_HEAP_SIZE - sim_heap_used;
+}
+
+size_t xPortGetMinimumEverFreeHeapSize(void)
+{
+	return configTOTAL_HEAP_SIZE - sim_heap_peak;
+}
+
+/*!
+ ******************************************************************************
+ *	Tasks
+ ******************************************************************************
+*/
+BaseType_t xTaskCreate(TaskFunction_t code,const char *name,uint16_t stack_depth,
+	void *parameters,UBaseType_t priority,TaskHandle_t *created)
+{
+struct SIM_Task	*t;
+
+	(void)stack_depth;
+	if ((t = calloc(1,sizeof(*t))) == NULL)
+		return pdFAIL;
+	t->code = code;
+	t->parameter = parameters;
+	t->priority = priority;
+	t->state = eReady;
+	if (name != NULL)
+		strncpy(t->name,name,sizeof(t->name) - 1);
+	t->next = sim_tasks;
+	sim_tasks = t;
+	if (created != NULL)
+		*created = t;
+	return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+	if (task == NULL)
+		task = sim_current;
+	task->state = eDeleted;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+	if (SIM_IPSR == 0)
+		SIM_RTOS_Advance(ticks);
+}
+
+void vTaskDelayUntil(TickType_t *previous,TickType_t increment)
+{
+TickType_t	wake = *previous + increment;
+
+	if ((TickType_t)(wake - sim_ticks) <= (TickType_t)0x7FFFFFFF)
+		vTaskDelay(wake - sim_ticks);
+	*previous = wake;
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+	return sim_ticks;
+}
+
+TickType_t xTaskGetTickCountFromISR(void)
+{
+	return sim_ticks;
+}
+
+BaseType_t xTaskGetSchedulerState(void)
+{
+	if (sim_scheduler == taskSCHEDULER_RUNNING && sim_suspend_all != 0)
+		return taskSCHEDULER_SUSPENDED;
+	return sim_scheduler;
+}
+
+void vTaskStartScheduler(void)
+{
+	sim_scheduler = taskSCHEDULER_RUNNING;
+}
+
+void vTaskEndScheduler(void)
+{
+	sim_scheduler = taskSCHEDULER_NOT_STARTED;
+}
+
+void vTaskSuspendAll(void)
+{
+	sim_suspend_all++;
+}
+
+BaseType_t xTaskResumeAll(void)
+{
+	if (sim_suspend_all > 0)
+		sim_suspend_all--;
+	return pdFALSE;
+}
+
+void vTaskSuspend(TaskHandle_t task)
+{
+	if (task == NULL)
+		task = sim_current;
+	task->state = eSuspended;
+}
+
+void vTaskResume(TaskHandle_t task)
+{
+	if (task != NULL && task->state == eSuspended)
+		task->state = eReady;
+}
+
+BaseType_t xTaskResumeFromISR(TaskHandle_t task)
+{
+	vTaskResume(task);
+	return pdFALSE;
+}
+
+eTaskState eTaskGetState(TaskHandle_t task)
+{
+	if (task == NULL)
+		return eInvalid;
+	return task == sim_current ? eRunning : task->state;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+	return sim_current;
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task)
+{
+	return (task != NULL ? task : sim_current)->priority;
+}
+
+void vTaskPrioritySet(TaskHandle_t task,UBaseType_t priority)
+{
+	(task != NULL ? task : sim_current)->priority = priority;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+	(void)task;
+	return configMINIMAL_STACK_SIZE;
+}
+
+char *pcTaskGetName(TaskHandle_t task)
+{
+	return (task != NULL ? task : sim_current)->name;
+}
+
+/*!
+ ******************************************************************************
+ *	Task notifications
+ ******************************************************************************
+*/
+BaseType_t xTaskGenericNotify(TaskHandle_t task,uint32_t value,eNotifyAction action,uint32_t *previous)
+{
+	if (previous != NULL)
+		*previous = task->notify_value;
+	switch (action)
+	{
+		case eSetBits:
+			task->notify_value |= value;
+			break;
+		case eIncrement:
+			task->notify_value++;
+			break;
+		case eSetValueWithoutOverwrite:
+			if (task->notify_pending)
+				return pdFAIL;
+			task->notify_value = value;
+			break;
+		case eSetValueWithOverwrite:
+			task->notify_value = value;
+			break;
+		case eNoAction:
+			break;
+	}
+	task->notify_pending = true;
+	return pdPASS;
+}
+
+BaseType_t xTaskGenericNotifyFromISR(TaskHandle_t task,uint32_t value,eNotifyAction action,
+	uint32_t *previous,BaseType_t *woken)
+{
+	configASSERT(SIM_IPSR != 0);			// interrupt API, the tasks use xTaskNotify
+	if (woken != NULL && task->priority >= sim_current->priority)
+		*woken = pdTRUE;
+	return xTaskGenericNotify(task,value,action,previous);
+}
+
+static bool SIM_NotifyPending(void *arg)
+{
+	return ((struct SIM_Task *)arg)->notify_pending;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry,uint32_t clear_on_exit,uint32_t *value,TickType_t ticks)
+{
+struct SIM_Task	*t = sim_current;
+
+	if (!t->notify_pending)
+		t->notify_value &= ~clear_on_entry;
+	if (!SIM_Wait(ticks,SIM_NotifyPending,t))
+		return pdFALSE;
+	if (value != NULL)
+		*value = t->notify_value;
+	t->notify_value &= ~clear_on_exit;
+	t->notify_pending = false;
+	return pdTRUE;
+}
+
+static bool SIM_NotifyCount(void *arg)
+{
+	return ((struct SIM_Task *)arg)->notify_value != 0;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit,TickType_t ticks)
+{
+struct SIM_Task	*t = sim_current;
+uint32_t				value;
+
+	SIM_Wait(ticks,SIM_NotifyCount,t);
+	value = t->notify_value;
+	if (value != 0)
+		t->notify_value = clear_on_exit ? 0 : value - 1;
+	t->notify_pending = false;
+	return value;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task,BaseType_t *woken)
+{
+	xTaskGenericNotifyFromISR(task,0,eIncrement,NULL,woken);
+}
+
+/*!
+ ******************************************************************************
+ *	Queues and semaphores
+ ******************************************************************************
+*/
+QueueHandle_t xQueueGenericCreate(UBaseType_t length,UBaseType_t item_size,uint8_t type)
+{
+struct SIM_Queue	*q;
+
+	if (length == 0 || (q = calloc(1,sizeof(*q))) == NULL)
+		return NULL;
+	if (item_size != 0 && (q->data = calloc(length,item_size)) == NULL)
+	{
+		free(q);
+		return NULL;
+	}
+	q->type = type;
+	q->length = length;
+	q->item_size = item_size;
+	if (type == queueQUEUE_TYPE_MUTEX || type == queueQUEUE_TYPE_RECURSIVE_MUTEX)
+		q->count = 1;
+	return q;
+}
+
+QueueHandle_t xQueueCreateCountingSemaphore(UBaseType_t max_count,UBaseType_t initial_count)
+{
+struct SIM_Queue	*q = xQueueGenericCreate(max_count,0,queueQUEUE_TYPE_COUNTING_SEMAPHORE);
+
+	if (q != NULL)
+		q->count = initial_count;
+	return q;
+}
+
+void vQueueDelete(QueueHandle_t queue)
+{
+	if (queue == NULL)
+		return;
+	free(queue->data);
+	free(queue);
+}
+
+static BaseType_t SIM_QueuePut(struct SIM_Queue *q,const void *item,BaseType_t position)
+{
+	if (position == queueOVERWRITE && q->count == q->length)
+	{
+		if (q->item_size != 0)
+			memcpy(q->data + ((q->head + q->count - 1) % q->length) * q->item_size,item,q->item_size);
+		return pdPASS;
+	}
+	if (q->count == q->length)
+		return errQUEUE_FULL;
+	if (q->item_size != 0)
+	{
+		if (position == queueSEND_TO_FRONT)
+		{
+			q->head = (q->head + q->length - 1) % q->length;
+			memcpy(q->data + q->head * q->item_size,item,q->item_size);
+		}
+		else
+			memcpy(q->data + ((q->head + q->count) % q->length) * q->item_size,item,q->item_size);
+	}
+	q->count++;
+	return pdPASS;
+}
+
+static BaseType_t SIM_QueueGet(struct SIM_Queue *q,void *buffer,bool peek)
+{
+	if (q->count == 0)
+		return errQUEUE_EMPTY;
+	if (q->item_size != 0 && buffer != NULL)
+		memcpy(buffer,q->data + q->head * q->item_size,q->item_size);
+	if (!peek)
+	{
+		if (q->item_size != 0)
+			q->head = (q->head + 1) % q->length;
+		q->count--;
+	}
+	return pdPASS;
+}
+
+static bool SIM_QueueNotFull(void *arg)
+{
+	return ((struct SIM_Queue *)arg)->count < ((struct SIM_Queue *)arg)->length;
+}
+
+static bool SIM_QueueNotEmpty(void *arg)
+{
+	return ((struct SIM_Queue *)arg)->count > 0;
+}
+
+BaseType_t xQueueGenericSend(QueueHandle_t queue,const void *item,TickType_t ticks,BaseType_t position)
+{
+	if (position != queueOVERWRITE && !SIM_Wait(ticks,SIM_QueueNotFull,queue))
+		return errQUEUE_FULL;
+	return SIM_QueuePut(queue,item,position);
+}
+
+BaseType_t xQueueGenericSendFromISR(QueueHandle_t queue,const void *item,BaseType_t *woken,BaseType_t position)
+{
+	BaseType_t ret = SIM_QueuePut(queue,item,position);
+	if (ret == pdPASS && woken != NULL)
+		*woken = pdTRUE;
+	return ret;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue,void *buffer,TickType_t ticks)
+{
+	if (!SIM_Wait(ticks,SIM_QueueNotEmpty,queue))
+		return errQUEUE_EMPTY;
+	return SIM_QueueGet(queue,buffer,false);
+}
+
+BaseType_t xQueueReceiveFromISR(QueueHandle_t queue,void *buffer,BaseType_t *woken)
+{
+	BaseType_t ret = SIM_QueueGet(queue,buffer,false);
+	if (ret == pdPASS && woken != NULL)
+		*woken = pdTRUE;
+	return ret;
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue,void *buffer,TickType_t ticks)
+{
+	if (!SIM_Wait(ticks,SIM_QueueNotEmpty,queue))
+		return errQUEUE_EMPTY;
+	return SIM_QueueGet(queue,buffer,true);
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+	return queue->count;
+}
+
+UBaseType_t uxQueueMessagesWaitingFromISR(QueueHandle_t queue)
+{
+	return queue->count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue)
+{
+	return queue->length - queue->count;
+}
+
+BaseType_t xQueueGenericReset(QueueHandle_t queue,BaseType_t new_queue)
+{
+	(void)new_queue;
+	queue->count = 0;
+	queue->head = 0;
+	return pdPASS;
+}
+
+BaseType_t xQueueSemaphoreTake(QueueHandle_t queue,TickType_t ticks)
+{
+	return xQueueReceive(queue,NULL,ticks);
+}
+
+BaseType_t xQueueGiveFromISR(QueueHandle_t queue,BaseType_t *woken)
+{
+	return xQueueGenericSendFromISR(queue,NULL,woken,queueSEND_TO_BACK);
+}
+
+BaseType_t xQueueTakeMutexRecursive(QueueHandle_t mutex,TickType_t ticks)
+{
+	if (mutex->recursion > 0)
+	{
+		mutex->recursion++;
+		return pdPASS;
+	}
+	if (xQueueReceive(mutex,NULL,ticks) != pdPASS)
+		return pdFAIL;
+	mutex->recursion = 1;
+	return pdPASS;
+}
+
+BaseType_t xQueueGiveMutexRecursive(QueueHandle_t mutex)
+{
+	if (mutex->recursion == 0)
+		return pdFAIL;
+	if (--mutex->recursion == 0)
+		return xQueueGenericSend(mutex,NULL,0,queueSEND_TO_BACK);
+	return pdPASS;
+}
+
+/*!
+ ******************************************************************************
+ *	Event groups
+ ******************************************************************************
+*/
+typedef struct {
+	struct SIM_EventGroup	*group;
+	EventBits_t					bits;
+	bool							all;
+} SIM_EventWait_t;
+
+EventGroupHandle_t xEventGroupCreate(void)
+{
+	return calloc(1,sizeof(struct SIM_EventGroup));
+}
+
+void vEventGroupDelete(EventGroupHandle_t group)
+{
+	free(group);
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group,EventBits_t bits)
+{
+	group->bits |= bits;
+	return group->bits;
+}
+
+BaseType_t xEventGroupSetBitsFromISR(EventGroupHandle_t group,EventBits_t bits,BaseType_t *woken)
+{
+	xEventGroupSetBits(group,bits);
+	if (woken != NULL)
+		*woken = pdTRUE;
+	return pdPASS;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group,EventBits_t bits)
+{
+EventBits_t	previous = group->bits;
+
+	group->bits &= ~bits;
+	return previous;
+}
+
+BaseType_t xEventGroupClearBitsFromISR(EventGroupHandle_t group,EventBits_t bits)
+{
+	xEventGroupClearBits(group,bits);
+	return pdPASS;
+}
+
+EventBits_t xEventGroupGetBitsFromISR(EventGroupHandle_t group)
+{
+	return group->bits;
+}
+
+static bool SIM_EventBitsSet(void *arg)
+{
+SIM_EventWait_t	*w = arg;
+
+	if (w->all)
+		return (w->group->bits & w->bits) == w->bits;
+	return (w->group->bits & w->bits) != 0;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group,EventBits_t bits,BaseType_t clear_on_exit,
+	BaseType_t wait_for_all,TickType_t ticks)
+{
+SIM_EventWait_t	w = { group, bits, wait_for_all != pdFALSE };
+EventBits_t			value;
+
+	if (!SIM_Wait(ticks,SIM_EventBitsSet,&w))
+		return group->bits;
+	value = group->bits;
+	if (clear_on_exit)
+		group->bits &= ~bits;
+	return value;
+}
+
+/*!
+ ******************************************************************************
+ *	Software timers
+ ******************************************************************************
+*/
+TimerHandle_t xTimerCreate(const char *name,TickType_t period,UBaseType_t auto_reload,
+	void *id,TimerCallbackFunction_t callback)
+{
+struct SIM_Timer	*t;
+
+	(void)name;
+	if (period == 0 || (t = calloc(1,sizeof(*t))) == NULL)
+		return NULL;
+	t->period = period;
+	t->auto_reload = auto_reload != pdFALSE;
+	t->id = id;
+	t->callback = callback;
+	t->next = sim_timers;
+	sim_timers = t;
+	return t;
+}
+
+BaseType_t xTimerStart(TimerHandle_t timer,TickType_t ticks)
+{
+	(void)ticks;
+	timer->expiry = sim_ticks + timer->period;
+	timer->active = true;
+	return pdPASS;
+}
+
+BaseType_t xTimerStop(TimerHandle_t timer,TickType_t ticks)
+{
+	(void)ticks;
+	timer->active = false;
+	return pdPASS;
+}
+
+BaseType_t xTimerReset(TimerHandle_t timer,TickType_t ticks)
+{
+	return xTimerStart(timer,ticks);
+}
+
+BaseType_t xTimerChangePeriod(TimerHandle_t timer,TickType_t period,TickType_t ticks)
+{
+	timer->period = period;
+	return xTimerStart(timer,ticks);
+}
+
+BaseType_t xTimerDelete(TimerHandle_t timer,TickType_t ticks)
+{
+	(void)ticks;
+	timer->active = false;				// stays in the list, the handle may still be used
+	return pdPASS;
+}
+
+BaseType_t xTimerIsTimerActive(TimerHandle_t timer)
+{
+	return timer->active ? pdTRUE : pdFALSE;
+}
+
+void *pvTimerGetTimerID(TimerHandle_t timer)
+{
+	return timer->id;
+}
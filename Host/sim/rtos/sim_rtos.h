@@ -0,0 +1,41 @@
+/*
+ * sim_rtos.h
+ *
+ *  Control of the deterministic kernel stand-in by the host tests
+ */
+
+#ifndef SIM_RTOS_H_
+#define SIM_RTOS_H_
+
+#include <stdbool.h>
+#include "FreeRTOS.h"
+#include "task.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+ ******************************************************************************
+ *	Called at every simulated tick, in interrupt context (__get_IPSR() != 0):
+ *	the test plays the interrupts of the simulated peripherals from here
+ ******************************************************************************
+*/
+typedef void (*SIM_TickHook_t)(TickType_t now,void *ctx);
+
+void SIM_RTOS_Reset(void);
+void SIM_RTOS_SetTickHook(SIM_TickHook_t hook,void *ctx);
+void SIM_RTOS_Advance(TickType_t ticks);
+void SIM_RTOS_SetMaxWait(TickType_t ticks);
+void SIM_RTOS_SetSchedulerState(BaseType_t state);
+void SIM_RTOS_SetCurrentTask(TaskHandle_t task);
+TaskHandle_t SIM_RTOS_FindTask(const char *name);
+TaskFunction_t SIM_RTOS_TaskFunction(TaskHandle_t task);
+void *SIM_RTOS_TaskParameter(TaskHandle_t task);
+uint32_t SIM_RTOS_PendingNotification(TaskHandle_t task);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_RTOS_H_ */
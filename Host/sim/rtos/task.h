@@ -0,0 +1,91 @@
+/*
+ * task.h
+ *
+ *  Task API of the deterministic kernel stand-in
+ */
+
+#ifndef INC_TASK_H
+#define INC_TASK_H
+
+#ifndef INC_FREERTOS_H
+	#error "include FreeRTOS.h must appear in source files before include task.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct SIM_Task;
+typedef struct SIM_Task			*TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+typedef enum {
+	eNoAction = 0,
+	eSetBits,
+	eIncrement,
+	eSetValueWithOverwrite,
+	eSetValueWithoutOverwrite
+} eNotifyAction;
+
+typedef enum {
+	eRunning = 0,
+	eReady,
+	eBlocked,
+	eSuspended,
+	eDeleted,
+	eInvalid
+} eTaskState;
+
+#define tskIDLE_PRIORITY				((UBaseType_t)0U)
+
+#define taskSCHEDULER_SUSPENDED		((BaseType_t)0)
+#define taskSCHEDULER_NOT_STARTED	((BaseType_t)1)
+#define taskSCHEDULER_RUNNING			((BaseType_t)2)
+
+#define taskYIELD()										((void)0)
+#define taskENTER_CRITICAL()							((void)0)
+#define taskEXIT_CRITICAL()							((void)0)
+#define taskENTER_CRITICAL_FROM_ISR()				(0)
+#define taskEXIT_CRITICAL_FROM_ISR(m)				((void)(m))
+#define taskDISABLE_INTERRUPTS()						((void)0)
+#define taskENABLE_INTERRUPTS()						((void)0)
+
+BaseType_t xTaskCreate(TaskFunction_t code,const char *name,uint16_t stack_depth,
+	void *parameters,UBaseType_t priority,TaskHandle_t *created);
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t *previous,TickType_t increment);
+TickType_t xTaskGetTickCount(void);
+TickType_t xTaskGetTickCountFromISR(void);
+BaseType_t xTaskGetSchedulerState(void);
+void vTaskStartScheduler(void);
+void vTaskEndScheduler(void);
+void vTaskSuspendAll(void);
+BaseType_t xTaskResumeAll(void);
+void vTaskSuspend(TaskHandle_t task);
+void vTaskResume(TaskHandle_t task);
+BaseType_t xTaskResumeFromISR(TaskHandle_t task);
+eTaskState eTaskGetState(TaskHandle_t task);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task);
+void vTaskPrioritySet(TaskHandle_t task,UBaseType_t priority);
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+char *pcTaskGetName(TaskHandle_t task);
+
+BaseType_t xTaskGenericNotify(TaskHandle_t task,uint32_t value,eNotifyAction action,uint32_t *previous);
+BaseType_t xTaskGenericNotifyFromISR(TaskHandle_t task,uint32_t value,eNotifyAction action,
+	uint32_t *previous,BaseType_t *woken);
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry,uint32_t clear_on_exit,uint32_t *value,TickType_t ticks);
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit,TickType_t ticks);
+void vTaskNotifyGiveFromISR(TaskHandle_t task,BaseType_t *woken);
+
+#define xTaskNotify(task,value,action)								xTaskGenericNotify((task),(value),(action),NULL)
+#define xTaskNotifyAndQuery(task,value,action,previous)		xTaskGenericNotify((task),(value),(action),(previous))
+#define xTaskNotifyFromISR(task,value,action,woken)			xTaskGenericNotifyFromISR((task),(value),(action),NULL,(woken))
+#define xTaskNotifyGive(task)											xTaskGenericNotify((task),0,eIncrement,NULL)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_TASK_H */
@@ -0,0 +1,43 @@
+/*
+ * timers.h
+ *
+ *  Software timer API of the deterministic kernel stand-in, the callbacks
+ *  run when the simulated tick reaches their expiry time
+ */
+
+#ifndef TIMERS_H
+#define TIMERS_H
+
+#ifndef INC_FREERTOS_H
+	#error "include FreeRTOS.h must appear in source files before include timers.h"
+#endif
+
+#include "task.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct SIM_Timer;
+typedef struct SIM_Timer			*TimerHandle_t;
+typedef void (*TimerCallbackFunction_t)(TimerHandle_t timer);
+
+TimerHandle_t xTimerCreate(const char *name,TickType_t period,UBaseType_t auto_reload,
+	void *id,TimerCallbackFunction_t callback);
+BaseType_t xTimerStart(TimerHandle_t timer,TickType_t ticks);
+BaseType_t xTimerStop(TimerHandle_t timer,TickType_t ticks);
+BaseType_t xTimerReset(TimerHandle_t timer,TickType_t ticks);
+BaseType_t xTimerChangePeriod(TimerHandle_t timer,TickType_t period,TickType_t ticks);
+BaseType_t xTimerDelete(TimerHandle_t timer,TickType_t ticks);
+BaseType_t xTimerIsTimerActive(TimerHandle_t timer);
+void *pvTimerGetTimerID(TimerHandle_t timer);
+
+#define xTimerStartFromISR(timer,woken)			xTimerStart((timer),0)
+#define xTimerStopFromISR(timer,woken)				xTimerStop((timer),0)
+#define xTimerResetFromISR(timer,woken)			xTimerReset((timer),0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIMERS_H */
@@ -0,0 +1,25 @@
+/*
+ * sim_clock_rtos.c
+ *
+ *  Simulated time of the deterministic kernel stand-in: the kernel tick plus
+ *  the time spent in busy waits and I2C transfers, which do not advance the
+ *  tick
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "sim_clock.h"
+
+#define SIM_TICK_NS			(1000000000ULL / configTICK_RATE_HZ)
+
+static uint64_t				sim_busy_ns;
+
+uint64_t SIM_Clock_ns(void)
+{
+	return (uint64_t)xTaskGetTickCount() * SIM_TICK_NS + sim_busy_ns;
+}
+
+void SIM_Clock_Sleep(uint64_t ns)
+{
+	sim_busy_ns += ns;
+}
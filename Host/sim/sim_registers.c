@@ -0,0 +1,169 @@
+/*
+ * sim_registers.c
+ *
+ *  Simulated register blocks of the peripherals and core state
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include "fsl_device_registers.h"
+
+ADC_Type       SIM_ADC0;
+ADC_Type       SIM_ADC1;
+AIPS_Type      SIM_AIPS0;
+AIPS_Type      SIM_AIPS1;
+AXBS_Type      SIM_AXBS;
+CAN_Type       SIM_CAN0;
+CMP_Type       SIM_CMP0;
+CMP_Type       SIM_CMP1;
+CMP_Type       SIM_CMP2;
+CMT_Type       SIM_CMT;
+CRC_Type       SIM_CRC0;
+DAC_Type       SIM_DAC0;
+DAC_Type       SIM_DAC1;
+DMA_Type       SIM_DMA0;
+DMAMUX_Type    SIM_DMAMUX;
+EWM_Type       SIM_EWM;
+FB_Type        SIM_FB;
+FMC_Type       SIM_FMC;
+FTFE_Type      SIM_FTFE;
+FTM_Type       SIM_FTM0;
+FTM_Type       SIM_FTM1;
+FTM_Type       SIM_FTM2;
+FTM_Type       SIM_FTM3;
+GPIO_Type      SIM_GPIOA;
+GPIO_Type      SIM_GPIOB;
+GPIO_Type      SIM_GPIOC;
+GPIO_Type      SIM_GPIOD;
+GPIO_Type      SIM_GPIOE;
+I2C_Type       SIM_I2C0;
+I2C_Type       SIM_I2C1;
+I2C_Type       SIM_I2C2;
+I2S_Type       SIM_I2S0;
+LLWU_Type      SIM_LLWU;
+LPTMR_Type     SIM_LPTMR0;
+MCG_Type       SIM_MCG;
+MCM_Type       SIM_MCM;
+OSC_Type       SIM_OSC;
+PDB_Type       SIM_PDB0;
+PIT_Type       SIM_PIT;
+PMC_Type       SIM_PMC;
+uint8_t        SIM_PORT[5][SIM_PORT_SPACING] __attribute__((aligned(8)));
+RCM_Type       SIM_RCM;
+RFSYS_Type     SIM_RFSYS;
+RFVBAT_Type    SIM_RFVBAT;
+RTC_Type       SIM_RTC;
+SDHC_Type      SIM_SDHC;
+SIM_Type       SIM_SIM;
+SMC_Type       SIM_SMC;
+SPI_Type       SIM_SPI0;
+SPI_Type       SIM_SPI1;
+SPI_Type       SIM_SPI2;
+SYSMPU_Type    SIM_SYSMPU;
+UART_Type      SIM_UART0;
+UART_Type      SIM_UART1;
+UART_Type      SIM_UART2;
+UART_Type      SIM_UART3;
+UART_Type      SIM_UART4;
+UART_Type      SIM_UART5;
+USB_Type       SIM_USB0;
+USBDCD_Type    SIM_USBDCD;
+VREF_Type      SIM_VREF;
+WDOG_Type      SIM_WDOG;
+
+DWT_Type SIM_DWT;
+CoreDebug_Type SIM_CoreDebug;
+SysTick_Type SIM_SysTick;
+SCB_Type SIM_SCB;
+
+volatile uint32_t SIM_IPSR;
+volatile uint32_t SIM_PRIMASK;
+uint8_t SIM_NVIC_Enabled[128];
+uint8_t SIM_NVIC_Pending[128];
+uint8_t SIM_NVIC_Priority[128];
+
+uint32_t SystemCoreClock = 120000000UL;
+
+static SIM_NVIC_Handler_t	sim_nvic_handler[128];
+static volatile bool			sim_nvic_raised;				// requests with a handler may be pending
+
+/*!
+ ******************************************************************************
+ *	A reset of the simulated controller ends the process
+ ******************************************************************************
+*/
+void SIM_SystemReset(void)
+{
+	exit(EXIT_FAILURE);
+}
+
+void SystemInit(void)
+{
+}
+
+void SystemCoreClockUpdate(void)
+{
+}
+
+/*!
+ ******************************************************************************
+ *	Priority of the running code: exceptions below 16 (SysTick, PendSV) have
+ * the lowest priority as under FreeRTOS, the thread mode is below all
+ ******************************************************************************
+*/
+static uint32_t SIM_NVIC_Level(void)
+{
+	if (SIM_IPSR == 0)
+		return 0x100;
+	if (SIM_IPSR < 16)
+		return 0xFF;
+	return SIM_NVIC_Priority[SIM_IPSR - 16];
+}
+
+void SIM_NVIC_Raise(IRQn_Type irq,SIM_NVIC_Handler_t handler)
+{
+	if (irq < 0)
+		return;
+	sim_nvic_handler[irq] = handler;
+	SIM_NVIC_Pending[irq] = 1;
+	sim_nvic_raised = true;
+	SIM_NVIC_Dispatch();
+}
+
+/*!
+ ******************************************************************************
+ *	Runs the pending handlers which preempt the running code, the highest
+ * priority first. Each one runs on the thread of the caller with the IPSR of
+ * its exception number
+ ******************************************************************************
+*/
+void SIM_NVIC_Dispatch(void)
+{
+uint32_t		level,prev;
+int			irq;
+bool			raised;
+
+	while (sim_nvic_raised && SIM_PRIMASK == 0)
+	{
+		level = SIM_NVIC_Level();
+		raised = false;
+		irq = -1;
+		for (int i = 0;i < 128;i++)
+		{
+			if (!SIM_NVIC_Pending[i] || sim_nvic_handler[i] == NULL)
+				continue;
+			raised = true;
+			if (SIM_NVIC_Enabled[i] && SIM_NVIC_Priority[i] < level &&
+				 (irq < 0 || SIM_NVIC_Priority[i] < SIM_NVIC_Priority[irq]))
+				irq = i;
+		}
+		sim_nvic_raised = raised;
+		if (irq < 0)
+			return;
+		SIM_NVIC_Pending[irq] = 0;
+		prev = SIM_IPSR;
+		SIM_IPSR = (uint32_t)irq + 16;
+		sim_nvic_handler[irq]();
+		SIM_IPSR = prev;
+	}
+}
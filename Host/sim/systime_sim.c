@@ -0,0 +1,41 @@
+/*
+ * systime_sim.c
+ *
+ *  Simulated board-SysTime.c: the system time is the simulated clock, the
+ *  PIT0 jiffies are whole periods of it. A separate file, so that a test may
+ *  link board-SysTime.c on a PIT model in place of it
+ */
+
+#include "board.h"
+#include "sim_clock.h"
+
+uint64_t BOARD_getSystemTime_ns(void)
+{
+	return SIM_Clock_ns();
+}
+
+uint64_t BOARD_getSystemTime_us(void)
+{
+	return SIM_Clock_ns() / 1000ULL;
+}
+
+uint64_t BOARD_getSystemTime_ms(void)
+{
+	return SIM_Clock_ns() / 1000000ULL;
+}
+
+bool BOARD_getSystemTime(uint64_t *time)
+{
+	*time = SIM_Clock_ns();
+	return true;
+}
+
+uint64_t BOARD_getSystemTimeDirect(void)
+{
+	return SIM_Clock_ns();
+}
+
+uint64_t Now(void)
+{
+	return SIM_Clock_ns() / (PIT0_PERIOD * 1000000ULL);
+}
@@ -0,0 +1,299 @@
+/*
+ * uart_sim.c
+ *
+ *  Simulated command interface: a model of UART0 and of the eDMA channels
+ *  below uart.c. The RX channel moves each received byte into its ring with
+ *  the destination modulo and interrupts at half and full major loop, the TX
+ *  channel sends one byte per character time from its source (modulo or not)
+ *  and stops at the end of the major loop. The UART sets the RX edge flag at
+ *  each start bit and the idle flag a character after a burst, the idle flag
+ *  is cleared by the first DMA read of D after an S1 read, as on the chip.
+ *  The RX edge flag is written one to clear by uart.c, on the plain memory of
+ *  the registers this leaves it set: the model clears it after each run of
+ *  the UART interrupt which found it or the idle line pending
+ */
+
+#include <string.h>
+#include "board.h"
+#include "fsl_edma.h"
+#include "uart.h"
+#include "sim_clock.h"
+#include "sim_uart.h"
+
+#define SIM_UART_S1			(*(volatile uint8_t *)&UART0->S1)		// read only for the driver
+
+typedef struct
+{
+	uint64_t				tx_ns;					// end of the last byte on the TX line
+	uint64_t				now_ns;					// time of the byte being sent by SIM_UART_Run
+	bool					running;
+	bool					idle_read;				// S1 has been read with IDLE set
+	uint8_t				log[SIM_UART_TX_LOG_SIZE];
+	uint32_t				log_in;
+	uint32_t				log_out;
+	SIM_UART_Stats_t	stats;
+} SIM_UART_t;
+
+void UART0_RX_TX_IRQHandler(void);
+void DMA6_IRQHandler(void);
+void DMA7_IRQHandler(void);
+
+static SIM_UART_t			sim_uart;
+
+static uint64_t SIM_UART_Now(void)
+{
+	return sim_uart.running ? sim_uart.now_ns : SIM_Clock_ns();
+}
+
+uint64_t SIM_UART_ByteNs(void)
+{
+uint32_t		sbr = ((uint32_t)(UART0->BDH & UART_BDH_SBR_MASK) << 8) | UART0->BDL;
+uint32_t		brfa = UART0->C4 & UART_C4_BRFA_MASK;
+
+	// baud rate = clock / (16 * (SBR + BRFA / 32)), 10 bits per character
+	return 10ULL * 1000000000ULL * (32 * sbr + brfa) / (2ULL * CLOCK_GetCoreSysClkFreq());
+}
+
+/*!
+ ******************************************************************************
+ *	Next address of a channel: the offset is added to the low modulo bits
+ ******************************************************************************
+*/
+static uint32_t SIM_DMA_Next(uint32_t addr,int16_t offset,uint32_t modulo)
+{
+uint32_t		mask;
+
+	if (modulo == 0)
+		return addr + offset;
+	mask = (1u << modulo) - 1;
+	return (addr & ~mask) | ((addr + offset) & mask);
+}
+
+static bool SIM_DMA_Requested(uint32_t channel)
+{
+	return (DMA0->ERQ & (1u << channel)) != 0 && (DMAMUX0->CHCFG[channel] & DMAMUX_CHCFG_ENBL_MASK) != 0;
+}
+
+static void SIM_UART_RxIrq(void)
+{
+	sim_uart.stats.rx_dma_irqs++;
+	DMA6_IRQHandler();
+}
+
+static void SIM_UART_TxIrq(void)
+{
+	sim_uart.stats.tx_dma_irqs++;
+	DMA7_IRQHandler();
+}
+
+/*!
+ ******************************************************************************
+ *	End of a minor loop: counts the major loop down, at its end the addresses
+ * are adjusted, DONE is set and a request with DREQ is cleared. Interrupts
+ * at half and at the end of the major loop if enabled
+ ******************************************************************************
+*/
+static void SIM_DMA_MinorLoop(uint32_t channel,IRQn_Type irq,SIM_NVIC_Handler_t handler)
+{
+uint32_t		citer = (DMA0->TCD[channel].CITER_ELINKNO & DMA_CITER_ELINKNO_CITER_MASK) - 1;
+uint32_t		biter = DMA0->TCD[channel].BITER_ELINKNO & DMA_BITER_ELINKNO_BITER_MASK;
+uint16_t		csr = DMA0->TCD[channel].CSR;
+bool			irq_req = false;
+
+	if (citer == 0)
+	{
+		DMA0->TCD[channel].CITER_ELINKNO = (uint16_t)biter;
+		DMA0->TCD[channel].SADDR += DMA0->TCD[channel].SLAST;
+		DMA0->TCD[channel].DADDR += DMA0->TCD[channel].DLAST_SGA;
+		DMA0->TCD[channel].CSR = csr | DMA_CSR_DONE_MASK;
+		if (csr & DMA_CSR_DREQ_MASK)
+			DMA0->ERQ &= ~(1u << channel);
+		irq_req = (csr & DMA_CSR_INTMAJOR_MASK) != 0;
+	}
+	else
+	{
+		DMA0->TCD[channel].CITER_ELINKNO = (uint16_t)citer;
+		irq_req = (csr & DMA_CSR_INTHALF_MASK) != 0 && citer == biter / 2;
+	}
+	if (irq_req)
+	{
+		DMA0->INT |= 1u << channel;
+		SIM_NVIC_Raise(irq,handler);
+	}
+}
+
+static void SIM_UART_Irq(void);
+
+/*!
+ ******************************************************************************
+ *	The interrupt line of the UART: idle line or RX edge, each if enabled
+ ******************************************************************************
+*/
+static void SIM_UART_Update(void)
+{
+	if (((UART0->S1 & UART_S1_IDLE_MASK) && (UART0->C2 & UART_C2_ILIE_MASK)) ||
+		 ((UART0->S2 & UART_S2_RXEDGIF_MASK) && (UART0->BDH & UART_BDH_RXEDGIE_MASK)))
+		SIM_NVIC_Raise(UART0_RX_TX_IRQn,SIM_UART_Irq);
+}
+
+static void SIM_UART_Irq(void)
+{
+bool			ack = ((UART0->S1 & UART_S1_IDLE_MASK) && (UART0->C2 & UART_C2_ILIE_MASK)) ||
+					((UART0->S2 & UART_S2_RXEDGIF_MASK) && (UART0->BDH & UART_BDH_RXEDGIE_MASK));
+
+	// the handler reads S1 first
+	if (UART0->S1 & UART_S1_IDLE_MASK)
+		sim_uart.idle_read = true;
+	sim_uart.stats.uart_irqs++;
+	UART0_RX_TX_IRQHandler();
+	if (ack)
+		UART0->S2 &= ~UART_S2_RXEDGIF_MASK;
+	SIM_UART_Update();
+}
+
+/*!
+ ******************************************************************************
+ *	A received byte is read from D by the RX DMA
+ ******************************************************************************
+*/
+static void SIM_UART_RxByte(uint8_t ch)
+{
+uint32_t		modulo = (DMA0->TCD[UART_DMA_RX_CHANNEL].ATTR & DMA_ATTR_DMOD_MASK) >> DMA_ATTR_DMOD_SHIFT;
+
+	sim_uart.stats.rx_bytes++;
+	if (!SIM_DMA_Requested(UART_DMA_RX_CHANNEL) || !(UART0->C5 & UART_C5_RDMAS_MASK) ||
+		 !(UART0->C2 & UART_C2_RIE_MASK) || !(UART0->C2 & UART_C2_RE_MASK))
+	{
+		sim_uart.stats.rx_lost++;
+		return;
+	}
+	if (sim_uart.idle_read)
+	{
+		SIM_UART_S1 &= ~UART_S1_IDLE_MASK;
+		sim_uart.idle_read = false;
+	}
+	*(uint8_t *)(uintptr_t)DMA0->TCD[UART_DMA_RX_CHANNEL].DADDR = ch;
+	DMA0->TCD[UART_DMA_RX_CHANNEL].DADDR = SIM_DMA_Next(DMA0->TCD[UART_DMA_RX_CHANNEL].DADDR,
+		DMA0->TCD[UART_DMA_RX_CHANNEL].DOFF,modulo);
+	SIM_DMA_MinorLoop(UART_DMA_RX_CHANNEL,UART_DMA_RX_IRQn,SIM_UART_RxIrq);
+}
+
+/*!
+ ******************************************************************************
+ *	The TX DMA writes a byte to D, it is on the line for a character time
+ ******************************************************************************
+*/
+static void SIM_UART_TxByte(void)
+{
+uint32_t		modulo = (DMA0->TCD[UART_DMA_TX_CHANNEL].ATTR & DMA_ATTR_SMOD_MASK) >> DMA_ATTR_SMOD_SHIFT;
+uint8_t		ch = *(const uint8_t *)(uintptr_t)DMA0->TCD[UART_DMA_TX_CHANNEL].SADDR;
+
+	if (sim_uart.log_in - sim_uart.log_out == SIM_UART_TX_LOG_SIZE)
+		sim_uart.log_out++;			// the test did not take the oldest byte
+	sim_uart.log[sim_uart.log_in++ & (SIM_UART_TX_LOG_SIZE - 1)] = ch;
+	sim_uart.stats.tx_bytes++;
+	DMA0->TCD[UART_DMA_TX_CHANNEL].SADDR = SIM_DMA_Next(DMA0->TCD[UART_DMA_TX_CHANNEL].SADDR,
+		DMA0->TCD[UART_DMA_TX_CHANNEL].SOFF,modulo);
+	SIM_DMA_MinorLoop(UART_DMA_TX_CHANNEL,UART_DMA_TX_IRQn,SIM_UART_TxIrq);
+}
+
+static bool SIM_UART_TxActive(void)
+{
+	return SIM_DMA_Requested(UART_DMA_TX_CHANNEL) && (UART0->C5 & UART_C5_TDMAS_MASK) &&
+		(UART0->C2 & UART_C2_TIE_MASK) && (UART0->C2 & UART_C2_TE_MASK);
+}
+
+void SIM_UART_Run(void)
+{
+uint64_t		byte_ns,until;
+
+	if (sim_uart.running)
+		return;
+	sim_uart.running = true;
+	byte_ns = SIM_UART_ByteNs();
+	until = SIM_Clock_ns();
+	// the TX DMA interrupt starts the next segment at the end of the last byte
+	while (SIM_UART_TxActive() && sim_uart.tx_ns + byte_ns <= until)
+	{
+		sim_uart.tx_ns += byte_ns;
+		sim_uart.now_ns = sim_uart.tx_ns;
+		sim_uart.stats.tx_busy_ns += byte_ns;
+		SIM_UART_TxByte();
+	}
+	sim_uart.running = false;
+}
+
+void SIM_UART_Receive(const uint8_t *data,int len)
+{
+uint64_t		byte_ns = SIM_UART_ByteNs();
+
+	for (int i = 0;i < len;i++)
+	{
+		UART0->S2 |= UART_S2_RXEDGIF_MASK;			// start bit
+		SIM_UART_Update();
+		SIM_Clock_Sleep(byte_ns);
+		SIM_UART_Run();
+		SIM_UART_RxByte(data[i]);
+	}
+	SIM_Clock_Sleep(byte_ns);
+	SIM_UART_Run();
+	if (len > 0)
+	{
+		SIM_UART_S1 |= UART_S1_IDLE_MASK;
+		SIM_UART_Update();
+	}
+}
+
+void SIM_UART_Flush(void)
+{
+uint64_t		byte_ns = SIM_UART_ByteNs();
+
+	while (SIM_UART_TxActive() || NVIC_GetPendingIRQ(UART_DMA_TX_IRQn))
+	{
+		SIM_Clock_Sleep(byte_ns);
+		SIM_UART_Run();
+	}
+}
+
+int SIM_UART_Sent(uint8_t *data,int max)
+{
+int			n = 0;
+
+	while (n < max && sim_uart.log_out != sim_uart.log_in)
+		data[n++] = sim_uart.log[sim_uart.log_out++ & (SIM_UART_TX_LOG_SIZE - 1)];
+	return n;
+}
+
+const SIM_UART_Stats_t *SIM_UART_GetStats(void)
+{
+	return &sim_uart.stats;
+}
+
+void SIM_UART_ClearStats(void)
+{
+	memset(&sim_uart.stats,0,sizeof(sim_uart.stats));
+}
+
+// -------------------------------------------------------------------------------
+// eDMA driver
+// -------------------------------------------------------------------------------
+
+/*!
+ ******************************************************************************
+ *	A request of the TX channel starts when it is set, at the end of the byte
+ * on the line if there is one
+ ******************************************************************************
+*/
+void EDMA_EnableChannelRequest(DMA_Type *base,uint32_t channel)
+{
+uint64_t		now = SIM_UART_Now();
+
+	if (channel == UART_DMA_TX_CHANNEL && !(base->ERQ & (1u << channel)) && sim_uart.tx_ns < now)
+		sim_uart.tx_ns = now;
+	base->ERQ |= 1u << channel;
+}
+
+void EDMA_DisableChannelRequest(DMA_Type *base,uint32_t channel)
+{
+	base->ERQ &= ~(1u << channel);
+}
@@ -0,0 +1,61 @@
+/*
+ * host_test.h
+ *
+ *  Checks of the host tests: a failed check is reported with its location,
+ *  the test returns the number of failed checks
+ */
+
+#ifndef HOST_TEST_H_
+#define HOST_TEST_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* __cplusplus */
+
+extern int host_test_failed;
+
+/*!
+ ******************************************************************************
+ *	Host time in ns, for the benchmarks
+ ******************************************************************************
+*/
+static inline uint64_t HOST_TimeNs(void)
+{
+struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+#if defined(__cplusplus)
+}
+#endif /* __cplusplus */
+
+#define CHECK(cond)																		\
+	do {																						\
+		if (!(cond))																		\
+		{																						\
+			printf("%s:%d: CHECK(%s) failed\n",__FILE__,__LINE__,#cond);	\
+			host_test_failed++;															\
+		}																						\
+	} while (0)
+
+#define CHECK_EQ(a,b)																	\
+	do {																						\
+		long long	_a = (long long)(a),_b = (long long)(b);					\
+		if (_a != _b)																		\
+		{																						\
+			printf("%s:%d: CHECK_EQ(%s,%s) failed: %lld != %lld\n",			\
+				__FILE__,__LINE__,#a,#b,_a,_b);										\
+			host_test_failed++;															\
+		}																						\
+	} while (0)
+
+#define HOST_TEST_RESULT()																\
+	(printf(host_test_failed ? "FAILED (%d checks)\n" : "PASSED\n",host_test_failed),host_test_failed != 0)
+
+#endif /* HOST_TEST_H_ */
@@ -0,0 +1,151 @@
+/*
+ * test_board.c
+ *
+ *  Smoke test of the host build: the board comes up on the simulated
+ *  peripherals and the drivers above them reach the simulated devices. The
+ *  ADC channels read the input of their own channel in the last scan, a read
+ *  between two conversions of a scan reads the previous scan (user-010)
+ */
+
+#include <string.h>
+#include "board.h"
+#include "clock_config.h"
+#include "board-Ana.h"
+#include "CAN.h"
+#include "EEPROM.h"
+#include "FRAM.h"
+#include "sim_rtos.h"
+#include "sim_board.h"
+#include "sim_can.h"
+#include "sim_i2c.h"
+#include "host_test.h"
+
+static void TestEEPROM(void)
+{
+SIM_I2C_Slave_t	*eeprom = SIM_I2C_Slave(EERPROM_I2C_ADDRESS);
+uint8_t				wr[300],rd[300];
+
+	// crosses a page boundary: two write cycles
+	for (unsigned i = 0;i < sizeof(wr);i++)
+		wr[i] = (uint8_t)(i * 7 + 3);
+	CHECK(EEPROM_WriteBlock(EERPROM_I2C_ADDRESS,0x01F0,wr,sizeof(wr)));
+	CHECK(EEPROM_ReadBlock(EERPROM_I2C_ADDRESS,0x01F0,rd,sizeof(rd)));
+	CHECK(memcmp(wr,rd,sizeof(wr)) == 0);
+	CHECK(memcmp(eeprom->mem + 0x01F0,wr,sizeof(wr)) == 0);
+	CHECK(eeprom->writes >= 2);
+	eeprom->nak = true;
+	CHECK(!EEPROM_ReadBlock(EERPROM_I2C_ADDRESS,0,rd,4));
+	eeprom->nak = false;
+}
+
+static void TestFRAM(void)
+{
+uint8_t		wr[40],rd[40];
+
+	for (unsigned i = 0;i < sizeof(wr);i++)
+		wr[i] = (uint8_t)(0xA5 ^ i);
+	CHECK(WriteFRAM(0x1000,wr,sizeof(wr)));
+	CHECK(ReadFRAM(0x1000,rd,sizeof(rd)));
+	CHECK(memcmp(wr,rd,sizeof(wr)) == 0);
+}
+
+static void TestCAN(void)
+{
+uint8_t				payload[8] = { 1,2,3,4,5,6,7,8 },rx[8];
+SIM_CAN_Frame_t	frame;
+uint32_t				id;
+bool					ext;
+int					len;
+
+	CHECK(CAN_SendMessage(CAN_CHANNEL,0x181,false,payload,8));
+	CHECK(SIM_CAN_Transmitted(CAN_CHANNEL,&frame));
+	CHECK_EQ(frame.msg.ID,0x181);
+	CHECK_EQ(frame.msg.len,8);
+	CHECK(memcmp(frame.msg.payload,payload,8) == 0);
+	CHECK(!SIM_CAN_Transmitted(CAN_CHANNEL,&frame));
+
+	CHECK(SIM_CAN_Receive(CAN_CHANNEL,0x100,false,payload,3));
+	CHECK(CAN_getRxMessage(CAN_CHANNEL,&id,&ext,rx,&len));
+	CHECK_EQ(id,0x100);
+	CHECK_EQ(len,3);
+	CHECK(!CAN_isRxMessageAvailable(CAN_CHANNEL));
+}
+
+/*!
+ ******************************************************************************
+ *	Input of a channel in a scan, distinct for each channel and scan
+ ******************************************************************************
+*/
+static uint16_t ADCInput(unsigned scan,unsigned channel)
+{
+	return (uint16_t)(((scan * 37 + channel * 4099) & 0x0FFF) | (channel << 12));
+}
+
+/*!
+ ******************************************************************************
+ *	A read between two conversions of a scan sees the previous scan, for all
+ * channels
+ ******************************************************************************
+*/
+static void OnConversion(unsigned adc,unsigned channel,void *ctx)
+{
+unsigned		scan = *(const unsigned *)ctx;
+uint16_t		value;
+
+	(void)adc;
+	(void)channel;
+	for (unsigned ch = 0;ch < BOARD_ADC_NumberOfChannels;ch++)
+	{
+		CHECK(BOARD_get_ADC(ch,&value));
+		CHECK_EQ(value,scan == 0 ? 0 : ADCInput(scan - 1,ch));
+	}
+}
+
+/*!
+ ******************************************************************************
+ *	Each channel reads the input of its own channel in the last scan, reads
+ * during a scan never see a half written buffer
+ ******************************************************************************
+*/
+static void TestADC(void)
+{
+unsigned		scan;
+uint16_t		value;
+
+	// no scan yet: the channels read 0
+	CHECK_EQ(BOARD_ADC_GetScanCount(),0);
+	BOARD_ADC_EnableScan(true);
+	SIM_ADC_SetConversionHook(OnConversion,&scan);
+	for (scan = 0;scan < 50;scan++)
+	{
+		for (unsigned ch = 0;ch < BOARD_ADC_NumberOfChannels;ch++)
+			CHECK(SIM_ADC_SetInput(ch,ADCInput(scan,ch)));
+		SIM_ADC_Scan();
+		CHECK_EQ(BOARD_ADC_GetScanCount(),scan + 1);
+		for (unsigned ch = 0;ch < BOARD_ADC_NumberOfChannels;ch++)
+		{
+			CHECK(BOARD_get_ADC(ch,&value));
+			CHECK_EQ(value,ADCInput(scan,ch));
+		}
+		if (host_test_failed)
+			break;
+	}
+	SIM_ADC_SetConversionHook(NULL,NULL);
+	CHECK(!BOARD_get_ADC(BOARD_ADC_NumberOfChannels,&value));
+	BOARD_ADC_EnableScan(false);
+	SIM_ADC_Scan();
+	CHECK_EQ(BOARD_ADC_GetScanCount(),50);
+}
+
+int main(void)
+{
+	SIM_RTOS_Reset();
+	SIM_RTOS_SetSchedulerState(taskSCHEDULER_RUNNING);
+	BOARD_InitBootClocks();
+	CHECK(BOARD_Init());
+	TestEEPROM();
+	TestFRAM();
+	TestCAN();
+	TestADC();
+	return HOST_TEST_RESULT();
+}
@@ -0,0 +1,177 @@
+/*
+ * test_boot_graph.cpp
+ *
+ *  Startup graph of BoardMgr (user-024) with scripted readiness signals in
+ *  place of the hardware: the dependencies and times of the stages are those
+ *  of BoardMgr. Each stage starts after all stages it depends on are
+ *  finished, the independent ones at once; the time to operational is the
+ *  longest path. Without any signal the timeouts give the former fixed waits.
+ *  A signal dropping during its hold time restarts the hold, a failed stage
+ *  still starts its dependents. Prints the time to operational
+ */
+
+#include <string.h>
+#include "BoardMgr.h"
+#include "BootGraph.h"
+#include "host_test.h"
+
+#define POLL_MS				10						// BOOT_POLL_PERIOD of BoardMgr
+#define NEVER					UINT32_MAX
+#define MAX_MS					60000
+
+typedef struct
+{
+	uint32_t		ready_at[BOOT_MAX_STAGES];		// ms after the start of the stage, NEVER if not
+	uint32_t		drop_at[BOOT_MAX_STAGES];		// ms after the start: not ready for one poll
+	bool			fail[BOOT_MAX_STAGES];
+	uint32_t		now;
+	BOOT_Graph_t	*graph;
+} Script_t;
+
+static BOOT_StageDef_t		stages[BOOT_MAX_STAGES];
+static unsigned				n_stages;
+
+static bool ScriptStart(void *ctx,unsigned stage)
+{
+Script_t		*script = (Script_t *)ctx;
+
+	return !script->fail[stage];
+}
+
+static bool ScriptReady(void *ctx,unsigned stage)
+{
+Script_t		*script = (Script_t *)ctx;
+uint32_t		t = script->now - script->graph->stage[stage].started;
+
+	if (script->drop_at[stage] != NEVER && t >= script->drop_at[stage] && t < script->drop_at[stage] + POLL_MS)
+		return false;
+	return script->ready_at[stage] != NEVER && t >= script->ready_at[stage];
+}
+
+static unsigned Stage(const char *name)
+{
+	for (unsigned i = 0;i < n_stages;i++)
+		if (strcmp(stages[i].name,name) == 0)
+			return i;
+	printf("no stage %s\n",name);
+	host_test_failed++;
+	return 0;
+}
+
+static void InitScript(Script_t *script)
+{
+	memset(script,0,sizeof(*script));
+	for (unsigned i = 0;i < BOOT_MAX_STAGES;i++)
+	{
+		script->ready_at[i] = NEVER;
+		script->drop_at[i] = NEVER;
+	}
+}
+
+/*!
+ ******************************************************************************
+ *	Runs the graph as BoardMgr::Boot does and checks the order of the stages
+ * \return        time to operational in ms
+ ******************************************************************************
+*/
+static uint32_t Run(BOOT_Graph_t *g,Script_t *script)
+{
+	script->graph = g;
+	script->now = 0;
+	CHECK(BOOT_Init(g,stages,n_stages,script,0));
+	while (!BOOT_Step(g,script->now) && script->now < MAX_MS)
+		script->now += POLL_MS;
+	CHECK(BOOT_Finished(g));
+	for (unsigned i = 0;i < n_stages;i++)
+	{
+		if (stages[i].after == 0)
+			CHECK_EQ(g->stage[i].started,0);
+		for (unsigned dep = 0;dep < n_stages;dep++)
+		{
+			if ((stages[i].after & BOOT_STAGE(dep)) == 0)
+				continue;
+			if (g->stage[i].started < g->stage[dep].finished)
+			{
+				printf("%s started at %u ms before %s finished at %u ms\n",stages[i].name,g->stage[i].started,
+					stages[dep].name,g->stage[dep].finished);
+				host_test_failed++;
+			}
+		}
+	}
+	return script->now;
+}
+
+int main(void)
+{
+const BOOT_StageDef_t	*board = BoardMgr::GetBootStages(&n_stages);
+BOOT_Graph_t				g;
+Script_t						script;
+unsigned						flexisoft,adc,relays,eeprom,cleaning;
+uint32_t						t,expected,sequential;
+
+	CHECK(n_stages <= BOOT_MAX_STAGES);
+	CHECK(BOOT_Init(&g,board,n_stages,nullptr,0));
+	// the stages of the board with scripted functions
+	for (unsigned i = 0;i < n_stages;i++)
+	{
+		stages[i] = board[i];
+		stages[i].start = board[i].start != nullptr ? ScriptStart : nullptr;
+		stages[i].ready = board[i].ready != nullptr ? ScriptReady : nullptr;
+	}
+	flexisoft = Stage("Flexisoft");
+	adc = Stage("ADC");
+	relays = Stage("Relays");
+	eeprom = Stage("EEPROM");
+	cleaning = Stage("Cleaning");
+	CHECK((stages[relays].after & BOOT_STAGE(flexisoft)) != 0);
+	CHECK((stages[cleaning].after & BOOT_STAGE(relays)) == 0);		// through Safety
+	sequential = stages[flexisoft].timeout + stages[relays].timeout;
+
+	// usual startup: the Flexisoft after 3 s, the Relays after 200 ms
+	InitScript(&script);
+	script.ready_at[flexisoft] = 3000;
+	script.ready_at[adc] = 50;
+	script.ready_at[relays] = 200;
+	t = Run(&g,&script);
+	expected = 3000 + stages[flexisoft].hold + 200 + stages[relays].hold;
+	CHECK(t >= expected && t < expected + 3 * POLL_MS);
+	for (unsigned i = 0;i < n_stages;i++)
+		CHECK_EQ(g.stage[i].state,BOOT_DONE);
+	CHECK_EQ(g.stage[adc].finished,50);
+	CHECK_EQ(g.stage[eeprom].finished,0);
+	printf("operational after %u ms, the fixed waits took %u ms\n",t,sequential);
+
+	// no signal: the timeouts are the former waits, the dependents start anyway
+	InitScript(&script);
+	t = Run(&g,&script);
+	CHECK(t >= sequential && t < sequential + 2 * POLL_MS);
+	CHECK_EQ(g.stage[flexisoft].state,BOOT_TIMEOUT);
+	CHECK_EQ(g.stage[relays].state,BOOT_TIMEOUT);
+	CHECK_EQ(g.stage[cleaning].state,BOOT_DONE);
+
+	// the Flexisoft signal drops during its hold time: the hold restarts
+	InitScript(&script);
+	script.ready_at[flexisoft] = 1000;
+	script.drop_at[flexisoft] = 1000 + stages[flexisoft].hold / 2;
+	script.ready_at[adc] = 0;
+	script.ready_at[relays] = 0;
+	Run(&g,&script);
+	CHECK(g.stage[flexisoft].finished >= 1000 + stages[flexisoft].hold / 2 + POLL_MS + stages[flexisoft].hold);
+	CHECK_EQ(g.stage[flexisoft].state,BOOT_DONE);
+
+	// the EEPROM fails: the Cleaning Unit is started anyway
+	InitScript(&script);
+	script.ready_at[flexisoft] = 0;
+	script.ready_at[adc] = 0;
+	script.ready_at[relays] = 0;
+	script.fail[eeprom] = true;
+	Run(&g,&script);
+	CHECK_EQ(g.stage[eeprom].state,BOOT_FAILED);
+	CHECK_EQ(g.stage[cleaning].state,BOOT_DONE);
+
+	// invalid graphs
+	stages[0].after = BOOT_STAGE(1);
+	CHECK(!BOOT_Init(&g,stages,n_stages,&script,0));
+	CHECK(!BOOT_Init(&g,board,BOOT_MAX_STAGES + 1,nullptr,0));
+	return HOST_TEST_RESULT();
+}
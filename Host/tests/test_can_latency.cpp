@@ -0,0 +1,110 @@
+/*
+ * test_can_latency.cpp
+ *
+ *  SDO request-to-response latency of CANNode on the simulated FlexCAN: the
+ *  requests arrive from the CAN interrupt at every phase of the 10 ms period
+ *  of the CAN task, the response must be sent in the tick of the request
+ *  (user-002, the task was polling every CAN_TASK_PERIOD before)
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "CANNode.h"
+#include "CANDriver.h"
+#include "sim_rtos.h"
+#include "sim_clock.h"
+#include "sim_can.h"
+#include "host_test.h"
+
+#define NODE_ID				0x12
+#define REQUESTS				40
+#define FIRST_TICK			100				// the node is registered and waiting
+#define REQUEST_GAP			13					// prime to the 10 ms period: every phase is hit
+#define GIVE_UP_TICKS		50
+
+static TickType_t		request_tick;
+static uint64_t		request_ns;
+static uint64_t		request_host_ns;
+static int				requests;
+static int				responses;
+static TickType_t		max_ticks;
+static uint64_t		max_sim_ns;
+static uint64_t		total_host_ns;
+
+static void Finish(void)
+{
+	CHECK_EQ(responses,REQUESTS);
+	CHECK_EQ(max_ticks,0);
+	printf("SDO round trips: %d, max latency %u ticks / %llu ns simulated, %llu ns host per round trip\n",
+		responses,(unsigned)max_ticks,(unsigned long long)max_sim_ns,
+		(unsigned long long)(responses ? total_host_ns / responses : 0));
+	exit(HOST_TEST_RESULT());
+}
+
+/*!
+ ******************************************************************************
+ *	The master: sends a SDO upload request from the CAN interrupt
+ ******************************************************************************
+*/
+static void OnTick(TickType_t now,void *ctx)
+{
+uint8_t		request[8] = { 0x40,0x00,0x20,0x00,0,0,0,0 };	// upload 0x2000:00
+
+	(void)ctx;
+	if (requests > responses)
+	{
+		if (now - request_tick > GIVE_UP_TICKS)
+		{
+			printf("no response to request %d\n",requests);
+			host_test_failed++;
+			Finish();
+		}
+		return;
+	}
+	if (now < FIRST_TICK || (now - FIRST_TICK) % REQUEST_GAP != 0)
+		return;
+	if (requests == REQUESTS)
+		Finish();
+	request_tick = now;
+	request_ns = SIM_Clock_ns();
+	request_host_ns = HOST_TimeNs();
+	CHECK(SIM_CAN_Receive(0,EMessageBase_RxSDO + NODE_ID,false,request,8));
+	requests++;
+}
+
+static void OnTransmit(unsigned channel,const SIM_CAN_Frame_t *frame,void *ctx)
+{
+TickType_t		ticks;
+
+	(void)channel;
+	(void)ctx;
+	if (frame->msg.ID != EMessageBase_TxSDO + NODE_ID || requests == responses)
+		return;
+	// upload response or abort of the requested object
+	CHECK(frame->msg.payload[0] == 0x80 || (frame->msg.payload[0] & 0xE0) == 0x40);
+	CHECK_EQ(frame->msg.payload[1],0x00);
+	CHECK_EQ(frame->msg.payload[2],0x20);
+	ticks = xTaskGetTickCount() - request_tick;
+	if (ticks > max_ticks)
+		max_ticks = ticks;
+	if (frame->time_ns - request_ns > max_sim_ns)
+		max_sim_ns = frame->time_ns - request_ns;
+	total_host_ns += HOST_TimeNs() - request_host_ns;
+	responses++;
+}
+
+int main(void)
+{
+	SIM_RTOS_Reset();
+	SIM_RTOS_SetSchedulerState(taskSCHEDULER_RUNNING);
+	CHECK(CAN_init(0));
+	SIM_CAN_SetTxHook(OnTransmit,NULL);
+	SIM_RTOS_SetTickHook(OnTick,NULL);
+
+	CANDriver	driver(EDevice_CAN1,500000);
+	CANNode		node(driver,NODE_ID,osPriorityAboveNormal);
+
+	// returns through Finish()
+	node.Main();
+	return 1;
+}
@@ -0,0 +1,79 @@
+/*
+ * test_can_read.cpp
+ *
+ *  Timeout of CANDriver::ReadMessage (user-002) on the simulated FlexCAN:
+ *  every third tick a frame is received and taken by another reader from
+ *  the tick, the driver wakes up without a frame. The read gives up after
+ *  its timeout counted from the call, not from the last wake-up, and returns
+ *  a frame which arrives in time
+ */
+
+#include <string.h>
+#include "CANDriver.h"
+#include "sim_rtos.h"
+#include "sim_can.h"
+#include "host_test.h"
+
+#define FRAME_ID				0x123
+#define TIMEOUT				20
+#define STEAL_PERIOD			3
+
+static TickType_t		steal_until;						// a read waiting longer ends then
+static TickType_t		deliver_at;
+static uint32_t		stolen;
+
+static void OnTick(TickType_t now,void *ctx)
+{
+uint8_t		payload[8] = { 1,2,3,4,5,6,7,8 };
+uint32_t		id;
+bool			ext;
+int			len;
+
+	(void)ctx;
+	if (now < steal_until && now % STEAL_PERIOD == 0)
+	{
+		CHECK(SIM_CAN_Receive(0,FRAME_ID,false,payload,1));
+		if (CAN_getRxMessage(0,&id,&ext,payload,&len))
+			stolen++;
+	}
+	if (now == deliver_at)
+		CHECK(SIM_CAN_Receive(0,FRAME_ID,false,payload,8));
+}
+
+int main(void)
+{
+CAN_msg		msg;
+TickType_t	start;
+
+	SIM_RTOS_Reset();
+	SIM_RTOS_SetSchedulerState(taskSCHEDULER_RUNNING);
+	CHECK(CAN_init(0));
+	SIM_RTOS_SetTickHook(OnTick,NULL);
+
+	CANDriver	driver(EDevice_CAN1,500000);
+
+	CHECK(driver.Start());
+	CHECK(driver.AddCANid(FRAME_ID,false,false));
+
+	// no frame: false at once without a timeout, after the timeout else
+	start = xTaskGetTickCount();
+	CHECK(!driver.ReadMessage(msg,0));
+	CHECK_EQ(xTaskGetTickCount() - start,0);
+	start = xTaskGetTickCount();
+	steal_until = start + 4 * TIMEOUT;
+	CHECK(!driver.ReadMessage(msg,TIMEOUT));
+	CHECK_EQ(xTaskGetTickCount() - start,TIMEOUT);
+	CHECK(stolen >= TIMEOUT / STEAL_PERIOD);
+
+	// a frame after the wake-ups without one
+	start = xTaskGetTickCount();
+	steal_until = start + 4 * TIMEOUT;
+	deliver_at = start + TIMEOUT - 2;
+	memset(&msg,0,sizeof(msg));
+	CHECK(driver.ReadMessage(msg,TIMEOUT));
+	CHECK_EQ(xTaskGetTickCount() - start,TIMEOUT - 2);
+	CHECK_EQ(msg.id,FRAME_ID);
+	CHECK_EQ(msg.len,8);
+	CHECK_EQ(msg.data[7],8);
+	return HOST_TEST_RESULT();
+}
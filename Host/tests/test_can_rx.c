@@ -0,0 +1,190 @@
+/*
+ * test_can_rx.c
+ *
+ *  RX ring of CAN.c (user-004) filled by the CAN interrupt of the FlexCAN
+ *  model. A flood without a reader stores CAN_RX_MESSAGE_BUFFER_DEPTH frames
+ *  and counts each further one as lost, a reader taking random amounts in
+ *  between gets every stored frame in order. With the interrupts masked the
+ *  FIFO of the FlexCAN overflows, the interrupt counts the warning and the
+ *  overflow once and stores the frames kept by the FIFO. Frames outside the
+ *  acceptance filters are not counted
+ */
+
+#include <string.h>
+#include "board.h"
+#include "clock_config.h"
+#include "CAN.h"
+#include "sim_rtos.h"
+#include "sim_can.h"
+#include "host_test.h"
+
+#define OWN_ID					0x100				// CAN_ID of the default descriptor
+#define AUX_ID					0x181
+#define FLOOD_EXTRA			20
+#define FIFO_DEPTH			6					// frames in the RX FIFO of the FlexCAN
+#define MIXED_FRAMES			20000
+
+static uint32_t		seed = 1999;
+
+static uint32_t Random(uint32_t lo,uint32_t hi)
+{
+	seed = seed * 1103515245u + 12345u;
+	return lo + (seed >> 8) % (hi - lo + 1);
+}
+
+static bool Receive(uint32_t ID,uint32_t seq)
+{
+uint8_t		payload[8];
+
+	memset(payload,0,sizeof(payload));
+	memcpy(payload,&seq,sizeof(seq));
+	return SIM_CAN_Receive(0,ID,false,payload,8);
+}
+
+/*!
+ ******************************************************************************
+ *	Takes a frame from the ring
+ * \return        its sequence number, UINT32_MAX if none
+ ******************************************************************************
+*/
+static uint32_t Read(uint32_t *ID)
+{
+uint8_t		payload[8];
+uint32_t		seq;
+bool			isExtID;
+int			len;
+
+	if (!CAN_getRxMessage(0,ID,&isExtID,payload,&len))
+		return UINT32_MAX;
+	CHECK(!isExtID);
+	CHECK_EQ(len,8);
+	memcpy(&seq,payload,sizeof(seq));
+	return seq;
+}
+
+static void Drain(void)
+{
+uint32_t		ID;
+
+	while (Read(&ID) != UINT32_MAX)
+	{
+	}
+}
+
+static void TestFlood(void)
+{
+CANstatistics_t	stats;
+uint32_t				ID;
+int					stored = 0;
+
+	Drain();
+	CHECK(CAN_ResetStatistics(0));
+	for (uint32_t seq = 0;seq < CAN_RX_MESSAGE_BUFFER_DEPTH + FLOOD_EXTRA;seq++)
+		stored += Receive(seq % 2 ? AUX_ID : OWN_ID,seq) ? 1 : 0;
+	CHECK(!Receive(OWN_ID + 1,0));
+	CHECK(!Receive(AUX_ID + 1,0));
+	CHECK_EQ(stored,CAN_RX_MESSAGE_BUFFER_DEPTH);
+	CHECK(CAN_GetStatistics(0,&stats));
+	CHECK_EQ(stats.RX_Frames,CAN_RX_MESSAGE_BUFFER_DEPTH);
+	CHECK_EQ(stats.RX_Lost,FLOOD_EXTRA);
+	CHECK_EQ(stats.RX_MaxSize,CAN_RX_MESSAGE_BUFFER_DEPTH);
+	CHECK_EQ(stats.RX_FifoOverflow,0);
+	CHECK_EQ(CAN_NumberOfRxMessageAvailable(0),CAN_RX_MESSAGE_BUFFER_DEPTH);
+	for (uint32_t seq = 0;seq < CAN_RX_MESSAGE_BUFFER_DEPTH;seq++)
+	{
+		CHECK_EQ(Read(&ID),seq);
+		CHECK_EQ(ID,seq % 2 ? AUX_ID : OWN_ID);
+	}
+	CHECK_EQ(Read(&ID),UINT32_MAX);
+}
+
+/*!
+ ******************************************************************************
+ *	Bursts and reads of random size: a frame is stored as long as the ring has
+ * room, the reader gets the stored ones in order
+ ******************************************************************************
+*/
+static void TestMixed(void)
+{
+CANstatistics_t	stats;
+uint32_t				ID,seq = 0,next = 0,frames = 0,lost = 0,used = 0,got;
+
+	CHECK(CAN_ResetStatistics(0));
+	while (seq < MIXED_FRAMES)
+	{
+		for (uint32_t n = Random(0,24);n > 0;n--,seq++)
+		{
+			bool	expected = used < CAN_RX_MESSAGE_BUFFER_DEPTH;
+
+			if (Receive(OWN_ID,seq) != expected)
+			{
+				printf("frame %u: stored %d with %u frames in the ring\n",seq,!expected,used);
+				host_test_failed++;
+				return;
+			}
+			if (expected)
+			{
+				used++;
+				frames++;
+			}
+			else
+				lost++;
+		}
+		for (uint32_t n = Random(0,20);n > 0 && used > 0;n--,used--)
+		{
+			// the lost frames leave gaps
+			got = Read(&ID);
+			CHECK(got != UINT32_MAX && got >= next);
+			next = got + 1;
+		}
+	}
+	CHECK(CAN_GetStatistics(0,&stats));
+	CHECK_EQ(stats.RX_Frames,frames);
+	CHECK_EQ(stats.RX_Lost,lost);
+	CHECK(lost > 0);
+	printf("%u frames: %u stored, %u lost in the ring\n",seq,frames,lost);
+	Drain();
+}
+
+/*!
+ ******************************************************************************
+ *	Frames while the interrupts are masked: the FIFO keeps FIFO_DEPTH, the
+ * interrupt stores them when it runs
+ ******************************************************************************
+*/
+static void TestFifoOverflow(void)
+{
+CANstatistics_t	stats;
+uint32_t				primask,ID;
+
+	Drain();
+	CHECK(CAN_ResetStatistics(0));
+	primask = DisableGlobalIRQ();
+	for (uint32_t seq = 0;seq < FIFO_DEPTH + 2;seq++)
+		CHECK(!Receive(OWN_ID,seq));
+	CHECK_EQ(CAN_NumberOfRxMessageAvailable(0),0);
+	EnableGlobalIRQ(primask);
+	CHECK(CAN_GetStatistics(0,&stats));
+	CHECK_EQ(stats.RX_Frames,FIFO_DEPTH);
+	CHECK_EQ(stats.RX_Lost,0);
+	CHECK_EQ(stats.RX_FifoWarning,1);
+	CHECK_EQ(stats.RX_FifoOverflow,1);
+	CHECK((CAN_getErrorFlags(0,1) & (eCANerr_RXfifo_Warning | eCANerr_RXfifo_Overflow)) ==
+		(eCANerr_RXfifo_Warning | eCANerr_RXfifo_Overflow));
+	for (uint32_t seq = 0;seq < FIFO_DEPTH;seq++)
+		CHECK_EQ(Read(&ID),seq);
+	CHECK_EQ(Read(&ID),UINT32_MAX);
+}
+
+int main(void)
+{
+	SIM_RTOS_Reset();
+	SIM_RTOS_SetSchedulerState(taskSCHEDULER_RUNNING);
+	BOARD_InitBootClocks();
+	BOARD_Init();
+	CHECK(CAN_AddMessageBuffer(AUX_ID,false,false));
+	TestFlood();
+	TestMixed();
+	TestFifoOverflow();
+	return HOST_TEST_RESULT();
+}
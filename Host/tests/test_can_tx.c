@@ -0,0 +1,227 @@
+/*
+ * test_can_tx.c
+ *
+ *  TX queue of CAN.c (user-003) on the FlexCAN model, the bus held by other
+ *  nodes while the frames are queued. The frames leave in the order of the
+ *  bus arbitration (base ID, RTR, IDE, ID extension), frames with the same ID
+ *  in the order they were queued, also when they are more than the mailboxes.
+ *  The queue takes one mailbox and CAN_TX_QUEUE_DEPTH frames of one ID.
+ *  Prints the enqueue time and the frames per second through the driver
+ */
+
+#include <string.h>
+#include "board.h"
+#include "clock_config.h"
+#include "CAN.h"
+#include "sim_rtos.h"
+#include "sim_can.h"
+#include "host_test.h"
+
+#define BLOCKER_ID			0x700				// low priority, in the mailboxes first
+#define BURST_IDS				3
+#define BURST_FRAMES			10					// of each ID, more than the mailboxes
+#define BENCH_BURSTS			2000
+#define BENCH_FRAMES			(CAN_TX_MAILBOX_NUM + CAN_TX_QUEUE_DEPTH)
+
+typedef struct
+{
+	uint32_t		ID;
+	bool			isExtID;
+	bool			remote;
+} Frame_t;
+
+static uint32_t		seed = 2027;
+
+static uint32_t Random(uint32_t lo,uint32_t hi)
+{
+	seed = seed * 1103515245u + 12345u;
+	return lo + (seed >> 8) % (hi - lo + 1);
+}
+
+static bool Send(const Frame_t *f,uint8_t seq)
+{
+	if (f->remote)
+		return CAN_RequestMessage(0,f->ID,f->isExtID);
+	return CAN_SendMessage(0,f->ID,f->isExtID,&seq,1);
+}
+
+static bool Next(const Frame_t *f)
+{
+SIM_CAN_Frame_t	frame;
+
+	if (!SIM_CAN_Transmitted(0,&frame))
+	{
+		printf("frame 0x%X missing\n",f->ID);
+		host_test_failed++;
+		return false;
+	}
+	if (frame.msg.ID != f->ID || frame.msg.isExtID != f->isExtID || frame.remote != f->remote)
+	{
+		printf("frame 0x%X%s%s sent, 0x%X%s%s expected\n",frame.msg.ID,frame.msg.isExtID ? " ext" : "",
+			frame.remote ? " RTR" : "",f->ID,f->isExtID ? " ext" : "",f->remote ? " RTR" : "");
+		host_test_failed++;
+		return false;
+	}
+	return true;
+}
+
+/*!
+ ******************************************************************************
+ *	The mailboxes are taken by low priority frames, the others are queued in
+ * reverse order. A standard frame wins against an extended one with the same
+ * base ID, a data frame against a remote frame
+ ******************************************************************************
+*/
+static void TestArbitration(void)
+{
+const Frame_t	queued[] = {
+						{ 0x081,false,false },
+						{ 0x080 << 18,true,false },			// base ID 0x080, the same ID field as 0x080
+						{ 0x080,false,true },
+						{ 0x080,false,false },
+						{ (0x07F << 18) | 0x3FFFF,true,false }
+					};
+const Frame_t	order[] = { queued[4],queued[3],queued[2],queued[1],queued[0] };
+Frame_t			blocker[CAN_TX_MAILBOX_NUM];
+
+	CHECK(CAN_ChangeAddressMode(0,1));
+	SIM_CAN_ClearTransmitted(0);
+	SIM_CAN_HoldBus(0,true);
+	for (int i = 0;i < CAN_TX_MAILBOX_NUM;i++)
+	{
+		blocker[i] = (Frame_t){ BLOCKER_ID + i,false,false };
+		CHECK(Send(&blocker[i],0));
+	}
+	for (unsigned i = 0;i < sizeof(queued) / sizeof(queued[0]);i++)
+		CHECK(Send(&queued[i],0));
+	SIM_CAN_HoldBus(0,false);
+	// each frame sent frees a mailbox for the best queued one
+	Next(&blocker[0]);
+	for (unsigned i = 0;i < sizeof(order) / sizeof(order[0]);i++)
+		Next(&order[i]);
+	for (int i = 1;i < CAN_TX_MAILBOX_NUM;i++)
+		Next(&blocker[i]);
+	CHECK(CAN_ChangeAddressMode(0,0));
+}
+
+/*!
+ ******************************************************************************
+ *	Interleaved bursts of a few IDs: each ID keeps its order
+ ******************************************************************************
+*/
+static void TestSameIdBurst(void)
+{
+SIM_CAN_Frame_t	frame;
+CANstatistics_t	stats;
+Frame_t				f[BURST_IDS];
+uint8_t				expected[BURST_IDS] = { 0 };
+int					sent = 0;
+
+	CHECK(CAN_ResetStatistics(0));
+	SIM_CAN_ClearTransmitted(0);
+	SIM_CAN_HoldBus(0,true);
+	for (int i = 0;i < BURST_IDS;i++)
+		f[i] = (Frame_t){ 0x181 + 0x100 * i,false,false };
+	for (uint8_t seq = 0;seq < BURST_FRAMES;seq++)
+		for (int i = 0;i < BURST_IDS;i++)
+			CHECK(Send(&f[i],seq));
+	SIM_CAN_HoldBus(0,false);
+	while (SIM_CAN_Transmitted(0,&frame))
+	{
+		int	i = (frame.msg.ID - 0x181) / 0x100;
+
+		CHECK(i >= 0 && i < BURST_IDS);
+		if (frame.msg.payload[0] != expected[i])
+		{
+			printf("0x%X: frame %u sent, %u expected\n",frame.msg.ID,frame.msg.payload[0],expected[i]);
+			host_test_failed++;
+		}
+		expected[i] = frame.msg.payload[0] + 1;
+		sent++;
+	}
+	CHECK_EQ(sent,BURST_IDS * BURST_FRAMES);
+	CHECK(CAN_GetStatistics(0,&stats));
+	CHECK_EQ(stats.TX_Frames,BURST_IDS * BURST_FRAMES);
+	CHECK_EQ(stats.TX_Lost,0);
+}
+
+/*!
+ ******************************************************************************
+ *	One ID: a single mailbox and the queue, the next frame is lost
+ ******************************************************************************
+*/
+static void TestQueueFull(void)
+{
+const Frame_t		f = { 0x222,false,false };
+SIM_CAN_Frame_t	frame;
+CANstatistics_t	stats;
+int					n;
+
+	CHECK(CAN_ResetStatistics(0));
+	SIM_CAN_ClearTransmitted(0);
+	SIM_CAN_HoldBus(0,true);
+	for (n = 0;n < CAN_TX_QUEUE_DEPTH + 1;n++)
+		CHECK(Send(&f,(uint8_t)n));
+	CHECK(!Send(&f,(uint8_t)n));
+	CHECK(CAN_GetStatistics(0,&stats));
+	CHECK_EQ(stats.TX_Lost,1);
+	CHECK_EQ(stats.TX_MaxSize,CAN_TX_QUEUE_DEPTH);
+	SIM_CAN_HoldBus(0,false);
+	for (n = 0;SIM_CAN_Transmitted(0,&frame);n++)
+		CHECK_EQ(frame.msg.payload[0],n);
+	CHECK_EQ(n,CAN_TX_QUEUE_DEPTH + 1);
+}
+
+/*!
+ ******************************************************************************
+ *	Bursts of random IDs which fill the mailboxes and the queue: the time of
+ * CAN_SendMessage with the sorted insert, then of the bursts on the bus with
+ * the refills from the interrupt
+ ******************************************************************************
+*/
+static void Bench(void)
+{
+Frame_t				f[BENCH_FRAMES];
+CANstatistics_t	stats;
+uint64_t				t0,t1,enqueue_ns = 0,total_ns = 0,max_ns = 0;
+
+	CHECK(CAN_ResetStatistics(0));
+	for (int burst = 0;burst < BENCH_BURSTS;burst++)
+	{
+		for (int i = 0;i < BENCH_FRAMES;i++)
+			f[i] = (Frame_t){ Random(0x001,0x7FF),false,false };
+		t0 = HOST_TimeNs();
+		SIM_CAN_HoldBus(0,true);
+		for (int i = 0;i < BENCH_FRAMES;i++)
+		{
+			t1 = HOST_TimeNs();
+			CHECK(Send(&f[i],(uint8_t)i));
+			t1 = HOST_TimeNs() - t1;
+			enqueue_ns += t1;
+			if (t1 > max_ns)
+				max_ns = t1;
+		}
+		SIM_CAN_HoldBus(0,false);
+		total_ns += HOST_TimeNs() - t0;
+		SIM_CAN_ClearTransmitted(0);
+	}
+	CHECK(CAN_GetStatistics(0,&stats));
+	CHECK_EQ(stats.TX_Frames,BENCH_BURSTS * BENCH_FRAMES);
+	CHECK_EQ(stats.TX_Lost,0);
+	printf("%d frames in bursts of %d: enqueue %llu ns (max %llu ns), %.0f frames/s through the driver\n",
+		BENCH_BURSTS * BENCH_FRAMES,BENCH_FRAMES,(unsigned long long)(enqueue_ns / (BENCH_BURSTS * BENCH_FRAMES)),
+		(unsigned long long)max_ns,(double)BENCH_BURSTS * BENCH_FRAMES * 1e9 / (double)total_ns);
+}
+
+int main(void)
+{
+	SIM_RTOS_Reset();
+	SIM_RTOS_SetSchedulerState(taskSCHEDULER_RUNNING);
+	BOARD_InitBootClocks();
+	BOARD_Init();
+	TestArbitration();
+	TestSameIdBurst();
+	TestQueueFull();
+	Bench();
+	return HOST_TEST_RESULT();
+}
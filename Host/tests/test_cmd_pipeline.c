@@ -0,0 +1,304 @@
+/*
+ * test_cmd_pipeline.c
+ *
+ *  Command packet pipeline (user-018): the host keeps several requests in
+ *  flight on the UART and on the USB, Device, Info, System and Measure
+ *  commands interleaved, with binary parameters and corrupted packets. The
+ *  UART bytes arrive in the DMA interrupt, the USB bytes in the USB task, both
+ *  in random pieces. Each interface gets every reply, in the order of its
+ *  requests, and the communication task is notified from the right context.
+ *  A request over the descriptors in flight is dropped. Prints the requests
+ *  per second through framing, queues and handlers
+ */
+
+#include <string.h>
+#include "board.h"
+#include "clock_config.h"
+#include "CommandDefs.h"
+#include "CommandHandler.h"
+#include "CmdPacket.h"
+#include "System.h"
+#include "Misc.h"
+#include "Task_CMSIS2.h"
+#include "uart-ring.h"
+#include "sim_rtos.h"
+#include "sim_comm.h"
+#include "sim_isr.h"
+#include "host_test.h"
+
+#define IN_FLIGHT				(CMD_PACKET_COUNT - 1)		// requests per interface before a dispatch
+#define USB_PACKET_SIZE		64									// bulk OUT max packet size
+#define ROUNDS					20000
+#define KINDS					5
+
+enum { REQ_DEVICE,REQ_INFO,REQ_SYSTEM,REQ_MEASURE,REQ_CORRUPT };
+
+typedef struct
+{
+	uint8_t		data[SIM_COMM_PACKET_SIZE];
+	int			len;
+	bool			nak;							// byte 5 (command type) is not checked
+} Reply_t;
+
+typedef struct
+{
+	uint8_t		stream[IN_FLIGHT * UART_STUFFED_MAX(CMD_PACKET_LEN)];
+	int			len;
+	Reply_t		reply[IN_FLIGHT + 1];
+	int			replies;
+} Channel_t;
+
+extern TaskHandle_t	TaskComm;
+
+static Channel_t		channel[2];
+static uint32_t		seed = 1818;
+static uint32_t		requests[KINDS];
+
+static uint32_t Random(uint32_t lo,uint32_t hi)
+{
+	seed = seed * 1103515245u + 12345u;
+	return lo + (seed >> 8) % (hi - lo + 1);
+}
+
+/*!
+ ******************************************************************************
+ *	A parameter byte, often one which has to be stuffed or a zero
+ ******************************************************************************
+*/
+static uint8_t RandomByte(void)
+{
+const uint8_t		special[] = { UART_SOP,UART_EOP,UART_ESC,0x00 };
+
+	if (Random(0,1))
+		return special[Random(0,3)];
+	return (uint8_t)Random(0,255);
+}
+
+static void Header(Reply_t *r,uint8_t cmd,uint8_t acknak,uint8_t subcmd,uint8_t cmd_rxtx,int len)
+{
+	MakeCommandHeader(r->data,cmd,acknak,subcmd,cmd_rxtx,BOARD_GetOwnAddress());
+	r->len = len;
+	r->nak = acknak == CMD_NAK;
+}
+
+/*!
+ ******************************************************************************
+ *	Appends the frame of a random request to the stream of an interface and
+ * the reply it should get to the expected ones
+ ******************************************************************************
+*/
+static void AddRequest(Channel_t *ch,bool expected)
+{
+uint8_t		packet[16];
+int			len = 6,kind = (int)Random(0,KINDS - 1);
+uint16_t		crc;
+Reply_t		*r = &ch->reply[ch->replies];
+
+	memset(packet,0,sizeof(packet));
+	switch (kind)
+	{
+		case REQ_DEVICE:
+			packet[4] = CMD_DEVICE;
+			packet[5] = SUB_DEVICE_GET_NUMBER_OF_TASKS;
+			Header(r,CMD_DEVICE,CMD_ACK,SUB_DEVICE_GET_NUMBER_OF_TASKS,CMD_RX,7);
+			r->data[6] = (uint8_t)CUC_Task_GetNumberOfTasks();
+			break;
+		case REQ_INFO:
+			packet[4] = CMD_INFO;
+			packet[5] = SUB_INFO_GET_SYSTEM_INFO;
+			Header(r,CMD_INFO,CMD_ACK,SUB_INFO_GET_SYSTEM_INFO,CMD_RX,6 + sizeof(SysInfo_t));
+			memcpy(r->data + 6,GetSystemInfoStructPtr(),sizeof(SysInfo_t));
+			break;
+		case REQ_SYSTEM:
+			packet[4] = CMD_SYSTEM;
+			packet[5] = SUB_SYS_REQUEST_PING;
+			Header(r,CMD_SYSTEM,CMD_ACK,SUB_SYS_REQUEST_PING,CMD_RX,10);
+			for (int i = 0;i < 4;i++)
+			{
+				packet[6 + i] = RandomByte();
+				r->data[6 + i] = packet[6 + i] ^ 0xFF;
+			}
+			len = 10;
+			break;
+		case REQ_MEASURE:
+			packet[4] = CMD_MEASUREMENT;
+			packet[5] = RandomByte();
+			Header(r,CMD_MEASUREMENT,CMD_NAK,packet[5],CMD_NONE,8);
+			SetVal_16(r->data + 6,(uint16_t)CMD_ERR_UNKNOWN_SUBCMD);
+			break;
+		default:
+			packet[4] = CMD_SYSTEM;
+			packet[5] = SUB_SYS_REQUEST_PING;
+			len = 10;
+			Header(r,CMD_NO_CMD,CMD_NAK,CMD_NO_SUB,CMD_NONE,8);
+			SetVal_16(r->data + 6,(uint16_t)CMD_ERR_INVALID_PACKET);
+			break;
+	}
+	crc = CRC16_Update(0,packet,len);
+	if (kind == REQ_CORRUPT)
+		crc ^= 1U << Random(0,15);
+	ch->len += UART_StuffFrame(ch->stream + ch->len,sizeof(ch->stream) - ch->len,packet,len,crc);
+	if (expected)
+	{
+		ch->replies++;
+		requests[kind]++;
+	}
+}
+
+/*!
+ ******************************************************************************
+ *	Delivers the streams of both interfaces in random pieces, interleaved: the
+ * UART in the DMA interrupt, the USB in the USB task with bulk OUT packets
+ ******************************************************************************
+*/
+static void Deliver(void)
+{
+int			pos[2] = { 0,0 },n;
+uint32_t		prev;
+
+	while (pos[SIM_COMM_UART] < channel[SIM_COMM_UART].len || pos[SIM_COMM_USB] < channel[SIM_COMM_USB].len)
+	{
+		n = (int)Random(1,40);
+		if (n > channel[SIM_COMM_UART].len - pos[SIM_COMM_UART])
+			n = channel[SIM_COMM_UART].len - pos[SIM_COMM_UART];
+		if (n > 0)
+		{
+			prev = SIM_ISR_Enter(DMA6_IRQn);
+			UART_CmdIF_HandleRx(channel[SIM_COMM_UART].stream + pos[SIM_COMM_UART],n);
+			SIM_ISR_Exit(prev);
+			pos[SIM_COMM_UART] += n;
+		}
+		n = (int)Random(1,USB_PACKET_SIZE);
+		if (n > channel[SIM_COMM_USB].len - pos[SIM_COMM_USB])
+			n = channel[SIM_COMM_USB].len - pos[SIM_COMM_USB];
+		if (n > 0)
+		{
+			UART_CmdIF_HandleUSB(channel[SIM_COMM_USB].stream + pos[SIM_COMM_USB],n);
+			pos[SIM_COMM_USB] += n;
+		}
+	}
+}
+
+/*!
+ ******************************************************************************
+ *	Takes the replies of an interface, they must be the expected ones in order
+ ******************************************************************************
+*/
+static bool CheckReplies(int c)
+{
+uint8_t		reply[SIM_COMM_PACKET_SIZE];
+Reply_t		*r;
+int			len;
+
+	for (int i = 0;i < channel[c].replies;i++)
+	{
+		r = &channel[c].reply[i];
+		len = SIM_Comm_Sent(c,reply,sizeof(reply));
+		if (len != r->len || memcmp(reply,r->data,5) != 0 ||
+			(!r->nak && reply[5] != r->data[5]) || memcmp(reply + 6,r->data + 6,len - 6) != 0)
+		{
+			printf("%s reply %d: command %u/%u %s, length %d, %u/%u %s, length %d expected\n",
+				c == SIM_COMM_UART ? "UART" : "USB",i,reply[2],reply[4],reply[3] == CMD_NAK ? "NAK" : "ACK",len,
+				r->data[2],r->data[4],r->nak ? "NAK" : "ACK",r->len);
+			host_test_failed++;
+			return false;
+		}
+	}
+	if (SIM_Comm_Sent(c,reply,sizeof(reply)) >= 0)
+	{
+		printf("%s: reply without request\n",c == SIM_COMM_UART ? "UART" : "USB");
+		host_test_failed++;
+		return false;
+	}
+	return true;
+}
+
+/*!
+ ******************************************************************************
+ *	One round: up to IN_FLIGHT requests on each interface, then the dispatch
+ * of the communication task
+ ******************************************************************************
+*/
+static bool Round(int in_flight)
+{
+uint32_t		bits = 0;
+
+	for (int c = 0;c < 2;c++)
+	{
+		channel[c].len = 0;
+		channel[c].replies = 0;
+		for (int n = (int)Random(0,in_flight);n > 0;n--)
+			AddRequest(&channel[c],true);
+	}
+	Deliver();
+	// the receivers notified the task, each with its own bit
+	xTaskNotifyWait(0,0xFFFFFFFFu,&bits,0);
+	if (bits != ((channel[SIM_COMM_UART].replies ? 1U << 0 : 0) | (channel[SIM_COMM_USB].replies ? 1U << 1 : 0)))
+	{
+		printf("notification 0x%X\n",bits);
+		host_test_failed++;
+		return false;
+	}
+	CommandHandler();
+	return CheckReplies(SIM_COMM_UART) && CheckReplies(SIM_COMM_USB);
+}
+
+/*!
+ ******************************************************************************
+ *	A request over the descriptors in flight is dropped, the others answered
+ ******************************************************************************
+*/
+static void TestOverflow(void)
+{
+	for (int c = 0;c < 2;c++)
+	{
+		channel[c].len = 0;
+		channel[c].replies = 0;
+	}
+	for (int i = 0;i < IN_FLIGHT;i++)
+		AddRequest(&channel[SIM_COMM_UART],true);
+	AddRequest(&channel[SIM_COMM_UART],false);
+	Deliver();
+	CommandHandler();
+	CheckReplies(SIM_COMM_UART);
+	// the queue is free again
+	CHECK(Round(IN_FLIGHT));
+}
+
+static void Dummy(void *arg)
+{
+	(void)arg;
+}
+
+int main(void)
+{
+uint64_t		t0;
+uint32_t		total = 0;
+int			round;
+
+	SIM_RTOS_Reset();
+	SIM_RTOS_SetSchedulerState(taskSCHEDULER_RUNNING);
+	BOARD_InitBootClocks();
+	BOARD_Init();
+	CHECK(xTaskCreate(Dummy,"COMM",256,NULL,2,&TaskComm) == pdPASS);
+	SIM_RTOS_SetCurrentTask(TaskComm);
+	CHECK(InitCommandHandler());
+	SIM_Comm_Clear();
+
+	t0 = HOST_TimeNs();
+	for (round = 0;round < ROUNDS && Round(IN_FLIGHT);round++)
+	{
+	}
+	t0 = HOST_TimeNs() - t0;
+	CHECK_EQ(round,ROUNDS);
+	for (int kind = 0;kind < KINDS;kind++)
+	{
+		CHECK(requests[kind] > 0);
+		total += requests[kind];
+	}
+	TestOverflow();
+	printf("%u requests (%u device, %u info, %u system, %u measure, %u corrupted): %.0f requests/s\n",total,
+		requests[REQ_DEVICE],requests[REQ_INFO],requests[REQ_SYSTEM],requests[REQ_MEASURE],requests[REQ_CORRUPT],
+		(double)total * 1e9 / (double)t0);
+	return HOST_TEST_RESULT();
+}
@@ -0,0 +1,107 @@
+/*
+ * test_cmd_table.c
+ *
+ *  Descriptor table of the system subcommands (user-020): every entry is
+ *  dispatched with all parameter lengths, the lengths outside of its min and
+ *  max are rejected before the handler, the lengths inside reach it. The
+ *  subcommands which are not in the table are unknown. Prints the cost of
+ *  the lookup and length check on the host
+ */
+
+#include <string.h>
+#include "board.h"
+#include "clock_config.h"
+#include "CommandDefs.h"
+#include "CmdSystem.h"
+#include "CmdPacket.h"
+#include "sim_rtos.h"
+#include "sim_comm.h"
+#include "host_test.h"
+
+#define MAX_PARAMETERS		(CMD_PACKET_LEN - 2 - 5 - 1)		// CRC, command header, subcommand
+#define BENCH_LOOPS			1000000
+
+static volatile int		sink;
+
+/*!
+ ******************************************************************************
+ *	Dispatches a subcommand with len parameter bytes of 0
+ ******************************************************************************
+*/
+static int Dispatch(uint8_t subcmd,int len)
+{
+uint8_t		command[1 + MAX_PARAMETERS];
+
+	memset(command,0,sizeof(command));
+	command[0] = subcmd;
+	return SystemCommandHandler(0,command,1 + len);
+}
+
+static void CheckEntry(const CMD_Desc_t *desc)
+{
+int		ret;
+
+	CHECK(desc->max_len != CMD_LEN_ANY);
+	CHECK(desc->max_len <= MAX_PARAMETERS);
+	for (int len = 0;len <= MAX_PARAMETERS;len++)
+	{
+		ret = Dispatch(desc->subcmd,len);
+		if (len < desc->min_len || len > desc->max_len)
+		{
+			if (ret != CMD_ERR_INVALID_LENGTH)
+			{
+				printf("subcommand 0x%02X: %d bytes not rejected (%d)\n",desc->subcmd,len,ret);
+				host_test_failed++;
+			}
+		}
+		else if (ret == CMD_ERR_INVALID_LENGTH || ret == CMD_ERR_UNKNOWN_SUBCMD)
+		{
+			printf("subcommand 0x%02X: %d bytes rejected (%d)\n",desc->subcmd,len,ret);
+			host_test_failed++;
+		}
+		SIM_Comm_Clear();
+	}
+}
+
+int main(void)
+{
+const CMD_Desc_t	*table;
+uint8_t				command[1 + MAX_PARAMETERS + 1];
+int					count,known = 0;
+uint64_t				t0;
+
+	SIM_RTOS_Reset();
+	SIM_RTOS_SetSchedulerState(taskSCHEDULER_RUNNING);
+	BOARD_InitBootClocks();
+	BOARD_Init();
+	CHECK(InitSystemCommandHandler());
+	table = GetSystemCommandTable(&count);
+	CHECK(CMD_TableValid(table,count));
+
+	for (int i = 0;i < count;i++)
+		CheckEntry(&table[i]);
+	for (int subcmd = 0;subcmd < 256;subcmd++)
+	{
+		if (CMD_FindDesc(table,count,(uint8_t)subcmd) != NULL)
+		{
+			known++;
+			continue;
+		}
+		CHECK_EQ(Dispatch((uint8_t)subcmd,0),CMD_ERR_UNKNOWN_SUBCMD);
+	}
+	CHECK_EQ(known,count);
+
+	// lookup and length check: the lengths are rejected, no handler runs
+	memset(command,0,sizeof(command));
+	t0 = HOST_TimeNs();
+	for (int i = 0;i < BENCH_LOOPS;i++)
+	{
+		const CMD_Desc_t	*desc = &table[(i * 7) % count];
+
+		command[0] = desc->subcmd;
+		sink = SystemCommandHandler(0,command,desc->max_len + 2);
+	}
+	t0 = HOST_TimeNs() - t0;
+	printf("%d subcommands, dispatch of a rejected length %.1f ns\n",count,(double)t0 / BENCH_LOOPS);
+	return HOST_TEST_RESULT();
+}
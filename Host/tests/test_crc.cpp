@@ -0,0 +1,299 @@
+/*
+ * test_crc.cpp
+ *
+ *  CRC_Calc16 of crc.c (user-017) on a model of the CRC peripheral. crc.c is
+ *  compiled here with CRC0 pointing to register objects: a write of DATA,
+ *  DATAL or DATALL shifts its bytes (most significant first) bit by bit
+ *  through the polynomial of GPOLY, or sets the seed with CTRL[WAS]. The
+ *  word-wide feed (head bytes up to the alignment, __REV words, tail bytes)
+ *  gives the CRC of the table of crc16.c for random lengths, alignments and
+ *  seeds. An interrupt at any write of the peripheral which computes a CRC
+ *  itself gets it from the table without touching the peripheral, both
+ *  results are correct. Prints the register writes per KiB and the time of
+ *  the table
+ */
+
+#include <string.h>
+#include "fsl_device_registers.h"
+#include "fsl_common.h"
+#include "crc16.h"
+#include "host_test.h"
+
+#define BUFFER_SIZE			4096
+#define RANDOM_CALLS			20000
+#define BUSY_CALLS			2000
+#define BENCH_LEN				1024
+#define BENCH_CALLS			20000
+#define CRC_TEST_IRQn		LPTMR0_IRQn
+
+enum { CRC_REG_DATA,CRC_REG_DATAL,CRC_REG_DATALL,CRC_REG_GPOLY,CRC_REG_CTRL };
+
+typedef struct
+{
+	uint32_t		ctrl;
+	uint16_t		gpoly;
+	uint16_t		crc;
+	uint32_t		seeds;						// writes with CTRL[WAS]
+	uint32_t		word_writes;
+	uint32_t		byte_writes;
+	uint32_t		other_writes;				// 16 bit data writes, not used by crc.c
+	uint32_t		bad_config;					// transpose, complement or 32 bit CRC
+	uint32_t		irq_at;						// data write which raises the interrupt, 0 if none
+} SIM_CRC_t;
+
+static SIM_CRC_t		sim_crc_state;
+
+static void SIM_CRC_Shift(uint8_t ch)
+{
+	for (int bit = 7;bit >= 0;bit--)
+	{
+		bool	feedback = ((sim_crc_state.crc >> 15) ^ (ch >> bit)) & 1;
+
+		sim_crc_state.crc = (uint16_t)(sim_crc_state.crc << 1);
+		if (feedback)
+			sim_crc_state.crc ^= sim_crc_state.gpoly;
+	}
+}
+
+static void SIM_CRC_Irq(void);
+
+static void SIM_CRC_Write(int reg,uint32_t value,int bytes)
+{
+	switch (reg)
+	{
+		case CRC_REG_CTRL:
+			sim_crc_state.ctrl = value;
+			if (value & (CRC_CTRL_TOT_MASK | CRC_CTRL_TOTR_MASK | CRC_CTRL_FXOR_MASK | CRC_CTRL_TCRC_MASK))
+				sim_crc_state.bad_config++;
+			return;
+		case CRC_REG_GPOLY:
+			sim_crc_state.gpoly = (uint16_t)value;
+			return;
+		default:
+			break;
+	}
+	if (sim_crc_state.ctrl & CRC_CTRL_WAS_MASK)
+	{
+		sim_crc_state.crc = (uint16_t)value;
+		sim_crc_state.seeds++;
+	}
+	else
+	{
+		for (int i = bytes - 1;i >= 0;i--)
+			SIM_CRC_Shift((uint8_t)(value >> (8 * i)));
+		if (bytes == 4)
+			sim_crc_state.word_writes++;
+		else if (bytes == 1)
+			sim_crc_state.byte_writes++;
+		else
+			sim_crc_state.other_writes++;
+	}
+	if (sim_crc_state.irq_at != 0 && --sim_crc_state.irq_at == 0)
+		SIM_NVIC_Raise(CRC_TEST_IRQn,SIM_CRC_Irq);
+}
+
+static uint32_t SIM_CRC_Read(int reg)
+{
+	switch (reg)
+	{
+		case CRC_REG_CTRL:
+			return sim_crc_state.ctrl;
+		case CRC_REG_GPOLY:
+			return sim_crc_state.gpoly;
+		default:
+			return sim_crc_state.crc;
+	}
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Register of the CRC model, accessed as the register of the same name
+// ----------------------------------------------------------------------------
+template<int REG, class T>
+struct SIM_CRC_Reg
+{
+	SIM_CRC_Reg &operator=(T value)
+	{
+		SIM_CRC_Write(REG,value,sizeof(T));
+		return *this;
+	}
+	operator T() const
+	{
+		return (T)SIM_CRC_Read(REG);
+	}
+};
+
+// ----------------------------------------------------------------------------
+//! \brief The registers of CRC_Type used by crc.c
+// ----------------------------------------------------------------------------
+struct SIM_CRC_Regs
+{
+	SIM_CRC_Reg<CRC_REG_DATA, uint32_t>			DATA;
+	struct
+	{
+		SIM_CRC_Reg<CRC_REG_DATAL, uint16_t>	DATAL;
+	} ACCESS16BIT;
+	struct
+	{
+		SIM_CRC_Reg<CRC_REG_DATALL, uint8_t>	DATALL;
+	} ACCESS8BIT;
+	SIM_CRC_Reg<CRC_REG_GPOLY, uint32_t>		GPOLY;
+	SIM_CRC_Reg<CRC_REG_CTRL, uint32_t>			CTRL;
+};
+
+static SIM_CRC_Regs		sim_crc;
+
+#undef CRC0
+#define CRC0					(&sim_crc)
+
+#include "crc.c"
+
+static uint8_t			buffer[BUFFER_SIZE + 8];
+static uint32_t		seed = 1717;
+static const uint8_t	*irq_msg;
+static uint32_t		irq_len;
+static uint16_t		irq_crc;
+static uint32_t		irq_writes;
+static int				irq_calls;
+
+static uint32_t Random(uint32_t lo,uint32_t hi)
+{
+	seed = seed * 1103515245u + 12345u;
+	return lo + (seed >> 8) % (hi - lo + 1);
+}
+
+/*!
+ ******************************************************************************
+ *	An interrupt while the peripheral computes a CRC: its own CRC has to come
+ * from the table, the peripheral must not be written
+ ******************************************************************************
+*/
+static void SIM_CRC_Irq(void)
+{
+uint32_t		writes = sim_crc_state.seeds + sim_crc_state.word_writes + sim_crc_state.byte_writes;
+
+	irq_crc = CRC_Calc16(0x1D0F,irq_msg,irq_len);
+	irq_writes = sim_crc_state.seeds + sim_crc_state.word_writes + sim_crc_state.byte_writes - writes;
+	irq_calls++;
+}
+
+/*!
+ ******************************************************************************
+ *	Random lengths (mostly short), alignments and seeds: the CRC of the table,
+ * the peripheral is fed with the head bytes up to the word alignment, whole
+ * words and the tail bytes
+ ******************************************************************************
+*/
+static void TestRandom(void)
+{
+uint32_t		len,offset,head,words,bytes,seeds,peripheral = 0;
+uint16_t		crc_seed,crc;
+
+	for (int i = 0;i < RANDOM_CALLS;i++)
+	{
+		offset = Random(0,7);
+		len = Random(0,3) ? Random(0,64) : Random(0,BUFFER_SIZE);
+		crc_seed = Random(0,1) ? 0 : (uint16_t)Random(0,0xFFFF);
+		words = sim_crc_state.word_writes;
+		bytes = sim_crc_state.byte_writes;
+		seeds = sim_crc_state.seeds;
+		crc = CRC_Calc16(crc_seed,buffer + offset,len);
+		if (crc != CRC16_Update(crc_seed,buffer + offset,len))
+		{
+			printf("%u bytes at offset %u, seed 0x%04X: 0x%04X, 0x%04X expected\n",len,offset,crc_seed,crc,
+				CRC16_Update(crc_seed,buffer + offset,len));
+			host_test_failed++;
+			return;
+		}
+		if (len < CRC_HW_MIN_LEN)
+		{
+			CHECK_EQ(sim_crc_state.seeds - seeds + sim_crc_state.word_writes - words + sim_crc_state.byte_writes - bytes,0);
+			continue;
+		}
+		head = (4 - ((uintptr_t)(buffer + offset) & 3)) & 3;
+		CHECK_EQ(sim_crc_state.seeds - seeds,1);
+		CHECK_EQ(sim_crc_state.word_writes - words,(len - head) / 4);
+		CHECK_EQ(sim_crc_state.byte_writes - bytes,head + (len - head) % 4);
+		peripheral++;
+	}
+	CHECK(peripheral > RANDOM_CALLS / 8);
+	CHECK_EQ(sim_crc_state.other_writes,0);
+	CHECK_EQ(sim_crc_state.bad_config,0);
+}
+
+/*!
+ ******************************************************************************
+ *	An interrupt at a random write of the peripheral computes another CRC
+ ******************************************************************************
+*/
+static void TestBusy(void)
+{
+uint32_t		len,writes;
+uint16_t		crc;
+const uint8_t	*msg;
+
+	NVIC_SetPriority(CRC_TEST_IRQn,5);
+	NVIC_EnableIRQ(CRC_TEST_IRQn);
+	for (int i = 0;i < BUSY_CALLS;i++)
+	{
+		msg = buffer + Random(0,7);
+		len = Random(CRC_HW_MIN_LEN,256);
+		irq_msg = buffer + Random(0,7);
+		irq_len = Random(CRC_HW_MIN_LEN,256);
+		irq_writes = 0;
+		irq_calls = 0;
+		// seed, head bytes, words and tail bytes
+		writes = 1 + len / 4 + 6;
+		sim_crc_state.irq_at = Random(1,writes);
+		crc = CRC_Calc16(0,msg,len);
+		if (sim_crc_state.irq_at != 0)
+		{
+			// after the last write: the peripheral is free again
+			sim_crc_state.irq_at = 0;
+			SIM_NVIC_Raise(CRC_TEST_IRQn,SIM_CRC_Irq);
+			CHECK(irq_writes > 0);
+		}
+		else
+			CHECK_EQ(irq_writes,0);
+		CHECK_EQ(irq_calls,1);
+		CHECK_EQ(crc,CRC16_Update(0,msg,len));
+		CHECK_EQ(irq_crc,CRC16_Update(0x1D0F,irq_msg,irq_len));
+		if (host_test_failed)
+			return;
+	}
+	NVIC_DisableIRQ(CRC_TEST_IRQn);
+}
+
+/*!
+ ******************************************************************************
+ *	Register writes of a KiB through the peripheral and host time of the table
+ ******************************************************************************
+*/
+static void Bench(void)
+{
+uint32_t		writes;
+uint64_t		t0;
+uint16_t		crc = 0;
+
+	writes = sim_crc_state.seeds + sim_crc_state.word_writes + sim_crc_state.byte_writes;
+	crc = CRC_Calc16(crc,buffer + 1,BENCH_LEN);
+	writes = sim_crc_state.seeds + sim_crc_state.word_writes + sim_crc_state.byte_writes - writes;
+	CHECK(writes <= BENCH_LEN / 4 + 1 + 3);
+	t0 = HOST_TimeNs();
+	for (int i = 0;i < BENCH_CALLS;i++)
+		crc = CRC16_Update(crc,buffer + (i & 7),BENCH_LEN);
+	t0 = HOST_TimeNs() - t0;
+	printf("%d bytes: %u peripheral writes (%d byte by byte), table %.2f ns/byte on the host (0x%04X)\n",BENCH_LEN,
+		writes,BENCH_LEN + 1,(double)t0 / ((double)BENCH_CALLS * BENCH_LEN),crc);
+}
+
+int main(void)
+{
+	for (int i = 0;i < BUFFER_SIZE + 8;i++)
+		buffer[i] = (uint8_t)Random(0,255);
+	CRC_init();
+	CHECK_EQ(sim_crc_state.gpoly,CRC16_CCITT_POLY);
+	TestRandom();
+	TestBusy();
+	Bench();
+	return HOST_TEST_RESULT();
+}
@@ -0,0 +1,295 @@
+/*
+ * test_eeprom_journal.c
+ *
+ *  Parameter journal (user-022) on a RAM port which cuts the power: the
+ *  write being done when it is cut stores a prefix and garbage behind it.
+ *  After each reload every position holds the last completed value or the
+ *  value of the interrupted update, the writes are spread over the ring and
+ *  the load reads only the search and the window. Through EEPROMhandler on
+ *  the simulated EEPROM an image of the former layout is reset once, the
+ *  magic word and the version structure are kept
+ */
+
+#include <string.h>
+#include "board.h"
+#include "clock_config.h"
+#include "EEPROM.h"
+#include "EEPROMhandler.h"
+#include "EEPROMjournal.h"
+#include "sim_rtos.h"
+#include "sim_i2c.h"
+#include "host_test.h"
+
+#define BASE					EEPROM_PARAM_START_ADDR
+#define SLOT_SIZE				EEPROM_JOURNAL_SLOT_SIZE
+#define SLOTS					EEPROM_JOURNAL_SLOTS
+#define MEM_SIZE				(BASE + SLOT_SIZE * SLOTS)
+#define POWER_CUTS			3000
+#define MAX_COUNT				20
+#define WEAR_UPDATES			(50 * SLOTS)
+
+typedef struct
+{
+	uint8_t		mem[MEM_SIZE];
+	uint32_t		slot_writes[SLOTS];
+	long			budget;					// bytes until the power cut, < 0 if none
+	bool			cut;
+} RamPort_t;
+
+typedef struct
+{
+	unsigned		count;
+	uint8_t		data[EEJ_MAX_POSITIONS][EEJ_DATA_SIZE];
+} State_t;
+
+static RamPort_t		ram;
+static uint32_t		seed = 4711;
+
+static uint32_t Random(uint32_t lo,uint32_t hi)
+{
+	seed = seed * 1103515245u + 12345u;
+	return lo + (seed >> 8) % (hi - lo + 1);
+}
+
+static bool RamRead(void *ctx,uint32_t address,uint8_t *data,uint32_t len)
+{
+RamPort_t	*port = ctx;
+
+	if (port->cut || address + len > MEM_SIZE)
+		return false;
+	memcpy(data,&port->mem[address],len);
+	return true;
+}
+
+/*!
+ ******************************************************************************
+ *	Writes until the budget is used up, the rest of the write is garbage
+ ******************************************************************************
+*/
+static bool RamWrite(void *ctx,uint32_t address,const uint8_t *data,uint32_t len)
+{
+RamPort_t	*port = ctx;
+uint32_t		done,garbage;
+
+	if (port->cut || address + len > MEM_SIZE)
+		return false;
+	if (address >= BASE)
+		port->slot_writes[(address - BASE) / SLOT_SIZE]++;
+	if (port->budget < 0 || (long)len <= port->budget)
+	{
+		memcpy(&port->mem[address],data,len);
+		if (port->budget >= 0)
+			port->budget -= len;
+		return true;
+	}
+	done = (uint32_t)port->budget;
+	memcpy(&port->mem[address],data,done);
+	garbage = Random(0,len - done);
+	for (uint32_t i = 0;i < garbage;i++)
+		port->mem[address + done + i] = (uint8_t)Random(0,255);
+	port->cut = true;
+	return false;
+}
+
+static void Attach(EEJ_Journal_t *j)
+{
+const EEJ_Port_t	port = { RamRead,RamWrite,&ram };
+
+	CHECK(EEJ_Init(j,&port,BASE,SLOT_SIZE,SLOTS));
+}
+
+static void Snapshot(const EEJ_Journal_t *j,State_t *state)
+{
+	memset(state,0,sizeof(*state));
+	state->count = EEJ_Count(j);
+	for (unsigned pos = 0;pos < state->count;pos++)
+		CHECK(EEJ_Read(j,pos,state->data[pos]));
+}
+
+static bool Equal(const State_t *a,const State_t *b)
+{
+	if (a->count != b->count)
+		return false;
+	for (unsigned pos = 0;pos < a->count;pos++)
+		if (memcmp(a->data[pos],b->data[pos],EEJ_DATA_SIZE) != 0)
+			return false;
+	return true;
+}
+
+/*!
+ ******************************************************************************
+ *	Random updates until the power is cut, then a reload: the journal holds
+ * the state before the interrupted update or after it
+ ******************************************************************************
+*/
+static void TestPowerCuts(void)
+{
+EEJ_Journal_t	j;
+State_t			committed,pending,loaded;
+uint8_t			data[EEJ_DATA_SIZE];
+int				torn = 0,applied = 0;
+
+	memset(&ram,0,sizeof(ram));
+	ram.budget = -1;
+	Attach(&j);
+	CHECK(EEJ_Format(&j));
+	Snapshot(&j,&committed);
+	for (int cut = 0;cut < POWER_CUTS;cut++)
+	{
+		ram.cut = false;
+		ram.budget = (long)Random(0,40 * SLOT_SIZE);
+		Attach(&j);
+		CHECK(EEJ_Load(&j));
+		for (;;)
+		{
+			pending = committed;
+			if (committed.count > 0 && Random(0,200) == 0)
+			{
+				pending.count = 0;
+				if (!EEJ_Clear(&j))
+					break;
+			}
+			else
+			{
+				unsigned		pos = Random(0,committed.count < MAX_COUNT ? committed.count : MAX_COUNT - 1);
+
+				for (unsigned i = 0;i < EEJ_DATA_SIZE;i++)
+					data[i] = (uint8_t)Random(0,255);
+				memcpy(pending.data[pos],data,EEJ_DATA_SIZE);
+				if (pos == pending.count)
+					pending.count++;
+				if (!EEJ_Write(&j,pos,data))
+					break;
+			}
+			committed = pending;
+		}
+		CHECK(ram.cut);
+		// power on
+		ram.cut = false;
+		ram.budget = -1;
+		Attach(&j);
+		CHECK(EEJ_Load(&j));
+		Snapshot(&j,&loaded);
+		if (Equal(&loaded,&committed))
+			torn++;
+		else if (Equal(&loaded,&pending))
+			applied++;
+		else
+		{
+			printf("power cut %d: %u positions, neither %u before nor %u after the update\n",
+				cut,loaded.count,committed.count,pending.count);
+			host_test_failed++;
+			return;
+		}
+		committed = loaded;
+	}
+	printf("%d power cuts: %d updates lost, %d kept\n",POWER_CUTS,torn,applied);
+	CHECK(torn > 0 && applied > 0);
+}
+
+/*!
+ ******************************************************************************
+ *	One position updated again and again: each slot is written as often as
+ * the others, a load reads the binary search and the window only
+ ******************************************************************************
+*/
+static void TestWear(void)
+{
+EEJ_Journal_t	j;
+uint8_t			data[EEJ_DATA_SIZE];
+uint32_t			lo = UINT32_MAX,hi = 0,max_reads;
+unsigned			count = 16;
+
+	memset(&ram,0,sizeof(ram));
+	ram.budget = -1;
+	Attach(&j);
+	CHECK(EEJ_Format(&j));
+	memset(ram.slot_writes,0,sizeof(ram.slot_writes));
+	for (unsigned pos = 0;pos < count;pos++)
+	{
+		memset(data,pos,sizeof(data));
+		CHECK(EEJ_Write(&j,pos,data));
+	}
+	for (uint32_t i = 0;i < WEAR_UPDATES;i++)
+	{
+		memcpy(data,&i,sizeof(i));
+		CHECK(EEJ_Write(&j,3,data));
+	}
+	for (unsigned slot = 0;slot < SLOTS;slot++)
+	{
+		if (ram.slot_writes[slot] < lo)
+			lo = ram.slot_writes[slot];
+		if (ram.slot_writes[slot] > hi)
+			hi = ram.slot_writes[slot];
+	}
+	CHECK(hi - lo <= 1);
+	Attach(&j);
+	CHECK(EEJ_Load(&j));
+	CHECK_EQ(EEJ_Count(&j),count);
+	CHECK(EEJ_Read(&j,3,data));
+	CHECK_EQ(*(uint32_t *)data,WEAR_UPDATES - 1);
+	// two first slots, the search over the ring, the window
+	max_reads = 2 + 9 + 1 + 2 * count + EEJ_SPARE;
+	CHECK(j.reads <= max_reads);
+	printf("%u updates: %u to %u writes per slot, load %u reads\n",WEAR_UPDATES + count,lo,hi,j.reads);
+}
+
+/*!
+ ******************************************************************************
+ *	EEPROMhandler on an image of the former layout: count and structures 4
+ * bytes apart from EEPROM_PARAM_START_ADDR on
+ ******************************************************************************
+*/
+static void TestFormerLayout(void)
+{
+SIM_I2C_Slave_t			*eeprom = SIM_I2C_Slave(EERPROM_I2C_ADDRESS);
+EEPROM_UParamEntry_t		param,rd;
+uint32_t						word = EEPROM_MAGIC_WORD,count = 3,layout;
+uint8_t						version[sizeof(EEPROM_VersionEntry_t)];
+
+	memcpy(eeprom->mem + EEPROM_MAGIC_WORD_ADDR,&word,sizeof(word));
+	for (unsigned i = 0;i < sizeof(version);i++)
+		version[i] = (uint8_t)(0x40 + i);
+	memcpy(eeprom->mem + EEPROM_VERSION_STR_ADDR,version,sizeof(version));
+	memcpy(eeprom->mem + EEPROM_LAYOUT_ADDR,&count,sizeof(count));
+	for (unsigned i = 0;i < count;i++)
+	{
+		CHECK(EEPROM_MakeParameterStruct(&param,(uint16_t)i,1,0x1111 * i,"old"));
+		memcpy(eeprom->mem + EEPROM_PARAM_START_ADDR + 4 * i,param.ByteVect,sizeof(param.ByteVect));
+	}
+
+	CHECK(EEPROM_InitParamJournal());
+	CHECK_EQ(EEPROM_ReadParamStructCount(),0);
+	memcpy(&layout,eeprom->mem + EEPROM_LAYOUT_ADDR,sizeof(layout));
+	CHECK_EQ(layout,EEPROM_LAYOUT);
+	CHECK(EEPROM_CheckMagicWord());
+	CHECK(memcmp(eeprom->mem + EEPROM_VERSION_STR_ADDR,version,sizeof(version)) == 0);
+
+	for (unsigned i = 0;i < 5;i++)
+	{
+		CHECK(EEPROM_MakeParameterStruct(&param,(uint16_t)i,2,0x2222 * i,"new"));
+		CHECK_EQ(EEPROM_WriteNextParamStruct(&param),i + 1);
+	}
+	CHECK(EEPROM_MakeParameterStruct(&param,7,2,0x7777,"pos2"));
+	CHECK(EEPROM_WriteParamStructAtPos(2,&param));
+	CHECK(EEPROM_ReadParamStructAtPos(2,&rd));
+	CHECK(memcmp(&rd,&param,sizeof(param)) == 0);
+	CHECK(!EEPROM_ReadParamStructAtPos(5,&rd));
+	CHECK_EQ(EEPROM_ReadParamStructCount(),5);
+	CHECK(EEPROM_ClearParamStructCount());
+	CHECK_EQ(EEPROM_ReadParamStructCount(),0);
+	CHECK(EEPROM_InitializeEEPROM());
+	CHECK_EQ(EEPROM_ReadParamStructCount(),0);
+}
+
+int main(void)
+{
+	SIM_RTOS_Reset();
+	SIM_RTOS_SetSchedulerState(taskSCHEDULER_RUNNING);
+	BOARD_InitBootClocks();
+	BOARD_Init();
+	TestPowerCuts();
+	TestWear();
+	TestFormerLayout();
+	return HOST_TEST_RESULT();
+}
@@ -0,0 +1,337 @@
+/*
+ * test_event_recorder.c
+ *
+ *  Event recorder (user-023). On a RAM port: the ring wraps around and keeps
+ *  the last records in order, a power cut tears the write being done (a
+ *  prefix and garbage behind it) and the reloaded ring holds every event of
+ *  the completed flushes, in order and without gaps. Through FRAM.c on the
+ *  simulated FRAM: 1000 events per second are written without a loss and
+ *  the bus could take 2000 (400 kHz, about 16 bytes per event), the ring is
+ *  recovered after a reset, a failing FRAM is left alone for the back-off
+ *  time. Prints the bus time of the events
+ */
+
+#include <string.h>
+#include "board.h"
+#include "clock_config.h"
+#include "FRAM.h"
+#include "EventRec.h"
+#include "sim_rtos.h"
+#include "sim_clock.h"
+#include "sim_i2c.h"
+#include "host_test.h"
+
+#define RING_RECORDS			100
+#define MEM_SIZE				2048
+#define POWER_CUTS			3000
+#define RATE_EVENTS_MS		1					// events per ms
+#define RATE_MAX_BUS_NS		500000			// bus time per event: 2000 events per second
+#define RATE_FLUSH_MS		10					// period of the flushes
+#define RATE_MS				10000
+
+typedef struct
+{
+	uint8_t		mem[MEM_SIZE];
+	long			budget;					// bytes until the power cut, < 0 if none
+	bool			cut;
+} RamPort_t;
+
+static RamPort_t		ram;
+static uint32_t		seed = 8191;
+
+static uint32_t Random(uint32_t lo,uint32_t hi)
+{
+	seed = seed * 1103515245u + 12345u;
+	return lo + (seed >> 8) % (hi - lo + 1);
+}
+
+static bool RamRead(void *ctx,uint32_t address,uint8_t *data,uint32_t len)
+{
+RamPort_t	*port = ctx;
+
+	if (port->cut || address + len > MEM_SIZE)
+		return false;
+	memcpy(data,&port->mem[address],len);
+	return true;
+}
+
+/*!
+ ******************************************************************************
+ *	Writes until the budget is used up, the rest of the write is garbage
+ ******************************************************************************
+*/
+static bool RamWrite(void *ctx,uint32_t address,const uint8_t *data,uint32_t len)
+{
+RamPort_t	*port = ctx;
+uint32_t		done,garbage;
+
+	if (port->cut || address + len > MEM_SIZE)
+		return false;
+	if (port->budget < 0 || (long)len <= port->budget)
+	{
+		memcpy(&port->mem[address],data,len);
+		if (port->budget >= 0)
+			port->budget -= len;
+		return true;
+	}
+	done = (uint32_t)port->budget;
+	memcpy(&port->mem[address],data,done);
+	garbage = Random(0,len - done);
+	for (uint32_t i = 0;i < garbage;i++)
+		port->mem[address + done + i] = (uint8_t)Random(0,255);
+	port->cut = true;
+	return false;
+}
+
+static uint32_t RamLock(void *ctx)
+{
+	(void)ctx;
+	return 0;
+}
+
+static void RamUnlock(void *ctx,uint32_t state)
+{
+	(void)ctx;
+	(void)state;
+}
+
+static void Attach(EVR_Recorder_t *r)
+{
+const EVR_Port_t	port = { RamRead,RamWrite,RamLock,RamUnlock,&ram };
+
+	CHECK(EVR_Init(r,&port,0,RING_RECORDS));
+	CHECK(EVR_Size(RING_RECORDS) <= MEM_SIZE);
+}
+
+/*!
+ ******************************************************************************
+ *	Reads the whole ring: consecutive sequence numbers up to the newest one,
+ * increasing values
+ * \return     value of the newest record, 0 if the ring is empty
+ ******************************************************************************
+*/
+static uint32_t CheckRing(EVR_Recorder_t *r)
+{
+EVR_Record_t	records[RING_RECORDS];
+int				n = EVR_Read(r,0,records,RING_RECORDS);
+
+	CHECK(n >= 0);
+	CHECK(n <= (int)(r->next - EVR_Oldest(r)));
+	for (int i = 0;i < n;i++)
+	{
+		// the oldest ones may be overwritten by an interrupted flush
+		CHECK_EQ(records[i].seq,r->next - n + i);
+		if (i > 0 && records[i].value <= records[i - 1].value)
+		{
+			printf("record %u: value %u after %u\n",records[i].seq,records[i].value,records[i - 1].value);
+			host_test_failed++;
+		}
+	}
+	return n > 0 ? records[n - 1].value : 0;
+}
+
+/*!
+ ******************************************************************************
+ *	More events than slots: the ring keeps the last ones, the bursts are split
+ * at the end of the ring
+ ******************************************************************************
+*/
+static void TestWrapAround(void)
+{
+EVR_Recorder_t	r;
+EVR_Record_t	records[RING_RECORDS];
+uint32_t			value = 0;
+
+	memset(&ram,0,sizeof(ram));
+	ram.budget = -1;
+	Attach(&r);
+	CHECK(EVR_Load(&r));
+	for (int flush = 0;flush < 100;flush++)
+	{
+		unsigned		n = Random(1,EVR_STAGE_SIZE);
+
+		for (unsigned i = 0;i < n;i++)
+		{
+			value++;
+			CHECK(EVR_Log(&r,value,1,2,value) < EVR_STAGE_SIZE + 1);
+		}
+		CHECK(EVR_Flush(&r));
+		CHECK_EQ(CheckRing(&r),value);
+	}
+	CHECK_EQ(r.next,value);
+	CHECK_EQ(EVR_Oldest(&r),value - RING_RECORDS);
+	// older records are not in the ring anymore
+	CHECK_EQ(EVR_Read(&r,0,records,5),5);
+	CHECK_EQ(records[0].seq,EVR_Oldest(&r));
+	CHECK_EQ(EVR_Read(&r,r.next - 3,records,RING_RECORDS),3);
+	CHECK_EQ(records[2].value,value);
+	// recovered as it is
+	Attach(&r);
+	CHECK(EVR_Load(&r));
+	CHECK_EQ(r.next,value);
+	CHECK_EQ(CheckRing(&r),value);
+	// a full stage drops the events and reports their number
+	for (unsigned i = 0;i < EVR_STAGE_SIZE + 7;i++)
+	{
+		value++;
+		EVR_Log(&r,value,1,2,value);
+	}
+	CHECK(EVR_Flush(&r));
+	CHECK_EQ(EVR_Read(&r,r.next - EVR_STAGE_SIZE - 1,records,1),1);
+	CHECK_EQ(records[0].source,EVR_SRC_RECORDER);
+	CHECK_EQ(records[0].code,EVR_EV_LOST);
+	CHECK_EQ(records[0].value,7);
+}
+
+/*!
+ ******************************************************************************
+ *	Events and flushes until the power is cut, then a reload: all events of
+ * the completed flushes are in the ring, followed by a part of the
+ * interrupted one at most
+ ******************************************************************************
+*/
+static void TestPowerCuts(void)
+{
+EVR_Recorder_t	r;
+uint32_t			value = 0,flushed = 0,newest;
+int				partial = 0;
+
+	memset(&ram,0,sizeof(ram));
+	ram.budget = -1;
+	Attach(&r);
+	CHECK(EVR_Load(&r));
+	for (int cut = 0;cut < POWER_CUTS;cut++)
+	{
+		ram.cut = false;
+		ram.budget = (long)Random(0,20 * sizeof(EVR_Record_t));
+		for (;;)
+		{
+			unsigned		n = Random(1,2 * EVR_BURST);
+
+			for (unsigned i = 0;i < n;i++)
+			{
+				value++;
+				EVR_Log(&r,value,1,2,value);
+			}
+			if (!EVR_Flush(&r))
+				break;
+			flushed = value;
+		}
+		CHECK(ram.cut);
+		// power on, the staged events are gone
+		ram.cut = false;
+		ram.budget = -1;
+		Attach(&r);
+		CHECK(EVR_Load(&r));
+		newest = CheckRing(&r);
+		if (newest < flushed || newest > value)
+		{
+			printf("power cut %d: newest event %u, flushed %u, logged %u\n",cut,newest,flushed,value);
+			host_test_failed++;
+			return;
+		}
+		if (newest > flushed)
+			partial++;
+		flushed = newest;
+	}
+	printf("%d power cuts: %d with a part of the interrupted flush\n",POWER_CUTS,partial);
+}
+
+/*!
+ ******************************************************************************
+ *	The recorder of FRAM.c on the simulated bus: the flushes of the
+ * communication task keep up with the events
+ ******************************************************************************
+*/
+static void TestRate(void)
+{
+EVR_Record_t	records[FRAM_EVENT_RECORDS];
+uint32_t			oldest,next,start;
+uint64_t			bus_ns = 0,t0;
+int				n;
+
+	CHECK(FRAM_FlushEvents());
+	CHECK_EQ(FRAM_ReadEvents(0,records,0,&oldest,&start),0);
+	for (uint32_t ms = 0;ms < RATE_MS;ms++)
+	{
+		for (int i = 0;i < RATE_EVENTS_MS;i++)
+			FRAM_LogEvent(EVR_SRC_LIFT,1,ms * RATE_EVENTS_MS + i);
+		SIM_RTOS_Advance(1);
+		if (ms % RATE_FLUSH_MS == RATE_FLUSH_MS - 1)
+		{
+			t0 = SIM_Clock_ns();
+			CHECK(FRAM_FlushEvents());
+			bus_ns += SIM_Clock_ns() - t0;
+		}
+	}
+	n = FRAM_ReadEvents(0,records,FRAM_EVENT_RECORDS,&oldest,&next);
+	CHECK_EQ(next - start,RATE_MS * RATE_EVENTS_MS);
+	CHECK_EQ(n,FRAM_EVENT_RECORDS);
+	for (int i = 0;i < n;i++)
+	{
+		CHECK_EQ(records[i].source,EVR_SRC_LIFT);
+		CHECK_EQ(records[i].value,RATE_MS * RATE_EVENTS_MS - n + i);
+	}
+	CHECK(bus_ns < (uint64_t)RATE_MS * RATE_EVENTS_MS * RATE_MAX_BUS_NS);
+	printf("%d events/s: bus %.1f us per event, %.1f %% of the time\n",RATE_EVENTS_MS * 1000,
+		(double)bus_ns / 1000.0 / (RATE_MS * RATE_EVENTS_MS),(double)bus_ns * 100.0 / ((double)RATE_MS * 1000000.0));
+}
+
+/*!
+ ******************************************************************************
+ *	Reset: the ring is recovered by the first flush and goes on. A FRAM which
+ * does not answer is accessed again after the back-off only, which doubles
+ ******************************************************************************
+*/
+static uint64_t BusNs(void)
+{
+	return SIM_Clock_ns() - (uint64_t)xTaskGetTickCount() * (1000000000ULL / configTICK_RATE_HZ);
+}
+
+static void TestResetAndBackoff(void)
+{
+SIM_I2C_Slave_t	*fram = SIM_I2C_Slave(FRAM_address);
+EVR_Record_t		records[2];
+uint32_t				oldest,next,before;
+uint64_t				bus;
+
+	CHECK_EQ(FRAM_ReadEvents(0,records,0,&oldest,&before),0);
+	CHECK(InitializeFRAM());						// reset, the boot event is staged
+	fram->nak = true;
+	bus = BusNs();
+	CHECK(!FRAM_FlushEvents());
+	CHECK(BusNs() > bus);
+	bus = BusNs();
+	for (int i = 0;i < 10;i++)
+		CHECK(!FRAM_FlushEvents());
+	SIM_RTOS_Advance(FRAM_EVENT_RETRY_MIN_MS - 1);
+	CHECK(!FRAM_FlushEvents());
+	CHECK_EQ(BusNs(),bus);
+	SIM_RTOS_Advance(1);
+	CHECK(!FRAM_FlushEvents());						// retried, fails again
+	CHECK(BusNs() > bus);
+	bus = BusNs();
+	SIM_RTOS_Advance(FRAM_EVENT_RETRY_MIN_MS);
+	CHECK(!FRAM_FlushEvents());
+	CHECK_EQ(BusNs(),bus);								// twice as long now
+	fram->nak = false;
+	SIM_RTOS_Advance(FRAM_EVENT_RETRY_MIN_MS);
+	CHECK(FRAM_FlushEvents());
+	CHECK_EQ(FRAM_ReadEvents(before,records,2,&oldest,&next),1);
+	CHECK_EQ(next,before + 1);
+	CHECK_EQ(records[0].source,EVR_SRC_RECORDER);
+	CHECK_EQ(records[0].code,EVR_EV_BOOT);
+}
+
+int main(void)
+{
+	SIM_RTOS_Reset();
+	SIM_RTOS_SetSchedulerState(taskSCHEDULER_RUNNING);
+	BOARD_InitBootClocks();
+	BOARD_Init();
+	TestWrapAround();
+	TestPowerCuts();
+	TestRate();
+	TestResetAndBackoff();
+	return HOST_TEST_RESULT();
+}
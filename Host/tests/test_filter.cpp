@@ -0,0 +1,99 @@
+/*
+ * test_filter.cpp
+ *
+ *  DC gain of the lift current biquad (user-013): with the low pass
+ *  coefficients normalised in Q30 a constant input settles exactly on the
+ *  input, for small and large currents of both signs.
+ *  CIC decimators with signed samples at the limit of a 32 bit accumulator
+ *  (digits + ORDER * SHIFT of 31 and 32) give the outputs of a 64 bit
+ *  reference for full range samples of both signs and for a constant
+ *  negative input
+ */
+
+#include "Filter.h"
+#include "host_test.h"
+
+#define SETTLE_SAMPLES		200000			// poles at 0.991: settled to the last count
+#define CIC_OUTPUTS			64
+
+static uint32_t		seed = 1313;
+
+static uint32_t Random(void)
+{
+	seed = seed * 1103515245u + 12345u;
+	return seed >> 8;
+}
+
+static int32_t Settle(Biquad<int32_t> &filter,int32_t input)
+{
+int32_t		y = 0;
+
+	filter.Reset();
+	for (int i = 0;i < SETTLE_SAMPLES;i++)
+		y = filter.Update(input);
+	return y;
+}
+
+/*!
+ ******************************************************************************
+ *	Runs a CIC decimator and the same CIC on int64_t without wrap-around on
+ * random samples of the full range, then on a constant negative input
+ ******************************************************************************
+*/
+template<int ORDER, int SHIFT, class T>
+static void CheckCIC(const char *name)
+{
+CICDecimator<ORDER, SHIFT, T>	cic;
+int64_t		integrator[ORDER] = { 0 },comb[ORDER] = { 0 },c,prev;
+int			outputs = 0,errors = 0;
+T				x;
+
+	for (int n = 0;n < CIC_OUTPUTS << SHIFT;n++)
+	{
+		x = (T)(std::numeric_limits<T>::min() + (int64_t)(((uint64_t)Random() << 24 | Random()) %
+			((uint64_t)std::numeric_limits<T>::max() - std::numeric_limits<T>::min() + 1)));
+		if (n >= (CIC_OUTPUTS / 2) << SHIFT)
+			x = (T)(n & 1 ? std::numeric_limits<T>::min() : -1);
+		integrator[0] += x;
+		for (int i = 1;i < ORDER;i++)
+			integrator[i] += integrator[i - 1];
+		if (!cic.Update(x))
+			continue;
+		c = integrator[ORDER - 1];
+		for (int i = 0;i < ORDER;i++)
+		{
+			prev = comb[i];
+			comb[i] = c;
+			c -= prev;
+		}
+		if (outputs++ >= ORDER && cic.Get() != (T)(c >> (ORDER * SHIFT)) && errors++ == 0)
+			printf("%s: output %d is %lld, %lld expected\n",name,outputs,(long long)cic.Get(),
+				(long long)(c >> (ORDER * SHIFT)));
+	}
+	CHECK_EQ(errors,0);
+	// the mean of the alternating samples
+	CHECK_EQ(cic.Get(),((int64_t)std::numeric_limits<T>::min() - 1) >> 1);
+	cic.Reset();
+	for (int n = 0;n < (ORDER + 1) << SHIFT;n++)
+		cic.Update((T)-1000);
+	CHECK_EQ(cic.Get(),-1000);
+}
+
+int main(void)
+{
+Biquad<int32_t>		lift;
+Biquad<int32_t>		plain(3.9130215E-05F,7.8260411E-05F,3.9130215E-05F,-1.982229F,0.9823854F);
+static const int32_t	inputs[] = { 1,7,1000,4095,65535,1000000,-1000,-1000000 };
+
+	// the coefficients of LiftDevice
+	lift.SetLowPassCoefficients(3.9130215E-05F,7.8260411E-05F,3.9130215E-05F,-1.982229F,0.9823854F);
+	for (unsigned i = 0;i < sizeof(inputs) / sizeof(inputs[0]);i++)
+		CHECK_EQ(Settle(lift,inputs[i]),inputs[i]);
+	CheckCIC<1, 1, int32_t>("CIC<1,1,int32_t>");
+	CheckCIC<1, 17, int16_t>("CIC<1,17,int16_t>");
+	CheckCIC<2, 8, int16_t>("CIC<2,8,int16_t>");		// 31 bits, the widest on 32 bits
+	// without the normalisation the rounding of the coefficients shows
+	printf("1000000 settles on %d without, on %d with the normalisation\n",
+		Settle(plain,1000000),Settle(lift,1000000));
+	return HOST_TEST_RESULT();
+}
@@ -0,0 +1,200 @@
+/*
+ * test_i2c_queue.c
+ *
+ *  Transaction queue of the I2C bus (user-021) on the simulated bus and its
+ *  slaves. A write to the EEPROM is split at its pages, the request is parked
+ *  for each write cycle and ends once the EEPROM acknowledges the poll after
+ *  the last one. Queued requests run by priority, in order within one. The
+ *  TMP100 are read while the EEPROM is in its write cycle, a request to the
+ *  EEPROM waits for it. Prints the times of the requests
+ */
+
+#include <string.h>
+#include "board.h"
+#include "clock_config.h"
+#include "I2C.h"
+#include "EEPROM.h"
+#include "FRAM.h"
+#include "TMP100.h"
+#include "sim_rtos.h"
+#include "sim_clock.h"
+#include "sim_i2c.h"
+#include "host_test.h"
+
+#define BYTE_US				((9 * 1000000 + I2C1_BAUD_RATE - 1) / I2C1_BAUD_RATE)
+#define WRITE_ADDR			(4 * EEPROM_PAGE_SIZE + EEPROM_PAGE_SIZE / 2)		// in the middle of a page
+#define WRITE_LEN				(3 * EEPROM_PAGE_SIZE)										// 4 pieces
+#define WRITE_PAGES			4
+#define MAX_JOBS				8
+
+typedef struct
+{
+	I2CQ_Request_t		req;
+	uint64_t				done_ns;
+	uint8_t				buf[4];
+} Job_t;
+
+static Job_t				*finished[MAX_JOBS];
+static int					nr_finished;
+static uint8_t				pattern[WRITE_LEN];
+
+static void Done(I2CQ_Request_t *req)
+{
+Job_t		*job = (Job_t *)req->arg;
+
+	job->done_ns = SIM_Clock_ns();
+	if (nr_finished < MAX_JOBS)
+		finished[nr_finished] = job;
+	nr_finished++;
+}
+
+static void Prepare(Job_t *job,uint8_t address,uint8_t priority,uint8_t flags,uint32_t sub_address,uint8_t sub_size,
+	uint8_t *data,uint32_t len)
+{
+	memset(job,0,sizeof(*job));
+	job->req.address = address;
+	job->req.priority = priority;
+	job->req.flags = flags;
+	job->req.sub_address = sub_address;
+	job->req.sub_size = sub_size;
+	job->req.data = data != NULL ? data : job->buf;
+	job->req.len = len;
+	job->req.callback = Done;
+	job->req.arg = job;
+	if (flags & I2CQ_WRITE_CYCLE)
+		job->req.page_size = EEPROM_PAGE_SIZE;
+}
+
+static void PrepareWrite(Job_t *job,uint8_t seed)
+{
+	for (int i = 0;i < WRITE_LEN;i++)
+		pattern[i] = (uint8_t)(seed + i * 7);
+	Prepare(job,EERPROM_I2C_ADDRESS,I2CQ_PRIO_LOW,I2CQ_WRITE_CYCLE,WRITE_ADDR,2,pattern,WRITE_LEN);
+}
+
+/*!
+ ******************************************************************************
+ *	A write over several pages: one write cycle per piece, the bus is polled
+ * until the EEPROM answers, the request ends after the last write cycle
+ ******************************************************************************
+*/
+static void TestWriteCycle(void)
+{
+SIM_I2C_Slave_t	*eeprom = SIM_I2C_Slave(EERPROM_I2C_ADDRESS);
+Job_t					write;
+uint32_t				writes = eeprom->writes;
+uint64_t				t0,us,min_us,max_us;
+
+	PrepareWrite(&write,0x30);
+	nr_finished = 0;
+	t0 = SIM_Clock_ns();
+	CHECK(I2C_Submit(&write.req));
+	CHECK_EQ(write.req.status,I2C_Stat_Success);
+	CHECK_EQ(nr_finished,1);
+	CHECK_EQ(write.req.done,WRITE_LEN);
+	CHECK_EQ(eeprom->writes - writes,WRITE_PAGES);
+	CHECK(memcmp(eeprom->mem + WRITE_ADDR,pattern,WRITE_LEN) == 0);
+	// each write cycle is seen by a poll, at most one interval late
+	us = (write.done_ns - t0) / 1000;
+	min_us = WRITE_PAGES * eeprom->write_cycle_us + (WRITE_LEN + WRITE_PAGES * 3) * BYTE_US;
+	max_us = min_us + WRITE_PAGES * (I2C_QUEUE_POLL_US + 4 * BYTE_US);
+	CHECK(us >= min_us && us <= max_us);
+	printf("%d bytes in %d pieces to the EEPROM: %llu us (%llu .. %llu us)\n",WRITE_LEN,WRITE_PAGES,
+		(unsigned long long)us,(unsigned long long)min_us,(unsigned long long)max_us);
+}
+
+/*!
+ ******************************************************************************
+ *	While the EEPROM write is parked the TMP100 are read, a read of the EEPROM
+ * queued before them waits for the end of the write and gets its data
+ ******************************************************************************
+*/
+static void TestReadDuringWrite(void)
+{
+SIM_I2C_Slave_t	*eeprom = SIM_I2C_Slave(EERPROM_I2C_ADDRESS);
+SIM_I2C_Slave_t	*tmp[2] = { SIM_I2C_Slave(TMP100_1_8BIT_ADDR),SIM_I2C_Slave(TMP100_2_8BIT_ADDR) };
+Job_t					write,read,temp[2];
+uint64_t				t0;
+
+	for (int i = 0;i < 2;i++)
+	{
+		tmp[i]->mem[0] = (uint8_t)(0x19 + i);					// temperature register
+		tmp[i]->mem[1] = 0x80;
+	}
+	PrepareWrite(&write,0x55);
+	Prepare(&read,EERPROM_I2C_ADDRESS,I2CQ_PRIO_NORMAL,I2CQ_READ,WRITE_ADDR + WRITE_LEN - 4,2,NULL,4);
+	Prepare(&temp[0],TMP100_1_8BIT_ADDR,I2CQ_PRIO_HIGH,I2CQ_READ,0,1,NULL,2);
+	Prepare(&temp[1],TMP100_2_8BIT_ADDR,I2CQ_PRIO_HIGH,I2CQ_READ,0,1,NULL,2);
+	nr_finished = 0;
+	t0 = SIM_Clock_ns();
+	SIM_I2C_Hold(true);
+	CHECK(I2C_Submit(&write.req));
+	CHECK(I2C_Submit(&read.req));
+	CHECK(I2C_Submit(&temp[0].req));
+	CHECK(I2C_Submit(&temp[1].req));
+	SIM_I2C_Hold(false);
+
+	CHECK_EQ(nr_finished,4);
+	CHECK(finished[0] == &temp[0] && finished[1] == &temp[1] && finished[2] == &write && finished[3] == &read);
+	for (int i = 0;i < 2;i++)
+	{
+		CHECK_EQ(temp[i].req.status,I2C_Stat_Success);
+		CHECK_EQ(temp[i].buf[0],0x19 + i);
+		CHECK_EQ(temp[i].buf[1],0x80);
+		// in the write cycle of the first piece
+		CHECK(temp[i].done_ns - t0 < (uint64_t)eeprom->write_cycle_us * 1000);
+	}
+	CHECK_EQ(write.req.status,I2C_Stat_Success);
+	CHECK_EQ(read.req.status,I2C_Stat_Success);
+	CHECK(read.done_ns > write.done_ns);
+	CHECK(memcmp(read.buf,pattern + WRITE_LEN - 4,4) == 0);
+	printf("TMP100 read after %llu and %llu us, EEPROM write done after %llu us, read after %llu us\n",
+		(unsigned long long)(temp[0].done_ns - t0) / 1000,(unsigned long long)(temp[1].done_ns - t0) / 1000,
+		(unsigned long long)(write.done_ns - t0) / 1000,(unsigned long long)(read.done_ns - t0) / 1000);
+}
+
+/*!
+ ******************************************************************************
+ *	Requests queued behind a transfer in progress: highest priority first, the
+ * ones of a priority in the order they were submitted
+ ******************************************************************************
+*/
+static void TestPriority(void)
+{
+const uint8_t	priority[] = { I2CQ_PRIO_LOW,I2CQ_PRIO_NORMAL,I2CQ_PRIO_HIGH,I2CQ_PRIO_NORMAL,I2CQ_PRIO_HIGH,I2CQ_PRIO_LOW };
+const int		order[] = { 2,4,1,3,0,5 };
+Job_t				first,job[6];
+
+	Prepare(&first,FRAM_address,I2CQ_PRIO_LOW,I2CQ_READ,0x100,2,NULL,4);
+	for (int i = 0;i < 6;i++)
+		Prepare(&job[i],FRAM_address,priority[i],I2CQ_READ,0x200 + 4 * i,2,NULL,4);
+	nr_finished = 0;
+	SIM_I2C_Hold(true);
+	CHECK(I2C_Submit(&first.req));
+	for (int i = 0;i < 6;i++)
+		CHECK(I2C_Submit(&job[i].req));
+	SIM_I2C_Hold(false);
+	CHECK_EQ(nr_finished,7);
+	CHECK(finished[0] == &first);
+	for (int i = 0;i < 6;i++)
+	{
+		CHECK_EQ(job[order[i]].req.status,I2C_Stat_Success);
+		if (finished[i + 1] != &job[order[i]])
+		{
+			printf("request %d finished at %d, request %d expected\n",(int)(finished[i + 1] - job),i + 1,order[i]);
+			host_test_failed++;
+		}
+	}
+}
+
+int main(void)
+{
+	SIM_RTOS_Reset();
+	SIM_RTOS_SetSchedulerState(taskSCHEDULER_RUNNING);
+	BOARD_InitBootClocks();
+	BOARD_Init();
+	TestWriteCycle();
+	TestReadDuringWrite();
+	TestPriority();
+	return HOST_TEST_RESULT();
+}
@@ -0,0 +1,240 @@
+/*
+ * test_io_dispatch.cpp
+ *
+ *  Port interrupt dispatch of IO.cpp (user-014): an input is declared for
+ *  every input pin of the board table, random ISFR patterns are raised on
+ *  the five ports and each input whose bit is set is called exactly once by
+ *  its port interrupt, the others not at all. PORTA does not dispatch while a
+ *  test counter takes it. Prints the cost of a pending pin with one input
+ *  registered and with all of them
+ */
+
+#include <string.h>
+#include "board.h"
+#include "clock_config.h"
+#include "IO.h"
+#include "sim_rtos.h"
+#include "host_test.h"
+
+#define PATTERNS				2000
+#define BENCH_LOOPS			1000000
+
+extern "C" {
+void PORTA_IRQHandler(void);
+void PORTB_IRQHandler(void);
+void PORTC_IRQHandler(void);
+void PORTD_IRQHandler(void);
+void PORTE_IRQHandler(void);
+}
+
+typedef struct
+{
+	PORT_Type				*base;
+	IRQn_Type				irq;
+	SIM_NVIC_Handler_t	handler;
+	bool						dispatches;			// the interrupt handler dispatches to the inputs
+} Port_t;
+
+static const Port_t		port[IO_N_PORTS] = {
+	{ PORTA,	PORTA_IRQn,	PORTA_IRQHandler,	true },
+	{ PORTB,	PORTB_IRQn,	PORTB_IRQHandler,	true },
+#if defined CUC_HW_V2 || defined CUC_HW_HALL_IOS_V2
+	{ PORTC,	PORTC_IRQn,	PORTC_IRQHandler,	false },	// the hall counters of V1 only
+#else
+	{ PORTC,	PORTC_IRQn,	PORTC_IRQHandler,	true },
+#endif
+	{ PORTD,	PORTD_IRQn,	PORTD_IRQHandler,	true },
+	{ PORTE,	PORTE_IRQn,	PORTE_IRQHandler,	true },
+};
+
+static uint32_t		seed = 1414;
+
+static uint32_t Random(uint32_t lo,uint32_t hi)
+{
+	seed = seed * 1103515245u + 12345u;
+	return lo + (seed >> 8) % (hi - lo + 1);
+}
+
+// ----------------------------------------------------------------------------
+//! \class      CountingInput
+//! \brief      Input which counts its interrupts
+class CountingInput : public DigitalInput
+{
+public:
+	CountingInput(uint8_t _nPinId) : DigitalInput(_nPinId), m_nCalls(0) {}
+	void HandleInterrupt(EEdge _eEdge) override { (void)_eEdge; m_nCalls++; }
+	unsigned			m_nCalls;
+};
+
+static CountingInput		*input[IO_N_PORTS][IO_N_PINS];
+static int					nr_inputs;
+static CountingInput		*bench_input;
+static PORT_Type			*bench_port;
+static uint32_t			bench_mask;
+
+static int PortIndex(PORT_Type *base)
+{
+	for (int i = 0;i < IO_N_PORTS;i++)
+		if (port[i].base == base)
+			return i;
+	return -1;
+}
+
+/*!
+ ******************************************************************************
+ *	Declares an input for each input pin of the board table up to max inputs,
+ * the pins listed twice are declared once. A pin dispatched alone must reach
+ * its input
+ ******************************************************************************
+*/
+static void DeclareInputs(int max)
+{
+const strGPIOattrib_t	*pin;
+CountingInput				*in;
+int							p;
+
+	for (unsigned id = 0;id < BOARD_N_GPIO && nr_inputs < max;id++)
+	{
+		pin = BOARD_GetPinStructPtr(id);
+		if (pin == NULL || pin->Direction != kGPIO_DigitalInput || (p = PortIndex(pin->Base)) < 0)
+			continue;
+		if (input[p][pin->Offset] != NULL)
+			continue;
+		in = new CountingInput((uint8_t)id);
+		CHECK(DigitalInput::DispatchInterrupt(pin->Base,pin->Offset));
+		CHECK_EQ(in->m_nCalls,1);
+		in->m_nCalls = 0;
+		input[p][pin->Offset] = in;
+		if (nr_inputs == 0)
+		{
+			bench_input = in;
+			bench_port = pin->Base;
+			bench_mask = 1u << pin->Offset;
+		}
+		nr_inputs++;
+	}
+	CHECK(nr_inputs > 0);
+}
+
+/*!
+ ******************************************************************************
+ *	Raises the interrupt of a port with an ISFR pattern, each input of a set
+ * bit is called once
+ ******************************************************************************
+*/
+static void RaisePattern(int p,uint32_t pattern,bool dispatches)
+{
+	port[p].base->ISFR = pattern;
+	SIM_NVIC_Raise(port[p].irq,port[p].handler);
+	for (int pin = 0;pin < IO_N_PINS;pin++)
+	{
+		if (input[p][pin] == NULL)
+			continue;
+		if (input[p][pin]->m_nCalls != ((dispatches && (pattern & (1u << pin)) != 0) ? 1u : 0u))
+		{
+			printf("port %c pin %d, ISFR 0x%08X: %u calls\n",'A' + p,pin,pattern,input[p][pin]->m_nCalls);
+			host_test_failed++;
+		}
+		input[p][pin]->m_nCalls = 0;
+	}
+}
+
+static uint32_t RandomPattern(void)
+{
+	switch (Random(0,3))
+	{
+		case 0:
+			return 1u << Random(0,31);
+		case 1:
+			return 0xFFFFFFFFu;
+		default:
+			return Random(0,0xFFFF) | (Random(0,0xFFFF) << 16);
+	}
+}
+
+static void TestPatterns(void)
+{
+	for (int i = 0;i < PATTERNS && !host_test_failed;i++)
+	{
+		for (int p = 0;p < IO_N_PORTS;p++)
+			RaisePattern(p,RandomPattern(),port[p].dispatches);
+	}
+	// direct dispatch of the table, all five ports
+	for (int p = 0;p < IO_N_PORTS;p++)
+	{
+		unsigned		mapped = 0;
+
+		for (int pin = 0;pin < IO_N_PINS;pin++)
+			mapped += input[p][pin] != NULL;
+		CHECK_EQ(DigitalInput::DispatchInterrupts(port[p].base,0xFFFFFFFFu),mapped);
+		for (int pin = 0;pin < IO_N_PINS;pin++)
+		{
+			if (input[p][pin] != NULL)
+			{
+				CHECK_EQ(input[p][pin]->m_nCalls,1);
+				input[p][pin]->m_nCalls = 0;
+			}
+		}
+	}
+	CHECK_EQ(DigitalInput::DispatchInterrupts(reinterpret_cast<PORT_Type *>(GPIOA),0xFFFFFFFFu),0);
+}
+
+/*!
+ ******************************************************************************
+ *	The test counters take PORTA, its inputs are not dispatched meanwhile
+ ******************************************************************************
+*/
+static void TestCounters(void)
+{
+	CHECK(BOARD_EnaFlowMeterTestCounter(1,0));
+	RaisePattern(0,0xFFFFFFFFu,false);
+	CHECK(BOARD_EnaFlowMeterTestCounter(0,0));
+#if defined CUC_HW_V2 || defined CUC_HW_HALL_IOS_V2
+	CHECK(BOARD_EnaHallTestCounters(1,0));
+	RaisePattern(0,0xFFFFFFFFu,false);
+	CHECK(BOARD_EnaHallTestCounters(0,0));
+#endif
+	RaisePattern(0,0xFFFFFFFFu,true);
+}
+
+/*!
+ ******************************************************************************
+ *	Dispatch of the pending pin of the first input
+ * \return        ns per dispatch on the host
+ ******************************************************************************
+*/
+static double Bench(void)
+{
+uint64_t		t0;
+
+	t0 = HOST_TimeNs();
+	for (int i = 0;i < BENCH_LOOPS;i++)
+		DigitalInput::DispatchInterrupts(bench_port,bench_mask);
+	t0 = HOST_TimeNs() - t0;
+	CHECK_EQ(bench_input->m_nCalls,BENCH_LOOPS);
+	bench_input->m_nCalls = 0;
+	return (double)t0 / BENCH_LOOPS;
+}
+
+int main(void)
+{
+double		t_one,t_all;
+
+	SIM_RTOS_Reset();
+	SIM_RTOS_SetSchedulerState(taskSCHEDULER_RUNNING);
+	BOARD_InitBootClocks();
+	BOARD_Init();
+	for (int p = 0;p < IO_N_PORTS;p++)
+	{
+		NVIC_SetPriority(port[p].irq,PORTA_INT_PRIORITY);
+		NVIC_EnableIRQ(port[p].irq);
+	}
+	DeclareInputs(1);
+	t_one = Bench();
+	DeclareInputs(BOARD_N_GPIO);
+	t_all = Bench();
+	TestPatterns();
+	TestCounters();
+	printf("pending pin: %.1f ns with 1 input registered, %.1f ns with %d inputs\n",t_one,t_all,nr_inputs);
+	return HOST_TEST_RESULT();
+}
@@ -0,0 +1,190 @@
+/*
+ * test_lift_tick.cpp
+ *
+ *  Tick path of the PWM control loop (user-009) with the brush lift: the
+ *  PWM period interrupt only latches the tick, the PWM_CONTROL task runs the
+ *  control cycle and the FSM of the LiftDevice. A motor model turns the duty
+ *  cycle of the lift output into hall sensor pulses, played through the
+ *  PORTA interrupt, also in the tick of a latched control cycle. Every pulse
+ *  ends up in the position, each tick gives one control cycle without an
+ *  overrun and both moves end in range. Prints the times of the moves
+ */
+
+#include <stdlib.h>
+#include "PWMDriver.h"
+#include "MotorDriver.h"
+#include "AnalogInput.h"
+#include "IO.h"
+#include "LiftDevice.h"
+#include "sim_rtos.h"
+#include "sim_board.h"
+#include "sim_isr.h"
+#include "host_test.h"
+
+#define PWM_PERIOD_US		2000
+#define PWM_PERIOD_MS		(PWM_PERIOD_US / 1000)
+#define HALL_PERIOD_MS		10						// full speed, the lift accepts one pulse per 9 ms
+#define MIN_DUTY				50						// 1/1000, the motor does not turn below
+#define REST_POS				(5 * CNTS_PER_MM)
+#define WORK_POS				(33 * CNTS_PER_MM)
+#define IN_RANGE				8						// m_nLiftMotorInPosRange without dry run
+
+extern "C" void PORTA_IRQHandler(void);
+
+typedef struct
+{
+	LiftDevice			*lift;
+	MotorDriver			*motor;
+	const strGPIOattrib_t	*hall;
+	int32_t				played;						// net pulses of the motor model
+	uint32_t				pulses;
+	uint32_t				pwm_ticks;
+	TickType_t			last_pulse;
+	TickType_t			move_start;
+	int					move;
+	uint32_t				move_ms[2];
+} Bench_t;
+
+static Bench_t		bench;
+
+static void Finish(void)
+{
+PWMControlStatistics_t	stats;
+
+	PWMDriver::GetInstance()->GetControlStatistics(&stats);
+	CHECK_EQ(stats.Ticks,bench.pwm_ticks);
+	CHECK_EQ(stats.ControlCycles,bench.pwm_ticks / PWM_N_TIMERS);
+	CHECK_EQ(stats.Overruns,0);
+	printf("%u hall pulses, %u control cycles: down %u ms, up %u ms\n",bench.pulses,stats.ControlCycles,
+		bench.move_ms[0],bench.move_ms[1]);
+	exit(HOST_TEST_RESULT());
+}
+
+/*!
+ ******************************************************************************
+ *	Position of the lift: the taken pulses and the ones counted since
+ ******************************************************************************
+*/
+static int32_t Position(int *delta)
+{
+int		act,home,rest,work,in_range;
+uint8_t	up,state;
+
+	bench.lift->GetStateAndPos(&act,&home,&rest,delta,&work,&in_range,&up,&state);
+	return act;
+}
+
+/*!
+ ******************************************************************************
+ *	The motor: one hall pulse every HALL_PERIOD_MS as long as the lift output
+ * drives it, counted in the direction of the motor as the lift does
+ ******************************************************************************
+*/
+static void PlayHall(TickType_t now)
+{
+unsigned		duty1,duty2;
+bool			enabled;
+uint32_t		prev;
+
+	CHECK(SIM_Board_GetPWMOutputs(PWM_CONTROL_LIFT_BR,&duty1,&duty2,&enabled));
+	if (!enabled || (duty1 < MIN_DUTY && duty2 < MIN_DUTY) || now - bench.last_pulse < HALL_PERIOD_MS)
+		return;
+	bench.last_pulse = now;
+	bench.played += bench.motor->GetMode() == EMotorDriverMode_Clockwise ? -1 : 1;
+	bench.pulses++;
+	prev = SIM_ISR_Enter(PORTA_IRQn);
+	bench.hall->Base->ISFR = 1U << bench.hall->Offset;
+	PORTA_IRQHandler();
+	SIM_ISR_Exit(prev);
+}
+
+/*!
+ ******************************************************************************
+ *	The interrupts of a tick, the PWM_CONTROL task runs after them
+ ******************************************************************************
+*/
+static void OnTick(TickType_t now,void *ctx)
+{
+int		delta;
+int32_t	pos;
+
+	(void)ctx;
+	// taken by the last control cycle or still counted by the interrupt
+	pos = Position(&delta);
+	if (pos + delta != bench.played)
+	{
+		printf("tick %u: position %d + %d, %d pulses played\n",(unsigned)now,pos,delta,bench.played);
+		host_test_failed++;
+		Finish();
+	}
+	// the control cycle of the previous tick has run
+	if (now % PWM_PERIOD_MS == 0)
+	{
+		for (unsigned timer = 0;timer < PWM_N_TIMERS;timer++)
+			SIM_Board_PWMInterrupt(timer);
+		bench.pwm_ticks += PWM_N_TIMERS;
+	}
+	PlayHall(now);
+
+	if (bench.lift->GetFSMstate() != ELiftDeviceStatus_Idle || now - bench.move_start < 10 * PWM_PERIOD_MS)
+	{
+		if (now - bench.move_start > MAX_MOVINT_TIME)
+		{
+			printf("move %d not done after %u ms\n",bench.move,(unsigned)(now - bench.move_start));
+			host_test_failed++;
+			Finish();
+		}
+		return;
+	}
+	// move done and settled
+	CHECK(abs(pos - (bench.move == 0 ? WORK_POS : REST_POS)) < IN_RANGE);
+	CHECK_EQ(bench.lift->GetCleaningDeviceStatus(),ECleaningDeviceStatus_Running);
+	bench.move_ms[bench.move] = bench.last_pulse - bench.move_start;
+	if (++bench.move == 2)
+		Finish();
+	// back up to the rest position
+	bench.lift->InitPositions(REST_POS,REST_POS);
+	CHECK(bench.lift->Lower());
+	bench.move_start = now;
+}
+
+int main(void)
+{
+TaskHandle_t	task;
+
+	SIM_RTOS_Reset();
+	SIM_RTOS_SetSchedulerState(taskSCHEDULER_RUNNING);
+	BOARD_InitBootClocks();
+	BOARD_Init();
+	BOARD_Ena_CUC_IRQ_Callback(true);
+
+	// static: the devices rely on zeroed memory, as BoardMgr on the fresh heap
+	static PWMDriver			pwm(PWM_PERIOD_US);
+	static AnalogInputMgr	adc(0);
+	static CurrentProbe		probe(adc.DeclareInput(ADC_LIFT_BR_CUR));
+	static MotorDriver		motor(pwm.DeclareOutput(PWM_CONTROL_LIFT_BR + 1),&probe,
+									EMotorDriverMode_Clockwise,EMotorDriverMode_BrakeGND,"Brush Lift Motor");
+	static HallSensorInput	hall(GP_LIFT_BRUSH_HALL_IN);
+	static LiftDevice			lift(ECleaningUnitMgrErrors_BrushLift,motor,nullptr,&hall,1);
+
+	bench.lift = &lift;
+	bench.motor = &motor;
+	bench.hall = BOARD_GetPinStructPtr(GP_LIFT_BRUSH_HALL_IN);
+	CHECK(bench.hall != nullptr && bench.hall->Base == PORTA);
+	lift.InitPID(250,0,0);
+	lift.InitPositions(REST_POS,WORK_POS);
+	CHECK(motor.Enable());
+	CHECK(lift.Lower());
+	CHECK_EQ(lift.GetFSMstate(),ELiftDeviceStatus_Moving);
+
+	// the control task, returns through Finish()
+	pwm.Start();
+	task = SIM_RTOS_FindTask("PWM_CONTROL");
+	CHECK(task != nullptr);
+	if (task == nullptr)
+		return HOST_TEST_RESULT();
+	SIM_RTOS_SetTickHook(OnTick,nullptr);
+	SIM_RTOS_SetCurrentTask(task);
+	SIM_RTOS_TaskFunction(task)(SIM_RTOS_TaskParameter(task));
+	return 1;
+}
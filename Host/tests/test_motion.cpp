@@ -0,0 +1,266 @@
+/*
+ * test_motion.cpp
+ *
+ *  Motion profiles of TMPGenerator in single precision (user-012) against a
+ *  double precision reference of the same profiles: random trapezoids and
+ *  S-curves from rest must follow the reference within one count and end on
+ *  time, moves commanded while moving must stay continuous and end on the
+ *  target. Prints the cost of Execute on the host
+ */
+
+#include <stdlib.h>
+#include <math.h>
+#include "MotionGenerator.h"
+#include "LiftDevice.h"
+#include "host_test.h"
+
+#define MOVES					2000
+#define MAX_DISTANCE			50000
+#define POS_TOLERANCE		1					// counts, the reference is rounded as well
+#define TIME_TOLERANCE		1					// ms
+
+static uint32_t		seed = 12345;
+
+static uint32_t Random(uint32_t lo,uint32_t hi)
+{
+	seed = seed * 1103515245u + 12345u;
+	return lo + (seed >> 8) % (hi - lo + 1);
+}
+
+/*!
+ ******************************************************************************
+ *	Reference profile from rest: constant jerk segments in double precision
+ ******************************************************************************
+*/
+struct RefProfile
+{
+	int			n;
+	double		start[7],pos[7],speed[7],acc[7],jerk[7];
+	double		end;
+
+	void Add(double duration,double a,double j)
+	{
+		if (duration <= 0.0)
+			return;
+		if (n == 0)
+		{
+			start[0] = pos[0] = speed[0] = 0.0;
+		}
+		else
+		{
+			double	T = end - start[n - 1];
+			start[n] = end;
+			pos[n] = pos[n - 1] + speed[n - 1] * T + acc[n - 1] * T * T / 2.0 + jerk[n - 1] * T * T * T / 6.0;
+			speed[n] = speed[n - 1] + acc[n - 1] * T + jerk[n - 1] * T * T / 2.0;
+		}
+		acc[n] = a;
+		jerk[n] = j;
+		end = start[n] + duration;
+		n++;
+	}
+
+	double Position(double t) const
+	{
+	int		i = 0;
+
+		while (i < n - 1 && t >= start[i + 1])
+			i++;
+		double	tau = t - start[i];
+		return pos[i] + speed[i] * tau + acc[i] * tau * tau / 2.0 + jerk[i] * tau * tau * tau / 6.0;
+	}
+};
+
+static void Trapezoid(RefProfile &ref,double D,double V,double A)
+{
+	ref.n = 0;
+	ref.end = 0.0;
+	double	peak = sqrt(A * D);
+	if (peak > V)
+		peak = V;
+	ref.Add(peak / A,A,0.0);
+	ref.Add((D - peak * peak / A) / peak,0.0,0.0);
+	ref.Add(peak / A,-A,0.0);
+}
+
+static void SCurve(RefProfile &ref,double D,double V,double A,double J)
+{
+double	tj,ta,tc = 0.0;
+
+	ref.n = 0;
+	ref.end = 0.0;
+	if (V * J >= A * A)
+	{
+		tj = A / J;
+		ta = V / A - tj;
+	}
+	else
+	{
+		tj = sqrt(V / J);
+		ta = 0.0;
+	}
+	if (V * (2.0 * tj + ta) <= D)
+		tc = D / V - (2.0 * tj + ta);
+	else
+	{
+		tj = A / J;
+		double	peak = 0.5 * A * (sqrt(tj * tj + 4.0 * D / A) - tj);
+		ta = peak / A - tj;
+		if (ta < 0.0)
+		{
+			tj = cbrt(D / (2.0 * J));
+			ta = 0.0;
+		}
+	}
+	double	a = J * tj;
+	ref.Add(tj,0.0,J);
+	ref.Add(ta,a,0.0);
+	ref.Add(tj,a,-J);
+	ref.Add(tc,0.0,0.0);
+	ref.Add(tj,0.0,-J);
+	ref.Add(ta,-a,0.0);
+	ref.Add(tj,-a,J);
+}
+
+/*!
+ ******************************************************************************
+ *	One move from rest, compared step by step with the reference
+ * \return        the largest position error in counts
+ ******************************************************************************
+*/
+static int CheckMove(uint32_t V,uint32_t A,uint32_t jerk,uint32_t jerk_div,int32_t from,int32_t to,uint32_t step)
+{
+TMPGenerator	gen(V,A,0);
+RefProfile		ref;
+uint32_t			t0 = Random(0,1000000);
+double			dir = (to > from) ? 1.0 : -1.0;
+double			D = fabs((double)to - from);
+int				max_err = 0;
+uint32_t			t;
+
+	if (jerk != 0)
+	{
+		gen.SetJerk(jerk,jerk_div);
+		SCurve(ref,D,V,A,(double)jerk / jerk_div);
+	}
+	else
+		Trapezoid(ref,D,V,A);
+	CHECK(gen.SetPosition(from));
+	gen.Execute(t0);
+	gen.MoveTo(to);
+	for (t = step;gen.IsMoving();t += step)
+	{
+		gen.Execute(t0 + t);
+		if (!gen.IsMoving())
+			break;
+		int32_t		expected = from + (int32_t)lround(dir * ref.Position(t));
+		int			err = abs(gen.GetPosition() - expected);
+
+		if (err > max_err)
+			max_err = err;
+		if (t > ref.end + 10 * step)
+			break;
+	}
+	CHECK_EQ(gen.GetPosition(),to);
+	// the move ends at the first step after the end of the reference
+	if (fabs((double)t - ref.end) > step + TIME_TOLERANCE)
+	{
+		printf("V %u A %u J %u/%u D %.0f: end %u ms instead of %.2f ms\n",V,A,jerk,jerk_div,D,t,ref.end);
+		host_test_failed++;
+	}
+	if (max_err > POS_TOLERANCE)
+	{
+		printf("V %u A %u J %u/%u D %.0f: position error %d counts\n",V,A,jerk,jerk_div,D,max_err);
+		host_test_failed++;
+	}
+	return max_err;
+}
+
+/*!
+ ******************************************************************************
+ *	New targets while moving: no jump, the last target is reached
+ ******************************************************************************
+*/
+static void CheckRetarget(uint32_t V,uint32_t A)
+{
+TMPGenerator	gen(V,A,0);
+uint32_t			t = 0;
+int32_t			last;
+int				moves = 0;
+
+	gen.SetJerk(LIFT_TMP_JERK,LIFT_TMP_JERK_DIV);
+	gen.Execute(t);
+	gen.MoveTo((int32_t)Random(1,MAX_DISTANCE));
+	last = gen.GetPosition();
+	while (gen.IsMoving() && t < 10000000)
+	{
+		t += 2;
+		gen.Execute(t);
+		if (abs(gen.GetPosition() - last) > (int)(2 * 2 * V + 1))
+		{
+			printf("V %u A %u: jump of %d counts at %u ms\n",V,A,gen.GetPosition() - last,t);
+			host_test_failed++;
+			return;
+		}
+		last = gen.GetPosition();
+		if (moves < 5 && Random(0,50) == 0)
+		{
+			gen.MoveTo((int32_t)Random(0,MAX_DISTANCE) - MAX_DISTANCE / 2);
+			moves++;
+		}
+	}
+	CHECK(!gen.IsMoving());
+}
+
+int main(void)
+{
+int				max_trap = 0,max_scurve = 0;
+uint64_t			t0,steps = 0;
+
+	// the lift
+	max_scurve = CheckMove(10,1,LIFT_TMP_JERK,LIFT_TMP_JERK_DIV,0,33 * 100,2);
+	max_trap = CheckMove(10,1,0,1,3300,500,2);
+
+	for (int i = 0;i < MOVES;i++)
+	{
+		uint32_t		V = Random(1,100);
+		uint32_t		A = Random(1,10);
+		int32_t		from = (int32_t)Random(0,MAX_DISTANCE) - MAX_DISTANCE / 2;
+		int32_t		to = (int32_t)Random(0,MAX_DISTANCE) - MAX_DISTANCE / 2;
+		// jerk from A^2/V / 10 to A^2/V * 10: all cases of the S-curve
+		uint32_t		div = Random(1,100) * V;
+		uint32_t		jerk = A * A * Random(1,100) / 10 + 1;
+		int			err;
+
+		if (from == to)
+			continue;
+		err = CheckMove(V,A,0,1,from,to,(i & 1) ? 1 : 2);
+		if (err > max_trap)
+			max_trap = err;
+		err = CheckMove(V,A,jerk,div,from,to,(i & 1) ? 1 : 2);
+		if (err > max_scurve)
+			max_scurve = err;
+		CheckRetarget(V,A);
+	}
+
+	// cost of a step
+	TMPGenerator	gen(10,1,0);
+	gen.SetJerk(LIFT_TMP_JERK,LIFT_TMP_JERK_DIV);
+	t0 = HOST_TimeNs();
+	for (int i = 0;i < 1000;i++)
+	{
+		uint32_t		t = i * 100000;
+
+		gen.Execute(t);
+		gen.MoveTo((i & 1) ? 0 : 20000);
+		while (gen.IsMoving())
+		{
+			t += 2;
+			gen.Execute(t);
+			steps++;
+		}
+	}
+	t0 = HOST_TimeNs() - t0;
+	printf("max position error: trapezoid %d, S-curve %d counts, Execute %.1f ns\n",
+		max_trap,max_scurve,(double)t0 / (double)steps);
+	return HOST_TEST_RESULT();
+}
@@ -0,0 +1,199 @@
+/*
+ * test_object_dictionary.cpp
+ *
+ *  Sorted object dictionary of ObjectDictionary.cpp (user-007): entries
+ *  with random keys are added in random order up to the capacity, after each
+ *  add the binary search finds every entry and rejects the keys next to
+ *  them, below and above all of them. Duplicates, a full dictionary and
+ *  entries without room for their value are refused. Prints the time of a
+ *  lookup, hit and miss, in the full dictionary and of a linear scan of the
+ *  same entries
+ */
+
+#include <string.h>
+#include "ObjectDictionary.h"
+#include "host_test.h"
+
+#define BENCH_LOOPS			2000000
+
+static ObjectDictionary			dict;
+static ObjectDictionaryEntry	*added[OBJDICT_MAX_ENTRIES];
+static uint32_t					keys[OBJDICT_MAX_ENTRIES];
+static int							nr_keys;
+static uint32_t					seed = 707;
+static volatile uintptr_t		sink;
+
+static uint32_t Random(uint32_t lo,uint32_t hi)
+{
+	seed = seed * 1103515245u + 12345u;
+	return lo + (seed >> 8) % (hi - lo + 1);
+}
+
+static bool Known(uint32_t key)
+{
+	for (int i = 0;i < nr_keys;i++)
+		if (keys[i] == key)
+			return true;
+	return false;
+}
+
+static ObjectDictionaryEntry *FindKey(uint32_t key)
+{
+	return dict.Find((uint16_t)(key >> 8),(uint8_t)key);
+}
+
+/*!
+ ******************************************************************************
+ *	Every entry is found, the keys next to them are not unless added
+ ******************************************************************************
+*/
+static void CheckLookup(void)
+{
+ObjectDictionaryEntry	*entry;
+uint32_t						key;
+
+	for (int i = 0;i < nr_keys;i++)
+	{
+		entry = FindKey(keys[i]);
+		if (entry != added[i])
+		{
+			printf("0x%04X.%u: not found with %d entries\n",keys[i] >> 8,keys[i] & 0xFF,nr_keys);
+			host_test_failed++;
+			return;
+		}
+		for (int d = -1;d <= 1;d += 2)
+		{
+			key = (keys[i] + d) & 0xFFFFFF;
+			if (!Known(key) && FindKey(key) != NULL)
+			{
+				printf("0x%04X.%u: found, not added\n",key >> 8,key & 0xFF);
+				host_test_failed++;
+				return;
+			}
+		}
+	}
+}
+
+/*!
+ ******************************************************************************
+ *	Random keys, a third of them subindexes of the previous object
+ ******************************************************************************
+*/
+static void TestAdd(void)
+{
+ObjectDictionaryEntry	*entry;
+uint32_t						key;
+
+	while (nr_keys < OBJDICT_MAX_ENTRIES)
+	{
+		do
+		{
+			if (nr_keys > 0 && Random(0,2) == 0)
+				key = (keys[nr_keys - 1] & 0xFFFF00) | Random(0,255);
+			else
+				key = Random(0x1000,0x6FFF) << 8 | Random(0,8);
+		} while (Known(key));
+		entry = dict.Add((uint16_t)(key >> 8),(uint8_t)key,ECANDataType_Unsigned16,2,ECANAccess_ReadWrite);
+		CHECK(entry != NULL);
+		if (entry == NULL)
+			return;
+		CHECK_EQ(entry->nObjectIndex,key >> 8);
+		CHECK_EQ(entry->nSubIndex,key & 0xFF);
+		CHECK(entry->pData == (uint8_t *)&entry->nValue);
+		// an entry already there is refused
+		CHECK(dict.Add((uint16_t)(key >> 8),(uint8_t)key,ECANDataType_Unsigned16,2,ECANAccess_ReadWrite) == NULL);
+		keys[nr_keys] = key;
+		added[nr_keys] = entry;
+		nr_keys++;
+		CHECK_EQ(dict.GetCount(),nr_keys);
+		CheckLookup();
+		if (host_test_failed)
+			return;
+	}
+	// misses outside of the keys
+	CHECK(dict.Find(0x0000,0) == NULL);
+	CHECK(dict.Find(0x0FFF,255) == NULL);
+	CHECK(dict.Find(0x7000,0) == NULL);
+	CHECK(dict.Find(0xFFFF,255) == NULL);
+	for (int i = 0;i < 10000;i++)
+	{
+		key = Random(0,0xFFFFFF);
+		CHECK(Known(key) || FindKey(key) == NULL);
+	}
+	// full
+	CHECK(dict.Add(0x0001,0,ECANDataType_Unsigned8,1,ECANAccess_ReadOnly) == NULL);
+	CHECK_EQ(dict.GetCount(),OBJDICT_MAX_ENTRIES);
+}
+
+/*!
+ ******************************************************************************
+ *	Entries refused before the dictionary is full
+ ******************************************************************************
+*/
+static void TestRefused(void)
+{
+ObjectDictionary		*small = new ObjectDictionary();
+uint8_t					buffer[16];
+ObjectDictionaryEntry	*entry;
+
+	CHECK(small->Add(0x2000,0,ECANDataType_Unsigned32,0,ECANAccess_ReadOnly) == NULL);
+	CHECK(small->Add(0x2000,0,ECANDataType_Domain,sizeof(buffer),ECANAccess_ReadOnly) == NULL);
+	entry = small->Add(0x2000,0,ECANDataType_Domain,sizeof(buffer),ECANAccess_ReadOnly,buffer);
+	CHECK(entry != NULL && entry->pData == buffer && entry->IsDomain());
+	CHECK_EQ(small->GetCount(),1);
+	CHECK(small->Find(0x2000,0) == entry);
+	CHECK(small->Find(0x2000,1) == NULL);
+	delete small;
+}
+
+/*!
+ ******************************************************************************
+ *	Lookups in the full dictionary and a linear scan of the same entries
+ * \return        ns per lookup on the host
+ ******************************************************************************
+*/
+static double BenchFind(bool hit)
+{
+uint64_t		t0;
+uint32_t		key;
+
+	t0 = HOST_TimeNs();
+	for (int i = 0;i < BENCH_LOOPS;i++)
+	{
+		key = hit ? keys[(i * 97) % OBJDICT_MAX_ENTRIES] : (keys[(i * 97) % OBJDICT_MAX_ENTRIES] | 0xFF) + 0x100;
+		sink = (uintptr_t)FindKey(key);
+	}
+	return (double)(HOST_TimeNs() - t0) / BENCH_LOOPS;
+}
+
+static double BenchScan(void)
+{
+uint64_t		t0;
+uint32_t		key;
+
+	t0 = HOST_TimeNs();
+	for (int i = 0;i < BENCH_LOOPS;i++)
+	{
+		key = keys[(i * 97) % OBJDICT_MAX_ENTRIES];
+		for (int e = 0;e < nr_keys;e++)
+		{
+			if (added[e]->nObjectIndex == (uint16_t)(key >> 8) && added[e]->nSubIndex == (uint8_t)key)
+			{
+				sink = (uintptr_t)added[e];
+				break;
+			}
+		}
+	}
+	return (double)(HOST_TimeNs() - t0) / BENCH_LOOPS;
+}
+
+int main(void)
+{
+	TestAdd();
+	TestRefused();
+	if (host_test_failed)
+		return HOST_TEST_RESULT();
+	printf("%d entries: hit %.1f ns, miss %.1f ns, linear scan %.1f ns\n",OBJDICT_MAX_ENTRIES,
+		BenchFind(true),BenchFind(false),BenchScan());
+	return HOST_TEST_RESULT();
+}
@@ -0,0 +1,212 @@
+/*
+ * test_pdo.cpp
+ *
+ *  PDO mapping of the Cleaning Unit and Safety Managers, seen from a simulated
+ *  CANopen master (user-005): the bytes of each TPDO are the mapped entries,
+ *  the cleaning status is sent on every SYNC, the safety status on change,
+ *  not faster than the inhibit time and repeated by the event timer. The
+ *  RPDOs write the request entries of both managers
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "CANNode.h"
+#include "CANDriver.h"
+#include "CANIds.h"
+#include "PWMDriver.h"
+#include "MotorDriver.h"
+#include "IO.h"
+#include "SafetyMgr.h"
+#include "CleaningUnitMgr.h"
+#include "sim_rtos.h"
+#include "sim_can.h"
+#include "host_test.h"
+
+#define NODE_ID				CAN_DEVID_CLEANINGUNIT
+#define START_TICK			100				// NMT start, the node is registered and waiting
+#define SYNC_PERIOD			5
+#define SYNC_FIRST			(START_TICK + 20)
+#define SYNC_LAST				(START_TICK + 200)
+#define CHANGE_TICK			400				// safety status changed 3 times within the inhibit time
+#define RPDO_TICK				500
+#define END_TICK				700
+#define TASK_PERIOD			10					// CAN_TASK_PERIOD, event TPDOs are checked at least so often
+
+static CANNode			*node;
+
+static int				syncs;
+static TickType_t		last_sync;
+static int				tpdo1;
+static int				tpdo2;
+static int				tpdo2_changed;
+static TickType_t		last_tpdo2;
+static uint8_t			last_tpdo2_data[8];
+
+static uint32_t Entry(unsigned obj,unsigned sub)
+{
+uint32_t		value = 0;
+bool			valid = false;
+
+	CHECK(node->getProviderContent(obj,sub,value,valid));
+	CHECK(valid);
+	return value;
+}
+
+static void Send(unsigned id,const uint8_t *data,int len)
+{
+	CHECK(SIM_CAN_Receive(0,id,false,data,len));
+}
+
+static void Download(unsigned obj,unsigned sub,uint32_t value)
+{
+uint8_t		sdo[8] = { 0x23,(uint8_t)obj,(uint8_t)(obj >> 8),(uint8_t)sub,
+						  (uint8_t)value,(uint8_t)(value >> 8),(uint8_t)(value >> 16),(uint8_t)(value >> 24) };
+
+	Send(EMessageBase_RxSDO + NODE_ID,sdo,8);
+}
+
+static void Finish(void)
+{
+	// one cleaning status TPDO per SYNC
+	CHECK(syncs > 30);
+	CHECK_EQ(tpdo1,syncs);
+	// safety status: start, 2 changes (the third one within the inhibit time
+	// is sent with the second) and the event timer repeats in between
+	CHECK_EQ(tpdo2_changed,2);
+	CHECK(tpdo2 >= 1 + tpdo2_changed + (END_TICK - START_TICK) / STATUS_TPDO_EVENT_TIME - 2);
+	printf("SYNCs %d, TPDO1 %d, TPDO2 %d (%d on change)\n",syncs,tpdo1,tpdo2,tpdo2_changed);
+	exit(HOST_TEST_RESULT());
+}
+
+/*!
+ ******************************************************************************
+ *	The master: NMT start, SYNC, SDO writes of the status and RPDOs, from the
+ *	CAN interrupt
+ ******************************************************************************
+*/
+static void OnTick(TickType_t now,void *ctx)
+{
+static const uint8_t	start[2] = { 0x01,NODE_ID };
+static const uint8_t	cleaning[6] = { 0x78,0x56,0x34,0x12,0x21,0x43 };
+static const uint8_t	safety[8] = { 0x01,0x00,0x00,0x00,0x0F,0x00,0x00,0x00 };
+
+	(void)ctx;
+	if (now == START_TICK)
+		Send(EMessageBase_NmtControl,start,2);
+	if (now >= SYNC_FIRST && now <= SYNC_LAST && (now - SYNC_FIRST) % SYNC_PERIOD == 0)
+	{
+		last_sync = now;
+		syncs++;
+		Send(EMessageBase_SyncAndEmergency,NULL,0);
+		// the cleaning status changes once on the way
+		if (now == SYNC_FIRST + 10 * SYNC_PERIOD)
+			Download(CLEANING_OBJID,CLEANING_STATUS_ID,0xA5A5A5A5);
+	}
+	if (now == CHANGE_TICK)
+		Download(SAFETY_OBJID,SAFETY_STATUS_ID,0x11);
+	if (now == CHANGE_TICK + 2)
+		Download(SAFETY_OBJID,SAFETY_STATUS_ID,0x22);
+	if (now == CHANGE_TICK + 4)
+		Download(SAFETY_OBJID,SAFETY_STATUS_ID,0x33);
+	if (now == RPDO_TICK)
+	{
+		// a RPDO shorter than its mapping is ignored
+		Send(EMessageBase_RxPDO1 + NODE_ID,cleaning,4);
+		Send(EMessageBase_RxPDO2 + NODE_ID,safety,8);
+	}
+	if (now == RPDO_TICK + 1)
+	{
+		CHECK_EQ(Entry(CLEANING_OBJID,CLEANING_REQUEST_ID),0u);
+		CHECK_EQ(Entry(SAFETY_OBJID,SAFETY_ANTOK_ID),1u);
+		CHECK_EQ(Entry(SAFETY_OBJID,SAFETY_REQUEST_ID),0x0Fu);
+		Send(EMessageBase_RxPDO1 + NODE_ID,cleaning,6);
+	}
+	if (now == RPDO_TICK + 2)
+	{
+		CHECK_EQ(Entry(CLEANING_OBJID,CLEANING_REQUEST_ID),0x12345678u);
+		CHECK_EQ(Entry(CLEANING_OBJID,CLEANING_WATERSETTINGS_ID),0x4321u);
+	}
+	if (now == END_TICK)
+		Finish();
+}
+
+static void OnTransmit(unsigned channel,const SIM_CAN_Frame_t *frame,void *ctx)
+{
+TickType_t		now = xTaskGetTickCount();
+uint32_t			value;
+
+	(void)channel;
+	(void)ctx;
+	if (frame->msg.ID == EMessageBase_TxPDO1 + NODE_ID)
+	{
+		// in the tick of the SYNC, the mapped cleaning status
+		CHECK_EQ(now,last_sync);
+		CHECK_EQ(frame->msg.len,4);
+		memcpy(&value,frame->msg.payload,4);
+		CHECK_EQ(value,Entry(CLEANING_OBJID,CLEANING_STATUS_ID));
+		tpdo1++;
+	}
+	else if (frame->msg.ID == EMessageBase_TxPDO2 + NODE_ID)
+	{
+		CHECK(now >= START_TICK);
+		CHECK_EQ(frame->msg.len,4);
+		memcpy(&value,frame->msg.payload,4);
+		CHECK_EQ(value,Entry(SAFETY_OBJID,SAFETY_STATUS_ID));
+		if (tpdo2 > 0)
+		{
+			CHECK(now - last_tpdo2 >= STATUS_TPDO_INHIBIT_TIME);
+			CHECK(now - last_tpdo2 <= STATUS_TPDO_EVENT_TIME + TASK_PERIOD);
+			if (memcmp(frame->msg.payload,last_tpdo2_data,4) != 0)
+			{
+				// a change is sent as soon as the inhibit time allows
+				CHECK(now <= (TickType_t)(CHANGE_TICK + STATUS_TPDO_INHIBIT_TIME + TASK_PERIOD));
+				tpdo2_changed++;
+			}
+			else
+				CHECK(now - last_tpdo2 >= STATUS_TPDO_EVENT_TIME);
+		}
+		else
+			CHECK(now - START_TICK <= 1);
+		memcpy(last_tpdo2_data,frame->msg.payload,4);
+		last_tpdo2 = now;
+		tpdo2++;
+	}
+}
+
+int main(void)
+{
+	SIM_RTOS_Reset();
+	SIM_RTOS_SetSchedulerState(taskSCHEDULER_RUNNING);
+	BOARD_InitBootClocks();
+	BOARD_Init();
+	CHECK(CAN_init(0));
+	SIM_CAN_SetTxHook(OnTransmit,NULL);
+	SIM_RTOS_SetTickHook(OnTick,NULL);
+
+	// the providers, the Safety Manager touches its I/O in its task only
+	PWMDriver		pwm(2000);
+	MotorDriver		brush(pwm.DeclareOutput(PWM_CONTROL_BRUSH + 1),nullptr,EMotorDriverMode_CounterClockwise,EMotorDriverMode_BrakeGND);
+	MotorDriver		brush_lift(pwm.DeclareOutput(PWM_CONTROL_LIFT_BR + 1),nullptr,EMotorDriverMode_Clockwise,EMotorDriverMode_BrakeGND);
+	MotorDriver		suction(pwm.DeclareOutput(PWM_CONTROL_SUCT + 1),nullptr,EMotorDriverMode_CounterClockwise,EMotorDriverMode_BrakeGND);
+	MotorDriver		suction_lift(pwm.DeclareOutput(PWM_CONTROL_LIFT_SUC + 1),nullptr,EMotorDriverMode_Clockwise,EMotorDriverMode_BrakeGND);
+	MotorDriver		pump1(pwm.DeclareOutput(PWM_CONTROL_PUMP1 + 1),nullptr,EMotorDriverMode_BrakeGND,EMotorDriverMode_BrakeGND);
+	MotorDriver		pump2(pwm.DeclareOutput(PWM_CONTROL_PUMP2 + 1),nullptr,EMotorDriverMode_BrakeGND,EMotorDriverMode_BrakeGND);
+	SafetyMgr		safety_mgr(osPriorityNormal2,nullptr,nullptr,nullptr,nullptr,nullptr,nullptr,nullptr,nullptr,
+								  nullptr,nullptr,nullptr,nullptr,nullptr,nullptr,nullptr,nullptr,nullptr,nullptr,
+								  nullptr,nullptr,nullptr,nullptr,nullptr);
+	CleaningUnitMgr	cleaning_mgr(safety_mgr,brush,suction,
+								  brush_lift,new HallSensorInput(GP_LIFT_BRUSH_HALL_IN),
+								  suction_lift,new HallSensorInput(GP_LIFT_SUCT_HALL_IN),
+								  pump1,pump2,new FlowMeterInput(GP_FLOW_METER),
+								  new DigitalInput(GP_T_24V_Safety),new DigitalOutput(GP_VALVE_DOSING_PUMP));
+	CANDriver		driver(EDevice_CAN1,125000);
+	CANNode			can_node(driver,NODE_ID,osPriorityBelowNormal5);
+
+	node = &can_node;
+	CHECK(can_node.RegisterDataProvider(&cleaning_mgr,CLEANING_OBJID));
+	CHECK(can_node.RegisterDataProvider(&safety_mgr,SAFETY_OBJID));
+
+	// returns through Finish()
+	can_node.Main();
+	return 1;
+}
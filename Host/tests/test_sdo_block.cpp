@@ -0,0 +1,157 @@
+/*
+ * test_sdo_block.cpp
+ *
+ *  SDO block download into a domain of CANNode (user-006): the CRC of the
+ *  end is checked with CRC_Calc16, an abort of the client during the block
+ *  resets the transfer without a response, a frame with another index is
+ *  still a segment out of sequence
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "CANNode.h"
+#include "CANDriver.h"
+#include "crc16.h"
+#include "sim_rtos.h"
+#include "sim_can.h"
+#include "host_test.h"
+
+#define NODE_ID				0x12
+#define DOMAIN_OBJ			1
+#define DOMAIN_SUB			5
+#define DOMAIN_SIZE			64
+#define DATA_SIZE				20					// 3 segments, the last one with 1 byte
+#define FIRST_TICK			100
+
+static uint8_t			domain[DOMAIN_SIZE];
+static uint8_t			data[DATA_SIZE];
+static int				responses;
+static uint8_t			response[8];
+
+static void Send(const uint8_t *frame)
+{
+	CHECK(SIM_CAN_Receive(0,EMessageBase_RxSDO + NODE_ID,false,frame,8));
+}
+
+static void Initiate(void)
+{
+uint8_t		frame[8] = { 0xC6,DOMAIN_OBJ,0,DOMAIN_SUB,DATA_SIZE,0,0,0 };	// CRC, size indicated
+
+	Send(frame);
+}
+
+static void Segment(int seq,bool last)
+{
+uint8_t		frame[8] = { (uint8_t)(seq | (last ? 0x80 : 0)) };
+int			pos = (seq - 1) * 7;
+
+	memcpy(&frame[1],&data[pos],pos + 7 <= DATA_SIZE ? 7 : DATA_SIZE - pos);
+	Send(frame);
+}
+
+static void End(uint16_t crc)
+{
+uint8_t		frame[8] = { (uint8_t)(0xC1 | ((3 * 7 - DATA_SIZE) << 2)),(uint8_t)crc,(uint8_t)(crc >> 8) };
+
+	Send(frame);
+}
+
+static void Abort(uint16_t obj,uint8_t sub)
+{
+uint8_t		frame[8] = { 0x80,(uint8_t)obj,(uint8_t)(obj >> 8),sub,0x00,0x00,0x04,0x05 };	// 0x05040000: timeout
+
+	Send(frame);
+}
+
+/*!
+ ******************************************************************************
+ *	Checks the response to the frame of the last tick, if any
+ ******************************************************************************
+*/
+static void Expect(int count,uint8_t command)
+{
+	CHECK_EQ(responses,count);
+	if (count > 0)
+		CHECK_EQ(response[0],command);
+	responses = 0;
+}
+
+/*!
+ ******************************************************************************
+ *	The client, one frame per tick
+ ******************************************************************************
+*/
+static void OnTick(TickType_t now,void *ctx)
+{
+uint16_t		crc = CRC16_Update(0,data,DATA_SIZE);
+
+	(void)ctx;
+	if (now < FIRST_TICK)
+		return;
+	switch (now - FIRST_TICK)
+	{
+		// complete transfer
+		case 0:	Initiate();									break;
+		case 1:	Expect(1,0xA4); Segment(1,false);	break;
+		case 2:	Expect(0,0); Segment(2,false);		break;
+		case 3:	Expect(0,0); Segment(3,true);			break;
+		case 4:	Expect(1,0xA2); End(crc);				break;
+		case 5:
+			Expect(1,0xA1);
+			CHECK(memcmp(domain,data,DATA_SIZE) == 0);
+			// the same with a wrong CRC
+			Initiate();
+			break;
+		case 6:	Expect(1,0xA4); Segment(1,false);	break;
+		case 7:	Expect(0,0); Segment(2,false);		break;
+		case 8:	Expect(0,0); Segment(3,true);			break;
+		case 9:	Expect(1,0xA2); End(crc ^ 1);			break;
+		case 10:	Expect(1,0x80); Initiate();			break;
+		// abort of the client during the block: no response
+		case 11:	Expect(1,0xA4); Segment(1,false);	break;
+		case 12:	Expect(0,0); Abort(DOMAIN_OBJ,DOMAIN_SUB);	break;
+		case 13:
+			Expect(0,0);
+			// the transfer is reset: a segment is a command again
+			Segment(2,false);
+			break;
+		case 14:	Expect(1,0x80); Initiate();			break;
+		// an abort of another object is a segment 0, the server aborts
+		case 15:	Expect(1,0xA4); Abort(DOMAIN_OBJ,DOMAIN_SUB + 1);	break;
+		case 16:
+			Expect(1,0x80);
+			CHECK_EQ(response[3],DOMAIN_SUB);
+			exit(HOST_TEST_RESULT());
+		default:
+			break;
+	}
+}
+
+static void OnTransmit(unsigned channel,const SIM_CAN_Frame_t *frame,void *ctx)
+{
+	(void)channel;
+	(void)ctx;
+	if (frame->msg.ID != EMessageBase_TxSDO + NODE_ID)
+		return;
+	memcpy(response,frame->msg.payload,8);
+	responses++;
+}
+
+int main(void)
+{
+	for (int i = 0;i < DATA_SIZE;i++)
+		data[i] = (uint8_t)(0x30 + 7 * i);
+	SIM_RTOS_Reset();
+	SIM_RTOS_SetSchedulerState(taskSCHEDULER_RUNNING);
+	CHECK(CAN_init(0));
+	SIM_CAN_SetTxHook(OnTransmit,NULL);
+	SIM_RTOS_SetTickHook(OnTick,NULL);
+
+	CANDriver	driver(EDevice_CAN1,500000);
+	CANNode		node(driver,NODE_ID,osPriorityAboveNormal);
+
+	CHECK(node.DeclareDomain(DOMAIN_OBJ,DOMAIN_SUB,domain,DOMAIN_SIZE,true));
+	// returns from the tick hook
+	node.Main();
+	return 1;
+}
@@ -0,0 +1,163 @@
+/*
+ * test_seqlock.cpp
+ *
+ *  Sequence lock of SeqLock.h and ProcessData.cpp (user-008) under real
+ *  concurrency: a writer thread publishes numbered snapshots while reader
+ *  threads copy them and yield in the middle of a copy, as a task preempted
+ *  by the interrupt which writes. Every snapshot a reader gets is one the
+ *  writer published whole (all words of the same write), in write order, and
+ *  readers retried at least once. Through ProcessDataOut/ProcessDataIn a 3
+ *  bytes value is read with its bytes of one write, the fourth byte of the
+ *  word is kept by the writes. Prints the reads and retries
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include "ProcessData.h"
+#include "SeqLock.h"
+#include "host_test.h"
+
+#define SNAPSHOT_WORDS		16
+#define READERS				3
+#define SNAPSHOTS				20000							// per reader
+#define SENTINEL				0xA5000000u
+
+typedef struct
+{
+	volatile uint32_t		nSeq;
+	volatile uint32_t		word[SNAPSHOT_WORDS];		// word[w] = write number * (w + 1)
+} Snapshot_t;
+
+typedef struct
+{
+	uint32_t		seed;
+	uint32_t		reads;
+	uint32_t		retries;
+	uint32_t		errors;
+	uint32_t		value_errors;
+} Reader_t;
+
+static Snapshot_t							snapshot;
+static volatile uint32_t				value = SENTINEL;
+static volatile uint32_t				value_seq;
+static volatile bool						done;
+static Reader_t								reader[READERS];
+static uint32_t								writes;
+static ProcessDataOut<uint32_t>		value_out((uint8_t *)&value,3,&value_seq);
+static ProcessDataIn<uint32_t>		value_in((uint8_t *)&value,3,&value_seq);
+
+static uint32_t Random(uint32_t *seed,uint32_t lo,uint32_t hi)
+{
+	*seed = *seed * 1103515245u + 12345u;
+	return lo + (*seed >> 8) % (hi - lo + 1);
+}
+
+/*!
+ ******************************************************************************
+ *	Publishes the numbered snapshots and values until each reader got its
+ * snapshots, yields now and then
+ ******************************************************************************
+*/
+static bool ReadersDone(void)
+{
+	for (int r = 0;r < READERS;r++)
+		if (__atomic_load_n(&reader[r].reads,__ATOMIC_RELAXED) < SNAPSHOTS)
+			return false;
+	return true;
+}
+
+static void *Writer(void *arg)
+{
+uint32_t		nPrimask,i;
+
+	(void)arg;
+	for (i = 1;!ReadersDone();i++)
+	{
+		nPrimask = SeqLock::WriteBegin(&snapshot.nSeq);
+		for (int w = 0;w < SNAPSHOT_WORDS;w++)
+			snapshot.word[w] = i * (w + 1);
+		SeqLock::WriteEnd(&snapshot.nSeq,nPrimask);
+		value_out.Write((i & 0xFF) * 0x010101u | 0xFF000000u);
+		if ((i & 3) == 0)
+			sched_yield();
+	}
+	writes = i - 1;
+	__atomic_store_n(&done,true,__ATOMIC_SEQ_CST);
+	return NULL;
+}
+
+/*!
+ ******************************************************************************
+ *	Copies the snapshots, the first copy is preempted at a random word now and
+ * then
+ ******************************************************************************
+*/
+static void *Reader(void *arg)
+{
+Reader_t		*reader = (Reader_t *)arg;
+uint32_t		copy[SNAPSHOT_WORDS];
+uint32_t		seq,last = 0,v;
+
+	while (!__atomic_load_n(&done,__ATOMIC_SEQ_CST))
+	{
+		int		yield_at = Random(&reader->seed,0,7) == 0 ? (int)Random(&reader->seed,0,SNAPSHOT_WORDS - 1) : -1;
+
+		for (;;)
+		{
+			seq = SeqLock::ReadBegin(&snapshot.nSeq);
+			for (int w = 0;w < SNAPSHOT_WORDS;w++)
+			{
+				copy[w] = snapshot.word[w];
+				if (w == yield_at)
+					sched_yield();
+			}
+			if (!SeqLock::ReadRetry(&snapshot.nSeq,seq))
+				break;
+			reader->retries++;
+			yield_at = -1;
+		}
+		for (int w = 0;w < SNAPSHOT_WORDS;w++)
+			if (copy[w] != copy[0] * (w + 1))
+				reader->errors++;
+		if (copy[0] < last)
+			reader->errors++;
+		last = copy[0];
+		__atomic_store_n(&reader->reads,reader->reads + 1,__ATOMIC_RELAXED);
+
+		v = value_in.Read();
+		if ((v >> 24) != 0 || (v & 0xFF) != ((v >> 8) & 0xFF) || (v & 0xFF) != ((v >> 16) & 0xFF))
+			reader->value_errors++;
+	}
+	return NULL;
+}
+
+int main(void)
+{
+pthread_t	writer,reader_thread[READERS];
+uint32_t		reads = 0,retries = 0;
+
+	for (int r = 0;r < READERS;r++)
+	{
+		reader[r].seed = 808 + r;
+		CHECK_EQ(pthread_create(&reader_thread[r],NULL,Reader,&reader[r]),0);
+	}
+	CHECK_EQ(pthread_create(&writer,NULL,Writer,NULL),0);
+	pthread_join(writer,NULL);
+	for (int r = 0;r < READERS;r++)
+	{
+		pthread_join(reader_thread[r],NULL);
+		CHECK_EQ(reader[r].errors,0);
+		CHECK_EQ(reader[r].value_errors,0);
+		CHECK(reader[r].reads > 0);
+		reads += reader[r].reads;
+		retries += reader[r].retries;
+	}
+	CHECK(retries > 0);
+	CHECK_EQ(snapshot.nSeq,2 * writes);
+	CHECK_EQ(snapshot.word[SNAPSHOT_WORDS - 1],writes * SNAPSHOT_WORDS);
+	// the byte beyond the 3 bytes of the value is not written
+	CHECK_EQ(value,SENTINEL | (writes & 0xFF) * 0x010101u);
+	CHECK_EQ(value_in.Read(),(writes & 0xFF) * 0x010101u);
+	printf("%u writes, %d readers: %u snapshots, %u retries\n",writes,READERS,reads,retries);
+	return HOST_TEST_RESULT();
+}
@@ -0,0 +1,163 @@
+/*
+ * test_stop_graph.cpp
+ *
+ *  Stop of the cleaning devices (user-025) with scripted stop times in place
+ *  of the devices: the stages are those of CleaningUnitMgr::StopCleaning.
+ *  The devices are stopped at once, a lift after the motor of its device.
+ *  The stop takes as long as the slowest chain instead of the sum of the
+ *  devices, also if devices never report the stop. A device failing to stop
+ *  still lets its lift move up. Prints the stop times of both
+ */
+
+#include <string.h>
+#include "CleaningUnitMgr.h"
+#include "BootGraph.h"
+#include "host_test.h"
+
+#define POLL_MS				10						// STOP_POLL_PERIOD of CleaningUnitMgr
+#define NEVER					UINT32_MAX
+#define MAX_MS					(10 * MAX_TIME_DEVICE_READY)
+
+typedef struct
+{
+	uint32_t		stop_ms[BOOT_MAX_STAGES];			// after the stop request, NEVER if not
+	bool			fail[BOOT_MAX_STAGES];
+	uint32_t		now;
+	BOOT_Graph_t	*graph;
+} Script_t;
+
+static BOOT_StageDef_t		stages[BOOT_MAX_STAGES];
+static unsigned				n_stages;
+
+static bool ScriptStop(void *ctx,unsigned stage)
+{
+Script_t		*script = (Script_t *)ctx;
+
+	return !script->fail[stage];
+}
+
+static bool ScriptStopped(void *ctx,unsigned stage)
+{
+Script_t		*script = (Script_t *)ctx;
+
+	return script->stop_ms[stage] != NEVER && script->now - script->graph->stage[stage].started >= script->stop_ms[stage];
+}
+
+static unsigned Stage(const char *name)
+{
+	for (unsigned i = 0;i < n_stages;i++)
+		if (strcmp(stages[i].name,name) == 0)
+			return i;
+	printf("no stage %s\n",name);
+	host_test_failed++;
+	return 0;
+}
+
+/*!
+ ******************************************************************************
+ *	Runs the stop as StopCleaning does and checks the order of the stages
+ * \return        duration of the stop in ms
+ ******************************************************************************
+*/
+static uint32_t Run(BOOT_Graph_t *g,Script_t *script)
+{
+	script->graph = g;
+	script->now = 0;
+	CHECK(BOOT_Init(g,stages,n_stages,script,0));
+	while (!BOOT_Step(g,script->now) && script->now < MAX_MS)
+		script->now += POLL_MS;
+	CHECK(BOOT_Finished(g));
+	for (unsigned i = 0;i < n_stages;i++)
+	{
+		if (stages[i].after == 0)
+			CHECK_EQ(g->stage[i].started,0);
+		for (unsigned dep = 0;dep < n_stages;dep++)
+			if ((stages[i].after & BOOT_STAGE(dep)) != 0)
+				CHECK(g->stage[i].started >= g->stage[dep].finished);
+	}
+	return script->now;
+}
+
+/*!
+ ******************************************************************************
+ *	Duration of the former stop: one device after the other, each polled until
+ * it has stopped or MAX_TIME_DEVICE_READY has elapsed
+ ******************************************************************************
+*/
+static uint32_t Sequential(const Script_t *script)
+{
+uint32_t		t = 0;
+
+	for (unsigned i = 0;i < n_stages;i++)
+		t += script->stop_ms[i] < MAX_TIME_DEVICE_READY ? script->stop_ms[i] : MAX_TIME_DEVICE_READY;
+	return t;
+}
+
+int main(void)
+{
+const BOOT_StageDef_t	*unit = CleaningUnitMgr::GetStopStages(&n_stages);
+BOOT_Graph_t				g;
+Script_t						script;
+unsigned						brush,suction,pump,brush_lift,suction_lift;
+uint32_t						t,expected;
+
+	CHECK(n_stages <= BOOT_MAX_STAGES);
+	CHECK(BOOT_Init(&g,unit,n_stages,nullptr,0));
+	for (unsigned i = 0;i < n_stages;i++)
+	{
+		stages[i] = unit[i];
+		stages[i].start = ScriptStop;
+		stages[i].ready = ScriptStopped;
+		CHECK_EQ(stages[i].timeout,MAX_TIME_DEVICE_READY);
+	}
+	brush = Stage("Brush");
+	suction = Stage("Suction");
+	pump = Stage("WaterPump");
+	brush_lift = Stage("BrushLift");
+	suction_lift = Stage("SuctionLift");
+	CHECK_EQ(stages[brush_lift].after,BOOT_STAGE(brush));
+	CHECK_EQ(stages[suction_lift].after,BOOT_STAGE(suction));
+
+	// ramps of the motors, the lifts move up
+	memset(&script,0,sizeof(script));
+	script.stop_ms[brush] = 2500;
+	script.stop_ms[suction] = 4000;
+	script.stop_ms[pump] = 100;
+	script.stop_ms[brush_lift] = 3000;
+	script.stop_ms[suction_lift] = 3000;
+	t = Run(&g,&script);
+	expected = 4000 + 3000;
+	CHECK(t >= expected && t < expected + 3 * POLL_MS);
+	for (unsigned i = 0;i < n_stages;i++)
+		CHECK_EQ(g.stage[i].state,BOOT_DONE);
+	CHECK(g.stage[pump].finished <= 100 + POLL_MS);
+	printf("stop after %u ms, one after the other %u ms\n",t,Sequential(&script));
+	CHECK(t < Sequential(&script));
+
+	// the brush never reports the stop: its lift after the timeout, the others
+	// are not held up
+	script.stop_ms[brush] = NEVER;
+	t = Run(&g,&script);
+	CHECK_EQ(g.stage[brush].state,BOOT_TIMEOUT);
+	CHECK_EQ(g.stage[brush_lift].state,BOOT_DONE);
+	CHECK(g.stage[suction_lift].finished < 4000 + 3000 + 3 * POLL_MS);
+	expected = MAX_TIME_DEVICE_READY + 3000;
+	CHECK(t >= expected && t < expected + 3 * POLL_MS);
+
+	// no device reports the stop: two timeouts instead of five
+	for (unsigned i = 0;i < n_stages;i++)
+		script.stop_ms[i] = NEVER;
+	t = Run(&g,&script);
+	CHECK(t >= 2 * MAX_TIME_DEVICE_READY && t < 2 * MAX_TIME_DEVICE_READY + 3 * POLL_MS);
+	printf("stop without feedback after %u ms, one after the other %u ms\n",t,Sequential(&script));
+
+	// the stop request of the suction fails: its lift moves up anyway
+	memset(&script,0,sizeof(script));
+	script.fail[suction] = true;
+	script.stop_ms[suction_lift] = 3000;
+	t = Run(&g,&script);
+	CHECK_EQ(g.stage[suction].state,BOOT_FAILED);
+	CHECK_EQ(g.stage[suction_lift].state,BOOT_DONE);
+	CHECK_EQ(g.stage[suction_lift].started,0);
+	return HOST_TEST_RESULT();
+}
@@ -0,0 +1,18 @@
+/*
+ * test_support.c
+ *
+ *  Globals of main.cpp used by the firmware, for the tests which do not link
+ *  the application
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "cmsis_os2.h"
+#include "host_test.h"
+
+TaskHandle_t				TaskComm;
+uint32_t						error_flags = 0;
+osThreadId_t				sysThread = NULL;
+traceString					dbgChannel;
+
+int							host_test_failed = 0;
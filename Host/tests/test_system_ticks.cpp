@@ -0,0 +1,235 @@
+/*
+ * test_system_ticks.cpp
+ *
+ *  System time of board-SysTime.c (user-011) on a model of PIT0. The file is
+ *  compiled here with PIT pointing to a channel whose counter advances by a
+ *  random number of counts at each read of CVAL or TFLG. At any read with
+ *  the flag set the PIT0 interrupt may run BOARD_SystemTimeTick (a tick in
+ *  the middle of BOARD_getSystemTicks makes it retry), or be held back by
+ *  masked interrupts as in a higher priority interrupt (the reader adds the
+ *  period itself). The ns, us and ms getters give the time of the counter at
+ *  one of their reads and never go back, with the scales of the bus clock and
+ *  with the division used when BOARD_TimeScaleInit finds no scale
+ */
+
+#include "board.h"
+#include "host_test.h"
+
+#define READS					200000
+
+// ----------------------------------------------------------------------------
+//! \brief State of the PIT0 model, the time is in counts since power up
+// ----------------------------------------------------------------------------
+typedef struct
+{
+	uint64_t		now;
+	uint64_t		ticks;						// periods cleared by the interrupt
+	uint32_t		period;						// LDVAL + 1
+	uint32_t		max_step;					// counts elapsing at a read
+	bool			reading;						// in a getter of the test
+	uint32_t		retries;						// ticks in a getter
+	uint32_t		flag_reads;					// flag seen set by a getter
+	uint32_t		held;							// ticks held back by masked interrupts
+} SIM_PIT_t;
+
+static SIM_PIT_t		sim_pit_state;
+static uint32_t		seed = 1111;
+
+static uint32_t Random(uint32_t lo,uint32_t hi)
+{
+	seed = seed * 1103515245u + 12345u;
+	return lo + (seed >> 8) % (hi - lo + 1);
+}
+
+static bool SIM_PIT_Flag(void)
+{
+	return sim_pit_state.now / sim_pit_state.period > sim_pit_state.ticks;
+}
+
+static void SIM_PIT_Irq(void);
+
+/*!
+ ******************************************************************************
+ *	A read of the counter or the flag: the interrupt of a set flag may run
+ * first (before the next reload at the latest), then the counts elapse
+ ******************************************************************************
+*/
+static void SIM_PIT_Step(void)
+{
+uint64_t		limit;
+
+	if (SIM_PIT_Flag())
+	{
+		limit = (sim_pit_state.ticks + 2) * sim_pit_state.period - 1;
+		if (Random(0,3) == 0 || sim_pit_state.now >= limit)
+		{
+			if (__get_PRIMASK() != 0)
+				sim_pit_state.held++;
+			SIM_NVIC_Raise(PIT0_IRQn,SIM_PIT_Irq);
+		}
+	}
+	sim_pit_state.now += Random(0,sim_pit_state.max_step);
+	// the interrupt runs before the flag is set a second time
+	limit = (sim_pit_state.ticks + 2) * sim_pit_state.period - 1;
+	if (sim_pit_state.now > limit)
+		sim_pit_state.now = limit;
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Current value register, counts down from LDVAL
+// ----------------------------------------------------------------------------
+struct SIM_PIT_CVAL
+{
+	operator uint32_t() const
+	{
+		uint32_t	value = sim_pit_state.period - 1 - (uint32_t)(sim_pit_state.now % sim_pit_state.period);
+
+		SIM_PIT_Step();
+		return value;
+	}
+};
+
+// ----------------------------------------------------------------------------
+//! \brief Flag register, written with 1 to clear the flag
+// ----------------------------------------------------------------------------
+struct SIM_PIT_TFLG
+{
+	SIM_PIT_TFLG &operator=(uint32_t value)
+	{
+		if (value & PIT_TFLG_TIF_MASK)
+			sim_pit_state.ticks = sim_pit_state.now / sim_pit_state.period;
+		return *this;
+	}
+	operator uint32_t() const
+	{
+		uint32_t	value = SIM_PIT_Flag() ? PIT_TFLG_TIF_MASK : 0;
+
+		if (value != 0 && sim_pit_state.reading)
+			sim_pit_state.flag_reads++;
+		SIM_PIT_Step();
+		return value;
+	}
+};
+
+// ----------------------------------------------------------------------------
+//! \brief The registers of PIT_Type used by board-SysTime.c
+// ----------------------------------------------------------------------------
+struct SIM_PIT_Regs
+{
+	struct
+	{
+		uint32_t			LDVAL;
+		SIM_PIT_CVAL	CVAL;
+		SIM_PIT_TFLG	TFLG;
+	} CHANNEL[1];
+};
+
+static SIM_PIT_Regs		sim_pit;
+
+#undef PIT
+#define PIT						(&sim_pit)
+
+#include "board-SysTime.c"
+
+static void SIM_PIT_Irq(void)
+{
+	if (sim_pit_state.reading)
+		sim_pit_state.retries++;
+	BOARD_SystemTimeTick();
+}
+
+// ----------------------------------------------------------------------------
+//! \brief A getter and the time of its unit for a number of counts
+// ----------------------------------------------------------------------------
+typedef struct
+{
+	const char		*name;
+	uint64_t			(*get)(void);
+	uint64_t			unit;
+} Getter_t;
+
+static const Getter_t	getters[] = {
+	{ "ns",	BOARD_getSystemTime_ns,	1000000000ULL },
+	{ "us",	BOARD_getSystemTime_us,	1000000ULL },
+	{ "ms",	BOARD_getSystemTime_ms,	1000ULL },
+};
+
+static uint64_t Expected(const Getter_t *getter,uint32_t clock,uint64_t counts)
+{
+	return counts / sim_pit_state.period * PIT0_PERIOD * getter->unit / 1000 +
+		counts % sim_pit_state.period * getter->unit / clock;
+}
+
+/*!
+ ******************************************************************************
+ *	Random calls of the getters, a quarter with the interrupts masked
+ ******************************************************************************
+*/
+static void TestGetters(uint32_t clock)
+{
+uint64_t		last[3] = { 0, 0, 0 };
+uint64_t		before,after,t;
+uint32_t		primask = 0;
+bool			masked;
+
+	sim_pit_state.retries = 0;
+	sim_pit_state.flag_reads = 0;
+	sim_pit_state.held = 0;
+	for (int i = 0;i < READS && !host_test_failed;i++)
+	{
+		const Getter_t	*getter = &getters[Random(0,2)];
+
+		masked = Random(0,3) == 0;
+		if (masked)
+			primask = DisableGlobalIRQ();
+		before = sim_pit_state.now;
+		sim_pit_state.reading = true;
+		t = getter->get();
+		sim_pit_state.reading = false;
+		after = sim_pit_state.now;
+		if (t < Expected(getter,clock,before) || t > Expected(getter,clock,after) || t < last[getter - getters])
+		{
+			printf("%s after %d reads: %llu, %llu..%llu expected, last %llu\n",getter->name,i,(unsigned long long)t,
+				(unsigned long long)Expected(getter,clock,before),(unsigned long long)Expected(getter,clock,after),
+				(unsigned long long)last[getter - getters]);
+			host_test_failed++;
+		}
+		last[getter - getters] = t;
+		if (masked)
+			EnableGlobalIRQ(primask);
+	}
+	// the ticks of the interrupt
+	if (SIM_PIT_Flag())
+		SIM_NVIC_Raise(PIT0_IRQn,SIM_PIT_Irq);
+	CHECK_EQ(Now(),sim_pit_state.now / sim_pit_state.period);
+	CHECK(sim_pit_state.retries > 0);
+	CHECK(sim_pit_state.flag_reads > 0);
+	CHECK(sim_pit_state.held > 0);
+}
+
+int main(void)
+{
+uint32_t		clock;
+
+	BOARD_InitBootClocks();
+	clock = CLOCK_GetBusClkFreq();
+	NVIC_SetPriority(PIT0_IRQn,PIT0_INT_PRIORITY);
+	NVIC_EnableIRQ(PIT0_IRQn);
+	CHECK(clock != 0);
+	sim_pit.CHANNEL[0].LDVAL = MSEC_TO_COUNT(PIT0_PERIOD,clock) - 1;
+	sim_pit_state.period = sim_pit.CHANNEL[0].LDVAL + 1;
+	sim_pit_state.max_step = sim_pit_state.period / 8;
+
+	// the bus clock has a scale
+	CHECK(BOARD_InitSystemTime());
+	TestGetters(clock);
+
+	// no scale for the longest period: the getters divide
+	sim_pit.CHANNEL[0].LDVAL = 0xFFFFFFFE;
+	CHECK(!BOARD_InitSystemTime());
+	sim_pit.CHANNEL[0].LDVAL = sim_pit_state.period - 1;
+	TestGetters(clock);
+	printf("%u Hz: %u ticks in a getter, %u flags seen by a getter, %u ticks held back\n",clock,
+		sim_pit_state.retries,sim_pit_state.flag_reads,sim_pit_state.held);
+	return HOST_TEST_RESULT();
+}
@@ -0,0 +1,89 @@
+/*
+ * test_system_time.c
+ *
+ *  Division-free conversion of the PIT0 counts (user-011): for every count of
+ *  a period and the bus clocks of the MK22 the scale gives exactly the
+ *  floor(counts * unit / freq) of the former 64 bits division, plus the cost
+ *  of both on the host. Longer periods may have no exact scale (ns of 10 ms),
+ *  BOARD_TimeScaleInit must refuse them then
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "board.h"
+#include "board-Time.h"
+#include "host_test.h"
+
+#define BENCH_LOOPS			10000000
+
+static const uint32_t	freqs[] = { 60000000,50000000,48000000,40000000,20971520,24000000,12000000 };
+static const uint32_t	periods_ms[] = { PIT0_PERIOD,10 };
+static const uint32_t	units[] = { 1000000000UL,1000000UL,1000UL };
+
+static volatile uint64_t	sink;
+
+/*!
+ ******************************************************************************
+ *	All counts of one period, stops at the first mismatch
+ * \return        false if there is no scale
+ ******************************************************************************
+*/
+static bool CheckScale(uint32_t unit,uint32_t freq,uint32_t counts)
+{
+BOARD_TimeScale_t	scale;
+uint64_t				last = 0;
+
+	if (!BOARD_TimeScaleInit(&scale,unit,freq,counts))
+		return false;
+	for (uint32_t c = 0;c < counts;c++)
+	{
+		uint64_t		t = BOARD_TimeScale(&scale,c);
+
+		if (t != (uint64_t)c * unit / freq || t < last)
+		{
+			printf("unit %u, %u Hz, count %u: %llu instead of %llu\n",unit,freq,c,
+				(unsigned long long)t,(unsigned long long)((uint64_t)c * unit / freq));
+			host_test_failed++;
+			break;
+		}
+		last = t;
+	}
+	return true;
+}
+
+int main(void)
+{
+BOARD_TimeScale_t	scale;
+uint64_t				t0,t_scale,t_div;
+uint32_t				freq = 60000000;
+uint32_t				counts = freq / 1000 * PIT0_PERIOD;
+
+	for (unsigned f = 0;f < sizeof(freqs) / sizeof(freqs[0]);f++)
+		for (unsigned p = 0;p < sizeof(periods_ms) / sizeof(periods_ms[0]);p++)
+			for (unsigned u = 0;u < sizeof(units) / sizeof(units[0]);u++)
+			{
+				bool	ok = CheckScale(units[u],freqs[f],(uint32_t)((uint64_t)freqs[f] * periods_ms[p] / 1000));
+
+				// the period of the firmware always has a scale
+				CHECK(ok || periods_ms[p] != PIT0_PERIOD);
+			}
+
+	// invalid parameters
+	CHECK(!BOARD_TimeScaleInit(&scale,1000,0,1000));
+	CHECK(!BOARD_TimeScaleInit(&scale,1000,1000,0));
+	CHECK_EQ(scale.mult,0);
+
+	// cost of a conversion of the ns time, as BOARD_getSystemTime_ns does it
+	CHECK(BOARD_TimeScaleInit(&scale,1000000000UL,freq,counts));
+	t0 = HOST_TimeNs();
+	for (uint32_t i = 0;i < BENCH_LOOPS;i++)
+		sink = BOARD_TimeScale(&scale,i % counts);
+	t_scale = HOST_TimeNs() - t0;
+	t0 = HOST_TimeNs();
+	for (uint32_t i = 0;i < BENCH_LOOPS;i++)
+		sink = (uint64_t)(i % counts) * 1000000000ULL / *(volatile uint32_t *)&freq;
+	t_div = HOST_TimeNs() - t0;
+	printf("count to ns: %.2f ns by scale, %.2f ns by division\n",
+		(double)t_scale / BENCH_LOOPS,(double)t_div / BENCH_LOOPS);
+	return HOST_TEST_RESULT();
+}
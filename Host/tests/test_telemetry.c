@@ -0,0 +1,304 @@
+/*
+ * test_telemetry.c
+ *
+ *  Frame packing of Telemetry.c (user-019) for a known catalogue: the frames
+ *  of a subscription hold seq, tick and the values of the signals due in the
+ *  order of the subscription, their length is given by TLM_FrameLen, skipped
+ *  periods keep seq and the decimation in step, TLM_BytesPerSecond is the
+ *  rate of the frames sampled over a second. Invalid subscriptions are
+ *  rejected and leave the stream unchanged. Prints the link rate of a few
+ *  signal sets and the cost of a sample on the host
+ */
+
+#include <string.h>
+#include "Telemetry.h"
+#include "host_test.h"
+
+#define TICK_RATE				1000
+#define SIG_U16				1
+#define SIG_U32				2
+#define SIG_U8					3
+#define SIG_FAILING			4					// read fails for odd indices
+#define BENCH_SAMPLES		1000000
+
+static bool ReadU16(uint8_t index,uint8_t *value)
+{
+	value[0] = 0x10 | index;
+	value[1] = 0x16;
+	return true;
+}
+
+static bool ReadU32(uint8_t index,uint8_t *value)
+{
+	for (int i = 0;i < 4;i++)
+		value[i] = (uint8_t)(0x20 + 4 * index + i);
+	return true;
+}
+
+static bool ReadU8(uint8_t index,uint8_t *value)
+{
+	value[0] = 0x80 | index;
+	return true;
+}
+
+static bool ReadFailing(uint8_t index,uint8_t *value)
+{
+	value[0] = 0xEE;						// garbage, replaced by 0 when failed
+	value[1] = 0xEE;
+	return (index & 1) == 0;
+}
+
+static const TLM_SignalDef_t		catalogue[] = {
+	{ SIG_U16,			2,	ReadU16 },
+	{ SIG_U32,			4,	ReadU32 },
+	{ SIG_U8,			1,	ReadU8 },
+	{ SIG_FAILING,		2,	ReadFailing },
+};
+
+typedef struct {
+	uint8_t		id;
+	uint8_t		index;
+	uint8_t		decimation;
+} Signal_t;
+
+static int Subscribe(TLM_Stream_t *stream,uint16_t period_ms,const Signal_t *signal,int n,uint32_t now)
+{
+uint8_t		data[TLM_MAX_SUBSCRIPTION_LEN + 3];
+int			len = 0;
+
+	data[len++] = (uint8_t)period_ms;
+	data[len++] = (uint8_t)(period_ms >> 8);
+	data[len++] = (uint8_t)n;
+	for (int i = 0;i < n;i++)
+	{
+		data[len++] = signal[i].id;
+		data[len++] = signal[i].index;
+		data[len++] = signal[i].decimation;
+	}
+	return TLM_Subscribe(stream,data,len,3,now,TICK_RATE);
+}
+
+static int SignalSize(uint8_t id)
+{
+	for (int i = 0;i < (int)(sizeof(catalogue) / sizeof(catalogue[0]));i++)
+		if (catalogue[i].id == id)
+			return catalogue[i].size;
+	return 0;
+}
+
+/*!
+ ******************************************************************************
+ *	Builds the frame expected for a period: seq, tick and the values of the
+ * signals with (period % decimation) == 0
+ ******************************************************************************
+*/
+static int ExpectedFrame(const Signal_t *signal,int n,uint32_t period,uint16_t seq,uint32_t tick,uint8_t *frame)
+{
+int			len = TLM_HEADER_LEN;
+
+	frame[len++] = (uint8_t)seq;
+	frame[len++] = (uint8_t)(seq >> 8);
+	for (int i = 0;i < 4;i++)
+		frame[len++] = (uint8_t)(tick >> (8 * i));
+	for (int i = 0;i < n;i++)
+	{
+		if (period % signal[i].decimation != 0)
+			continue;
+		switch (signal[i].id)
+		{
+			case SIG_U16:
+				ReadU16(signal[i].index,frame + len);
+				break;
+			case SIG_U32:
+				ReadU32(signal[i].index,frame + len);
+				break;
+			case SIG_U8:
+				ReadU8(signal[i].index,frame + len);
+				break;
+			default:
+				if (!ReadFailing(signal[i].index,frame + len))
+					memset(frame + len,0,2);
+				break;
+		}
+		len += SignalSize(signal[i].id);
+	}
+	return len;
+}
+
+/*!
+ ******************************************************************************
+ *	Frames of each period compared with the expected layout, the sampling is
+ * late by a few periods now and then
+ ******************************************************************************
+*/
+static void TestLayout(void)
+{
+static const Signal_t	signal[] = {
+	{ SIG_U16,		2,	1 },
+	{ SIG_U32,		1,	2 },
+	{ SIG_FAILING,	1,	3 },
+	{ SIG_U8,		5,	5 },
+	{ SIG_FAILING,	4,	1 },
+};
+TLM_Stream_t		stream;
+uint8_t				frame[TLM_MAX_FRAME_LEN],expected[TLM_MAX_FRAME_LEN];
+uint32_t				now = 0xFFFFFF00u,period = 0,skipped = 0,failed = 0;
+int					n = sizeof(signal) / sizeof(signal[0]),len,expected_len;
+
+	TLM_Init(&stream,catalogue,sizeof(catalogue) / sizeof(catalogue[0]));
+	CHECK_EQ(TLM_TimeToNext(&stream,now),UINT32_MAX);
+	CHECK_EQ(Subscribe(&stream,10,signal,n,now),0);
+	CHECK_EQ(stream.period,10);
+	CHECK_EQ(TLM_TimeToNext(&stream,now),0);
+	// the tick wraps during the test
+	for (int i = 0;i < 200;i++)
+	{
+		if (i % 37 == 36)
+		{
+			// 3 periods late: they are skipped
+			now += 3 * 10;
+			period += 3;
+			skipped += 3;
+		}
+		expected_len = ExpectedFrame(signal,n,period,(uint16_t)period,now + 4,expected);
+		failed += period % 3 == 0;			// SIG_FAILING index 1, decimation 3
+		// too small for the values: nothing is sampled
+		CHECK_EQ(TLM_Sample(&stream,now + 4,frame,expected_len - 1),0);
+		CHECK_EQ(TLM_FrameLen(&stream),expected_len);
+		len = TLM_Sample(&stream,now + 4,frame,sizeof(frame));
+		CHECK_EQ(len,expected_len);
+		CHECK(memcmp(frame + TLM_HEADER_LEN,expected + TLM_HEADER_LEN,len - TLM_HEADER_LEN) == 0);
+		CHECK_EQ(TLM_Sample(&stream,now + 9,frame,sizeof(frame)),0);
+		CHECK_EQ(TLM_TimeToNext(&stream,now + 4),6);
+		if (host_test_failed)
+		{
+			printf("period %u\n",period);
+			return;
+		}
+		now += 10;
+		period++;
+	}
+	CHECK_EQ(stream.frames,200);
+	CHECK_EQ(stream.skipped,skipped);
+	CHECK_EQ(stream.failed,failed);
+	CHECK_EQ(stream.seq,(uint16_t)period);
+}
+
+/*!
+ ******************************************************************************
+ *	Invalid subscriptions leave the running one unchanged, n = 0 stops it
+ ******************************************************************************
+*/
+static void TestSubscribe(void)
+{
+static const Signal_t	valid[] = { { SIG_U16,0,1 },{ SIG_U8,0,4 } };
+static const Signal_t	unknown[] = { { SIG_U16,0,1 },{ 9,0,1 } };
+static const Signal_t	decimation0[] = { { SIG_U16,0,0 } };
+Signal_t				many[TLM_MAX_SIGNALS + 1];
+TLM_Stream_t		stream;
+uint8_t				data[3] = { 10,0,1 };
+
+	for (int i = 0;i < TLM_MAX_SIGNALS + 1;i++)
+	{
+		many[i].id = SIG_U32;
+		many[i].index = (uint8_t)i;
+		many[i].decimation = 1;
+	}
+	TLM_Init(&stream,catalogue,sizeof(catalogue) / sizeof(catalogue[0]));
+	CHECK_EQ(Subscribe(&stream,20,valid,2,100),0);
+	CHECK_EQ(TLM_TimeToNext(&stream,100),0);
+	CHECK_EQ(TLM_Subscribe(&stream,data,2,0,100,TICK_RATE),TLM_ERR_LENGTH);
+	CHECK_EQ(TLM_Subscribe(&stream,data,3,0,100,TICK_RATE),TLM_ERR_LENGTH);
+	CHECK_EQ(Subscribe(&stream,20,unknown,2,100),TLM_ERR_SIGNAL);
+	CHECK_EQ(Subscribe(&stream,20,decimation0,1,100),TLM_ERR_PARAMETER);
+	CHECK_EQ(Subscribe(&stream,0,valid,2,100),TLM_ERR_PARAMETER);
+	CHECK_EQ(Subscribe(&stream,20,many,TLM_MAX_SIGNALS + 1,100),TLM_ERR_PARAMETER);
+	CHECK(stream.active);
+	CHECK_EQ(stream.n,2);
+	CHECK_EQ(stream.period,20);
+	// frame of 6 + 6 + 4 * n bytes: up to 29 signals of 4 bytes fit, 16 are allowed
+	CHECK_EQ(Subscribe(&stream,20,many,TLM_MAX_SIGNALS,100),0);
+	CHECK_EQ(TLM_FrameLen(&stream),TLM_HEADER_LEN + 6 + 4 * TLM_MAX_SIGNALS);
+	CHECK_EQ(stream.source,3);
+	CHECK_EQ(Subscribe(&stream,20,valid,0,100),0);
+	CHECK(!stream.active);
+	CHECK_EQ(TLM_BytesPerSecond(&stream,TICK_RATE),0);
+	CHECK_EQ(TLM_Sample(&stream,200,data,sizeof(data)),0);
+}
+
+/*!
+ ******************************************************************************
+ *	The rate of TLM_BytesPerSecond against the frames of a second (packet
+ * framing included)
+ ******************************************************************************
+*/
+static uint32_t MeasureRate(const Signal_t *signal,int n,uint16_t period_ms)
+{
+TLM_Stream_t		stream;
+uint8_t				frame[TLM_MAX_FRAME_LEN];
+uint32_t				bytes = 0,rate,tick;
+int					len;
+
+	TLM_Init(&stream,catalogue,sizeof(catalogue) / sizeof(catalogue[0]));
+	CHECK_EQ(Subscribe(&stream,period_ms,signal,n,0),0);
+	for (tick = 0;tick < TICK_RATE;tick++)
+	{
+		len = TLM_Sample(&stream,tick,frame,sizeof(frame));
+		if (len != 0)
+			bytes += len + TLM_FRAME_OVERHEAD;
+	}
+	rate = TLM_BytesPerSecond(&stream,TICK_RATE);
+	CHECK_EQ(rate,bytes);
+	return rate;
+}
+
+static void TestRate(void)
+{
+static const Signal_t	one_adc[] = { { SIG_U16,0,1 } };
+static const Signal_t	service[] = {
+	{ SIG_U16,0,1 },{ SIG_U16,1,1 },{ SIG_U16,2,1 },{ SIG_U16,3,1 },
+	{ SIG_U32,0,2 },{ SIG_U8,0,5 },{ SIG_U8,1,10 },
+};
+static const Signal_t	fast[] = {
+	{ SIG_U16,0,1 },{ SIG_U16,1,1 },{ SIG_U32,0,4 },{ SIG_U32,1,4 },
+};
+
+uint32_t				rate;
+
+	// 12 + 2 bytes and the packet framing at 100 Hz
+	rate = MeasureRate(one_adc,1,10);
+	CHECK_EQ(rate,(TLM_HEADER_LEN + 6 + 2 + TLM_FRAME_OVERHEAD) * 100);
+	printf("1 ADC channel at 100 Hz: %u bytes/s\n",rate);
+	printf("4 ADC, position, state, counter at 100 Hz: %u bytes/s\n",MeasureRate(service,7,10));
+	printf("2 ADC at 1 kHz, 2 words at 250 Hz: %u bytes/s\n",MeasureRate(fast,4,1));
+}
+
+static void Bench(void)
+{
+static const Signal_t	service[] = {
+	{ SIG_U16,0,1 },{ SIG_U16,1,1 },{ SIG_U16,2,1 },{ SIG_U16,3,1 },
+	{ SIG_U32,0,2 },{ SIG_U8,0,5 },{ SIG_U8,1,10 },
+};
+TLM_Stream_t		stream;
+uint8_t				frame[TLM_MAX_FRAME_LEN];
+uint64_t				t0;
+uint32_t				bytes = 0;
+
+	TLM_Init(&stream,catalogue,sizeof(catalogue) / sizeof(catalogue[0]));
+	CHECK_EQ(Subscribe(&stream,1,service,7,0),0);
+	t0 = HOST_TimeNs();
+	for (uint32_t tick = 0;tick < BENCH_SAMPLES;tick++)
+		bytes += TLM_Sample(&stream,tick,frame,sizeof(frame));
+	t0 = HOST_TimeNs() - t0;
+	CHECK_EQ(stream.frames,BENCH_SAMPLES);
+	printf("%.1f ns per frame of %.1f bytes on the host\n",(double)t0 / BENCH_SAMPLES,(double)bytes / BENCH_SAMPLES);
+}
+
+int main(void)
+{
+	TestLayout();
+	TestSubscribe();
+	TestRate();
+	Bench();
+	return HOST_TEST_RESULT();
+}
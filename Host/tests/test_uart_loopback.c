@@ -0,0 +1,433 @@
+/*
+ * test_uart_loopback.c
+ *
+ *  DMA driven command interface (user-015): uart.c and uart-ring.c on the
+ *  eDMA/UART model, the command handler answers the pings of the host. A
+ *  burst is handed over at the idle line with three UART interrupts whatever
+ *  its length, the RX edge interrupt restarts the idle line detection, a
+ *  burst of a single byte waits for the next one. Bursts longer than the RX
+ *  ring and replies over the end of the TX ring arrive intact. An interrupt
+ *  does not wait for the TX queue or ring and counts the dropped packet, a
+ *  task waits. Prints the TX line use and the requests per second
+ */
+
+#include <string.h>
+#include "board.h"
+#include "clock_config.h"
+#include "CommandDefs.h"
+#include "CommandHandler.h"
+#include "CmdPacket.h"
+#include "Misc.h"
+#include "uart.h"
+#include "uart-ring.h"
+#include "sim_rtos.h"
+#include "sim_clock.h"
+#include "sim_isr.h"
+#include "sim_uart.h"
+#include "host_test.h"
+
+#define IN_FLIGHT				(CMD_PACKET_COUNT - 1)		// requests before a dispatch
+#define PING_LEN				10
+#define MAX_EXPECTED			32
+#define MAX_PACKET			256
+#define IDLE_BURSTS			200
+#define WRAP_ROUNDS			300
+#define LOOP_ROUNDS			2000
+#define ISR_PACKETS			(UART_TX_MAX_SEGMENTS + 4)
+#define LONG_PACKET			200
+#define STREAM_PACKETS		200
+
+typedef struct
+{
+	uint8_t		data[MAX_PACKET];
+	int			len;
+} Packet_t;
+
+extern TaskHandle_t	TaskComm;
+
+static Packet_t		expected[MAX_EXPECTED];
+static int				nr_expected;
+static int				frames_done;
+static uint32_t		seed = 1505;
+
+static uint32_t Random(uint32_t lo,uint32_t hi)
+{
+	seed = seed * 1103515245u + 12345u;
+	return lo + (seed >> 8) % (hi - lo + 1);
+}
+
+static void OnTick(TickType_t now,void *ctx)
+{
+	(void)now;
+	(void)ctx;
+	SIM_UART_Run();
+}
+
+static void Expect(const uint8_t *packet,int len)
+{
+	if (nr_expected < MAX_EXPECTED)
+	{
+		memcpy(expected[nr_expected].data,packet,len);
+		expected[nr_expected].len = len;
+	}
+	nr_expected++;
+}
+
+/*!
+ ******************************************************************************
+ *	Builds the frame of a ping with random parameters, often bytes which have
+ * to be stuffed, and expects its reply
+ * \return        frame length
+ ******************************************************************************
+*/
+static int Ping(uint8_t *frame,int max)
+{
+const uint8_t		special[] = { UART_SOP,UART_EOP,UART_ESC };
+uint8_t				packet[PING_LEN],reply[PING_LEN];
+
+	memset(packet,0,sizeof(packet));
+	packet[4] = CMD_SYSTEM;
+	packet[5] = SUB_SYS_REQUEST_PING;
+	MakeCommandHeader(reply,CMD_SYSTEM,CMD_ACK,SUB_SYS_REQUEST_PING,CMD_RX,BOARD_GetOwnAddress());
+	for (int i = 6;i < PING_LEN;i++)
+	{
+		packet[i] = Random(0,1) ? special[Random(0,2)] : (uint8_t)Random(0,255);
+		reply[i] = packet[i] ^ 0xFF;
+	}
+	Expect(reply,PING_LEN);
+	return UART_StuffFrame(frame,max,packet,PING_LEN,CRC16_Update(0,packet,PING_LEN));
+}
+
+/*!
+ ******************************************************************************
+ *	Bytes before a frame which the deframer drops (no SOP)
+ ******************************************************************************
+*/
+static int Noise(uint8_t *buf,int len)
+{
+	for (int i = 0;i < len;i++)
+	{
+		do
+			buf[i] = (uint8_t)Random(0,255);
+		while (buf[i] == UART_SOP);
+	}
+	return len;
+}
+
+/*!
+ ******************************************************************************
+ *	Deframes the bytes sent on the TX line, they must be the expected packets
+ * in order with a correct CRC
+ * \return        true if so
+ ******************************************************************************
+*/
+static bool CheckSent(void)
+{
+UART_Deframer_t	deframer;
+uint8_t				buf[MAX_PACKET + 2],line[256];
+int					n,len,got = 0;
+bool					ok = nr_expected <= MAX_EXPECTED;
+
+	UART_DeframerInit(&deframer,buf,sizeof(buf));
+	while ((n = SIM_UART_Sent(line,sizeof(line))) > 0)
+	{
+		for (int i = 0;i < n;i++)
+		{
+			if ((len = UART_Deframe(&deframer,line[i])) == 0)
+				continue;
+			if (len < 0 || got >= nr_expected || len != expected[got].len + 2 ||
+				 memcmp(buf,expected[got].data,expected[got].len) != 0 ||
+				 CRC16_Update(0,buf,len - 2) != (uint16_t)(buf[len - 2] | (buf[len - 1] << 8)))
+			{
+				printf("packet %d: length %d, %d expected\n",got,len,got < nr_expected ? expected[got].len + 2 : 0);
+				ok = false;
+			}
+			got++;
+		}
+	}
+	if (got != nr_expected)
+	{
+		printf("%d packets sent, %d expected\n",got,nr_expected);
+		ok = false;
+	}
+	nr_expected = 0;
+	if (!ok)
+		host_test_failed++;
+	return ok;
+}
+
+static uint32_t Notified(void)
+{
+uint32_t		bits = 0;
+
+	xTaskNotifyWait(0,0xFFFFFFFFu,&bits,0);
+	return bits;
+}
+
+static bool WaitsForBurst(void)
+{
+	return !(UART0->C2 & UART_C2_ILIE_MASK) && (UART0->BDH & UART_BDH_RXEDGIE_MASK);
+}
+
+/*!
+ ******************************************************************************
+ *	Bursts of a ping after noise of random length: each one is handed over at
+ * its idle line, with an interrupt at its first two bytes (RX edge) and one
+ * at the idle line. Then the UART waits for the edge of the next burst
+ ******************************************************************************
+*/
+static void TestIdleLine(void)
+{
+uint8_t		burst[UART_STUFFED_MAX(PING_LEN) + 100];
+uint32_t		irqs;
+int			len;
+
+	// the first burst after the initialization has no RX edge interrupts
+	len = Ping(burst,sizeof(burst));
+	SIM_UART_Receive(burst,len);
+	CHECK(WaitsForBurst());
+	CHECK(CommandHandler());
+	SIM_UART_Flush();
+	CheckSent();
+	Notified();
+	SIM_UART_ClearStats();
+	for (int i = 0;i < IDLE_BURSTS;i++)
+	{
+		len = Noise(burst,(int)Random(0,100));
+		len += Ping(burst + len,sizeof(burst) - len);
+		irqs = SIM_UART_GetStats()->uart_irqs;
+		SIM_UART_Receive(burst,len);
+		if (SIM_UART_GetStats()->uart_irqs - irqs != 3 || !WaitsForBurst() || Notified() != (1U << 0))
+		{
+			printf("burst %d of %d bytes: %u interrupts\n",i,len,SIM_UART_GetStats()->uart_irqs - irqs);
+			host_test_failed++;
+			return;
+		}
+		CommandHandler();
+		SIM_UART_Flush();
+		if (!CheckSent())
+			return;
+	}
+	CHECK_EQ(SIM_UART_GetStats()->rx_lost,0);
+}
+
+/*!
+ ******************************************************************************
+ *	A burst of one byte (the EOP of a frame) does not end at an idle line, it
+ * is handed over at the first edges of the next burst
+ ******************************************************************************
+*/
+static void TestSingleByte(void)
+{
+uint8_t		frame[2][UART_STUFFED_MAX(PING_LEN)];
+int			len[2];
+
+	len[0] = Ping(frame[0],sizeof(frame[0]));
+	len[1] = Ping(frame[1],sizeof(frame[1]));
+	SIM_UART_Receive(frame[0],len[0] - 1);
+	CHECK_EQ(Notified(),0);
+	SIM_UART_Receive(frame[0] + len[0] - 1,1);
+	CHECK(WaitsForBurst());
+	CHECK_EQ(Notified(),0);
+	SIM_UART_Receive(frame[1],len[1]);
+	CHECK_EQ(Notified(),1U << 0);
+	CHECK(CommandHandler());
+	SIM_UART_Flush();
+	CheckSent();
+}
+
+/*!
+ ******************************************************************************
+ *	Bursts longer than the RX ring, handed over by the half and full ring
+ * interrupts of the RX DMA. The replies wrap around the TX ring
+ ******************************************************************************
+*/
+static void TestRingWrap(void)
+{
+uint8_t		burst[3 * UART_RX_RING_LEN + IN_FLIGHT * UART_STUFFED_MAX(PING_LEN)];
+int			len;
+
+	SIM_UART_ClearStats();
+	for (int round = 0;round < WRAP_ROUNDS;round++)
+	{
+		len = Noise(burst,(int)Random(UART_RX_RING_LEN,3 * UART_RX_RING_LEN));
+		for (int n = (int)Random(1,IN_FLIGHT);n > 0;n--)
+			len += Ping(burst + len,sizeof(burst) - len);
+		SIM_UART_Receive(burst,len);
+		CommandHandler();
+		SIM_UART_Flush();
+		if (!CheckSent())
+			return;
+	}
+	CHECK(SIM_UART_GetStats()->rx_dma_irqs >= 2 * SIM_UART_GetStats()->rx_bytes / UART_RX_RING_LEN);
+	CHECK(SIM_UART_GetStats()->tx_bytes > 4 * UART_TX_RING_LEN);
+	CHECK_EQ(SIM_UART_GetStats()->rx_lost,0);
+}
+
+static void LongPacket(uint8_t *packet,int len,uint8_t seq)
+{
+	for (int i = 0;i < len;i++)
+	{
+		packet[i] = (uint8_t)(seq + i);
+		if (packet[i] == UART_SOP || packet[i] == UART_EOP || packet[i] == UART_ESC)
+			packet[i] = 0x55;
+	}
+}
+
+static void FrameDone(const uint8_t *frame)
+{
+	(void)frame;
+	frames_done++;
+}
+
+/*!
+ ******************************************************************************
+ *	Packets sent from an interrupt while the TX DMA has no time to send: the
+ * frames over the TX queue, then the packets over the TX ring are dropped and
+ * counted. A task waits for the DMA instead
+ ******************************************************************************
+*/
+static void TestTxDropped(void)
+{
+static uint8_t	frame[ISR_PACKETS][UART_STUFFED_MAX(PING_LEN)];		// sent without a copy
+uint8_t			packet[LONG_PACKET];
+uint32_t			dropped = UART_GetTxDropped(),prev;
+int				sent,len;
+
+	// queue full: UART_TX_MAX_SEGMENTS frames, the first one on the line
+	frames_done = 0;
+	prev = SIM_ISR_Enter(PIT1_IRQn);
+	for (int i = 0;i < ISR_PACKETS;i++)
+	{
+		LongPacket(packet,PING_LEN,(uint8_t)i);
+		len = UART_StuffPacketCMD(frame[i],sizeof(frame[i]),packet,PING_LEN);
+		CHECK_EQ(UART_SendFrameCMD(frame[i],len,FrameDone),i < UART_TX_MAX_SEGMENTS);
+		if (i < UART_TX_MAX_SEGMENTS)
+			Expect(packet,PING_LEN);
+	}
+	SIM_ISR_Exit(prev);
+	CHECK_EQ(UART_GetTxDropped() - dropped,ISR_PACKETS - UART_TX_MAX_SEGMENTS);
+	SIM_UART_Flush();
+	CHECK_EQ(frames_done,UART_TX_MAX_SEGMENTS);
+	CheckSent();
+
+	// ring full: each write needs room for the worst case of the frame
+	dropped = UART_GetTxDropped();
+	prev = SIM_ISR_Enter(PIT1_IRQn);
+	for (sent = 0;UART_GetTxDropped() == dropped;sent++)
+	{
+		LongPacket(packet,LONG_PACKET,(uint8_t)sent);
+		UART_SendPacketCMD(packet,LONG_PACKET);
+		if (UART_GetTxDropped() == dropped)
+			Expect(packet,LONG_PACKET);
+	}
+	SIM_ISR_Exit(prev);
+	CHECK(nr_expected > 0 && nr_expected < UART_TX_MAX_SEGMENTS);
+	SIM_UART_Flush();
+	CheckSent();
+
+	// a task waits for the TX DMA
+	dropped = UART_GetTxDropped();
+	for (int i = 0;i < ISR_PACKETS;i++)
+	{
+		LongPacket(packet,LONG_PACKET,(uint8_t)i);
+		UART_SendPacketCMD(packet,LONG_PACKET);
+		Expect(packet,LONG_PACKET);
+	}
+	CHECK_EQ(UART_GetTxDropped(),dropped);
+	SIM_UART_Flush();
+	CheckSent();
+}
+
+/*!
+ ******************************************************************************
+ *	Packets sent back to back by a task: the TX DMA interrupt starts the next
+ * segment at the end of the last one, the line has no gap
+ ******************************************************************************
+*/
+static void TestTxStream(void)
+{
+uint8_t		packet[64];
+uint64_t		t0,line_ns,byte_ns = SIM_UART_ByteNs();
+
+	SIM_UART_ClearStats();
+	t0 = SIM_Clock_ns();
+	for (int i = 0;i < STREAM_PACKETS;i++)
+	{
+		LongPacket(packet,sizeof(packet),(uint8_t)(3 * i));
+		UART_SendPacketCMD(packet,sizeof(packet));
+	}
+	SIM_UART_Flush();
+	line_ns = SIM_Clock_ns() - t0;
+	while (SIM_UART_Sent(packet,sizeof(packet)) > 0)
+	{
+	}
+	CHECK_EQ(SIM_UART_GetStats()->tx_busy_ns,(uint64_t)SIM_UART_GetStats()->tx_bytes * byte_ns);
+	CHECK(line_ns <= SIM_UART_GetStats()->tx_busy_ns + byte_ns);
+	printf("%u bytes in %d packets from a task: %.0f bytes/s, line %.0f bytes/s\n",SIM_UART_GetStats()->tx_bytes,
+		STREAM_PACKETS,(double)SIM_UART_GetStats()->tx_bytes * 1e9 / (double)line_ns,1e9 / (double)byte_ns);
+}
+
+/*!
+ ******************************************************************************
+ *	Loopback: IN_FLIGHT pings in a burst, the replies on the line
+ ******************************************************************************
+*/
+static void Bench(void)
+{
+uint8_t		burst[IN_FLIGHT * UART_STUFFED_MAX(PING_LEN)];
+uint64_t		t0,sim0;
+int			len,round;
+
+	t0 = HOST_TimeNs();
+	sim0 = SIM_Clock_ns();
+	for (round = 0;round < LOOP_ROUNDS;round++)
+	{
+		len = 0;
+		for (int n = 0;n < IN_FLIGHT;n++)
+			len += Ping(burst + len,sizeof(burst) - len);
+		SIM_UART_Receive(burst,len);
+		CommandHandler();
+		SIM_UART_Flush();
+		if (!CheckSent())
+			break;
+	}
+	t0 = HOST_TimeNs() - t0;
+	sim0 = SIM_Clock_ns() - sim0;
+	CHECK_EQ(round,LOOP_ROUNDS);
+	printf("%d pings in bursts of %d: %.0f requests/s on the line, %.0f requests/s through the host model\n",
+		LOOP_ROUNDS * IN_FLIGHT,IN_FLIGHT,(double)LOOP_ROUNDS * IN_FLIGHT * 1e9 / (double)sim0,
+		(double)LOOP_ROUNDS * IN_FLIGHT * 1e9 / (double)t0);
+}
+
+static void Dummy(void *arg)
+{
+	(void)arg;
+}
+
+int main(void)
+{
+UART_descriptor_t		*desc;
+
+	SIM_RTOS_Reset();
+	SIM_RTOS_SetSchedulerState(taskSCHEDULER_RUNNING);
+	BOARD_InitBootClocks();
+	BOARD_Init();
+	SIM_RTOS_SetTickHook(OnTick,NULL);
+	CHECK(xTaskCreate(Dummy,"COMM",256,NULL,2,&TaskComm) == pdPASS);
+	SIM_RTOS_SetCurrentTask(TaskComm);
+	CHECK(InitCommandHandler());
+	// as BOARD_InitUART0
+	desc = GetUARTdescriptorFromPtr(UART0);
+	CHECK(desc != NULL);
+	UART_InitIRQ(desc,desc->IRQ_enabled);
+	CHECK(UART_InitUart(desc));
+
+	TestIdleLine();
+	TestSingleByte();
+	TestRingWrap();
+	TestTxDropped();
+	TestTxStream();
+	Bench();
+	return HOST_TEST_RESULT();
+}
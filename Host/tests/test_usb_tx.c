@@ -0,0 +1,414 @@
+/*
+ * test_usb_tx.c
+ *
+ *  Transmit queue of the USB CDC bulk-IN endpoint (user-016) on a simulated
+ *  full speed endpoint: 19 packets of 64 bytes per 1 ms frame, the end of a
+ *  transfer raises the USB interrupt which calls VCOM_TxComplete. The writer
+ *  follows USB_TxWrite of virtual_com.c: it appends and starts the transfers
+ *  with the interrupts enabled, masks them only to claim the endpoint, and is
+ *  preempted by the completion at random points. The bytes arrive in order,
+ *  a stream is sent in full buffers, a transfer on a packet boundary ends
+ *  with a zero length packet, a failed start drops its buffer. Prints the
+ *  bytes/s of a stream and the latency of responses
+ */
+
+#include <string.h>
+#include "fsl_common.h"
+#include "virtual_com_tx.h"
+#include "sim_clock.h"
+#include "host_test.h"
+
+#define PACKET_SIZE			64
+#define BUFFER_SIZE			512
+#define PACKETS_PER_FRAME	19
+#define PACKET_NS				(1000000ULL / PACKETS_PER_FRAME)
+#define STREAM_BYTES			(1024 * 1024)
+#define RESPONSES				5000
+#define MAX_RESPONSE			300
+#define LOG_SIZE				(2 * STREAM_BYTES)
+
+typedef struct
+{
+	bool			busy;
+	bool			fail;						// the next start fails
+	uint64_t		done_ns;					// end of the transfer in progress
+	uint32_t		transfers;
+	uint32_t		zlps;
+	uint32_t		partial;					// transfers which are not full buffers
+	uint32_t		masked_sends;			// started by the task with the interrupts masked
+	uint64_t		complete_ns;			// end of the last transfer completed
+	uint8_t		log[LOG_SIZE];
+	uint32_t		received;				// bytes of completed transfers
+	uint32_t		sent;						// bytes of started transfers
+} Endpoint_t;
+
+typedef struct
+{
+	uint64_t		write_ns;
+	uint64_t		latency;
+	uint32_t		end;						// stream offset after the response
+	bool			idle;						// the endpoint was idle when it was written
+} Response_t;
+
+static VCOM_TxQueue_t	queue;
+static uint8_t				buffers[VCOM_TX_BUFFERS * BUFFER_SIZE];
+static Endpoint_t			ep;
+static uint32_t			written;
+static Response_t			response[RESPONSES];
+static int					responses;
+static int					done_responses;
+static uint32_t			seed = 1616;
+
+static uint32_t Random(uint32_t lo,uint32_t hi)
+{
+	seed = seed * 1103515245u + 12345u;
+	return lo + (seed >> 8) % (hi - lo + 1);
+}
+
+static uint8_t Pattern(uint32_t n)
+{
+	return (uint8_t)(n * 7 + (n >> 9));
+}
+
+/*!
+ ******************************************************************************
+ *	Send function of the queue: the transfer is on the bus after the one in
+ * progress, one packet time per packet (a zero length packet takes one)
+ ******************************************************************************
+*/
+static int EP_Send(void *ctx,uint8_t *buf,uint32_t len)
+{
+uint64_t		now = SIM_Clock_ns();
+
+	(void)ctx;
+	CHECK(!ep.busy);
+	if (__get_PRIMASK() != 0 && __get_IPSR() == 0)
+		ep.masked_sends++;
+	if (ep.fail)
+	{
+		ep.fail = false;
+		return -1;
+	}
+	if (len == 0)
+		ep.zlps++;
+	else if (len != BUFFER_SIZE)
+		ep.partial++;
+	CHECK(ep.sent + len <= LOG_SIZE);
+	memcpy(ep.log + ep.sent,buf,len);
+	ep.sent += len;
+	ep.busy = true;
+	ep.done_ns = (ep.done_ns > now ? ep.done_ns : now) + (len == 0 ? 1 : (len + PACKET_SIZE - 1) / PACKET_SIZE) * PACKET_NS;
+	return 0;
+}
+
+static void EP_Irq(void)
+{
+	ep.transfers++;
+	ep.received = ep.sent;
+	while (done_responses < responses && response[done_responses].end <= ep.received)
+	{
+		response[done_responses].latency = ep.complete_ns - response[done_responses].write_ns;
+		done_responses++;
+	}
+	VCOM_TxComplete(&queue);
+}
+
+/*!
+ ******************************************************************************
+ *	Ends the transfers due up to the simulated time
+ ******************************************************************************
+*/
+static void EP_Run(void)
+{
+	while (ep.busy && ep.done_ns <= SIM_Clock_ns())
+	{
+		ep.busy = false;
+		ep.complete_ns = ep.done_ns;
+		SIM_NVIC_Raise(USB0_IRQn,EP_Irq);
+		if (__get_PRIMASK() != 0)
+			break;
+	}
+}
+
+/*!
+ ******************************************************************************
+ *	The writer is preempted now and then for up to two packet times
+ ******************************************************************************
+*/
+static void Preempt(void)
+{
+	if (Random(0,3) == 0)
+	{
+		SIM_Clock_Sleep(Random(0,2 * PACKET_NS));
+		EP_Run();
+	}
+}
+
+/*!
+ ******************************************************************************
+ *	Waits for the end of the transfer in progress
+ ******************************************************************************
+*/
+static void WaitTransfer(void)
+{
+	if (ep.busy && ep.done_ns > SIM_Clock_ns())
+		SIM_Clock_Sleep(ep.done_ns - SIM_Clock_ns());
+	EP_Run();
+}
+
+/*!
+ ******************************************************************************
+ *	USB_TxWrite of virtual_com.c on the simulated endpoint
+ ******************************************************************************
+*/
+static bool TxWrite(const uint8_t *data,uint32_t len,bool flush)
+{
+uint32_t		n,primask;
+int			index;
+
+	for (;;)
+	{
+		n = VCOM_TxWrite(&queue,data,len);
+		Preempt();
+		if (n == len && flush)
+			VCOM_TxFlush(&queue);
+		Preempt();
+		for (;;)
+		{
+			primask = DisableGlobalIRQ();
+			index = VCOM_TxClaim(&queue);
+			EnableGlobalIRQ(primask);
+			Preempt();
+			if (index < 0 || VCOM_TxStart(&queue,index))
+				break;
+			primask = DisableGlobalIRQ();
+			VCOM_TxDrop(&queue);
+			EnableGlobalIRQ(primask);
+		}
+		data += n;
+		len -= n;
+		if (len == 0)
+			return true;
+		if (!ep.busy)
+			return false;
+		WaitTransfer();
+	}
+}
+
+/*!
+ ******************************************************************************
+ *	Writes the next len bytes of the pattern
+ ******************************************************************************
+*/
+static void WritePattern(uint32_t len,bool flush)
+{
+uint8_t		data[2 * BUFFER_SIZE];
+
+	for (uint32_t i = 0;i < len;i++)
+		data[i] = Pattern(written + i);
+	CHECK(TxWrite(data,len,flush));
+	written += len;
+}
+
+static void WaitIdle(void)
+{
+	while (ep.busy || VCOM_TxPending(&queue) != 0)
+		WaitTransfer();
+	SIM_Clock_Sleep(Random(0,PACKET_NS));
+}
+
+static void Reset(void)
+{
+	memset(&ep,0,sizeof(ep));
+	written = 0;
+	CHECK(VCOM_TxInit(&queue,buffers,BUFFER_SIZE,PACKET_SIZE,EP_Send,NULL));
+}
+
+static void CheckLog(void)
+{
+	CHECK_EQ(ep.received,written);
+	for (uint32_t i = 0;i < ep.received;i++)
+	{
+		if (ep.log[i] != Pattern(i))
+		{
+			printf("byte %u: 0x%02X, 0x%02X expected\n",i,ep.log[i],Pattern(i));
+			host_test_failed++;
+			return;
+		}
+	}
+}
+
+/*!
+ ******************************************************************************
+ *	A stream without flush: full buffers back to back on the bus
+ ******************************************************************************
+*/
+static void TestStream(void)
+{
+uint64_t		t0;
+
+	Reset();
+	t0 = SIM_Clock_ns();
+	while (written < STREAM_BYTES)
+		WritePattern(Random(1,BUFFER_SIZE),false);
+	WritePattern(1,true);
+	WaitIdle();
+	t0 = ep.done_ns - t0;
+	CheckLog();
+	CHECK(ep.partial <= 1);
+	CHECK_EQ(ep.masked_sends,0);
+	CHECK_EQ(queue.errors,0);
+	CHECK(t0 < (uint64_t)(STREAM_BYTES / PACKET_SIZE + 2 * PACKETS_PER_FRAME) * PACKET_NS);
+	printf("stream: %u bytes in %u transfers, %.0f bytes/s (full speed bulk %u bytes/s)\n",ep.received,ep.transfers,
+		(double)ep.received * 1e9 / (double)t0,PACKETS_PER_FRAME * PACKET_SIZE * 1000);
+}
+
+/*!
+ ******************************************************************************
+ *	Responses of random length with random gaps, the latency runs from the
+ * write to the end of the transfer holding the last byte. A response written
+ * while the endpoint is idle goes out at once, else it waits at most for the
+ * buffers queued before it
+ ******************************************************************************
+*/
+static void TestLatency(void)
+{
+uint64_t		sum = 0,max = 0,idle_sum = 0,idle_max = 0;
+uint32_t		len;
+int			idle_count = 0;
+
+	Reset();
+	for (int i = 0;i < RESPONSES;i++)
+	{
+		len = Random(1,MAX_RESPONSE);
+		response[i].idle = !ep.busy && VCOM_TxPending(&queue) == 0;
+		response[i].write_ns = SIM_Clock_ns();
+		response[i].end = written + len;
+		responses++;
+		WritePattern(len,true);
+		// next response soon or after a gap, the bus is not saturated
+		SIM_Clock_Sleep((Random(0,1) ? Random(4,12) : Random(0,2)) * PACKET_NS);
+		EP_Run();
+	}
+	WaitIdle();
+	CheckLog();
+	CHECK_EQ(done_responses,RESPONSES);
+	CHECK_EQ(ep.masked_sends,0);
+	for (int i = 0;i < RESPONSES;i++)
+	{
+		sum += response[i].latency;
+		if (response[i].latency > max)
+			max = response[i].latency;
+		if (response[i].idle)
+		{
+			idle_count++;
+			idle_sum += response[i].latency;
+			if (response[i].latency > idle_max)
+				idle_max = response[i].latency;
+		}
+	}
+	// the preemption of the writer adds up to 6 packet times per pass of its
+	// loop, a response waiting for a free buffer takes two passes
+	CHECK(idle_count > RESPONSES / 10 && idle_count < RESPONSES);
+	CHECK(idle_max <= (MAX_RESPONSE / PACKET_SIZE + 1 + 6) * PACKET_NS);
+	CHECK(max <= (VCOM_TX_BUFFERS * BUFFER_SIZE / PACKET_SIZE + 1 + 12) * PACKET_NS);
+	printf("%d responses of 1..%d bytes: latency %.0f us mean, %.0f us max, idle endpoint (%d) %.0f us mean, %.0f us max\n",
+		RESPONSES,MAX_RESPONSE,(double)sum / RESPONSES / 1000.0,(double)max / 1000.0,idle_count,
+		(double)idle_sum / idle_count / 1000.0,(double)idle_max / 1000.0);
+}
+
+/*!
+ ******************************************************************************
+ *	Zero length packet after a transfer on a packet boundary, not when more
+ * bytes follow or the transfer ends in a short packet
+ ******************************************************************************
+*/
+static void TestZeroLength(void)
+{
+	Reset();
+	WritePattern(2 * PACKET_SIZE,true);
+	WaitIdle();
+	CHECK_EQ(ep.zlps,1);
+	WritePattern(PACKET_SIZE + 1,true);
+	WaitIdle();
+	CHECK_EQ(ep.zlps,1);
+	WritePattern(BUFFER_SIZE,true);
+	WaitIdle();
+	CHECK_EQ(ep.zlps,2);
+	// two full buffers back to back: only the last one is followed by a ZLP
+	WritePattern(2 * BUFFER_SIZE,true);
+	WaitIdle();
+	CHECK_EQ(ep.zlps,3);
+	CheckLog();
+}
+
+/*!
+ ******************************************************************************
+ *	A buffer which cannot be started is dropped, the next ones are sent
+ ******************************************************************************
+*/
+static void TestStartError(void)
+{
+uint8_t		data[20];
+
+	Reset();
+	memset(data,0xAA,sizeof(data));
+	ep.fail = true;
+	CHECK(VCOM_TxWrite(&queue,data,sizeof(data)) == sizeof(data));
+	VCOM_TxFlush(&queue);
+	CHECK(!VCOM_TxKick(&queue));
+	CHECK_EQ(queue.errors,1);
+	CHECK_EQ(VCOM_TxPending(&queue),0);
+	CHECK_EQ(ep.sent,0);
+	WritePattern(100,true);
+	WaitIdle();
+	CheckLog();
+	// aborted between the claim and the failed start: nothing to drop
+	WritePattern(10,false);
+	VCOM_TxFlush(&queue);
+	CHECK(VCOM_TxClaim(&queue) >= 0);
+	VCOM_TxAbort(&queue);
+	VCOM_TxDrop(&queue);
+	CHECK_EQ(VCOM_TxPending(&queue),0);
+	CHECK_EQ(queue.errors,1);
+	CHECK(!queue.busy);
+}
+
+/*!
+ ******************************************************************************
+ *	A transfer ending while the writer appends does not close the buffer being
+ * filled, the claim of the writer closes it afterwards
+ ******************************************************************************
+*/
+static void TestCompleteWhileWriting(void)
+{
+uint32_t		head;
+
+	Reset();
+	WritePattern(BUFFER_SIZE,true);
+	CHECK(ep.busy);
+	WritePattern(30,true);
+	head = queue.head;
+	queue.writing = true;
+	WaitTransfer();
+	CHECK_EQ(queue.head,head);
+	CHECK(!ep.busy);
+	queue.writing = false;
+	WritePattern(30,true);
+	CHECK(ep.busy);
+	WaitIdle();
+	CheckLog();
+	CHECK_EQ(ep.partial,1);
+}
+
+int main(void)
+{
+	NVIC_SetPriority(USB0_IRQn,6);
+	NVIC_EnableIRQ(USB0_IRQn);
+	TestZeroLength();
+	TestStartError();
+	TestCompleteWhileWriting();
+	TestStream();
+	TestLatency();
+	return HOST_TEST_RESULT();
+}
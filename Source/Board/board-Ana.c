@@ -2,6 +2,14 @@
 #include <stdbool.h>
 #include "board.h"
 #include "board-Ana.h"
+#include "board-AnaScan.h"
+#include "fsl_pdb.h"
+#include "fsl_edma.h"
+#include "fsl_dmamux.h"
+
+#if defined (PDB_USED) && (PDB_USED != 0)
+#error "PDB0 triggers the ADC scan, it cannot be used for the pump control"
+#endif
 
 #if TRACEALYZER != 0 && (TRC_ANA != 0 || TRC_ANA_CHANNEL != 0 || TRC_ANA_ISR != 0)
 #include "trcRecorder.h"
@@ -20,21 +28,9 @@ traceHandle ADC1_ISR_Handle;
 #endif
 #endif
 
-static volatile int				gCnt0 = 0;
-static volatile int				gCnt1 = 0;
-
-static volatile bool				ADC0copySema = false;
-static volatile bool				ADC1copySema = false;
-
-static uint16_t		      	ADC_conversion_temp_value[BOARD_ADC_NumberOfChannels];
-//static uint16_t		      	ADC_conversion_temp_value_F[BOARD_ADC_NumberOfChannels];
-static uint16_t		      	ADC_conversion_value[BOARD_ADC_NumberOfChannels];
 static uint16_t		      	ADC_conv_offset_calib[BOARD_ADC_NumberOfChannels];
-//static uint16_t		      	ADC_conversion_value_F[BOARD_ADC_NumberOfChannels];
-static volatile int		   	gADC0channel_ctr = 0;
-static volatile int		   	gADC1channel_ctr = 0;
-static volatile bool				gADC0allConvDone = false;
-static volatile bool				gADC1allConvDone = false;
+static ADC_Scan_t					ADC_ScanState;
+static void							(*ADC_ScanCallback)(void) = NULL;
 #if TRACEALYZER != 0 && (TRC_ANA != 0 || TRC_ANA_CHANNEL != 0)
 static traceString 				adc_CH0;
 static traceString 				adc_CH1;
@@ -45,122 +41,6 @@ static const vref_config_t	VrefConfigStruct =
     .bufferMode = kVREF_ModeHighPowerBuffer
 };
 
-static volatile ADC_Conversion_Ptr_t 	ADC_Conversion_ADC0_Ptr[ADC0_N_CHANNEL] =
-{
-	{
-		.value_ptr = &(ADC_conversion_temp_value[2]),
-		.copy_value_ptr = &(ADC_conversion_value[2]),
-		.adc_mux = 0,
-		.adc_channel = ADC_CH2
-	},
-	{
-		.value_ptr = &(ADC_conversion_temp_value[3]),
-		.copy_value_ptr = &(ADC_conversion_value[3]),
-		.adc_mux = 0,
-		.adc_channel = ADC_CH3
-	},
-	{
-		.value_ptr = &(ADC_conversion_temp_value[4]),
-		.copy_value_ptr = &(ADC_conversion_value[4]),
-		.adc_mux = 0,
-		.adc_channel = ADC_CH4
-	},
-	{
-		.value_ptr = &(ADC_conversion_temp_value[5]),
-		.copy_value_ptr = &(ADC_conversion_value[5]),
-		.adc_mux = 0,
-		.adc_channel = ADC_CH5
-	},
-	{
-		.value_ptr = &(ADC_conversion_temp_value[6]),
-		.copy_value_ptr = &(ADC_conversion_value[6]),
-		.adc_mux = 0,
-		.adc_channel = ADC_CH6
-	},
-	{
-		.value_ptr = &(ADC_conversion_temp_value[9]),
-		.copy_value_ptr = &(ADC_conversion_value[9]),
-		.adc_mux = 0,
-		.adc_channel = ADC_CH9
-	},
-	{
-		.value_ptr = &(ADC_conversion_temp_value[10]),
-		.copy_value_ptr = &(ADC_conversion_value[10]),
-		.adc_mux = 0,
-		.adc_channel = ADC_CH10
-	},
-#ifdef CUC_HW_V2
-	{
-		.value_ptr = &(ADC_conversion_temp_value[11]),
-		.copy_value_ptr = &(ADC_conversion_value[11]),
-		.adc_mux = 0,
-		.adc_channel = ADC_CH11
-	},
-	{
-		.value_ptr = &(ADC_conversion_temp_value[12]),
-		.copy_value_ptr = &(ADC_conversion_value[12]),
-		.adc_mux = 0,
-		.adc_channel = ADC_CH12
-	},
-	{
-		.value_ptr = &(ADC_conversion_temp_value[13]),
-		.copy_value_ptr = &(ADC_conversion_value[13]),
-		.adc_mux = 0,
-		.adc_channel = ADC_CH13
-	}
-#else
-	{
-		.value_ptr = &(ADC_conversion_temp_value[11]),
-		.copy_value_ptr = &(ADC_conversion_value[11]),
-		.adc_mux = 0,
-		.adc_channel = ADC_CH11
-	}
-#endif
-};
-
-static volatile ADC_Conversion_Ptr_t 	ADC_Conversion_ADC1_Ptr[ADC1_N_CHANNEL] =
-{
-	{
-		.value_ptr = &(ADC_conversion_temp_value[0]),
-		.copy_value_ptr = &(ADC_conversion_value[0]),
-		.adc_mux = 0,
-		.adc_channel = ADC_CH0
-	},
-	{
-		.value_ptr = &(ADC_conversion_temp_value[1]),
-		.copy_value_ptr = &(ADC_conversion_value[1]),
-		.adc_mux = 0,
-		.adc_channel = ADC_CH1
-	},
-	{
-		.value_ptr = &(ADC_conversion_temp_value[7]),
-		.copy_value_ptr = &(ADC_conversion_value[7]),
-		.adc_mux = 0,
-		.adc_channel = ADC_CH7
-	},
-	{
-		.value_ptr = &(ADC_conversion_temp_value[8]),
-		.copy_value_ptr = &(ADC_conversion_value[8]),
-		.adc_mux = 0,
-		.adc_channel = ADC_CH8
-	},
-#ifdef CUC_HW_V2
-	{
-		.value_ptr = &(ADC_conversion_temp_value[14]),
-		.copy_value_ptr = &(ADC_conversion_value[14]),
-		.adc_mux = 0,
-		.adc_channel = ADC_TEMP_SENSOR
-	}
-#else
-	{
-		.value_ptr = &(ADC_conversion_temp_value[12]),
-		.copy_value_ptr = &(ADC_conversion_value[12]),
-		.adc_mux = 0,
-		.adc_channel = ADC_TEMP_SENSOR
-	}
-#endif
-};
-
 static adc16_board_channel_t		adc16BoardChannel[BOARD_ADC_NumberOfChannels] =
 {
 	{
@@ -169,7 +49,7 @@ static adc16_board_channel_t		adc16BoardChannel[BOARD_ADC_NumberOfChannels] =
 		{
 				.channelNumber = ADC_CH0,
 				.enableDifferentialConversion = false,
-				.enableInterruptOnConversionCompleted = true
+				.enableInterruptOnConversionCompleted = false
 		},
 		.gain = 0.0008332F,			// Unit is A
 		.offset = 30036.9F,			// Offset
@@ -184,7 +64,7 @@ static adc16_board_channel_t		adc16BoardChannel[BOARD_ADC_NumberOfChannels] =
 		{
 				.channelNumber = ADC_CH1,
 				.enableDifferentialConversion = false,
-				.enableInterruptOnConversionCompleted = true
+				.enableInterruptOnConversionCompleted = false
 		},
 		.gain = 0.0008332F,			// Unit is A
 		.offset = 30036.9F,			// Offset
@@ -199,7 +79,7 @@ static adc16_board_channel_t		adc16BoardChannel[BOARD_ADC_NumberOfChannels] =
 		{
 				.channelNumber = ADC_CH2,
 				.enableDifferentialConversion = false,
-				.enableInterruptOnConversionCompleted = true
+				.enableInterruptOnConversionCompleted = false
 		},
 		.gain = 0.0008332F,			// Unit is A
 		.offset = 30036.9F,			// Offset
@@ -214,7 +94,7 @@ static adc16_board_channel_t		adc16BoardChannel[BOARD_ADC_NumberOfChannels] =
 		{
 				.channelNumber = ADC_CH3,
 				.enableDifferentialConversion = false,
-				.enableInterruptOnConversionCompleted = true
+				.enableInterruptOnConversionCompleted = false
 		},
 		.gain = 0.0008332F,			// Unit is A
 		.offset = 30036.9F,			// Offset
@@ -229,7 +109,7 @@ static adc16_board_channel_t		adc16BoardChannel[BOARD_ADC_NumberOfChannels] =
 		{
 				.channelNumber = ADC_CH4,
 				.enableDifferentialConversion = false,
-				.enableInterruptOnConversionCompleted = true
+				.enableInterruptOnConversionCompleted = false
 		},
 		.gain = 0.0008332F,			// Unit is A
 		.offset = 30036.9F,			// Offset
@@ -244,7 +124,7 @@ static adc16_board_channel_t		adc16BoardChannel[BOARD_ADC_NumberOfChannels] =
 		{
 				.channelNumber = ADC_CH5,
 				.enableDifferentialConversion = false,
-				.enableInterruptOnConversionCompleted = true
+				.enableInterruptOnConversionCompleted = false
 		},
 		.gain = 0.0005127031F,		// Unit is V
 		.offset = 0,					// Offset
@@ -259,7 +139,7 @@ static adc16_board_channel_t		adc16BoardChannel[BOARD_ADC_NumberOfChannels] =
 		{
 				.channelNumber = ADC_CH6,
 				.enableDifferentialConversion = false,
-				.enableInterruptOnConversionCompleted = true
+				.enableInterruptOnConversionCompleted = false
 		},
 		.gain = 0.0005127031F,		// Unit is V
 		.offset = 0,					// Offset
@@ -274,7 +154,7 @@ static adc16_board_channel_t		adc16BoardChannel[BOARD_ADC_NumberOfChannels] =
 		{
 				.channelNumber = ADC_CH7,
 				.enableDifferentialConversion = false,
-				.enableInterruptOnConversionCompleted = true
+				.enableInterruptOnConversionCompleted = false
 		},
 		.gain = 0.0000549325F,		// Unit is V
 		.offset = 0,					// Offset
@@ -289,7 +169,7 @@ static adc16_board_channel_t		adc16BoardChannel[BOARD_ADC_NumberOfChannels] =
 		{
 				.channelNumber = ADC_CH8,
 				.enableDifferentialConversion = false,
-				.enableInterruptOnConversionCompleted = true
+				.enableInterruptOnConversionCompleted = false
 		},
 		.gain = 0.0000842298F,		// Unit is V
 		.offset = 0,					// Offset
@@ -304,7 +184,7 @@ static adc16_board_channel_t		adc16BoardChannel[BOARD_ADC_NumberOfChannels] =
 		{
 				.channelNumber = ADC_CH9,
 				.enableDifferentialConversion = false,
-				.enableInterruptOnConversionCompleted = true
+				.enableInterruptOnConversionCompleted = false
 		},
 		.gain = 0.0001684596,		// Unit is V
 		.offset = 0,					// Offset
@@ -319,7 +199,7 @@ static adc16_board_channel_t		adc16BoardChannel[BOARD_ADC_NumberOfChannels] =
 		{
 				.channelNumber = ADC_CH10,
 				.enableDifferentialConversion = false,
-				.enableInterruptOnConversionCompleted = true
+				.enableInterruptOnConversionCompleted = false
 		},
 		.gain = 0.0005127031F,		// Unit is V
 		.offset = 0,					// Offset
@@ -334,7 +214,7 @@ static adc16_board_channel_t		adc16BoardChannel[BOARD_ADC_NumberOfChannels] =
 		{
 				.channelNumber = ADC_CH11,
 				.enableDifferentialConversion = false,
-				.enableInterruptOnConversionCompleted = true
+				.enableInterruptOnConversionCompleted = false
 		},
 		.gain = 0.0005127031F,		// Unit is V
 		.offset = 0,					// Offset
@@ -350,7 +230,7 @@ static adc16_board_channel_t		adc16BoardChannel[BOARD_ADC_NumberOfChannels] =
 		{
 				.channelNumber = ADC_CH12,
 				.enableDifferentialConversion = false,
-				.enableInterruptOnConversionCompleted = true
+				.enableInterruptOnConversionCompleted = false
 		},
 		.gain = 0.0005127031F,		// Unit is V
 		.offset = 0,					// Offset
@@ -365,7 +245,7 @@ static adc16_board_channel_t		adc16BoardChannel[BOARD_ADC_NumberOfChannels] =
 		{
 				.channelNumber = ADC_CH13,
 				.enableDifferentialConversion = false,
-				.enableInterruptOnConversionCompleted = true
+				.enableInterruptOnConversionCompleted = false
 		},
 		.gain = 0.0005127031F,		// Unit is V
 		.offset = 0,					// Offset
@@ -380,7 +260,7 @@ static adc16_board_channel_t		adc16BoardChannel[BOARD_ADC_NumberOfChannels] =
 		{
 				.channelNumber = ADC_TEMP_SENSOR,
 				.enableDifferentialConversion = false,
-				.enableInterruptOnConversionCompleted = true
+				.enableInterruptOnConversionCompleted = false
 		},
 		.gain = 0.00001831F,			// Unit is C
 		.offset = 0,					// Offset
@@ -396,7 +276,7 @@ static adc16_board_channel_t		adc16BoardChannel[BOARD_ADC_NumberOfChannels] =
 		{
 				.channelNumber = ADC_TEMP_SENSOR,
 				.enableDifferentialConversion = false,
-				.enableInterruptOnConversionCompleted = true
+				.enableInterruptOnConversionCompleted = false
 		},
 		.gain = 0.00001831F,			// Unit is C
 		.offset = 0,					// Offset
@@ -440,168 +320,45 @@ static const char *adc_channel_names[BOARD_ADC_NumberOfChannels] =
 	"Temperature Sensor"
 };
 
-void setADC0channel_ctr(unsigned value)
-{
-	gADC0channel_ctr = value;
-}
-
-unsigned getADC0channel_ctr(void)
-{
-	return gADC0channel_ctr;
-}
-
-void setADC1channel_ctr(unsigned value)
-{
-	gADC1channel_ctr = value;
-}
-
-unsigned getADC1channel_ctr(void)
-{
-	return gADC1channel_ctr;
-}
-
-bool getADC0convStatus(void)
-{
-	return gADC0allConvDone;
-}
-
-bool getADC1convStatus(void)
-{
-	return gADC1allConvDone;
-}
-
-void ADC0convStart(void)
-{
-volatile uint32_t	   							reg;
-volatile register ADC_Conversion_Ptr_t		*ptr;
-	
-	gADC0channel_ctr = 0;
-	gADC0allConvDone = false;
-	reg = ADC0->R[0];	
-	reg = ADC0->R[1];	
-	ptr = &(ADC_Conversion_ADC0_Ptr[gADC0channel_ctr]);
-	reg = ADC0->SC1[0];
-	reg &= ~ADC_SC1_ADCH_MASK;
-	reg |= ADC_SC1_ADCH(ptr->adc_channel);
-	if (ptr->adc_mux)
-		ADC0->CFG2 |= ADC_CFG2_MUXSEL_MASK;
-	else
-		ADC0->CFG2 &= ~ADC_CFG2_MUXSEL_MASK;
-	ADC0->SC1[0] = reg;
-#if TRACEALYZER != 0 && TRC_ANA != 0
-	vTracePrintF(adc_CH0,"Trigger");
-#endif
-}
-
-void ADC1convStart(void)
+const char * BOARD_getADCchannelName(unsigned channel)
 {
-volatile uint32_t	   							reg;
-volatile register ADC_Conversion_Ptr_t		*ptr;
-	
-	gADC1channel_ctr = 0;
-	gADC1allConvDone = false;
-	reg = ADC1->R[0];	
-	reg = ADC1->R[1];	
-	ptr = &(ADC_Conversion_ADC1_Ptr[gADC1channel_ctr]);
-	reg = ADC1->SC1[0];
-	reg &= ~ADC_SC1_ADCH_MASK;
-	reg |= ADC_SC1_ADCH(ptr->adc_channel);
-	if (ptr->adc_mux)
-		ADC1->CFG2 |= ADC_CFG2_MUXSEL_MASK;
-	else
-		ADC1->CFG2 &= ~ADC_CFG2_MUXSEL_MASK;
-	ADC1->SC1[0] = reg;
-#if TRACEALYZER != 0 && TRC_ANA != 0
-	vTracePrintF(adc_CH1,"Trigger");
-#endif
+	if (channel >= BOARD_ADC_NumberOfChannels)
+		return NULL;
+	return adc_channel_names[channel];
 }
 
-void ADC0copyChannels(void)
+/*!
+ ******************************************************************************
+ *	End of the sequence of one converter
+ *	\details	When both converters are done the results are published, the result
+ *				channels are pointed at the other buffer and the scan is re-armed.
+ *				A PDB trigger seen during the scan is dropped, so that the next scan
+ *				starts on a PWM period boundary.
+ ******************************************************************************
+*/
+static void ADC_ScanDone(unsigned adc,uint32_t dma_channel)
 {
-int		i;
-	
-	// TODO Implement Timeout
-	for (i = 0;i < ADC0_N_CHANNEL;i++)
+	EDMA_ClearChannelStatusFlags(DMA0,dma_channel,kEDMA_InterruptFlag);
+	if (ADC_ScanComplete(&ADC_ScanState,adc))
 	{
-		while (ADC0copySema);
-		*(ADC_Conversion_ADC0_Ptr[i].copy_value_ptr) = *(ADC_Conversion_ADC0_Ptr[i].value_ptr);
-	}
+		DMA0->TCD[ADC_SCAN_DMA_RESULT0].DADDR = (uint32_t)ADC_ScanWriteBuffer(&ADC_ScanState,0);
+		DMA0->TCD[ADC_SCAN_DMA_RESULT1].DADDR = (uint32_t)ADC_ScanWriteBuffer(&ADC_ScanState,1);
+		PDB_ClearStatusFlags(PDB0,kPDB_DelayEventFlag);
+		EDMA_EnableChannelRequest(DMA0,ADC_SCAN_DMA_START0);
 #if TRACEALYZER != 0 && TRC_ANA != 0
-	vTracePrintF(adc_CH0,"Copy");
+		vTracePrintF(adc_CH0,"Scan %d",ADC_ScanState.scans);
 #endif
-}
-
-void ADC1copyChannels(void)
-{
-int		i;
-	
-	// TODO Implement Timeout
-	for (i = 0;i < ADC1_N_CHANNEL;i++)
-	{
-		while (ADC1copySema);
-		*(ADC_Conversion_ADC1_Ptr[i].copy_value_ptr) = *(ADC_Conversion_ADC1_Ptr[i].value_ptr);
+		if (ADC_ScanCallback != NULL)
+			ADC_ScanCallback();
 	}
-#if TRACEALYZER != 0 && TRC_ANA != 0
-	vTracePrintF(adc_CH1,"Copy");
-#endif
-}
-
-const char * BOARD_getADCchannelName(unsigned channel)
-{
-	if (channel >= BOARD_ADC_NumberOfChannels)
-		return NULL;
-	return adc_channel_names[channel];
 }
 
-void ADC0_IRQHandler(void)
+void DMA2_IRQHandler(void)
 {
-volatile uint32_t						status,value;
-register ADC_Conversion_Ptr_t		*ptr;
-
 #if TRACEALYZER != 0 && TRC_ANA_ISR != 0
 	vTraceStoreISRBegin(ADC0_ISR_Handle); 
 #endif
-	status = ADC0->SC1[0];
-	if ((status & ADC_SC1_COCO_MASK) != 0)
-	{
-		if (!gADC0allConvDone)
-		{
-			ptr = (ADC_Conversion_Ptr_t *)&(ADC_Conversion_ADC0_Ptr[gADC0channel_ctr]);
-			ADC0copySema = true;
-			*(ptr->value_ptr) = value = ADC0->R[0];
-			ADC0copySema = false;
-#if TRACEALYZER != 0 && TRC_ANA != 0
-			vTracePrintF(adc_CH0,"ADCctr %d, Value %d",gADC0channel_ctr,value);
-#endif
-#if TRACEALYZER != 0 && TRC_ANA_CHANNEL != 0
-			vTracePrintF(adc_CH0,"[%d,%d]",gADC0channel_ctr,value);
-#endif			
-			gADC0channel_ctr++;
-			if (gADC0channel_ctr >= ADC0_N_CHANNEL)
-			{
-				gADC0allConvDone = true;
-				gADC0channel_ctr = 0;
-			}
-			else
-			{
-				ptr = (ADC_Conversion_Ptr_t *)&(ADC_Conversion_ADC0_Ptr[gADC0channel_ctr]);
-				status &= ~ADC_SC1_ADCH_MASK;
-				status |= ADC_SC1_ADCH(ptr->adc_channel);
-				if (ptr->adc_mux)
-					ADC0->CFG2 |= ADC_CFG2_MUXSEL_MASK;
-				else
-					ADC0->CFG2 &= ~ADC_CFG2_MUXSEL_MASK;
-				ADC0->SC1[0] = status;
-			}
-		}
-	}
-	else
-	{
-#if TRACEALYZER != 0 && TRC_ANA != 0
-		vTracePrintF(adc_CH0,"Status = %u",status);
-#endif
-	}
-	gCnt0++;
+	ADC_ScanDone(0,ADC_SCAN_DMA_RESULT0);
 #if TRACEALYZER != 0 && TRC_ANA_ISR != 0
 	vTraceStoreISREnd(0);
 #endif
@@ -610,57 +367,12 @@ register ADC_Conversion_Ptr_t		*ptr;
 #endif
 }
 
-void ADC1_IRQHandler(void)
+void DMA4_IRQHandler(void)
 {
-volatile uint32_t						status,value;
-register ADC_Conversion_Ptr_t		*ptr;
-
 #if TRACEALYZER != 0 && TRC_ANA_ISR != 0
 	vTraceStoreISRBegin(ADC1_ISR_Handle); 
 #endif
-	status = ADC1->SC1[0];
-	if ((status & ADC_SC1_COCO_MASK) != 0)
-	{
-		if (!gADC1allConvDone)
-		{
-			ptr = (ADC_Conversion_Ptr_t *)&(ADC_Conversion_ADC1_Ptr[gADC1channel_ctr]);
-			if ((uint32_t)(ptr->value_ptr) < 0x20000)
-				return;
-			ADC1copySema = true;
-			*(ptr->value_ptr) = value = ADC1->R[0];
-			ADC1copySema = false;
-#if TRACEALYZER != 0 && TRC_ANA != 0
-			vTracePrintF(adc_CH1,"ADCctr %d, Value %d",gADC1channel_ctr,value);
-#endif
-#if TRACEALYZER != 0 && TRC_ANA_CHANNEL != 0
-			vTracePrintF(adc_CH1,"[%d,%d]",gADC1channel_ctr,value);
-#endif			
-			gADC1channel_ctr++;
-			if (gADC1channel_ctr >= ADC1_N_CHANNEL)
-			{
-				gADC1allConvDone = true;
-				gADC1channel_ctr = 0;
-			}
-			else
-			{
-				ptr = (ADC_Conversion_Ptr_t *)&(ADC_Conversion_ADC1_Ptr[gADC1channel_ctr]);
-				status &= ~ADC_SC1_ADCH_MASK;
-				status |= ADC_SC1_ADCH(ptr->adc_channel);
-				if (ptr->adc_mux)
-					ADC1->CFG2 |= ADC_CFG2_MUXSEL_MASK;
-				else
-					ADC1->CFG2 &= ~ADC_CFG2_MUXSEL_MASK;
-				ADC1->SC1[0] = status;
-			}
-		}
-	}
-	else
-	{
-#if TRACEALYZER != 0 && TRC_ANA != 0
-		vTracePrintF("adc_CH1","Status = %u",status);
-#endif
-	}
-	gCnt1++;
+	ADC_ScanDone(1,ADC_SCAN_DMA_RESULT1);
 #if TRACEALYZER != 0 && TRC_ANA_ISR != 0
 	vTraceStoreISREnd(0);
 #endif
@@ -679,10 +391,10 @@ static bool BOARD_InitTracealyzer(void)
 {
 #if TRACEALYZER != 0 && TRC_ANA_ISR != 0
 #if ADC0_USED != 0
-	ADC0_ISR_Handle = xTraceSetISRProperties("ADC0 ISR", ADC0_INT_PRIORITY);
+	ADC0_ISR_Handle = xTraceSetISRProperties("ADC0 DMA ISR", ADC0_INT_PRIORITY);
 #endif
 #if ADC1_USED != 0
-	ADC1_ISR_Handle = xTraceSetISRProperties("ADC1 ISR", ADC1_INT_PRIORITY);
+	ADC1_ISR_Handle = xTraceSetISRProperties("ADC1 DMA ISR", ADC1_INT_PRIORITY);
 #endif
 #endif
 #if TRACEALYZER != 0 && (TRC_ANA != 0 || TRC_ANA_CHANNEL)
@@ -696,17 +408,134 @@ static bool BOARD_InitTracealyzer(void)
 	return true;
 }
 
+/*!
+ ******************************************************************************
+ *	Sets up the eDMA channels of one converter
+ *	\details	RESULT reads R[0] on each conversion complete request and links to
+ *				COMMAND after each minor loop, COMMAND writes the next SC1 value,
+ *				which starts the next conversion. The first conversion is started
+ *				by the START channel.
+ *	\param[in]	ADC				ADC device
+ *	\param[in]	adc				converter index in the scan
+ *	\param[in]	start				START channel
+ *	\param[in]	result			RESULT channel
+ *	\param[in]	command			COMMAND channel
+ *	\param[in]	source			DMAMUX source of the conversion complete request
+ ******************************************************************************
+*/
+static void BOARD_ADC_InitScanDMA(ADC_Type *ADC,unsigned adc,uint32_t start,uint32_t result,
+											 uint32_t command,uint32_t source)
+{
+edma_transfer_config_t		transfer;
+unsigned							n = ADC_ScanCount(&ADC_ScanState,adc);
+const uint32_t					*cmd = ADC_ScanCommands(&ADC_ScanState,adc);
+
+	// START: first command
+	EDMA_ResetChannel(DMA0,start);
+	transfer.srcAddr = (uint32_t)&cmd[0];
+	transfer.destAddr = (uint32_t)&(ADC->SC1[0]);
+	transfer.srcTransferSize = kEDMA_TransferSize4Bytes;
+	transfer.destTransferSize = kEDMA_TransferSize4Bytes;
+	transfer.srcOffset = 0;
+	transfer.destOffset = 0;
+	transfer.minorLoopBytes = 4;
+	transfer.majorLoopCounts = 1;
+	EDMA_SetTransferConfig(DMA0,start,&transfer,NULL);
+
+	// RESULT: one 16 bit result per request, the request stays enabled
+	EDMA_ResetChannel(DMA0,result);
+	transfer.srcAddr = (uint32_t)&(ADC->R[0]);
+	transfer.destAddr = (uint32_t)ADC_ScanWriteBuffer(&ADC_ScanState,adc);
+	transfer.srcTransferSize = kEDMA_TransferSize2Bytes;
+	transfer.destTransferSize = kEDMA_TransferSize2Bytes;
+	transfer.srcOffset = 0;
+	transfer.destOffset = 2;
+	transfer.minorLoopBytes = 2;
+	transfer.majorLoopCounts = n;
+	EDMA_SetTransferConfig(DMA0,result,&transfer,NULL);
+	EDMA_EnableAutoStopRequest(DMA0,result,false);
+	EDMA_EnableChannelInterrupts(DMA0,result,kEDMA_MajorInterruptEnable);
+
+	// COMMAND: commands 1..n-1, rewinds to command 1 at the end of the scan
+	if (n > 1)
+	{
+		EDMA_ResetChannel(DMA0,command);
+		transfer.srcAddr = (uint32_t)&cmd[1];
+		transfer.destAddr = (uint32_t)&(ADC->SC1[0]);
+		transfer.srcTransferSize = kEDMA_TransferSize4Bytes;
+		transfer.destTransferSize = kEDMA_TransferSize4Bytes;
+		transfer.srcOffset = 4;
+		transfer.destOffset = 0;
+		transfer.minorLoopBytes = 4;
+		transfer.majorLoopCounts = n - 1;
+		EDMA_SetTransferConfig(DMA0,command,&transfer,NULL);
+		EDMA_EnableAutoStopRequest(DMA0,command,false);
+		DMA0->TCD[command].SLAST = -(int32_t)((n - 1) * 4);
+		EDMA_SetChannelLink(DMA0,result,kEDMA_MinorLink,command);
+	}
+
+	DMAMUX_SetSource(DMAMUX0,result,source);
+	DMAMUX_EnableChannel(DMAMUX0,result);
+	EDMA_EnableChannelRequest(DMA0,result);
+	ADC16_EnableDMA(ADC,true);
+}
+
+/*!
+ ******************************************************************************
+ *	Sets up the PDB and eDMA driven scan of all ADC channels
+ * \return        true if success, false else
+ ******************************************************************************
+*/
+static bool BOARD_ADC_InitScan(void)
+{
+ADC_ScanChannel_t		table[BOARD_ADC_NumberOfChannels];
+edma_config_t			edmaConfig;
+pdb_config_t			pdbConfig;
+
+	for (int i = 0;i < BOARD_ADC_NumberOfChannels;i++)
+	{
+		table[i].adc = (adc16BoardChannel[i].ADC == ADC0) ? 0 : 1;
+		table[i].adc_channel = adc16BoardChannel[i].ChannelConfig.channelNumber;
+		table[i].channel = i;
+	}
+	if (!ADC_ScanInit(&ADC_ScanState,table,BOARD_ADC_NumberOfChannels))
+		return false;
+
+	DMAMUX_Init(DMAMUX0);
+	EDMA_GetDefaultConfig(&edmaConfig);
+	EDMA_Init(DMA0,&edmaConfig);
+	BOARD_ADC_InitScanDMA(ADC0,0,ADC_SCAN_DMA_START0,ADC_SCAN_DMA_RESULT0,ADC_SCAN_DMA_COMMAND0,
+								 kDmaRequestMux0ADC0);
+	BOARD_ADC_InitScanDMA(ADC1,1,ADC_SCAN_DMA_START1,ADC_SCAN_DMA_RESULT1,ADC_SCAN_DMA_COMMAND1,
+								 kDmaRequestMux0ADC1);
+	// START0 is requested by the PDB and disarmed after each scan start, START1 is linked
+	EDMA_SetChannelLink(DMA0,ADC_SCAN_DMA_START0,kEDMA_MajorLink,ADC_SCAN_DMA_START1);
+	DMAMUX_SetSource(DMAMUX0,ADC_SCAN_DMA_START0,kDmaRequestMux0PDB);
+	DMAMUX_EnableChannel(DMAMUX0,ADC_SCAN_DMA_START0);
+
+	NVIC_SetPriority(ADC_SCAN_DMA_RESULT0_IRQn,ADC0_INT_PRIORITY);
+	EnableIRQ(ADC_SCAN_DMA_RESULT0_IRQn);
+	NVIC_SetPriority(ADC_SCAN_DMA_RESULT1_IRQn,ADC1_INT_PRIORITY);
+	EnableIRQ(ADC_SCAN_DMA_RESULT1_IRQn);
+
+	// The PDB delay event requests the DMA instead of an interrupt
+	PDB_GetDefaultConfig(&pdbConfig);
+	pdbConfig.triggerInputSource = kPDB_TriggerInput8;		// FTM0 init trigger
+	PDB_Init(PDB0,&pdbConfig);
+	PDB_SetModulusValue(PDB0,ADC_SCAN_PDB_DELAY + 1);
+	PDB_SetCounterDelayValue(PDB0,ADC_SCAN_PDB_DELAY);
+	PDB_EnableInterrupts(PDB0,kPDB_DelayInterruptEnable);
+	PDB_EnableDMA(PDB0,true);
+	PDB_DoLoadValues(PDB0);
+	return true;
+}
+
 int BOARD_InitADC(void)
 {
 int      ret = 1;
 
 	for (int i = 0;i < BOARD_ADC_NumberOfChannels;i++)
-	{
-		ADC_conversion_value[i] = 0;
-		ADC_conversion_temp_value[i] = 0;
 		ADC_conv_offset_calib[i] = 0;
-//		ADC_conversion_value_F[i] = 0.0;
-	}
 	// update configuration
 	ADC16_Init(ADC0,&adc16ConfigStruct);
 	ADC16_Init(ADC1,&adc16ConfigStruct);
@@ -726,31 +555,57 @@ int      ret = 1;
 	ADC16_SetChannelMuxMode(ADC0,kADC16_ChannelMuxA);
 	ADC16_SetChannelMuxMode(ADC1,kADC16_ChannelMuxA);
 
-	// update channel config
-	for (int i = 0;i < BOARD_ADC_NumberOfChannels;i++)
-	{
-		ADC16_SetChannelConfig(adc16BoardChannel[i].ADC, BOARD_ADC_ChannelGroup,
-                             &(adc16BoardChannel[i].ChannelConfig));
-	}
 	BOARD_ADC_InitAverager(-1);
-	// Select PIT0 as external trigger;
-//	SIM->SOPT7 &= ~(SIM_SOPT7_ADC0TRGSEL_MASK | SIM_SOPT7_ADC0TRGSEL_MASK);
-//	SIM->SOPT7 |= SIM_SOPT7_ADC0ALTTRGEN_MASK | SIM_SOPT7_ADC0ALTTRGEN_MASK | SIM_SOPT7_ADC0TRGSEL(4);
-//	ADC16_EnableHardwareTrigger(ADC0, true);
+	// Conversions are started by the DMA writing SC1
 	ADC16_EnableHardwareTrigger(ADC0, false);
-	EnableIRQ(ADC0_IRQn);
-
-//	SIM->SOPT7 &= ~(SIM_SOPT7_ADC1TRGSEL_MASK | SIM_SOPT7_ADC1TRGSEL_MASK);
-//	SIM->SOPT7 |= SIM_SOPT7_ADC1ALTTRGEN_MASK | SIM_SOPT7_ADC1ALTTRGEN_MASK | SIM_SOPT7_ADC1TRGSEL(4);
-//	ADC16_EnableHardwareTrigger(ADC0, true);
-	ADC16_EnableHardwareTrigger(ADC0, false);
-	EnableIRQ(ADC1_IRQn);
+	ADC16_EnableHardwareTrigger(ADC1, false);
+	if (!BOARD_ADC_InitScan())
+		ret = 0;
 
 	BOARD_InitTracealyzer();
 
    return ret;
 }
 
+/*!
+ ******************************************************************************
+ *	Enables or disables the ADC scan on each PWM period
+ *	\details	Disabling lets a scan in progress complete.
+ * \param[in]		enable 	true to enable
+ ******************************************************************************
+*/
+void BOARD_ADC_EnableScan(bool enable)
+{
+	if (enable)
+	{
+		FTM0->EXTTRIG |= FTM_EXTTRIG_INITTRIGEN_MASK;
+		PDB_ClearStatusFlags(PDB0,kPDB_DelayEventFlag);
+		EDMA_EnableChannelRequest(DMA0,ADC_SCAN_DMA_START0);
+	}
+	else
+		EDMA_DisableChannelRequest(DMA0,ADC_SCAN_DMA_START0);
+}
+
+/*!
+ ******************************************************************************
+ *	Registers the function called (in interrupt context) after each complete scan
+ ******************************************************************************
+*/
+void BOARD_ADC_RegisterScanCallback(void (*callback)(void))
+{
+	ADC_ScanCallback = callback;
+}
+
+/*!
+ ******************************************************************************
+ *	Gets the number of complete scans
+ ******************************************************************************
+*/
+uint32_t BOARD_ADC_GetScanCount(void)
+{
+	return ADC_ScanState.scans;
+}
+
 /*!
  ******************************************************************************
  *	Initializes the hardware Average Function of the ADCs
@@ -808,10 +663,7 @@ adc16_hardware_average_mode_t		nSamples;
 bool BOARD_get_ADC(uint8_t channel,uint16_t *value)
 {
 
-	if (channel >= BOARD_ADC_NumberOfChannels)
-		return false;
-   *value =  ADC_conversion_value[channel];
-   return true;
+	return ADC_ScanGet(&ADC_ScanState,channel,value);
 }
 
 /*!
@@ -824,18 +676,18 @@ bool BOARD_get_ADC(uint8_t channel,uint16_t *value)
 */
 bool BOARD_get_ADC_float(uint8_t channel,float *value)
 {
+uint16_t		raw;
 
-	if (channel >= BOARD_ADC_NumberOfChannels)
+	if (!BOARD_get_ADC(channel,&raw))
 		return false;
 	if (channel == ADC_TEMP_SENSOR_CHANNEL)
 	{
-		float Vtemp = ADC_conversion_value[channel] * ADC_REF_VOLTAGE / ADC_MAX_VALUE;
+		float Vtemp = raw * ADC_REF_VOLTAGE / ADC_MAX_VALUE;
 		*value = 25.0F - (Vtemp - ADC_VTEMP25) / ADC_VTEMP_SLOPE;
 	}
 	else
 	{
-		float		temp = 
-		*value =  (ADC_conversion_value[channel] -
+		*value =  (raw -
 				adc16BoardChannel[channel].offset) *
 				adc16BoardChannel[channel].gain;
 		if (channel == ADC_TEMP_SENSE)
@@ -919,9 +771,8 @@ unsigned BOARD_getOffsetCalibValue(uint8_t channel)
 */
 bool BOARD_getValueAndOffset(uint8_t channel,uint16_t *value,uint16_t *offset)
 {
-	if (channel >= BOARD_ADC_NumberOfChannels)
+	if (!BOARD_get_ADC(channel,value))
 		return false;
 	*offset = ADC_conv_offset_calib[channel];
-   *value =  ADC_conversion_value[channel];
 	return true;
 }
@@ -6,6 +6,7 @@
 #include "fsl_port.h"
 #include "fsl_adc16.h"
 #include "fsl_vref.h"
+#include "board-AnaScan.h"
 
 #define ADC0_USED							1
 #define ADC1_USED							1
@@ -13,6 +14,18 @@
 #define ADC0_INT_PRIORITY         	9
 #define ADC1_INT_PRIORITY         	9
 
+// Scan: FTM0 init trigger -> PDB0 delay -> eDMA writes the SC1 commands and
+// reads the results, one completion interrupt per converter and scan
+#define ADC_SCAN_PDB_DELAY				10				// PDB counts after the PWM period start
+#define ADC_SCAN_DMA_START0			0				// PDB request: first command of ADC0
+#define ADC_SCAN_DMA_START1			1				// linked from START0: first command of ADC1
+#define ADC_SCAN_DMA_RESULT0			2				// ADC0 COCO request: result of ADC0
+#define ADC_SCAN_DMA_COMMAND0			3				// linked from RESULT0: next command of ADC0
+#define ADC_SCAN_DMA_RESULT1			4				// ADC1 COCO request: result of ADC1
+#define ADC_SCAN_DMA_COMMAND1			5				// linked from RESULT1: next command of ADC1
+#define ADC_SCAN_DMA_RESULT0_IRQn	DMA2_IRQn
+#define ADC_SCAN_DMA_RESULT1_IRQn	DMA4_IRQn
+
 
 #ifdef CUC_HW_V2
 #define BOARD_ADC_NumberOfChannels	15
@@ -97,13 +110,6 @@
 #endif
 #define ADCTEMP_SENSOR_ADC		      ADC1
 
-typedef struct {
-	uint16_t *value_ptr;
-	uint16_t *copy_value_ptr;
-	uint8_t adc_channel;
-	uint8_t adc_mux;
-} ADC_Conversion_Ptr_t;
-
 typedef struct {
 	adc16_channel_config_t ChannelConfig;		// Channel Configuration
 	ADC_Type 												*ADC;				// Device ADC
@@ -119,18 +125,11 @@ typedef struct {
 extern "C" {
 #endif /* __cplusplus */
 
-void setADC0channel_ctr(unsigned value);
-unsigned getADC0channel_ctr(void);
-void setADC1channel_ctr(unsigned value);
-unsigned getADC1channel_ctr(void);
-bool getADC0convStatus(void);
-bool getADC1convStatus(void);
-void ADC0convStart(void);
-void ADC1convStart(void);
-void ADC0copyChannels(void);
-void ADC1copyChannels(void);
 void BOARD_InitVREF(void);
 int BOARD_InitADC(void);
+void BOARD_ADC_EnableScan(bool enable);
+void BOARD_ADC_RegisterScanCallback(void (*callback)(void));
+uint32_t BOARD_ADC_GetScanCount(void);
 const char * BOARD_getADCchannelName(unsigned channel);
 bool BOARD_get_ADC(uint8_t channel,uint16_t *value);
 bool BOARD_get_ADC_float(uint8_t channel,float *value);
@@ -0,0 +1,125 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "board-AnaScan.h"
+
+/*!
+ ******************************************************************************
+ *	Builds the per converter command sequences and the channel to slot map
+ *	\param[out]	scan			scan state
+ *	\param[in]	table			channel table, converted in table order on each ADC
+ *	\param[in]	n				number of entries of the table
+ * \return     true if success, false if the table is invalid
+ ******************************************************************************
+*/
+bool ADC_ScanInit(ADC_Scan_t *scan,const ADC_ScanChannel_t *table,unsigned n)
+{
+unsigned		adc,i,slot;
+
+	if (scan == NULL || table == NULL || n == 0 || n > ADC_SCAN_MAX_CHANNELS)
+		return false;
+	memset(scan,0,sizeof(*scan));
+	memset(scan->slot,0xFF,sizeof(scan->slot));
+	slot = 0;
+	for (adc = 0;adc < ADC_SCAN_N_ADC;adc++)
+	{
+		scan->first[adc] = slot;
+		for (i = 0;i < n;i++)
+		{
+			if (table[i].adc >= ADC_SCAN_N_ADC || table[i].channel >= n)
+				return false;
+			if (table[i].adc != adc)
+				continue;
+			if (scan->slot[table[i].channel] != 0xFF)
+				return false;			// board channel declared twice
+			scan->command[adc][scan->count[adc]] = table[i].adc_channel & ADC_SCAN_SC1_ADCH_MASK;
+			scan->slot[table[i].channel] = slot;
+			scan->count[adc]++;
+			slot++;
+		}
+		if (scan->count[adc] != 0)
+			scan->all_done |= 1 << adc;
+	}
+	scan->n_channels = n;
+	scan->write = 0;
+	scan->read = 1;
+	return true;
+}
+
+/*!
+ ******************************************************************************
+ *	Gets the number of conversions of a converter per scan
+ ******************************************************************************
+*/
+unsigned ADC_ScanCount(const ADC_Scan_t *scan,unsigned adc)
+{
+	if (adc >= ADC_SCAN_N_ADC)
+		return 0;
+	return scan->count[adc];
+}
+
+/*!
+ ******************************************************************************
+ *	Gets the SC1 command sequence of a converter
+ ******************************************************************************
+*/
+const uint32_t * ADC_ScanCommands(const ADC_Scan_t *scan,unsigned adc)
+{
+	if (adc >= ADC_SCAN_N_ADC)
+		return NULL;
+	return scan->command[adc];
+}
+
+/*!
+ ******************************************************************************
+ *	Gets the buffer the results of a converter are written to during the scan
+ ******************************************************************************
+*/
+uint16_t * ADC_ScanWriteBuffer(ADC_Scan_t *scan,unsigned adc)
+{
+	if (adc >= ADC_SCAN_N_ADC)
+		return NULL;
+	return &(scan->result[scan->write][scan->first[adc]]);
+}
+
+/*!
+ ******************************************************************************
+ *	Reports the end of the sequence of a converter
+ *	\details	When all converters are done the write buffer is published and the
+ *				other buffer becomes the write buffer of the next scan.
+ *	\param[in]	scan			scan state
+ *	\param[in]	adc			converter which finished its sequence
+ * \return     true if the scan is complete (once per scan)
+ ******************************************************************************
+*/
+bool ADC_ScanComplete(ADC_Scan_t *scan,unsigned adc)
+{
+	if (adc >= ADC_SCAN_N_ADC)
+		return false;
+	scan->done |= 1 << adc;
+	if ((scan->done & scan->all_done) != scan->all_done)
+		return false;
+	scan->done = 0;
+	scan->read = scan->write;
+	scan->write ^= 1;
+	scan->valid = true;
+	scan->scans++;
+	return true;
+}
+
+/*!
+ ******************************************************************************
+ *	Gets the value of a board channel from the last complete scan
+ *	\param[in]	scan			scan state
+ *	\param[in]	channel		board channel
+ *	\param[out]	value			conversion result, 0 before the first scan
+ * \return     true if success, false else
+ ******************************************************************************
+*/
+bool ADC_ScanGet(const ADC_Scan_t *scan,unsigned channel,uint16_t *value)
+{
+	if (channel >= scan->n_channels)
+		return false;
+	*value = scan->valid ? scan->result[scan->read][scan->slot[channel]] : 0;
+	return true;
+}
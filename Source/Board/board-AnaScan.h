@@ -0,0 +1,59 @@
+#ifndef _BOARD_ANA_SCAN_H_
+#define _BOARD_ANA_SCAN_H_
+
+/*!
+ ******************************************************************************
+ *	ADC scan bookkeeping: channel table and double-buffered results
+ *
+ *	The hardware (PDB, eDMA, ADC) only writes the conversion results of a scan
+ *	into the buffer returned by ADC_ScanWriteBuffer and reports the end of the
+ *	sequence of each converter with ADC_ScanComplete. This file has no hardware
+ *	dependency, a simulated ADC can fill the write buffer and call
+ *	ADC_ScanComplete the same way the DMA completion interrupts do.
+ ******************************************************************************
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define ADC_SCAN_N_ADC					2				// ADC0 and ADC1
+#define ADC_SCAN_MAX_CHANNELS			16
+#define ADC_SCAN_SC1_ADCH_MASK		0x1F			// SC1: input select, no interrupt, single ended
+
+typedef struct {
+	uint8_t		adc;					// converter: 0 = ADC0, 1 = ADC1
+	uint8_t		adc_channel;		// ADCH input selection
+	uint8_t		channel;				// board channel (index used by BOARD_get_ADC)
+} ADC_ScanChannel_t;
+
+typedef struct {
+	uint16_t				result[2][ADC_SCAN_MAX_CHANNELS];					// results in scan order, double buffered
+	uint32_t				command[ADC_SCAN_N_ADC][ADC_SCAN_MAX_CHANNELS];	// SC1 values in scan order
+	uint8_t				first[ADC_SCAN_N_ADC];		// slot of the first result of each converter
+	uint8_t				count[ADC_SCAN_N_ADC];		// conversions per scan of each converter
+	uint8_t				slot[ADC_SCAN_MAX_CHANNELS];	// board channel -> result slot
+	uint8_t				n_channels;
+	uint8_t				all_done;						// bit n set: converter n takes part in the scan
+	volatile uint8_t	done;								// bit n set: converter n finished the current scan
+	volatile uint8_t	write;							// buffer written by the hardware
+	volatile uint8_t	read;								// buffer of the last complete scan
+	volatile bool		valid;							// at least one complete scan
+	volatile uint32_t	scans;							// number of complete scans
+} ADC_Scan_t;
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* __cplusplus */
+
+bool ADC_ScanInit(ADC_Scan_t *scan,const ADC_ScanChannel_t *table,unsigned n);
+unsigned ADC_ScanCount(const ADC_Scan_t *scan,unsigned adc);
+const uint32_t * ADC_ScanCommands(const ADC_Scan_t *scan,unsigned adc);
+uint16_t * ADC_ScanWriteBuffer(ADC_Scan_t *scan,unsigned adc);
+bool ADC_ScanComplete(ADC_Scan_t *scan,unsigned adc);
+bool ADC_ScanGet(const ADC_Scan_t *scan,unsigned channel,uint16_t *value);
+
+#if defined(__cplusplus)
+}
+#endif /* __cplusplus */
+
+#endif /* _BOARD_ANA_SCAN_H_ */
@@ -2914,16 +2914,13 @@ uint32_t IRQmask = PORTA->ISFR;
 	PORTA->ISFR = IRQmask;	// Resets the Interrupt
 	if (mTestFlowCounter)
 		BOARD_CountFlowMeterTestCounter(IRQmask);
-	else
-		if (!mTestHallCounters)
-			PORT_IRQHandler(PORTA,IRQmask);
 #if defined CUC_HW_V2 || defined CUC_HW_HALL_IOS_V2
 	if (mTestHallCounters)
 		BOARD_CountTestCounters(IRQmask);
-	else
-		if (!mTestFlowCounter)
-			PORT_IRQHandler(PORTA,IRQmask);
 #endif
+	// The inputs are dispatched once, unless a test counter takes the port
+	if (!mTestFlowCounter && !mTestHallCounters)
+		PORT_IRQHandler(PORTA,IRQmask);
 #if TRACEALYZER != 0 && TRC_DIG_ISR != 0
 	vTraceStoreISREnd(0);
 #endif
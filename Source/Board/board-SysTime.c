@@ -0,0 +1,174 @@
+#include <stdint.h>
+#include "board.h"
+#include "board-Time.h"
+#include "board-SysTime.h"
+
+// PIT0 periods since power up, double buffered: SysTimeJiffies[SysTimeGen & 1] is current.
+// The PIT0 interrupt writes the other slot and then increments the generation,
+// so that readers never see a half written 64 bits value and never mask interrupts.
+static volatile uint64_t		SysTimeJiffies[2] = { 0, 0 };
+static volatile uint32_t		SysTimeGen = 0;
+static BOARD_TimeScale_t		SysTimeScale_ns;
+static BOARD_TimeScale_t		SysTimeScale_us;
+static BOARD_TimeScale_t		SysTimeScale_ms;
+static bool							SysTimeScaled = false;		// the three scales exist
+static uint32_t					SysTimeClock = 1;
+
+/*!
+ ******************************************************************************
+ *	Sets up the conversion of the PIT0 counts (called once the PIT0 period is set)
+ *	\details	Without an exact scale for the bus clock and the PIT0 period the
+ *				getters divide instead.
+ * \return     true if the counts are converted without division, false else
+ ******************************************************************************
+*/
+bool BOARD_InitSystemTime(void)
+{
+uint32_t		clock = CLOCK_GetBusClkFreq();
+uint32_t		counts = PIT->CHANNEL[0].LDVAL + 1;
+
+	SysTimeClock = clock != 0 ? clock : 1;
+	SysTimeScaled = BOARD_TimeScaleInit(&SysTimeScale_ns,1000000000UL,clock,counts) &&
+						 BOARD_TimeScaleInit(&SysTimeScale_us,1000000UL,clock,counts) &&
+						 BOARD_TimeScaleInit(&SysTimeScale_ms,1000UL,clock,counts);
+	return SysTimeScaled;
+}
+
+/*!
+ ******************************************************************************
+ *	Counts one PIT0 period (PIT0 interrupt)
+ *	\details	Clearing the flag and publishing the new period is done with the
+ *				interrupts masked (a few cycles), so that a reader preempting this
+ *				interrupt sees either the flag set or the new period, never both
+ *				or none.
+ ******************************************************************************
+*/
+void BOARD_SystemTimeTick(void)
+{
+uint32_t		primask = DisableGlobalIRQ();
+uint32_t		gen = SysTimeGen;
+
+	PIT->CHANNEL[0].TFLG = PIT_TFLG_TIF_MASK;
+	SysTimeJiffies[(gen + 1) & 1] = SysTimeJiffies[gen & 1] + 1;
+	__DMB();
+	SysTimeGen = gen + 1;
+	EnableGlobalIRQ(primask);
+}
+
+/*!
+ ******************************************************************************
+ *	Reads the PIT0 periods and the counts elapsed in the current period
+ *	\details	Lock-free: retries if the PIT0 interrupt ran meanwhile. A period
+ *				which ended but is not yet counted by the interrupt (flag set, e.g.
+ *				when called from a higher priority interrupt) is added here.
+ * \param[out]	counts	PIT0 counts elapsed in the current period
+ * \return        PIT0 periods since power up
+ ******************************************************************************
+*/
+static uint64_t BOARD_getSystemTicks(uint32_t *counts)
+{
+uint32_t		gen,cval;
+uint32_t		ldval = PIT->CHANNEL[0].LDVAL;
+uint64_t		jiffies;
+
+	do
+	{
+		gen = SysTimeGen;
+		__DMB();
+		jiffies = SysTimeJiffies[gen & 1];
+		cval = PIT->CHANNEL[0].CVAL;
+		if ((PIT->CHANNEL[0].TFLG & PIT_TFLG_TIF_MASK) != 0)
+		{
+			// The counter reloaded: read it again after the reload
+			cval = PIT->CHANNEL[0].CVAL;
+			jiffies++;
+		}
+		__DMB();
+	} while (gen != SysTimeGen);
+	*counts = ldval - cval;
+	return jiffies;
+}
+
+/*!
+ ******************************************************************************
+ *	Converts the counts of the current period
+ ******************************************************************************
+*/
+static uint64_t BOARD_SystemTimeScale(const BOARD_TimeScale_t *scale,uint32_t unit,uint32_t counts)
+{
+	if (!SysTimeScaled)
+		return (uint64_t)counts * unit / SysTimeClock;
+	return BOARD_TimeScale(scale,counts);
+}
+
+/*!
+ *********************************************************************************
+ * Gets the System Time in nanoseconds. The System Time starts with 0 when the
+ * MCU powers up. Monotonic and lock-free, may be called from any context.
+ * \return			System Time in Nanoseconds
+ *********************************************************************************
+*/
+uint64_t BOARD_getSystemTime_ns(void)
+{
+uint32_t		counts;
+uint64_t		jiffies = BOARD_getSystemTicks(&counts);
+
+	return jiffies * (PIT0_PERIOD * 1000000ULL) + BOARD_SystemTimeScale(&SysTimeScale_ns,1000000000UL,counts);
+}
+
+/*!
+ *********************************************************************************
+ * Gets the System Time in microseconds (see BOARD_getSystemTime_ns)
+ *********************************************************************************
+*/
+uint64_t BOARD_getSystemTime_us(void)
+{
+uint32_t		counts;
+uint64_t		jiffies = BOARD_getSystemTicks(&counts);
+
+	return jiffies * (PIT0_PERIOD * 1000ULL) + BOARD_SystemTimeScale(&SysTimeScale_us,1000000UL,counts);
+}
+
+/*!
+ *********************************************************************************
+ * Gets the System Time in milliseconds (see BOARD_getSystemTime_ns)
+ *********************************************************************************
+*/
+uint64_t BOARD_getSystemTime_ms(void)
+{
+uint32_t		counts;
+uint64_t		jiffies = BOARD_getSystemTicks(&counts);
+
+	return jiffies * PIT0_PERIOD + BOARD_SystemTimeScale(&SysTimeScale_ms,1000UL,counts);
+}
+
+/*!
+ *********************************************************************************
+ * Gets the System Time in nanoseconds
+ * \param[out]		time	System Time in Nanoseconds
+ * \return			true if success, false else
+ *********************************************************************************
+*/
+bool BOARD_getSystemTime(uint64_t *time)
+{
+	*time = BOARD_getSystemTime_ns();
+	return true;
+}
+
+/*!
+ *********************************************************************************
+ * Gets the System Time in nanoseconds. The System Time starts with 0 when the
+ * MCU powers up (the 64-Bit Jiffy Counter variable will wrap around in 584 years)
+ * The function directly returns the system time without the boolean return value
+ * \return			System Time in Nanoseconds
+ *********************************************************************************
+*/
+uint64_t BOARD_getSystemTimeDirect(void)
+{
+	return BOARD_getSystemTime_ns();
+}
+
+uint64_t Now(void)
+{
+	return SysTimeJiffies[SysTimeGen & 1];
+}
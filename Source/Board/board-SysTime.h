@@ -0,0 +1,26 @@
+#ifndef _BOARD_SYSTIME_H_
+#define _BOARD_SYSTIME_H_
+
+/*!
+ ******************************************************************************
+ *	System time: the PIT0 periods counted by the PIT0 interrupt plus the counts
+ *	elapsed in the current period. The getters (BOARD_getSystemTime_ns ...)
+ *	are declared in board.h.
+ ******************************************************************************
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* __cplusplus */
+
+bool BOARD_InitSystemTime(void);
+void BOARD_SystemTimeTick(void);
+
+#if defined(__cplusplus)
+}
+#endif /* __cplusplus */
+
+#endif /* _BOARD_SYSTIME_H_ */
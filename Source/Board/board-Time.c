@@ -0,0 +1,51 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include "board-Time.h"
+
+/*!
+ ******************************************************************************
+ *	Computes the multiplier and shift of a scale (called at initialization only)
+ *	\param[out]	scale			scale
+ *	\param[in]	unit			time units per second (1000000000 for ns)
+ *	\param[in]	freq			timer frequency in Hz
+ *	\param[in]	max_counts	upper bound (excluded) of the counts to convert
+ * \return     true if success, false if no exact 64 bits scale exists
+ ******************************************************************************
+*/
+bool BOARD_TimeScaleInit(BOARD_TimeScale_t *scale,uint32_t unit,uint32_t freq,uint32_t max_counts)
+{
+uint64_t		q,r;
+uint32_t		shift;
+
+	scale->mult = 0;
+	scale->shift = 0;
+	if (freq == 0 || max_counts == 0)
+		return false;
+	// Smallest shift with 2^shift >= max_counts * freq
+	shift = 0;
+	while (shift < 63 && ((uint64_t)1 << shift) < (uint64_t)max_counts * freq)
+		shift++;
+	// mult = ceil(2^shift * unit / freq) by long division, 2^shift * unit overflows 64 bits
+	q = unit / freq;
+	r = unit % freq;
+	for (uint32_t i = 0;i < shift;i++)
+	{
+		if (q >> 63)
+			return false;
+		q <<= 1;
+		r <<= 1;
+		if (r >= freq)
+		{
+			q |= 1;
+			r -= freq;
+		}
+	}
+	if (r != 0)
+		q++;
+	// (max_counts - 1) * mult must not overflow
+	if (q != 0 && (uint64_t)(max_counts - 1) > UINT64_MAX / q)
+		return false;
+	scale->mult = q;
+	scale->shift = shift;
+	return true;
+}
@@ -0,0 +1,47 @@
+#ifndef _BOARD_TIME_H_
+#define _BOARD_TIME_H_
+
+/*!
+ ******************************************************************************
+ *	Division-free conversion of timer counts to time units
+ *
+ *	A count c of a timer running at freq Hz is converted to floor(c * unit / freq)
+ *	(unit = 1000000000 for ns, 1000000 for us, 1000 for ms) with one multiply
+ *	and one shift: (c * mult) >> shift, mult = ceil(2^shift * unit / freq).
+ *	The result is exact for c < max_counts when 2^shift >= max_counts * freq.
+ *	This file has no hardware dependency.
+ ******************************************************************************
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+	uint64_t		mult;
+	uint32_t		shift;
+} BOARD_TimeScale_t;
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* __cplusplus */
+
+bool BOARD_TimeScaleInit(BOARD_TimeScale_t *scale,uint32_t unit,uint32_t freq,uint32_t max_counts);
+
+/*!
+ ******************************************************************************
+ *	Converts a timer count to the time unit of the scale
+ *	\param[in]	scale		scale set up by BOARD_TimeScaleInit
+ *	\param[in]	counts	timer counts, must be < max_counts
+ * \return     floor(counts * unit / freq)
+ ******************************************************************************
+*/
+static inline uint64_t BOARD_TimeScale(const BOARD_TimeScale_t *scale,uint32_t counts)
+{
+	return ((uint64_t)counts * scale->mult) >> scale->shift;
+}
+
+#if defined(__cplusplus)
+}
+#endif /* __cplusplus */
+
+#endif /* _BOARD_TIME_H_ */
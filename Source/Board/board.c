@@ -2,10 +2,13 @@
 #include "board.h"
 #include "board-DigIO.h"
 #include "board-Ana.h"
+#include "board-SysTime.h"
 #include "uart.h"
 #include "CAN.h"
 #include "I2C.h"
 #include "EEPROM.h"
+#include "FRAM.h"
+#include "TMP100.h"
 #include "crc.h"
 #include "fsl_wdog.h"
 
@@ -52,11 +55,6 @@ static void (*PWM_IRQHandler)(unsigned channel) = NULL;
 static void (*TIMER0_IRQHandler)(uint64_t value,uint32_t flags) = NULL;
 static void (*TIMER1_IRQHandler)(uint64_t value,uint32_t flags) = NULL;
 
-static volatile uint64_t		JiffyCntr = 0;
-static volatile SystemTime_t	mSystemTime = {
-	.ticks_ms = 0,
-	.ticks_timer = 0
-};
 static volatile uint32_t		FTM1_counter = 0;
 static volatile uint32_t		FTM2_counter = 0;
 static volatile bool				Disable_CUC_IRQ_Callback = false;
@@ -82,12 +80,6 @@ static bool							CheckVB1 = true;
 static uint16_t					ChargeDelay = 2000 / 50;
 static uint8_t						RelayFlags = 0;
 
-static bool							m_EnaADC_Timer = false;
-
-static volatile SystemTime_t	SystemTime = {
-	.ticks_ms = 0,
-	.ticks_timer = 0
-};
 
 static const PWM_FTMtimer_t		FTMtimer[N_PWM_FTM_TIMER_CHANNELS] =
 {
@@ -975,6 +967,7 @@ bool BOARD_InitPIT(void)
 	PIT_SetTimerPeriod(PIT,kPIT_Chnl_0,MSEC_TO_COUNT(PIT0_PERIOD,CLOCK_GetBusClkFreq()) - 1);
 	PIT_SetTimerPeriod(PIT,kPIT_Chnl_1,MSEC_TO_COUNT(PIT1_PERIOD,CLOCK_GetBusClkFreq()) - 1);
 	PIT_SetTimerPeriod(PIT,kPIT_Chnl_2,0xFFFFFFFF);    // Full resolution
+	BOARD_InitSystemTime();									// false if the system time divides (no scale)
 #if defined (PIT0_USED ) && (PIT0_USED != 0)
 #if BOARD_PIT0_IRQ_ENA
 	NVIC_SetPriority(PIT0_IRQn,PIT0_INT_PRIORITY);
@@ -1592,24 +1585,6 @@ void FTM3_IRQHandler(void)
 #endif
    FTM3->SC &= ~FTM_SC_TOF_MASK;
 
-#if PIT1_STARTS_ADC == 0
-	if (m_EnaADC_Timer)
-	{
-		if (getADC0convStatus())
-		{
-			ADC0copyChannels();
-	//		ADC0convStart();
-		}
-		if (getADC1convStatus())
-		{
-	//		ADC1convStart();
-			ADC1copyChannels();
-		}
-		ADC0convStart();
-		ADC1convStart();
-		ADCtrigger = true;
-	}
-#endif
 	if (PWM_IRQHandler != NULL && !Disable_CUC_IRQ_Callback)
 		PWM_IRQHandler(1);
 #if (TRACEALYZER != 0) && (TRC_BOARD_ISR != 0)
@@ -1662,8 +1637,7 @@ static bool				bCntrlUsed = false;
 #if (TRACEALYZER != 0) && (TRC_BOARD_ISR != 0)
 	vTraceStoreISRBegin(PIT0_ISR_Handle); 
 #endif
-	PIT->CHANNEL[0].TFLG |= PIT_TFLG_TIF_MASK;
-	JiffyCntr++;
+	BOARD_SystemTimeTick();
 #if !PDB_USED || !USE_PDB_FOR_PUMPS
 	if (PumpClMgrCtrl.ctrl_by_cl_mgr)
 	{
@@ -1772,24 +1746,6 @@ BaseType_t        xHigherPriorityTaskWoken = pdFALSE;
 #endif
 	PIT->CHANNEL[1].TFLG |= PIT_TFLG_TIF_MASK;
 	BOARD_Toggle_LED();
-#if PIT1_STARTS_ADC != 0
-	if (m_EnaADC_Timer)
-	{
-		if (getADC0convStatus())
-		{
-			ADC0copyChannels();
-	//		ADC0convStart();
-		}
-		if (getADC1convStatus())
-		{
-	//		ADC1convStart();
-			ADC1copyChannels();
-		}
-		ADC0convStart();
-		ADC1convStart();
-		ADCtrigger = true;
-	}
-#endif
 	if (cnt == 99)
 	{
 		cnt = 0;
@@ -2880,72 +2836,6 @@ void BOARD_InitDebugConsole(void)
 {
 }
 
-bool BOARD_getSystemTime(uint64_t *time)
-{
-uint32_t				clock;
-static uint64_t	old_time = 0;
-	
-	// System Time is in ns
-	PIT_DisableInterrupts(PIT,kPIT_Chnl_0,kPIT_TimerInterruptEnable);
-	SystemTime.ticks_ms = JiffyCntr * PIT0_PERIOD;
-	SystemTime.ticks_timer = PIT_GetCurrentTimerCount(PIT,kPIT_Chnl_0);
-	clock = CLOCK_GetBusClkFreq();
-	*time = (1000000000ULL * SystemTime.ticks_timer) / clock + (uint64_t)(SystemTime.ticks_ms) * 1000000ULL;
-	PIT_EnableInterrupts(PIT,kPIT_Chnl_0,kPIT_TimerInterruptEnable);
-	// Prevent false time due to pipelining
-	if (*time < old_time)
-		*time += 1000000ULL;
-	old_time = *time;
-	return true;
-}
-
-/*!
- *********************************************************************************
- * Gets the System Time in nanoseconds. The System Time starts with 0 when the
- * MCU powers up (the 64-Bit Jiffy Counter variable will wrap around in 584 years)
- * The function directly returns the system time without the boolean return value
- * \param[out]		time	System Time in Nanoseconds
- * \return			true if success, false else
- *********************************************************************************
-*/
-uint64_t BOARD_getSystemTimeDirect(void)
-{
-uint64_t				clk1_H,clk2_H;
-uint64_t				clk1_L,clk2_L;
-uint64_t				time;
-static uint64_t	old_time = 0;
-
-	// System Time is in ns
-	clk1_H = JiffyCntr;
-	clk1_L = 0xFFFFFFFFUL - PIT_GetCurrentTimerCount(PIT, kPIT_Chnl_0);
-	clk2_L = 0xFFFFFFFFUL - PIT_GetCurrentTimerCount(PIT, kPIT_Chnl_0);
-	clk2_H = JiffyCntr;
-	/*
-	 * We need to detect a wrap-around of the timer to determine if the
-	 * Jiffy Counter before of after the wrap around is valid
-	 * if clk1_L > clk2_L the timer did wrap-around and clk2_H is valid,
-	 * else clk1_L is valid
-	 */
-	if (clk1_L > clk2_L)
-	{
-		mSystemTime.ticks_ms = clk2_H * PIT0_PERIOD;
-		mSystemTime.ticks_timer = clk2_L;
-	}
-	else
-	{
-		mSystemTime.ticks_ms = clk1_H * PIT0_PERIOD;
-		mSystemTime.ticks_timer = clk1_L;
-	}
-	/* calculate the time in nanoseconds */
-	time = (1000000000ULL * mSystemTime.ticks_timer) / CLOCK_GetBusClkFreq() +
-		   (uint64_t)(mSystemTime.ticks_ms) * 1000000ULL;
-	// Prevent false time due to pipelining
-	if (time < old_time)
-		time += 1000000ULL;
-	old_time = time;
-	return time;
-}
-
 void BOARD_Reset_ADC_Trigger(void)
 {
 	ADCtrigger = false;
@@ -2956,14 +2846,9 @@ bool BOARD_getADC_Trigger(void)
 	return ADCtrigger;
 }
 
-uint64_t Now(void)
-{
-	return JiffyCntr;
-}
-
 uint64_t DiffTime(unsigned tm)
 {
-	return JiffyCntr - tm;
+	return Now() - tm;
 }
 
 void SleepBM(unsigned tm)
@@ -3574,9 +3459,15 @@ bool BOARD_GetStackAndHeapInfo(bool getZIregions,uint32_t *stack_base,uint32_t *
 	return true;
 }
 
+static void BOARD_ADC_ScanDone(void)
+{
+	ADCtrigger = true;
+}
+
 void BOARD_EnaADC_Timer(bool flag)
 {
-	m_EnaADC_Timer = flag;
+	BOARD_ADC_RegisterScanCallback(BOARD_ADC_ScanDone);
+	BOARD_ADC_EnableScan(flag);
 }
 
 #if (TRACEALYZER != 0) && (TRC_BOARD != 0)
@@ -3643,6 +3534,8 @@ bool BOARD_Init(void)
 	BOARD_InitI2C(I2C_CHANNEL);
 	I2C_Bus_Init();
 	EEPROM_Initialize();
+	InitializeFRAM();
+	TMP100_Init();
 	uint8_t data;
 #if defined (PDB_USED ) && (PDB_USED != 0)
 	BOARD_InitPDB(PDB_MOD_VALUE);
@@ -82,8 +82,6 @@
 #define PIT1_PERIOD						10				// PIT Timeout in ms
 #define PIT2_PERIOD						10				// PIT Timeout in ms
 
-#define PIT1_STARTS_ADC					1
-
 #define PWM_DEADTIME						50				// Deadtime in ns
 
 #define FTM0_INT_PRIORITY           13
@@ -119,6 +117,8 @@
 #define  UART4_INT_PRIORITY         11
 #define  UART5_INT_PRIORITY         11
 
+#define  I2C1_INT_PRIORITY          12
+
 #define N_SUPPLY_RAILS					3
 
 #define RELAY1_VB1_THRESHOLD			30000
@@ -216,10 +216,6 @@ typedef struct {
 
 #endif
 
-typedef struct {
-	uint64_t		ticks_ms;
-	uint16_t		ticks_timer;
-} SystemTime_t;
 
 typedef struct {
 	uint16_t		frequency;			// in Hz
@@ -313,6 +309,9 @@ extern "C" {
 	bool BOARD_GetPWMStatus(unsigned channel,uint32_t *status);
 	bool BOARD_getSystemTime(uint64_t *time);
 	uint64_t BOARD_getSystemTimeDirect(void);
+	uint64_t BOARD_getSystemTime_ns(void);
+	uint64_t BOARD_getSystemTime_us(void);
+	uint64_t BOARD_getSystemTime_ms(void);
 	void BOARD_SetOwnAddress(uint16_t address);
 	uint16_t BOARD_GetOwnAddress(void);
 	bool BOARD_Enable_WDOG(void);
@@ -0,0 +1,107 @@
+/*
+ * BootGraph.c
+ *
+ *  Sequence of stages waiting on readiness signals, run as a dependency graph
+ */
+
+#include <string.h>
+#include "BootGraph.h"
+
+/*!
+ ******************************************************************************
+ *	Marks a stage as finished
+ ******************************************************************************
+*/
+static void BOOT_Finish(BOOT_Graph_t *g,unsigned i,BOOT_State_t state,uint32_t now)
+{
+	g->stage[i].state = state;
+	g->stage[i].finished = now;
+	g->finished |= BOOT_STAGE(i);
+}
+
+/*!
+ ******************************************************************************
+ *	Initializes a graph, a stage may only depend on the stages before it
+ *	\param[in]	def			stages
+ *	\param[in]	n				number of stages
+ *	\param[in]	ctx			first argument of the stage functions
+ *	\param[in]	now			time in ms
+ * \return     false if the graph is invalid
+ ******************************************************************************
+*/
+bool BOOT_Init(BOOT_Graph_t *g,const BOOT_StageDef_t *def,unsigned n,void *ctx,uint32_t now)
+{
+	memset(g,0,sizeof(*g));
+	if (n > BOOT_MAX_STAGES)
+		return false;
+	for (unsigned i = 0;i < n;i++)
+		if ((def[i].after & ~(BOOT_STAGE(i) - 1)) != 0)
+			return false;								// no cycle possible
+	g->def = def;
+	g->n = n;
+	g->ctx = ctx;
+	g->begin = now;
+	return true;
+}
+
+/*!
+ ******************************************************************************
+ *	Starts the stages whose dependencies are finished and polls the readiness
+ * signals of the started ones
+ *	\param[in]	now			time in ms
+ * \return     true if all stages are finished
+ ******************************************************************************
+*/
+bool BOOT_Step(BOOT_Graph_t *g,uint32_t now)
+{
+const BOOT_StageDef_t	*def;
+BOOT_Stage_t				*s;
+bool							changed = true;
+
+	while (changed)										// a finished stage may start its dependents at once
+	{
+		changed = false;
+		for (unsigned i = 0;i < g->n;i++)
+		{
+			def = &g->def[i];
+			s = &g->stage[i];
+			if (s->state == BOOT_IDLE)
+			{
+				if ((def->after & ~g->finished) != 0)
+					continue;
+				s->started = now;
+				changed = true;
+				if (def->start != NULL && !def->start(g->ctx,i))
+					BOOT_Finish(g,i,BOOT_FAILED,now);
+				else if (def->ready == NULL)
+					BOOT_Finish(g,i,BOOT_DONE,now);
+				else
+					s->state = BOOT_WAITING;
+			}
+			if (s->state != BOOT_WAITING)
+				continue;
+			if (def->ready(g->ctx,i))
+			{
+				if (!s->ready_seen)
+				{
+					s->ready_seen = true;
+					s->ready_since = now;
+				}
+				if (now - s->ready_since >= def->hold)
+				{
+					BOOT_Finish(g,i,BOOT_DONE,now);
+					changed = true;
+					continue;
+				}
+			}
+			else
+				s->ready_seen = false;
+			if (now - s->started >= def->timeout)
+			{
+				BOOT_Finish(g,i,BOOT_TIMEOUT,now);
+				changed = true;
+			}
+		}
+	}
+	return BOOT_Finished(g);
+}
@@ -0,0 +1,87 @@
+/*
+ * BootGraph.h
+ *
+ *  Sequence of stages waiting on readiness signals, run as a dependency graph
+ */
+
+#ifndef BOOTGRAPH_H_
+#define BOOTGRAPH_H_
+
+/*!
+ ******************************************************************************
+ *	A stage is started when all stages it depends on are finished: its start
+ *	function is called once, then its readiness signal is polled until it has
+ *	been true for the hold time (done) or the timeout has elapsed (timed out).
+ *	Stages whose dependencies are finished run at the same time, a stage
+ *	without readiness signal is done when it is started. The dependents of a
+ *	stage which timed out or failed are started anyway: the timeouts are the
+ *	fixed waits of a sequence without readiness signals.
+ *	Used for the startup of the board and the stop of the cleaning devices.
+ *	BOOT_Step is called periodically with the time in ms, this file has no
+ *	hardware dependency.
+ ******************************************************************************
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define BOOT_MAX_STAGES				16
+
+#define BOOT_STAGE(n)					(1UL << (n))		///< Dependency mask of a stage
+
+typedef enum {
+	BOOT_IDLE = 0,										// dependencies not finished
+	BOOT_WAITING,										// started, waits for the readiness signal
+	BOOT_DONE,
+	BOOT_TIMEOUT,
+	BOOT_FAILED											// start function failed
+} BOOT_State_t;
+
+typedef struct {
+	const char		*name;
+	uint32_t			after;							// BOOT_STAGE mask of the dependencies
+	bool				(*start)(void *ctx,unsigned stage);		// NULL: nothing to start, false: failed
+	bool				(*ready)(void *ctx,unsigned stage);		// NULL: done when started
+	uint32_t			hold;							// ms the readiness signal must be true
+	uint32_t			timeout;						// ms from the start
+} BOOT_StageDef_t;
+
+typedef struct {
+	BOOT_State_t	state;
+	uint32_t			started;						// ms
+	uint32_t			finished;					// ms
+	uint32_t			ready_since;				// ms, valid if ready_seen
+	bool				ready_seen;
+} BOOT_Stage_t;
+
+typedef struct {
+	const BOOT_StageDef_t	*def;
+	unsigned						n;
+	void							*ctx;							// first argument of the stage functions
+	uint32_t						begin;						// ms
+	uint32_t						finished;					// BOOT_STAGE mask of the finished stages
+	BOOT_Stage_t				stage[BOOT_MAX_STAGES];
+} BOOT_Graph_t;
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* __cplusplus */
+
+bool BOOT_Init(BOOT_Graph_t *g,const BOOT_StageDef_t *def,unsigned n,void *ctx,uint32_t now);
+bool BOOT_Step(BOOT_Graph_t *g,uint32_t now);
+
+/*!
+ ******************************************************************************
+ *	Checks whether all stages are finished
+ ******************************************************************************
+*/
+static inline bool BOOT_Finished(const BOOT_Graph_t *g)
+{
+	return g->finished == (g->n < 32 ? (1UL << g->n) - 1 : UINT32_MAX);
+}
+
+#if defined(__cplusplus)
+}
+#endif /* __cplusplus */
+
+#endif /* BOOTGRAPH_H_ */
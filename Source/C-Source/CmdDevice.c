@@ -9,7 +9,7 @@
 #include "cmsis_os2.h"
 #include "board.h"
 #include "Misc.h"
-#include "EEPROMHandler.h"
+#include "EEPROMhandler.h"
 #include "CommandDefs.h"
 #include "CommandHandler.h"
 
@@ -282,12 +282,12 @@ EEPROM_UParamEntry_t		entry;
 		return CMD_ERR_COMMAND_FAILED;
 	if ((int8_t)(data[0]) == -1)
 	{
-		if (!EEPROM_WriteNextParamStruct(&entry))
+		if (EEPROM_WriteNextParamStruct(&entry) < 0)
 			return CMD_ERR_COMMAND_FAILED;
 	}
 	else
 	{
-		if (!EEPROM_WriteParamStruct(data[0],&entry))
+		if (!EEPROM_WriteParamStructAtPos(data[0],&entry))
 			return CMD_ERR_COMMAND_FAILED;
 	}
    MakeCommandHeader(buf,CMD_DEVICE,CMD_ACK,SUB_DEVICE_EEPROM_WRITE_PARAM,CMD_TX,BOARD_GetOwnAddress());
@@ -311,7 +311,7 @@ uint8_t     				buf[6 + sizeof(entry.ByteVect)];
    if (len < 1)
       return(CMD_ERR_INVALID_LENGTH);
 
-	if (!EEPROM_ReadParamStruct(data[0],&entry))
+	if (!EEPROM_ReadParamStructAtPos(data[0],&entry))
 		return CMD_ERR_COMMAND_FAILED;
 	memcpy(buf + 6,entry.ByteVect,sizeof(entry.ByteVect));
    MakeCommandHeader(buf,CMD_DEVICE,CMD_ACK,SUB_DEVICE_EEPROM_READ_PARAM,CMD_RX,BOARD_GetOwnAddress());
@@ -0,0 +1,112 @@
+/*
+ * CmdPacket.c
+ *
+ *  Receive queues of the command interface packets
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include "CmdPacket.h"
+
+#define	CMD_PACKET_MASK		(CMD_PACKET_COUNT - 1)
+
+/*!
+ ******************************************************************************
+ *	Initializes a packet queue, all descriptors are free
+ *	\param[out]	queue			queue
+ *	\param[in]	source		interface of the packets
+ ******************************************************************************
+*/
+void CMD_PacketQueueInit(CMD_PacketQueue_t *queue,uint8_t source)
+{
+	memset(queue,0,sizeof(*queue));
+	queue->source = source;
+	UART_DeframerInit(&queue->deframer,queue->packet[0].data,CMD_PACKET_LEN);
+}
+
+/*!
+ ******************************************************************************
+ *	Publishes the packet being received and moves on to the next descriptor.
+ *	The packet is dropped if no descriptor would be left for the next one.
+ *	\param[in]	queue			queue
+ *	\param[in]	len			packet length without CRC or error code
+ * \return     1 if published, 0 if dropped
+ ******************************************************************************
+*/
+static int CMD_PacketQueuePublish(CMD_PacketQueue_t *queue,int len)
+{
+	if (CMD_PacketQueuePending(queue) >= CMD_PACKET_COUNT - 1)
+	{
+		queue->dropped++;
+		return 0;
+	}
+	queue->packet[queue->head & CMD_PACKET_MASK].len = len;
+	queue->head++;											// publish the packet
+	queue->received++;
+	queue->deframer.buf = queue->packet[queue->head & CMD_PACKET_MASK].data;
+	return 1;
+}
+
+/*!
+ ******************************************************************************
+ *	Deframes received bytes (receiver side). The CRC of a complete packet is
+ *	checked, wrong packets are published with their error code so that the
+ *	dispatcher answers them with a NAK.
+ *	\param[in]	queue			queue
+ *	\param[in]	buf			received bytes
+ *	\param[in]	count			number of bytes
+ * \return     number of packets published
+ ******************************************************************************
+*/
+int CMD_PacketQueueReceive(CMD_PacketQueue_t *queue,const uint8_t *buf,int count)
+{
+int			len,n = 0;
+uint8_t		*data;
+
+	while (count--)
+	{
+		len = UART_Deframe(&queue->deframer,*buf++);
+		if (len == 0)
+			continue;
+		if (len > 0)
+		{
+			data = queue->deframer.buf;
+			if (len < 3)
+				len = CMD_PACKET_ERR_INVALID;
+			else
+			{
+				len -= 2;
+				if (queue->deframer.crc != (uint16_t)(data[len] | (data[len + 1] << 8)))
+					len = CMD_PACKET_ERR_CRC;
+			}
+		}
+		n += CMD_PacketQueuePublish(queue,len);
+	}
+	return n;
+}
+
+/*!
+ ******************************************************************************
+ *	Gets the oldest published packet (dispatcher side)
+ * \return     packet, NULL if none is pending
+ ******************************************************************************
+*/
+CMD_Packet_t * CMD_PacketQueueFront(CMD_PacketQueue_t *queue)
+{
+	if (queue->head == queue->tail)
+		return NULL;
+	return &queue->packet[queue->tail & CMD_PACKET_MASK];
+}
+
+/*!
+ ******************************************************************************
+ *	Releases the oldest published packet once it has been handled
+ ******************************************************************************
+*/
+void CMD_PacketQueuePop(CMD_PacketQueue_t *queue)
+{
+	if (queue->head != queue->tail)
+		queue->tail++;
+}
@@ -0,0 +1,71 @@
+/*
+ * CmdPacket.h
+ *
+ *  Receive queues of the command interface packets
+ */
+
+#ifndef CMDPACKET_H_
+#define CMDPACKET_H_
+
+/*!
+ ******************************************************************************
+ *	Each interface (UART, USB) owns a ring of packet descriptors. The receiver
+ *	(interrupt) deframes into the descriptor at the head and publishes it when
+ *	it is complete, the dispatcher (communication task) handles the published
+ *	descriptors in order and releases them. The host may thus send several
+ *	requests without waiting for the responses. One descriptor is always kept
+ *	for the packet being received: a completed packet which would leave none is
+ *	dropped.
+ *	This file has no hardware dependency.
+ ******************************************************************************
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "uart-ring.h"
+
+#define	CMD_PACKET_LEN					128				///< Packet buffer length (CRC included), RS232_BUFFER_LEN of uart.h
+#define	CMD_PACKET_COUNT				4					///< Descriptors per interface (power of two)
+
+#define	CMD_PACKET_ERR_CRC			(-0x04)			///< Packet error: -E_CRC_ERROR of uart.h
+#define	CMD_PACKET_ERR_INVALID		(-0x05)			///< Packet error: -E_INVALID_PACKET of uart.h
+
+typedef struct {
+	uint8_t					data[CMD_PACKET_LEN];
+	int						len;					// packet length without CRC, < 0: error code of the packet
+} CMD_Packet_t;
+
+typedef struct {
+	CMD_Packet_t			packet[CMD_PACKET_COUNT];
+	UART_Deframer_t		deframer;			// deframes into packet[head]
+	volatile uint32_t		head;					// free running index of the packet being received
+	volatile uint32_t		tail;					// free running index of the oldest published packet
+	uint8_t					source;				// interface, reported to the dispatcher
+	uint32_t					received;			// packets published
+	uint32_t					dropped;				// packets dropped, no descriptor free
+} CMD_PacketQueue_t;
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* __cplusplus */
+
+void CMD_PacketQueueInit(CMD_PacketQueue_t *queue,uint8_t source);
+int CMD_PacketQueueReceive(CMD_PacketQueue_t *queue,const uint8_t *buf,int count);
+CMD_Packet_t * CMD_PacketQueueFront(CMD_PacketQueue_t *queue);
+void CMD_PacketQueuePop(CMD_PacketQueue_t *queue);
+
+/*!
+ ******************************************************************************
+ *	Gets the number of published packets not released yet
+ ******************************************************************************
+*/
+static inline uint32_t CMD_PacketQueuePending(const CMD_PacketQueue_t *queue)
+{
+	return queue->head - queue->tail;
+}
+
+#if defined(__cplusplus)
+}
+#endif /* __cplusplus */
+
+#endif /* CMDPACKET_H_ */
@@ -17,6 +17,7 @@
 #include "System.h"
 #include "Misc.h"
 #include "CAN.h"
+#include "PWMDriver.h"
 #include "TMP100.h"
 #include "CleaningUnitMgr.h"
 #include "LiftDevice.h"
@@ -25,6 +26,9 @@
 #include "CANNode.h"
 #include "I2C.h"
 #include "EEPROM.h"
+#include "FRAM.h"
+#include "Telemetry.h"
+#include "CmdTable.h"
 
 /* Scheduler includes. */
 #include "FreeRTOS.h"
@@ -37,17 +41,26 @@
 
 extern osThreadId_t						sysThread;
 
+#define TLM_USB_BYTES_PER_SECOND				1000000		// usable bandwidth of the full speed bulk-IN endpoint
+#define SYS_EVENTS_PER_PACKET					6				// recorded events fitting into a command packet
+
+static bool TLM_ReadADC(uint8_t index,uint8_t *value);
+static bool TLM_ReadDigInputs(uint8_t index,uint8_t *value);
+static bool TLM_ReadLiftPos(uint8_t index,uint8_t *value);
+static bool TLM_ReadLiftState(uint8_t index,uint8_t *value);
+static bool TLM_ReadCanNmtState(uint8_t index,uint8_t *value);
+static bool TLM_ReadSafetyErrCntr(uint8_t index,uint8_t *value);
+
+static const TLM_SignalDef_t			tlm_catalogue[] = {
+	{ TLM_SIG_ADC,					2,	TLM_ReadADC },
+	{ TLM_SIG_DIG_INPUTS,		4,	TLM_ReadDigInputs },
+	{ TLM_SIG_LIFT_POS,			4,	TLM_ReadLiftPos },
+	{ TLM_SIG_LIFT_STATE,		2,	TLM_ReadLiftState },
+	{ TLM_SIG_CAN_NMT_STATE,	1,	TLM_ReadCanNmtState },
+	{ TLM_SIG_SAFETY_ERR_CNTR,	1,	TLM_ReadSafetyErrCntr },
+};
+static TLM_Stream_t						tlm_stream;
 
-/*!
- ******************************************************************************
- *	Initializes the System Command Handler
- * \return     1 if success, 0 else
- ******************************************************************************
-*/
-int InitSystemCommandHandler(void)
-{
-   return 1;
-}
 
 /*!
  ******************************************************************************
@@ -62,8 +75,6 @@ static int cmd_SUB_SYS_REQUEST_PING(uint8_t *data,int len)
 uint8_t     buf[10];
 int         i;
 
-   if (len < 4)
-      return(CMD_ERR_INVALID_LENGTH);
    for (i=0;i<4;i++)
       buf[i+6] = data[i] ^ 0xFF;
    MakeCommandHeader(buf,CMD_SYSTEM,CMD_ACK,SUB_SYS_REQUEST_PING,CMD_RX,BOARD_GetOwnAddress());
@@ -84,8 +95,6 @@ static int cmd_SUB_SYS_GET_ADC_VALUE(uint8_t *data,int len)
 uint8_t     buf[10];
 uint16_t    value;
 
-   if (len < 1)
-      return(CMD_ERR_INVALID_LENGTH);
    if (!BOARD_get_ADC(data[0],&value))
    	return(CMD_ERR_COMMAND_FAILED);
    MakeCommandHeader(buf,CMD_SYSTEM,CMD_ACK,SUB_SYS_GET_ADC_VALUE,CMD_RX,BOARD_GetOwnAddress());
@@ -109,8 +118,6 @@ static int cmd_SUB_SYS_GET_ADC_VAL_OFFSET(uint8_t *data,int len)
 uint8_t     buf[12];
 uint16_t    value,offset;
 
-   if (len < 1)
-      return(CMD_ERR_INVALID_LENGTH);
 	if (!BOARD_getValueAndOffset(data[0],&value,&offset))
    	return(CMD_ERR_COMMAND_FAILED);
    MakeCommandHeader(buf,CMD_SYSTEM,CMD_ACK,SUB_SYS_GET_ADC_VAL_OFFSET,CMD_RX,BOARD_GetOwnAddress());
@@ -189,8 +196,6 @@ static int cmd_SUB_SYS_GET_ADC_VALUE_FLOAT(uint8_t *data,int len)
 uint8_t     buf[12];
 float    	value;
 
-   if (len < 1)
-      return(CMD_ERR_INVALID_LENGTH);
    if (!BOARD_get_ADC_float(data[0],&value))
    	return(CMD_ERR_COMMAND_FAILED);
    MakeCommandHeader(buf,CMD_SYSTEM,CMD_ACK,SUB_SYS_GET_ADC_VALUE_FLOAT,CMD_RX,BOARD_GetOwnAddress());
@@ -383,9 +388,6 @@ int cmd_SUB_SYS_RESET_CLMNGR_MAX_CUR(uint8_t *data,int len)
 {
 uint8_t     buf[6];
 
-	if (len < 2)
-      return(CMD_ERR_INVALID_LENGTH);
-
 	if (!ClMgr_ResetMaxDeviceCurrent(GetU16_Val(data)))
 		return CMD_ERR_COMMAND_FAILED;
    MakeCommandHeader(buf,CMD_SYSTEM,CMD_ACK,SUB_SYS_RESET_CLMNGR_MAX_CUR,CMD_TX,BOARD_GetOwnAddress());
@@ -405,8 +407,6 @@ int cmd_SUB_SYS_SET_DRYRUN(uint8_t *data,int len)
 {
 uint8_t     buf[6];
 
-	if (len < 1)
-      return(CMD_ERR_INVALID_LENGTH);
 	if (!ClMgr_EnableDryRun(data[0]))
 		return CMD_ERR_COMMAND_FAILED;
    MakeCommandHeader(buf,CMD_SYSTEM,CMD_ACK,SUB_SYS_SET_DRYRUN,CMD_TX,BOARD_GetOwnAddress());
@@ -426,9 +426,6 @@ int cmd_SUB_SYS_SET_LIFT_MAX_CURRENT(uint8_t *data,int len)
 {
 uint8_t     buf[6];
 
-	if (len < 5)
-      return(CMD_ERR_INVALID_LENGTH);
-	
 	if (!SetLiftMaxCurrent(data[0],GetU16_Val(data + 1)))
 		return CMD_ERR_COMMAND_FAILED;
    MakeCommandHeader(buf,CMD_SYSTEM,CMD_ACK,SUB_SYS_SET_LIFT_MAX_CURRENT,CMD_TX,BOARD_GetOwnAddress());
@@ -449,8 +446,6 @@ int cmd_SUB_SYS_GET_LIFT_HALL_COUNT(uint8_t *data,int len)
 uint8_t     buf[12];
 int			value;
 	
-   if (len < 1)
-      return(CMD_ERR_INVALID_LENGTH);
    if ((value = GetHallCountPulses(data[0])) == -1)
    	return(CMD_ERR_COMMAND_FAILED);
    MakeCommandHeader(buf,CMD_SYSTEM,CMD_ACK,SUB_SYS_GET_LIFT_HALL_COUNT,CMD_RX,BOARD_GetOwnAddress());
@@ -473,8 +468,6 @@ uint8_t     buf[15];
 int			value;
 uint32_t		current;
 	
-   if (len < 1)
-      return(CMD_ERR_INVALID_LENGTH);
    value = GetLiftDeviceStatus(data[0]);
 	current = GetLiftDeviceOvercurrentTest(data[0]);
    MakeCommandHeader(buf,CMD_SYSTEM,CMD_ACK,SUB_SYS_GET_LIFT_DEVICE_STATUS,CMD_RX,BOARD_GetOwnAddress());
@@ -498,8 +491,6 @@ int cmd_SUB_SUB_SYS_SWITCH_RELAY(uint8_t *data,int len)
 uint8_t     buf[7];
 uint16_t		delay;
 	
-   if (len < 4)
-      return(CMD_ERR_INVALID_LENGTH);
 	delay = GetU16_Val(data+2);
 	if (delay < 2000)
 		delay = 2000;
@@ -555,8 +546,6 @@ int cmd_SUB_SYS_ENA_LIFT_HALL_CNTR(uint8_t *data,int len)
 {
 uint8_t     buf[6];
 	
-	if (len < 2)
-		return(CMD_ERR_INVALID_LENGTH);
 	if (!BOARD_EnaHallTestCounters(data[0],data[1]))
 		return CMD_ERR_COMMAND_FAILED;
    MakeCommandHeader(buf,CMD_SYSTEM,CMD_ACK,SUB_SYS_ENA_LIFT_HALL_CNTR,CMD_TX,BOARD_GetOwnAddress());
@@ -576,8 +565,6 @@ int cmd_SUB_SYS_ENA_FLOWMETER_CNTR(uint8_t *data,int len)
 {
 uint8_t     buf[6];
 	
-	if (len < 2)
-		return(CMD_ERR_INVALID_LENGTH);
 	if (!BOARD_EnaFlowMeterTestCounter(data[0],data[1]))
 		return CMD_ERR_COMMAND_FAILED;
    MakeCommandHeader(buf,CMD_SYSTEM,CMD_ACK,SUB_SYS_ENA_FLOWMETER_CNTR,CMD_TX,BOARD_GetOwnAddress());
@@ -597,8 +584,6 @@ int cmd_SUB_SYS_RESET_LIFT_HALL_CNTR(uint8_t *data,int len)
 {
 uint8_t     buf[6];
 	
-	if (len < 1)
-		return(CMD_ERR_INVALID_LENGTH);
 	if (!BOARD_ResetHallTestCounters(data[0]))
 		return CMD_ERR_COMMAND_FAILED;
    MakeCommandHeader(buf,CMD_SYSTEM,CMD_ACK,SUB_SYS_RESET_LIFT_HALL_CNTR,CMD_TX,BOARD_GetOwnAddress());
@@ -673,8 +658,6 @@ int cmd_SUB_SYS_SET_PUMP_CL_MGR(uint8_t *data,int len)
 {
 uint8_t     buf[6];
 	
-	if (len < 19)
-		return(CMD_ERR_INVALID_LENGTH);
 	if (!BOARD_ClMngr_SetParameters(GetU32_Val(data),GetU32_Val(data + 4),
 		GetU32_Val(data + 8),GetU32_Val(data + 12),GetU16_Val(data + 16)))
 		return CMD_ERR_COMMAND_FAILED;
@@ -699,8 +682,6 @@ uint8_t     buf[6];
 uint32_t		command;
 uint32_t 	params;
 	
-	if (len < 8)
-		return(CMD_ERR_INVALID_LENGTH);
 	command = GetU32_Val(data);
 	params = GetU32_Val(data + 4);
 	if (!ClMgr_SendDirectCommand(command,params))
@@ -722,8 +703,6 @@ int cmd_SUB_SYS_DISABLE_LIFT_ADJUST(uint8_t *data,int len)
 {
 uint8_t     buf[6];
 	
-	if (len < 2)
-		return(CMD_ERR_INVALID_LENGTH);
 	if (!DisableAdjust(data[0],data[1]))
 		return CMD_ERR_COMMAND_FAILED;
    MakeCommandHeader(buf,CMD_SYSTEM,CMD_ACK,SUB_SYS_DISABLE_LIFT_ADJUST,CMD_TX,BOARD_GetOwnAddress());
@@ -792,8 +771,6 @@ int cmd_SUB_SYS_GET_HEAP_INFO(uint8_t *data,int len)
 uint8_t     buf[26];
 uint32_t		heap1,heap2,heapBase,HeapSize,StackBase,StackSize;
 	
-	if (len < 1)
-		return(CMD_ERR_INVALID_LENGTH);
 	heap1 = configTOTAL_HEAP_SIZE - xPortGetMinimumEverFreeHeapSize();
 	heap2 = configTOTAL_HEAP_SIZE - xPortGetFreeHeapSize();
 	if (!BOARD_GetStackAndHeapInfo(data[0] != 0,&StackBase,&StackSize,
@@ -869,8 +846,6 @@ uint8_t     buf[15];
 uint32_t		id,subid,content;
 bool			valid;
 	
-   if (len < 4)
-      return(CMD_ERR_INVALID_LENGTH);
 	id = GetU16_Val(data);
 	subid = GetU16_Val(data+2);
 	if (!GetCAN_ProviderContent(id,subid,&content,&valid))
@@ -899,8 +874,6 @@ uint32_t		id;
 int			ObjID;
 char			*sPtr;
 	
-   if (len < 2)
-      return(CMD_ERR_INVALID_LENGTH);
 	id = GetU16_Val(data);
 	if (!GetCAN_ProviderInfo(id,&sPtr,&ObjID))
 		return CMD_ERR_COMMAND_FAILED;
@@ -925,8 +898,6 @@ int cmd_SUB_SYS_SET_LIFT_STATUS(uint8_t *data,int len)
 uint8_t     buf[6];
 uint32_t		value;
 	
-   if (len < 5)
-      return(CMD_ERR_INVALID_LENGTH);
    value = GetU32_Val(data+1);
 	if (!ChangeLiftDeviceStatus(data[0],value))
 		return CMD_ERR_COMMAND_FAILED;
@@ -948,8 +919,6 @@ int cmd_SUB_SYS_GET_PUMP_PULSE(uint8_t *data,int len)
 uint8_t     buf[11];
 uint16_t    freq,pulse;
 
-   if (len < 1)
-      return(CMD_ERR_INVALID_LENGTH);
 	if (!BOARD_GetPumpFreqPulse(*data,&freq,&pulse))
       return(CMD_ERR_COMMAND_FAILED);
    MakeCommandHeader(buf,CMD_SYSTEM,CMD_ACK,SUB_SYS_GET_PUMP_PULSE,CMD_RX,BOARD_GetOwnAddress());
@@ -973,8 +942,6 @@ int cmd_SUB_SYS_GET_PUMP_ENABLE(uint8_t *data,int len)
 uint8_t     buf[8];
 bool    		onoff;
 
-   if (len < 1)
-      return(CMD_ERR_INVALID_LENGTH);
 	if (!BOARD_GetPumpStatus(*data,&onoff))
       return(CMD_ERR_COMMAND_FAILED);
    MakeCommandHeader(buf,CMD_SYSTEM,CMD_ACK,SUB_SYS_GET_PUMP_ENABLE,CMD_RX,BOARD_GetOwnAddress());
@@ -996,8 +963,6 @@ static int cmd_SUB_SYS_SET_GPIO(uint8_t *data,int len)
 {
 uint8_t     buf[6];
 
-   if (len < 2)
-      return(CMD_ERR_INVALID_LENGTH);
    if (!BOARD_WriteGPIOpin(data[0],data[1]))
    	return(CMD_ERR_COMMAND_FAILED);
    MakeCommandHeader(buf,CMD_SYSTEM,CMD_ACK,SUB_SYS_SET_GPIO,CMD_TX,BOARD_GetOwnAddress());
@@ -1018,8 +983,6 @@ static int cmd_SUB_SYS_GET_GPIO(uint8_t *data,int len)
 uint8_t     buf[8];
 uint8_t		value;
 
-   if (len < 1)
-      return(CMD_ERR_INVALID_LENGTH);
    if (!BOARD_ReadGPIOpin(data[0],&value))
    	return(CMD_ERR_COMMAND_FAILED);
    MakeCommandHeader(buf,CMD_SYSTEM,CMD_ACK,SUB_SYS_GET_GPIO,CMD_RX,BOARD_GetOwnAddress());
@@ -1041,8 +1004,6 @@ static int cmd_SUB_SYS_SET_DIG_VALUE(uint8_t *data,int len)
 {
 uint8_t     buf[8];
 
-   if (len < 2)
-      return(CMD_ERR_INVALID_LENGTH);
    if (!BOARD_SetGPIO_Output(data[0],data[1]))
    	return(CMD_ERR_COMMAND_FAILED);
    MakeCommandHeader(buf,CMD_SYSTEM,CMD_ACK,SUB_SYS_SET_DIG_VALUE,CMD_TX,BOARD_GetOwnAddress());
@@ -1064,8 +1025,6 @@ static int cmd_SUB_SYS_SET_DIG_SECURITY_VALUE(uint8_t *data,int len)
 {
 uint8_t     buf[8];
 
-   if (len < 2)
-      return(CMD_ERR_INVALID_LENGTH);
    if (!BOARD_SetSecurityOutput(data[0],data[1]))
    	return(CMD_ERR_COMMAND_FAILED);
 	buf[6] = data[0];
@@ -1087,8 +1046,6 @@ static int cmd_SUB_SYS_SET_TEST_MUX(uint8_t *data,int len)
 {
 uint8_t     buf[6];
 
-   if (len < 2)
-      return(CMD_ERR_INVALID_LENGTH);
    if (!BOARD_SetTestMUX(data[0],data[1]))
    	return(CMD_ERR_COMMAND_FAILED);
    MakeCommandHeader(buf,CMD_SYSTEM,CMD_ACK,SUB_SYS_SET_TEST_MUX,CMD_TX,BOARD_GetOwnAddress());
@@ -1108,8 +1065,6 @@ static int cmd_SUB_SYS_SET_PWM_CONTROL(uint8_t *data,int len)
 {
 uint8_t     buf[7];
 
-   if (len < 4)
-      return(CMD_ERR_INVALID_LENGTH);
 	if (!BOARD_SetPWMControl(data[0],GetU16_Val(data+2),(eDirMode_t)(data[1])))
    	return(CMD_ERR_COMMAND_FAILED);
 	buf[6] = data[0];
@@ -1130,8 +1085,6 @@ static int cmd_SUB_SYS_SET_CAN_PARAMETERS(uint8_t *data,int len)
 {
 uint8_t     buf[6];
 
-   if (len < 13)
-      return(CMD_ERR_INVALID_LENGTH);
 	if (!CAN_ChangeParameters(0,GetU32_Val(data),GetU32_Val(data+4),
                          GetU32_Val(data+8),data[12]))
    	return(CMD_ERR_COMMAND_FAILED);
@@ -1152,8 +1105,6 @@ static int cmd_SUB_SYS_SET_CAN_ACCEPTANCE(uint8_t *data,int len)
 {
 uint8_t     buf[6];
 
-   if (len < 5)
-      return(CMD_ERR_INVALID_LENGTH);
 	if (!CAN_SetAcceptanceFilter(0,GetU32_Val(data),data[4]))
    	return(CMD_ERR_COMMAND_FAILED);
    MakeCommandHeader(buf,CMD_SYSTEM,CMD_ACK,SUB_SYS_SET_CAN_ACCEPTANCE,CMD_TX,BOARD_GetOwnAddress());
@@ -1173,8 +1124,6 @@ static int cmd_SUB_SYS_SET_CAN_ID(uint8_t *data,int len)
 {
 uint8_t     buf[6];
 
-   if (len < 5)
-      return(CMD_ERR_INVALID_LENGTH);
 	if (!CAN_ChangeID(0,GetU32_Val(data),data[4]))
    	return(CMD_ERR_COMMAND_FAILED);
    MakeCommandHeader(buf,CMD_SYSTEM,CMD_ACK,SUB_SYS_SET_CAN_ID,CMD_TX,BOARD_GetOwnAddress());
@@ -1220,8 +1169,6 @@ uint8_t     buf[6];
 		data[5]		1 if CAN ID is an extended ID, 0 else
 		data[6..12]	Payload (size depends on Payload Length (0 .. 8)
 	*/
-   if (len < 6)
-      return(CMD_ERR_INVALID_LENGTH);
    if (len < 6 + data[4])		// Check the payload length
       return(CMD_ERR_INVALID_LENGTH);
 	if (!CAN_SendMessage(0,GetU32_Val(data),data[5],data + 6,data[4]))
@@ -1243,8 +1190,6 @@ static int cmd_SUB_SYS_SET_CAN_BAUDRATE(uint8_t *data,int len)
 {
 uint8_t     buf[6];
 
-   if (len < 4)
-      return(CMD_ERR_INVALID_LENGTH);
 	if (!CAN_ChangeBaudrate(0,GetU32_Val(data)))
    	return(CMD_ERR_COMMAND_FAILED);
    MakeCommandHeader(buf,CMD_SYSTEM,CMD_ACK,SUB_SYS_SET_CAN_BAUDRATE,CMD_TX,BOARD_GetOwnAddress());
@@ -1264,8 +1209,6 @@ static int cmd_SUB_SYS_SET_SECURITY_GPIOS(uint8_t *data,int len)
 {
 uint8_t     buf[6];
 
-   if (len < 4)
-      return(CMD_ERR_INVALID_LENGTH);
 	if (!BOARD_SetAllSecurityOutput(GetU32_Val(data)))
    	return(CMD_ERR_COMMAND_FAILED);
    MakeCommandHeader(buf,CMD_SYSTEM,CMD_ACK,SUB_SYS_SET_SECURITY_GPIOS,CMD_TX,BOARD_GetOwnAddress());
@@ -1285,8 +1228,6 @@ static int cmd_SUB_SYS_SET_ALL_CUC_TASKS_ENA(uint8_t *data,int len)
 {
 uint8_t     buf[6];
 
-   if (len < 1)
-      return(CMD_ERR_INVALID_LENGTH);		
 	if (*data != 0)
 	{
 		if (sysThread != NULL)
@@ -1318,8 +1259,6 @@ static int cmd_SUB_SYS_SET_TEST_EXT_WD(uint8_t *data,int len)
 {
 uint8_t     buf[6];
 
-   if (len < 1)
-      return(CMD_ERR_INVALID_LENGTH);
 	if (!BOARD_Set_Test_Ext_WD(*data))
    	return(CMD_ERR_COMMAND_FAILED);
    MakeCommandHeader(buf,CMD_SYSTEM,CMD_ACK,SUB_SYS_SET_TEST_EXT_WD,CMD_TX,BOARD_GetOwnAddress());
@@ -1339,8 +1278,6 @@ static int cmd_SUB_SYS_SET_PUMP_PULSE(uint8_t *data,int len)
 {
 uint8_t     buf[6];
 
-   if (len < 5)
-      return(CMD_ERR_INVALID_LENGTH);
 	if (!BOARD_SetPumpPWM(*data,1000))
    	return(CMD_ERR_COMMAND_FAILED);
 	if (!BOARD_SetPumpFreqPulse(*data,GetU16_Val(data + 1), GetU16_Val(data + 3)))
@@ -1362,8 +1299,6 @@ static int cmd_SUB_SYS_SET_PUMP_ENABLE(uint8_t *data,int len)
 {
 uint8_t     buf[6];
 
-   if (len < 2)
-      return(CMD_ERR_INVALID_LENGTH);
 	if (!BOARD_EnablePump(data[0],data[1] != 0))
    	return(CMD_ERR_COMMAND_FAILED);
    MakeCommandHeader(buf,CMD_SYSTEM,CMD_ACK,SUB_SYS_SET_PUMP_ENABLE,CMD_TX,BOARD_GetOwnAddress());
@@ -1401,8 +1336,6 @@ static int cmd_SUB_SYS_SET_SAFETYMNGR_CHECKS(uint8_t *data,int len)
 {
 uint8_t     buf[6];
 
-   if (len < 4)
-      return(CMD_ERR_INVALID_LENGTH);
 	SafetyMngrEnableChecks(GetU32_Val(data));
    MakeCommandHeader(buf,CMD_SYSTEM,CMD_ACK,SUB_SYS_SET_SAFETYMNGR_CHECKS,CMD_TX,BOARD_GetOwnAddress());
    SendPacketCMD(buf,sizeof(buf));
@@ -1445,8 +1378,6 @@ static int cmd_SUB_SYS_GET_DIG_VALUE(uint8_t *data,int len)
 uint8_t     buf[8];
 uint8_t		value;
 
-   if (len < 1)
-      return(CMD_ERR_INVALID_LENGTH);
    if (!BOARD_GetGPIO_Input(data[0],&value))
    	return(CMD_ERR_COMMAND_FAILED);
    MakeCommandHeader(buf,CMD_SYSTEM,CMD_ACK,SUB_SYS_GET_DIG_VALUE,CMD_RX,BOARD_GetOwnAddress());
@@ -1469,8 +1400,6 @@ static int cmd_SUB_SYS_GET_DIG_SECURITY_VALUE(uint8_t *data,int len)
 uint8_t     buf[8];
 uint8_t		value;
 
-   if (len < 1)
-      return(CMD_ERR_INVALID_LENGTH);
    if (!BOARD_GetSecurityGPIO(data[0],&value))
    	return(CMD_ERR_COMMAND_FAILED);
    MakeCommandHeader(buf,CMD_SYSTEM,CMD_ACK,SUB_SYS_GET_DIG_SECURITY_VALUE,CMD_RX,BOARD_GetOwnAddress());
@@ -1536,8 +1465,6 @@ static int cmd_SUB_SYS_GET_DIG_READBACK(uint8_t *data,int len)
 uint8_t     buf[8];
 uint8_t     value;
 
-   if (len < 1)
-      return(CMD_ERR_INVALID_LENGTH);
    if (!BOARD_GetGPIO_Readback(data[0],&value))
    	return(CMD_ERR_COMMAND_FAILED);
    MakeCommandHeader(buf,CMD_SYSTEM,CMD_ACK,SUB_SYS_GET_DIG_READBACK,CMD_RX,BOARD_GetOwnAddress());
@@ -1560,8 +1487,6 @@ static int cmd_SUB_SYS_GET_ALL_DIG_READBACKS(uint8_t *data,int len)
 uint8_t     buf[10];
 uint32_t    value;
 
-   if (len < 1)
-      return(CMD_ERR_INVALID_LENGTH);
    if (!BOARD_GetAllGPIO_Inputs(data[0],&value))
    	return(CMD_ERR_COMMAND_FAILED);
    MakeCommandHeader(buf,CMD_SYSTEM,CMD_ACK,SUB_SYS_GET_ALL_DIG_READBACKS,CMD_RX,BOARD_GetOwnAddress());
@@ -1606,8 +1531,6 @@ uint8_t     	buf[20];
 uint32_t    	dutycycle1,dutycycle2,pwm;
 eDirMode_t		DirMode;
 
-   if (len < 1)
-      return(CMD_ERR_INVALID_LENGTH);
 #if defined (USE_DRV8701P) && (USE_DRV8701P != 0)
 	if (!BOARD_GetPWMControl(data[0],&pwm,&DirMode,&dutycycle1))
    	return(CMD_ERR_COMMAND_FAILED);
@@ -1710,8 +1633,6 @@ int cmd_SUB_SYS_GET_CAN_ERROR_FLAGS(uint8_t *data,int len)
 uint8_t     buf[10];
 uint32_t		errFlags;
 
-   if (len < 1)
-      return(CMD_ERR_INVALID_LENGTH);
 	errFlags = CAN_getErrorFlags(0,data[0]);
 	MakeCommandHeader(buf,CMD_SYSTEM,CMD_ACK,SUB_SYS_GET_CAN_ERROR_FLAGS,CMD_RX,BOARD_GetOwnAddress());
    SetVal_32(buf+6,errFlags);
@@ -1775,6 +1696,42 @@ int			packet_len;
    return(CMD_OK);
 }
 
+/*!
+ ******************************************************************************
+ *	System Subcommand: Get the CAN RX and TX statistics
+ *	\param[in]	data        parameter buffer
+ *	\param[in]	len         length of paramter buffer
+ * \return     CMD_OK if success, Errorcode else
+ ******************************************************************************
+*/
+int cmd_SUB_SYS_GET_CAN_STATISTICS(uint8_t *data,int len)
+{
+uint8_t     		buf[44];
+CANstatistics_t	stats;
+
+	/*
+		data[0]			if != 0 the statistics are reset after reading
+	*/
+	if (!CAN_GetStatistics(0,&stats))
+   	return(CMD_ERR_COMMAND_FAILED);
+	if (data[0] != 0)
+		CAN_ResetStatistics(0);
+	MakeCommandHeader(buf,CMD_SYSTEM,CMD_ACK,SUB_SYS_GET_CAN_STATISTICS,CMD_RX,BOARD_GetOwnAddress());
+   SetVal_32(buf+6,stats.RX_Frames);
+   SetVal_32(buf+10,stats.RX_Lost);
+   SetVal_32(buf+14,stats.RX_MaxSize);
+   SetVal_32(buf+18,stats.RX_FifoOverflow);
+   SetVal_32(buf+22,stats.RX_FifoWarning);
+   SetVal_32(buf+26,stats.ErrorFrames);
+   SetVal_32(buf+30,stats.TX_Frames);
+   SetVal_32(buf+34,stats.TX_Lost);
+   SetVal_32(buf+38,stats.TX_MaxSize);
+   buf[42] = stats.TX_ErrorCounter;
+   buf[43] = stats.RX_ErrorCounter;
+   SendPacketCMD(buf,sizeof(buf));
+   return(CMD_OK);
+}
+
 /*!
  ******************************************************************************
  *	System Subcommand: Get the CAN baudrate
@@ -1814,8 +1771,6 @@ float			result;
 int32_t		result;
 #endif
 
-	if (len < 1)
-		return CMD_ERR_INVALID_LENGTH;
 	if (!TMP100_GetTemperature(data[0],&result))
 		return CMD_ERR_COMMAND_FAILED;
 	else
@@ -1864,7 +1819,7 @@ uint64_t		time;
  * \return     CMD_OK if success, Errorcode else
  ******************************************************************************
 */
-int cmd_SUB_SYS_GET_CLOCKS(void)
+int cmd_SUB_SYS_GET_CLOCKS(uint8_t *data,int len)
 {
 uint8_t     buf[26];
 
@@ -1881,10 +1836,12 @@ uint8_t     buf[26];
 /*!
  ******************************************************************************
  *	Gets the Device Type
+ *	\param[in]	data        parameter buffer
+ *	\param[in]	len         length of paramter buffer
  * \return     CMD_OK if success, Errorcode else
  ******************************************************************************
 */
-int cmd_SUB_SYS_GET_DEVICE_TYPE(void)
+int cmd_SUB_SYS_GET_DEVICE_TYPE(uint8_t *data,int len)
 {
 uint8_t  buf[8];
 
@@ -1907,8 +1864,6 @@ int cmd_SUB_SYS_SET_DEVICE_OWN_ADDR(uint8_t *data,int len)
 uint8_t     buf[6];
 uint16_t    address;
 
-   if (len < 2)
-      return(CMD_ERR_INVALID_LENGTH);
    address = GetU16_Val(data);
    BOARD_SetOwnAddress(address);
    MakeCommandHeader(buf,CMD_SYSTEM,CMD_ACK,SUB_SYS_SET_DEVICE_OWN_ADDR,CMD_TX,BOARD_GetOwnAddress());
@@ -1954,8 +1909,6 @@ int 			in_range;
 uint8_t 		is_up;
 uint8_t		adjust_state;
 
-   if (len < 1)
-      return(CMD_ERR_INVALID_LENGTH);
 	if (!GetLiftStateAndPos(data[0],&act_pos,&home_pos,&rest_pos,&delta_pos,
 			&work_pos,&in_range,&is_up,&adjust_state))
 		return CMD_ERR_COMMAND_FAILED;
@@ -1986,8 +1939,6 @@ uint8_t     buf[6];
 uint16_t		address;
 uint16_t		size;
 
-   if (len < 3)
-      return(CMD_ERR_INVALID_LENGTH);
 	address = GetU16_Val(data);
 	size = data[2];
 	if (len < size + 3 || len > 35)
@@ -2013,8 +1964,6 @@ uint8_t     buf[64+6+3];
 uint16_t		address;
 uint16_t		size;
 
-   if (len < 3)
-      return(CMD_ERR_INVALID_LENGTH);
 	address = GetU16_Val(data);
 	size = data[2];
 	if (size > 32)
@@ -2079,8 +2028,6 @@ int cmd_SUB_SYS_CAN_SET_SELF_RX(uint8_t *data,int len)
 {
 uint8_t     buf[6];
 
-   if (len < 1)
-      return(CMD_ERR_INVALID_LENGTH);
 	if (!CAN_EnableSelfReception(0,data[0]))
 		return CMD_ERR_COMMAND_FAILED;
    MakeCommandHeader(buf,CMD_SYSTEM,CMD_ACK,SUB_SYS_CAN_SET_SELF_RX,CMD_TX,BOARD_GetOwnAddress());
@@ -2100,8 +2047,6 @@ int cmd_SUB_SYS_INJECT_LIFT_ERROR(uint8_t *data,int len)
 {
 uint8_t     buf[6];
 
-   if (len < 3)
-      return(CMD_ERR_INVALID_LENGTH);
 	if (!Lift_InjectError(data[0],GetU16_Val(data + 1)))
 		return CMD_ERR_COMMAND_FAILED;
    MakeCommandHeader(buf,CMD_SYSTEM,CMD_ACK,SUB_SYS_INJECT_LIFT_ERROR,CMD_TX,BOARD_GetOwnAddress());
@@ -2138,9 +2083,7 @@ int cmd_SUB_SYS_SET_RAMP_SLOPE(uint8_t *data,int len)
 {
 uint8_t  buf[6];
 
-   if (len < 9)
-      return(CMD_ERR_INVALID_LENGTH);
-	if (!ClMgr_SetRampSlope(buf[0],GetU32_Val(buf + 1),GetU32_Val(buf + 5)))
+	if (!ClMgr_SetRampSlope(data[0],GetU32_Val(data + 1),GetU32_Val(data + 5)))
 		return CMD_ERR_COMMAND_FAILED;
    MakeCommandHeader(buf,CMD_SYSTEM,CMD_ACK,SUB_SYS_SET_RAMP_SLOPE,CMD_TX,BOARD_GetOwnAddress());
    SendPacketCMD(buf,sizeof(buf));
@@ -2164,6 +2107,367 @@ uint8_t  buf[8];
    return(CMD_OK);
 }
 
+/*!
+ ******************************************************************************
+ *	Gets the timing statistics of the PWM control loop (durations in ns)
+ *	\param[in]	data        parameter buffer
+ *	\param[in]	len         length of paramter buffer
+ * \return     CMD_OK if success, Errorcode else
+ ******************************************************************************
+*/
+int cmd_SUB_SYS_GET_PWM_CTRL_STATISTICS(uint8_t *data,int len)
+{
+uint8_t     				buf[38];
+PWMControlStatistics_t	stats;
+
+	/*
+		data[0]			if != 0 the statistics are reset after reading
+	*/
+	if (!PWM_GetControlStatistics(&stats))
+   	return(CMD_ERR_COMMAND_FAILED);
+	if (data[0] != 0)
+		PWM_ResetControlStatistics();
+	MakeCommandHeader(buf,CMD_SYSTEM,CMD_ACK,SUB_SYS_GET_PWM_CTRL_STATISTICS,CMD_RX,BOARD_GetOwnAddress());
+   SetVal_32(buf+6,stats.Ticks);
+   SetVal_32(buf+10,stats.ControlCycles);
+   SetVal_32(buf+14,stats.Overruns);
+   SetVal_32(buf+18,stats.IsrMax);
+   SetVal_32(buf+22,stats.LatencyMax);
+   SetVal_32(buf+26,stats.RunMax);
+   SetVal_32(buf+30,stats.PeriodMin);
+   SetVal_32(buf+34,stats.PeriodMax);
+   SendPacketCMD(buf,sizeof(buf));
+   return(CMD_OK);
+}
+
+/*!
+ ******************************************************************************
+ *	Telemetry signal: ADC value
+ ******************************************************************************
+*/
+static bool TLM_ReadADC(uint8_t index,uint8_t *value)
+{
+uint16_t    adc;
+
+	if (!BOARD_get_ADC(index,&adc))
+		return false;
+	SetVal_16(value,adc);
+	return true;
+}
+
+/*!
+ ******************************************************************************
+ *	Telemetry signal: digital inputs
+ ******************************************************************************
+*/
+static bool TLM_ReadDigInputs(uint8_t index,uint8_t *value)
+{
+uint32_t    inputs;
+
+	if (!BOARD_GetAllGPIO_Inputs(index,&inputs))
+		return false;
+	SetVal_32(value,inputs);
+	return true;
+}
+
+/*!
+ ******************************************************************************
+ *	Telemetry signal: actual position of a lift device
+ ******************************************************************************
+*/
+static bool TLM_ReadLiftPos(uint8_t index,uint8_t *value)
+{
+int 			act_pos,home_pos,rest_pos,delta_pos,work_pos,in_range;
+uint8_t 		is_up,adjust_state;
+
+	if (!GetLiftStateAndPos(index,&act_pos,&home_pos,&rest_pos,&delta_pos,
+			&work_pos,&in_range,&is_up,&adjust_state))
+		return false;
+	SetVal_32(value,act_pos);
+	return true;
+}
+
+/*!
+ ******************************************************************************
+ *	Telemetry signal: adjust state and is up of a lift device
+ ******************************************************************************
+*/
+static bool TLM_ReadLiftState(uint8_t index,uint8_t *value)
+{
+int 			act_pos,home_pos,rest_pos,delta_pos,work_pos,in_range;
+uint8_t 		is_up,adjust_state;
+
+	if (!GetLiftStateAndPos(index,&act_pos,&home_pos,&rest_pos,&delta_pos,
+			&work_pos,&in_range,&is_up,&adjust_state))
+		return false;
+	value[0] = adjust_state;
+	value[1] = is_up;
+	return true;
+}
+
+/*!
+ ******************************************************************************
+ *	Telemetry signal: CANopen NMT state
+ ******************************************************************************
+*/
+static bool TLM_ReadCanNmtState(uint8_t index,uint8_t *value)
+{
+uint32_t		nProvider,id,nmt_state;
+
+	if (!GetCANstatus(&nProvider,&id,&nmt_state))
+		return false;
+	value[0] = (uint8_t)nmt_state;
+	return true;
+}
+
+/*!
+ ******************************************************************************
+ *	Telemetry signal: Safety Manager error counter
+ ******************************************************************************
+*/
+static bool TLM_ReadSafetyErrCntr(uint8_t index,uint8_t *value)
+{
+uint8_t		counters[6];
+
+	if (index >= sizeof(counters) || !SafetyMngrGetErrCounters(counters,sizeof(counters)))
+		return false;
+	value[0] = counters[index];
+	return true;
+}
+
+/*!
+ ******************************************************************************
+ *	System Subcommand: Subscribes to a set of signals which are then streamed
+ * periodically to the interface of this command (see Telemetry.h), an empty set
+ * stops the stream. The subscription is refused if the stream would exceed the
+ * bandwidth of the interface.
+ *	\param[in]	data        parameter buffer
+ *	\param[in]	len         length of paramter buffer
+ * \return     CMD_OK if success, Errorcode else
+ ******************************************************************************
+*/
+int cmd_SUB_SYS_SET_TELEMETRY(uint8_t *data,int len)
+{
+uint8_t     buf[12];
+uint32_t		bytes,capacity;
+int			ret;
+
+	/*
+		data[0..1]		period in ms, converted to ticks
+		data[2]			number of signals n
+		data[3..]		n * (signal, index, decimation)
+	*/
+	ret = TLM_Subscribe(&tlm_stream,data,len,GetCommandSource(),(uint32_t)xTaskGetTickCount(),configTICK_RATE_HZ);
+	if (ret == TLM_ERR_LENGTH)
+		return(CMD_ERR_INVALID_LENGTH);
+	if (ret != 0)
+		return(CMD_ERR_COMMAND_FAILED);
+	bytes = TLM_BytesPerSecond(&tlm_stream,configTICK_RATE_HZ);
+	capacity = (tlm_stream.source == lrSource_UART) ? CONSOLE_UART_BAUDRATE / 10 : TLM_USB_BYTES_PER_SECOND;
+	if (bytes > capacity)
+	{
+		TLM_Stop(&tlm_stream);
+		return(CMD_ERR_COMMAND_FAILED);
+	}
+   MakeCommandHeader(buf,CMD_SYSTEM,CMD_ACK,SUB_SYS_SET_TELEMETRY,CMD_TX,BOARD_GetOwnAddress());
+   SetVal_16(buf+6,(uint16_t)TLM_FrameLen(&tlm_stream));
+   SetVal_32(buf+8,bytes);
+   SendPacketCMD(buf,sizeof(buf));
+   return(CMD_OK);
+}
+
+/*!
+ ******************************************************************************
+ *	Gets the time until the next telemetry frame is due, the communication task
+ * waits no longer for commands
+ * \return     ticks, portMAX_DELAY if no stream is subscribed
+ ******************************************************************************
+*/
+uint32_t SystemTelemetryWait(void)
+{
+uint32_t		ticks = TLM_TimeToNext(&tlm_stream,(uint32_t)xTaskGetTickCount());
+
+	return ticks == UINT32_MAX ? (uint32_t)portMAX_DELAY : ticks;
+}
+
+/*!
+ ******************************************************************************
+ *	Sends the telemetry frame which is due, called by the communication task
+ ******************************************************************************
+*/
+void SystemTelemetryPoll(void)
+{
+uint8_t     buf[TLM_MAX_FRAME_LEN];
+int			len;
+
+	len = TLM_Sample(&tlm_stream,(uint32_t)xTaskGetTickCount(),buf,sizeof(buf));
+	if (len == 0)
+		return;
+   MakeCommandHeader(buf,CMD_SYSTEM,CMD_ACK,SUB_SYS_TELEMETRY_FRAME,CMD_RX,BOARD_GetOwnAddress());
+	SendPacketCMDSource(tlm_stream.source,buf,len);
+}
+
+/*!
+ ******************************************************************************
+ *	System Subcommand: Reads recorded events from the FRAM (see EventRec.h),
+ * the staged events are written before. Parameters: sequence number of the
+ * first event (4), optionally the max number of events (1). Answer: oldest
+ * and next sequence number (4 + 4), number of events (1), events (16 each:
+ * seq, time, value, source, code, crc)
+ *	\param[in]	data        parameter buffer
+ *	\param[in]	len         length of paramter buffer
+ * \return     CMD_OK if success, Errorcode else
+ ******************************************************************************
+*/
+int cmd_SUB_SYS_READ_EVENTS(uint8_t *data,int len)
+{
+uint8_t     	buf[6 + 9 + SYS_EVENTS_PER_PACKET * sizeof(EVR_Record_t)];
+EVR_Record_t	records[SYS_EVENTS_PER_PACKET];
+uint32_t			oldest,next;
+int				max = SYS_EVENTS_PER_PACKET,n;
+
+	if (len > 4 && data[4] < max)
+		max = data[4];
+	if ((n = FRAM_ReadEvents(GetU32_Val(data),records,max,&oldest,&next)) < 0)
+		return CMD_ERR_COMMAND_FAILED;
+	SetVal_32(buf + 6,oldest);
+	SetVal_32(buf + 10,next);
+	buf[14] = (uint8_t)n;
+	memcpy(buf + 15,records,n * sizeof(EVR_Record_t));
+   MakeCommandHeader(buf,CMD_SYSTEM,CMD_ACK,SUB_SYS_READ_EVENTS,CMD_RX,BOARD_GetOwnAddress());
+   SendPacketCMD(buf,15 + n * sizeof(EVR_Record_t));
+   return(CMD_OK);
+}
+
+/*!
+ ******************************************************************************
+ *	Subcommands of the system commands, sorted by subcommand: command type, min and
+ * max number of parameter bytes, handler
+ ******************************************************************************
+*/
+static const CMD_Desc_t			sys_commands[] = {
+	{ SUB_SYS_SET_DEVICE_OWN_ADDR,       CMD_TX,	2,	2,	cmd_SUB_SYS_SET_DEVICE_OWN_ADDR },
+	{ SUB_SYS_REQUEST_PING,              CMD_RX,	4,	4,	cmd_SUB_SYS_REQUEST_PING },
+	{ SUB_SYS_GET_DEVICE_TYPE,           CMD_RX,	0,	0,	cmd_SUB_SYS_GET_DEVICE_TYPE },
+	{ SUB_SYS_GET_CLOCKS,                CMD_RX,	0,	0,	cmd_SUB_SYS_GET_CLOCKS },
+	{ SUB_SYS_SET_DIG_VALUE,             CMD_TX,	2,	2,	cmd_SUB_SYS_SET_DIG_VALUE },
+	{ SUB_SYS_SET_DIG_SECURITY_VALUE,    CMD_TX,	2,	2,	cmd_SUB_SYS_SET_DIG_SECURITY_VALUE },
+	{ SUB_SYS_SET_TEST_MUX,              CMD_TX,	2,	2,	cmd_SUB_SYS_SET_TEST_MUX },
+	{ SUB_SYS_SET_GPIO,                  CMD_TX,	2,	2,	cmd_SUB_SYS_SET_GPIO },
+	{ SUB_SYS_SET_PWM_CONTROL,           CMD_TX,	4,	4,	cmd_SUB_SYS_SET_PWM_CONTROL },
+	{ SUB_SYS_SET_CAN_PARAMETERS,        CMD_TX,	13,	13,	cmd_SUB_SYS_SET_CAN_PARAMETERS },
+	{ SUB_SYS_SET_CAN_ACCEPTANCE,        CMD_TX,	5,	5,	cmd_SUB_SYS_SET_CAN_ACCEPTANCE },
+	{ SUB_SYS_SET_CAN_ID,                CMD_TX,	5,	5,	cmd_SUB_SYS_SET_CAN_ID },
+	{ SUB_SYS_CLEAR_ERRORS,              CMD_TX,	0,	0,	cmd_SUB_SYS_CLEAR_ERRORS },
+	{ SUB_SYS_SEND_CAN_MESSAGE,          CMD_TX,	6,	14,	cmd_SUB_SYS_SEND_CAN_MESSAGE },
+	{ SUB_SYS_SET_CAN_BAUDRATE,          CMD_TX,	4,	4,	cmd_SUB_SYS_SET_CAN_BAUDRATE },
+	{ SUB_SYS_SET_SECURITY_GPIOS,        CMD_TX,	4,	4,	cmd_SUB_SYS_SET_SECURITY_GPIOS },
+	{ SUB_SYS_SET_ALL_CUC_TASKS_ENA,     CMD_TX,	1,	1,	cmd_SUB_SYS_SET_ALL_CUC_TASKS_ENA },
+	{ SUB_SYS_SET_TEST_EXT_WD,           CMD_TX,	1,	1,	cmd_SUB_SYS_SET_TEST_EXT_WD },
+	{ SUB_SYS_SET_PUMP_PULSE,            CMD_TX,	5,	5,	cmd_SUB_SYS_SET_PUMP_PULSE },
+	{ SUB_SYS_SET_PUMP_ENABLE,           CMD_TX,	2,	2,	cmd_SUB_SYS_SET_PUMP_ENABLE },
+	{ SUB_SYS_RESTART_SAFETYMNGR,        CMD_TX,	0,	0,	cmd_SUB_SYS_RESTART_SAFETYMNGR },
+	{ SUB_SYS_SET_SAFETYMNGR_CHECKS,     CMD_TX,	4,	4,	cmd_SUB_SYS_SET_SAFETYMNGR_CHECKS },
+	{ SUB_SYS_SET_LIFT_STATUS,           CMD_TX,	5,	5,	cmd_SUB_SYS_SET_LIFT_STATUS },
+	{ SUB_SYS_SWITCH_RELAY,              CMD_TX,	4,	4,	cmd_SUB_SUB_SYS_SWITCH_RELAY },
+	{ SUB_SYS_ENA_LIFT_HALL_CNTR,        CMD_TX,	2,	2,	cmd_SUB_SYS_ENA_LIFT_HALL_CNTR },
+	{ SUB_SYS_RESET_LIFT_HALL_CNTR,      CMD_TX,	1,	1,	cmd_SUB_SYS_RESET_LIFT_HALL_CNTR },
+	{ SUB_SYS_ENA_FLOWMETER_CNTR,        CMD_TX,	2,	2,	cmd_SUB_SYS_ENA_FLOWMETER_CNTR },
+	{ SUB_SYS_RESET_FLOWMETER_CNTR,      CMD_TX,	0,	0,	cmd_SUB_SYS_RESET_FLOWMETER_CNTR },
+	{ SUB_SYS_RESET_ENDSWITCH_STATE,     CMD_TX,	0,	0,	cmd_SUB_SYS_RESET_ENDSWITCH_STATE },
+	{ SUB_SYS_RESET_CLMGR_FSM_ERR,       CMD_TX,	0,	0,	cmd_SUB_SYS_RESET_CLMGR_FSM_ERR },
+	{ SUB_SYS_SET_PUMP_CL_MGR,           CMD_TX,	19,	19,	cmd_SUB_SYS_SET_PUMP_CL_MGR },
+	{ SUB_SYS_SEND_CL_MGR_CMD,           CMD_TX,	8,	8,	cmd_SUB_SYS_SEND_CL_MGR_CMD },
+	{ SUB_SYS_DISABLE_LIFT_ADJUST,       CMD_TX,	2,	2,	cmd_SUB_SYS_DISABLE_LIFT_ADJUST },
+	{ SUB_SYS_SET_LIFT_MAX_CURRENT,      CMD_TX,	5,	5,	cmd_SUB_SYS_SET_LIFT_MAX_CURRENT },
+	{ SUB_SYS_GET_ADC_VALUE,             CMD_RX,	1,	1,	cmd_SUB_SYS_GET_ADC_VALUE },
+	{ SUB_SYS_GET_ADC_VALUE_FLOAT,       CMD_RX,	1,	1,	cmd_SUB_SYS_GET_ADC_VALUE_FLOAT },
+	{ SUB_SYS_GET_ALL_ADC_VALUES,        CMD_RX,	0,	0,	cmd_SUB_SYS_GET_ALL_ADC_VALUES },
+	{ SUB_SYS_GET_ALL_ADC_VAL_FLOAT,     CMD_RX,	0,	0,	cmd_SUB_SYS_GET_ALL_ADC_VAL_FLOAT },
+	{ SUB_SYS_GET_DIG_VALUE,             CMD_RX,	1,	1,	cmd_SUB_SYS_GET_DIG_VALUE },
+	{ SUB_SYS_GET_DIG_READBACK,          CMD_RX,	1,	1,	cmd_SUB_SYS_GET_DIG_READBACK },
+	{ SUB_SYS_GET_ALL_DIG_VALUES,        CMD_RX,	1,	1,	cmd_SUB_SYS_GET_ALL_DIG_VALUES },
+	{ SUB_SYS_GET_ALL_DIG_READBACKS,     CMD_RX,	1,	1,	cmd_SUB_SYS_GET_ALL_DIG_READBACKS },
+	{ SUB_SYS_GET_DIG_SECURITY_VALUE,    CMD_RX,	1,	1,	cmd_SUB_SYS_GET_DIG_SECURITY_VALUE },
+	{ SUB_SYS_GET_ALL_DIG_SEC_VALUES,    CMD_RX,	0,	0,	cmd_SUB_SYS_GET_ALL_DIG_SEC_VALUES },
+	{ SUB_SYS_GET_TEST_MUX,              CMD_RX,	0,	0,	cmd_SUB_SYS_GET_TEST_MUX },
+	{ SUB_SYS_GET_GPIO,                  CMD_RX,	1,	1,	cmd_SUB_SYS_GET_GPIO },
+	{ SUB_SYS_GET_PWM_CONTROL,           CMD_RX,	1,	1,	cmd_SUB_SYS_GET_PWM_CONTROL },
+	{ SUB_SYS_GET_ALL_DIG_IOS,           CMD_RX,	0,	0,	cmd_SUB_SYS_GET_ALL_DIG_IOS },
+	{ SUB_SYS_GET_CAN_PARAMETERS,        CMD_RX,	0,	0,	cmd_SUB_SYS_GET_CAN_PARAMETERS },
+	{ SUB_SYS_GET_CAN_ACCEPTANCE,        CMD_RX,	0,	0,	cmd_SUB_SYS_GET_CAN_ACCEPTANCE },
+	{ SUB_SYS_GET_CAN_ID,                CMD_RX,	0,	0,	cmd_SUB_SYS_GET_CAN_ID },
+	{ SUB_SYS_GET_CAN_ERROR_FLAGS,       CMD_RX,	1,	1,	cmd_SUB_SYS_GET_CAN_ERROR_FLAGS },
+	{ SUB_SYS_GET_CAN_N_RX_MSGS,         CMD_RX,	0,	0,	cmd_SUB_SYS_GET_CAN_N_RX_MSGS },
+	{ SUB_SYS_GET_CAN_MESSAGE,           CMD_RX,	0,	0,	cmd_SUB_SYS_GET_CAN_MESSAGE },
+	{ SUB_SYS_GET_CAN_BAUDRATE,          CMD_RX,	0,	0,	cmd_SUB_SYS_GET_CAN_BAUDRATE },
+	{ SUB_SYS_GET_TEMPERATURE_SENSOR,    CMD_RX,	1,	1,	cmd_SUB_SYS_GET_TEMPERATURE_SENSOR },
+	{ SUB_SYS_GET_SYSTEM_TIME_NS,        CMD_RX,	0,	0,	cmd_SUB_SYS_GET_SYSTEM_TIME_NS },
+	{ SUB_SYS_GET_ADC_VAL_OFFSET,        CMD_RX,	1,	1,	cmd_SUB_SYS_GET_ADC_VAL_OFFSET },
+	{ SUB_SYS_GET_ALL_ADC_VAL_OFFSET,    CMD_RX,	0,	0,	cmd_SUB_SYS_GET_ALL_ADC_VAL_OFFSET },
+	{ SUB_SYS_GET_PUMP_PULSE,            CMD_RX,	1,	1,	cmd_SUB_SYS_GET_PUMP_PULSE },
+	{ SUB_SYS_GET_PUMP_ENABLE,           CMD_RX,	1,	1,	cmd_SUB_SYS_GET_PUMP_ENABLE },
+	{ SUB_SYS_GET_ALL_ADC_AND_TEMP_F,    CMD_RX,	0,	0,	cmd_SUB_SYS_GET_ALL_ADC_AND_TEMP_F },
+	{ SUB_SYS_GET_SAFETYMNGR_STATUS,     CMD_RX,	0,	0,	cmd_SUB_SYS_GET_SAFETYMNGR_STATUS },
+	{ SUB_SYS_GET_LIFT_HALL_COUNT,       CMD_RX,	1,	1,	cmd_SUB_SYS_GET_LIFT_HALL_COUNT },
+	{ SUB_SYS_GET_CLEANINGMNGR_STATUS,   CMD_RX,	0,	0,	cmd_SUB_SYS_GET_CLEANINGMNGR_STATUS },
+	{ SUB_SYS_GET_LIFT_DEVICE_STATUS,    CMD_RX,	1,	1,	cmd_SUB_SYS_GET_LIFT_DEVICE_STATUS },
+	{ SUB_SYS_GET_RELAY_STATUS,          CMD_RX,	0,	0,	cmd_SUB_SYS_GET_RELAY_STATUS },
+	{ SUB_SYS_GET_LIFT_HALL_CNTR,        CMD_RX,	0,	0,	cmd_SUB_SYS_GET_LIFT_HALL_CNTR },
+	{ SUB_SYS_GET_FLOWMETER_CNTR,        CMD_RX,	0,	0,	cmd_SUB_SYS_GET_FLOWMETER_CNTR },
+	{ SUB_SYS_GET_HEAP_INFO,             CMD_RX,	1,	1,	cmd_SUB_SYS_GET_HEAP_INFO },
+	{ SUB_SYS_GET_FLOWMETER_PULSES,      CMD_RX,	0,	0,	cmd_SUB_SYS_GET_FLOWMETER_PULSES },
+	{ SUB_SYS_GET_CAN_STATUS,            CMD_RX,	0,	0,	cmd_SUB_SYS_GET_CAN_STATUS },
+	{ SUB_SYS_GET_CAN_PROVIDER_DATA,     CMD_RX,	4,	4,	cmd_SUB_SYS_GET_CAN_PROVIDER_DATA },
+	{ SUB_SYS_GET_CAN_PROVIDER_INFO,     CMD_RX,	2,	2,	cmd_SUB_SYS_GET_CAN_PROVIDER_INFO },
+	{ SUB_SYS_GET_CANOPEN_CTRS,          CMD_RX,	0,	0,	cmd_SUB_SYS_GET_CANOPEN_CTRS },
+	{ SUB_SYS_GET_ENDSWITCH_STATE,       CMD_RX,	0,	0,	cmd_SUB_SYS_GET_ENDSWITCH_STATE },
+	{ SUB_SYS_GET_LIFT_STATE_POS,        CMD_RX,	1,	1,	cmd_SUB_SYS_GET_LIFT_STATE_POS },
+	{ SUB_SYS_WRITE_EEPROM,              CMD_TX,	3,	35,	cmd_SUB_SYS_WRITE_EEPROM },
+	{ SUB_SYS_READ_EEPROM,               CMD_RX,	3,	3,	cmd_SUB_SYS_READ_EEPROM },
+	{ SUB_SYS_GET_CLMNGR_MAX_CUR,        CMD_RX,	0,	0,	cmd_SUB_SYS_GET_CLMNGR_MAX_CUR },
+	{ SUB_SYS_RESET_CLMNGR_MAX_CUR,      CMD_TX,	2,	2,	cmd_SUB_SYS_RESET_CLMNGR_MAX_CUR },
+	{ SUB_SYS_SET_DRYRUN,                CMD_TX,	1,	1,	cmd_SUB_SYS_SET_DRYRUN },
+	{ SUB_SYS_GET_SAFETYMNGR_INT_STATUS, CMD_RX,	0,	0,	cmd_SUB_SYS_GET_SAFETYMNGR_INT_STATUS },
+	{ SUB_SYS_GET_PWM_STATUS,            CMD_RX,	0,	0,	cmd_SUB_SYS_GET_PWM_STATUS },
+	{ SUB_SYS_GET_SAFETY_ERR_CNTR,       CMD_RX,	0,	0,	cmd_SUB_SYS_GET_SAFETY_ERR_CNTR },
+	{ SUB_SYS_CLR_SAFETY_ERR_CNTR,       CMD_TX,	0,	0,	cmd_SUB_SYS_CLR_SAFETY_ERR_CNTR },
+	{ SUB_SYS_CAN_SET_SELF_RX,           CMD_TX,	1,	1,	cmd_SUB_SYS_CAN_SET_SELF_RX },
+	{ SUB_SYS_INJECT_LIFT_ERROR,         CMD_TX,	3,	3,	cmd_SUB_SYS_INJECT_LIFT_ERROR },
+	{ SUB_SYS_SET_RAMP_SLOPE,            CMD_TX,	9,	9,	cmd_SUB_SYS_SET_RAMP_SLOPE },
+	{ SUB_SYS_GET_CAN_STATISTICS,        CMD_RX,	1,	1,	cmd_SUB_SYS_GET_CAN_STATISTICS },
+	{ SUB_SYS_GET_PWM_CTRL_STATISTICS,   CMD_RX,	1,	1,	cmd_SUB_SYS_GET_PWM_CTRL_STATISTICS },
+	{ SUB_SYS_SET_TELEMETRY,             CMD_TX,	3,	TLM_MAX_SUBSCRIPTION_LEN,	cmd_SUB_SYS_SET_TELEMETRY },
+	{ SUB_SYS_READ_EVENTS,               CMD_RX,	4,	5,	cmd_SUB_SYS_READ_EVENTS },
+};
+
+/*!
+ ******************************************************************************
+ *	Initializes the System Command Handler
+ * \return     1 if success, 0 else
+ ******************************************************************************
+*/
+int InitSystemCommandHandler(void)
+{
+   TLM_Init(&tlm_stream,tlm_catalogue,sizeof(tlm_catalogue) / sizeof(tlm_catalogue[0]));
+   if (!CMD_TableValid(sys_commands,sizeof(sys_commands) / sizeof(sys_commands[0])))
+      return 0;
+   return 1;
+}
+
+/*!
+ ******************************************************************************
+ *	Gets the descriptors of the system subcommands
+ *	\param[out]	count       number of descriptors
+ * \return     descriptors, sorted by subcommand
+ ******************************************************************************
+*/
+const CMD_Desc_t *GetSystemCommandTable(int *count)
+{
+   *count = sizeof(sys_commands) / sizeof(sys_commands[0]);
+   return sys_commands;
+}
+
 /*!
  ******************************************************************************
  *	System Command: Calls the System SUB-Command functions
@@ -2175,278 +2479,14 @@ uint8_t  buf[8];
 */
 int SystemCommandHandler(int16_t dev_nr,uint8_t *command,int len)
 {
-   switch(*command)
-   {
-		case SUB_SYS_REQUEST_PING:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_REQUEST_PING(command+1,len-1);
-		case SUB_SYS_SET_DEVICE_OWN_ADDR:
-			SendCommandType(CMD_TX);
-			return cmd_SUB_SYS_SET_DEVICE_OWN_ADDR(command+1,len-1);
-		case SUB_SYS_SET_DIG_VALUE:
-			SendCommandType(CMD_TX);
-			return cmd_SUB_SYS_SET_DIG_VALUE(command+1,len-1);
-		case SUB_SYS_SET_GPIO:
-			SendCommandType(CMD_TX);
-			return cmd_SUB_SYS_SET_GPIO(command+1,len-1);
-		case SUB_SYS_SET_DIG_SECURITY_VALUE:
-			SendCommandType(CMD_TX);
-			return cmd_SUB_SYS_SET_DIG_SECURITY_VALUE(command+1,len-1);
-		case SUB_SYS_SET_TEST_MUX:
-			SendCommandType(CMD_TX);
-			return cmd_SUB_SYS_SET_TEST_MUX(command+1,len-1);
-		case SUB_SYS_SET_PWM_CONTROL:
-			SendCommandType(CMD_TX);
-			return cmd_SUB_SYS_SET_PWM_CONTROL(command+1,len-1);
-		case SUB_SYS_SET_CAN_PARAMETERS:
-			SendCommandType(CMD_TX);
-			return cmd_SUB_SYS_SET_CAN_PARAMETERS(command+1,len-1);
-		case SUB_SYS_SET_CAN_ACCEPTANCE:
-			SendCommandType(CMD_TX);
-			return cmd_SUB_SYS_SET_CAN_ACCEPTANCE(command+1,len-1);
-		case SUB_SYS_SET_CAN_ID:
-			SendCommandType(CMD_TX);
-			return cmd_SUB_SYS_SET_CAN_ID(command+1,len-1);
-		case SUB_SYS_CLEAR_ERRORS:
-			SendCommandType(CMD_TX);
-			return cmd_SUB_SYS_CLEAR_ERRORS(command+1,len-1);
-		case SUB_SYS_SEND_CAN_MESSAGE:
-			SendCommandType(CMD_TX);
-			return cmd_SUB_SYS_SEND_CAN_MESSAGE(command+1,len-1);
-		case SUB_SYS_SET_CAN_BAUDRATE:
-			SendCommandType(CMD_TX);
-			return cmd_SUB_SYS_SET_CAN_BAUDRATE(command+1,len-1);
-		case SUB_SYS_SET_SECURITY_GPIOS:
-			SendCommandType(CMD_TX);
-			return cmd_SUB_SYS_SET_SECURITY_GPIOS(command+1,len-1);
-		case SUB_SYS_SET_ALL_CUC_TASKS_ENA:
-			SendCommandType(CMD_TX);
-			return cmd_SUB_SYS_SET_ALL_CUC_TASKS_ENA(command+1,len-1);
-		case SUB_SYS_SET_TEST_EXT_WD:
-			SendCommandType(CMD_TX);
-			return cmd_SUB_SYS_SET_TEST_EXT_WD(command+1,len-1);
-		case SUB_SYS_SET_PUMP_PULSE:
-			SendCommandType(CMD_TX);
-			return cmd_SUB_SYS_SET_PUMP_PULSE(command+1,len-1);
-		case SUB_SYS_SET_PUMP_ENABLE:
-			SendCommandType(CMD_TX);
-			return cmd_SUB_SYS_SET_PUMP_ENABLE(command+1,len-1);
-		case SUB_SYS_SET_SAFETYMNGR_CHECKS:
-			SendCommandType(CMD_TX);
-			return cmd_SUB_SYS_SET_SAFETYMNGR_CHECKS(command+1,len-1);
-		case SUB_SYS_RESTART_SAFETYMNGR:
-			SendCommandType(CMD_TX);
-			return cmd_SUB_SYS_RESTART_SAFETYMNGR(command+1,len-1);
-		case SUB_SYS_SET_LIFT_STATUS:
-			SendCommandType(CMD_TX);
-			return cmd_SUB_SYS_SET_LIFT_STATUS(command+1,len-1);
-		case SUB_SYS_ENA_LIFT_HALL_CNTR:
-			SendCommandType(CMD_TX);
-			return cmd_SUB_SYS_ENA_LIFT_HALL_CNTR(command+1,len-1);
-		case SUB_SYS_RESET_LIFT_HALL_CNTR:
-			SendCommandType(CMD_TX);
-			return cmd_SUB_SYS_RESET_LIFT_HALL_CNTR(command+1,len-1);
-		case SUB_SYS_ENA_FLOWMETER_CNTR:
-			SendCommandType(CMD_TX);
-			return cmd_SUB_SYS_ENA_FLOWMETER_CNTR(command+1,len-1);
-		case SUB_SYS_RESET_FLOWMETER_CNTR:
-			SendCommandType(CMD_TX);
-			return cmd_SUB_SYS_RESET_FLOWMETER_CNTR(command+1,len-1);
-		case SUB_SYS_RESET_ENDSWITCH_STATE:
-			SendCommandType(CMD_TX);
-			return cmd_SUB_SYS_RESET_ENDSWITCH_STATE(command+1,len-1);
-		case SUB_SYS_RESET_CLMGR_FSM_ERR:
-			SendCommandType(CMD_TX);
-			return cmd_SUB_SYS_RESET_CLMGR_FSM_ERR(command+1,len-1);
-		case SUB_SYS_SET_PUMP_CL_MGR:
-			SendCommandType(CMD_TX);
-			return cmd_SUB_SYS_SET_PUMP_CL_MGR(command+1,len-1);
-		case SUB_SYS_SEND_CL_MGR_CMD:
-			SendCommandType(CMD_TX);
-			return cmd_SUB_SYS_SEND_CL_MGR_CMD(command+1,len-1);
-		case SUB_SYS_DISABLE_LIFT_ADJUST:
-			SendCommandType(CMD_TX);
-			return cmd_SUB_SYS_DISABLE_LIFT_ADJUST(command+1,len-1);
-		case SUB_SYS_RESET_CLMNGR_MAX_CUR:
-			SendCommandType(CMD_TX);
-			return cmd_SUB_SYS_RESET_CLMNGR_MAX_CUR(command+1,len-1);
-		case SUB_SYS_SET_DRYRUN:
-			SendCommandType(CMD_TX);
-			return cmd_SUB_SYS_SET_DRYRUN(command+1,len-1);
-		case SUB_SYS_SET_LIFT_MAX_CURRENT:
-			SendCommandType(CMD_TX);
-			return cmd_SUB_SYS_SET_LIFT_MAX_CURRENT(command+1,len-1);
-
-		case SUB_SYS_GET_DEVICE_TYPE:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_DEVICE_TYPE();
-		case SUB_SYS_GET_CLOCKS:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_CLOCKS();
-		case SUB_SYS_GET_ADC_VALUE:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_ADC_VALUE(command+1,len-1);
-		case SUB_SYS_GET_ALL_ADC_VALUES:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_ALL_ADC_VALUES(command+1,len-1);
-		case SUB_SYS_GET_ADC_VALUE_FLOAT:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_ADC_VALUE_FLOAT(command+1,len-1);
-		case SUB_SYS_GET_ALL_ADC_VAL_FLOAT:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_ALL_ADC_VAL_FLOAT(command+1,len-1);
-		case SUB_SYS_GET_DIG_VALUE:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_DIG_VALUE(command+1,len-1);
-		case SUB_SYS_GET_DIG_SECURITY_VALUE:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_DIG_SECURITY_VALUE(command+1,len-1);
-		case SUB_SYS_GET_ALL_DIG_VALUES:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_ALL_DIG_VALUES(command+1,len-1);
-		case SUB_SYS_GET_ALL_DIG_SEC_VALUES:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_ALL_DIG_SEC_VALUES(command+1,len-1);
-		case SUB_SYS_GET_DIG_READBACK:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_DIG_READBACK(command+1,len-1);
-		case SUB_SYS_GET_ALL_DIG_READBACKS:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_ALL_DIG_READBACKS(command+1,len-1);
-		case SUB_SYS_GET_TEST_MUX:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_TEST_MUX(command+1,len-1);
-		case SUB_SYS_GET_GPIO:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_GPIO(command+1,len-1);
-		case SUB_SYS_GET_ALL_DIG_IOS:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_ALL_DIG_IOS(command+1,len-1);
-		case SUB_SYS_GET_PWM_CONTROL:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_PWM_CONTROL(command+1,len-1);
-		case SUB_SYS_GET_CAN_ACCEPTANCE:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_CAN_ACCEPTANCE(command+1,len-1);
-		case SUB_SYS_GET_CAN_BAUDRATE:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_CAN_BAUDRATE(command+1,len-1);
-		case SUB_SYS_GET_CAN_ERROR_FLAGS:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_CAN_ERROR_FLAGS(command+1,len-1);
-		case SUB_SYS_GET_CAN_ID:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_CAN_ID(command+1,len-1);
-		case SUB_SYS_GET_CAN_N_RX_MSGS:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_CAN_N_RX_MSGS(command+1,len-1);
-		case SUB_SYS_GET_CAN_PARAMETERS:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_CAN_PARAMETERS(command+1,len-1);
-		case SUB_SYS_GET_CAN_MESSAGE:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_CAN_MESSAGE(command+1,len-1);
-		case SUB_SYS_GET_TEMPERATURE_SENSOR:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_TEMPERATURE_SENSOR(command+1,len-1);
-		case SUB_SYS_GET_SYSTEM_TIME_NS:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_SYSTEM_TIME_NS(command+1,len-1);
-		case SUB_SYS_GET_ADC_VAL_OFFSET:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_ADC_VAL_OFFSET(command+1,len-1);
-		case SUB_SYS_GET_ALL_ADC_VAL_OFFSET:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_ALL_ADC_VAL_OFFSET(command+1,len-1);
-		case SUB_SYS_GET_PUMP_PULSE:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_PUMP_PULSE(command+1,len-1);
-		case SUB_SYS_GET_PUMP_ENABLE:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_PUMP_ENABLE(command+1,len-1);
-		case SUB_SYS_GET_ALL_ADC_AND_TEMP_F:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_ALL_ADC_AND_TEMP_F(command+1,len-1);
-		case SUB_SYS_GET_SAFETYMNGR_STATUS:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_SAFETYMNGR_STATUS(command+1,len-1);
-		case SUB_SYS_GET_SAFETYMNGR_INT_STATUS:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_SAFETYMNGR_INT_STATUS(command+1,len-1);
-		case SUB_SYS_GET_CLEANINGMNGR_STATUS:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_CLEANINGMNGR_STATUS(command+1,len-1);
-		case SUB_SYS_GET_CLMNGR_MAX_CUR:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_CLMNGR_MAX_CUR(command+1,len-1);
-		case SUB_SYS_GET_LIFT_HALL_COUNT:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_LIFT_HALL_COUNT(command+1,len-1);
-		case SUB_SYS_GET_LIFT_DEVICE_STATUS:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_LIFT_DEVICE_STATUS(command+1,len-1);
-		case SUB_SYS_SWITCH_RELAY:
-			SendCommandType(CMD_TX);
-			return cmd_SUB_SUB_SYS_SWITCH_RELAY(command+1,len-1);
-		case SUB_SYS_GET_RELAY_STATUS:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_RELAY_STATUS(command+1,len-1);
-		case SUB_SYS_GET_LIFT_HALL_CNTR:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_LIFT_HALL_CNTR(command+1,len-1);
-		case SUB_SYS_GET_FLOWMETER_CNTR:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_FLOWMETER_CNTR(command+1,len-1);
-		case SUB_SYS_GET_HEAP_INFO:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_HEAP_INFO(command+1,len-1);
-		case SUB_SYS_GET_FLOWMETER_PULSES:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_FLOWMETER_PULSES(command+1,len-1);
-		case SUB_SYS_GET_CAN_STATUS:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_CAN_STATUS(command+1,len-1);
-		case SUB_SYS_GET_CAN_PROVIDER_DATA:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_CAN_PROVIDER_DATA(command+1,len-1);
-		case SUB_SYS_GET_CAN_PROVIDER_INFO:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_CAN_PROVIDER_INFO(command+1,len-1);
-		case SUB_SYS_GET_CANOPEN_CTRS:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_CANOPEN_CTRS(command+1,len-1);
-		case SUB_SYS_GET_ENDSWITCH_STATE:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_ENDSWITCH_STATE(command+1,len-1);
-		case SUB_SYS_GET_LIFT_STATE_POS:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_LIFT_STATE_POS(command+1,len-1);
-		case SUB_SYS_WRITE_EEPROM:
-			SendCommandType(CMD_TX);
-			return cmd_SUB_SYS_WRITE_EEPROM(command+1,len-1);
-		case SUB_SYS_READ_EEPROM:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_READ_EEPROM(command+1,len-1);		
-		case SUB_SYS_GET_SAFETY_ERR_CNTR:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_SAFETY_ERR_CNTR(command+1,len-1);
-		case SUB_SYS_CLR_SAFETY_ERR_CNTR:
-			SendCommandType(CMD_TX);
-			return cmd_SUB_SYS_CLR_SAFETY_ERR_CNTR(command+1,len-1);
-		case SUB_SYS_CAN_SET_SELF_RX:
-			SendCommandType(CMD_TX);
-			return cmd_SUB_SYS_CAN_SET_SELF_RX(command+1,len-1);
-		case SUB_SYS_INJECT_LIFT_ERROR:
-			SendCommandType(CMD_TX);
-			return cmd_SUB_SYS_INJECT_LIFT_ERROR(command+1,len-1);		
-		case SUB_SYS_SET_RAMP_SLOPE:
-			SendCommandType(CMD_TX);
-			return cmd_SUB_SYS_SET_RAMP_SLOPE(command+1,len-1);
-		case SUB_SYS_GET_PWM_STATUS:
-			SendCommandType(CMD_RX);
-			return cmd_SUB_SYS_GET_PWM_STATUS(command+1,len-1);		
-      default:
-         return CMD_ERR_UNKNOWN_SUBCMD;    	// we should never get there!
-   }
+const CMD_Desc_t     *desc;
+
+   desc = CMD_FindDesc(sys_commands,sizeof(sys_commands) / sizeof(sys_commands[0]),*command);
+   if (desc == NULL)
+      return CMD_ERR_UNKNOWN_SUBCMD;
+   SendCommandType(desc->type);
+   if (!CMD_CheckLen(desc,len - 1))
+      return(CMD_ERR_INVALID_LENGTH);
+   return desc->handler(command+1,len-1);
 }
 
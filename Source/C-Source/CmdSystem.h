@@ -9,8 +9,20 @@
 #define CMDSYSTEM_H_
 
 #include <stdint.h>
+#include "CmdTable.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* __cplusplus */
 
 int InitSystemCommandHandler(void);
 int SystemCommandHandler(int16_t dev_nr,uint8_t *command,int len);
+const CMD_Desc_t *GetSystemCommandTable(int *count);
+uint32_t SystemTelemetryWait(void);
+void SystemTelemetryPoll(void);
+
+#if defined(__cplusplus)
+}
+#endif /* __cplusplus */
 
 #endif /* CMDSYSTEM_H_ */
@@ -0,0 +1,103 @@
+/*
+ * CmdTable.h
+ *
+ *  Descriptor tables of the subcommand handlers
+ */
+
+#ifndef CMDTABLE_H_
+#define CMDTABLE_H_
+
+/*!
+ ******************************************************************************
+ *	A command handler owns a const table with one descriptor per subcommand,
+ *	sorted by subcommand. The dispatcher looks the subcommand up by binary
+ *	search, sets the command type and checks the parameter length against the
+ *	descriptor, so that the handlers only see parameters of a valid length.
+ *	This file has no hardware dependency.
+ ******************************************************************************
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define CMD_LEN_ANY					0xFF						///< No upper limit of the parameter length
+
+typedef int (*CMD_Handler_t)(uint8_t *data,int len);	///< Subcommand handler, CMD_OK if success
+
+typedef struct {
+	uint8_t					subcmd;			// subcommand
+	uint8_t					type;				// CMD_TX or CMD_RX
+	uint8_t					min_len;			// min number of parameter bytes
+	uint8_t					max_len;			// max number of parameter bytes or CMD_LEN_ANY
+	CMD_Handler_t			handler;
+} CMD_Desc_t;
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* __cplusplus */
+
+/*!
+ ******************************************************************************
+ *	Finds the descriptor of a subcommand
+ *	\param[in]	table			descriptors sorted by subcommand
+ *	\param[in]	count			number of descriptors
+ *	\param[in]	subcmd		subcommand
+ * \return     descriptor, NULL if the subcommand is unknown
+ ******************************************************************************
+*/
+static inline const CMD_Desc_t *CMD_FindDesc(const CMD_Desc_t *table,int count,uint8_t subcmd)
+{
+int		lo = 0,hi = count - 1,mid;
+
+	while (lo <= hi)
+	{
+		mid = (lo + hi) >> 1;
+		if (table[mid].subcmd == subcmd)
+			return &table[mid];
+		if (table[mid].subcmd < subcmd)
+			lo = mid + 1;
+		else
+			hi = mid - 1;
+	}
+	return NULL;
+}
+
+/*!
+ ******************************************************************************
+ *	Checks the parameter length of a subcommand
+ *	\param[in]	desc			descriptor
+ *	\param[in]	len			number of parameter bytes
+ * \return     true if the length is valid
+ ******************************************************************************
+*/
+static inline bool CMD_CheckLen(const CMD_Desc_t *desc,int len)
+{
+	if (len < desc->min_len)
+		return false;
+	return desc->max_len == CMD_LEN_ANY || len <= desc->max_len;
+}
+
+/*!
+ ******************************************************************************
+ *	Checks that a table is sorted by subcommand without duplicates
+ * \return     true if the table can be searched
+ ******************************************************************************
+*/
+static inline bool CMD_TableValid(const CMD_Desc_t *table,int count)
+{
+	for (int i = 0;i < count;i++)
+	{
+		if (table[i].handler == NULL || table[i].min_len > table[i].max_len)
+			return false;
+		if (i > 0 && table[i - 1].subcmd >= table[i].subcmd)
+			return false;
+	}
+	return true;
+}
+
+#if defined(__cplusplus)
+}
+#endif /* __cplusplus */
+
+#endif /* CMDTABLE_H_ */
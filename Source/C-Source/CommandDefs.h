@@ -144,6 +144,19 @@
 #define SUB_SYS_INJECT_LIFT_ERROR			0xA3						//!< SUBCOMMAND: Injects a Lift Device Error
 
 #define SUB_SYS_SET_RAMP_SLOPE				0xA4						//!< SUBCOMMAND: Sets the Ramp Slope of the Brush or Suction Device
+#define SUB_SYS_GET_CAN_STATISTICS			0xA5						//!< SUBCOMMAND: Gets the CAN RX / TX Statistics
+#define SUB_SYS_GET_PWM_CTRL_STATISTICS	0xA6						//!< SUBCOMMAND: Gets the Timing Statistics of the PWM Control Loop
+#define SUB_SYS_SET_TELEMETRY					0xA7						//!< SUBCOMMAND: Subscribes to a Set of Signals streamed periodically (see Telemetry.h)
+#define SUB_SYS_TELEMETRY_FRAME				0xA8						//!< SUBCOMMAND: Telemetry Frame, sent without request
+#define SUB_SYS_READ_EVENTS					0xA9						//!< SUBCOMMAND: Reads recorded Events from the FRAM (see EventRec.h)
+
+// Telemetry Signals (SUB_SYS_SET_TELEMETRY)
+#define TLM_SIG_ADC								0x01						//!< SIGNAL: ADC value (16 Bit), index = ADC channel
+#define TLM_SIG_DIG_INPUTS						0x02						//!< SIGNAL: Digital inputs (32 Bit), index = input bank
+#define TLM_SIG_LIFT_POS						0x03						//!< SIGNAL: Actual position of a lift device (32 Bit), index = lift device
+#define TLM_SIG_LIFT_STATE						0x04						//!< SIGNAL: Adjust state (8 Bit) and is up (8 Bit) of a lift device, index = lift device
+#define TLM_SIG_CAN_NMT_STATE					0x05						//!< SIGNAL: CANopen NMT state (8 Bit)
+#define TLM_SIG_SAFETY_ERR_CNTR				0x06						//!< SIGNAL: Safety Manager error counter (8 Bit), index = counter
 
 // Info Subcommands
 #define SUB_INFO_GET_SYSTEM_INFO          0x01                 //!< SUBCOMMAND: Get System Info
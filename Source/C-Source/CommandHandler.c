@@ -5,9 +5,9 @@
  *      Author: martin
  */
 
-#include "Board.h"
+#include "board.h"
 #include "Misc.h"
-#include "crc.h"
+#include "CmdPacket.h"
 #include "CommandDefs.h"
 #include "virtual_com.h"
 #include "CommandHandler.h"
@@ -22,18 +22,12 @@ SemaphoreHandle_t                   xSemaBin_CmdPollDevices;
 static uint8_t                      t_cmd = CMD_NONE,t_subcmd = CMD_NO_SUB;
 static volatile int                 poll_timer = 0;
 
-static volatile uint8_t             rec_error = E_NO_ERROR;
-static volatile uint8_t             sbuf_0[RS232_BUFFER_LEN];
-static volatile uint8_t             rcv_buf_0[RS232_BUFFER_LEN];
-static volatile int                 packet_len = 0;
-static volatile uint8_t             packet_wait_proc_0 = 0;
-static volatile uint8_t             packet_received_0 = 0;
+#if CMD_PACKET_LEN < RS232_BUFFER_LEN
+#error "CMD_PACKET_LEN is shorter than RS232_BUFFER_LEN"
+#endif
 
-typedef enum
-{
-	lrSource_UART = 0,
-	lrSource_USB = 1
-} lrSource_t;
+static CMD_PacketQueue_t            uart_packets,usb_packets;     // received packets of each interface
+static volatile bool                packets_ready = false;        // the receivers may fill the queues
 
 static lrSource_t							lastReceiveSource = lrSource_USB;
 
@@ -41,13 +35,14 @@ static lrSource_t							lastReceiveSource = lrSource_USB;
  *********************************************************************************
  * Sends a command packet via UART or USB to the Command Interface
  * <SOP><Payload Byte> ... <16Byte Checksum><EOP>
+ * \param[in]		source	Interface (see GetCommandSource)
  * \param[in]		packet	Packet to send
  * \param[in]		len		Length of packet
  *********************************************************************************
 */
-void SendPacketCMD(uint8_t *packet,int len)
+void SendPacketCMDSource(uint8_t source,uint8_t *packet,int len)
 {
-	if (lastReceiveSource == lrSource_UART)
+	if (source == lrSource_UART)
 	{
 		UART_SendPacketCMD(packet,len);
 	}
@@ -57,6 +52,29 @@ void SendPacketCMD(uint8_t *packet,int len)
 	}
 }
 
+/*!
+ *********************************************************************************
+ * Sends a command packet to the interface of the command being handled
+ * \param[in]		packet	Packet to send
+ * \param[in]		len		Length of packet
+ *********************************************************************************
+*/
+void SendPacketCMD(uint8_t *packet,int len)
+{
+	SendPacketCMDSource(lastReceiveSource,packet,len);
+}
+
+/*!
+ *********************************************************************************
+ * Gets the interface of the command being handled, so that packets can be sent
+ * to it later on (SendPacketCMDSource)
+ *********************************************************************************
+*/
+uint8_t GetCommandSource(void)
+{
+	return (uint8_t)lastReceiveSource;
+}
+
 /*!
  ******************************************************************************
  *	Sets the command type to either TX or RX
@@ -99,6 +117,9 @@ int InitCommandHandler(void)
    xSemaBin_CmdPollDevices = xSemaphoreCreateBinary();
    if (xSemaBin_CmdPollDevices == NULL)
       return 0;
+   CMD_PacketQueueInit(&uart_packets,lrSource_UART);
+   CMD_PacketQueueInit(&usb_packets,lrSource_USB);
+   packets_ready = true;
    InitDeviceCommandHandler();
    InitInfoCommandHandler();
    InitSystemCommandHandler();
@@ -108,302 +129,154 @@ int InitCommandHandler(void)
 
 /*!
  ******************************************************************************
- *	Reads a packet that has been received. Also performs a CRC check
- *	\param[out]	packet      Buffer for received packet
- *	\param[in]	len         Length of that buffer
- * \return  packet length if success, 0 if no packet pending, else error code < 0
+ *	Handles one received packet, a NAK is sent if the packet is wrong or the
+ * command fails
+ *	\param[in]	packet      packet (CRC checked by the receiver)
+ * \return     CMD_OK or CMD_NO_COMMAND_AVAILABLE if success, Errorcode else
  ******************************************************************************
 */
-static int GetPacketCmdIF(uint8_t *packet,int len)
+static int DispatchPacket(CMD_Packet_t *packet)
 {
-int         ret;
-uint16_t    packet_crc,calc_crc;
+uint8_t              cmd;
+int                  len,ret,retry;
+uint16_t             dev_nr;
+uint8_t              *command;
 
-   if (packet_received_0)
+   len = packet->len;
+   command = packet->data;
+   if (len < 0)
    {
-      if (rec_error)
-         ret = -((int)rec_error);
+      SendNAK(CMD_NO_CMD,CMD_NO_SUB,CMD_ERR_INVALID_PACKET);
+      return(CMD_ERR_INVALID_PACKET);
+   }
+   if (len < 5)
+   {
+      SendNAK(CMD_NO_CMD,CMD_NO_SUB,CMD_ERR_INVALID_LENGTH);
+      return(CMD_ERR_INVALID_LENGTH);
+   }
+   dev_nr = *((uint16_t *)(command));
+   // Check for correct device address
+   if (dev_nr != 0 && dev_nr != BOARD_GetOwnAddress())
+      return CMD_NO_COMMAND_AVAILABLE;
+   cmd = *(command + 4);
+   command += 5;
+   len -= 5;
+   retry = CMD_RETRY;
+   do
+   {
+      switch(cmd)
+      {
+			case CMD_DEVICE:
+				t_subcmd = *command;
+				ret = DeviceCommandHandler(dev_nr,command,len);
+				break;
+			case CMD_INFO:
+				t_subcmd = *command;
+				ret = InfoCommandHandler(dev_nr,command,len);
+				break;
+			case CMD_SYSTEM:
+				t_subcmd = *command;
+				ret = SystemCommandHandler(dev_nr,command,len);
+				break;
+			case CMD_MEASUREMENT:
+				t_subcmd = *command;
+				ret = MeasureCommandHandler(dev_nr,command,len);
+				break;
+         default:
+            t_cmd = CMD_NONE;
+            t_subcmd = CMD_NO_SUB;
+            ret = CMD_ERR_UNKNOWN_CMD;
+      }
+      if (ret != CMD_ERROR_MUTEX_SYNC)
+         break;
       else
-         if (packet_len < 3)
-            ret = -((int)E_INVALID_PACKET);
-         else
-         {
-            ret = packet_len - 2;
-            packet_crc = (uint16_t)(sbuf_0[ret]) + (((uint16_t)(sbuf_0[ret+1])) << 8);
-            memcpy(packet,(void const *)sbuf_0,ret<=len?ret:len);
-            CRC_Config(0x1021,0,0,0,0);
-            calc_crc = CRC_Cal_16(0,packet,ret,0);
-            if (calc_crc != packet_crc)
-               ret = -((int)E_CRC_ERROR);
-         }
-      packet_wait_proc_0 = 0;
-      packet_received_0 = 0;
-      return(ret);
+         vTaskDelay((TickType_t)CMD_RETRY_WAIT);
    }
-   else
-      return(0);
+   while(retry--);
+   if (ret != CMD_OK)
+      SendNAK(cmd,t_subcmd,ret);
+   return(ret);
 }
 
 /*!
  ******************************************************************************
- *	Command Handler for RS232 commands. Handles all commands and returns either
- * an error code if failed, CMD_NO_COMMAND_AVAILABLE if no command is pending
- * or CMD_OK if command was pending and has been successfully processed
+ *	Command Handler for RS232 and USB commands. Handles all received packets,
+ * taking the interfaces in turn, and returns either the error code of the last
+ * failed command, CMD_NO_COMMAND_AVAILABLE if no command is pending or CMD_OK
+ * if the commands have been successfully processed
  * \return     CMD_OK or CMD_NO_COMMAND_AVAILABLE if success, Errorcode else
  ******************************************************************************
 */
 int CommandHandler(void)
 {
-uint8_t              buf[RS232_BUFFER_LEN];
-static uint8_t       command_pending = 0;
-uint8_t              cmd;
-int                  len,ret,retry;
-uint16_t             dev_class,dev_nr;
-uint8_t              *command;
+CMD_PacketQueue_t    *queues[] = { &uart_packets,&usb_packets };
+CMD_Packet_t         *packet;
+int                  ret = CMD_NO_COMMAND_AVAILABLE,r;
+bool                 found;
 
-   len = GetPacketCmdIF(buf,sizeof(buf));
-   command = buf;
-   if (len == 0)
-   {
-      return(CMD_NO_COMMAND_AVAILABLE);
-   }
-   if (len < 0)
-   {
-      SendNAK(CMD_NO_CMD,CMD_NO_SUB,CMD_ERR_INVALID_PACKET);
-      return(CMD_ERR_INVALID_PACKET);
-   }
-   if (command_pending && command != NULL)
-      return(CMD_ERR_COMMAND_PENDING);
-   if (command != NULL)
+   if (!packets_ready)
+      return(ret);
+   do
    {
-      if (len < 5)
-      {
-         SendNAK(CMD_NO_CMD,CMD_NO_SUB,CMD_ERR_INVALID_LENGTH);
-         ret = CMD_ERR_INVALID_LENGTH;
-      }
-      dev_class = *((uint16_t *)command + 2);
-      dev_nr = *((uint16_t *)(command));
-      // Check for correct device address
-      if (dev_nr != 0 && dev_nr != BOARD_GetOwnAddress())
-         return CMD_NO_COMMAND_AVAILABLE;
-      cmd = *(command + 4);
-      command += 5;
-      len -= 5;
-      retry = CMD_RETRY;
-      do
+      found = false;
+      for (int i = 0;i < (int)(sizeof(queues) / sizeof(queues[0]));i++)
       {
-         switch(cmd)
-         {
-				case CMD_DEVICE:
-					t_subcmd = *command;
-					ret = DeviceCommandHandler(dev_nr,command,len);
-					break;
-				case CMD_INFO:
-					t_subcmd = *command;
-					ret = InfoCommandHandler(dev_nr,command,len);
-					break;
-				case CMD_SYSTEM:
-					t_subcmd = *command;
-					ret = SystemCommandHandler(dev_nr,command,len);
-					break;
-				case CMD_MEASUREMENT:
-					t_subcmd = *command;
-					ret = MeasureCommandHandler(dev_nr,command,len);
-					break;
-            default:
-               t_cmd = CMD_NONE;
-               t_subcmd = CMD_NO_SUB;
-               ret = CMD_ERR_UNKNOWN_CMD;
-         }
-         if (ret != CMD_ERROR_MUTEX_SYNC)
-            break;
-         else
-            vTaskDelay((TickType_t)CMD_RETRY_WAIT);
+         packet = CMD_PacketQueueFront(queues[i]);
+         if (packet == NULL)
+            continue;
+         found = true;
+         lastReceiveSource = (lrSource_t)queues[i]->source;     // the response goes back to the sender
+         r = DispatchPacket(packet);
+         CMD_PacketQueuePop(queues[i]);
+         if (r != CMD_NO_COMMAND_AVAILABLE && (ret == CMD_NO_COMMAND_AVAILABLE || ret == CMD_OK))
+            ret = r;
       }
-      while(retry--);
-      if (ret != CMD_OK)
-         SendNAK(cmd,t_subcmd,ret);
    }
+   while (found);
    return(ret);
 }
 
 /*!
  ******************************************************************************
- *	USB Low Level Command Handler
- * \param[in]     ch     	received character
+ *	USB command handler, called by the USB application task (APPTask) with the
+ * bytes of a bulk OUT transfer. Complete packets are queued for the
+ * communication task.
+ * \param[in]     buf		received bytes
+ * \param[in]     count		number of bytes
  ******************************************************************************
 */
 void UART_CmdIF_HandleUSB(uint8_t *buf,int count)
 {
-uint8_t                       ch;
-static int                    len = 0,packet_pending = 0,escape_seq = 0;
-BaseType_t                    xHigherPriorityTaskWoken = pdFALSE;
-
-	while (count--)
+	if (!packets_ready)
+		return;
+	if (CMD_PacketQueueReceive(&usb_packets,buf,count) > 0)
 	{
-		ch = *buf++;
-		if (ch == SOP)						// Start of Packet
-		{
-			if (packet_pending)			// premature SOP detected
-			{
-				rec_error = E_PREM_SOP;
-				packet_received_0 = 1;  // signal that a packet has been received
-			}
-			else
-				rec_error = 0;
-			len = 0;							// reset the buffer length
-			escape_seq = 0;				// reset escape sequencing
-			packet_pending = 1;		   // set the packet pending flag
-		}
-		else
-		{
-			if (ch == EOP)				// End of Packet
-			{
-				strcpy((void *)rcv_buf_0,(void *)sbuf_0);		// save the buffer
-				packet_len = len;
-				rec_error = E_NO_ERROR;
-				packet_wait_proc_0 = 1;								// wait for packet processing
-				packet_received_0 = 1;				            // signal that a packet has been received
-				packet_pending = 0;									// reset the packet pending flag
-			}
-			else
-				if (packet_pending)									// just receiving a packet
-				{
-					if (ch == ESC && !escape_seq)					// Escape sequence detected (byte stuffing)
-					{
-						escape_seq = 1;								// signal that
-					}
-					else
-						if (len < RS232_BUFFER_LEN)			   // if the buffer length has not exceeded
-						{
-							if (escape_seq)							// escape char
-							{
-								switch (ch)								// decode the byte stuffed char
-								{
-									case ESC_ESC:
-										ch	= ESC;
-										break;
-									case ESC_SOP:
-										ch	= SOP;
-										break;
-									case ESC_EOP:
-										ch	= EOP;
-										break;
-									default:
-										rec_error = E_ESCAPE_SEQ;	// wrong escape sequence
-										packet_received_0 = 1;	   // signal that a packet has been received
-										packet_pending = 0;
-								}
-								escape_seq = 0;
-							}
-							sbuf_0[len++] = ch;						// store the character in the packet buffer
-						}
-						else
-						{
-							rec_error = E_BUFFER_OVERFLOW;		// Buffer overflow occured
-							packet_received_0 = 1;				   // signal that a packet has been received
-							packet_pending = 0;
-						}
-				}
-	      }
-	   }
 	#ifdef TASK_EVENT_DRIVEN
-	if (packet_received_0)
-	{
 		if (TaskComm != NULL)
-		{
-	   	lastReceiveSource = lrSource_USB;
-			xTaskNotifyFromISR(TaskComm,(1 << 1),eSetBits,&xHigherPriorityTaskWoken);
-		}
-	}
-	portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+			xTaskNotify(TaskComm,(1 << 1),eSetBits);
 	#endif
+	}
 }
 
 /*!
  ******************************************************************************
- *	UART command handler interrupt routine
- * \param[in]     UART_desc     UART interface descriptor
+ *	UART command handler, called by the UART driver interrupts with the bytes
+ * received by DMA (idle line, half or full RX ring). Complete packets are
+ * queued for the communication task.
+ * \param[in]     buf		received bytes
+ * \param[in]     count		number of bytes
  ******************************************************************************
 */
-void UART_CmdIF_IRQHandler(UART_descriptor_t *UART_desc)
+void UART_CmdIF_HandleRx(const uint8_t *buf,int count)
 {
-uint8_t                       ch;
-int                           count;
-static int                    len = 0,state = 0;
 BaseType_t                    xHigherPriorityTaskWoken = pdFALSE;
-UART_Type                     *UART = UART_desc->IF_ptr;
 
-#if defined(FSL_FEATURE_UART_HAS_FIFO) && FSL_FEATURE_UART_HAS_FIFO
-   count = UART->RCFIFO;
-#else
-   count = 1;
-#endif
-   while (count--)
-   {
-      ch = UART->D;
-		switch (state)
-		{
-			case 0:	// waiting for SOP
-				if (ch == SOP)					// Start of Packet
-				{
-					len = 0;
-					state = 1;
-				}
-				break;
-			case 1:
-				if (ch == SOP)					// premature SOP, packet is dropped
-					len = 0;
-				else
-				{
-					if (ch == EOP)
-					{
-						lastReceiveSource = lrSource_UART;
-						strcpy((void *)rcv_buf_0,(void *)sbuf_0);		// save the buffer
-						packet_len = len;
-						rec_error = E_NO_ERROR;
-						packet_wait_proc_0 = 1;								// wait for packet processing
-						packet_received_0 = 1;				            // signal that a packet has been received
-						if (TaskComm != NULL)
-						{
-							xTaskNotifyFromISR(TaskComm,(1 << 0),eSetBits,&xHigherPriorityTaskWoken);
-							portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
-						}
-						state = 0;
-					}
-					else
-						if (ch == ESC)
-							state = 2;
-						else
-							if (len < RS232_BUFFER_LEN)			   	// if the buffer length has not exceeded
-								sbuf_0[len++] = ch;							// store the character in the packet buffer
-							else
-								state = 0;										// write budder overflow, packet is dropped
-				}
-				break;
-			case 2:
-				switch (ch)								// decode the byte stuffed char
-				{
-					case ESC_ESC:
-						ch	= ESC;
-						break;
-					case ESC_SOP:
-						ch	= SOP;
-						break;
-					case ESC_EOP:
-						ch	= EOP;
-						break;
-					default:
-						rec_error = E_ESCAPE_SEQ;	// wrong escape sequence
-						state = 0;						// packet is dropped
-				}
-				if (len < RS232_BUFFER_LEN)			   	// if the buffer length has not exceeded
-				{
-					sbuf_0[len++] = ch;							// store the character in the packet buffer
-					state = 1;										// go back to state 1
-				}
-				else
-					state = 0;										// write budder overflow, packet is dropped
-		}
+	if (!packets_ready)
+		return;
+	if (CMD_PacketQueueReceive(&uart_packets,buf,count) > 0)
+	{
+		if (TaskComm != NULL)
+			xTaskNotifyFromISR(TaskComm,(1 << 0),eSetBits,&xHigherPriorityTaskWoken);
 	}
+	portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
 }
@@ -21,6 +21,12 @@
 
 #define MUTEX_CmdHandler_WAIT       500                     //!< Wait time for Mutex Acquisition in Ticks
 
+typedef enum
+{
+	lrSource_UART = 0,
+	lrSource_USB = 1
+} lrSource_t;                                               //!< Interface of a command
+
 extern SemaphoreHandle_t   	xMutex_CmdHandler;
 extern SemaphoreHandle_t   	xSemaBin_CmdPollDevices;
 
@@ -32,9 +38,11 @@ int                 	InitCommandHandler(void);
 int                 	CommandHandler(void);
 void                	SendCommandType(uint8_t com_type);
 void                	commtask_systimer_isr_handler(void);
-void                	UART_CmdIF_IRQHandler(UART_descriptor_t *UART_desc);
+void                	UART_CmdIF_HandleRx(const uint8_t *buf,int count);
 void 			   		UART_CmdIF_HandleUSB(uint8_t *buf,int count);
 void 						SendPacketCMD(uint8_t *packet,int len);
+void 						SendPacketCMDSource(uint8_t source,uint8_t *packet,int len);
+uint8_t 					GetCommandSource(void);
 void 						SendNAK(uint8_t command,uint8_t subcommand,int16_t error_code);
 
 #if defined(__cplusplus)
@@ -12,7 +12,7 @@
 #include "CommandDefs.h"
 #include "CommandMeasure.h"
 #include "CommandHandler.h"
-#include "Board.h"
+#include "board.h"
 #include "System.h"
 #include "Misc.h"
 
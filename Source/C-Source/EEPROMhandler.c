@@ -10,6 +10,9 @@
 #include "board.h"
 #include "crc.h"
 #include "Misc.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
 
 bool EEPROM_FillVersionStruct(EEPROM_UVersionEntry_t *result,uint8_t *data,int size)
 {
@@ -18,8 +21,7 @@ uint16_t		crc;
 	if (size != sizeof(EEPROM_VersionEntry_t))
 		return false;
 	memcpy(result->ByteVect,data,size);
-	CRC_Config(0x1021, 0, 0, 0, 0);
-	crc = CRC_Cal_16(0, result->ByteVect, size - 2, 0);
+	crc = CRC_Calc16(0, result->ByteVect, size - 2);
 	result->Entry.crc = crc;
 	return true;
 }
@@ -31,8 +33,7 @@ uint16_t		crc;
 	if (size != sizeof(EEPROM_ParamEntry_t))
 		return false;
 	memcpy(result->ByteVect,data,size);
-	CRC_Config(0x1021, 0, 0, 0, 0);
-	crc = CRC_Cal_16(0, result->ByteVect, size - 2, 0);
+	crc = CRC_Calc16(0, result->ByteVect, size - 2);
 	result->Entry.crc = crc;
 	return true;
 }
@@ -52,8 +53,7 @@ uint16_t		crc;
 	result->Entry.Minor = Minor;
 	result->Entry.Build = Build;
 	result->Entry.Reserved = 0;
-	CRC_Config(0x1021, 0, 0, 0, 0);
-	crc = CRC_Cal_16(0, result->ByteVect, sizeof(EEPROM_VersionEntry_t) - 2, 0);
+	crc = CRC_Calc16(0, result->ByteVect, sizeof(EEPROM_VersionEntry_t) - 2);
 	result->Entry.crc = crc;
 	return true;
 }
@@ -69,8 +69,7 @@ uint16_t		crc;
 	result->Entry.ID = ID;
 	result->Entry.Type = Type;
 	result->Entry.Value = Value;
-	CRC_Config(0x1021, 0, 0, 0, 0);
-	crc = CRC_Cal_16(0, result->ByteVect, sizeof(EEPROM_VersionEntry_t) - 2, 0);
+	crc = CRC_Calc16(0, result->ByteVect, sizeof(EEPROM_VersionEntry_t) - 2);
 	result->Entry.crc = crc;
 	return true;
 }
@@ -80,8 +79,7 @@ bool EEPROM_GetVersionStruct(EEPROM_UVersionEntry_t *data,uint8_t *Major,uint8_t
 {
 uint16_t		crc;
 
-	CRC_Config(0x1021, 0, 0, 0, 0);
-	crc = CRC_Cal_16(0, data->ByteVect, sizeof(EEPROM_VersionEntry_t) - 2, 0);
+	crc = CRC_Calc16(0, data->ByteVect, sizeof(EEPROM_VersionEntry_t) - 2);
 	if (crc != data->Entry.crc)
 		return false;
 	strcpy(Serial,data->Entry.Serial);
@@ -97,8 +95,7 @@ bool EEPROM_GetParameterStruct(EEPROM_UParamEntry_t *data,uint16_t *ID,uint32_t
 {
 uint16_t		crc;
 
-	CRC_Config(0x1021, 0, 0, 0, 0);
-	crc = CRC_Cal_16(0, data->ByteVect, sizeof(EEPROM_VersionEntry_t) - 2, 0);
+	crc = CRC_Calc16(0, data->ByteVect, sizeof(EEPROM_VersionEntry_t) - 2);
 	if (crc != data->Entry.crc)
 		return false;
 	strcpy(Name,data->Entry.Name);
@@ -176,76 +173,184 @@ uint32_t		MagicWord;
 		return false;
 }
 
-bool EEPROM_WriteParamStructCount(uint32_t count)
+/*!
+ ******************************************************************************
+ *	EEPROM access of the parameter journal
+ ******************************************************************************
+*/
+static bool EEPROM_JournalRead(void *ctx,uint32_t address,uint8_t *data,uint32_t len)
 {
-	return EEPROM_WriteBlock(EERPROM_I2C_ADDRESS,EEPROM_PARAM_COUNT_ADDR,
-		(uint8_t *)(&count),sizeof(count));
+	return EEPROM_ReadBlock(EERPROM_I2C_ADDRESS,(uint16_t)address,data,len);
+}
+
+static bool EEPROM_JournalWrite(void *ctx,uint32_t address,const uint8_t *data,uint32_t len)
+{
+	return EEPROM_WriteBlock(EERPROM_I2C_ADDRESS,(uint16_t)address,(uint8_t *)data,len);
+}
+
+static EEJ_Journal_t		param_journal;
+static SemaphoreHandle_t	param_mutex;
+
+/*!
+ ******************************************************************************
+ *	Creates the mutex of the parameter journal, called before the tasks are
+ * started: the init task and the communication task both use the journal
+ * \return     true if success
+ ******************************************************************************
+*/
+bool EEPROM_InitParamJournal(void)
+{
+	if (param_mutex == NULL)
+		param_mutex = xSemaphoreCreateMutex();
+	return param_mutex != NULL;
+}
+
+/*!
+ ******************************************************************************
+ *	Locks the parameter journal, there is only one thread before the scheduler
+ * is running
+ * \return     false if another task holds it too long
+ ******************************************************************************
+*/
+static bool EEPROM_JournalLock(void)
+{
+	if (xTaskGetSchedulerState() != taskSCHEDULER_RUNNING || param_mutex == NULL)
+		return true;
+	return xSemaphoreTake(param_mutex,EEPROM_JOURNAL_WAIT_MS / portTICK_PERIOD_MS) == pdTRUE;
+}
+
+static void EEPROM_JournalUnlock(void)
+{
+	if (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING && param_mutex != NULL)
+		xSemaphoreGive(param_mutex);
+}
+
+/*!
+ ******************************************************************************
+ *	Writes the layout word
+ ******************************************************************************
+*/
+static bool EEPROM_WriteLayout(void)
+{
+uint32_t		layout = EEPROM_LAYOUT;
+
+	return EEPROM_WriteBlock(EERPROM_I2C_ADDRESS,EEPROM_LAYOUT_ADDR,(uint8_t *)&layout,sizeof(layout));
+}
+
+/*!
+ ******************************************************************************
+ *	Gets the parameter journal, it is loaded into the RAM index on first use.
+ * An EEPROM of another layout is formatted, see EEPROMhandler.h. The journal
+ * has to be locked.
+ * \return     journal, NULL if the EEPROM cannot be read
+ ******************************************************************************
+*/
+static EEJ_Journal_t *EEPROM_Journal(void)
+{
+const EEJ_Port_t		port = { EEPROM_JournalRead,EEPROM_JournalWrite,NULL };
+uint32_t					layout;
+
+	if (param_journal.loaded)
+		return &param_journal;
+	if (!EEJ_Init(&param_journal,&port,EEPROM_PARAM_START_ADDR,EEPROM_JOURNAL_SLOT_SIZE,EEPROM_JOURNAL_SLOTS))
+		return NULL;
+	if (!EEPROM_ReadBlock(EERPROM_I2C_ADDRESS,EEPROM_LAYOUT_ADDR,(uint8_t *)&layout,sizeof(layout)))
+		return NULL;
+	if (layout != EEPROM_LAYOUT)
+	{
+		// the layout word last: an interrupted format is repeated
+		if (!EEJ_Format(&param_journal) || !EEPROM_WriteLayout())
+		{
+			param_journal.loaded = false;
+			return NULL;
+		}
+		return &param_journal;
+	}
+	if (!EEJ_Load(&param_journal))
+		return NULL;
+	return &param_journal;
 }
 
 int EEPROM_ReadParamStructCount(void)
 {
-uint32_t count;
-	
-	if (EEPROM_ReadBlock(EERPROM_I2C_ADDRESS,EEPROM_PARAM_COUNT_ADDR,
-		(uint8_t *)(&count),sizeof(count)))
-		return count;
-	else
+EEJ_Journal_t	*j;
+int				count = -1;
+
+	if (!EEPROM_JournalLock())
 		return -1;
+	if ((j = EEPROM_Journal()) != NULL)
+		count = (int)EEJ_Count(j);
+	EEPROM_JournalUnlock();
+	return count;
 }
 
 bool EEPROM_ClearParamStructCount(void)
 {
-	return EEPROM_WriteParamStructCount(0);
+EEJ_Journal_t	*j;
+bool				result;
+
+	if (!EEPROM_JournalLock())
+		return false;
+	j = EEPROM_Journal();
+	result = j != NULL && EEJ_Clear(j);
+	EEPROM_JournalUnlock();
+	return result;
 }
 
 int EEPROM_WriteNextParamStruct(EEPROM_UParamEntry_t * ParamStruct)
 {
-	int count = EEPROM_ReadParamStructCount();
-	if (count == -1)
-		return -1;
-	uint16_t address = EEPROM_PARAM_START_ADDR + count
-		* sizeof(ParamStruct);
-	if (!EEPROM_WriteParamStruct(address,ParamStruct))
-		return -1;
-	count++;
-	if (!EEPROM_WriteParamStructCount(count))
+EEJ_Journal_t	*j;
+int				count = -1;
+
+	if (!EEPROM_JournalLock())
 		return -1;
+	if ((j = EEPROM_Journal()) != NULL && EEJ_Write(j,EEJ_Count(j),ParamStruct->ByteVect))
+		count = (int)EEJ_Count(j);
+	EEPROM_JournalUnlock();
 	return count;
 }
 
 bool EEPROM_ReadParamStructAtPos(uint32_t position,EEPROM_UParamEntry_t * ParamStruct)
 {
-	int count = EEPROM_ReadParamStructCount();
-	if (count == -1)
-		return false;
-	if (position > count)
+EEJ_Journal_t	*j;
+bool				result;
+
+	if (!EEPROM_JournalLock())
 		return false;
-	uint16_t address = EEPROM_PARAM_START_ADDR + position
-		* sizeof(ParamStruct);
-	return EEPROM_ReadParamStruct(address,ParamStruct);
+	j = EEPROM_Journal();
+	result = j != NULL && EEJ_Read(j,position,ParamStruct->ByteVect);
+	EEPROM_JournalUnlock();
+	return result;
 }
 
 bool EEPROM_WriteParamStructAtPos(uint32_t position,EEPROM_UParamEntry_t * ParamStruct)
 {
-	int count = EEPROM_ReadParamStructCount();
-	if (count == -1)
-		return false;
-	if (position > count + 1)
-		return false;
-	uint16_t address = EEPROM_PARAM_START_ADDR + position
-		* sizeof(ParamStruct);
-	if (!EEPROM_WriteParamStruct(address,ParamStruct))
+EEJ_Journal_t	*j;
+bool				result;
+
+	if (!EEPROM_JournalLock())
 		return false;
-	if (position > count)
-		return EEPROM_WriteParamStructCount(position);
-	return true;
+	j = EEPROM_Journal();
+	result = j != NULL && EEJ_Write(j,position,ParamStruct->ByteVect);
+	EEPROM_JournalUnlock();
+	return result;
 }
 
 bool EEPROM_InitializeEEPROM(void)
 {
+const EEJ_Port_t		port = { EEPROM_JournalRead,EEPROM_JournalWrite,NULL };
+bool						result;
+
 	if (!EEPROM_WriteMagicWord())
 		return false;
 	if (!EEPROM_CheckMagicWord())
 		return false;
-	return EEPROM_WriteParamStructCount(0);
+	if (!EEPROM_JournalLock())
+		return false;
+	result = EEJ_Init(&param_journal,&port,EEPROM_PARAM_START_ADDR,EEPROM_JOURNAL_SLOT_SIZE,EEPROM_JOURNAL_SLOTS) &&
+		EEJ_Format(&param_journal) && EEPROM_WriteLayout();
+	if (!result)
+		param_journal.loaded = false;
+	EEPROM_JournalUnlock();
+	return result;
 }
@@ -10,13 +10,32 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "EEPROMjournal.h"
 
 #define	EEPROM_MAGIC_WORD					0xA54179F4
 #define	EEPROM_MAGIC_WORD_ADDR			0x0000
 
 #define	EEPROM_VERSION_STR_ADDR			0x0004
-#define	EEPROM_PARAM_COUNT_ADDR			(EEPROM_VERSION_STR_ADDR + sizeof(EEPROM_VersionEntry_t))
-#define	EEPROM_PARAM_START_ADDR			0x0100
+#define	EEPROM_LAYOUT_ADDR				0x0024		//!< Layout word, the parameter count of the former layout
+#define	EEPROM_LAYOUT						0x4C590002	//!< 'LY', layout 2: parameter journal
+#define	EEPROM_PARAM_START_ADDR			0x0100		//!< Journal of the parameter structures
+#define	EEPROM_JOURNAL_SLOT_SIZE		64				//!< Record slot, a page holds whole slots
+#define	EEPROM_JOURNAL_SLOTS				256			//!< 16 KiB ring
+#define	EEPROM_PARAM_MAX_COUNT			EEJ_MAX_POSITIONS
+#define	EEPROM_JOURNAL_WAIT_MS			2000			//!< Max wait for the journal of another task
+
+/*!
+ ******************************************************************************
+ *	Layout 1 stored a count at EEPROM_LAYOUT_ADDR and the parameter structures
+ *	from EEPROM_PARAM_START_ADDR on, 4 bytes apart: each structure overwrote
+ *	most of the previous one, only the last one written was intact. The
+ *	structures cannot be migrated. If the layout word is not EEPROM_LAYOUT when
+ *	the journal is loaded, the journal is formatted (all parameters are
+ *	cleared) and the layout word is written; the version structure and the
+ *	magic word are kept. A power cut before the layout word is written repeats
+ *	the reset on the next load.
+ ******************************************************************************
+*/
 
 #pragma push
 #pragma pack(1)
@@ -77,7 +96,7 @@ bool EEPROM_ReadParamStruct(uint16_t address,EEPROM_UParamEntry_t * ParamStruct)
 bool EEPROM_WriteMagicWord(void);
 uint32_t EEPROM_ReadMagicWord(void);
 bool EEPROM_CheckMagicWord(void);
-bool EEPROM_WriteParamStructCount(uint32_t count);
+bool EEPROM_InitParamJournal(void);
 int EEPROM_ReadParamStructCount(void);
 bool EEPROM_ClearParamStructCount(void);
 int EEPROM_WriteNextParamStruct(EEPROM_UParamEntry_t * ParamStruct);
@@ -0,0 +1,316 @@
+/*
+ * EEPROMjournal.c
+ *
+ *  Circular journal of the parameter structures in the EEPROM
+ */
+
+#include <string.h>
+#include <stddef.h>
+#include "EEPROMjournal.h"
+#include "crc16.h"
+
+#define EEJ_ERASE_CHUNK				256			///< Bytes written at once by EEJ_Format
+
+static const uint8_t		eej_zero[EEJ_ERASE_CHUNK];
+
+/*!
+ ******************************************************************************
+ *	Address of a slot
+ ******************************************************************************
+*/
+static inline uint32_t EEJ_Address(const EEJ_Journal_t *j,unsigned slot)
+{
+	return j->base + (uint32_t)slot * j->slot_size;
+}
+
+/*!
+ ******************************************************************************
+ *	Slot following a slot
+ ******************************************************************************
+*/
+static inline unsigned EEJ_Next(const EEJ_Journal_t *j,unsigned slot)
+{
+	return slot + 1 < j->slots ? slot + 1 : 0;
+}
+
+/*!
+ ******************************************************************************
+ *	Number of slots from the tail to the head
+ ******************************************************************************
+*/
+static inline unsigned EEJ_Window(const EEJ_Journal_t *j)
+{
+	if (j->seq == 0)
+		return 0;
+	return (j->head + j->slots - j->tail) % j->slots + 1;
+}
+
+/*!
+ ******************************************************************************
+ *	CRC of a record
+ ******************************************************************************
+*/
+static uint16_t EEJ_RecordCRC(const EEJ_Record_t *rec)
+{
+	return CRC16_Update(EEJ_CRC_SEED,rec,offsetof(EEJ_Record_t,crc));
+}
+
+/*!
+ ******************************************************************************
+ *	Reads the record of a slot
+ *	\param[out]	rec			record
+ *	\param[out]	valid			true if the record is intact and consistent
+ * \return     false if the EEPROM cannot be read
+ ******************************************************************************
+*/
+static bool EEJ_ReadRecord(EEJ_Journal_t *j,unsigned slot,EEJ_Record_t *rec,bool *valid)
+{
+	if (!j->port.read(j->port.ctx,EEJ_Address(j,slot),(uint8_t *)rec,sizeof(*rec)))
+		return false;
+	j->reads++;
+	*valid = rec->seq != 0 && rec->seq_end == rec->seq && rec->crc == EEJ_RecordCRC(rec) && rec->tail < j->slots &&
+		rec->count <= EEJ_MAX_POSITIONS && (rec->pos < rec->count || rec->pos == EEJ_POS_CLEAR);
+	return true;
+}
+
+/*!
+ ******************************************************************************
+ *	Writes a record to the slot following the head and makes it the head
+ *	\param[in]	pos			position or EEJ_POS_CLEAR
+ *	\param[in]	count			number of positions with this record
+ *	\param[in]	tail			oldest slot needed with this record as head
+ * \return     true if success
+ ******************************************************************************
+*/
+static bool EEJ_Append(EEJ_Journal_t *j,uint8_t pos,uint8_t count,unsigned tail,const uint8_t *data)
+{
+EEJ_Record_t	rec;
+unsigned			slot = j->seq == 0 ? 0 : EEJ_Next(j,j->head);
+
+	if (j->seq != 0 && slot == j->tail)
+		return false;								// the ring is full, never with the window limit
+	memset(&rec,0,sizeof(rec));
+	rec.seq = j->seq + 1;
+	rec.pos = pos;
+	rec.count = count;
+	rec.tail = (uint16_t)(pos == EEJ_POS_CLEAR ? slot : tail);
+	if (data != NULL)
+		memcpy(rec.data,data,EEJ_DATA_SIZE);
+	rec.crc = EEJ_RecordCRC(&rec);
+	rec.seq_end = rec.seq;
+	if (!j->port.write(j->port.ctx,EEJ_Address(j,slot),(const uint8_t *)&rec,sizeof(rec)))
+		return false;								// the slot is free, it is written again next time
+	j->writes++;
+	j->head = (uint16_t)slot;
+	j->tail = rec.tail;
+	j->seq = rec.seq;
+	j->count = count;
+	if (pos != EEJ_POS_CLEAR)
+	{
+		j->slot[pos] = (uint16_t)slot;
+		memcpy(j->data[pos],rec.data,EEJ_DATA_SIZE);
+	}
+	return true;
+}
+
+/*!
+ ******************************************************************************
+ *	Keeps the window below its limit: the tail moves over the superseded
+ * records, a live record at the tail is copied to the head first
+ * \return     true if success
+ ******************************************************************************
+*/
+static bool EEJ_Compact(EEJ_Journal_t *j)
+{
+unsigned		pos,tail;
+
+	while (EEJ_Window(j) > 2U * j->count + EEJ_SPARE)
+	{
+		tail = EEJ_Next(j,j->tail);
+		for (pos = 0;pos < j->count;pos++)
+			if (j->slot[pos] == j->tail)
+				break;
+		if (pos < j->count)
+		{
+			if (!EEJ_Append(j,(uint8_t)pos,j->count,tail,j->data[pos]))
+				return false;
+		}
+		else
+			j->tail = (uint16_t)tail;
+	}
+	return true;
+}
+
+/*!
+ ******************************************************************************
+ *	Initializes a journal, EEJ_Load has to be called before it is used
+ *	\param[in]	port			access to the EEPROM
+ *	\param[in]	base			address of the first slot
+ *	\param[in]	slot_size	distance of the slots
+ *	\param[in]	slots			number of slots
+ * \return     false if the ring is too small
+ ******************************************************************************
+*/
+bool EEJ_Init(EEJ_Journal_t *j,const EEJ_Port_t *port,uint32_t base,uint16_t slot_size,uint16_t slots)
+{
+	memset(j,0,sizeof(*j));
+	j->port = *port;
+	j->base = base;
+	j->slot_size = slot_size;
+	j->slots = slots;
+	return slot_size >= sizeof(EEJ_Record_t) && slots > 2 * EEJ_MAX_POSITIONS + EEJ_SPARE;
+}
+
+/*!
+ ******************************************************************************
+ *	Loads the journal: finds the head by a binary search over the sequence
+ * numbers (the ring holds increasing numbers up to the head, then older or
+ * free slots) and replays the window into the RAM index
+ * \return     false if the EEPROM cannot be read
+ ******************************************************************************
+*/
+bool EEJ_Load(EEJ_Journal_t *j)
+{
+EEJ_Record_t	rec;
+bool				valid;
+unsigned			first,lo,hi,mid,slot,n;
+uint32_t			first_seq,seq;
+
+	j->loaded = false;
+	j->seq = 0;
+	j->count = 0;
+	j->head = j->tail = 0;
+	// slot 0 can only be torn if the head is the last slot
+	for (first = 0;first < 2;first++)
+	{
+		if (!EEJ_ReadRecord(j,first,&rec,&valid))
+			return false;
+		if (valid)
+			break;
+	}
+	if (first == 2)
+	{
+		j->loaded = true;							// empty
+		return true;
+	}
+	first_seq = rec.seq;
+	lo = first;
+	hi = j->slots - 1;
+	while (lo < hi)								// last slot with a sequence number >= first_seq
+	{
+		mid = (lo + hi + 1) / 2;
+		if (!EEJ_ReadRecord(j,mid,&rec,&valid))
+			return false;
+		if (valid && rec.seq >= first_seq)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+	if (!EEJ_ReadRecord(j,lo,&rec,&valid))
+		return false;
+	if (!valid)
+		return false;
+	j->head = (uint16_t)lo;
+	j->tail = rec.tail;
+	j->seq = rec.seq;
+	n = EEJ_Window(j);
+	seq = rec.seq - (n - 1);
+	for (slot = j->tail;n > 0;n--,seq++,slot = EEJ_Next(j,slot))
+	{
+		if (!EEJ_ReadRecord(j,slot,&rec,&valid))
+			return false;
+		if (!valid || rec.seq != seq)
+			continue;								// damaged, the previous record of the position stays
+		if (rec.pos == EEJ_POS_CLEAR)
+		{
+			j->count = 0;
+			continue;
+		}
+		for (unsigned pos = j->count;pos < rec.count;pos++)
+		{
+			j->slot[pos] = 0xFFFF;					// record damaged, no data
+			memset(j->data[pos],0,EEJ_DATA_SIZE);
+		}
+		j->count = rec.count;
+		j->slot[rec.pos] = (uint16_t)slot;
+		memcpy(j->data[rec.pos],rec.data,EEJ_DATA_SIZE);
+	}
+	j->loaded = true;
+	return true;
+}
+
+/*!
+ ******************************************************************************
+ *	Erases all slots and clears the journal. The slots are erased from the end,
+ * if it is interrupted the remaining records are still a consistent journal.
+ * \return     true if success
+ ******************************************************************************
+*/
+bool EEJ_Format(EEJ_Journal_t *j)
+{
+uint32_t		address = EEJ_Address(j,j->slots),len;
+
+	j->loaded = false;
+	for (;address > j->base;address -= len)
+	{
+		len = address - j->base < EEJ_ERASE_CHUNK ? address - j->base : EEJ_ERASE_CHUNK;
+		if (!j->port.write(j->port.ctx,address - len,eej_zero,len))
+			return false;
+	}
+	j->seq = 0;
+	j->count = 0;
+	j->head = j->tail = 0;
+	j->loaded = true;
+	return true;
+}
+
+/*!
+ ******************************************************************************
+ *	Clears all positions
+ * \return     true if success
+ ******************************************************************************
+*/
+bool EEJ_Clear(EEJ_Journal_t *j)
+{
+	if (!j->loaded)
+		return false;
+	if (j->seq == 0)
+		return true;
+	return EEJ_Append(j,EEJ_POS_CLEAR,0,0,NULL);
+}
+
+/*!
+ ******************************************************************************
+ *	Writes the data of a position
+ *	\param[in]	pos			position, count to add one
+ *	\param[in]	data			EEJ_DATA_SIZE bytes
+ * \return     true if success
+ ******************************************************************************
+*/
+bool EEJ_Write(EEJ_Journal_t *j,unsigned pos,const uint8_t *data)
+{
+unsigned		count;
+
+	if (!j->loaded || pos > j->count || pos >= EEJ_MAX_POSITIONS)
+		return false;
+	count = pos == j->count ? j->count + 1 : j->count;
+	if (!EEJ_Append(j,(uint8_t)pos,(uint8_t)count,j->tail,data))
+		return false;
+	return EEJ_Compact(j);
+}
+
+/*!
+ ******************************************************************************
+ *	Reads the data of a position from the RAM index
+ *	\param[in]	pos			position
+ *	\param[out]	data			EEJ_DATA_SIZE bytes
+ * \return     false if the position is not stored
+ ******************************************************************************
+*/
+bool EEJ_Read(const EEJ_Journal_t *j,unsigned pos,uint8_t *data)
+{
+	if (!j->loaded || pos >= j->count)
+		return false;
+	memcpy(data,j->data[pos],EEJ_DATA_SIZE);
+	return true;
+}
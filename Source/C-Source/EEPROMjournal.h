@@ -0,0 +1,99 @@
+/*
+ * EEPROMjournal.h
+ *
+ *  Circular journal of the parameter structures in the EEPROM
+ */
+
+#ifndef EEPROMJOURNAL_H_
+#define EEPROMJOURNAL_H_
+
+/*!
+ ******************************************************************************
+ *	The parameters are stored by position (0 .. count - 1). Each update is
+ *	appended as a record to a ring of slots: sequence number, position, number
+ *	of positions, oldest slot still needed (tail), data, CRC and the sequence
+ *	number again. No location is rewritten in place, so the writes are spread
+ *	over the whole ring.
+ *	The records between the tail and the newest one (head) are the window;
+ *	it is kept below 2 * count + EEJ_SPARE slots by copying the live record at
+ *	the tail to the head. Only free slots are written, a power cut tears at
+ *	most the slot being written, which fails its CRC or the sequence check.
+ *	EEJ_Load finds the head by a binary search over the sequence numbers and
+ *	replays the window into a RAM index, the reads do not touch the EEPROM.
+ *	The EEPROM is reached through a port, this file has no hardware dependency.
+ ******************************************************************************
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define EEJ_DATA_SIZE				32				///< Size of a parameter structure
+#define EEJ_MAX_POSITIONS			64				///< Max number of parameter positions
+#define EEJ_SPARE						2				///< Slots of the window beyond 2 * count
+#define EEJ_POS_CLEAR				0xFF			///< Position of the record clearing all positions
+#define EEJ_CRC_SEED					0x4A52		///< Seed of the record CRC, other data fails the check
+
+#pragma push
+#pragma pack(1)
+
+typedef struct
+{
+	uint32_t		seq;							// sequence number, 0 if the slot is free
+	uint8_t		pos;							// position or EEJ_POS_CLEAR
+	uint8_t		count;						// number of positions including this record
+	uint16_t		tail;							// oldest slot needed with this record as head
+	uint8_t		data[EEJ_DATA_SIZE];
+	uint16_t		crc;							// CRC16 over the fields above
+	uint32_t		seq_end;						// seq again, sent last: a torn write does not match
+} EEJ_Record_t;
+
+#pragma pop
+
+typedef struct {
+	bool		(*read)(void *ctx,uint32_t address,uint8_t *data,uint32_t len);
+	bool		(*write)(void *ctx,uint32_t address,const uint8_t *data,uint32_t len);
+	void		*ctx;
+} EEJ_Port_t;
+
+typedef struct {
+	EEJ_Port_t		port;
+	uint32_t			base;							// address of slot 0
+	uint16_t			slot_size;					// distance of the slots, >= sizeof(EEJ_Record_t)
+	uint16_t			slots;
+	bool				loaded;
+	uint16_t			head;							// slot of the newest record
+	uint16_t			tail;							// oldest slot of the window
+	uint32_t			seq;							// sequence number of the head, 0 if empty
+	uint8_t			count;						// number of positions
+	uint16_t			slot[EEJ_MAX_POSITIONS];	// slot of the live record of each position
+	uint8_t			data[EEJ_MAX_POSITIONS][EEJ_DATA_SIZE];
+	uint32_t			writes;						// records written, including the copies
+	uint32_t			reads;						// records read by EEJ_Load
+} EEJ_Journal_t;
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* __cplusplus */
+
+bool EEJ_Init(EEJ_Journal_t *j,const EEJ_Port_t *port,uint32_t base,uint16_t slot_size,uint16_t slots);
+bool EEJ_Load(EEJ_Journal_t *j);
+bool EEJ_Format(EEJ_Journal_t *j);
+bool EEJ_Clear(EEJ_Journal_t *j);
+bool EEJ_Write(EEJ_Journal_t *j,unsigned pos,const uint8_t *data);
+bool EEJ_Read(const EEJ_Journal_t *j,unsigned pos,uint8_t *data);
+
+/*!
+ ******************************************************************************
+ *	Gets the number of positions
+ ******************************************************************************
+*/
+static inline unsigned EEJ_Count(const EEJ_Journal_t *j)
+{
+	return j->count;
+}
+
+#if defined(__cplusplus)
+}
+#endif /* __cplusplus */
+
+#endif /* EEPROMJOURNAL_H_ */
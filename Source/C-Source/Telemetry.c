@@ -0,0 +1,225 @@
+/*
+ * Telemetry.c
+ *
+ *  Streaming of signals over the command interface
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include "Telemetry.h"
+
+/*!
+ ******************************************************************************
+ *	Initializes a stream, no signal is subscribed
+ *	\param[out]	stream			stream
+ *	\param[in]	catalogue		signals which can be subscribed
+ *	\param[in]	catalogue_len	number of signals of the catalogue
+ ******************************************************************************
+*/
+void TLM_Init(TLM_Stream_t *stream,const TLM_SignalDef_t *catalogue,int catalogue_len)
+{
+	memset(stream,0,sizeof(*stream));
+	stream->catalogue = catalogue;
+	stream->catalogue_len = catalogue_len;
+}
+
+/*!
+ ******************************************************************************
+ *	Looks a signal up in the catalogue
+ * \return     signal, NULL if unknown
+ ******************************************************************************
+*/
+static const TLM_SignalDef_t * TLM_FindSignal(const TLM_Stream_t *stream,uint8_t id)
+{
+	for (int i = 0;i < stream->catalogue_len;i++)
+		if (stream->catalogue[i].id == id)
+			return &stream->catalogue[i];
+	return NULL;
+}
+
+/*!
+ ******************************************************************************
+ *	Replaces the subscription, the first frame is sampled at once
+ *	\param[in]	stream		stream
+ *	\param[in]	data			<period 16 (ms)><n><n * (signal,index,decimation)>,
+ *								n = 0 stops the stream
+ *	\param[in]	len			length of data
+ *	\param[in]	source		interface of the subscriber
+ *	\param[in]	now			current tick
+ *	\param[in]	tick_rate	ticks per second
+ * \return     0 if success, TLM_ERR_xxx else (the subscription is unchanged)
+ ******************************************************************************
+*/
+int TLM_Subscribe(TLM_Stream_t *stream,const uint8_t *data,int len,uint8_t source,uint32_t now,uint32_t tick_rate)
+{
+TLM_Entry_t				entry[TLM_MAX_SIGNALS];
+uint32_t					period;
+int						n,frame_len;
+
+	if (len < 3)
+		return TLM_ERR_LENGTH;
+	period = (uint32_t)(((uint64_t)(data[0] | ((uint32_t)data[1] << 8)) * tick_rate) / 1000);	// ms to ticks
+	n = data[2];
+	if (len < 3 + 3 * n)
+		return TLM_ERR_LENGTH;
+	if (n == 0)
+	{
+		TLM_Stop(stream);
+		return 0;
+	}
+	if (n > TLM_MAX_SIGNALS || period == 0)
+		return TLM_ERR_PARAMETER;
+	frame_len = TLM_HEADER_LEN + 6;
+	data += 3;
+	for (int i = 0;i < n;i++,data += 3)
+	{
+		entry[i].def = TLM_FindSignal(stream,data[0]);
+		if (entry[i].def == NULL)
+			return TLM_ERR_SIGNAL;
+		entry[i].index = data[1];
+		entry[i].decimation = data[2];
+		entry[i].phase = 0;
+		if (entry[i].decimation == 0)
+			return TLM_ERR_PARAMETER;
+		frame_len += entry[i].def->size;
+	}
+	if (frame_len > TLM_MAX_FRAME_LEN)
+		return TLM_ERR_PARAMETER;
+	memcpy(stream->entry,entry,n * sizeof(entry[0]));
+	stream->n = n;
+	stream->period = period;
+	stream->next = now;
+	stream->seq = 0;
+	stream->source = source;
+	stream->frames = 0;
+	stream->skipped = 0;
+	stream->failed = 0;
+	stream->active = true;
+	return 0;
+}
+
+/*!
+ ******************************************************************************
+ *	Stops the stream
+ ******************************************************************************
+*/
+void TLM_Stop(TLM_Stream_t *stream)
+{
+	stream->active = false;
+	stream->n = 0;
+}
+
+/*!
+ ******************************************************************************
+ *	Gets the time until the next frame is due
+ *	\param[in]	stream		stream
+ *	\param[in]	now			current tick
+ * \return     ticks, 0 if due, UINT32_MAX if the stream is stopped
+ ******************************************************************************
+*/
+uint32_t TLM_TimeToNext(const TLM_Stream_t *stream,uint32_t now)
+{
+int32_t		d;
+
+	if (!stream->active)
+		return UINT32_MAX;
+	d = (int32_t)(stream->next - now);
+	return d > 0 ? (uint32_t)d : 0;
+}
+
+/*!
+ ******************************************************************************
+ *	Samples the signals into a frame if it is due
+ *	\param[in]	stream		stream
+ *	\param[in]	now			current tick
+ *	\param[out]	frame			frame, the values are written after the command
+ *								header (TLM_HEADER_LEN bytes left to the caller)
+ *	\param[in]	max			size of frame
+ * \return     frame length, 0 if no frame is due
+ ******************************************************************************
+*/
+int TLM_Sample(TLM_Stream_t *stream,uint32_t now,uint8_t *frame,int max)
+{
+const TLM_Entry_t		*e;
+uint32_t					late;
+int						n;
+
+	if (!stream->active || (int32_t)(now - stream->next) < 0)
+		return 0;
+	late = (now - stream->next) / stream->period;
+	if (late != 0)									// the periods missed are skipped
+	{
+		stream->skipped += late;
+		stream->seq += (uint16_t)late;
+		stream->next += late * stream->period;
+		for (int i = 0;i < stream->n;i++)
+		{
+			e = &stream->entry[i];
+			stream->entry[i].phase = (uint8_t)((e->phase + late % e->decimation) % e->decimation);
+		}
+	}
+	if (max < TLM_FrameLen(stream))
+		return 0;
+	n = TLM_HEADER_LEN;
+	frame[n++] = (uint8_t)stream->seq;
+	frame[n++] = (uint8_t)(stream->seq >> 8);
+	for (int i = 0;i < 4;i++)
+		frame[n++] = (uint8_t)(now >> (8 * i));
+	for (int i = 0;i < stream->n;i++)
+	{
+		e = &stream->entry[i];
+		if (e->phase == 0)
+		{
+			if (!e->def->read(e->index,frame + n))
+			{
+				memset(frame + n,0,e->def->size);
+				stream->failed++;
+			}
+			n += e->def->size;
+		}
+		stream->entry[i].phase = (uint8_t)((e->phase + 1) % e->decimation);
+	}
+	stream->seq++;
+	stream->next += stream->period;
+	stream->frames++;
+	return n;
+}
+
+/*!
+ ******************************************************************************
+ *	Gets the length of the next frame (command header included)
+ *	\param[in]	stream		stream
+ ******************************************************************************
+*/
+int TLM_FrameLen(const TLM_Stream_t *stream)
+{
+int		n = TLM_HEADER_LEN + 6;
+
+	for (int i = 0;i < stream->n;i++)
+		if (stream->entry[i].phase == 0)
+			n += stream->entry[i].def->size;
+	return n;
+}
+
+/*!
+ ******************************************************************************
+ *	Gets the mean number of bytes per second sent on the link (packet framing
+ *	included, byte stuffing excluded)
+ *	\param[in]	stream		stream
+ *	\param[in]	tick_rate	ticks per second
+ * \return     bytes per second, 0 if the stream is stopped
+ ******************************************************************************
+*/
+uint32_t TLM_BytesPerSecond(const TLM_Stream_t *stream,uint32_t tick_rate)
+{
+uint64_t		bytes;							// bytes per period, scaled by 2^16
+
+	if (!stream->active)
+		return 0;
+	bytes = (uint64_t)(TLM_HEADER_LEN + 6 + TLM_FRAME_OVERHEAD) << 16;
+	for (int i = 0;i < stream->n;i++)
+		bytes += ((uint64_t)stream->entry[i].def->size << 16) / stream->entry[i].decimation;
+	return (uint32_t)((bytes * tick_rate / stream->period + 0xFFFF) >> 16);
+}
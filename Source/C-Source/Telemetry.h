@@ -0,0 +1,85 @@
+/*
+ * Telemetry.h
+ *
+ *  Streaming of signals over the command interface
+ */
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+/*!
+ ******************************************************************************
+ *	A subscription selects up to TLM_MAX_SIGNALS signals of a catalogue, each
+ *	with an index (channel, device) and a decimation, and a sampling period in
+ *	ms. Every period a frame is sent without further request:
+ *	<command header><seq 16><tick 32><values>
+ *	A signal with decimation d is part of the first frame and then of every
+ *	d-th period, the values follow the order of the subscription (little
+ *	endian, the size of each signal is given by the catalogue). Periods which
+ *	could not be sampled in time are skipped, seq and the decimation still
+ *	count them. seq wraps, the decimation does not depend on it.
+ *	This file has no hardware dependency: the catalogue supplies the read
+ *	functions.
+ ******************************************************************************
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define	TLM_MAX_SIGNALS				16					///< Signals per subscription
+#define	TLM_HEADER_LEN					6					///< Command header, filled by the caller
+#define	TLM_MAX_FRAME_LEN				128				///< Frame length (command header included)
+#define	TLM_FRAME_OVERHEAD			4					///< SOP, EOP and CRC of a packet
+#define	TLM_MAX_SUBSCRIPTION_LEN	(3 + 3 * TLM_MAX_SIGNALS)	///< Subscription with TLM_MAX_SIGNALS signals
+
+#define	TLM_ERR_LENGTH					(-1)				///< Subscription too short
+#define	TLM_ERR_PARAMETER				(-2)				///< Period, decimation, number of signals or frame length out of range
+#define	TLM_ERR_SIGNAL					(-3)				///< Signal not in the catalogue
+
+typedef bool (*TLM_Read_t)(uint8_t index,uint8_t *value);		///< Writes the value (size bytes, little endian)
+
+typedef struct {
+	uint8_t					id;
+	uint8_t					size;					// bytes of the value
+	TLM_Read_t				read;
+} TLM_SignalDef_t;
+
+typedef struct {
+	const TLM_SignalDef_t	*def;
+	uint8_t					index;
+	uint8_t					decimation;
+	uint8_t					phase;				// periods since the last sample, modulo decimation
+} TLM_Entry_t;
+
+typedef struct {
+	const TLM_SignalDef_t	*catalogue;
+	int						catalogue_len;
+	TLM_Entry_t				entry[TLM_MAX_SIGNALS];
+	int						n;						// signals subscribed
+	uint32_t					period;				// ticks
+	uint32_t					next;					// tick of the next sample
+	uint16_t					seq;
+	uint8_t					source;				// interface of the subscriber
+	bool						active;
+	uint32_t					frames;				// frames sampled
+	uint32_t					skipped;				// periods skipped
+	uint32_t					failed;				// values which could not be read (sent as 0)
+} TLM_Stream_t;
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* __cplusplus */
+
+void TLM_Init(TLM_Stream_t *stream,const TLM_SignalDef_t *catalogue,int catalogue_len);
+int TLM_Subscribe(TLM_Stream_t *stream,const uint8_t *data,int len,uint8_t source,uint32_t now,uint32_t tick_rate);
+void TLM_Stop(TLM_Stream_t *stream);
+uint32_t TLM_TimeToNext(const TLM_Stream_t *stream,uint32_t now);
+int TLM_Sample(TLM_Stream_t *stream,uint32_t now,uint8_t *frame,int max);
+int TLM_FrameLen(const TLM_Stream_t *stream);
+uint32_t TLM_BytesPerSecond(const TLM_Stream_t *stream,uint32_t tick_rate);
+
+#if defined(__cplusplus)
+}
+#endif /* __cplusplus */
+
+#endif /* TELEMETRY_H_ */
@@ -10,6 +10,7 @@
 // Includes
 #include "BoardMgr.h"
 #include "ProcessData.h"
+#include "EEPROMhandler.h"
 //#include "AnalogOutput.h"
 
 #define DBGPRINTF_BOARDMGR
@@ -26,6 +27,39 @@ const DataProviderInfo_t BoardMgr::m_DataProviderInfo[BOARD_N_DATAPROVIDER] =
 
 BoardMgr *BoardMgr::BoardMgrInstance = nullptr;
 
+// ----------------------------------------------------------------------------
+// Startup sequence (see BootGraph.h): the stages wait on the readiness signals,
+// the timeouts are the former fixed waits
+enum EBootStage
+{
+	eBootFlexisoft = 0,			// the Flexisoft supplies the 24V safety
+	eBootADC,						// first complete ADC scan, the Relays are checked by the ADC
+	eBootCAN,
+	eBootEEPROM,					// loads the parameter journal
+	eBootRelays,
+	eBootSafety,					// initial check of the safety chain, Safety Manager task
+	eBootCleaning,					// Cleaning Unit Manager task, watchdog
+	eBootStages
+};
+
+#define BOOT_POLL_PERIOD				10			// in ms
+#define BOOT_FLEXISOFT_HOLD			500		// in ms
+#define BOOT_FLEXISOFT_TIMEOUT		12000		// in ms
+#define BOOT_ADC_TIMEOUT				1000		// in ms
+#define BOOT_RELAYS_HOLD				1000		// in ms, lets the Relays settle
+#define BOOT_RELAYS_TIMEOUT			10000		// in ms
+
+const BOOT_StageDef_t BoardMgr::m_BootStages[eBootStages] =
+{
+	{ "Flexisoft",	0,																	nullptr,				BootFlexisoftReady,	BOOT_FLEXISOFT_HOLD,	BOOT_FLEXISOFT_TIMEOUT },
+	{ "ADC",			0,																	nullptr,				BootADCReady,			0,	BOOT_ADC_TIMEOUT },
+	{ "CAN",			0,																	BootStartCAN,		nullptr,	0,	0 },
+	{ "EEPROM",		0,																	BootStartEEPROM,	nullptr,	0,	0 },
+	{ "Relays",		BOOT_STAGE(eBootFlexisoft) | BOOT_STAGE(eBootADC),		BootStartRelays,	BootRelaysReady,		BOOT_RELAYS_HOLD,		BOOT_RELAYS_TIMEOUT },
+	{ "Safety",		BOOT_STAGE(eBootRelays),										BootStartSafety,	nullptr,	0,	0 },
+	{ "Cleaning",	BOOT_STAGE(eBootSafety) | BOOT_STAGE(eBootCAN) | BOOT_STAGE(eBootEEPROM),		BootStartCleaning,	nullptr,	0,	0 },
+};
+
 // ----------------------------------------------------------------------------
 // Constants
 #define BOARDMGR_TASK_PERIOD 	100		// in uc cycles
@@ -134,71 +168,143 @@ BoardMgr::BoardMgr(void) :
 	m_CANMgr.RegisterDataProvider(&m_SafetyMgr, SAFETY_OBJID);
 
    // Start all managers
-   m_CANMgr.Start(2048);
-	// wait 12 seconds to let time for the flexisoft to start up
-	dbgprintf("Waiting 12s to allow Flexisoft to start up: ");	
-//	for (int i = 0;i < 12;i++)
-//	{
-//		CUC_Task::Wait(1000);  
-//		dbgprintf(" %d",i+1);
-//	}
-//	dbgprintf(" done.\n");
-	// wait 12 seconds to let time for the Flexisoft to start up
-   CUC_Task::Wait(12000);
-//   CUC_Task::Wait(1000);  // wait 12 seconds to let time for the flexisoft to start up
-   dbgprintf("Switch Relay 1 on ...");
-	if (ControlRelay1(true,2000,false))
-		dbgprintf(" succeeded\n");
-	else
-		dbgprintf(" failed\n");
-   dbgprintf("Switch Relay 2 on ...");
-	if (ControlRelay2(true,false))
-		dbgprintf(" succeeded\n");
-	else
-		dbgprintf(" failed\n");
-	// wait 1 second to allow the Relays to settle
-	dbgprintf("Waiting to let the Relays settle ...\n");
-   CUC_Task::Wait(10000);
-	dbgprintf("... done.\n");
+	// The PWM control task runs the device state machines on each PWM period
+   m_PWMDriver.Start(2048);
+	Boot();
+	
+	BoardMgrInstance = this;
+	
+	dbgprintf("RTOS Free Heap: %d\n",xPortGetFreeHeapSize());
+   dbgprintf("... Board Manager Constructor done.\n");	
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Runs the startup sequence, the independent stages at the same time
+void BoardMgr::Boot(void)
+{
+static BOOT_Graph_t	graph;
+static const char		*state[] = { "idle","waiting","done","TIMEOUT","FAILED" };
+uint32_t					now = (uint32_t)(BOARD_getSystemTime_us() / 1000);
+
+	dbgprintf("Startup sequence ...\n");
+	BOOT_Init(&graph,m_BootStages,eBootStages,this,now);
+	while (!BOOT_Step(&graph,now))
+	{
+		CUC_Task::Wait(BOOT_POLL_PERIOD);
+		now = (uint32_t)(BOARD_getSystemTime_us() / 1000);
+	}
+	now = (uint32_t)(BOARD_getSystemTime_us() / 1000);		// the last stages may have blocked
+	for (unsigned i = 0;i < eBootStages;i++)
+		dbgprintf("   %-10s %-7s %6d ms\n",m_BootStages[i].name,state[graph.stage[i].state],
+			(int)(graph.stage[i].finished - graph.begin));
+	dbgprintf("... operational after %d ms\n",(int)(now - graph.begin));
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Gets the stages of the startup sequence, indexed by EBootStage
+const BOOT_StageDef_t *BoardMgr::GetBootStages(unsigned *count)
+{
+	*count = eBootStages;
+	return m_BootStages;
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Startup: the Flexisoft is up when it supplies the 24V safety
+bool BoardMgr::BootFlexisoftReady(void *ctx,unsigned stage)
+{
+	return BOARD_GetT24_Safety();
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Startup: the ADC values are valid after the first complete scan
+bool BoardMgr::BootADCReady(void *ctx,unsigned stage)
+{
+	return BOARD_ADC_GetScanCount() > 0;
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Startup: starts the CAN node
+bool BoardMgr::BootStartCAN(void *ctx,unsigned stage)
+{
+	static_cast<BoardMgr *>(ctx)->m_CANMgr.Start(2048);
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Startup: loads the parameter journal from the EEPROM
+bool BoardMgr::BootStartEEPROM(void *ctx,unsigned stage)
+{
+	return EEPROM_ReadParamStructCount() >= 0;
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Startup: switches the Relays on, they are switched by HandleRelay1
+bool BoardMgr::BootStartRelays(void *ctx,unsigned stage)
+{
+	dbgprintf("Switch Relay 1 and 2 on\n");
+	return ControlRelay1(true,2000,false) && ControlRelay2(true,false);
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Startup: both Relays are on and the voltage behind them is present
+bool BoardMgr::BootRelaysReady(void *ctx,unsigned stage)
+{
+uint8_t		status;
+float			VB1_rail;
+
+	return BOARD_GetRelayStatus(&status,&VB1_rail) && (status & 0x07) == 0x07;
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Startup: checks the safety chain and starts the Safety Manager
+bool BoardMgr::BootStartSafety(void *ctx,unsigned stage)
+{
+BoardMgr		*pMgr = static_cast<BoardMgr *>(ctx);
 
 	dbgprintf("Safety Manager: Enable Checks ...\n");
-	m_SafetyMgr.EnableChecks(0xFFFFFFFF);
+	pMgr->m_SafetyMgr.EnableChecks(0xFFFFFFFF);
 	dbgprintf("done ...\n");
 	dbgprintf("Safety Manager: Initial Check of Safety Chain ...\n");
 #ifdef TEST_SAFETY_MANAGER_TASK
-	m_SafetyMgr.Start(2048);
+	pMgr->m_SafetyMgr.Start(2048);
 	dbgprintf("... SUCCESS, Safety Manager Task started\n");
 #else
 #ifdef SAFETY_NO_INITIAL_CHECK
    if (true)
 #else
-   if (m_SafetyMgr.CheckSafetyChain(10))
+   if (pMgr->m_SafetyMgr.CheckSafetyChain(10))
 #endif
    {
-		m_SafetyMgr.Start(2048);
+		pMgr->m_SafetyMgr.Start(2048);
 		dbgprintf("... SUCCESS, Safety Manager Task started\n");
    }
 	else
 	{
-		dbgprintf("... FAILED due to error in Safety Chain, Safety State = %d\n",m_SafetyMgr.getSafetyCheckState());
+		dbgprintf("... FAILED due to error in Safety Chain, Safety State = %d\n",pMgr->m_SafetyMgr.getSafetyCheckState());
+		return false;
 	}
 #endif
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Startup: starts the Cleaning Unit Manager and the watchdog
+bool BoardMgr::BootStartCleaning(void *ctx,unsigned stage)
+{
+BoardMgr		*pMgr = static_cast<BoardMgr *>(ctx);
+
 	dbgprintf("Enabling GPIO-Interrupts of PORTA\n");
 	BOARD_Enable_Port_IRQ(PORTA);
 	dbgprintf("Enabling GPIO-Interrupts of PORTC\n");
 	BOARD_Enable_Port_IRQ(PORTC);
 	dbgprintf("Now starting the Cleaning Unit Manager ...\n");
-	m_CleaningUnitMgr.Start(2048);
+	pMgr->m_CleaningUnitMgr.Start(2048);
     
 	// Start the watchdog 
    // Note that this must be done after the check of the safety chain because it takes too much time...
 	dbgprintf("Now starting the Watchdog ...\n");
-	m_Watchdog.Start(10);			// TODO Check Watchdog Implementation
-	
-	BoardMgrInstance = this;
-	
-	dbgprintf("RTOS Free Heap: %d\n",xPortGetFreeHeapSize());
-   dbgprintf("... Board Manager Constructor done.\n");	
+	pMgr->m_Watchdog.Start(10);			// TODO Check Watchdog Implementation
+	return true;
 }
 
 // ----------------------------------------------------------------------------
@@ -25,6 +25,7 @@
 #include "AnalogInput.h"
 #include "CANDriver.h"
 #include "CANNode.h"
+#include "BootGraph.h"
 
 #define BOARD_N_DATAPROVIDER		2
 
@@ -55,6 +56,18 @@ public:
 	static bool GetCAN_ProviderContent(uint32_t id,uint32_t subid,
 			uint32_t *content,bool *valid);
 	static bool GetCAN_ProviderInfo(uint32_t id,char **Name,int *ObjID);
+	static const BOOT_StageDef_t *GetBootStages(unsigned *count);
+
+private:
+	void Boot(void);
+	static bool BootFlexisoftReady(void *ctx,unsigned stage);
+	static bool BootADCReady(void *ctx,unsigned stage);
+	static bool BootStartCAN(void *ctx,unsigned stage);
+	static bool BootStartEEPROM(void *ctx,unsigned stage);
+	static bool BootStartRelays(void *ctx,unsigned stage);
+	static bool BootRelaysReady(void *ctx,unsigned stage);
+	static bool BootStartSafety(void *ctx,unsigned stage);
+	static bool BootStartCleaning(void *ctx,unsigned stage);
 
 private:
 	Timer m_Timer0;
@@ -83,6 +96,7 @@ private:
 	Watchdog m_Watchdog;
 	static BoardMgr *BoardMgrInstance;
 	static const DataProviderInfo_t m_DataProviderInfo[BOARD_N_DATAPROVIDER];
+	static const BOOT_StageDef_t m_BootStages[];
 };
 
 extern "C" bool GetCANstatus(uint32_t *nProvider,uint32_t *id,uint32_t *nmt_state);
@@ -37,6 +37,16 @@
 #define SAFETY_ANTOK_ID 							1		// ANT ok sub-index
 #define SAFETY_REQUEST_ID               		2		// Request sub-index
 
+// ----------------------------------------------------------------------------
+// PDOs, PDO1..4 are shared by all objects of the node (see CANNode.h)
+#define CLEANING_STATUS_TPDO						1		// Cleaning status, on every SYNC
+#define CLEANING_REQUEST_RPDO						1		// Cleaning request and water settings, on reception
+#define SAFETY_STATUS_TPDO							2		// Safety status, on change
+#define SAFETY_REQUEST_RPDO						2		// ANT ok and safety request, on reception
+#define CLEANING_STATUS_SYNC_CYCLE				1		// Cleaning status TPDO sent on every n-th SYNC
+#define STATUS_TPDO_INHIBIT_TIME					10		// [ms] minimum time between two status TPDOs
+#define STATUS_TPDO_EVENT_TIME					100	// [ms] an unchanged status TPDO is repeated after this time
+
 // ----------------------------------------------------------------------------
 //! \brief List all devices supported by CleaningUnitMgr
 typedef enum
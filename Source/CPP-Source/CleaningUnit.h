@@ -9,7 +9,7 @@
 #ifndef _CLEANINGUNIT_H_
 #define _CLEANINGUNIT_H_
 
-#include "base.h"
+#include "Base.h"
 
 //#define TEST_MODE 1
 
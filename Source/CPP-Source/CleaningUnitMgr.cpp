@@ -18,6 +18,7 @@
 #include "Version.h"
 #include "SvnRevision.h"
 #include "board.h"
+#include "FRAM.h"
 #include "Debug.h"
 
 #define LIFT_TEST
@@ -462,6 +463,7 @@ uint32_t			 timerval;
 			if (m_FatalErrorCntr < MAX_FATAL_ERROR_CNT)
 			{
 				m_FatalErrorCntr++;
+				FRAM_LogEvent(EVR_SRC_CLEANING,0,m_FatalErrorCntr);
 #if TRACEALYZER != 0 && TRC_CLEAN != 0
 			vTracePrintF(trcClMgr,"Fatal Error Counter incremented: %d",m_FatalErrorCntr);
 #endif
@@ -896,6 +898,12 @@ void CleaningUnitMgr::RegisterData(CANNode &_node, uint16_t _nObjIndex)
 	_node.DeclareData(_nObjIndex, CLEANING_DRYRUN_ID, m_pDryRun);
 	dbgprintf("   Register SubID %d\n",CLEANING_DEBUG_INFO_ID);
 	_node.DeclareData(_nObjIndex, CLEANING_DEBUG_INFO_ID, m_pDebugInfo);
+	dbgprintf("   Map TPDO%d and RPDO%d\n",CLEANING_STATUS_TPDO,CLEANING_REQUEST_RPDO);
+	_node.ConfigureTxPDO(CLEANING_STATUS_TPDO, CLEANING_STATUS_SYNC_CYCLE);
+	_node.MapTxPDO(CLEANING_STATUS_TPDO, _nObjIndex, CLEANING_STATUS_ID, sizeof(uint32_t));
+	_node.ConfigureRxPDO(CLEANING_REQUEST_RPDO, CANNODE_PDO_EVENT_PROFILE);
+	_node.MapRxPDO(CLEANING_REQUEST_RPDO, _nObjIndex, CLEANING_REQUEST_ID, sizeof(uint32_t));
+	_node.MapRxPDO(CLEANING_REQUEST_RPDO, _nObjIndex, CLEANING_WATERSETTINGS_ID, sizeof(uint16_t));
 	m_pStatus->Write(BuildCUCStatus(ECleaningUnitMgrStatus_NotInitialized, 0, 0, 0));
 	m_pRequest->Write(0);
 	m_pDebugInfo->Write(0);
@@ -1085,53 +1093,97 @@ bool 			bResult = true;
 }
 
 // ----------------------------------------------------------------------------
-//! \brief Stop cleaning
+// Stop of the devices (see BootGraph.h): all devices are stopped at once, a lift
+// is moved up after the motor of its device has stopped
+enum EStopStage
+{
+	eStopBrush = 0,
+	eStopSuction,
+	eStopWaterPump,
+	eStopBrushLift,
+	eStopSuctionLift,
+	eStopStages
+};
+
+#define STOP_POLL_PERIOD				10			// in ms
+
+const BOOT_StageDef_t CleaningUnitMgr::m_StopStages[eStopStages] =
+{
+	{ "Brush",			0,								StopStageStart,	StopStageReady,	0,	MAX_TIME_DEVICE_READY },
+	{ "Suction",		0,								StopStageStart,	StopStageReady,	0,	MAX_TIME_DEVICE_READY },
+	{ "WaterPump",		0,								StopStageStart,	StopStageReady,	0,	MAX_TIME_DEVICE_READY },
+	{ "BrushLift",		BOOT_STAGE(eStopBrush),		StopStageStart,	StopStageReady,	0,	MAX_TIME_DEVICE_READY },
+	{ "SuctionLift",	BOOT_STAGE(eStopSuction),	StopStageStart,	StopStageReady,	0,	MAX_TIME_DEVICE_READY },
+};
+
+// ----------------------------------------------------------------------------
+//! \brief Gets the device of a stage of the stop
+CleaningDevice *CleaningUnitMgr::GetStopStageDevice(unsigned stage)
+{
+	switch (stage)
+	{
+		case eStopBrush:
+			return &m_Brush;
+		case eStopSuction:
+			return &m_Suction;
+		case eStopWaterPump:
+			return &m_WaterPump;
+		case eStopBrushLift:
+			return &m_BrushLift;
+		case eStopSuctionLift:
+			return &m_SuctionLift;
+		default:
+			return NULL;
+	}
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Stop: requests a device to stop
+bool CleaningUnitMgr::StopStageStart(void *ctx,unsigned stage)
+{
+	return static_cast<CleaningUnitMgr *>(ctx)->GetStopStageDevice(stage)->Stop();
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Stop: the device has stopped
+bool CleaningUnitMgr::StopStageReady(void *ctx,unsigned stage)
+{
+	return static_cast<CleaningUnitMgr *>(ctx)->GetStopStageDevice(stage)->GetStatus() == ECleaningDeviceStatus_Stopped;
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Gets the stages of the stop, indexed by EStopStage
+const BOOT_StageDef_t *CleaningUnitMgr::GetStopStages(unsigned *count)
+{
+	*count = eStopStages;
+	return m_StopStages;
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Stop cleaning: all devices are stopped at the same time, the stop takes
+//! as long as the slowest device (its lift included)
 bool CleaningUnitMgr::StopCleaning(void)
 {
 	bool bResult = true;
-	uint32_t nSlots = sizeof(m_apDevices)/sizeof(CleaningDevice*);
 
 #if TRACEALYZER != 0 && TRC_CLEAN != 0
-	vTracePrintF(trcClMgr,"N Slots = %d (StopCleaning)",nSlots);
+	vTracePrintF(trcClMgr,"N Stages = %d (StopCleaning)",eStopStages);
 #endif
-	for (int32_t i=nSlots-1; i>=0; i--)
+	BOOT_Init(&m_StopGraph,m_StopStages,eStopStages,this,SystemTime::GetTime());
+	while (!BOOT_Step(&m_StopGraph,SystemTime::GetTime()))
+		Wait(STOP_POLL_PERIOD);
+	for (unsigned i = 0;i < eStopStages;i++)
 	{
-		if (m_apDevices[i] != NULL)
-		{
-			bResult &= m_apDevices[i]->Stop();
-			if (bResult)
-			{
-				ECleaningDeviceStatus eStatus = m_apDevices[i]->GetStatus();
-				uint64_t m_nWaitForDevice = SystemTime::GetTime() + MAX_TIME_DEVICE_READY;
-#if TRACEALYZER != 0 && TRC_CLEAN != 0
-				bool timeout = false;
-#endif
-				while (eStatus != ECleaningDeviceStatus_Stopped)
-				{
-					if (SystemTime::GetTime() >= m_nWaitForDevice)
-					{
-#if TRACEALYZER != 0 && TRC_CLEAN != 0
-						timeout = true;
-#endif
-						break;
-					}
-					eStatus = m_apDevices[i]->GetStatus();
-					Wait(10);
-				}
 #if TRACEALYZER != 0 && TRC_CLEAN != 0
-				if (timeout)
-					vTracePrint(trcClMgr,"Timeout waiting for Device ready (StopCleaning)");
-				vTracePrintF(trcClMgr,"Dev.State(%d) = %d, OK (StopCleaning)",i,(int)eStatus);
-#endif
-				bResult = (eStatus == ECleaningDeviceStatus_Stopped);
-			}
-			else
-			{
-#if TRACEALYZER != 0 && TRC_CLEAN != 0
-				vTracePrintF(trcClMgr,"Device %d, NOK (StopCleaning)",i);
-#endif
-			}
-		}
+		if (m_StopGraph.stage[i].state == BOOT_TIMEOUT)
+			vTracePrint(trcClMgr,"Timeout waiting for Device ready (StopCleaning)");
+		else if (m_StopGraph.stage[i].state == BOOT_FAILED)
+			vTracePrintF(trcClMgr,"Device %d, NOK (StopCleaning)",i);
+		vTracePrintF(trcClMgr,"Dev.State(%d) = %d after %d ms (StopCleaning)",i,
+			(int)GetStopStageDevice(i)->GetStatus(),(int)(m_StopGraph.stage[i].finished - m_StopGraph.begin));
+#endif
+		if (m_StopGraph.stage[i].state != BOOT_DONE)
+			bResult = false;
 	}
 	return bResult;
 }
@@ -1616,5 +1668,7 @@ extern "C" bool ClMgr_EnableDryRun(uint8_t enable)
 //! \brief Sets the Ramp Slope of a Suction or Brush Device
 extern "C" bool ClMgr_SetRampSlope(uint8_t Device,unsigned Slope,unsigned SlopeDiv)
 {
+	if (ClMngr == nullptr)
+		return false;
 	return ClMngr->SetBrushSuctionRampSlope(Device,Slope,SlopeDiv);
 }
@@ -28,6 +28,7 @@
 #include "CANIds.h"
 #include "CANNode.h"
 #include "ProcessData.h"
+#include "BootGraph.h"
 
 #define MAN_START_DEVICE_MODE				1
 
@@ -170,6 +171,7 @@ public: // For testing purpose only...
 	 bool SetDryRun(uint16_t enable);
 	 bool IsInEMstop(void);
 	 bool SetBrushSuctionRampSlope(uint8_t Device,unsigned Slope,unsigned SlopeDiv);
+	 static const BOOT_StageDef_t *GetStopStages(unsigned *count);
 
 private:
     SafetyMgr &						m_SafetyMgr;
@@ -183,6 +185,8 @@ private:
     DigitalOutput *					m_pDosingValve;
 
     CleaningDevice *					m_apDevices[N_CLEANING_DEVICES];
+    BOOT_Graph_t						m_StopGraph;					// stop of the devices (StopCleaning)
+    static const BOOT_StageDef_t	m_StopStages[];
     int 				  					m_apDevicesStatusOld[N_CLEANING_DEVICES];
 
     uint16_t m_nObjectIndex;
@@ -238,6 +242,9 @@ private:
 	bool CheckAndHandlePowerStateAndEMstop(void);
 	eEMRCV_t CleaningRFS_FSM(bool Reset);
 	bool CheckForDeviceErrors(void);
+	CleaningDevice *GetStopStageDevice(unsigned stage);
+	static bool StopStageStart(void *ctx,unsigned stage);
+	static bool StopStageReady(void *ctx,unsigned stage);
 	void HandleFatalErrorCnt(bool CountUp,bool ResetCounter);
 };
 
@@ -15,6 +15,7 @@
 #include "AnalogInput.h"
 #include "IO.h"
 #include "board.h"
+#include "FRAM.h"
 
 // #include "AnalogOutput.h" // YJE test...
 
@@ -73,6 +74,8 @@ LiftDevice::LiftDevice(ECleaningUnitMgrErrors _eDeviceErrorId, MotorDriver &_lif
 	Disable();
 	// Set the output saturation of the PID controller
 	m_PIDController.SetOutputSaturation(-LIFT_PWM_AMPLITUDE / 2, LIFT_PWM_AMPLITUDE / 2);
+	// Use a jerk-limited Profile for smoother Starts and lower Peak Current
+	m_TMPGenerator.SetJerk(LIFT_TMP_JERK, LIFT_TMP_JERK_DIV);
 	// Delta Position initially is 0 (nothing to do)
 	m_nDeltaPosition = 0;
 	// Register the interrupt handler of the Lift Motor (PWM Timer)
@@ -85,7 +88,7 @@ LiftDevice::LiftDevice(ECleaningUnitMgrErrors _eDeviceErrorId, MotorDriver &_lif
 	if (sLiftDevicesN < 2)
 		sLiftDevices[sLiftDevicesN++] = this;
 #if USE_IIR_FILTER != 0
-	m_nAvgCurrentFB = new IIR<int32_t>(
+	m_nAvgCurrentFB.SetLowPassCoefficients(
 		3.9130215E-05F,		// b0
 		7.8260411E-05F,		// b1
 		3.9130215E-05F,		// b2
@@ -154,6 +157,7 @@ int32_t 	nCurrent;
 			m_Lift_Error_Reason = eLiftDeviceErrReason_OVC;		// Error Reason for the Lift FSM
 			m_eLiftStateErrSrc = m_eLiftState;						// Set the state that caused the error
 			m_OverCurrent_Test = nCurrent;							// Store the current that cause the Overcurrent Error
+			FRAM_LogEvent(EVR_SRC_LIFT,(uint8_t)m_nLiftID,(uint32_t)abs(nCurrent));
 			m_OC_Cnt = 0;													// Reset the Overcurrent Counter
 			m_RecoveryTime = SystemTime::GetTime() + 
 					MAX_OC_RECOVERY_TIME;								// Set the Recovery Time (ms)
@@ -260,11 +264,14 @@ void LiftDevice::HandleEvent(EventSource *_pSource, uint32_t _nEventId, uint32_t
 	// ******************************************
 	if (_nEventId == ELiftDeviceEventId_PWM)
 	{
-		// calculate the actual position from the previos value plus the delta position
-		// (the actual count value from the hall sensor pulse counter, either +1 or -1)
-		m_nActualPosition += m_nDeltaPosition;
-		// and reset the delta position to 0
+		// take the delta position counted by the hall sensor interrupt and reset it
+		// to 0 in one step, a pulse counted in between would be lost otherwise
+		uint32_t nPrimask = DisableGlobalIRQ();
+		int32_t nDelta = m_nDeltaPosition;
 		m_nDeltaPosition = 0;
+		EnableGlobalIRQ(nPrimask);
+		// calculate the actual position from the previos value plus the delta position
+		m_nActualPosition += nDelta;
 		// increase the internal time by one PWM period duration (in ms)
 		m_nTime += m_LiftMotor.GetPeriodDuration() / 1000;
 #if TRACEALYZER != 0 && TRC_LIFT != 0
@@ -299,19 +306,11 @@ void LiftDevice::HandleEvent(EventSource *_pSource, uint32_t _nEventId, uint32_t
 		{
 #if TRACEALYZER != 0 && TRC_LIFT != 0 && TRC_LIFT_SHOW_MEAS_CURR != 0
 			int ExtCurrent = abs(m_pDeviceMotor->GetCurrent());
-#if USE_IIR_FILTER != 0
-		   nExtCurrentFB = m_nAvgCurrentFB->Update(ExtCurrent);
-#else
 		   nExtCurrentFB = m_nAvgCurrentFB.Update(ExtCurrent);
-#endif
 			if (ExtCurrent > 200 || nExtCurrentFB > 200)
 				vTracePrintF(trcLift,"Ext. Device Cur. = %d mA, Mean = %d mA",ExtCurrent,nExtCurrentFB);
-#else
-#if USE_IIR_FILTER != 0
-			nExtCurrentFB = m_nAvgCurrentFB->Update(abs(m_pDeviceMotor->GetCurrent()));
 #else
 			nExtCurrentFB = m_nAvgCurrentFB.Update(abs(m_pDeviceMotor->GetCurrent()));
-#endif
 #endif
 		}
 		if (m_Hold)		// Active Hold from the Cleaning Manager resets the State of the FSM
@@ -23,11 +23,8 @@
 #include "Timer.h"
 #include "MotorDriver.h"
 #include "CleaningUnit.h"
-#include "Average.h"
+#include "Filter.h"
 #include "board.h"
-#if USE_IIR_FILTER != 0
-#include "IIRFilter.h"
-#endif
 
 #define MAX_OC_CNT					100		// Number of Overcurrent Counts (Moving Overcurrent)
 #define MAX_MOVINT_TIME				5000		// Maximum Time for Motor Movement (Moving Timeout)
@@ -39,6 +36,9 @@
 
 #define LIFT_CHECK_DWELL_TIME
 
+#define LIFT_TMP_JERK				1			// Jerk of the Lift Motion Profile (LIFT_TMP_JERK / LIFT_TMP_JERK_DIV)
+#define LIFT_TMP_JERK_DIV			20			// LIFT_TMP_JERK = 0 selects the trapezoidal Profile
+
 // ----------------------------------------------------------------------------
 // Forward declaration
 class PWMOutput;
@@ -165,7 +165,7 @@ private:
 	ECleaningDeviceStatus m_eEndOfMoveStatus;       //!< Status to switch to when move is finished
 	uint32_t m_nTime;                               //!< Internal image of the current time
 	int32_t m_nActualPosition;                      //!< The actual position
-	int32_t m_nDeltaPosition;                       //!< Distance to the target position
+	volatile int32_t m_nDeltaPosition;              //!< Hall sensor pulses counted by the interrupt since the last PWM cycle
 	int32_t m_nHomePosition;                        //!< The home position (position reached at the end of the homing sequence)
 	int32_t m_nRestPosition;                        //!< The rest position (when the vehicle is not cleaning)
 	int32_t m_nWorkingPosition;                     //!< The working position (when the vehicle is cleaning)
@@ -188,7 +188,7 @@ private:
 	unsigned	DwellMovTimePtr;								//!< Pointer (Index) into the DwellMoveTimes array (next position)	
 	int32_t DwellTime;										//!< Dwell Time, no movement before Dwell Time has not expired
 #if USE_IIR_FILTER != 0
-	IIR<int32_t> * m_nAvgCurrentFB;			  			//!< This is the IIR Filter for the current measurement (Biquad LP)	
+	Biquad<int32_t> m_nAvgCurrentFB;			  			//!< This is the IIR Filter for the current measurement (Biquad LP)	
 #else
 	Average<128, int32_t> m_nAvgCurrentFB;			  	//!< This is the Averager for the current measurement (Moving Average)	
 #endif
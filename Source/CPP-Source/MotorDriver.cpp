@@ -49,6 +49,7 @@ CurrentProbe::CurrentProbe(AnalogInput *_pCurrentFB, int32_t _nADCgain)
 	  m_nCurrent(0)				// added since this was not initialized
 {
    dbgprintf("Current Probe Constructor ...\n");	
+	SetGain(_nADCgain);
 	m_nOffset = m_pCurrentFB->GetOffset();
    dbgprintf("   Current Probe Offset = %d, Gain = %d\n",m_nOffset,m_nADCgain);	
    dbgprintf("... Current Probe Constructor done.\n");	
@@ -63,7 +64,11 @@ int32_t CurrentProbe::Measure()
 #if !NB_CURRENTMONITOR_SIGNED
 	nCurrent = abs(nCurrent);	
 #endif	// we are not interested in the current direction
-	m_nCurrent = (nCurrent * 1000) / m_nADCgain;		// Calculate the Current in mA
+	// Calculate the Current in mA: (nCurrent * 1000) / m_nADCgain by a multiplication,
+	// exact for |nCurrent| < 2^32 / m_nADCgain
+	uint32_t nAbs = (nCurrent < 0) ? -nCurrent : nCurrent;
+	int32_t nmA = (int32_t)(((uint64_t)nAbs * m_nScale) >> 32);
+	m_nCurrent = (nCurrent < 0) ? -nmA : nmA;
 	return m_nCurrent;
 }
 
@@ -79,6 +84,7 @@ void CurrentProbe::SetOffset(int32_t offset)
 void CurrentProbe::SetGain(int32_t gain)
 {
 	m_nADCgain = gain;
+	m_nScale = (gain > 0) ? (((uint64_t)1000 << 32) + gain - 1) / gain : 0;
 }
 
 // ----------------------------------------------------------------------------
@@ -108,36 +114,24 @@ int32_t CurrentAverage::Measure()
 	// Handle reset requests
 	if (m_bReset)
 	{
-		m_nTotal = 0;
-		m_nIndex = 0;
+		m_History.Reset();
+		m_nCount = 0;
 		m_nAverage = 0;
-		for (int i = 0;i < NB_CURRENTMONITOR_HISTORYSLOTS;i++)
-			m_anHistory[m_nIndex] = 0;
-		m_bFull = false;
 		m_bReset = false;
 	}
 
-	int32_t nCurrent = CurrentProbe::Measure();
-
-	m_nTotal += nCurrent;
-	m_anHistory[m_nIndex] = nCurrent;
-	m_nIndex++;
-	if (m_nIndex >= NB_CURRENTMONITOR_HISTORYSLOTS)
-	{
-		m_nIndex = 0;
-		m_bFull = true;
-	}
+	int32_t nAverage = m_History.Update((int16_t)CurrentProbe::Measure());
 
 	// Buffer is full ?
-	if (m_bFull) 
+	if (m_nCount >= NB_CURRENTMONITOR_HISTORYSLOTS) 
 	{
-		// Handle cyclic buffer
-		m_nTotal -= m_anHistory[m_nIndex];
-		m_nAverage = (m_nTotal/NB_CURRENTMONITOR_HISTORYSLOTS);
+		m_nAverage = nAverage;
 	}
 	else
 	{
-		m_nAverage = (m_nTotal/m_nIndex);
+		// Average of the measures since the reset
+		m_nCount++;
+		m_nAverage = (m_History.GetTotal() / m_nCount);
 	}
 	return m_nAverage;
 }
@@ -14,6 +14,7 @@
 #include "Base.h"
 #include "EventSource.h"
 #include "PWMDriver.h"
+#include "Filter.h"
 
 // ----------------------------------------------------------------------------
 // Constants
@@ -74,6 +75,7 @@ public:
 private:
 	AnalogInput *m_pCurrentFB;
 	int32_t m_nADCgain; 
+	uint64_t m_nScale;			//!< ceil(2^32 * 1000 / m_nADCgain), replaces the division by the gain
 	int32_t m_nCurrent;
 	int32_t m_nOffset;
 };
@@ -98,11 +100,9 @@ public:
 
 private:
 	AnalogInput *m_pCurrentFB;
-	int16_t m_anHistory[NB_CURRENTMONITOR_HISTORYSLOTS];
-	int32_t m_nTotal;
-	int32_t m_nIndex;
+	Average<NB_CURRENTMONITOR_HISTORYSLOTS, int16_t> m_History;
+	int32_t m_nCount;				//!< Number of measures in the history, up to NB_CURRENTMONITOR_HISTORYSLOTS
 	int32_t m_nAverage;	
-	bool m_bFull;
 	bool m_bReset;
 
 };
@@ -12,6 +12,7 @@
 #include "CleaningUnit.h"
 #include "Timer.h"
 #include "board.h"
+#include "FRAM.h"
 
 //#define TEST_WITHOUT_BUMPERS          1
 #define NB_MAX_MISSED_WATCHDOG          125
@@ -28,7 +29,8 @@
 #define DBGPRINTF_SAFETY
 #undef DBGPRINTF_SAFETY
 
-#define INC_ERR_CNT(index)		if (m_ErrorCntr[index] < 255) m_ErrorCntr[index]++
+#define INC_ERR_CNT(index)		do { if (m_ErrorCntr[index] < 255) { m_ErrorCntr[index]++; \
+									FRAM_LogEvent(EVR_SRC_SAFETY,index,m_ErrorCntr[index]); } } while (0)
 
 #if (TRACEALYZER != 0) && (TRC_SAFETY != 0)
 static traceString 				trcSaveMgr;
@@ -887,6 +889,14 @@ void SafetyMgr::RegisterData(CANNode &_node, uint16_t _nObjIndex)
     // CUC outputs
 	dbgprintf("   Register SubID %d\n",SAFETY_STATUS_ID);
 	_node.DeclareData(_nObjIndex, SAFETY_STATUS_ID, m_pStatus);
+
+	// Status and requests are exchanged by PDO as well
+	dbgprintf("   Map TPDO%d and RPDO%d\n",SAFETY_STATUS_TPDO,SAFETY_REQUEST_RPDO);
+	_node.ConfigureTxPDO(SAFETY_STATUS_TPDO, CANNODE_PDO_EVENT_PROFILE, STATUS_TPDO_INHIBIT_TIME, STATUS_TPDO_EVENT_TIME);
+	_node.MapTxPDO(SAFETY_STATUS_TPDO, _nObjIndex, SAFETY_STATUS_ID, sizeof(uint32_t));
+	_node.ConfigureRxPDO(SAFETY_REQUEST_RPDO, CANNODE_PDO_EVENT_PROFILE);
+	_node.MapRxPDO(SAFETY_REQUEST_RPDO, _nObjIndex, SAFETY_ANTOK_ID, sizeof(uint32_t));
+	_node.MapRxPDO(SAFETY_REQUEST_RPDO, _nObjIndex, SAFETY_REQUEST_ID, sizeof(uint32_t));
 	dbgprintf("... Safety Manager, Registering Data done\n");
 }
 
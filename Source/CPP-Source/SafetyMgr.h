@@ -20,7 +20,7 @@
 #include "ProcessData.h"
 #include "IO.h"
 #include "AnalogInput.h"
-#include "Average.h"
+#include "Filter.h"
 #include "TracealyzerSetup.h"
 
 #define MAX_SAFETY_ERR_COUNTERS	6
@@ -33,6 +33,7 @@
  * @brief   Application entry point.
  */
 #include <stdio.h>
+#include <stdarg.h>
 #include "board.h"
 #include "board-DigIO.h"
 #include "board-Ana.h"
@@ -43,6 +44,7 @@
 //#include "MK22FA12.h"
 #include "virtual_com.h"
 #include "CommandHandler.h"
+#include "CmdSystem.h"
 
 #include <stdint.h>
 #include <stdbool.h>
@@ -50,11 +52,13 @@
 #include "task.h"
 #include "cmsis_os2.h"
 
-#include "base.h"
+#include "Base.h"
 #include "UCDevice.h"
 #include "IO.h"
 #include "BoardMgr.h"
 #include "EEPROM.h"
+#include "EEPROMhandler.h"
+#include "FRAM.h"
 
 #include "cmsis_os2.h"
 
@@ -69,7 +73,7 @@ osThreadId_t						sysThread = NULL;
 
 traceString							dbgChannel;
 
-#if USE_STACK_PROTECTION != 0
+#if USE_STACK_PROTECTION != 0 && defined(__ARMCC_VERSION)
 void *__stack_chk_guard = (void *)0xA5432198;
 #endif
 
@@ -96,7 +100,9 @@ va_list 		args;
 void CheckHeapStatus(void)
 {
 	dbgprintf("****************** Begin Of Heap Status ******************\n");
+#if defined(__ARMCC_VERSION)
 	__heapstats((__heapprt)hprintf,stdout);
+#endif
 	dbgprintf("RTOS actual heap size: %d\n",configTOTAL_HEAP_SIZE - xPortGetFreeHeapSize()); 
 	dbgprintf("RTOS max. heap size  : %d\n",configTOTAL_HEAP_SIZE - xPortGetMinimumEverFreeHeapSize()); 
 	dbgprintf("******************  End Of Heap Status  ******************\n");
@@ -172,6 +178,7 @@ __NO_RETURN void osSysInit(void * argument)
 void CommunicationTask(void *pvParameters)
 {
 uint32_t            ulNotify;
+TickType_t          wait;
 static bool			  start = true;
 
    for( ;; )
@@ -182,7 +189,10 @@ static bool			  start = true;
    	    start = false;
    	}
 //	   cmd_SUB_SYS_GET_CLOCKS();
-      if (xTaskNotifyWait(0x00,UINT32_MAX,&ulNotify,(TickType_t)500) == pdTRUE)
+      wait = (TickType_t)SystemTelemetryWait();         // commands are handled until the next telemetry frame is due
+      if (wait > (TickType_t)500)
+         wait = (TickType_t)500;
+      if (xTaskNotifyWait(0x00,UINT32_MAX,&ulNotify,wait) == pdTRUE)
       {
          if ((ulNotify & (1 << 0)) != 0)
          {
@@ -198,6 +208,8 @@ static bool			  start = true;
          	// CheckVB1_Voltage();
          }
       }
+      SystemTelemetryPoll();
+      FRAM_FlushEvents();                                // the staged events, woken up by bit 3 if many are staged
    }
 }
 
@@ -270,6 +282,20 @@ osThreadAttr_t 	thread_attr;
 	
 	CheckHeapStatus();
 
+	// before the receivers: packets are dropped until the queues exist
+	dbgprintf("Initializing Command Handler ...");
+	if (InitCommandHandler())
+		dbgprintf(" SUCCESS\n");
+	else
+		dbgprintf(" FAILED\n");
+
+	// the init task and the communication task share the parameter journal
+	dbgprintf("Initializing Parameter Journal ...");
+	if (EEPROM_InitParamJournal())
+		dbgprintf(" SUCCESS\n");
+	else
+		dbgprintf(" FAILED\n");
+
 	dbgprintf("Initializing USB stack ...");
 	if (usb_main_init())
 		dbgprintf(" SUCCESS\n\n");
@@ -319,7 +345,7 @@ extern "C" void vApplicationStackOverflowHook(TaskHandle_t xTask,char *pcTaskNam
 	error_flags |= (1 << 1);
 }
 
-#if USE_STACK_PROTECTION != 0
+#if USE_STACK_PROTECTION != 0 && defined(__ARMCC_VERSION)
 extern "C" void __stack_chk_fail(void)
 {
    dbgprintf("ERROR Stack violation\n");	
@@ -91,4 +91,57 @@ typedef enum
 	ESdoCommand_ErrorResponse = 0x80
 } ESdoCommand;
 
+// ----------------------------------------------------------------------------
+//! \brief Enumeration of CANopen SDO command specifiers (bits 7..5 of the command byte)
+typedef enum
+{
+	ESdoCcs_DownloadSegment = 0,
+	ESdoCcs_InitiateDownload = 1,
+	ESdoCcs_InitiateUpload = 2,
+	ESdoCcs_UploadSegment = 3,
+	ESdoCcs_Abort = 4,
+	ESdoCcs_BlockUpload = 5,
+	ESdoCcs_BlockDownload = 6
+} ESdoCcs;
+
+// ----------------------------------------------------------------------------
+//! \brief Enumeration of CANopen SDO abort codes
+typedef enum
+{
+	ESdoAbort_ToggleBit = 0x05030000,
+	ESdoAbort_Timeout = 0x05040000,
+	ESdoAbort_InvalidCommand = 0x05040001,
+	ESdoAbort_InvalidBlockSize = 0x05040002,
+	ESdoAbort_InvalidSequence = 0x05040003,
+	ESdoAbort_CRCError = 0x05040004,
+	ESdoAbort_WriteOnly = 0x06010001,
+	ESdoAbort_ReadOnly = 0x06010002,
+	ESdoAbort_NoObject = 0x06020000,
+	ESdoAbort_LengthMismatch = 0x06070010,
+	ESdoAbort_LengthTooHigh = 0x06070012,
+	ESdoAbort_General = 0x08000000
+} ESdoAbort;
+
+// ----------------------------------------------------------------------------
+//! \brief Enumeration of CANopen data types of object dictionary entries
+typedef enum
+{
+	ECANDataType_Integer8 = 0x0002,
+	ECANDataType_Integer16 = 0x0003,
+	ECANDataType_Integer32 = 0x0004,
+	ECANDataType_Unsigned8 = 0x0005,
+	ECANDataType_Unsigned16 = 0x0006,
+	ECANDataType_Unsigned32 = 0x0007,
+	ECANDataType_Domain = 0x000F
+} ECANDataType;
+
+// ----------------------------------------------------------------------------
+//! \brief Access rights of object dictionary entries
+typedef enum
+{
+	ECANAccess_ReadOnly = 0x01,
+	ECANAccess_WriteOnly = 0x02,
+	ECANAccess_ReadWrite = 0x03
+} ECANAccess;
+
 #endif // _CANDEFS_H_
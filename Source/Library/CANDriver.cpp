@@ -13,7 +13,8 @@
 // ----------------------------------------------------------------------------
 //! \brief Constructor
 CANDriver::CANDriver(EDevice_t _eDevice, uint32_t _nBaudrate)
-	: m_Timeout(10)
+	: m_Timeout(10),
+	  m_RxEvent(nullptr)
 {
 	dbgprintf("CAN Driver Constructor, Device = %d, Baudrate = %d ...\n",(int)_eDevice,_nBaudrate);	
 	// Initialize and start CAN
@@ -27,7 +28,22 @@ CANDriver::CANDriver(EDevice_t _eDevice, uint32_t _nBaudrate)
 bool CANDriver::Start()
 {
 //	return (CAN_OK == CAN_start(m_nController));
-	return true;
+	if (m_RxEvent == nullptr)
+	{
+		m_RxEvent = osEventFlagsNew(NULL);
+		if (m_RxEvent == nullptr)
+			return false;
+	}
+	return CAN_SetRxCallback(m_nController,CANDriver::OnMessageReceived,(void *)this);
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Called from the CAN message ISR when a frame has been received
+void CANDriver::OnMessageReceived(unsigned channel,void *arg)
+{
+	CANDriver *ptr = (CANDriver *)arg;
+	if (ptr != nullptr && ptr->m_RxEvent != nullptr)
+		osEventFlagsSet(ptr->m_RxEvent, CANDRIVER_RX_EVENT);
 }
 
 // ----------------------------------------------------------------------------
@@ -42,7 +58,7 @@ void CANDriver::SetTimeout(uint8_t timeout)
 bool CANDriver::SetCANid(uint32_t ID,uint8_t type)
 {
 //	return false;
-	return CAN_ChangeID(0,ID,type);
+	return CAN_ChangeID(m_nController,ID,type);
 }
 
 // ----------------------------------------------------------------------------
@@ -57,35 +73,35 @@ bool CANDriver::AddCANid(uint32_t ID,bool isExtended,bool isRemote)
 //! \brief Send a request to a remote node
 bool CANDriver::SendRequest(uint32_t id)
 {
-	return CAN_RequestMessage(0,id,false);
+	return CAN_RequestMessage(m_nController,id,false);
 }
 
 // ----------------------------------------------------------------------------
 //! \brief Send a 0 byte message
 bool CANDriver::SendMessage(uint32_t id)
 {
-	return CAN_SendMessage(0,id,false,NULL,0);
+	return CAN_SendMessage(m_nController,id,false,NULL,0);
 }
 
 // ----------------------------------------------------------------------------
 //! \brief Send a 1 byte message
 bool CANDriver::SendMessage(uint32_t id, uint8_t data)
 {
-	return CAN_SendMessage(0,id,false,&data,1);
+	return CAN_SendMessage(m_nController,id,false,&data,1);
 }
 
 // ----------------------------------------------------------------------------
 //! \brief Send a 2 byte message
 bool CANDriver::SendMessage(uint32_t id, uint16_t data)
 {
-	return CAN_SendMessage(0,id,false,(uint8_t *)(&data),2);
+	return CAN_SendMessage(m_nController,id,false,(uint8_t *)(&data),2);
 }
 
 // ----------------------------------------------------------------------------
 //! \brief Send a 4 byte message
 bool CANDriver::SendMessage(uint32_t id, uint32_t data)
 {
-	return CAN_SendMessage(0,id,false,(uint8_t *)(&data),4);
+	return CAN_SendMessage(m_nController,id,false,(uint8_t *)(&data),4);
 }
 
 // ----------------------------------------------------------------------------
@@ -96,7 +112,14 @@ uint8_t		buffer[8];
 	
 	*(uint32_t *)(&buffer[0]) = data1;	
 	*(uint32_t *)(&buffer[4]) = data2;	
-	return CAN_SendMessage(0,id,false,buffer,8);
+	return CAN_SendMessage(m_nController,id,false,buffer,8);
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Send a message of 0 to 8 bytes
+bool CANDriver::SendMessage(uint32_t id, const uint8_t *data, uint8_t len)
+{
+	return CAN_SendMessage(m_nController,id,false,(uint8_t *)data,len);
 }
 
 // ----------------------------------------------------------------------------
@@ -107,58 +130,95 @@ bool CANDriver::ReadMessage(CAN_msg &msg)
 }
 
 // ----------------------------------------------------------------------------
-//! \brief Read a CAN message. Returns true if successful.
+//! \brief Read a CAN message. Blocks up to timeout ticks until a frame has
+//!        been received. Returns true if successful.
+//! \details The timeout runs from the call: a wake-up without a frame (taken
+//!          by another reader) waits only for the remaining ticks.
 bool CANDriver::ReadMessage(CAN_msg &msg, uint16_t timeout)
 {
 bool		IDisExtended;
 int		len;
+uint32_t	start = osKernelGetTickCount();
+uint32_t	elapsed;
 	
-	if (CAN_isRxMessageAvailable(0))
+	while (!CAN_isRxMessageAvailable(m_nController))
 	{
-		if (!CAN_getRxMessage(0,&(msg.id),&IDisExtended,msg.data,&len))
+		elapsed = osKernelGetTickCount() - start;
+		if (elapsed >= timeout)
+			return false;
+		if (m_RxEvent == nullptr)
+		{
+			// no RX notification available, fall back to polling
+			osDelay(timeout - elapsed);
+			if (!CAN_isRxMessageAvailable(m_nController))
+				return false;
+			break;
+		}
+		// The flag is cleared on return, a frame that arrived before the wait
+		// leaves it set so that we do not miss it
+		uint32_t result = osEventFlagsWait(m_RxEvent, CANDRIVER_RX_EVENT, osFlagsWaitAny, timeout - elapsed);
+		if ((result & osFlagsError) != 0)
 			return false;
-		msg.len = len;
-		msg.format = IDisExtended ? 1 : 0;
-		return true;
 	}
-	return false;
+	if (!CAN_getRxMessage(m_nController,&(msg.id),&IDisExtended,msg.data,&len))
+		return false;
+	msg.len = len;
+	msg.format = IDisExtended ? 1 : 0;
+	return true;
 }
 
+// ----------------------------------------------------------------------------
+//! \brief Number of received frames dropped because the RX buffer was full
 uint32_t CANDriver::GetRxStatsLost()
 {
-	// TODO
-   // return CAN_rx_stats_lost(m_nController);
-	return 0;
+	return CAN_rx_stats_lost(m_nController);
 }
 
+// ----------------------------------------------------------------------------
+//! \brief High-water mark of the RX buffer
 uint32_t CANDriver::GetRxStatsMaxSize()
 {
-	// TODO
-	// return CAN_rx_stats_max_size(m_nController);
-	return 0;
+	return CAN_rx_stats_max_size(m_nController);
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Number of FlexCAN RX FIFO overflows (frames lost in hardware)
+uint32_t CANDriver::GetRxStatsFifoOverflow()
+{
+	return CAN_rx_stats_fifo_overflow(m_nController);
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Number of CAN error interrupts
+uint32_t CANDriver::GetRxStatsErrorFrames()
+{
+	return CAN_rx_stats_error_frames(m_nController);
 }
 
+// ----------------------------------------------------------------------------
+//! \brief Reset the RX statistics
 void CANDriver::ResetRxStats()
 {
-	// TODO
-	// CAN_rx_stats_reset(m_nController);
+	CAN_rx_stats_reset(m_nController);
 }
 
+// ----------------------------------------------------------------------------
+//! \brief Number of frames rejected because the TX queue was full
 uint32_t CANDriver::GetTxStatsLost()
 {
-	// TODO
-	// return CAN_tx_stats_lost(m_nController);
-	return 0;
+	return CAN_tx_stats_lost(m_nController);
 }
 
+// ----------------------------------------------------------------------------
+//! \brief High-water mark of the TX queue
 uint32_t CANDriver::GetTxStatsMaxSize()
 {
-	// TODO
-	// return CAN_tx_stats_max_size(m_nController);
-	return 0;
+	return CAN_tx_stats_max_size(m_nController);
 }
 
+// ----------------------------------------------------------------------------
+//! \brief Reset the TX statistics
 void CANDriver::ResetTxStats()
 {
-//	CAN_tx_stats_reset(m_nController);
+	CAN_tx_stats_reset(m_nController);
 }
@@ -11,6 +11,7 @@
 
 // ----------------------------------------------------------------------------
 // Includes
+#include "cmsis_os2.h"
 #include "CANDefs.h"
 #include "UCDevice.h"
 
@@ -20,6 +21,8 @@
 
 #define CAN_RX_FIFO_SIZE  CAN_No_ReceiveObjects
 
+#define CANDRIVER_RX_EVENT	0x0001	//!< Event flag set by the RX interrupt
+
 /* CAN message object structure                                              */
 typedef struct {
   uint32_t id;                 /* 29 bit identifier                               */
@@ -30,24 +33,6 @@ typedef struct {
   uint8_t  type;               /* 0 - DATA FRAME, 1 - REMOTE FRAME                */
 } CAN_msg;
 
-/*--------------------------- CAN_rx_stats ----------------------------------
- * These functions return statistics of the message queue
-*---------------------------------------------------------------------------*/
-uint32_t CAN_rx_stats_lost(uint32_t ctrl);
-uint32_t CAN_rx_stats_max_size(uint32_t ctrl);
-void CAN_rx_stats_lost_incr(uint32_t ctrl);
-void CAN_rx_stats_max_size_update(uint32_t ctrl);
-void CAN_rx_stats_reset(uint32_t ctrl);
-
-/*--------------------------- CAN_tx_stats ----------------------------------
- * These functions return statistics of the message queue
-*---------------------------------------------------------------------------*/
-uint32_t CAN_tx_stats_lost(uint32_t ctrl);
-uint32_t CAN_tx_stats_max_size(uint32_t ctrl);
-void CAN_tx_stats_lost_incr(uint32_t ctrl);
-void CAN_tx_stats_max_size_update(uint32_t ctrl);
-void CAN_tx_stats_reset(uint32_t ctrl);
-
 // ----------------------------------------------------------------------------
 //! \class      CANDriver
 //! \brief      Manage a CAN controller
@@ -73,12 +58,15 @@ public:
 	bool SendMessage(uint32_t id, uint16_t data);
 	bool SendMessage(uint32_t id, uint32_t data);
 	bool SendMessage(uint32_t id, uint32_t data1, uint32_t data2);	
+	bool SendMessage(uint32_t id, const uint8_t *data, uint8_t len);
 
 	bool ReadMessage(CAN_msg &msg);
 	bool ReadMessage(CAN_msg &msg, uint16_t timeout);
 
 	uint32_t GetRxStatsLost();
 	uint32_t GetRxStatsMaxSize();
+	uint32_t GetRxStatsFifoOverflow();
+	uint32_t GetRxStatsErrorFrames();
 	void ResetRxStats();
 
 	uint32_t GetTxStatsLost();
@@ -87,9 +75,13 @@ public:
 
 	bool AddCANid(uint32_t ID,bool isExtended = false,bool isRemote = false);
 
+private:
+	static void OnMessageReceived(unsigned channel,void *arg);
+
 private:
 	uint8_t m_nController;
 	uint16_t m_Timeout;
+	osEventFlagsId_t m_RxEvent;		//!< Signaled from the ISR when a frame has been received
 };
 
 #endif // _CANDRIVER_H_
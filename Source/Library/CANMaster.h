@@ -16,7 +16,7 @@
 #include "CANDriver.h"
 #include "CANNode.h"
 #include "Timer.h"
-#include "base.h"
+#include "Base.h"
 
 // ----------------------------------------------------------------------------
 // Constants
@@ -4,7 +4,8 @@
 //! \brief       Encapsulate the functionality of a CAN node
 //! \details     <UL><LI>Handle NMT request</LI>
 //!                  <LI>Handle SDO requests to write a value into the object dictionary</LI><
-//!                  <LI>Handle SDO requests to read  a value from the object dictionary</LI></UL>
+//!                  <LI>Handle SDO requests to read  a value from the object dictionary</LI>
+//!                  <LI>Exchange mapped object dictionary entries via RPDOs and TPDOs</LI></UL>
 //!              
 //!              \par Each CAN accessible object has a different object index
 //!              \par Each CAN accessible object must derive from ICANNodeDataProvider
@@ -21,6 +22,8 @@
 #include "CANNode.h"
 #include "ProcessData.h"
 #include "board.h"
+#include "crc.h"
+#include <string.h>
 
 static CANNode 	*CAN_Node_Ptr = nullptr;
 static bool			registered = false;
@@ -35,6 +38,8 @@ static traceString 				trcCANNode;
 // Constants
 #define CAN_TASK_PERIOD	10
 
+#define PDO_COB_ID_STEP	0x100		// Distance between the COB-IDs of PDO n and PDO n+1
+
 // ----------------------------------------------------------------------------
 //! \brief Constructor
 CANNode::CANNode(CANDriver &_driver, uint8_t _nCANId, osPriority_t _nPriority)
@@ -49,7 +54,10 @@ CANNode::CANNode(CANDriver &_driver, uint8_t _nCANId, osPriority_t _nPriority)
 	for (int i=0; i<CANNODE_MAX_OBJECTS; i++)
 		m_aDataProviders[i] = NULL;
 
-	m_ProcessDataMutex = xSemaphoreCreateMutex();
+	memset(m_aTxPdo, 0, sizeof(m_aTxPdo));
+	memset(m_aRxPdo, 0, sizeof(m_aRxPdo));
+	memset(&m_Sdo, 0, sizeof(m_Sdo));
+
 	nCanReceived = 0;
 	nCanTransmitted = 0;
 	if (!registered)
@@ -81,17 +89,30 @@ bool CANNode::RegisterDataProvider(ICANNodeDataProvider *_pProvider, uint16_t _n
 
 // ----------------------------------------------------------------------------
 //! \brief Used by data provider to declare CAN data
-template<class T> bool CANNode::DeclareData(uint16_t _nObjIndex, uint8_t _nSubIndex, ProcessDataOut<T>* &_pProcessData)
+template<class T> bool CANNode::DeclareData(uint16_t _nObjIndex, uint8_t _nSubIndex, ProcessDataOut<T>* &_pProcessData, uint8_t _nAccess)
 {
-	if (_nObjIndex >= CANNODE_MAX_OBJECTS || _nSubIndex >= CANNDOE_MAX_SUBINDEXES)
+	ObjectDictionaryEntry *pEntry = m_Dictionary.Add(_nObjIndex, _nSubIndex, CANDataType<T>::eType, sizeof(T), _nAccess);
+	if (NULL == pEntry)
 	{
 		_pProcessData = NULL;
 		return false;
 	}
-	_pProcessData = new ProcessDataOut<T>((uint8_t*)&(m_aData[_nObjIndex][_nSubIndex]), (uint8_t)sizeof(T), m_ProcessDataMutex);
+	_pProcessData = new ProcessDataOut<T>(pEntry->pData, (uint8_t)sizeof(T), &pEntry->nSeq);
 	return (NULL != _pProcessData);
 }
 
+// ----------------------------------------------------------------------------
+//! \brief Used by data provider to declare a domain object backed by a buffer
+//! \details The buffer is read by SDO uploads and, if writable, written by SDO
+//!          downloads. OnNewDataAvailable is called once a download completes.
+bool CANNode::DeclareDomain(uint16_t _nObjIndex, uint8_t _nSubIndex, uint8_t *_pData, uint32_t _nSize, bool _bWritable)
+{
+	if (NULL == _pData)
+		return false;
+	uint8_t nAccess = _bWritable ? ECANAccess_ReadWrite : ECANAccess_ReadOnly;
+	return NULL != m_Dictionary.Add(_nObjIndex, _nSubIndex, ECANDataType_Domain, _nSize, nAccess, _pData);
+}
+
 // ----------------------------------------------------------------------------
 //! \brief Get the CAN ID
 uint32_t CANNode::getCAN_ID(void)
@@ -135,11 +156,12 @@ bool CANNode::getProviderContent(unsigned id,unsigned subid,uint32_t &content,bo
 {
 	if (id >= CANNODE_MAX_OBJECTS)
 		return false;
-	if (subid >= CANNDOE_MAX_SUBINDEXES)
+	if (subid > 0xFF)
 		return false;
+	ObjectDictionaryEntry *pEntry = m_Dictionary.Find((uint16_t)id, (uint8_t)subid);
 	valid = m_aDataProviders[id] != nullptr;
-	if (valid)
-		content = m_aData[id][subid];
+	if (valid && NULL != pEntry && !pEntry->IsDomain())
+		content = pEntry->Read();
 	else
 		content = 0;
 	return true;
@@ -180,124 +202,341 @@ void CANNode::Main()
 			m_aDataProviders[nObjectIndex]->RegisterData(*this, nObjectIndex);
 		}
 	}
+
+	// Receive the RPDOs configured by the data providers
+	for (int nPdo=0; nPdo<CANNODE_MAX_PDOS; nPdo++)
+	{
+		if (!m_aRxPdo[nPdo].bEnabled)
+			continue;
+		unsigned id = (unsigned)EMessageBase_RxPDO1 + nPdo * PDO_COB_ID_STEP + m_nCANId;
+		if (m_Driver.AddCANid(id))
+			dbgprintf("CAN-ID filter added, ID = 0x%X (RPDO%d)\n",id,nPdo + 1);
+		else
+			dbgprintf("Adding CAN-ID FAILED\n");
+	}
 	
 	nCanReceived = 0;
 	nCanTransmitted = 0;
 
 	// Start the CAN controller
-	m_Driver.Start();
+	if (!m_Driver.Start())
+		dbgprintf("CAN Driver RX notification FAILED\n");
 
 	dbgprintf("CAN Task - entering Main Loop.\n");	
 	while (1)
 	{
-		CUC_Task::Wait(CAN_TASK_PERIOD);
-		// Dispatch incomming messages
+		// Dispatch incomming messages, the RX interrupt wakes us up as soon
+		// as a frame is available
 		CAN_msg msg;
-		while (m_Driver.ReadMessage(msg))
+		// Poll faster while a block upload is waiting for free TX room
+		uint16_t timeout = (ESdoState_BlockUpload == m_Sdo.eState) ? 1 : CAN_TASK_PERIOD;
+		if (m_Driver.ReadMessage(msg, timeout))
 		{
 			// Dispatch message
 			HandleMessage(msg);
 		}
+		// Event-driven TPDOs, checked at least every CAN_TASK_PERIOD
+		ProcessTxPDOs(false);
+		// Pending block upload segments and SDO timeout
+		ProcessSDO();
 	}
 }
 
 // ----------------------------------------------------------------------------
 //! \brief Handle an incomming message
+//! \details Dispatched on the CANopen function code (bits 10..7 of the COB-ID)
 bool CANNode::HandleMessage(CAN_msg &msg)
 {	
 	nCanReceived++;
-	// Handle SYNC message
-	if (msg.id == (unsigned)EMessageBase_SyncAndEmergency) 
+	bool bOwnNode = (msg.id & 0x7F) == m_nCANId;
+	switch (msg.id & 0x780)
 	{
+		// Handle NMT commands
+		case EMessageBase_NmtControl:
+		{
+			if (msg.id != (unsigned)EMessageBase_NmtControl)
+				break;
+			ENMTCommand cmd = (ENMTCommand)msg.data[0];
+			uint8_t nodeId = msg.data[1];	
+			if (nodeId == 0 || nodeId == m_nCANId)
+			{
 #ifdef DBGPRINTF_BOARDMGR
-		dbgprintf("CAN-RX (Sync): ID = %04X, Cmd = %d, Object = %d, Subindex = %d, Data = %d\n",
-					  (unsigned)EMessageBase_NmtControl + m_nCANId,0,0,0,0);
+				dbgprintf("CAN-RX (NMT Command): ID = %04X, Cmd = %d, Object = %d, Subindex = %d, Data = %d\n",
+							  (unsigned)EMessageBase_NmtControl + m_nCANId,0,0,0,0);
 #endif
 #if TRACEALYZER != 0 && TRC_CANNODE != 0
-		vTracePrint(trcCANNode,"Sync Cmd");
+				vTracePrintF(trcCANNode,"NMT Cmd: Cmd = %d",cmd);
 #endif
-		return OnSync();
-	}
+				return OnNMTCommand(cmd);
+			}
+			return true;
+		}
 
-	// Handle NMT commands
-	if (msg.id == (unsigned)EMessageBase_NmtControl)
-	{
-		ENMTCommand cmd = (ENMTCommand)msg.data[0];
-		uint8_t nodeId = msg.data[1];	
-		if (nodeId == 0 || nodeId == m_nCANId)
-		{
+		// Handle SYNC message
+		case EMessageBase_SyncAndEmergency:
+			if (msg.id != (unsigned)EMessageBase_SyncAndEmergency)
+				break;
 #ifdef DBGPRINTF_BOARDMGR
-			dbgprintf("CAN-RX (NMT Command): ID = %04X, Cmd = %d, Object = %d, Subindex = %d, Data = %d\n",
+			dbgprintf("CAN-RX (Sync): ID = %04X, Cmd = %d, Object = %d, Subindex = %d, Data = %d\n",
 						  (unsigned)EMessageBase_NmtControl + m_nCANId,0,0,0,0);
 #endif
 #if TRACEALYZER != 0 && TRC_CANNODE != 0
-			vTracePrintF(trcCANNode,"NMT Cmd: Cmd = %d",cmd);
+			vTracePrint(trcCANNode,"Sync Cmd");
 #endif
-			return OnNMTCommand(cmd);
-		}
-		return true;
-	}
+			return OnSync();
 
-	// Handle NMT requests
-	if (msg.id == (unsigned)EMessageBase_NmtMonitorng + m_nCANId)
-	{
+		// Handle RPDOs
+		case EMessageBase_RxPDO1:
+		case EMessageBase_RxPDO2:
+		case EMessageBase_RxPDO3:
+		case EMessageBase_RxPDO4:
+			if (!bOwnNode)
+				break;
+			return OnRxPDO((uint8_t)(((msg.id & 0x780) - (unsigned)EMessageBase_RxPDO1) / PDO_COB_ID_STEP), msg);
+
+		// Handle SDO download and upload requests
+		case EMessageBase_RxSDO:
+			if (!bOwnNode)
+				break;
+			return OnSDORequest(msg);
+
+		// Handle NMT requests
+		case EMessageBase_NmtMonitorng:
+			if (!bOwnNode)
+				break;
 #ifdef DBGPRINTF_BOARDMGR
-		dbgprintf("CAN-RX (NMT Request): ID = %04X, Cmd = %d, Object = %d, Subindex = %d, Data = %d\n",
-					 (unsigned)EMessageBase_NmtMonitorng + m_nCANId,0,0,0,(uint32_t)m_nNMTToggleBit);
+			dbgprintf("CAN-RX (NMT Request): ID = %04X, Cmd = %d, Object = %d, Subindex = %d, Data = %d\n",
+						 (unsigned)EMessageBase_NmtMonitorng + m_nCANId,0,0,0,(uint32_t)m_nNMTToggleBit);
 #endif
 #if TRACEALYZER != 0 && TRC_CANNODE != 0
 			vTracePrintF(trcCANNode,"NMT Request");
 #endif
-		return OnNMTRequest();
+			return OnNMTRequest();
+
+		default:
+			break;
 	}
+	return true;
+}
 
-	// Handle SDO download and upload requests
-	if (msg.id == (unsigned)EMessageBase_RxSDO + m_nCANId)
-	{
-		uint8_t nCommand = msg.data[0];
-		uint16_t nObject = msg.data[1] + (msg.data[2] << 8);
-		uint8_t nSubIndex = msg.data[3];
-		uint32_t nData = *(uint32_t*)&msg.data[4];
+// ----------------------------------------------------------------------------
+//! \brief Called by HandleMessage when a SDO request is received
+bool CANNode::OnSDORequest(CAN_msg &msg)
+{
+	uint8_t nCommand = msg.data[0];
+	uint16_t nObject = msg.data[1] + (msg.data[2] << 8);
+	uint8_t nSubIndex = msg.data[3];
+	uint32_t nData = *(uint32_t*)&msg.data[4];
 
 #ifdef DBGPRINTF_BOARDMGR
-		dbgprintf("CAN-RX (RxSDO): ID = %04X, Cmd = %d, Object = %d, Subindex = %d, Data = %04X\n",
-					 msg.id,nCommand,nObject,nSubIndex,nData);
+	dbgprintf("CAN-RX (RxSDO): ID = %04X, Cmd = %d, Object = %d, Subindex = %d, Data = %04X\n",
+				 msg.id,nCommand,nObject,nSubIndex,nData);
+#endif
+#if TRACEALYZER != 0 && TRC_CANNODE != 0
+		vTracePrintF(trcCANNode,"SDO Rx: Cmd=0x%02X, Obj=%d ,Sub=%d, Data=%d",nCommand,nObject,nSubIndex,nData);
 #endif
+	m_Sdo.nLastTime = osKernelGetTickCount();
+
+	// While a block download is running the client sends raw segments
+	if (ESdoState_BlockDownload == m_Sdo.eState)
+		return OnBlockDownloadSegment(msg);
+
+	ObjectDictionaryEntry *pEntry = NULL;
+	switch ((ESdoCcs)(nCommand >> 5))
+	{
+		case ESdoCcs_InitiateDownload:
+			pEntry = m_Dictionary.Find(nObject, nSubIndex);
+			if (NULL != pEntry && pEntry->IsDomain())
+				return OnInitiateDomainDownload(msg, pEntry);
+			switch (nCommand)
+			{
+				case 0x23:	// Initiate 4 bytes download
+					return OnDownloadRequest(nObject, nSubIndex, 4, nData);
+				case 0x27:	// Initiate 3 bytes download
+					return OnDownloadRequest(nObject, nSubIndex, 3, nData);
+				case 0x2B:	// Initiate 2 bytes download
+					return OnDownloadRequest(nObject, nSubIndex, 2, nData);
+				case 0x2F:	// Initiate 1 bytes download
+					return OnDownloadRequest(nObject, nSubIndex, 1, nData);
+				default:
+					// Segmented download is only supported by domains
+					break;
+			}
+			return SendSDOAbort(nObject, nSubIndex, ESdoAbort_LengthTooHigh);
+		case ESdoCcs_DownloadSegment:
+			return OnDownloadSegment(msg);
+		case ESdoCcs_InitiateUpload:
+			pEntry = m_Dictionary.Find(nObject, nSubIndex);
+			if (NULL != pEntry && pEntry->IsDomain())
+				return OnInitiateDomainUpload(pEntry);
+			return OnUploadRequest(nObject, nSubIndex);
+		case ESdoCcs_UploadSegment:
+			return OnUploadSegment(msg);
+		case ESdoCcs_Abort:
+			m_Sdo.eState = ESdoState_Idle;
+			return true;
+		case ESdoCcs_BlockDownload:
+			return OnBlockDownload(msg);
+		case ESdoCcs_BlockUpload:
+			return OnBlockUpload(msg);
+		default:
+			break;
+	}
+	return SendSDOAbort(nObject, nSubIndex, ESdoAbort_InvalidCommand);
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Called by HandleMessage when a SYNC message is received
+bool CANNode::OnSync()
+{
 #if TRACEALYZER != 0 && TRC_CANNODE != 0
-			vTracePrintF(trcCANNode,"SDO Rx: Cmd=0x%02X, Obj=%d ,Sub=%d, Data=%d",nCommand,nObject,nSubIndex,nData);
+		vTracePrint(trcCANNode,"Sync");
 #endif
-		switch (nCommand)
+	if (m_nNMTState != ENMTState_Operational)
+		return true;
+
+	// Apply the synchronous RPDOs received during the last cycle
+	for (int nPdo=0; nPdo<CANNODE_MAX_PDOS; nPdo++)
+	{
+		CANNodePdo &pdo = m_aRxPdo[nPdo];
+		if (pdo.bEnabled && pdo.bPending)
 		{
-			case 0x23:	// Initiate 4 bytes download
-				return OnDownloadRequest(nObject, nSubIndex, 4, nData);
-			case 0x27:	// Initiate 3 bytes download
-				return OnDownloadRequest(nObject, nSubIndex, 3, nData);
-			case 0x2B:	// Initiate 2 bytes download
-				return OnDownloadRequest(nObject, nSubIndex, 2, nData);
-			case 0x2F:	// Initiate 1 bytes download
-				return OnDownloadRequest(nObject, nSubIndex, 1, nData);
-			case 0x40:  // Initiate upload
-				return OnUploadRequest(nObject, nSubIndex);
-			default:
-				// Other types of download/upload not supported
-				break;
+			pdo.bPending = false;
+			WritePdoData(pdo);
 		}
-		return false;
 	}
 
+	// Send the synchronous TPDOs
+	ProcessTxPDOs(true);
 	return true;
 }
 
 // ----------------------------------------------------------------------------
-//! \brief Called by HandleMessage when a SYNC message is received
-bool CANNode::OnSync()
+//! \brief Called by HandleMessage when a RPDO is received
+bool CANNode::OnRxPDO(uint8_t _nPdo, CAN_msg &msg)
 {
+	CANNodePdo &pdo = m_aRxPdo[_nPdo];
+	if (!pdo.bEnabled || m_nNMTState != ENMTState_Operational)
+		return true;
+	// A RPDO shorter than its mapping is ignored
+	if (msg.len < pdo.nLen)
+		return false;
 #if TRACEALYZER != 0 && TRC_CANNODE != 0
-		vTracePrint(trcCANNode,"Sync");
+	vTracePrintF(trcCANNode,"RPDO%d",(int)_nPdo + 1);
 #endif
+	memcpy(pdo.aData, msg.data, pdo.nLen);
+	if (pdo.nTransmission <= CANNODE_PDO_SYNC_MAX)
+		pdo.bPending = true;		// Synchronous RPDO: take over at the next SYNC
+	else
+		WritePdoData(pdo);
 	return true;
 }
 
+// ----------------------------------------------------------------------------
+//! \brief Send the TPDOs that are due
+//! \details Called with _bSync set on each SYNC for the synchronous TPDOs and
+//!          without after each loop of the task for the event-driven ones.
+void CANNode::ProcessTxPDOs(bool _bSync)
+{
+	if (m_nNMTState != ENMTState_Operational)
+		return;
+
+	uint32_t now = osKernelGetTickCount();
+	for (int nPdo=0; nPdo<CANNODE_MAX_PDOS; nPdo++)
+	{
+		CANNodePdo &pdo = m_aTxPdo[nPdo];
+		if (!pdo.bEnabled || 0 == pdo.nMappings)
+			continue;
+
+		uint8_t data[8];
+		if (pdo.nTransmission <= CANNODE_PDO_SYNC_MAX)
+		{
+			if (!_bSync)
+				continue;
+			if (CANNODE_PDO_SYNC_ACYCLIC == pdo.nTransmission)
+			{
+				ReadPdoData(pdo, data);
+				if (pdo.bPending || 0 != memcmp(data, pdo.aData, pdo.nLen))
+					SendTxPDO(nPdo, data, now);
+			}
+			else if (++pdo.nSyncCounter >= pdo.nTransmission)
+			{
+				pdo.nSyncCounter = 0;
+				ReadPdoData(pdo, data);
+				SendTxPDO(nPdo, data, now);
+			}
+		}
+		else
+		{
+			if (_bSync)
+				continue;
+			uint32_t elapsed = now - pdo.nLastTime;
+			if (!pdo.bPending && elapsed < pdo.nInhibitTime)
+				continue;
+			ReadPdoData(pdo, data);
+			if (pdo.bPending || 0 != memcmp(data, pdo.aData, pdo.nLen) ||
+				 (0 != pdo.nEventTime && elapsed >= pdo.nEventTime))
+				SendTxPDO(nPdo, data, now);
+		}
+	}
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Send a TPDO and remember its payload for the change detection
+bool CANNode::SendTxPDO(uint8_t _nPdo, const uint8_t *_pData, uint32_t _nNow)
+{
+	CANNodePdo &pdo = m_aTxPdo[_nPdo];
+	memcpy(pdo.aData, _pData, pdo.nLen);
+	pdo.nLastTime = _nNow;
+	pdo.bPending = false;
+	nCanTransmitted++;
+#if TRACEALYZER != 0 && TRC_CANNODE != 0
+	vTracePrintF(trcCANNode,"TPDO%d",(int)_nPdo + 1);
+#endif
+	return m_Driver.SendMessage((unsigned)EMessageBase_TxPDO1 + _nPdo * PDO_COB_ID_STEP + m_nCANId,
+										 pdo.aData, pdo.nLen);
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Collect the mapped bytes of a PDO, returns the PDO length
+uint8_t CANNode::ReadPdoData(CANNodePdo &_pdo, uint8_t *_pData)
+{
+	uint8_t nPos = 0;
+	for (int i=0; i<_pdo.nMappings; i++)
+	{
+		CANNodePdoMapping &map = _pdo.aMapping[i];
+		uint32_t value = map.pEntry->Read();
+		memcpy(&_pData[nPos], &value, map.nBytes);
+		nPos += map.nBytes;
+	}
+	return nPos;
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Store the payload of a received RPDO into the mapped entries
+void CANNode::WritePdoData(CANNodePdo &_pdo)
+{
+	uint8_t nPos = 0;
+	for (int i=0; i<_pdo.nMappings; i++)
+	{
+		CANNodePdoMapping &map = _pdo.aMapping[i];
+		uint32_t value = 0;
+		memcpy(&value, &_pdo.aData[nPos], map.nBytes);
+		map.pEntry->Write(value);
+		nPos += map.nBytes;
+	}
+
+	// Notify the providers once all mapped entries are updated
+	for (int i=0; i<_pdo.nMappings; i++)
+	{
+		ObjectDictionaryEntry *pEntry = _pdo.aMapping[i].pEntry;
+		if (pEntry->nObjectIndex >= CANNODE_MAX_OBJECTS)
+			continue;
+		ICANNodeDataProvider *pProvider = m_aDataProviders[pEntry->nObjectIndex];
+		if (NULL != pProvider) pProvider->OnNewDataAvailable(pEntry->nSubIndex);
+	}
+}
+
 // ----------------------------------------------------------------------------
 //! \brief Called by HandleMessage when a NMT request is received
 bool CANNode::OnNMTRequest()
@@ -364,12 +603,13 @@ bool CANNode::OnNMTCommand(ENMTCommand cmd)
 //! \brief Called by HandleMessage when a SDO upload request is received
 bool CANNode::OnUploadRequest(uint16_t _nObjIndex, uint8_t _nSubIndex)
 {
-	uint8_t nDataLen = 4;
-	uint32_t data = 0;
-	if (_nObjIndex < CANNODE_MAX_OBJECTS && _nSubIndex < CANNDOE_MAX_SUBINDEXES)
-	{
-		data = m_aData[_nObjIndex][_nSubIndex];
-	}
+	ObjectDictionaryEntry *pEntry = m_Dictionary.Find(_nObjIndex, _nSubIndex);
+	if (NULL == pEntry)
+		return SendSDOAbort(_nObjIndex, _nSubIndex, ESdoAbort_NoObject);
+	if (!pEntry->IsReadable())
+		return SendSDOAbort(_nObjIndex, _nSubIndex, ESdoAbort_WriteOnly);
+	uint8_t nDataLen = (uint8_t)pEntry->nSize;
+	uint32_t data = pEntry->Read() & (0xFFFFFFFFu >> ((4 - nDataLen) * 8));
 	uint32_t cmd;
 	uint8_t  h_cmd;
 	cmd = h_cmd = (unsigned)ESdoCommand_ReadResponse4Bytes + ((4-nDataLen) << 2);
@@ -392,9 +632,17 @@ bool CANNode::OnUploadRequest(uint16_t _nObjIndex, uint8_t _nSubIndex)
 //! \brief Called by HandleMessage when a SDO download request is received
 bool CANNode::OnDownloadRequest(uint16_t _nObjIndex, uint8_t _nSubIndex, uint8_t _nDataLen, uint32_t _nData)
 {
-	if (_nObjIndex < CANNODE_MAX_OBJECTS && _nSubIndex < CANNDOE_MAX_SUBINDEXES)
+	ObjectDictionaryEntry *pEntry = m_Dictionary.Find(_nObjIndex, _nSubIndex);
+	if (NULL == pEntry)
+		return SendSDOAbort(_nObjIndex, _nSubIndex, ESdoAbort_NoObject);
+	if (!pEntry->IsWritable())
+		return SendSDOAbort(_nObjIndex, _nSubIndex, ESdoAbort_ReadOnly);
+	// Accept wider downloads as long as the value fits the entry
+	if (_nDataLen > pEntry->nSize && (_nData >> (pEntry->nSize * 8)) != 0)
+		return SendSDOAbort(_nObjIndex, _nSubIndex, ESdoAbort_LengthTooHigh);
+	pEntry->Write(_nData & (0xFFFFFFFFu >> ((4 - pEntry->nSize) * 8)));
+	if (_nObjIndex < CANNODE_MAX_OBJECTS)
 	{
-		m_aData[_nObjIndex][_nSubIndex] = _nData;
 		ICANNodeDataProvider *pProvider = m_aDataProviders[_nObjIndex];
 		if (NULL != pProvider) pProvider->OnNewDataAvailable(_nSubIndex);
 	}
@@ -416,6 +664,414 @@ bool CANNode::OnDownloadRequest(uint16_t _nObjIndex, uint8_t _nSubIndex, uint8_t
 	return m_Driver.SendMessage((unsigned)EMessageBase_TxSDO + m_nCANId, cmd);
 }
 
+// ----------------------------------------------------------------------------
+//! \brief Send a 8 bytes SDO response
+bool CANNode::SendSDO(uint8_t *_pData)
+{
+	nCanTransmitted++;
+	return m_Driver.SendMessage((unsigned)EMessageBase_TxSDO + m_nCANId, _pData, 8);
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Send a SDO abort and terminate the transfer in progress
+bool CANNode::SendSDOAbort(uint16_t _nObjIndex, uint8_t _nSubIndex, uint32_t _nCode)
+{
+	uint8_t data[8];
+	data[0] = (uint8_t)ESdoCommand_ErrorResponse;
+	data[1] = (uint8_t)_nObjIndex;
+	data[2] = (uint8_t)(_nObjIndex >> 8);
+	data[3] = _nSubIndex;
+	memcpy(&data[4], &_nCode, 4);
+	m_Sdo.eState = ESdoState_Idle;
+#if TRACEALYZER != 0 && TRC_CANNODE != 0
+	vTracePrintF(trcCANNode,"SDO Abort: ObjID=%X,SubID=%X,Code=%X",(unsigned)_nObjIndex,
+		(unsigned)_nSubIndex,(unsigned)_nCode);
+#endif
+	SendSDO(data);
+	return false;
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Abort the domain transfer in progress
+bool CANNode::AbortSDO(uint32_t _nCode)
+{
+	if (NULL == m_Sdo.pDomain)
+		return SendSDOAbort(0, 0, _nCode);
+	return SendSDOAbort(m_Sdo.pDomain->nObjectIndex, m_Sdo.pDomain->nSubIndex, _nCode);
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Expedited, segmented or block download of a domain is complete
+void CANNode::EndDomainDownload(uint32_t _nLen)
+{
+	ObjectDictionaryEntry *pDomain = m_Sdo.pDomain;
+	m_Sdo.eState = ESdoState_Idle;
+#if TRACEALYZER != 0 && TRC_CANNODE != 0
+	vTracePrintF(trcCANNode,"SDO Domain Dwl.: ObjID=%X,SubID=%X,Len=%d",(unsigned)pDomain->nObjectIndex,
+		(unsigned)pDomain->nSubIndex,(int)_nLen);
+#endif
+	if (pDomain->nObjectIndex < CANNODE_MAX_OBJECTS)
+	{
+		ICANNodeDataProvider *pProvider = m_aDataProviders[pDomain->nObjectIndex];
+		if (NULL != pProvider) pProvider->OnNewDataAvailable(pDomain->nSubIndex);
+	}
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Initiate an expedited or segmented download into a domain
+bool CANNode::OnInitiateDomainDownload(CAN_msg &msg, ObjectDictionaryEntry *_pDomain)
+{
+	uint8_t nCommand = msg.data[0];
+	uint32_t nSize = 0;
+	if (nCommand & 0x01)
+		memcpy(&nSize, &msg.data[4], 4);
+
+	m_Sdo.pDomain = _pDomain;
+	if (!_pDomain->IsWritable())
+		return AbortSDO(ESdoAbort_ReadOnly);
+
+	uint8_t data[8];
+	memcpy(data, msg.data, 4);
+	memset(&data[4], 0, 4);
+	data[0] = (uint8_t)ESdoCommand_WriteResponse;
+
+	if (nCommand & 0x02)
+	{
+		// Expedited: 4 - n bytes in the frame
+		uint32_t nLen = (nCommand & 0x01) ? 4 - ((nCommand >> 2) & 0x03) : 4;
+		if (nLen > _pDomain->nSize)
+			return AbortSDO(ESdoAbort_LengthTooHigh);
+		memcpy(_pDomain->pData, &msg.data[4], nLen);
+		SendSDO(data);
+		EndDomainDownload(nLen);
+		return true;
+	}
+
+	// Segmented
+	if (nSize > _pDomain->nSize)
+		return AbortSDO(ESdoAbort_LengthTooHigh);
+	m_Sdo.eState = ESdoState_DownloadSegment;
+	m_Sdo.nSize = nSize;
+	m_Sdo.nPos = 0;
+	m_Sdo.nToggle = 0;
+	return SendSDO(data);
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Segment of a segmented download
+bool CANNode::OnDownloadSegment(CAN_msg &msg)
+{
+	uint8_t nCommand = msg.data[0];
+	if (ESdoState_DownloadSegment != m_Sdo.eState)
+		return AbortSDO(ESdoAbort_InvalidCommand);
+	if (((nCommand >> 4) & 0x01) != m_Sdo.nToggle)
+		return AbortSDO(ESdoAbort_ToggleBit);
+
+	uint32_t nLen = 7 - ((nCommand >> 1) & 0x07);
+	if (m_Sdo.nPos + nLen > m_Sdo.pDomain->nSize)
+		return AbortSDO(ESdoAbort_LengthTooHigh);
+	memcpy(&m_Sdo.pDomain->pData[m_Sdo.nPos], &msg.data[1], nLen);
+	m_Sdo.nPos += nLen;
+
+	bool bLast = (nCommand & 0x01) != 0;
+	if (bLast && 0 != m_Sdo.nSize && m_Sdo.nPos != m_Sdo.nSize)
+		return AbortSDO(ESdoAbort_LengthMismatch);
+
+	uint8_t data[8];
+	memset(data, 0, sizeof(data));
+	data[0] = (uint8_t)(0x20 | (m_Sdo.nToggle << 4));
+	m_Sdo.nToggle ^= 1;
+	bool bOk = SendSDO(data);
+	if (bLast)
+		EndDomainDownload(m_Sdo.nPos);
+	return bOk;
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Initiate an expedited or segmented upload of a domain
+bool CANNode::OnInitiateDomainUpload(ObjectDictionaryEntry *_pDomain)
+{
+	uint8_t data[8];
+	data[1] = (uint8_t)_pDomain->nObjectIndex;
+	data[2] = (uint8_t)(_pDomain->nObjectIndex >> 8);
+	data[3] = _pDomain->nSubIndex;
+	memset(&data[4], 0, 4);
+
+	m_Sdo.pDomain = _pDomain;
+	if (_pDomain->nSize <= 4)
+	{
+		// Expedited, size indicated
+		data[0] = (uint8_t)(ESdoCommand_ReadResponse4Bytes + ((4 - _pDomain->nSize) << 2));
+		memcpy(&data[4], _pDomain->pData, _pDomain->nSize);
+		m_Sdo.eState = ESdoState_Idle;
+		return SendSDO(data);
+	}
+
+	// Segmented, size indicated
+	data[0] = 0x41;
+	memcpy(&data[4], &_pDomain->nSize, 4);
+	m_Sdo.eState = ESdoState_UploadSegment;
+	m_Sdo.nSize = _pDomain->nSize;
+	m_Sdo.nPos = 0;
+	m_Sdo.nToggle = 0;
+	return SendSDO(data);
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Segment request of a segmented upload
+bool CANNode::OnUploadSegment(CAN_msg &msg)
+{
+	if (ESdoState_UploadSegment != m_Sdo.eState)
+		return AbortSDO(ESdoAbort_InvalidCommand);
+	if (((msg.data[0] >> 4) & 0x01) != m_Sdo.nToggle)
+		return AbortSDO(ESdoAbort_ToggleBit);
+
+	uint32_t nLen = m_Sdo.nSize - m_Sdo.nPos;
+	if (nLen > 7)
+		nLen = 7;
+	bool bLast = (m_Sdo.nPos + nLen) >= m_Sdo.nSize;
+
+	uint8_t data[8];
+	memset(data, 0, sizeof(data));
+	data[0] = (uint8_t)((m_Sdo.nToggle << 4) | ((7 - nLen) << 1) | (bLast ? 0x01 : 0));
+	memcpy(&data[1], &m_Sdo.pDomain->pData[m_Sdo.nPos], nLen);
+	m_Sdo.nPos += nLen;
+	m_Sdo.nToggle ^= 1;
+	if (bLast)
+		m_Sdo.eState = ESdoState_Idle;
+	return SendSDO(data);
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Initiate and end commands of a block download
+bool CANNode::OnBlockDownload(CAN_msg &msg)
+{
+	uint8_t nCommand = msg.data[0];
+	uint8_t data[8];
+	memset(data, 0, sizeof(data));
+
+	if (0 == (nCommand & 0x01))
+	{
+		// Initiate
+		uint16_t nObject = msg.data[1] + (msg.data[2] << 8);
+		ObjectDictionaryEntry *pDomain = m_Dictionary.Find(nObject, msg.data[3]);
+		if (NULL == pDomain)
+			return SendSDOAbort(nObject, msg.data[3], ESdoAbort_NoObject);
+		if (!pDomain->IsDomain())
+			return SendSDOAbort(nObject, msg.data[3], ESdoAbort_InvalidCommand);
+		m_Sdo.pDomain = pDomain;
+		if (!pDomain->IsWritable())
+			return AbortSDO(ESdoAbort_ReadOnly);
+		m_Sdo.nSize = 0;
+		if (nCommand & 0x02)
+			memcpy(&m_Sdo.nSize, &msg.data[4], 4);
+		if (m_Sdo.nSize > pDomain->nSize)
+			return AbortSDO(ESdoAbort_LengthTooHigh);
+		m_Sdo.eState = ESdoState_BlockDownload;
+		m_Sdo.bCrc = (nCommand & 0x04) != 0;
+		m_Sdo.bLast = false;
+		m_Sdo.nPos = 0;
+		m_Sdo.nSeqNo = 0;
+		m_Sdo.nBlockSize = CANNODE_SDO_BLOCK_SIZE;
+		data[0] = 0xA4;			// CRC supported
+		memcpy(&data[1], &msg.data[1], 3);
+		data[4] = m_Sdo.nBlockSize;
+		return SendSDO(data);
+	}
+
+	// End: n bytes of the last segment did not contain data
+	if (ESdoState_BlockDownloadEnd != m_Sdo.eState)
+		return AbortSDO(ESdoAbort_InvalidCommand);
+	uint32_t nUnused = (nCommand >> 2) & 0x07;
+	if (nUnused > m_Sdo.nPos)
+		return AbortSDO(ESdoAbort_LengthMismatch);
+	uint32_t nLen = m_Sdo.nPos - nUnused;
+	if (nLen > m_Sdo.pDomain->nSize)
+		return AbortSDO(ESdoAbort_LengthTooHigh);
+	if (0 != m_Sdo.nSize && nLen != m_Sdo.nSize)
+		return AbortSDO(ESdoAbort_LengthMismatch);
+	if (m_Sdo.bCrc)
+	{
+		uint16_t nCrc = msg.data[1] + (msg.data[2] << 8);
+		if (nCrc != CRC_Calc16(0, m_Sdo.pDomain->pData, nLen))
+			return AbortSDO(ESdoAbort_CRCError);
+	}
+	data[0] = 0xA1;
+	bool bOk = SendSDO(data);
+	EndDomainDownload(nLen);
+	return bOk;
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Segment of a block download
+//! \details Segments out of sequence are dropped; the acknowledge sent at the
+//!          end of the block reports the last segment received in sequence so
+//!          that the client repeats the missing ones.
+bool CANNode::OnBlockDownloadSegment(CAN_msg &msg)
+{
+	uint8_t nSeqNo = msg.data[0] & 0x7F;
+	bool bLast = (msg.data[0] & 0x80) != 0;
+
+	// An abort of the client reads as last segment 0: it is told apart by the
+	// index and sub-index of the transfer and is not answered
+	if ((uint8_t)ESdoCommand_ErrorResponse == msg.data[0] &&
+		 msg.data[1] + (msg.data[2] << 8) == m_Sdo.pDomain->nObjectIndex &&
+		 msg.data[3] == m_Sdo.pDomain->nSubIndex)
+	{
+		m_Sdo.eState = ESdoState_Idle;
+		return true;
+	}
+	if (0 == nSeqNo || nSeqNo > m_Sdo.nBlockSize)
+		return AbortSDO(ESdoAbort_InvalidSequence);
+	if (nSeqNo == m_Sdo.nSeqNo + 1)
+	{
+		// Bytes beyond the domain are only allowed as padding of the last segment
+		uint32_t nLen = 7;
+		if (m_Sdo.nPos + nLen > m_Sdo.pDomain->nSize)
+		{
+			if (!bLast)
+				return AbortSDO(ESdoAbort_LengthTooHigh);
+			nLen = m_Sdo.pDomain->nSize - m_Sdo.nPos;
+		}
+		memcpy(&m_Sdo.pDomain->pData[m_Sdo.nPos], &msg.data[1], nLen);
+		m_Sdo.nPos += 7;
+		m_Sdo.nSeqNo = nSeqNo;
+		m_Sdo.bLast = bLast;
+	}
+	if (nSeqNo < m_Sdo.nBlockSize && !bLast)
+		return true;
+
+	// End of block: acknowledge the segments received in sequence
+	uint8_t data[8];
+	memset(data, 0, sizeof(data));
+	data[0] = 0xA2;
+	data[1] = m_Sdo.nSeqNo;
+	data[2] = m_Sdo.nBlockSize;
+	m_Sdo.nSeqNo = 0;
+	if (m_Sdo.bLast)
+		m_Sdo.eState = ESdoState_BlockDownloadEnd;
+	return SendSDO(data);
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Commands of a block upload
+bool CANNode::OnBlockUpload(CAN_msg &msg)
+{
+	uint8_t nCommand = msg.data[0];
+	uint8_t data[8];
+	memset(data, 0, sizeof(data));
+
+	switch (nCommand & 0x03)
+	{
+		case 0:	// Initiate
+		{
+			uint16_t nObject = msg.data[1] + (msg.data[2] << 8);
+			ObjectDictionaryEntry *pDomain = m_Dictionary.Find(nObject, msg.data[3]);
+			if (NULL == pDomain)
+				return SendSDOAbort(nObject, msg.data[3], ESdoAbort_NoObject);
+			if (!pDomain->IsDomain())
+				return SendSDOAbort(nObject, msg.data[3], ESdoAbort_InvalidCommand);
+			m_Sdo.pDomain = pDomain;
+			if (!pDomain->IsReadable())
+				return AbortSDO(ESdoAbort_WriteOnly);
+			if (0 == msg.data[4] || msg.data[4] > 127)
+				return AbortSDO(ESdoAbort_InvalidBlockSize);
+			m_Sdo.eState = ESdoState_BlockUploadInitiated;
+			m_Sdo.bCrc = (nCommand & 0x04) != 0;
+			m_Sdo.bLast = false;
+			m_Sdo.nBlockSize = msg.data[4];
+			m_Sdo.nSize = pDomain->nSize;
+			m_Sdo.nPos = 0;
+			m_Sdo.nSeqNo = 0;
+			data[0] = 0xC6;		// CRC supported, size indicated
+			memcpy(&data[1], &msg.data[1], 3);
+			memcpy(&data[4], &m_Sdo.nSize, 4);
+			return SendSDO(data);
+		}
+		case 3:	// Start
+			if (ESdoState_BlockUploadInitiated != m_Sdo.eState)
+				return AbortSDO(ESdoAbort_InvalidCommand);
+			m_Sdo.eState = ESdoState_BlockUpload;
+			SendUploadBlock();
+			return true;
+		case 2:	// Block acknowledge
+		{
+			if (ESdoState_BlockUpload != m_Sdo.eState)
+				return AbortSDO(ESdoAbort_InvalidCommand);
+			uint8_t nAckSeq = msg.data[1];
+			if (nAckSeq > m_Sdo.nSeqNo)
+				return AbortSDO(ESdoAbort_InvalidSequence);
+			if (0 == msg.data[2] || msg.data[2] > 127)
+				return AbortSDO(ESdoAbort_InvalidBlockSize);
+			// Continue after the last segment received by the client
+			m_Sdo.nPos += nAckSeq * 7;
+			m_Sdo.nBlockSize = msg.data[2];
+			m_Sdo.nSeqNo = 0;
+			m_Sdo.bLast = false;
+			if (m_Sdo.nPos >= m_Sdo.nSize)
+			{
+				// All data acknowledged, send the end with the CRC
+				uint16_t nCrc = m_Sdo.bCrc ? CRC_Calc16(0, m_Sdo.pDomain->pData, m_Sdo.nSize) : 0;
+				data[0] = (uint8_t)(0xC1 | (((7 - m_Sdo.nSize % 7) % 7) << 2));
+				data[1] = (uint8_t)nCrc;
+				data[2] = (uint8_t)(nCrc >> 8);
+				m_Sdo.eState = ESdoState_BlockUploadEnd;
+				return SendSDO(data);
+			}
+			SendUploadBlock();
+			return true;
+		}
+		case 1:	// End
+			if (ESdoState_BlockUploadEnd != m_Sdo.eState)
+				return AbortSDO(ESdoAbort_InvalidCommand);
+			m_Sdo.eState = ESdoState_Idle;
+			return true;
+		default:
+			break;
+	}
+	return AbortSDO(ESdoAbort_InvalidCommand);
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Queue the segments of the current upload block
+//! \details Stops as soon as the CAN TX queue is full, ProcessSDO resumes
+//!          from the main loop.
+void CANNode::SendUploadBlock(void)
+{
+	while (!m_Sdo.bLast && m_Sdo.nSeqNo < m_Sdo.nBlockSize)
+	{
+		uint32_t nOffset = m_Sdo.nPos + m_Sdo.nSeqNo * 7;
+		uint32_t nLen = m_Sdo.nSize - nOffset;
+		if (nLen > 7)
+			nLen = 7;
+		bool bLast = (nOffset + nLen) >= m_Sdo.nSize;
+
+		uint8_t data[8];
+		memset(data, 0, sizeof(data));
+		data[0] = (uint8_t)((m_Sdo.nSeqNo + 1) | (bLast ? 0x80 : 0));
+		memcpy(&data[1], &m_Sdo.pDomain->pData[nOffset], nLen);
+		if (!SendSDO(data))
+			return;
+		m_Sdo.nSeqNo++;
+		m_Sdo.bLast = bLast;
+	}
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Resume block uploads and abort transfers the client gave up
+void CANNode::ProcessSDO(void)
+{
+	if (ESdoState_Idle == m_Sdo.eState)
+		return;
+	if (osKernelGetTickCount() - m_Sdo.nLastTime > CANNODE_SDO_TIMEOUT)
+	{
+		AbortSDO(ESdoAbort_Timeout);
+		return;
+	}
+	if (ESdoState_BlockUpload == m_Sdo.eState)
+		SendUploadBlock();
+}
+
 // ----------------------------------------------------------------------------
 //! \brief Gets the CAN Node TX- and RX counter
 bool CANNode::GetCAN_Counters(int *TX_ctr,int *RX_ctr)
@@ -425,11 +1081,89 @@ bool CANNode::GetCAN_Counters(int *TX_ctr,int *RX_ctr)
 	return true;
 }
 
+// ----------------------------------------------------------------------------
+//! \brief Set the communication parameters of TPDO1..4
+//! \details _nTransmission: 0 = on SYNC when changed, 1..240 = every n-th SYNC,
+//!          254/255 = event-driven on change, limited by _nInhibitTime [ms]
+//!          and repeated after _nEventTime [ms] if not 0.
+bool CANNode::ConfigureTxPDO(uint8_t _nPdo, uint8_t _nTransmission, uint16_t _nInhibitTime, uint16_t _nEventTime)
+{
+	if (_nPdo < 1 || _nPdo > CANNODE_MAX_PDOS)
+		return false;
+	if (_nTransmission > CANNODE_PDO_SYNC_MAX && _nTransmission < CANNODE_PDO_EVENT_MANUFACTURER)
+		return false;
+	CANNodePdo &pdo = m_aTxPdo[_nPdo - 1];
+	pdo.nTransmission = _nTransmission;
+	pdo.nInhibitTime = _nInhibitTime;
+	pdo.nEventTime = _nEventTime;
+	pdo.nSyncCounter = 0;
+	pdo.nLastTime = osKernelGetTickCount();
+	pdo.bPending = true;
+	pdo.bEnabled = true;
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Append an object dictionary entry to the mapping of TPDO1..4
+bool CANNode::MapTxPDO(uint8_t _nPdo, uint16_t _nObjIndex, uint8_t _nSubIndex, uint8_t _nBytes)
+{
+	if (_nPdo < 1 || _nPdo > CANNODE_MAX_PDOS)
+		return false;
+	return AddPdoMapping(m_aTxPdo[_nPdo - 1], _nObjIndex, _nSubIndex, _nBytes, ECANAccess_ReadOnly);
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Set the communication parameters of RPDO1..4
+//! \details _nTransmission: 0..240 = take over at the next SYNC,
+//!          254/255 = take over on reception.
+//!          Must be called from RegisterData, the CAN filters are set up afterwards.
+bool CANNode::ConfigureRxPDO(uint8_t _nPdo, uint8_t _nTransmission)
+{
+	if (_nPdo < 1 || _nPdo > CANNODE_MAX_PDOS)
+		return false;
+	if (_nTransmission > CANNODE_PDO_SYNC_MAX && _nTransmission < CANNODE_PDO_EVENT_MANUFACTURER)
+		return false;
+	CANNodePdo &pdo = m_aRxPdo[_nPdo - 1];
+	pdo.nTransmission = _nTransmission;
+	pdo.bPending = false;
+	pdo.bEnabled = true;
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Append an object dictionary entry to the mapping of RPDO1..4
+bool CANNode::MapRxPDO(uint8_t _nPdo, uint16_t _nObjIndex, uint8_t _nSubIndex, uint8_t _nBytes)
+{
+	if (_nPdo < 1 || _nPdo > CANNODE_MAX_PDOS)
+		return false;
+	return AddPdoMapping(m_aRxPdo[_nPdo - 1], _nObjIndex, _nSubIndex, _nBytes, ECANAccess_WriteOnly);
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Append a mapping entry, a PDO carries at most 8 bytes
+//! \details The entry must have been declared and grant the access needed
+//!          by the PDO direction (_nAccess).
+bool CANNode::AddPdoMapping(CANNodePdo &_pdo, uint16_t _nObjIndex, uint8_t _nSubIndex, uint8_t _nBytes, uint8_t _nAccess)
+{
+	ObjectDictionaryEntry *pEntry = m_Dictionary.Find(_nObjIndex, _nSubIndex);
+	if (NULL == pEntry || pEntry->IsDomain() || (pEntry->nAccess & _nAccess) != _nAccess)
+		return false;
+	if (_nBytes < 1 || _nBytes > pEntry->nSize)
+		return false;
+	if (_pdo.nMappings >= CANNODE_MAX_PDO_MAPPINGS || _pdo.nLen + _nBytes > sizeof(_pdo.aData))
+		return false;
+	CANNodePdoMapping &map = _pdo.aMapping[_pdo.nMappings++];
+	map.pEntry = pEntry;
+	map.nBytes = _nBytes;
+	_pdo.nLen += _nBytes;
+	return true;
+}
+
 // ----------------------------------------------------------------------------
 // Instanciate all the templates we'll be using...
-template bool CANNode::DeclareData(uint16_t _nObjIndex, uint8_t _nSubIndex, ProcessDataOut<uint8_t>*&);
-template bool CANNode::DeclareData(uint16_t _nObjIndex, uint8_t _nSubIndex, ProcessDataOut<uint16_t>*&);
-template bool CANNode::DeclareData(uint16_t _nObjIndex, uint8_t _nSubIndex, ProcessDataOut<uint32_t>*&);
+template bool CANNode::DeclareData(uint16_t _nObjIndex, uint8_t _nSubIndex, ProcessDataOut<uint8_t>*&, uint8_t);
+template bool CANNode::DeclareData(uint16_t _nObjIndex, uint8_t _nSubIndex, ProcessDataOut<uint16_t>*&, uint8_t);
+template bool CANNode::DeclareData(uint16_t _nObjIndex, uint8_t _nSubIndex, ProcessDataOut<uint32_t>*&, uint8_t);
 
 // ----------------------------------------------------------------------------
 //! \brief Get the CAN Node TX- and RX counter
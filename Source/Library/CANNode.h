@@ -4,7 +4,9 @@
 //! \brief       Encapsulate the functionality of a CAN node
 //! \details     <UL><LI>Handle NMT request</LI>
 //!                  <LI>Handle SDO requests to write a value into the object dictionary</LI><
-//!                  <LI>Handle SDO requests to read  a value from the object dictionary</LI></UL>
+//!                  <LI>Handle SDO requests to read  a value from the object dictionary</LI>
+//!                  <LI>Handle segmented and block SDO transfers of domain objects</LI>
+//!                  <LI>Exchange mapped object dictionary entries via RPDOs and TPDOs</LI></UL>
 //!              
 //!              \par Each CAN accessible object has a different object index
 //!              \par Each CAN accessible object must derive from ICANNodeDataProvider
@@ -12,6 +14,9 @@
 //!              \par CAN data are	exchanged via instances of ProcessData
 //!              \par When starting CANNode call the RegisterData method of each registered object to let them create associated ProcessData instances
 //!              \par When a CAN message modifies a CAN data the OnNewDataAvailable method of the corresponding object is called
+//!              \par Entries live in a sorted ObjectDictionary with per-entry data type and access rights
+//!              \par Data providers may declare domain objects pointing at large buffers with DeclareDomain
+//!              \par Data providers may map their CAN data to PDOs from RegisterData using ConfigureTxPDO/MapTxPDO and ConfigureRxPDO/MapRxPDO
 //! 
 //! \copyright   Copyright (C) 2011-2012 BlueBotics SA
 // ----------------------------------------------------------------------------
@@ -25,13 +30,24 @@
 #include "cmsis_os2.h"
 #include "CANDefs.h"
 #include "CANDriver.h"
-#include "base.h"
+#include "Base.h"
 #include "Task_CMSIS2.h"
+#include "ObjectDictionary.h"
 
 // ----------------------------------------------------------------------------
 // Constants
 #define CANNODE_MAX_OBJECTS 3
-#define CANNDOE_MAX_SUBINDEXES 16
+
+#define CANNODE_MAX_PDOS 4					//!< Number of RPDOs and of TPDOs (PDO1..PDO4)
+#define CANNODE_MAX_PDO_MAPPINGS 8			//!< Mapping entries per PDO
+
+#define CANNODE_PDO_SYNC_ACYCLIC 0			//!< Transmission type: on SYNC, only when the data changed
+#define CANNODE_PDO_SYNC_MAX 240				//!< Transmission type 1..240: on every n-th SYNC
+#define CANNODE_PDO_EVENT_MANUFACTURER 254	//!< Transmission type: event-driven (change of data or event timer)
+#define CANNODE_PDO_EVENT_PROFILE 255		//!< Transmission type: event-driven (change of data or event timer)
+
+#define CANNODE_SDO_BLOCK_SIZE 32			//!< Segments per block requested for block downloads (1..127)
+#define CANNODE_SDO_TIMEOUT 1000				//!< [ms] an idle segmented/block transfer is aborted after this time
 
 // ----------------------------------------------------------------------------
 // Forward declarations
@@ -60,6 +76,64 @@ struct CANNodeDataProvider
 	ICANNodeDataProvider *pProvider;
 };
 
+// ----------------------------------------------------------------------------
+//! \struct     CANNodePdoMapping
+//! \brief      One object dictionary entry mapped into a PDO
+struct CANNodePdoMapping
+{
+	ObjectDictionaryEntry *pEntry;
+	uint8_t nBytes;
+};
+
+// ----------------------------------------------------------------------------
+//! \struct     CANNodePdo
+//! \brief      Communication and mapping parameters of a RPDO or TPDO
+struct CANNodePdo
+{
+	bool bEnabled;
+	bool bPending;								//!< RPDO received and waiting for SYNC / TPDO never sent yet
+	uint8_t nTransmission;					//!< CANopen transmission type
+	uint8_t nSyncCounter;
+	uint16_t nInhibitTime;					//!< [ms] minimum time between two TPDOs
+	uint16_t nEventTime;						//!< [ms] TPDO event timer, 0 = disabled
+	uint32_t nLastTime;						//!< Tick of the last transmission
+	uint8_t nLen;								//!< Number of mapped bytes
+	uint8_t nMappings;
+	uint8_t aData[8];							//!< Last sent (TPDO) or received (RPDO) payload
+	CANNodePdoMapping aMapping[CANNODE_MAX_PDO_MAPPINGS];
+};
+
+// ----------------------------------------------------------------------------
+//! \brief State of the SDO server
+typedef enum
+{
+	ESdoState_Idle = 0,
+	ESdoState_DownloadSegment,
+	ESdoState_UploadSegment,
+	ESdoState_BlockDownload,
+	ESdoState_BlockDownloadEnd,
+	ESdoState_BlockUploadInitiated,
+	ESdoState_BlockUpload,
+	ESdoState_BlockUploadEnd
+} ESdoState;
+
+// ----------------------------------------------------------------------------
+//! \struct     CANNodeSdoTransfer
+//! \brief      Segmented or block SDO transfer in progress
+struct CANNodeSdoTransfer
+{
+	ESdoState eState;
+	ObjectDictionaryEntry *pDomain;
+	uint32_t nSize;							//!< Indicated transfer size, 0 = not indicated
+	uint32_t nPos;								//!< Bytes transferred so far / start of the current upload block
+	uint8_t nToggle;
+	bool bCrc;									//!< Block transfer protected by a CRC
+	bool bLast;									//!< Last segment received / sent
+	uint8_t nBlockSize;
+	uint8_t nSeqNo;							//!< Last segment received / sent in the current block
+	uint32_t nLastTime;						//!< Tick of the last SDO frame received
+};
+
 // ----------------------------------------------------------------------------
 //! \class      CANNode
 //! \brief      Encapsulate the functionality of a CAN node
@@ -75,7 +149,9 @@ public:
 public:			
 	virtual void Main();
 	bool RegisterDataProvider(ICANNodeDataProvider *_pProvider, uint16_t _nObjIndex);
-	template<class T> bool DeclareData(uint16_t _nObjIndex, uint8_t _nSubIndex, ProcessDataOut<T>* &_pProcessData);
+	template<class T> bool DeclareData(uint16_t _nObjIndex, uint8_t _nSubIndex, ProcessDataOut<T>* &_pProcessData,
+											 uint8_t _nAccess = ECANAccess_ReadWrite);
+	bool DeclareDomain(uint16_t _nObjIndex, uint8_t _nSubIndex, uint8_t *_pData, uint32_t _nSize, bool _bWritable);
 	uint32_t getCAN_ID(void);
 	uint32_t getNMT_State(void);
 	int getNumberOfProvider(void);
@@ -83,10 +159,35 @@ public:
 	bool getProviderContent(unsigned id,unsigned subid,uint32_t &content,bool &valid);
 	bool GetCAN_Counters(int *TX_ctr,int *RX_ctr);
 
+	bool ConfigureTxPDO(uint8_t _nPdo, uint8_t _nTransmission, uint16_t _nInhibitTime = 0, uint16_t _nEventTime = 0);
+	bool MapTxPDO(uint8_t _nPdo, uint16_t _nObjIndex, uint8_t _nSubIndex, uint8_t _nBytes);
+	bool ConfigureRxPDO(uint8_t _nPdo, uint8_t _nTransmission);
+	bool MapRxPDO(uint8_t _nPdo, uint16_t _nObjIndex, uint8_t _nSubIndex, uint8_t _nBytes);
+
 private:
 	int nCanReceived;
 	int nCanTransmitted;
 
+	bool AddPdoMapping(CANNodePdo &_pdo, uint16_t _nObjIndex, uint8_t _nSubIndex, uint8_t _nBytes, uint8_t _nAccess);
+	uint8_t ReadPdoData(CANNodePdo &_pdo, uint8_t *_pData);
+	void WritePdoData(CANNodePdo &_pdo);
+	bool SendTxPDO(uint8_t _nPdo, const uint8_t *_pData, uint32_t _nNow);
+
+	bool OnSDORequest(CAN_msg &msg);
+	bool SendSDO(uint8_t *_pData);
+	bool SendSDOAbort(uint16_t _nObjIndex, uint8_t _nSubIndex, uint32_t _nCode);
+	bool AbortSDO(uint32_t _nCode);
+	bool OnInitiateDomainDownload(CAN_msg &msg, ObjectDictionaryEntry *_pDomain);
+	bool OnDownloadSegment(CAN_msg &msg);
+	bool OnInitiateDomainUpload(ObjectDictionaryEntry *_pDomain);
+	bool OnUploadSegment(CAN_msg &msg);
+	bool OnBlockDownload(CAN_msg &msg);
+	bool OnBlockDownloadSegment(CAN_msg &msg);
+	bool OnBlockUpload(CAN_msg &msg);
+	void SendUploadBlock(void);
+	void ProcessSDO(void);
+	void EndDomainDownload(uint32_t _nLen);
+
 protected:
 	virtual bool HandleMessage(CAN_msg &msg);
 	virtual bool OnSync(void);
@@ -94,6 +195,8 @@ protected:
 	virtual bool OnNMTCommand(ENMTCommand cmd);
 	virtual bool OnUploadRequest(uint16_t _nObjIndex, uint8_t _nSubIndex);
 	virtual bool OnDownloadRequest(uint16_t _nObjIndex, uint8_t _nSubIndex, uint8_t _nDataLen, uint32_t _nData);	
+	virtual bool OnRxPDO(uint8_t _nPdo, CAN_msg &msg);
+	virtual void ProcessTxPDOs(bool _bSync);
 
 protected:
 	CANDriver 					&m_Driver;
@@ -102,8 +205,12 @@ protected:
 	ENMTState 					m_nNMTState;
 	ICANNodeDataProvider* 	m_aDataProviders[CANNODE_MAX_OBJECTS];
 
-	SemaphoreHandle_t  		m_ProcessDataMutex;
-	uint32_t 					m_aData[CANNODE_MAX_OBJECTS][CANNDOE_MAX_SUBINDEXES];
+	ObjectDictionary 			m_Dictionary;
+
+	CANNodePdo 					m_aTxPdo[CANNODE_MAX_PDOS];
+	CANNodePdo 					m_aRxPdo[CANNODE_MAX_PDOS];
+
+	CANNodeSdoTransfer 		m_Sdo;
 };
 
 extern "C" bool CAN_Node_GetCounters(int *TX_ctr,int *RX_ctr);
@@ -0,0 +1,249 @@
+// ---------------------------------------------------------------------------
+//! \package     ARMLibrary
+//! \file        Filter.h
+//! \brief       Fixed-point filters for the measurement chains
+//! \details     <UL><LI>Average: moving average over a power of two number of samples</LI>
+//!                  <LI>Biquad: second order IIR section with Q(FRAC) coefficients</LI>
+//!                  <LI>CICDecimator: cascaded integrator-comb decimation stage</LI></UL>
+//!
+//!              \par The accumulator of each filter is selected at compile time
+//!                   (32 or 64 bits) from the sample type and the number of bits
+//!                   the filter adds, so the filters never overflow for samples
+//!                   in the range of their type.
+//!              \par No division is made per sample: divisions by a power of
+//!                   two are shifts and the biquad works on integers.
+//!
+//! \copyright   Copyright (C) 2011-2013 BlueBotics SA
+// ----------------------------------------------------------------------------
+
+#ifndef _FILTER_H_
+#define _FILTER_H_
+
+// ----------------------------------------------------------------------------
+// Includes
+#include <stdint.h>
+#include <limits>
+#include "Base.h"
+
+// ----------------------------------------------------------------------------
+//! \brief Compile time selection of a type
+template<bool B, class T, class F> struct FilterSelect { typedef T Type; };
+template<class T, class F> struct FilterSelect<false, T, F> { typedef F Type; };
+
+// ----------------------------------------------------------------------------
+//! \brief Compile time log2 of a power of two
+template<int N> struct FilterLog2 { static const int value = 1 + FilterLog2<N / 2>::value; };
+template<> struct FilterLog2<1> { static const int value = 0; };
+
+// ----------------------------------------------------------------------------
+//! \brief Accumulator holding a sample of type T extended by BITS bits
+//! \details Type has the signedness of T, Unsigned is used for wrap-around arithmetic and
+//!          has the width of Type, so that a wrapped value converts back with its sign.
+template<class T, int BITS>
+struct FilterAccumulator
+{
+	static const bool bSigned = std::numeric_limits<T>::is_signed;
+	static const int nBits = std::numeric_limits<T>::digits + BITS;		// digits excludes the sign bit
+	static const bool bWide = nBits > (bSigned ? 31 : 32);
+
+	typedef typename FilterSelect<bWide, uint64_t, uint32_t>::Type Unsigned;
+	typedef typename FilterSelect<bSigned,
+				typename FilterSelect<bWide, int64_t, int32_t>::Type,
+				Unsigned>::Type Type;
+
+	static_assert(nBits <= 63, "Filter accumulator wider than 64 bits");
+};
+
+// ----------------------------------------------------------------------------
+//! \class      Average
+//! \brief      Moving average over the last N samples, N is a power of two
+template<int N, class T>
+class Average
+{
+	static_assert((N > 0) && ((N & (N - 1)) == 0), "Average: N must be a power of two");
+
+public:
+	typedef typename FilterAccumulator<T, FilterLog2<N>::value>::Type Accumulator;
+
+	Average()
+	{
+		Reset();
+	}
+	T Update(T nMeasure)
+	{
+		m_nTotal -= m_aMeasures[m_nPos];
+		m_nTotal += nMeasure;
+		m_aMeasures[m_nPos] = nMeasure;
+		m_nPos = (m_nPos + 1) & (N - 1);
+		return Get();
+	}
+	T Get() { return (T)(m_nTotal >> FilterLog2<N>::value); }
+	Accumulator GetTotal() { return m_nTotal; }
+	void Reset()
+	{
+		m_nPos = 0;
+		m_nTotal = 0;
+		for (uint32_t i = 0; i < N; i++)
+			m_aMeasures[i] = 0;
+	}
+
+private:
+	uint32_t m_nPos;
+	Accumulator m_nTotal;
+	T m_aMeasures[N];
+};
+
+// ----------------------------------------------------------------------------
+//! \class      Biquad
+//! \brief      Second order IIR section, direct form I
+//! \details    y[n] = b0*x[n] + b1*x[n-1] + b2*x[n-2] - a1*y[n-1] - a2*y[n-2]
+//!
+//!             \par The coefficients (|c| < 2) are converted once to Q(FRAC), each
+//!                  sample costs 5 32x32->64 multiply-accumulates and a shift.
+//!             \par The fractions truncated from the last two outputs are fed back with
+//!                  the denominator coefficients rounded to integers (second order
+//!                  error feedback), which cancels the gain of the poles on the
+//!                  truncation noise: low pass sections with poles close to 1 keep
+//!                  an exact DC gain and have no dead band.
+//!             \par Samples must stay within +/-2^(59-FRAC) to keep the sum of the
+//!                  five products within 64 bits.
+template<class T, int FRAC = 30>
+class Biquad
+{
+	static_assert((FRAC >= 8) && (FRAC <= 30), "Biquad: FRAC must be in 8..30");
+	static_assert(std::numeric_limits<T>::digits <= 31, "Biquad: samples wider than 32 bits");
+
+public:
+	Biquad()
+	{
+		m_nB0 = m_nB1 = m_nB2 = m_nA1 = m_nA2 = 0;
+		m_nK1 = m_nK2 = 0;
+		Reset();
+	}
+	Biquad(float b0, float b1, float b2, float a1, float a2)
+	{
+		SetCoefficients(b0, b1, b2, a1, a2);
+		Reset();
+	}
+	void SetCoefficients(float b0, float b1, float b2, float a1, float a2)
+	{
+		m_nB0 = ToFixed(b0);
+		m_nB1 = ToFixed(b1);
+		m_nB2 = ToFixed(b2);
+		m_nA1 = ToFixed(a1);
+		m_nA2 = ToFixed(a2);
+		m_nK1 = -(int32_t)((a1 < 0.0F) ? (a1 - 0.5F) : (a1 + 0.5F));
+		m_nK2 = -(int32_t)((a2 < 0.0F) ? (a2 - 0.5F) : (a2 + 0.5F));
+	}
+	//! \brief Low pass coefficients with a DC gain of exactly 1
+	//! \details The numerator is scaled to the denominator after the conversion to
+	//!          Q(FRAC): the rounding of the coefficients of a low pass section with
+	//!          poles close to 1 makes a DC gain error of the order of 1e-3.
+	void SetLowPassCoefficients(float b0, float b1, float b2, float a1, float a2)
+	{
+		SetCoefficients(b0, b1, b2, a1, a2);
+		int32_t nDen = (int32_t)(1L << FRAC) + m_nA1 + m_nA2;
+		float fNum = b0 + b1 + b2;
+		m_nB0 = ToFixed(b0 / fNum * (float)nDen / (float)(1L << FRAC));
+		m_nB2 = ToFixed(b2 / fNum * (float)nDen / (float)(1L << FRAC));
+		m_nB1 = nDen - m_nB0 - m_nB2;
+	}
+	T Update(T nMeasure)
+	{
+		int64_t acc = (int64_t)m_nK1 * m_nError1 + (int64_t)m_nK2 * m_nError2;
+		acc += (int64_t)m_nB0 * (int32_t)nMeasure;
+		acc += (int64_t)m_nB1 * m_nX1;
+		acc += (int64_t)m_nB2 * m_nX2;
+		acc -= (int64_t)m_nA1 * m_nY1;
+		acc -= (int64_t)m_nA2 * m_nY2;
+		int64_t y = acc >> FRAC;
+		m_nError2 = m_nError1;
+		m_nError1 = (int32_t)(acc - (y << FRAC));
+		m_nX2 = m_nX1;
+		m_nX1 = (int32_t)nMeasure;
+		m_nY2 = m_nY1;
+		m_nY1 = (int32_t)y;
+		return (T)y;
+	}
+	T Get() { return (T)m_nY1; }
+	void Reset()
+	{
+		m_nX1 = m_nX2 = 0;
+		m_nY1 = m_nY2 = 0;
+		m_nError1 = m_nError2 = 0;
+	}
+
+private:
+	static int32_t ToFixed(float c)
+	{
+		return (int32_t)(c * (float)(1L << FRAC) + ((c < 0.0F) ? -0.5F : 0.5F));
+	}
+
+private:
+	int32_t m_nB0, m_nB1, m_nB2;			// Q(FRAC) coefficients
+	int32_t m_nA1, m_nA2;
+	int32_t m_nX1, m_nX2;					// Input history
+	int32_t m_nY1, m_nY2;					// Output history
+	int32_t m_nK1, m_nK2;					// Error feedback coefficients (-a1, -a2 rounded)
+	int32_t m_nError1, m_nError2;			// Fractions truncated from the last outputs
+};
+
+// ----------------------------------------------------------------------------
+//! \class      CICDecimator
+//! \brief      CIC decimation by 2^SHIFT with ORDER stages and unity gain
+//! \details    Update is called for each input sample and returns true each 2^SHIFT
+//!             samples, when a new output is available with Get. The integrators
+//!             wrap around, which is exact as long as the accumulator holds the
+//!             ORDER*SHIFT bits of gain.
+template<int ORDER, int SHIFT, class T>
+class CICDecimator
+{
+	static_assert((ORDER >= 1) && (ORDER <= 4) && (SHIFT >= 1), "CICDecimator: unsupported order or rate");
+
+public:
+	typedef FilterAccumulator<T, ORDER * SHIFT> Acc;
+	typedef typename Acc::Type Accumulator;
+	typedef typename Acc::Unsigned Unsigned;
+
+	CICDecimator()
+	{
+		Reset();
+	}
+	bool Update(T nMeasure)
+	{
+		m_aIntegrator[0] += (Unsigned)(Accumulator)nMeasure;
+		for (int i = 1; i < ORDER; i++)
+			m_aIntegrator[i] += m_aIntegrator[i - 1];
+		m_nCount = (m_nCount + 1) & ((1 << SHIFT) - 1);
+		if (m_nCount != 0)
+			return false;
+		Unsigned c = m_aIntegrator[ORDER - 1];
+		for (int i = 0; i < ORDER; i++)
+		{
+			Unsigned prev = m_aComb[i];
+			m_aComb[i] = c;
+			c -= prev;
+		}
+		m_nOutput = (T)((Accumulator)c >> (ORDER * SHIFT));
+		return true;
+	}
+	T Get() { return m_nOutput; }
+	void Reset()
+	{
+		for (int i = 0; i < ORDER; i++)
+		{
+			m_aIntegrator[i] = 0;
+			m_aComb[i] = 0;
+		}
+		m_nCount = 0;
+		m_nOutput = 0;
+	}
+
+private:
+	Unsigned m_aIntegrator[ORDER];
+	Unsigned m_aComb[ORDER];
+	uint32_t m_nCount;
+	T m_nOutput;
+};
+
+#endif // _FILTER_H_
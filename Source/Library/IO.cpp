@@ -14,7 +14,7 @@
 
 // ----------------------------------------------------------------------------
 // Static variables
-DigitalInput* DigitalInput::m_Inputs[NB_MAX_INPUTS];
+DigitalInput* DigitalInput::m_PinMap[IO_N_PORTS][IO_N_PINS];
 
 
 // ----------------------------------------------------------------------------
@@ -180,40 +180,72 @@ void DigitalInput::HandleInterrupt(EEdge _eEdge)
 }
 
 // ----------------------------------------------------------------------------
-//! \brief Dispatch input interrupts
+//! \brief Get the index of a port (0 for PORTA), -1 if the port is unknown
+int DigitalInput::GetPortIndex(PORT_Type *PortBase)
+{
+	// The port register blocks are contiguous and evenly spaced
+	uintptr_t nOffset = (uintptr_t)PortBase - PORTA_BASE;
+	uintptr_t nIndex = nOffset / (PORTB_BASE - PORTA_BASE);
+	if ((nIndex >= IO_N_PORTS) || (nOffset != nIndex * (PORTB_BASE - PORTA_BASE)))
+		return -1;
+	return (int)nIndex;
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Dispatch the interrupt of one input
 bool DigitalInput::DispatchInterrupt(PORT_Type *PortBase,uint8_t PinOffset)
 {
-	// Loop through registered inputs
-	for (int i = 0; i < NB_MAX_INPUTS; i++)
+	int nPort = GetPortIndex(PortBase);
+	if ((nPort < 0) || (PinOffset >= IO_N_PINS))
+		return false;
+	DigitalInput *pInput = m_PinMap[nPort][PinOffset];
+	if (pInput == NULL)
+		return false; 	// Not found...
+	pInput->HandleInterrupt(pInput->m_InterruptEdge);
+	return true;	
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Dispatch the interrupts of all pending pins of a port
+//! \return number of pins dispatched to a registered input
+unsigned DigitalInput::DispatchInterrupts(PORT_Type *PortBase,uint32_t IRQmask)
+{
+	int nPort = GetPortIndex(PortBase);
+	if (nPort < 0)
+		return 0;
+	DigitalInput * const *pPins = m_PinMap[nPort];
+	unsigned nDispatched = 0;
+	// Visit the set bits only, highest pin first
+	while (IRQmask != 0)
 	{
-		DigitalInput *pInput = m_Inputs[i];
-		if (pInput == NULL)
-			return false; 	// Not found... (first slot empty means end of the array)
-		// Does this input correspond to the port and pin ids?
-		if (pInput->m_GPIO_ptr->Base == PortBase && pInput->m_GPIO_ptr->Offset == PinOffset)
+		unsigned nPin = 31 - __CLZ(IRQmask);
+		IRQmask &= ~(1U << nPin);
+		DigitalInput *pInput = pPins[nPin];
+		if (pInput != NULL)
 		{
 			pInput->HandleInterrupt(pInput->m_InterruptEdge);
-			return true;	
-		}		
+			nDispatched++;
+		}
 	}
-	return false; // Not found...
+	return nDispatched;
 }
 
 // ----------------------------------------------------------------------------
 //! \brief Register an input
 bool DigitalInput::RegisterInput(DigitalInput *_pInput)
 {
+	if (!_pInput->m_Valid)
+		return false;
 	if (_pInput->m_GPIO_ptr->Direction != kGPIO_DigitalInput)
 		return false;
-	for (int i = 0; i < BOARD_N_GPIO_IN; i++)
-	{
-		if (m_Inputs[i] == NULL)
-		{
-			m_Inputs[i] = _pInput;
-			return true;
-		}
-	}
-	return false;
+	int nPort = GetPortIndex(_pInput->m_GPIO_ptr->Base);
+	unsigned nPin = _pInput->m_GPIO_ptr->Offset;
+	if ((nPort < 0) || (nPin >= IO_N_PINS))
+		return false;
+	if (m_PinMap[nPort][nPin] != NULL)
+		return false;	// Pin already declared
+	m_PinMap[nPort][nPin] = _pInput;
+	return true;
 }
 
 
@@ -274,10 +306,6 @@ bool DigitalOutput::Toggle(void)
 //! \brief The interrupt handler for IOs
 extern "C" void PORT_IRQHandler(PORT_Type *port,unsigned IRQmask)
 {
-	// Check what input is the source of the interrupt
-	for (int nPinId = 0; nPinId < 32; nPinId++)
-	{
-		if ((IRQmask & (1 << nPinId)) != 0)
-			DigitalInput::DispatchInterrupt(port,nPinId);
-	}
+	// Dispatch each pending pin to its input
+	DigitalInput::DispatchInterrupts(port,IRQmask);
 }
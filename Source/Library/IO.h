@@ -148,6 +148,8 @@ typedef struct {
 } mGPIO_Interrupt_t;
 
 #define NB_MAX_INPUTS	BOARD_N_GPIO_IN
+#define IO_N_PORTS		5				// PORTA to PORTE
+#define IO_N_PINS			32				// Pins per port (bits of ISFR)
 
 // ----------------------------------------------------------------------------
 //! \brief Describe falling or rising edge type of interrupt
@@ -200,14 +202,19 @@ protected:
 // ----------------------------------------------------------------------------
 //! \class      DigitalInput
 //! \brief      Encapsulate a digital input
+//! \details    Inputs are registered in a (port, pin) table at construction. A port
+//!             interrupt only visits the set bits of its ISFR mask, highest pin
+//!             first (CLZ), and finds each input by direct indexing: the cost is
+//!             constant per pending pin, whatever the number of declared inputs.
 class DigitalInput : public DigitalIOBase, 
                      public EventSource
 {
 private:
-	static DigitalInput* 	m_Inputs[NB_MAX_INPUTS];
+	static DigitalInput* 	m_PinMap[IO_N_PORTS][IO_N_PINS];
 	EEdge							m_InterruptEdge;	
 	bool							m_isInverted;
 	static bool RegisterInput(DigitalInput *_pInput);
+	static int GetPortIndex(PORT_Type *PortBase);
 public:
 	DigitalInput(uint8_t _nPinId, bool isInverted = false, EPinMode _eMode = EPinMode_NoPull, EPinOption _eOption = EPinOption_None);
     //! \cond 
@@ -222,6 +229,7 @@ public:
 	virtual void HandleInterrupt(EEdge _eEdge);
 public:
 	static bool DispatchInterrupt(PORT_Type *PortBase,uint8_t PinOffset);
+	static unsigned DispatchInterrupts(PORT_Type *PortBase,uint32_t IRQmask);
 };
 
 // ----------------------------------------------------------------------------
@@ -114,6 +114,13 @@ void RampGenerator::Execute(uint32_t _nTime)
    }
 }
 
+// ----------------------------------------------------------------------------
+//! \brief Helper function to round a position or a speed
+static inline int32_t RoundToInt(float _fValue)
+{
+	return (int32_t)((_fValue < 0.0f) ? (_fValue - 0.5f) : (_fValue + 0.5f));
+}
+
 // ----------------------------------------------------------------------------
 //! \brief Constructor
 TMPGenerator::TMPGenerator(uint32_t _nTravelSpeed, uint32_t _nAcceleration,int ID)
@@ -121,128 +128,66 @@ TMPGenerator::TMPGenerator(uint32_t _nTravelSpeed, uint32_t _nAcceleration,int I
 	dbgprintf("Trapezoid Motion Generator Constructor, TravelSpeed = %d, Acceleration = %d ...\n",_nTravelSpeed,_nAcceleration);	
 	m_nCurPos = 0;
 	m_nCurSpeed = 0;
+	m_fCurSpeed = 0.0f;
 	m_nTime = 0;
+	m_nStartTime = 0;
+	m_nStartPos = 0;
+	m_nTargetPos = 0;
+	m_fDirection = 1.0f;
+	m_fDuration = 0.0f;
+	m_nSegments = 0;
+	m_nSegment = 0;
 	m_eState = ETMPState_Idle;
 	m_ID = ID;
+	m_fJerk = 0.0f;
 	SetTravelSpeed(_nTravelSpeed);
 	SetAcceleration(_nAcceleration);
 #if TRACEALYZER != 0 && TRC_TMP != 0 
 	sprintf(m_char,"TMP %d",m_ID);
 	trcTMP = xTraceRegisterString(m_char);
-	sprintf(m_char_s,"TMP_s %d",m_ID);
-	trcTMP_s = xTraceRegisterString(m_char_s);
-	sprintf(m_char_v,"TMP_v %d",m_ID);
-	trcTMP_v = xTraceRegisterString(m_char_v);
-	sprintf(m_char_a,"TMP_a %d",m_ID);
-	trcTMP_a = xTraceRegisterString(m_char_a);
 #endif
 	dbgprintf("... Trapezoid Motion Generator Constructor done.\n");	
 }
 
 // ----------------------------------------------------------------------------
 //! \brief Execute one cycle of the TMP generator
+//! \details Bounded time: no division, no trace and at most TMP_MAX_SEGMENTS
+//!          iterations to find the segment of the current time.
 void TMPGenerator::Execute(uint32_t _nTime)
 {
-	// Compute delta time
-	// Time Difference to the Start of the Movement
-	uint32_t dtStart = ComputeDeltaTime(m_nStartTime, _nTime);	
-	// Time Difference to the last Time the TMP Generator did execute
-	uint32_t dt = ComputeDeltaTime(m_nTime, _nTime);	
-
-	// Save current time and speed
 	m_nTime = _nTime;
-	int32_t nLastSpeed = m_nCurSpeed;	
-	// Set the Target Reached Flag to false;
-	bool bTargetReached = false;
-
-	// Handle the State Machine
-	switch (m_eState)
+	if (ETMPState_Idle == m_eState)
 	{
-		case ETMPState_Idle:							// Idle phase			
-			m_nCurSpeed = 0;
-			break;
-
-		case ETMPState_Acc: 							// Acceleration phase			
-			m_nCurSpeed += m_nCurAcc;					
-			if (dtStart >= m_tAcc)					// Check end of acceleration
-			{						
-				m_eState = ETMPState_Dec;		
-#if TRACEALYZER != 0 && TRC_TMP != 0
-				vTracePrintF(trcTMP,"TMPGEN: End of Accel., Speed = %d",m_nCurSpeed);
-#endif
-				if (m_tCst != 0)						// Do we have a constant speed phase?
-				{
-					m_eState = ETMPState_Cst;
-					m_nCurSpeed = m_nCurTravelSpeed;
-#if TRACEALYZER != 0 && TRC_TMP != 0
-					vTracePrintF(trcTMP,"TMPGEN: -> Const. Speed, Speed = %d",m_nCurSpeed);
-#endif
-				}
-				else
-				{
-#if TRACEALYZER != 0 && TRC_TMP != 0
-					vTracePrintF(trcTMP,"TMPGEN: -> Deaccel., Speed = %d",m_nCurSpeed);
-#endif
-				}
-			}
-			else
-			{
-#if TRACEALYZER != 0 && TRC_TMP != 0
-				vTracePrintF(trcTMP,"TMPGEN: Accel., Speed = %d",m_nCurSpeed);
-#endif
-			}
-			break;
-		case ETMPState_Cst:							// Constant speed phase			
-			m_nCurSpeed = m_nCurTravelSpeed;			
-			if (dtStart >= (m_tAcc + m_tCst))	// Check end of acceleration
-			{
-#if TRACEALYZER != 0 && TRC_TMP != 0
-				vTracePrintF(trcTMP,"TMPGEN: -> Deaccel., Speed = %d",m_nCurSpeed);
-#endif
-				m_eState = ETMPState_Dec;
-			}	
-			else
-			{
-#if TRACEALYZER != 0 && TRC_TMP != 0
-				vTracePrintF(trcTMP,"TMPGEN: Const., Speed = %d",m_nCurSpeed);
-#endif
-			}				
-			break;
-		case ETMPState_Dec:							// Deceleration phase			
-			m_nCurSpeed -= m_nCurAcc;
-			bTargetReached = (dtStart >= (m_tAcc + m_tCst + m_tDec));
-			if (bTargetReached)
-			{		
-#if TRACEALYZER != 0 && TRC_TMP != 0
-				vTracePrintF(trcTMP,"TMPGEN: -> Idle, Speed = %d",m_nCurSpeed);
-#endif
-				m_eState = ETMPState_Idle;				
-				m_nCurSpeed = 0;				
-				m_nCurPos = m_nTargetPos;
-			}
-			else
-			{
-#if TRACEALYZER != 0 && TRC_TMP != 0
-				vTracePrintF(trcTMP,"TMPGEN: Deaccel., Speed = %d",m_nCurSpeed);
-#endif
-			}
-			break;
-		default:
-			break;
-	}	
-
-	// Set the current position if the target has not been reached and
-	// the current delta time (time from the las execution of the
-	// TMP Gen) is greater than zero
-	if (!bTargetReached && dt > 0)
+		m_nCurSpeed = 0;
+		m_fCurSpeed = 0.0f;
+		return;
+	}
+
+	// Time Difference to the Start of the Movement
+	float t = (float)ComputeDeltaTime(m_nStartTime, _nTime);
+	if (t >= m_fDuration)
 	{
-		m_nCurPos += ((m_nCurSpeed + nLastSpeed) * (int32_t)dt) / 2;
+		// End of the move, land exactly on the target
+		m_eState = ETMPState_Idle;
+		m_nCurSpeed = 0;
+		m_fCurSpeed = 0.0f;
+		m_nCurPos = m_nTargetPos;
+		return;
 	}
-#if TRACEALYZER != 0 && TRC_TMP != 0
-				vTracePrintF(trcTMP_s,"%d",m_nCurPos);
-				vTracePrintF(trcTMP_v,"%d",m_nCurSpeed);
-				vTracePrintF(trcTMP_a,"%d",m_nCurAcc);
-#endif
+
+	// Find the segment of the current time (time only increases during a move)
+	while ((m_nSegment < (m_nSegments - 1)) && (t >= m_aSegments[m_nSegment].fEnd))
+		m_nSegment++;
+	const TMPSegment &seg = m_aSegments[m_nSegment];
+
+	// Evaluate the segment: p = p0 + v0*t + a0*t^2/2 + j*t^3/6
+	float tau = t - seg.fStart;
+	float fSpeed = seg.fSpeed + tau * (seg.fAcc + 0.5f * seg.fJerk * tau);
+	float fPos = seg.fPos + tau * (seg.fSpeed + tau * (0.5f * seg.fAcc + tau * seg.fJerk * (1.0f / 6.0f)));
+	m_eState = seg.eState;
+	m_fCurSpeed = m_fDirection * fSpeed;
+	m_nCurSpeed = RoundToInt(m_fCurSpeed);
+	m_nCurPos = m_nStartPos + RoundToInt(m_fDirection * fPos);
 }
 
 // ----------------------------------------------------------------------------
@@ -263,74 +208,170 @@ void TMPGenerator::SetAcceleration(uint32_t _nAcceleration)
 }
 
 // ----------------------------------------------------------------------------
-//! \brief Request the generator to move to a specified position
-void TMPGenerator::MoveTo(int32_t _nPosition)
+//! \brief Change the jerk of the generator (_nJerk / _nJerkDiv), 0 selects the trapezoidal profile
+void TMPGenerator::SetJerk(uint32_t _nJerk, uint32_t _nJerkDiv)
+{ 
+	m_fJerk = (_nJerkDiv != 0) ? (float)_nJerk / (float)_nJerkDiv : 0.0f; 
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Append a segment to the profile of the move, the start state is the end state of the previous segment
+void TMPGenerator::AddSegment(float _fDuration, float _fAcc, float _fJerk, ETMPState _eState)
 {
-	// Compute delta position and speed	
-	int32_t deltaPos = _nPosition - m_nCurPos;								// Delta Position
-	int32_t nDirection = ((_nPosition > m_nCurPos) ? 1 : -1);			// Direction of the Movement
-	int32_t deltaSpeed = (nDirection * m_nTravelSpeed) - m_nCurSpeed;	// Delta Speed
-	int32_t speedDirection = ((deltaSpeed > 0) ? 1 : -1);					// Speed Direction
-	if (deltaPos == 0)
+	if ((_fDuration <= 0.0f) || (m_nSegments >= TMP_MAX_SEGMENTS))
 		return;
-	
+	TMPSegment &seg = m_aSegments[m_nSegments];
+	if (0 == m_nSegments)
+	{
+		seg.fStart = 0.0f;
+		seg.fPos = 0.0f;
+		seg.fSpeed = m_fDirection * m_fCurSpeed;
+	}
+	else
+	{
+		const TMPSegment &prev = m_aSegments[m_nSegments - 1];
+		float T = prev.fEnd - prev.fStart;
+		seg.fStart = prev.fEnd;
+		seg.fPos = prev.fPos + T * (prev.fSpeed + T * (0.5f * prev.fAcc + T * prev.fJerk * (1.0f / 6.0f)));
+		seg.fSpeed = prev.fSpeed + T * (prev.fAcc + 0.5f * prev.fJerk * T);
+	}
+	seg.fEnd = seg.fStart + _fDuration;
+	seg.fAcc = _fAcc;
+	seg.fJerk = _fJerk;
+	seg.eState = _eState;
+	m_nSegments++;
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Plan a trapezoidal profile from the current speed
+//! \param _fDistance distance to the target (> 0)
+//! \param _fSpeed current speed in the direction of the move
+void TMPGenerator::PlanTrapezoid(float _fDistance, float _fSpeed)
+{
+	float A = (float)m_nAcceleration;
+	float V = (float)m_nTravelSpeed;
+
+	// Moving away from the target: stop first
+	if (_fSpeed < 0.0f)
+	{
+		AddSegment(-_fSpeed / A, A, 0.0f, ETMPState_Dec);
+		_fDistance += (_fSpeed * _fSpeed) / (2.0f * A);
+		_fSpeed = 0.0f;
+	}
+
+	// Not able to stop at the target with the acceleration: just brake harder!
+	if ((_fSpeed * _fSpeed) >= (2.0f * A * _fDistance))
+	{
 #if TRACEALYZER != 0 && TRC_TMP != 0
-	vTracePrint(trcTMP,"TMPGEN: Move to Target");
+		vTracePrint(trcTMP,"TMPGEN: Brake");
 #endif
-	// Compute time and distance of both acceleration and deceleration phases of the trapezoidal curve	
-	m_tAcc = abs(deltaSpeed) / ((int32_t)m_nAcceleration);				// Acceleration Duration
-	int32_t dAcc = m_tAcc * (m_nCurSpeed + deltaSpeed / 2);				// Acceleration Distance
-	m_tDec = m_nTravelSpeed / m_nAcceleration;								// Deacceleration Duration
-	int32_t dDec = m_tDec * nDirection * (int32_t)m_nTravelSpeed / 2;	// Deacceleration Distance
-
-	// Compute lenght of the constant speed phase
-	int32_t dCst = nDirection * (deltaPos - (dAcc + dDec));				// Constant Speed Distance
-
-	// Is the distance large enough to reach target speed?
-	if (dCst > (int32_t)m_nTravelSpeed)
-	{		
-		// Yes, generate the trapezoidal curve
-		m_tCst = dCst / m_nTravelSpeed;											// Constant Speed Duration
-		m_nCurTravelSpeed = nDirection * m_nTravelSpeed;					// Current Travel Speed equals the desired Travel Speed
-		m_nCurAcc = speedDirection * m_nAcceleration;						// Calculate the Current Acceleration from the desired Acceleration
-		m_nStartTime = m_nTime;														// Set the Starting Time	
-		m_nTargetPos = _nPosition;													// Set the Target Position 
-		m_eState = ETMPState_Acc;													// Set the FSM to "Acceleration"
+		float fDec = (_fSpeed * _fSpeed) / (2.0f * _fDistance);
+		AddSegment(_fSpeed / fDec, -fDec, 0.0f, ETMPState_Dec);
+		return;
+	}
+
+	// Peak speed: travel speed, or the speed of the triangular profile
+	float fPeak = sqrtf(A * _fDistance + 0.5f * _fSpeed * _fSpeed);
+	if (fPeak > V)
+		fPeak = V;
 #if TRACEALYZER != 0 && TRC_TMP != 0
-		vTracePrint(trcTMP,"TMPGEN: Can reach Target Speed");
+	else
+		vTracePrint(trcTMP,"TMPGEN: Cannot reach vTarget, accel.");
 #endif
-		return;
+	float tAcc = fabsf(fPeak - _fSpeed) / A;
+	float dAcc = 0.5f * (_fSpeed + fPeak) * tAcc;
+	float dDec = (fPeak * fPeak) / (2.0f * A);
+	AddSegment(tAcc, (fPeak >= _fSpeed) ? A : -A, 0.0f, (fPeak >= _fSpeed) ? ETMPState_Acc : ETMPState_Dec);
+	AddSegment((_fDistance - dAcc - dDec) / fPeak, 0.0f, 0.0f, ETMPState_Cst);
+	AddSegment(fPeak / A, -A, 0.0f, ETMPState_Dec);
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Plan a jerk-limited S-curve profile from rest
+//! \param _fDistance distance to the target (> 0)
+void TMPGenerator::PlanSCurve(float _fDistance)
+{
+	float A = (float)m_nAcceleration;
+	float V = (float)m_nTravelSpeed;
+	float J = m_fJerk;
+	float tJerk;										// Duration of a jerk segment
+	float tAcc;											// Duration of the constant acceleration segment
+	float tCst = 0.0f;								// Duration of the constant speed segment
+
+	// Acceleration phase up to the travel speed
+	if ((V * J) >= (A * A))
+	{
+		tJerk = A / J;
+		tAcc = V / A - tJerk;
+	}
+	else
+	{
+		tJerk = sqrtf(V / J);
+		tAcc = 0.0f;
 	}
 
-	// Not enough time to reach travel speed...
-	// Are we moving at a slower speed than travel speed?
-	if (abs(m_nCurSpeed) < m_nTravelSpeed)
+	if ((V * (2.0f * tJerk + tAcc)) <= _fDistance)
 	{
-		// Yes, then generate a triangular curve
-		m_tAcc = sqrt((double)abs(deltaPos) / m_nAcceleration);				// Calculate the Acceleration Time
-		m_tCst = 0;																			// no Constant Speed Phase
-		m_tDec = m_tAcc;																	// Acceleration Time equals the Deacceleration Time
-		m_nCurAcc = speedDirection * abs(deltaPos) / (m_tAcc * m_tAcc);	// Calculate the Current Acceleration
-		m_nStartTime = m_nTime;															// Set the Starting Time	
-		m_nTargetPos = _nPosition;														// Set the Target Position 
-		m_eState = ETMPState_Acc;														// Set the FSM to "Acceleration"
+		tCst = _fDistance / V - (2.0f * tJerk + tAcc);
+	}
+	else
+	{
+		// Travel speed not reached: peak speed v with v^2/A + v*A/J = distance
+		tJerk = A / J;
+		float fPeak = 0.5f * A * (sqrtf(tJerk * tJerk + 4.0f * _fDistance / A) - tJerk);
+		tAcc = fPeak / A - tJerk;
+		if (tAcc < 0.0f)
+		{
+			// Acceleration not reached either: distance = 2*J*tJerk^3
+			tJerk = powf(_fDistance / (2.0f * J), 1.0f / 3.0f);
+			tAcc = 0.0f;
+		}
 #if TRACEALYZER != 0 && TRC_TMP != 0
-		vTracePrint(trcTMP,"TMPGEN: Cannot reach vTargrt, accel.");
+		vTracePrint(trcTMP,"TMPGEN: Cannot reach vTarget, accel.");
 #endif
-		return;
 	}
 
-	// We are already running faster than travel speed: Now just break!
+	float fAcc = J * tJerk;
+	AddSegment(tJerk, 0.0f, J, ETMPState_Acc);
+	AddSegment(tAcc, fAcc, 0.0f, ETMPState_Acc);
+	AddSegment(tJerk, fAcc, -J, ETMPState_Acc);
+	AddSegment(tCst, 0.0f, 0.0f, ETMPState_Cst);
+	AddSegment(tJerk, 0.0f, -J, ETMPState_Dec);
+	AddSegment(tAcc, -fAcc, 0.0f, ETMPState_Dec);
+	AddSegment(tJerk, -fAcc, J, ETMPState_Dec);
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Request the generator to move to a specified position
+void TMPGenerator::MoveTo(int32_t _nPosition)
+{
+	// Compute delta position and direction
+	int32_t deltaPos = _nPosition - m_nCurPos;								// Delta Position
+	if (deltaPos == 0 || m_nAcceleration == 0 || m_nTravelSpeed == 0)
+		return;
+	
 #if TRACEALYZER != 0 && TRC_TMP != 0
-	vTracePrint(trcTMP,"TMPGEN: Brake");
+	vTracePrint(trcTMP,"TMPGEN: Move to Target");
 #endif
-	m_tAcc = 0;
-	m_tCst = 0;
-	m_tDec = sqrt((double)abs(deltaPos) / m_nAcceleration);
-	m_nCurAcc = speedDirection * abs(deltaPos)/(m_tDec * m_tDec);
-	m_nStartTime = m_nTime;
-	m_nTargetPos = _nPosition;
-	m_eState = ETMPState_Dec;
+	m_fDirection = (deltaPos > 0) ? 1.0f : -1.0f;							// Direction of the Movement
+	float fDistance = (float)abs(deltaPos);
+	float fSpeed = m_fDirection * m_fCurSpeed;								// Current speed in the direction of the move
+
+	// Plan the segments of the move
+	m_nSegments = 0;
+	if ((m_fJerk > 0.0f) && (ETMPState_Idle == m_eState))
+		PlanSCurve(fDistance);
+	else
+		PlanTrapezoid(fDistance, fSpeed);
+	if (0 == m_nSegments)
+		return;
+
+	m_fDuration = m_aSegments[m_nSegments - 1].fEnd;						// Duration of the move
+	m_nSegment = 0;
+	m_nStartPos = m_nCurPos;														// Set the Starting Position
+	m_nStartTime = m_nTime;															// Set the Starting Time	
+	m_nTargetPos = _nPosition;														// Set the Target Position 
+	m_eState = m_aSegments[0].eState;											// Set the FSM to the first phase
 }
 
 // ----------------------------------------------------------------------------
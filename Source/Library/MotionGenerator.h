@@ -52,10 +52,41 @@ private:
 	uint32_t m_nSlopeDiv;
 };
 
+// ----------------------------------------------------------------------------
+// Constants
+#define TMP_MAX_SEGMENTS	7				//!< Jerk-limited profile: 3 acceleration, 1 constant speed, 3 deceleration segments
+
+// ----------------------------------------------------------------------------
+//! \struct     TMPSegment
+//! \brief      Constant jerk segment of a motion profile
+//! \details    Times are relative to the start of the move [ms], the state at the
+//!             start of the segment is relative to the start position, in the
+//!             direction of the move.
+struct TMPSegment
+{
+	float fStart;						//!< Start time
+	float fEnd;							//!< End time
+	float fPos;							//!< Position at the start
+	float fSpeed;						//!< Speed at the start
+	float fAcc;							//!< Acceleration at the start
+	float fJerk;						//!< Jerk during the segment
+	ETMPState eState;					//!< State reported during the segment
+};
+
 // ----------------------------------------------------------------------------
 //! \class      TMPGenerator
 //! \brief      Trapezoidal Motion Profile. 
-//! \details    Generate positions based on a trapezoid of speed.
+//! \details    Generate positions based on a trapezoid of speed, or on a jerk-limited
+//!             S-curve of speed if a jerk is set.
+//!
+//!             \par MoveTo plans the whole move as a list of at most TMP_MAX_SEGMENTS
+//!                  constant jerk segments in single precision (sqrtf/powf, no double).
+//!             \par Execute evaluates the segment of the current time in closed form:
+//!                  at most TMP_MAX_SEGMENTS comparisons and a fixed number of single
+//!                  precision operations, no division, no trace, no library call.
+//!                  Positions do not drift with the step period.
+//!             \par The S-curve is used for moves starting at rest, a move commanded
+//!                  while moving is planned as a trapezoid from the current speed.
 class TMPGenerator
 {
 public:
@@ -68,6 +99,7 @@ public:
 public:
 	void SetTravelSpeed(uint32_t _nTravelSpeed);
 	void SetAcceleration(uint32_t _nAcceleration);
+	void SetJerk(uint32_t _nJerk, uint32_t _nJerkDiv);
 	void MoveTo(int32_t _nPosition);
 	void Execute(uint32_t _nTime);
 	bool SetPosition(int32_t _nPosition);
@@ -76,36 +108,38 @@ public:
 	ETMPState GetState()		{ return m_eState; }
 	bool IsMoving()			{ return (m_eState != ETMPState_Idle); }
 
+private:
+	void PlanTrapezoid(float _fDistance, float _fSpeed);
+	void PlanSCurve(float _fDistance);
+	void AddSegment(float _fDuration, float _fAcc, float _fJerk, ETMPState _eState);
+
 private:
 	// Current state
 	ETMPState m_eState;				// Generator state
 	uint32_t m_nTime;					// Current time
 	int32_t m_nCurPos;				// Current position
 	int32_t m_nCurSpeed;				// Current speed
+	float m_fCurSpeed;				// Current speed, not rounded
 
 	// Parameters of the current command
 	uint32_t m_nStartTime;			// Start time
+	int32_t m_nStartPos;				// Start position
 	int32_t m_nTargetPos;				// Target position
-	int32_t m_tAcc;					// Duration of the acceleration phase
-	int32_t m_tDec;					// Duration of the deceleration phase
-	int32_t m_tCst;					// Duration of the constant speed phase
-	int32_t m_nCurAcc;				// Actual acceleration
-	int32_t m_nCurTravelSpeed;		// Actual travel speed
+	float m_fDirection;				// Direction of the Movement (1 or -1)
+	float m_fDuration;				// Duration of the move
+	TMPSegment m_aSegments[TMP_MAX_SEGMENTS];	// Profile of the move
+	int m_nSegments;					// Number of segments of the profile
+	int m_nSegment;					// Current segment
 	int m_ID;							// ID of the Motion Generator
 #if TRACEALYZER != 0 && TRC_TMP != 0
 	traceString trcTMP;
-	traceString trcTMP_s;
-	traceString trcTMP_v;
-	traceString trcTMP_a;
 	char m_char[8];											//!< Tracealyzer String
-	char m_char_s[8];											//!< Tracealyzer String
-	char m_char_v[8];											//!< Tracealyzer String
-	char m_char_a[8];											//!< Tracealyzer String
 #endif
 
 	// General Settings
 	uint32_t m_nAcceleration;			// Acceleration
 	uint32_t m_nTravelSpeed;			// Travel speed
+	float m_fJerk;						// Jerk, 0 for a trapezoidal profile
 };
 
 // ----------------------------------------------------------------------------
@@ -0,0 +1,90 @@
+// ---------------------------------------------------------------------------
+//! \package     ARMLibrary
+//! \file        ObjectDictionary.cpp
+//! \brief       Sorted CANopen object dictionary
+//!
+//! \copyright   Copyright (C) 2011-2012 BlueBotics SA
+// ----------------------------------------------------------------------------
+
+// ----------------------------------------------------------------------------
+// Includes
+#include "ObjectDictionary.h"
+#include <string.h>
+
+// ----------------------------------------------------------------------------
+//! \brief Constructor
+ObjectDictionary::ObjectDictionary()
+{
+	memset(m_aEntries, 0, sizeof(m_aEntries));
+	m_nEntries = 0;
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Position of the first sorted entry whose key is not less than _nKey
+int ObjectDictionary::LowerBound(uint32_t _nKey)
+{
+	int nLow = 0;
+	int nHigh = m_nEntries;
+	while (nLow < nHigh)
+	{
+		int nMid = (nLow + nHigh) >> 1;
+		const ObjectDictionaryEntry &entry = m_aEntries[m_aSorted[nMid]];
+		if (Key(entry.nObjectIndex, entry.nSubIndex) < _nKey)
+			nLow = nMid + 1;
+		else
+			nHigh = nMid;
+	}
+	return nLow;
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Add an entry, returns NULL if it already exists or the dictionary is full
+//! \details Basic entries (_pData == NULL) hold their value in the entry, at most 4 bytes.
+//!          Domains must provide their buffer.
+ObjectDictionaryEntry *ObjectDictionary::Add(uint16_t _nObjIndex, uint8_t _nSubIndex, ECANDataType _eType,
+															uint32_t _nSize, uint8_t _nAccess, uint8_t *_pData)
+{
+	if (m_nEntries >= OBJDICT_MAX_ENTRIES || 0 == _nSize)
+		return NULL;
+	if (NULL == _pData && _nSize > sizeof(uint32_t))
+		return NULL;
+
+	uint32_t nKey = Key(_nObjIndex, _nSubIndex);
+	int nPos = LowerBound(nKey);
+	if (nPos < m_nEntries)
+	{
+		const ObjectDictionaryEntry &next = m_aEntries[m_aSorted[nPos]];
+		if (Key(next.nObjectIndex, next.nSubIndex) == nKey)
+			return NULL;
+	}
+
+	ObjectDictionaryEntry *pEntry = &m_aEntries[m_nEntries];
+	pEntry->nObjectIndex = _nObjIndex;
+	pEntry->nSubIndex = _nSubIndex;
+	pEntry->nAccess = _nAccess;
+	pEntry->nDataType = (uint16_t)_eType;
+	pEntry->nSize = _nSize;
+	pEntry->nValue = 0;
+	pEntry->nSeq = 0;
+	pEntry->pData = (NULL != _pData) ? _pData : (uint8_t*)&pEntry->nValue;
+
+	// Entries are declared once at startup: a sorted insert is cheap enough
+	memmove(&m_aSorted[nPos + 1], &m_aSorted[nPos], (m_nEntries - nPos) * sizeof(m_aSorted[0]));
+	m_aSorted[nPos] = (uint16_t)m_nEntries;
+	m_nEntries++;
+	return pEntry;
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Look up an entry, returns NULL if it does not exist
+ObjectDictionaryEntry *ObjectDictionary::Find(uint16_t _nObjIndex, uint8_t _nSubIndex)
+{
+	uint32_t nKey = Key(_nObjIndex, _nSubIndex);
+	int nPos = LowerBound(nKey);
+	if (nPos >= m_nEntries)
+		return NULL;
+	ObjectDictionaryEntry *pEntry = &m_aEntries[m_aSorted[nPos]];
+	if (Key(pEntry->nObjectIndex, pEntry->nSubIndex) != nKey)
+		return NULL;
+	return pEntry;
+}
@@ -0,0 +1,111 @@
+// ---------------------------------------------------------------------------
+//! \package     ARMLibrary
+//! \file        ObjectDictionary.h
+//! \brief       Sorted CANopen object dictionary
+//! \details     <UL><LI>Entries are identified by (object index, subindex)</LI>
+//!                  <LI>Each entry has a data type, a size and access rights</LI>
+//!                  <LI>Basic entries hold their value, domain entries point at an external buffer</LI></UL>
+//!
+//!              \par Entries are stored in declaration order and never move, so pointers
+//!                   to their value (ProcessDataIn/ProcessDataOut) stay valid.
+//!              \par A separate index kept sorted by (object index, subindex) provides
+//!                   O(log n) lookup by binary search.
+//!              \par Values of basic entries are guarded by a per-entry sequence counter
+//!                   shared with their ProcessData instances.
+//!
+//! \copyright   Copyright (C) 2011-2012 BlueBotics SA
+// ----------------------------------------------------------------------------
+
+#ifndef _OBJECTDICTIONARY_H_
+#define _OBJECTDICTIONARY_H_
+
+// ----------------------------------------------------------------------------
+// Includes
+#include "CANDefs.h"
+#include "Base.h"
+#include "SeqLock.h"
+
+// ----------------------------------------------------------------------------
+// Constants
+#ifndef OBJDICT_MAX_ENTRIES
+#define OBJDICT_MAX_ENTRIES 256
+#endif
+
+// ----------------------------------------------------------------------------
+//! \brief Data type of a basic entry, deduced from the ProcessData type
+template<class T> struct CANDataType;
+template<> struct CANDataType<uint8_t>  { static const ECANDataType eType = ECANDataType_Unsigned8;  };
+template<> struct CANDataType<uint16_t> { static const ECANDataType eType = ECANDataType_Unsigned16; };
+template<> struct CANDataType<uint32_t> { static const ECANDataType eType = ECANDataType_Unsigned32; };
+template<> struct CANDataType<int8_t>   { static const ECANDataType eType = ECANDataType_Integer8;   };
+template<> struct CANDataType<int16_t>  { static const ECANDataType eType = ECANDataType_Integer16;  };
+template<> struct CANDataType<int32_t>  { static const ECANDataType eType = ECANDataType_Integer32;  };
+
+// ----------------------------------------------------------------------------
+//! \struct     ObjectDictionaryEntry
+//! \brief      One (object index, subindex) entry of the object dictionary
+struct ObjectDictionaryEntry
+{
+	uint16_t nObjectIndex;
+	uint8_t nSubIndex;
+	uint8_t nAccess;							//!< ECANAccess
+	uint16_t nDataType;						//!< ECANDataType
+	uint32_t nSize;							//!< [bytes]
+	uint8_t *pData;							//!< &nValue for basic entries, external buffer for domains
+	volatile uint32_t nValue;
+	volatile uint32_t nSeq;					//!< Sequence counter guarding nValue
+
+	uint32_t Read() const
+	{
+		uint32_t value;
+		uint32_t seq;
+		do
+		{
+			seq = SeqLock::ReadBegin(&nSeq);
+			value = nValue;
+		} while (SeqLock::ReadRetry(&nSeq, seq));
+		return value;
+	}
+	void Write(uint32_t _nValue)
+	{
+		uint32_t nPrimask = SeqLock::WriteBegin(&nSeq);
+		nValue = _nValue;
+		SeqLock::WriteEnd(&nSeq, nPrimask);
+	}
+
+	bool IsReadable() const { return (nAccess & ECANAccess_ReadOnly) != 0; }
+	bool IsWritable() const { return (nAccess & ECANAccess_WriteOnly) != 0; }
+	bool IsDomain() const { return ECANDataType_Domain == nDataType; }
+};
+
+// ----------------------------------------------------------------------------
+//! \class      ObjectDictionary
+//! \brief      Fixed capacity object dictionary with binary search lookup
+class ObjectDictionary
+{
+public:
+	ObjectDictionary();
+    //! \cond
+	virtual ~ObjectDictionary() {}
+private:
+	ObjectDictionary(const ObjectDictionary &right);				// HideDefaultMethods would hide the constructor
+	ObjectDictionary & operator=(const ObjectDictionary &right);
+    //! \endcond
+
+public:
+	ObjectDictionaryEntry *Add(uint16_t _nObjIndex, uint8_t _nSubIndex, ECANDataType _eType,
+										uint32_t _nSize, uint8_t _nAccess, uint8_t *_pData = NULL);
+	ObjectDictionaryEntry *Find(uint16_t _nObjIndex, uint8_t _nSubIndex);
+	int GetCount() { return m_nEntries; }
+
+private:
+	static uint32_t Key(uint16_t _nObjIndex, uint8_t _nSubIndex) { return ((uint32_t)_nObjIndex << 8) | _nSubIndex; }
+	int LowerBound(uint32_t _nKey);
+
+private:
+	ObjectDictionaryEntry 	m_aEntries[OBJDICT_MAX_ENTRIES];	//!< In declaration order
+	uint16_t 					m_aSorted[OBJDICT_MAX_ENTRIES];		//!< Entry numbers sorted by key
+	int 							m_nEntries;
+};
+
+#endif // _OBJECTDICTIONARY_H_
@@ -17,18 +17,22 @@ static traceString 				trcPWM = nullptr;
 
 extern "C" void PWM_IRQHandler(unsigned channel);		// forward declaration
 
+static const char	osPWMTaskName[] = "PWM_CONTROL";
+
 // ----------------------------------------------------------------------------
 // Static member variables
 PWMDriver *PWMDriver::m_pTheInstance = nullptr;
 
 // ----------------------------------------------------------------------------
 //! \brief Constructor
-PWMDriver::PWMDriver(uint32_t _nPeriodDuration, uint32_t _nFrequency)		// Period is in us
+PWMDriver::PWMDriver(uint32_t _nPeriodDuration, uint32_t _nFrequency,		// Period is in us
+							osPriority_t _nPriority)
 	: UCDevice(EDevice_PWM, _nFrequency),
 	  EventSource(2 * LARGER_PWM_ID),
+	  CUC_Task(_nPriority, osPWMTaskName),
 	  m_nPeriodCounts(0),
-	  m_nPeriodDuration(0)
-	  
+	  m_nPeriodDuration(0),
+	  m_nPendingChannels(0)
 {
 uint32_t		period;
 int			frequency;
@@ -54,6 +58,12 @@ int			frequency;
 		m_pTheInstance = this;
 		Configure();
 
+		// The cycle counter time stamps the ticks for the timing statistics
+		CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+		DWT->CYCCNT = 0;
+		DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+		ResetControlStatistics();
+
 		// Clear all channels
 		for (int i = 0;i < N_PWM_CONTROL_CHANNELS;i++)
 			BOARD_SetPWMControl(i,0,eDirModeBrake);
@@ -71,10 +81,129 @@ uint32_t PWMDriver::GetPeriodDuration(void)
 	return m_nPeriodDuration;
 }
 
-//! \brief Interrupt Dispatcher
+// ----------------------------------------------------------------------------
+//! \brief Interrupt Dispatcher: latch the tick of the channel and wake the control task
+//! \details The handlers are not called here, they run in RunControlCycle.
+//!          A tick still pending from the previous period is counted as an overrun.
 void PWMDriver::DispatchInterrupt(uint8_t channel)
 {
-	Signal(channel);
+	uint32_t nStart = DWT->CYCCNT;
+	if (channel >= PWM_N_TIMERS)
+		return;
+
+	uint32_t nPrimask = DisableGlobalIRQ();
+	if (m_nPendingChannels & (1U << channel))
+		m_nOverruns++;
+	m_nPendingChannels |= (1U << channel);
+	m_anLatchCycles[channel] = nStart;
+	m_nTicks++;
+	EnableGlobalIRQ(nPrimask);
+
+	// Before the task is started the tick stays latched
+	if (IsTaskRunning())
+		SetEvent(PWM_CONTROL_EVENT, true);
+
+	uint32_t nDuration = DWT->CYCCNT - nStart;
+	if (nDuration > m_nIsrMaxCycles)
+		m_nIsrMaxCycles = nDuration;
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Run one control cycle: signal the handlers of every latched channel
+void PWMDriver::RunControlCycle(void)
+{
+	uint32_t anLatch[PWM_N_TIMERS];
+	uint32_t nStart = DWT->CYCCNT;
+
+	uint32_t nPrimask = DisableGlobalIRQ();
+	uint32_t nPending = m_nPendingChannels;
+	m_nPendingChannels = 0;
+	for (int i = 0; i < PWM_N_TIMERS; i++)
+		anLatch[i] = m_anLatchCycles[i];
+	EnableGlobalIRQ(nPrimask);
+
+	if (0 == nPending)
+		return;
+
+	// Jitter is measured on timer 0, both timers run at the same frequency
+	if (nPending & 1)
+	{
+		if (m_bLastCycleValid)
+		{
+			uint32_t nPeriod = nStart - m_nLastCycleStart;
+			if (nPeriod < m_nPeriodMinCycles)
+				m_nPeriodMinCycles = nPeriod;
+			if (nPeriod > m_nPeriodMaxCycles)
+				m_nPeriodMaxCycles = nPeriod;
+		}
+		m_nLastCycleStart = nStart;
+		m_bLastCycleValid = true;
+	}
+
+	for (uint8_t channel = 0; channel < PWM_N_TIMERS; channel++)
+	{
+		if (nPending & (1U << channel))
+		{
+			uint32_t nLatency = nStart - anLatch[channel];
+			if (nLatency > m_nLatencyMaxCycles)
+				m_nLatencyMaxCycles = nLatency;
+			Signal(channel);
+		}
+	}
+
+	uint32_t nRun = DWT->CYCCNT - nStart;
+	if (nRun > m_nRunMaxCycles)
+		m_nRunMaxCycles = nRun;
+	m_nControlCycles++;
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Entry point of the control task
+void PWMDriver::Main()
+{
+	for (;;)
+	{
+		if (WaitForEvent(PWM_CONTROL_EVENT, PWM_CONTROL_TIMEOUT))
+			RunControlCycle();
+	}
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Convert CPU cycles to ns
+uint32_t PWMDriver::CyclesToNs(uint32_t _nCycles)
+{
+	return (uint32_t)(((uint64_t)_nCycles * 1000000000ULL) / SystemCoreClock);
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Get the timing statistics of the control loop
+void PWMDriver::GetControlStatistics(PWMControlStatistics_t *_pStats)
+{
+	_pStats->Ticks = m_nTicks;
+	_pStats->ControlCycles = m_nControlCycles;
+	_pStats->Overruns = m_nOverruns;
+	_pStats->IsrMax = CyclesToNs(m_nIsrMaxCycles);
+	_pStats->LatencyMax = CyclesToNs(m_nLatencyMaxCycles);
+	_pStats->RunMax = CyclesToNs(m_nRunMaxCycles);
+	_pStats->PeriodMin = (m_nPeriodMinCycles <= m_nPeriodMaxCycles) ? CyclesToNs(m_nPeriodMinCycles) : 0;
+	_pStats->PeriodMax = CyclesToNs(m_nPeriodMaxCycles);
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Reset the timing statistics of the control loop
+void PWMDriver::ResetControlStatistics(void)
+{
+	uint32_t nPrimask = DisableGlobalIRQ();
+	m_nTicks = 0;
+	m_nOverruns = 0;
+	m_nIsrMaxCycles = 0;
+	EnableGlobalIRQ(nPrimask);
+	m_nControlCycles = 0;
+	m_nLatencyMaxCycles = 0;
+	m_nRunMaxCycles = 0;
+	m_nPeriodMinCycles = 0xFFFFFFFF;
+	m_nPeriodMaxCycles = 0;
+	m_bLastCycleValid = false;
 }
 
 // ----------------------------------------------------------------------------
@@ -348,10 +477,31 @@ bool PWMOutput::RegisterHandler(IEventHandler *_pHandler, uint32_t _nEventId)
 //! \brief PWM input interrupt handler...
 extern "C" void PWM_IRQHandler(unsigned channel)
 {
-	// TODO: Call of this from interrupt
 	PWMDriver *pPWMDriver = PWMDriver::GetInstance();
 	if (NULL != pPWMDriver)
 	{
 		pPWMDriver->DispatchInterrupt(channel);
 	}
 }
+
+// ----------------------------------------------------------------------------
+//! \brief "C" interface: get the timing statistics of the control loop
+extern "C" bool PWM_GetControlStatistics(PWMControlStatistics_t *stats)
+{
+	PWMDriver *pPWMDriver = PWMDriver::GetInstance();
+	if (NULL == pPWMDriver || NULL == stats)
+		return false;
+	pPWMDriver->GetControlStatistics(stats);
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+//! \brief "C" interface: reset the timing statistics of the control loop
+extern "C" bool PWM_ResetControlStatistics(void)
+{
+	PWMDriver *pPWMDriver = PWMDriver::GetInstance();
+	if (NULL == pPWMDriver)
+		return false;
+	pPWMDriver->ResetControlStatistics();
+	return true;
+}
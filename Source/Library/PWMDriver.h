@@ -2,6 +2,8 @@
 //! \package     ARMLibrary
 //! \file        PWMDriver.h
 //! \brief       Defines a small wrapper around the PWM component of the processor
+//! \details     The timer overflow interrupt only latches the tick and wakes the
+//!              control task, the registered device handlers run in that task.
 //! 
 //! \copyright   Copyright (C) 2011-2012 BlueBotics SA
 // ----------------------------------------------------------------------------
@@ -11,12 +13,29 @@
 
 // ----------------------------------------------------------------------------
 // Includes
+#include <stdint.h>
+#include <stdbool.h>
+
+// ----------------------------------------------------------------------------
+//! \brief Timing statistics of the PWM control loop, all durations in ns
+typedef struct
+{
+	uint32_t		Ticks;				//!< Overflow ticks latched by the interrupt
+	uint32_t		ControlCycles;		//!< Cycles run by the control task
+	uint32_t		Overruns;			//!< Ticks latched while the previous one was still pending
+	uint32_t		IsrMax;				//!< Worst-case duration of the overflow interrupt callback
+	uint32_t		LatencyMax;			//!< Worst-case delay between the interrupt and the control cycle
+	uint32_t		RunMax;				//!< Worst-case duration of a control cycle
+	uint32_t		PeriodMin;			//!< Shortest period between two control cycles of timer 0
+	uint32_t		PeriodMax;			//!< Longest period between two control cycles of timer 0
+} PWMControlStatistics_t;
+
 #if defined(__cplusplus)
 
 #include "Base.h"
 #include "UCDevice.h"
 #include "EventSource.h"
-#include "EventSource.h"
+#include "Task_CMSIS2.h"
 #include "board.h"
 
 // ----------------------------------------------------------------------------
@@ -24,6 +43,10 @@
 #define SMALLER_PWM_ID	1
 #define LARGER_PWM_ID	(N_PWM_CONTROL_CHANNELS + 1)
 
+#define PWM_N_TIMERS				2				//!< Timers raising the overflow interrupt (FTM0, FTM3)
+#define PWM_CONTROL_EVENT		0x0001		//!< Event set by the overflow interrupt
+#define PWM_CONTROL_TIMEOUT	100			//!< [ms] Wait timeout of the control task
+
 typedef enum
 {
 	eDevTimer0 = 0,
@@ -46,11 +69,18 @@ class DigitalInput;
 // ----------------------------------------------------------------------------
 //! \class      PWMDriver
 //! \brief      Encapsulate the PWM functionality of the processor
+//! \details    The overflow interrupt calls DispatchInterrupt, which only latches the
+//!             channel and wakes the control task. The task calls RunControlCycle, which
+//!             signals the registered handlers (device state machines) for each latched
+//!             channel. A simulated tick calls DispatchInterrupt and RunControlCycle in
+//!             sequence, which is the same path the interrupt and the task take.
 class PWMDriver : public UCDevice,
-                  public EventSource
+                  public EventSource,
+                  public CUC_Task
 {
 public:
-	PWMDriver(uint32_t _nPeriodDuration, uint32_t _nFrequency = 0); 	// Period is in us
+	PWMDriver(uint32_t _nPeriodDuration, uint32_t _nFrequency = 0,		// Period is in us
+				 osPriority_t _nPriority = osPriorityHigh);
     //! \cond 
 	virtual ~PWMDriver() {}
 	HideDefaultMethods(PWMDriver);
@@ -61,15 +91,40 @@ public:
 	PWMOutput* DeclareOutput(uint8_t _nId);
 	PWMOutput* GetOutput(uint8_t _nId);
 	void DispatchInterrupt(uint8_t channel);
+	void RunControlCycle(void);
+	void GetControlStatistics(PWMControlStatistics_t *_pStats);
+	void ResetControlStatistics(void);
 	uint32_t GetCountsPerPeriod(void) { return m_nPeriodCounts; }		// ticks
 //	uint32_t GetPeriodDuration(void) { return m_nPeriodDuration; }		// us
 	uint32_t GetPeriodDuration(void);
 
+protected:
+	virtual void Main();
+
+private:
+	static uint32_t CyclesToNs(uint32_t _nCycles);
+
 private:
 	static PWMDriver *m_pTheInstance;
 	uint32_t m_nPeriodCounts;
 	uint32_t m_nPeriodDuration;
 	PWMOutput* m_apOutputs[LARGER_PWM_ID + 1];
+
+	// Written by the interrupt, consumed by the control task
+	volatile uint32_t m_nPendingChannels;						//!< Bit n set: overflow of timer n latched
+	volatile uint32_t m_anLatchCycles[PWM_N_TIMERS];		//!< Cycle counter when the tick was latched
+	volatile uint32_t m_nTicks;
+	volatile uint32_t m_nOverruns;
+	volatile uint32_t m_nIsrMaxCycles;
+
+	// Owned by the control task
+	uint32_t m_nControlCycles;
+	uint32_t m_nLatencyMaxCycles;
+	uint32_t m_nRunMaxCycles;
+	uint32_t m_nPeriodMinCycles;
+	uint32_t m_nPeriodMaxCycles;
+	uint32_t m_nLastCycleStart;
+	bool m_bLastCycleValid;
 };
 
 // ----------------------------------------------------------------------------
@@ -122,13 +177,14 @@ friend class PWMDriver;
 };
 
 extern "C" void PWM_IRQHandler(unsigned channel);
+extern "C" bool PWM_GetControlStatistics(PWMControlStatistics_t *stats);
+extern "C" bool PWM_ResetControlStatistics(void);
 
 #else
 
-#include <stdint.h>
-#include <stdbool.h>
-
 extern void PWM_IRQHandler(unsigned channel);
+extern bool PWM_GetControlStatistics(PWMControlStatistics_t *stats);
+extern bool PWM_ResetControlStatistics(void);
 
 #endif
 
@@ -9,72 +9,84 @@
 // ----------------------------------------------------------------------------
 // Includes
 #include "ProcessData.h"
-#include "cmsis_os2.h"
+#include "SeqLock.h"
+
+// ----------------------------------------------------------------------------
+//! \brief Mask of the bytes really used by a 32 bits data
+static inline uint32_t ByteMask(uint8_t _nBytes)
+{
+	return (_nBytes >= 4) ? 0xFFFFFFFFu : ((1u << (_nBytes*8)) - 1);
+}
 
 // ----------------------------------------------------------------------------
 //! \brief Read data
-template <class T> T ProcessDataIn<T>::Read(bool _bFromISR)          		
+//! \details Lock-free, may be called from a task or an ISR
+template <class T> T ProcessDataIn<T>::Read()          		
 { 
-	if (!_bFromISR)
-		osMutexAcquire(m_Mutex, 0xffff);
-	T value = *m_pData;
-	if (!_bFromISR)
-		osMutexRelease(m_Mutex);
+	T value;
+	uint32_t nSeq;
+	do
+	{
+		nSeq = SeqLock::ReadBegin(m_pSeq);
+		value = *m_pData;
+	} while (SeqLock::ReadRetry(m_pSeq, nSeq));
 	return value; 
 }
 
 // ----------------------------------------------------------------------------
 //! \brief Read data
-template <class T> T ProcessDataOut<T>::Read(bool _bFromISR)          		
+template <class T> T ProcessDataOut<T>::Read()          		
 { 
-	if (!_bFromISR)
-		osMutexAcquire(m_Mutex, 0xffff);
-	T value = *m_pData;
-	if (!_bFromISR)
-		osMutexRelease(m_Mutex);
+	T value;
+	uint32_t nSeq;
+	do
+	{
+		nSeq = SeqLock::ReadBegin(m_pSeq);
+		value = *m_pData;
+	} while (SeqLock::ReadRetry(m_pSeq, nSeq));
 	return value; 
 }
 
 // ----------------------------------------------------------------------------
 //! \brief Write data
-template <class T> void ProcessDataOut<T>::Write(T _value, bool _bFromISR)
+template <class T> void ProcessDataOut<T>::Write(T _value)
 { 
-	if (!_bFromISR)
-		osMutexAcquire(m_Mutex, 0xffff);
+	uint32_t nPrimask = SeqLock::WriteBegin(m_pSeq);
 	*m_pData = _value; 
-	if (!_bFromISR)
-		osMutexRelease(m_Mutex);
+	SeqLock::WriteEnd(m_pSeq, nPrimask);
 }	
 
 // ----------------------------------------------------------------------------
 //! \brief Specialization of the Read method for unsigned 32 bits data
-template <> uint32_t ProcessDataIn<uint32_t>::Read(bool _bFromISR)
+template <> uint32_t ProcessDataIn<uint32_t>::Read()
 {	
-	uint32_t nMask = (1 << (m_nBytes*8)) -1;
-
-	if (!_bFromISR)
-		osMutexAcquire(m_Mutex, 0xffff);
-	uint32_t value = *m_pData & nMask;
-	if (!_bFromISR)
-		osMutexRelease(m_Mutex);
-
-	return value;
+	uint32_t value;
+	uint32_t nSeq;
+	do
+	{
+		nSeq = SeqLock::ReadBegin(m_pSeq);
+		value = *m_pData;
+	} while (SeqLock::ReadRetry(m_pSeq, nSeq));
+
+	return value & ByteMask(m_nBytes);
 }
 
 // ----------------------------------------------------------------------------
 //! \brief Specialization of the Read method for signed 32 bits data
-template <> int32_t ProcessDataIn<int32_t>::Read(bool _bFromISR)
+template <> int32_t ProcessDataIn<int32_t>::Read()
 {	
-	uint32_t nMask = (1 << (m_nBytes*8)) -1;
-
-	if (!_bFromISR)
-		osMutexAcquire(m_Mutex, 0xffff);
-	uint32_t value = *m_pData & nMask;
-	if (!_bFromISR)
-		osMutexRelease(m_Mutex);
+	uint32_t nMask = ByteMask(m_nBytes);
+	uint32_t value;
+	uint32_t nSeq;
+	do
+	{
+		nSeq = SeqLock::ReadBegin(m_pSeq);
+		value = (uint32_t)*m_pData;
+	} while (SeqLock::ReadRetry(m_pSeq, nSeq));
+	value &= nMask;
 
 	// Handle the sign bit
-	uint32_t nMaskNeg = (1 << ((m_nBytes*8)-1));
+	uint32_t nMaskNeg = (1u << ((m_nBytes*8)-1));
 	if (value & nMaskNeg)
 		value |= ~nMask;
 
@@ -83,64 +95,56 @@ template <> int32_t ProcessDataIn<int32_t>::Read(bool _bFromISR)
 
 // ----------------------------------------------------------------------------
 //! \brief Specialization of the Read method for unsigned 32 bits data
-template <> uint32_t ProcessDataOut<uint32_t>::Read(bool _bFromISR)
+template <> uint32_t ProcessDataOut<uint32_t>::Read()
 {	
-	uint32_t nMask = (1 << (m_nBytes*8)) -1;
-
-	if (!_bFromISR)
-		osMutexAcquire(m_Mutex, 0xffff);
-	uint32_t value = *m_pData & nMask;
-	if (!_bFromISR)
-		osMutexRelease(m_Mutex);
-
-	return value;
+	uint32_t value;
+	uint32_t nSeq;
+	do
+	{
+		nSeq = SeqLock::ReadBegin(m_pSeq);
+		value = *m_pData;
+	} while (SeqLock::ReadRetry(m_pSeq, nSeq));
+
+	return value & ByteMask(m_nBytes);
 }
 
 // ----------------------------------------------------------------------------
 //! \brief Specialization of the Write method for unsigned 32 bits data
-template <> void ProcessDataOut<uint32_t>::Write(uint32_t _value, bool _bFromISR)
+//! \details The bytes beyond m_nBytes are preserved, the read-modify-write
+//!          runs inside the write section.
+template <> void ProcessDataOut<uint32_t>::Write(uint32_t _value)
 {	
-	uint32_t nMask = (1 << (m_nBytes*8)) -1;
-	uint32_t value = _value & nMask;
-
-	if (!_bFromISR)
-		osMutexAcquire(m_Mutex, 0xffff);
-	uint32_t nMSB = *m_pData & ~nMask;
-	value |= nMSB;
-	*m_pData = value;
-	if (!_bFromISR)
-		osMutexRelease(m_Mutex);
+	uint32_t nMask = ByteMask(m_nBytes);
+
+	uint32_t nPrimask = SeqLock::WriteBegin(m_pSeq);
+	*m_pData = (_value & nMask) | (*m_pData & ~nMask);
+	SeqLock::WriteEnd(m_pSeq, nPrimask);
 }
 
 // ----------------------------------------------------------------------------
 //! \brief Specialization of the Read method for signed 32 bits data
-template <> int32_t ProcessDataOut<int32_t>::Read(bool _bFromISR)
+template <> int32_t ProcessDataOut<int32_t>::Read()
 {	
-	int32_t nMask = (1 << (m_nBytes*8)) -1;
-
-	if (!_bFromISR)
-		osMutexAcquire(m_Mutex, 0xffff);
-	int32_t value = *m_pData & nMask;
-	if (!_bFromISR)
-		osMutexRelease(m_Mutex);
-
-	return value;
+	uint32_t value;
+	uint32_t nSeq;
+	do
+	{
+		nSeq = SeqLock::ReadBegin(m_pSeq);
+		value = (uint32_t)*m_pData;
+	} while (SeqLock::ReadRetry(m_pSeq, nSeq));
+
+	return (int32_t)(value & ByteMask(m_nBytes));
 }
 
 // ----------------------------------------------------------------------------
 //! \brief Specialization of the Write method for signed 32 bits data
-template <> void ProcessDataOut<int32_t>::Write(int32_t _value, bool _bFromISR)
+template <> void ProcessDataOut<int32_t>::Write(int32_t _value)
 {	
-	int32_t nMask = (1 << (m_nBytes*8)) -1;
-	int32_t value = _value & nMask;
-
-	if (!_bFromISR)
-		osMutexAcquire(m_Mutex, 0xffff);
-	int32_t nMSB = (*m_pData) & ~nMask;
-	value |= nMSB;
-	*m_pData = value;
-	if (!_bFromISR)
-		osMutexRelease(m_Mutex);
+	uint32_t nMask = ByteMask(m_nBytes);
+
+	uint32_t nPrimask = SeqLock::WriteBegin(m_pSeq);
+	*m_pData = (int32_t)(((uint32_t)_value & nMask) | ((uint32_t)*m_pData & ~nMask));
+	SeqLock::WriteEnd(m_pSeq, nPrimask);
 }
 
 // ----------------------------------------------------------------------------
@@ -2,6 +2,9 @@
 //! \package     ARMLibrary
 //! \file        ProcessData.h
 //! \brief       Defines small classes encapsulating individual process data
+//! \details     Accesses are lock-free: each value is guarded by a sequence counter
+//!              (see SeqLock.h) so readers never block and writers are safe from
+//!              tasks and interrupts alike.
 //! 
 //! \copyright   Copyright (C) 2011-2012 BlueBotics SA
 // ----------------------------------------------------------------------------
@@ -12,8 +15,6 @@
 // ----------------------------------------------------------------------------
 // Includes
 #include "Base.h"
-#include "FreeRTOS.h"
-#include "semphr.h"
 
 // ----------------------------------------------------------------------------
 //! \class      ProcessDataIn
@@ -22,19 +23,19 @@ template<class T>
 class ProcessDataIn
 {
 public:
-	ProcessDataIn(uint8_t* _pData, uint8_t _nBytes, SemaphoreHandle_t _mutex): m_nBytes(_nBytes), m_pData((T*)_pData), m_Mutex(_mutex) {}
+	ProcessDataIn(uint8_t* _pData, uint8_t _nBytes, volatile uint32_t *_pSeq): m_nBytes(_nBytes), m_pData((volatile T*)_pData), m_pSeq(_pSeq) {}
     //! \cond 
 	virtual ~ProcessDataIn() {}
 	HideDefaultMethods(ProcessDataIn);
     //! \endcond 
 
 public:
- 	T Read(bool _bFromISR = false);
+ 	T Read();
 
 private:
 	uint8_t 					m_nBytes;
-	T* 						m_pData;
-	SemaphoreHandle_t 	m_Mutex;
+	volatile T* 			m_pData;
+	volatile uint32_t *	m_pSeq;				//!< Sequence counter of the value
 };
 
 // ----------------------------------------------------------------------------
@@ -44,20 +45,20 @@ template<class T>
 class ProcessDataOut
 {
 public:
-	ProcessDataOut(uint8_t* _pData, uint8_t _nBytes, SemaphoreHandle_t _mutex): m_nBytes(_nBytes), m_pData((T*)_pData), m_Mutex(_mutex) {}
+	ProcessDataOut(uint8_t* _pData, uint8_t _nBytes, volatile uint32_t *_pSeq): m_nBytes(_nBytes), m_pData((volatile T*)_pData), m_pSeq(_pSeq) {}
    //! \cond 
 	virtual ~ProcessDataOut() {}
 	HideDefaultMethods(ProcessDataOut);
    //! \endcond 
 
 public:
- 	T Read(bool _bFromISR = false);
-	void Write(T _value, bool _bFromISR = false);
+ 	T Read();
+	void Write(T _value);
 
 private:
 	uint8_t 					m_nBytes;
-	T *						m_pData;
-	SemaphoreHandle_t 	m_Mutex;
+	volatile T *			m_pData;
+	volatile uint32_t *	m_pSeq;				//!< Sequence counter of the value
 };
 
 
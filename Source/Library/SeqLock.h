@@ -0,0 +1,66 @@
+// ---------------------------------------------------------------------------
+//! \package     ARMLibrary
+//! \file        SeqLock.h
+//! \brief       Sequence lock for data shared between tasks and interrupts
+//! \details     <UL><LI>Readers never block: they retry when a write happened meanwhile</LI>
+//!                  <LI>Writers bump the sequence to odd, write, and bump it back to even
+//!                      with interrupts masked, so task and ISR writers cannot interleave</LI></UL>
+//!
+//!              \par Usage (reader):
+//!                   do { seq = SeqLock::ReadBegin(&nSeq); v = data; } while (SeqLock::ReadRetry(&nSeq, seq));
+//!              \par Usage (writer):
+//!                   mask = SeqLock::WriteBegin(&nSeq); data = v; SeqLock::WriteEnd(&nSeq, mask);
+//!
+//! \copyright   Copyright (C) 2011-2012 BlueBotics SA
+// ----------------------------------------------------------------------------
+
+#ifndef _SEQLOCK_H_
+#define _SEQLOCK_H_
+
+// ----------------------------------------------------------------------------
+// Includes
+#include "fsl_common.h"
+
+// ----------------------------------------------------------------------------
+//! \class      SeqLock
+//! \brief      Sequence lock primitives operating on a 32 bits sequence counter
+class SeqLock
+{
+public:
+	//! \brief Start a read section, returns the sequence to pass to ReadRetry
+	static inline uint32_t ReadBegin(const volatile uint32_t *_pSeq)
+	{
+		uint32_t nSeq;
+		// Odd: a writer on another context is busy (cannot happen with a single core)
+		while ((nSeq = *_pSeq) & 1)
+			;
+		__DMB();
+		return nSeq;
+	}
+
+	//! \brief End a read section, returns true if the data must be read again
+	static inline bool ReadRetry(const volatile uint32_t *_pSeq, uint32_t _nSeq)
+	{
+		__DMB();
+		return *_pSeq != _nSeq;
+	}
+
+	//! \brief Start a write section, returns the interrupt mask to pass to WriteEnd
+	static inline uint32_t WriteBegin(volatile uint32_t *_pSeq)
+	{
+		uint32_t nPrimask = DisableGlobalIRQ();
+		*_pSeq = *_pSeq + 1;
+		__DMB();
+		return nPrimask;
+	}
+
+	//! \brief End a write section
+	static inline void WriteEnd(volatile uint32_t *_pSeq, uint32_t _nPrimask)
+	{
+		__DMB();
+		*_pSeq = *_pSeq + 1;
+		EnableGlobalIRQ(_nPrimask);
+	}
+};
+
+#endif // _SEQLOCK_H_
@@ -14,7 +14,7 @@
 #if defined(__cplusplus)
 
 #include "cmsis_os2.h"
-#include "base.h"
+#include "Base.h"
 #endif
 #include "FreeRTOS.h"
 #include "task.h"
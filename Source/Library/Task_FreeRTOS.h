@@ -11,7 +11,7 @@
 
 // ----------------------------------------------------------------------------
 // Includes
-#include "base.h"
+#include "Base.h"
 #include "FreeRTOS.h"
 #include "task.h"
 #include "semphr.h"
@@ -11,7 +11,7 @@
 
 // ----------------------------------------------------------------------------
 // Includes
-#include "base.h"
+#include "Base.h"
 
 // ----------------------------------------------------------------------------
 //! \class      Task
@@ -9,7 +9,7 @@
 // ----------------------------------------------------------------------------
 // Includes
 #include "Timer.h"
-#include "base.h"
+#include "Base.h"
 #include "board.h"
 #include "fsl_ftm.h"
 #include "fsl_clock.h"
@@ -24,7 +24,6 @@ extern "C" void TIMER1_IRQHandler(uint64_t value,uint32_t flags);
 Timer* Timer::m_apTimers[2];
 CaptureInput* CaptureInput::m_apCaptures[2][3];
 uint32_t SystemTime::m_nTickDuration;
-uint64_t SystemTime::m_nTime; 
 uint64_t SystemTime::m_uWaitTime; 
 
 // ----------------------------------------------------------------------------
@@ -336,12 +335,21 @@ void SystemTime::Update(void)
 //! \brief Gets the System Time in ms
 uint32_t SystemTime::GetTime(void)
 {
-uint64_t		system_time;
-	
-	if (!BOARD_getSystemTime(&system_time))
-		return 0;
-	m_nTime = system_time;
-	return system_time / 1000000;		// System Time in ms
+	return (uint32_t)BOARD_getSystemTime_ms();
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Gets the System Time in us
+uint64_t SystemTime::GetTimeUs(void)
+{
+	return BOARD_getSystemTime_us();
+}
+
+// ----------------------------------------------------------------------------
+//! \brief Gets the System Time in ns
+uint64_t SystemTime::GetTimeNs(void)
+{
+	return BOARD_getSystemTime_ns();
 }
 
 // ----------------------------------------------------------------------------
@@ -352,13 +360,13 @@ uint64_t				uSystemTime;
 	
 	if (wait_time != 0)
 	{
-		BOARD_getSystemTime(&uSystemTime);
+		uSystemTime = BOARD_getSystemTime_ns();
 		m_uWaitTime = uSystemTime + (uint64_t)wait_time * 1000000;
 		return true;
 	}
 	else
 	{
-		BOARD_getSystemTime(&uSystemTime);
+		uSystemTime = BOARD_getSystemTime_ns();
 		return (uSystemTime >= m_uWaitTime);
 	}
 }
@@ -92,10 +92,11 @@ public:
     static void Init(uint16_t _nTickDuration);    	// Initialization: Specify the duration in ns of a system tick
     static void Update(void);                     	// Must be called periodically (every few ms)
     static uint32_t GetTime(void);						// Return the number of ms elapsed since startup
+    static uint64_t GetTimeUs(void);					// Return the number of us elapsed since startup
+    static uint64_t GetTimeNs(void);					// Return the number of ns elapsed since startup
 	 static bool Wait(uint32_t wait_time);				// Wait for a given time (in ms)
 private:
     static uint32_t m_nTickDuration;  					// [micro seconds]
-    static uint64_t m_nTime;          					// [ns]
 	 static uint64_t m_uWaitTime;							// Wait Time in ms
 };
 
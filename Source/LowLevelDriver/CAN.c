@@ -19,10 +19,27 @@ static traceString 				trcCAN = NULL;
 
 flexcan_config_t           CAN0_Config;
 
+/* Single producer (CAN ISR) / single consumer RX ring. The indexes are free
+   running, only the ISR writes CAN_Ptr_In_RX and only the reader writes
+   CAN_Ptr_Out_RX, so no locking is needed */
+#define CAN_RX_MESSAGE_BUFFER_MASK     (CAN_RX_MESSAGE_BUFFER_DEPTH - 1)
+
 static CANmessage_t        CAN_RXbuffer[CAN_NR_IF][CAN_RX_MESSAGE_BUFFER_DEPTH];
 static volatile uint32_t   CAN_Ptr_In_RX[CAN_NR_IF] = {0};
 static volatile uint32_t   CAN_Ptr_Out_RX[CAN_NR_IF] = {0};
-static volatile uint8_t    CAN_RX_buffer_full[CAN_NR_IF] = {0};
+static volatile CANstatistics_t  CAN_Statistics[CAN_NR_IF];
+static CAN_RxCallback_t    CAN_RxCallback[CAN_NR_IF] = {NULL};
+static void                *CAN_RxCallbackArg[CAN_NR_IF] = {NULL};
+
+/* TX frames waiting for a free mailbox, sorted by descending arbitration key
+   so that the highest priority frame is always the last one. Frames with the
+   same key keep their FIFO order, only one of them is in a mailbox at a time:
+   the FlexCAN sends equal IDs lowest mailbox first, not in the queued order */
+static flexcan_frame_t     CAN_TXqueue[CAN_NR_IF][CAN_TX_QUEUE_DEPTH];
+static uint32_t            CAN_TXqueueKey[CAN_NR_IF][CAN_TX_QUEUE_DEPTH];
+static volatile uint32_t   CAN_TXqueueCount[CAN_NR_IF] = {0};
+static volatile uint32_t   CAN_TXmbBusy[CAN_NR_IF] = {0};
+static uint32_t            CAN_TXmbKey[CAN_NR_IF][CAN_TX_MAILBOX_NUM];
 
 const CANdescriptor_t      CAN_DefaultDescriptor[CAN_NR_IF] = {
                               {
@@ -161,6 +178,270 @@ static void CAN_SetSelfReception(CAN_Type *CanIF,bool enable)
 	CAN_EnterFreezeMode(CanIF);
 }
 
+/*!
+ ******************************************************************************
+ *	Resets the TX mailboxes and drops all queued TX frames
+ * \param[in]     channel     CAN channel
+ * \param[in]     CanIF       CAN Interface Pointer
+ ******************************************************************************
+*/
+static void CAN_TxReset(unsigned channel,CAN_Type *CanIF)
+{
+uint32_t    primask;
+
+   primask = DisableGlobalIRQ();
+   for (int i = 0;i < CAN_TX_MAILBOX_NUM;i++)
+      FLEXCAN_SetTxMbConfig(CanIF,CAN_TX_MAILBOX_INDEX + i,true);
+   FLEXCAN_ClearMbStatusFlags(CanIF,CAN_TX_MAILBOX_MASK);
+   CAN_TXqueueCount[channel] = 0;
+   CAN_TXmbBusy[channel] = 0;
+   EnableGlobalIRQ(primask);
+}
+
+/*!
+ ******************************************************************************
+ *	Gets the arbitration key of a frame: the fields of the arbitration phase in
+ * the order they are sent, base ID, RTR (SRR of an extended frame), IDE, ID
+ * extension and RTR of an extended frame. The lower key wins the bus
+ * \param[in]     frame       Frame
+ * \return        Arbitration key
+ ******************************************************************************
+*/
+static uint32_t CAN_TxArbitrationKey(const flexcan_frame_t *frame)
+{
+uint32_t    key;
+
+   key = ((frame->id >> CAN_ID_STD_SHIFT) & 0x7FF) << 21;
+   if (frame->format == kFLEXCAN_FrameFormatExtend)
+   {
+      key |= (1u << 20) | (1u << 19) | ((frame->id & 0x3FFFF) << 1);
+      if (frame->type == kFLEXCAN_FrameTypeRemote)
+         key |= 1;
+   }
+   else if (frame->type == kFLEXCAN_FrameTypeRemote)
+      key |= 1u << 20;
+   return key;
+}
+
+/*!
+ ******************************************************************************
+ *	Gets a free TX mailbox, if no frame with the same arbitration key is in one
+ * \param[in]     channel     CAN channel
+ * \param[in]     key         Arbitration key of the frame
+ * \return        Mailbox number (0 .. CAN_TX_MAILBOX_NUM - 1), -1 if none
+ ******************************************************************************
+*/
+static int CAN_TxGetMailbox(unsigned channel,uint32_t key)
+{
+uint32_t    busy = CAN_TXmbBusy[channel];
+int         mb = -1;
+
+   for (int i = 0;i < CAN_TX_MAILBOX_NUM;i++)
+   {
+      if ((busy & (1u << (CAN_TX_MAILBOX_INDEX + i))) == 0)
+      {
+         if (mb < 0)
+            mb = i;
+      }
+      else if (CAN_TXmbKey[channel][i] == key)
+         return -1;
+   }
+   return mb;
+}
+
+/*!
+ ******************************************************************************
+ *	Writes a frame to a TX mailbox
+ * \param[in]     channel     CAN channel
+ * \param[in]     CanIF       CAN Interface Pointer
+ * \param[in]     mb          Mailbox number (0 .. CAN_TX_MAILBOX_NUM - 1)
+ * \param[in]     frame       Frame to be sent
+ * \param[in]     key         Arbitration key of the frame
+ * \return        true if success, false else
+ ******************************************************************************
+*/
+static bool CAN_TxWriteMailbox(unsigned channel,CAN_Type *CanIF,int mb,const flexcan_frame_t *frame,uint32_t key)
+{
+   if (FLEXCAN_WriteTxMb(CanIF,CAN_TX_MAILBOX_INDEX + mb,frame) != kStatus_Success)
+      return false;
+   CAN_TXmbKey[channel][mb] = key;
+   CAN_TXmbBusy[channel] |= 1u << (CAN_TX_MAILBOX_INDEX + mb);
+   return true;
+}
+
+/*!
+ ******************************************************************************
+ *	Moves the queued frames to the free TX mailboxes, highest priority first.
+ * A frame stays queued while one with the same arbitration key is in a
+ * mailbox, lower priority frames may pass it.
+ * Must be called with interrupts disabled or from the CAN ISR.
+ * \param[in]     channel     CAN channel
+ * \param[in]     CanIF       CAN Interface Pointer
+ ******************************************************************************
+*/
+static void CAN_TxFillMailboxes(unsigned channel,CAN_Type *CanIF)
+{
+uint32_t    count = CAN_TXqueueCount[channel];
+uint32_t    i;
+int         mb;
+
+   for (i = count;i > 0;i--)
+   {
+      if ((CAN_TXmbBusy[channel] & CAN_TX_MAILBOX_MASK) == CAN_TX_MAILBOX_MASK)
+         break;
+      if ((mb = CAN_TxGetMailbox(channel,CAN_TXqueueKey[channel][i - 1])) < 0)
+         continue;
+      if (!CAN_TxWriteMailbox(channel,CanIF,mb,&(CAN_TXqueue[channel][i - 1]),CAN_TXqueueKey[channel][i - 1]))
+         break;
+      // the frames behind keep their order
+      for (uint32_t k = i;k < count;k++)
+      {
+         CAN_TXqueue[channel][k - 1] = CAN_TXqueue[channel][k];
+         CAN_TXqueueKey[channel][k - 1] = CAN_TXqueueKey[channel][k];
+      }
+      count--;
+   }
+   CAN_TXqueueCount[channel] = count;
+}
+
+/*!
+ ******************************************************************************
+ *	Releases the TX mailboxes whose transmission has completed and refills
+ * them from the TX queue.
+ * Must be called with interrupts disabled or from the CAN ISR.
+ * \param[in]     channel     CAN channel
+ * \param[in]     CanIF       CAN Interface Pointer
+ * \param[in]     flags       MB status flags
+ ******************************************************************************
+*/
+static void CAN_TxCompleteHandler(unsigned channel,CAN_Type *CanIF,uint32_t flags)
+{
+uint32_t    done;
+
+   done = flags & CAN_TX_MAILBOX_MASK & CAN_TXmbBusy[channel];
+   if (done == 0)
+      return;
+   FLEXCAN_ClearMbStatusFlags(CanIF,done);
+   CAN_TXmbBusy[channel] &= ~done;
+   CAN_TxFillMailboxes(channel,CanIF);
+}
+
+/*!
+ ******************************************************************************
+ *	Queues a CAN frame for transmission. The frame is written directly to a
+ * free TX mailbox if one is available and no frame with the same arbitration
+ * key is in a mailbox, else it is inserted in the TX queue according to its
+ * priority. Does not wait for the transmission.
+ * \param[in]     channel     CAN channel
+ * \param[in]     CanIF       CAN Interface Pointer
+ * \param[in]     frame       Frame to be sent
+ * \return        true if the frame has been queued, false if the queue is full
+ ******************************************************************************
+*/
+static bool CAN_TxQueueFrame(unsigned channel,CAN_Type *CanIF,const flexcan_frame_t *frame)
+{
+uint32_t    primask;
+uint32_t    count;
+uint32_t    key;
+uint32_t    i;
+int         mb;
+bool        ret = true;
+
+   key = CAN_TxArbitrationKey(frame);
+   primask = DisableGlobalIRQ();
+   // reclaim mailboxes even if the CAN IRQ is not enabled
+   CAN_TxCompleteHandler(channel,CanIF,FLEXCAN_GetMbStatusFlags(CanIF,CAN_TX_MAILBOX_MASK));
+   // no queued frame has the key if it is not in a mailbox and one is free
+   if ((mb = CAN_TxGetMailbox(channel,key)) >= 0 &&
+       CAN_TxWriteMailbox(channel,CanIF,mb,frame,key))
+   {
+      CAN_Statistics[channel].TX_Frames++;
+   }
+   else if ((count = CAN_TXqueueCount[channel]) < CAN_TX_QUEUE_DEPTH)
+   {
+      // frames with the same or a higher priority stay behind, FIFO order is kept for equal keys
+      for (i = count;i > 0 && CAN_TXqueueKey[channel][i - 1] <= key;i--)
+      {
+         CAN_TXqueue[channel][i] = CAN_TXqueue[channel][i - 1];
+         CAN_TXqueueKey[channel][i] = CAN_TXqueueKey[channel][i - 1];
+      }
+      CAN_TXqueue[channel][i] = *frame;
+      CAN_TXqueueKey[channel][i] = key;
+      CAN_TXqueueCount[channel] = count + 1;
+      CAN_Statistics[channel].TX_Frames++;
+      if (count + 1 > CAN_Statistics[channel].TX_MaxSize)
+         CAN_Statistics[channel].TX_MaxSize = count + 1;
+   }
+   else
+   {
+      CAN_Statistics[channel].TX_Lost++;
+      ret = false;
+   }
+   EnableGlobalIRQ(primask);
+   return ret;
+}
+
+/*!
+ ******************************************************************************
+ *	Fills the ID and payload of a FlexCAN frame
+ * \param[in]     channel     	CAN channel
+ * \param[out]    txFrame     	Frame to be filled
+ * \param[in]     address     	CAN ID
+ * \param[in]     IDisExtended  	Set (true) if the CAN ID is an extended ID
+ * \param[in]     payload     	CAN Payload
+ * \param[in]     len         	CAN Payload length
+ ******************************************************************************
+*/
+static void CAN_BuildFrame(unsigned channel,flexcan_frame_t *txFrame,uint32_t address,
+                           bool IDisExtended,const uint8_t *payload,int len)
+{
+int                  i;
+
+   if (CAN_Descriptor[channel].CAN_HasExtendedID && IDisExtended)
+   {
+      txFrame->id = FLEXCAN_ID_EXT(address);
+      txFrame->format = kFLEXCAN_FrameFormatExtend;
+   }
+   else
+   {
+      txFrame->id = FLEXCAN_ID_STD(address);
+      txFrame->format = kFLEXCAN_FrameFormatStandard;
+   }
+   txFrame->length = len;
+   txFrame->dataWord0 = 0;
+   txFrame->dataWord1 = 0;
+   for (i = 0;i < len;i++)
+   {
+      switch (i)
+      {
+         case 0:
+            txFrame->dataByte0 = payload[0];
+            break;
+         case 1:
+            txFrame->dataByte1 = payload[1];
+            break;
+         case 2:
+            txFrame->dataByte2 = payload[2];
+            break;
+         case 3:
+            txFrame->dataByte3 = payload[3];
+            break;
+         case 4:
+            txFrame->dataByte4 = payload[4];
+            break;
+         case 5:
+            txFrame->dataByte5 = payload[5];
+            break;
+         case 6:
+            txFrame->dataByte6 = payload[6];
+            break;
+         case 7:
+            txFrame->dataByte7 = payload[7];
+            break;
+      }
+   }
+}
+
 /*!
  ******************************************************************************
  *	Internal CAN Initialize Routine
@@ -241,13 +522,14 @@ uint32_t                   mask;
    for (int i = 0;i < ptr->CAN_N_RX_filters;i++)
       FLEXCAN_SetRxIndividualMask(ptr->CAN_IF,i,mask);
    FLEXCAN_SetRxFifoConfig(ptr->CAN_IF,&CAN_FIFO_Config,true);
+   CAN_TxReset(channel,ptr->CAN_IF);
    if (enable)
    {
       NVIC_SetPriority(ptr->CAN_IRQ,ptr->CAN_IRQ_Prio);
       NVIC_EnableIRQ(ptr->CAN_IRQ);
       NVIC_SetPriority(ptr->CAN_Error_IRQ,ptr->CAN_ERR_IRQ_Prio);
       NVIC_EnableIRQ(ptr->CAN_Error_IRQ);
-      FLEXCAN_EnableMbInterrupts(ptr->CAN_IF,kFLEXCAN_RxFifoFrameAvlFlag);
+      FLEXCAN_EnableMbInterrupts(ptr->CAN_IF,kFLEXCAN_RxFifoFrameAvlFlag | CAN_TX_MAILBOX_MASK);
 		FLEXCAN_EnableInterrupts(ptr->CAN_IF,kFLEXCAN_ErrorInterruptEnable);
       FLEXCAN_Enable(ptr->CAN_IF,true);
    }
@@ -560,74 +842,18 @@ bool CAN_GetParameters(unsigned channel,unsigned *baudrate,uint32_t *IDmask,
 bool CAN_SendMessage(unsigned channel,uint32_t address,bool IDisExtended,uint8_t *payload,int len)
 {
 flexcan_frame_t      txFrame;
-int                  i;
-uint64_t             timer;
 CAN_Type             *CAN_IF;
 
    if ((CAN_IF = CAN_GetIfPtr(channel)) == NULL)
       return false;
+   if (len < 0 || len > 8)
+      return false;
 #if TRACEALYZER != 0 && TRC_CAN != 0
 	vTracePrintF(trcCAN,"Send CAN Message, Addr = %08X",address);
 #endif
-   FLEXCAN_SetTxMbConfig(CAN_IF,CAN_TX_MAILBOX_INDEX,true);
-   if (CAN_Descriptor[channel].CAN_HasExtendedID && IDisExtended)
-   {
-      txFrame.id = FLEXCAN_ID_EXT(address);
-      txFrame.format = kFLEXCAN_FrameFormatExtend;
-   }
-   else
-   {
-      txFrame.id = FLEXCAN_ID_STD(address);
-      txFrame.format = kFLEXCAN_FrameFormatStandard;
-   }
-   txFrame.length = len;
+   CAN_BuildFrame(channel,&txFrame,address,IDisExtended,payload,len);
 	txFrame.type = kFLEXCAN_FrameTypeData;
-   for (i = 0;i < len;i++)
-   {
-      switch (i)
-      {
-         case 0:
-            txFrame.dataByte0 = payload[0];
-            break;
-         case 1:
-            txFrame.dataByte1 = payload[1];
-            break;
-         case 2:
-            txFrame.dataByte2 = payload[2];
-            break;
-         case 3:
-            txFrame.dataByte3 = payload[3];
-            break;
-         case 4:
-            txFrame.dataByte4 = payload[4];
-            break;
-         case 5:
-            txFrame.dataByte5 = payload[5];
-            break;
-         case 6:
-            txFrame.dataByte6 = payload[6];
-            break;
-         case 7:
-            txFrame.dataByte7 = payload[7];
-            break;
-      }
-   }
-   FLEXCAN_WriteTxMb(CAN_IF,CAN_TX_MAILBOX_INDEX,&txFrame);
-   timer = Now();
-   while (!FLEXCAN_GetMbStatusFlags(CAN_IF,1 << CAN_TX_MAILBOX_INDEX))
-   {
-      if (DiffTime(timer) > CAN_TX_TIMEOUT)
-      {
-         // Abort sending the CAN message
-         FLEXCAN_SetTxMbConfig(CAN_IF,CAN_TX_MAILBOX_INDEX,true);
-         return false;
-      }
-      Sleep(2);
-   }
-	FLEXCAN_ClearMbStatusFlags(CAN_IF,1 << CAN_TX_MAILBOX_INDEX);
-	Sleep(2);
-//   FLEXCAN_ClearMbStatusFlags(CAN_IF,kFLEXCAN_RxFifoFrameAvlFlag);
-   return true;
+   return CAN_TxQueueFrame(channel,CAN_IF,&txFrame);
 }
 
 /*!
@@ -644,7 +870,6 @@ CAN_Type             *CAN_IF;
 bool CAN_RequestMessage(unsigned channel,uint32_t address,bool IDisExtended)
 {
 flexcan_frame_t      txFrame;
-uint64_t             timer;
 CAN_Type             *CAN_IF;
 
    if ((CAN_IF = CAN_GetIfPtr(channel)) == NULL)
@@ -652,46 +877,39 @@ CAN_Type             *CAN_IF;
 #if TRACEALYZER != 0 && TRC_CAN != 0
 	vTracePrintF(trcCAN,"Request CAN Message, Addr = %08X",address);
 #endif
-   FLEXCAN_SetTxMbConfig(CAN_IF,CAN_TX_MAILBOX_INDEX,true);
-   if (CAN_Descriptor[channel].CAN_HasExtendedID && IDisExtended)
-   {
-      txFrame.id = FLEXCAN_ID_EXT(address);
-      txFrame.format = kFLEXCAN_FrameFormatExtend;
-   }
-   else
-   {
-      txFrame.id = FLEXCAN_ID_STD(address);
-      txFrame.format = kFLEXCAN_FrameFormatStandard;
-   }
-   txFrame.length = 0;
+   CAN_BuildFrame(channel,&txFrame,address,IDisExtended,NULL,0);
 	txFrame.type = kFLEXCAN_FrameTypeRemote;
-   FLEXCAN_WriteTxMb(CAN_IF,CAN_TX_MAILBOX_INDEX,&txFrame);
-   timer = Now();
-   while (!FLEXCAN_GetMbStatusFlags(CAN_IF,1 << CAN_TX_MAILBOX_INDEX))
-   {
-      if (DiffTime(timer) > CAN_TX_TIMEOUT)
-      {
-         // Abort sending the CAN message
-         FLEXCAN_SetTxMbConfig(CAN_IF,CAN_TX_MAILBOX_INDEX,true);
-         return false;
-      }
-      Sleep(2);
-   }
-//   FLEXCAN_ClearMbStatusFlags(CAN_IF,kFLEXCAN_RxFifoFrameAvlFlag);
-   return true;
+   return CAN_TxQueueFrame(channel,CAN_IF,&txFrame);
 }
 
-static void CAN_MessageReceivedHandler(unsigned channel,CAN_Type *CAN_IF)
+/*!
+ ******************************************************************************
+ *	Reads a frame from the RX FIFO and stores it in the RX message buffer
+ * \param[in]     channel     CAN channel
+ * \param[in]     CAN_IF      CAN Interface Pointer
+ * \return        true if a frame has been stored, false else
+ ******************************************************************************
+*/
+static bool CAN_MessageReceivedHandler(unsigned channel,CAN_Type *CAN_IF)
 {
 flexcan_frame_t   rxFrame;
 CANmessage_t      *ptr;
+uint32_t          in,used;
 
    if (FLEXCAN_ReadRxFifo(CAN_IF,&rxFrame) != kStatus_Success)
-      return;
+      return false;
 #if TRACEALYZER != 0 && TRC_CAN != 0
 	vTracePrint(trcCAN,"Request CAN Message RX Handler");
 #endif
-   ptr = &(CAN_RXbuffer[channel][CAN_Ptr_In_RX[channel]]);
+   in = CAN_Ptr_In_RX[channel];
+   used = in - CAN_Ptr_Out_RX[channel];
+   if (used >= CAN_RX_MESSAGE_BUFFER_DEPTH)
+   {
+      // buffer full, the frame is dropped but accounted for
+      CAN_Statistics[channel].RX_Lost++;
+      return false;
+   }
+   ptr = &(CAN_RXbuffer[channel][in & CAN_RX_MESSAGE_BUFFER_MASK]);
    ptr->len = rxFrame.length;
    if (rxFrame.format == kFLEXCAN_FrameFormatExtend)
 	{
@@ -703,46 +921,43 @@ CANmessage_t      *ptr;
 		ptr->isExtID = false;
       ptr->ID = (rxFrame.id >> 18) & 0x7FF;
 	}
-   if (!CAN_RX_buffer_full[channel])
+   for (int i = 0;i < rxFrame.length;i++)
    {
-      for (int i = 0;i < rxFrame.length;i++)
+      switch (i)
       {
-         switch (i)
-         {
-            case 0:
-               ptr->payload[0] = rxFrame.dataByte0;
-               break;
-            case 1:
-               ptr->payload[1] = rxFrame.dataByte1;
-               break;
-            case 2:
-               ptr->payload[2] = rxFrame.dataByte2;
-               break;
-            case 3:
-               ptr->payload[3] = rxFrame.dataByte3;
-               break;
-            case 4:
-               ptr->payload[4] = rxFrame.dataByte4;
-               break;
-            case 5:
-               ptr->payload[5] = rxFrame.dataByte5;
-               break;
-            case 6:
-               ptr->payload[6] = rxFrame.dataByte6;
-               break;
-            case 7:
-               ptr->payload[7] = rxFrame.dataByte7;
-               break;
-         }
+         case 0:
+            ptr->payload[0] = rxFrame.dataByte0;
+            break;
+         case 1:
+            ptr->payload[1] = rxFrame.dataByte1;
+            break;
+         case 2:
+            ptr->payload[2] = rxFrame.dataByte2;
+            break;
+         case 3:
+            ptr->payload[3] = rxFrame.dataByte3;
+            break;
+         case 4:
+            ptr->payload[4] = rxFrame.dataByte4;
+            break;
+         case 5:
+            ptr->payload[5] = rxFrame.dataByte5;
+            break;
+         case 6:
+            ptr->payload[6] = rxFrame.dataByte6;
+            break;
+         case 7:
+            ptr->payload[7] = rxFrame.dataByte7;
+            break;
       }
-      CAN_Ptr_In_RX[channel]++;
-      if (CAN_Ptr_In_RX[channel] >= CAN_RX_MESSAGE_BUFFER_DEPTH)
-         CAN_Ptr_In_RX[channel] = 0;
-      if (CAN_Ptr_In_RX[channel] == CAN_Ptr_Out_RX[channel])
-         CAN_RX_buffer_full[channel] = 1;
-      else
-         CAN_RX_buffer_full[channel] = 0;
    }
+   // make the frame visible before publishing the new write index
+   __DMB();
+   CAN_Ptr_In_RX[channel] = in + 1;
+   CAN_Statistics[channel].RX_Frames++;
+   if (used + 1 > CAN_Statistics[channel].RX_MaxSize)
+      CAN_Statistics[channel].RX_MaxSize = used + 1;
+   return true;
 }
 
 void CAN_ErrorIRQhandler(unsigned channel)
@@ -752,6 +967,8 @@ CAN_Type    *CAN_IF;
    if ((CAN_IF = CAN_GetIfPtr(channel)) != NULL)
    {
 		mCAN_Error = FLEXCAN_GetStatusFlags(CAN_IF);
+		if ((mCAN_Error & CAN_ESR1_ERRINT_MASK) != 0)
+			CAN_Statistics[channel].ErrorFrames++;
 		FLEXCAN_ClearStatusFlags(CAN_IF,CAN_ESR1_ERRINT_MASK);
 	}
 }
@@ -760,24 +977,56 @@ void CAN_MessageIRQhandler(unsigned channel)
 {
 uint32_t    StatusFlags;
 CAN_Type    *CAN_IF;
+bool        received = false;
 
    if ((CAN_IF = CAN_GetIfPtr(channel)) != NULL)
 	{
 		StatusFlags = FLEXCAN_GetMbStatusFlags(CAN_IF,0xFFFFFFFF);
 //   	FLEXCAN_ClearMbStatusFlags(CAN_IF,0xFFFFFFFF);
 		if ((StatusFlags & kFLEXCAN_RxFifoWarningFlag) != 0)
+		{
 			CAN_Descriptor[channel].CAN_Error_Status |= eCANerr_RXfifo_Warning;
+			CAN_Statistics[channel].RX_FifoWarning++;
+		}
 		if ((StatusFlags & kFLEXCAN_RxFifoOverflowFlag) != 0)
+		{
 			CAN_Descriptor[channel].CAN_Error_Status |= eCANerr_RXfifo_Overflow;
+			CAN_Statistics[channel].RX_FifoOverflow++;
+		}
 		if ((StatusFlags & kFLEXCAN_RxFifoFrameAvlFlag) != 0)
-			CAN_MessageReceivedHandler(channel,CAN_IF);
+			received = CAN_MessageReceivedHandler(channel,CAN_IF);
+		if ((StatusFlags & CAN_TX_MAILBOX_MASK) != 0)
+			CAN_TxCompleteHandler(channel,CAN_IF,StatusFlags);
 		FLEXCAN_ClearMbStatusFlags(CAN_IF,
 			kFLEXCAN_RxFifoWarningFlag |
 			kFLEXCAN_RxFifoOverflowFlag |
 			kFLEXCAN_RxFifoFrameAvlFlag);
+		// wake up the reader as soon as the frame is in the buffer
+		if (received && (CAN_RxCallback[channel] != NULL))
+			CAN_RxCallback[channel](channel,CAN_RxCallbackArg[channel]);
 	}
 }
 
+/*!
+ ******************************************************************************
+ *	Registers the function called from the CAN message ISR each time a frame
+ * has been stored in the RX message buffer. Pass NULL to remove it.
+ * \param[in]     channel     CAN channel
+ * \param[in]     callback    Callback function (ISR context)
+ * \param[in]     arg         Argument passed to the callback
+ * \return        true if success, false else
+ ******************************************************************************
+*/
+bool CAN_SetRxCallback(unsigned channel,CAN_RxCallback_t callback,void *arg)
+{
+   if (channel >= CAN_NR_IF)
+      return false;
+   CAN_RxCallback[channel] = NULL;
+   CAN_RxCallbackArg[channel] = arg;
+   CAN_RxCallback[channel] = callback;
+   return true;
+}
+
 uint32_t CAN_getErrorFlags(unsigned channel,uint8_t clear)
 {
 uint32_t    err_flags;
@@ -802,31 +1051,29 @@ bool CAN_isRxMessageAvailable(unsigned channel)
 {
    if (channel >= CAN_NR_IF)
       return false;
-   if (CAN_Ptr_In_RX[channel] == CAN_Ptr_Out_RX[channel] && !CAN_RX_buffer_full[channel])
-      return false;
-   else
-      return true;
+   return CAN_Ptr_In_RX[channel] != CAN_Ptr_Out_RX[channel];
 }
 
 int CAN_NumberOfRxMessageAvailable(unsigned channel)
 {
    if (channel >= CAN_NR_IF)
       return 0;
-   int n = CAN_Ptr_In_RX[channel] - CAN_Ptr_Out_RX[channel];
-   if (n < 0)
-      n += CAN_RX_MESSAGE_BUFFER_DEPTH;
-   return n;
+   return (int)(CAN_Ptr_In_RX[channel] - CAN_Ptr_Out_RX[channel]);
 }
 
 void CAN_clearRxMessageBufferQueue(unsigned channel)
 {
-   CAN_Ptr_In_RX[channel] = 0;
-   CAN_Ptr_Out_RX[channel] = 0;
-   CAN_RX_buffer_full[channel]= 0;
+   if (channel >= CAN_NR_IF)
+      return;
+   // only the reader side may drop pending frames
+   CAN_Ptr_Out_RX[channel] = CAN_Ptr_In_RX[channel];
 }
 
 bool CAN_getRxMessage(unsigned channel,uint32_t *address,bool *IDisExtended,uint8_t *payload,int *len)
 {
+CANmessage_t      *ptr;
+uint32_t          out;
+
 #if TRACEALYZER != 0 && TRC_CAN != 0
 	vTracePrint(trcCAN,"Get CAN RX Message");
 #endif
@@ -835,17 +1082,128 @@ bool CAN_getRxMessage(unsigned channel,uint32_t *address,bool *IDisExtended,uint
 #if TRACEALYZER != 0 && TRC_CAN != 0
 	vTracePrint(trcCAN,"Get CAN RX Message -  Available");
 #endif
-   *address = CAN_RXbuffer[channel][CAN_Ptr_Out_RX[channel]].ID;
-   *len = CAN_RXbuffer[channel][CAN_Ptr_Out_RX[channel]].len;
-   for (int i = 0;i < CAN_RXbuffer[channel][CAN_Ptr_Out_RX[channel]].len;i++)
-      payload[i] = CAN_RXbuffer[channel][CAN_Ptr_Out_RX[channel]].payload[i];
-   CAN_RX_buffer_full[channel] = 0;
-   (CAN_Ptr_Out_RX[channel])++;
-   if (CAN_Ptr_Out_RX[channel] >= CAN_RX_MESSAGE_BUFFER_DEPTH)
-      CAN_Ptr_Out_RX[channel] = 0;
+   out = CAN_Ptr_Out_RX[channel];
+   ptr = &(CAN_RXbuffer[channel][out & CAN_RX_MESSAGE_BUFFER_MASK]);
+   *address = ptr->ID;
+   *IDisExtended = ptr->isExtID;
+   *len = ptr->len;
+   for (int i = 0;i < ptr->len;i++)
+      payload[i] = ptr->payload[i];
+   // the slot must have been read before it is handed back to the ISR
+   __DMB();
+   CAN_Ptr_Out_RX[channel] = out + 1;
+   return true;
+}
+
+/*!
+ ******************************************************************************
+ *	Gets a snapshot of the RX and TX statistics
+ * \param[in]     channel     CAN channel
+ * \param[out]    stats       Statistics
+ * \return        true if success, false else
+ ******************************************************************************
+*/
+bool CAN_GetStatistics(unsigned channel,CANstatistics_t *stats)
+{
+uint32_t    primask;
+CAN_Type    *CAN_IF;
+
+   if ((CAN_IF = CAN_GetIfPtr(channel)) == NULL)
+      return false;
+   primask = DisableGlobalIRQ();
+   *stats = *((CANstatistics_t *)&(CAN_Statistics[channel]));
+   EnableGlobalIRQ(primask);
+   FLEXCAN_GetBusErrCount(CAN_IF,&(stats->TX_ErrorCounter),&(stats->RX_ErrorCounter));
    return true;
 }
 
+/*!
+ ******************************************************************************
+ *	Resets all RX and TX statistics
+ * \param[in]     channel     CAN channel
+ * \return        true if success, false else
+ ******************************************************************************
+*/
+bool CAN_ResetStatistics(unsigned channel)
+{
+   if (channel >= CAN_NR_IF)
+      return false;
+   CAN_rx_stats_reset(channel);
+   CAN_tx_stats_reset(channel);
+   return true;
+}
+
+uint32_t CAN_rx_stats_lost(uint32_t ctrl)
+{
+   if (ctrl >= CAN_NR_IF)
+      return 0;
+   return CAN_Statistics[ctrl].RX_Lost;
+}
+
+uint32_t CAN_rx_stats_max_size(uint32_t ctrl)
+{
+   if (ctrl >= CAN_NR_IF)
+      return 0;
+   return CAN_Statistics[ctrl].RX_MaxSize;
+}
+
+uint32_t CAN_rx_stats_fifo_overflow(uint32_t ctrl)
+{
+   if (ctrl >= CAN_NR_IF)
+      return 0;
+   return CAN_Statistics[ctrl].RX_FifoOverflow;
+}
+
+uint32_t CAN_rx_stats_error_frames(uint32_t ctrl)
+{
+   if (ctrl >= CAN_NR_IF)
+      return 0;
+   return CAN_Statistics[ctrl].ErrorFrames;
+}
+
+void CAN_rx_stats_reset(uint32_t ctrl)
+{
+uint32_t    primask;
+
+   if (ctrl >= CAN_NR_IF)
+      return;
+   primask = DisableGlobalIRQ();
+   CAN_Statistics[ctrl].RX_Frames = 0;
+   CAN_Statistics[ctrl].RX_Lost = 0;
+   CAN_Statistics[ctrl].RX_MaxSize = CAN_Ptr_In_RX[ctrl] - CAN_Ptr_Out_RX[ctrl];
+   CAN_Statistics[ctrl].RX_FifoOverflow = 0;
+   CAN_Statistics[ctrl].RX_FifoWarning = 0;
+   CAN_Statistics[ctrl].ErrorFrames = 0;
+   EnableGlobalIRQ(primask);
+}
+
+uint32_t CAN_tx_stats_lost(uint32_t ctrl)
+{
+   if (ctrl >= CAN_NR_IF)
+      return 0;
+   return CAN_Statistics[ctrl].TX_Lost;
+}
+
+uint32_t CAN_tx_stats_max_size(uint32_t ctrl)
+{
+   if (ctrl >= CAN_NR_IF)
+      return 0;
+   return CAN_Statistics[ctrl].TX_MaxSize;
+}
+
+void CAN_tx_stats_reset(uint32_t ctrl)
+{
+uint32_t    primask;
+
+   if (ctrl >= CAN_NR_IF)
+      return;
+   primask = DisableGlobalIRQ();
+   CAN_Statistics[ctrl].TX_Frames = 0;
+   CAN_Statistics[ctrl].TX_Lost = 0;
+   CAN_Statistics[ctrl].TX_MaxSize = CAN_TXqueueCount[ctrl];
+   EnableGlobalIRQ(primask);
+}
+
 bool CAN_SetAcceptanceFilter(unsigned channel,uint32_t ACCmask,uint8_t flag)
 {
 CANdescriptor_t            *ptr;
@@ -14,7 +14,7 @@
 #define  CAN_NR_IF                     1
 #define  CAN_IF_IDENT                  0
 #define  CAN_NR_RX_FILTERS             2
-#define  CAN_NR_AUX_RX_FILTERS    		4
+#define  CAN_NR_AUX_RX_FILTERS    		8     /* NMT, SYNC, SDO, NMT monitoring + up to 4 RPDOs */
 #define  CAN_NR_RX_FILTERS_TOTAL       (CAN_NR_RX_FILTERS + CAN_NR_AUX_RX_FILTERS)
 
 #define  CAN0_IF_IRQ_PRIO              9
@@ -23,12 +23,21 @@
 #define  CAN0_INDIVIDUAL_MASK          0xFFFFFFFF
 #define  CAN0_OWN_ADDRESS              0x00001000
 
-#define  CAN_TX_MAILBOX_INDEX          9
+#define  CAN_TX_MAILBOX_INDEX          12    /* first TX mailbox, MB0..9 are taken by the RX FIFO and its filter table */
+#define  CAN_TX_MAILBOX_NUM            4     /* number of TX mailboxes starting at CAN_TX_MAILBOX_INDEX */
+#define  CAN_TX_MAILBOX_MASK           (((1u << CAN_TX_MAILBOX_NUM) - 1) << CAN_TX_MAILBOX_INDEX)
+#define  CAN_TX_QUEUE_DEPTH            32    /* frames waiting for a free TX mailbox */
 // #define  CAN_RX_MAILBOX_INDEX          10
 
 #define  CAN_RX_DFAULT_MASK            0x3FFFFFFF
 
-#define  CAN_RX_MESSAGE_BUFFER_DEPTH   16
+/* RX message buffer depth, must be a power of two */
+#ifndef  CAN_RX_MESSAGE_BUFFER_DEPTH
+#define  CAN_RX_MESSAGE_BUFFER_DEPTH   64
+#endif
+#if (CAN_RX_MESSAGE_BUFFER_DEPTH & (CAN_RX_MESSAGE_BUFFER_DEPTH - 1)) != 0
+#error "CAN_RX_MESSAGE_BUFFER_DEPTH must be a power of two"
+#endif
 
 #define  CAN_TX_TIMEOUT                1000
 #define  CAN_RX_TIMEOUT                1000
@@ -82,8 +91,26 @@ typedef struct
    uint8_t     payload[8];
 } CANmessage_t;
 
+typedef struct
+{
+   uint32_t    RX_Frames;           /* frames stored in the RX message buffer */
+   uint32_t    RX_Lost;             /* frames dropped because the RX message buffer was full */
+   uint32_t    RX_MaxSize;          /* high-water mark of the RX message buffer */
+   uint32_t    RX_FifoOverflow;     /* FlexCAN RX FIFO overflows (frames lost in hardware) */
+   uint32_t    RX_FifoWarning;      /* FlexCAN RX FIFO almost full warnings */
+   uint32_t    ErrorFrames;         /* CAN error interrupts */
+   uint32_t    TX_Frames;           /* frames queued for transmission */
+   uint32_t    TX_Lost;             /* frames rejected because the TX queue was full */
+   uint32_t    TX_MaxSize;          /* high-water mark of the TX queue */
+   uint8_t     TX_ErrorCounter;     /* actual FlexCAN TX error counter */
+   uint8_t     RX_ErrorCounter;     /* actual FlexCAN RX error counter */
+} CANstatistics_t;
+
 #define CAN_DESC_ARRAY_SIZE            (CAN_NR_IF * sizeof(CANdescriptor_t))
 
+/* Callback invoked from the CAN message ISR after a frame has been queued */
+typedef void (*CAN_RxCallback_t)(unsigned channel,void *arg);
+
 #if defined(__cplusplus)
 extern "C" {
 #endif /* __cplusplus */
@@ -116,6 +143,17 @@ bool CAN_DeleteMessageBuffers(uint8_t ID);
 int CAN_getNumberOfAuxMessageBuffers(uint8_t ID);
 bool CAN_EnableSelfReception(int ID,bool enable);
 void CAN_ErrorIRQhandler(unsigned channel);
+bool CAN_SetRxCallback(unsigned channel,CAN_RxCallback_t callback,void *arg);
+bool CAN_GetStatistics(unsigned channel,CANstatistics_t *stats);
+bool CAN_ResetStatistics(unsigned channel);
+uint32_t CAN_rx_stats_lost(uint32_t ctrl);
+uint32_t CAN_rx_stats_max_size(uint32_t ctrl);
+uint32_t CAN_rx_stats_fifo_overflow(uint32_t ctrl);
+uint32_t CAN_rx_stats_error_frames(uint32_t ctrl);
+void CAN_rx_stats_reset(uint32_t ctrl);
+uint32_t CAN_tx_stats_lost(uint32_t ctrl);
+uint32_t CAN_tx_stats_max_size(uint32_t ctrl);
+void CAN_tx_stats_reset(uint32_t ctrl);
 
 #if defined(__cplusplus)
 }
@@ -0,0 +1,309 @@
+/*
+ * EventRec.c
+ *
+ *  Ring buffered event recorder in a nonvolatile memory without write delay
+ */
+
+#include <string.h>
+#include <stddef.h>
+#include "EventRec.h"
+#include "crc16.h"
+
+/*!
+ ******************************************************************************
+ *	Address of a header copy
+ ******************************************************************************
+*/
+static inline uint32_t EVR_HeaderAddress(const EVR_Recorder_t *r,unsigned copy)
+{
+	return r->base + copy * sizeof(EVR_Header_t);
+}
+
+/*!
+ ******************************************************************************
+ *	Address of the slot of a record
+ ******************************************************************************
+*/
+static inline uint32_t EVR_RecordAddress(const EVR_Recorder_t *r,uint32_t seq)
+{
+	return r->base + 2 * sizeof(EVR_Header_t) + (seq % r->records) * sizeof(EVR_Record_t);
+}
+
+/*!
+ ******************************************************************************
+ *	CRC of a record, seeded with the epoch
+ ******************************************************************************
+*/
+static uint16_t EVR_RecordCRC(const EVR_Recorder_t *r,const EVR_Record_t *rec)
+{
+	return CRC16_Update((uint16_t)(EVR_CRC_SEED ^ r->epoch ^ (r->epoch >> 16)),rec,offsetof(EVR_Record_t,crc));
+}
+
+/*!
+ ******************************************************************************
+ *	Checks a header copy
+ ******************************************************************************
+*/
+static bool EVR_HeaderValid(const EVR_Header_t *hdr)
+{
+	return hdr->magic == EVR_MAGIC && hdr->crc == CRC16_Update(EVR_CRC_SEED,hdr,offsetof(EVR_Header_t,crc));
+}
+
+/*!
+ ******************************************************************************
+ *	Writes the next header copy
+ * \return     true if success
+ ******************************************************************************
+*/
+static bool EVR_WriteHeader(EVR_Recorder_t *r)
+{
+EVR_Header_t		hdr;
+
+	memset(&hdr,0,sizeof(hdr));
+	hdr.magic = EVR_MAGIC;
+	hdr.epoch = r->epoch;
+	hdr.next = r->next;
+	hdr.crc = CRC16_Update(EVR_CRC_SEED,&hdr,offsetof(EVR_Header_t,crc));
+	if (!r->port.write(r->port.ctx,EVR_HeaderAddress(r,r->header),(const uint8_t *)&hdr,sizeof(hdr)))
+		return false;
+	r->header ^= 1;
+	return true;
+}
+
+/*!
+ ******************************************************************************
+ *	Numbers the first n records of the burst buffer and writes them, they must
+ * not cross the end of the ring
+ * \return     true if success
+ ******************************************************************************
+*/
+static bool EVR_WriteBurst(EVR_Recorder_t *r,unsigned n)
+{
+	for (unsigned i = 0;i < n;i++)
+	{
+		r->burst[i].seq = r->next + i;
+		r->burst[i].crc = EVR_RecordCRC(r,&r->burst[i]);
+	}
+	if (!r->port.write(r->port.ctx,EVR_RecordAddress(r,r->next),(const uint8_t *)r->burst,n * sizeof(EVR_Record_t)))
+		return false;
+	r->next += n;
+	r->flushes++;
+	return true;
+}
+
+/*!
+ ******************************************************************************
+ *	Initializes a recorder, events can be logged at once, EVR_Load has to be
+ * called before the first flush
+ *	\param[in]	port			access to the memory
+ *	\param[in]	base			address of the header copies and the ring (EVR_Size)
+ *	\param[in]	records		slots of the ring, more than a flush writes
+ * \return     false if the ring is too small
+ ******************************************************************************
+*/
+bool EVR_Init(EVR_Recorder_t *r,const EVR_Port_t *port,uint32_t base,uint32_t records)
+{
+	memset(r,0,sizeof(*r));
+	r->port = *port;
+	r->base = base;
+	r->records = records;
+	return records > EVR_STAGE_SIZE;
+}
+
+/*!
+ ******************************************************************************
+ *	Recovers the ring: takes the newer valid header copy and the records
+ * written after it, then updates the other copy. Formats the ring if no copy
+ * is valid
+ * \return     false if the memory cannot be accessed
+ ******************************************************************************
+*/
+bool EVR_Load(EVR_Recorder_t *r)
+{
+EVR_Header_t		hdr[2];
+EVR_Record_t		rec;
+int					use = -1;
+
+	for (unsigned i = 0;i < 2;i++)
+	{
+		if (!r->port.read(r->port.ctx,EVR_HeaderAddress(r,i),(uint8_t *)&hdr[i],sizeof(hdr[i])))
+			return false;
+		if (!EVR_HeaderValid(&hdr[i]))
+			continue;
+		if (use < 0 || hdr[i].epoch > hdr[use].epoch || (hdr[i].epoch == hdr[use].epoch && hdr[i].next > hdr[use].next))
+			use = i;
+	}
+	if (use < 0)
+		return EVR_Format(r);
+	r->epoch = hdr[use].epoch;
+	r->next = hdr[use].next;
+	r->header = (uint8_t)(use ^ 1);						// the valid copy is kept
+	for (uint32_t n = 0;n < r->records;n++)
+	{
+		if (!r->port.read(r->port.ctx,EVR_RecordAddress(r,r->next),(uint8_t *)&rec,sizeof(rec)))
+			return false;
+		if (rec.seq != r->next || rec.crc != EVR_RecordCRC(r,&rec))
+			break;
+		r->next++;
+	}
+	// a copy covering the records found is written before any new record: the
+	// valid copy is never more than one flush behind
+	if (r->next != hdr[use].next && !EVR_WriteHeader(r))
+		return false;
+	r->loaded = true;
+	return true;
+}
+
+/*!
+ ******************************************************************************
+ *	Formats the ring: a new epoch invalidates the records, the staged events
+ * are kept
+ * \return     true if success
+ ******************************************************************************
+*/
+bool EVR_Format(EVR_Recorder_t *r)
+{
+	r->loaded = false;
+	r->epoch++;
+	r->next = 0;
+	r->header = 0;
+	if (!EVR_WriteHeader(r) || !EVR_WriteHeader(r))
+		return false;
+	r->loaded = true;
+	return true;
+}
+
+/*!
+ ******************************************************************************
+ *	Stages an event, may be called from interrupts
+ *	\param[in]	time			ms since the start
+ *	\param[in]	source		EVR_SRC_...
+ *	\param[in]	code			event of the source
+ *	\param[in]	value			argument of the event
+ * \return     number of staged events, EVR_STAGE_SIZE if it has been dropped
+ ******************************************************************************
+*/
+unsigned EVR_Log(EVR_Recorder_t *r,uint32_t time,uint8_t source,uint8_t code,uint32_t value)
+{
+EVR_Event_t		*ev;
+uint32_t			state;
+unsigned			n;
+
+	state = r->port.lock(r->port.ctx);
+	n = r->head - r->tail;
+	if (n >= EVR_STAGE_SIZE)
+		r->lost++;
+	else
+	{
+		ev = &r->stage[r->head % EVR_STAGE_SIZE];
+		ev->time = time;
+		ev->value = value;
+		ev->source = source;
+		ev->code = code;
+		r->head++;
+		n++;
+	}
+	r->port.unlock(r->port.ctx,state);
+	return n;
+}
+
+/*!
+ ******************************************************************************
+ *	Writes the staged events in bursts and updates the header. The events
+ * logged meanwhile are staged in the free part of the stage.
+ * \return     false if the ring is not loaded or cannot be written, the events
+ *					stay staged
+ ******************************************************************************
+*/
+bool EVR_Flush(EVR_Recorder_t *r)
+{
+EVR_Event_t		*ev;
+uint32_t			state,tail,lost;
+unsigned			n,i;
+
+	if (!r->loaded)
+		return false;
+	state = r->port.lock(r->port.ctx);
+	n = r->head - r->tail;
+	lost = r->lost;
+	r->lost = 0;
+	r->port.unlock(r->port.ctx,state);
+	if (n == 0 && lost == 0)
+		return true;
+	if (lost != 0)
+	{
+		memset(&r->burst[0],0,sizeof(r->burst[0]));
+		r->burst[0].time = n > 0 ? r->stage[r->tail % EVR_STAGE_SIZE].time : 0;
+		r->burst[0].source = EVR_SRC_RECORDER;
+		r->burst[0].code = EVR_EV_LOST;
+		r->burst[0].value = lost;
+		if (!EVR_WriteBurst(r,1))
+		{
+			state = r->port.lock(r->port.ctx);
+			r->lost += lost;
+			r->port.unlock(r->port.ctx,state);
+			return false;
+		}
+	}
+	tail = r->tail;
+	while (n > 0)
+	{
+		i = n < EVR_BURST ? n : EVR_BURST;
+		if (i > r->records - r->next % r->records)
+			i = r->records - r->next % r->records;		// up to the end of the ring
+		for (unsigned k = 0;k < i;k++)
+		{
+			ev = &r->stage[(tail + k) % EVR_STAGE_SIZE];
+			r->burst[k].time = ev->time;
+			r->burst[k].value = ev->value;
+			r->burst[k].source = ev->source;
+			r->burst[k].code = ev->code;
+		}
+		if (!EVR_WriteBurst(r,i))
+			return false;
+		tail += i;
+		n -= i;
+		r->tail = tail;									// frees the slots for EVR_Log
+	}
+	return EVR_WriteHeader(r);
+}
+
+/*!
+ ******************************************************************************
+ *	Reads records from the ring, from the task calling EVR_Flush. A flush
+ * interrupted by a reset may have overwritten the oldest records partly, the
+ * records failing the check are skipped.
+ *	\param[in]	first			sequence number of the first record, older ones are
+ *									not in the ring anymore: it starts at EVR_Oldest
+ *	\param[out]	records		records
+ *	\param[in]	max			max number of records
+ * \return     number of records read, -1 if the memory cannot be read
+ ******************************************************************************
+*/
+int EVR_Read(EVR_Recorder_t *r,uint32_t first,EVR_Record_t *records,int max)
+{
+uint32_t		end = r->next;
+int			n = 0,i,k,m;
+
+	if (!r->loaded)
+		return -1;
+	if (first < EVR_Oldest(r))
+		first = EVR_Oldest(r);
+	while (n < max && first < end)
+	{
+		i = max - n;
+		if ((uint32_t)i > end - first)
+			i = (int)(end - first);
+		if ((uint32_t)i > r->records - first % r->records)
+			i = (int)(r->records - first % r->records);
+		if (!r->port.read(r->port.ctx,EVR_RecordAddress(r,first),(uint8_t *)(records + n),i * sizeof(EVR_Record_t)))
+			return -1;
+		for (k = 0,m = n;k < i;k++,first++)
+		{
+			if (records[n + k].seq == first && records[n + k].crc == EVR_RecordCRC(r,&records[n + k]))
+				records[m++] = records[n + k];
+		}
+		n = m;
+	}
+	return n;
+}
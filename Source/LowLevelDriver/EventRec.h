@@ -0,0 +1,132 @@
+/*
+ * EventRec.h
+ *
+ *  Ring buffered event recorder in a nonvolatile memory without write delay
+ */
+
+#ifndef EVENTREC_H_
+#define EVENTREC_H_
+
+/*!
+ ******************************************************************************
+ *	Events are staged in RAM by EVR_Log (tasks and interrupts) and written in
+ *	bursts by EVR_Flush (one task) as numbered records to a ring: the record
+ *	with the sequence number seq is in slot seq % records, the ring holds the
+ *	last records written. Two header copies, written alternately after each
+ *	flush, hold the next sequence number. EVR_Load takes the newer valid copy
+ *	and adds the records written after it (a flush interrupted by a reset),
+ *	so the recorder goes on where it stopped. The other copy is updated then,
+ *	before more records are written: the valid copy is at most one flush
+ *	behind, less than the ring. A reset during a flush may overwrite the
+ *	oldest records partly, EVR_Read skips them.
+ *	The records are checked by a CRC seeded with the epoch of the ring, which
+ *	changes when the ring is formatted: records of a former epoch are invalid.
+ *	If the stage is full events are counted and reported by an EVR_EV_LOST
+ *	record.
+ *	The memory is reached through a port, this file has no hardware dependency.
+ ******************************************************************************
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define EVR_STAGE_SIZE				64				///< Events staged in RAM
+#define EVR_BURST						16				///< Records per write of a flush
+#define EVR_MAGIC						0x45565231	///< Header magic ("EVR1")
+#define EVR_CRC_SEED					0x5245
+
+#define EVR_SRC_RECORDER			0				///< Events of the recorder itself
+#define EVR_EV_BOOT					0				///< Recorder started, value: reset reason
+#define EVR_EV_LOST					1				///< Events dropped, value: number of events
+
+#pragma push
+#pragma pack(1)
+
+typedef struct
+{
+	uint32_t		seq;							// sequence number
+	uint32_t		time;							// ms since the start
+	uint32_t		value;
+	uint8_t		source;						// EVR_SRC_...
+	uint8_t		code;							// event of the source
+	uint16_t		crc;							// CRC16 over the fields above
+} EVR_Record_t;
+
+typedef struct
+{
+	uint32_t		magic;
+	uint32_t		epoch;						// changed by formatting
+	uint32_t		next;							// sequence number of the next record
+	uint16_t		crc;
+	uint16_t		reserved;
+} EVR_Header_t;
+
+#pragma pop
+
+typedef struct {
+	uint32_t		time;
+	uint32_t		value;
+	uint8_t		source;
+	uint8_t		code;
+} EVR_Event_t;
+
+typedef struct {
+	bool			(*read)(void *ctx,uint32_t address,uint8_t *data,uint32_t len);
+	bool			(*write)(void *ctx,uint32_t address,const uint8_t *data,uint32_t len);
+	uint32_t		(*lock)(void *ctx);							// masks the callers of EVR_Log
+	void			(*unlock)(void *ctx,uint32_t state);
+	void			*ctx;
+} EVR_Port_t;
+
+typedef struct {
+	EVR_Port_t				port;
+	uint32_t					base;							// header copies, then the ring
+	uint32_t					records;						// slots of the ring
+	bool						loaded;
+	uint32_t					epoch;
+	uint32_t					next;							// sequence number of the next record
+	uint8_t					header;						// header copy written next
+	volatile uint32_t		head;							// events staged
+	volatile uint32_t		tail;							// events written
+	volatile uint32_t		lost;							// events dropped, not reported yet
+	EVR_Event_t				stage[EVR_STAGE_SIZE];
+	EVR_Record_t			burst[EVR_BURST];
+	uint32_t					flushes;						// bursts written
+} EVR_Recorder_t;
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* __cplusplus */
+
+bool EVR_Init(EVR_Recorder_t *r,const EVR_Port_t *port,uint32_t base,uint32_t records);
+bool EVR_Load(EVR_Recorder_t *r);
+bool EVR_Format(EVR_Recorder_t *r);
+unsigned EVR_Log(EVR_Recorder_t *r,uint32_t time,uint8_t source,uint8_t code,uint32_t value);
+bool EVR_Flush(EVR_Recorder_t *r);
+int EVR_Read(EVR_Recorder_t *r,uint32_t first,EVR_Record_t *records,int max);
+
+/*!
+ ******************************************************************************
+ *	Gets the sequence number of the oldest record in the ring
+ ******************************************************************************
+*/
+static inline uint32_t EVR_Oldest(const EVR_Recorder_t *r)
+{
+	return r->next > r->records ? r->next - r->records : 0;
+}
+
+/*!
+ ******************************************************************************
+ *	Gets the size of the memory used by a ring
+ ******************************************************************************
+*/
+static inline uint32_t EVR_Size(uint32_t records)
+{
+	return 2 * sizeof(EVR_Header_t) + records * sizeof(EVR_Record_t);
+}
+
+#if defined(__cplusplus)
+}
+#endif /* __cplusplus */
+
+#endif /* EVENTREC_H_ */
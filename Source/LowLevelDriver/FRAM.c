@@ -1,13 +1,34 @@
 #include "FRAM.h"
 
+static I2C_Device_t		fram_dev;
+static EVR_Recorder_t	fram_events;
+static TickType_t			fram_events_retry;		// tick of the next access after a failure
+static uint32_t			fram_events_backoff;		// ms, 0 if the last access did not fail
+
+static bool FRAM_EventRead(void *ctx,uint32_t address,uint8_t *data,uint32_t len);
+static bool FRAM_EventWrite(void *ctx,uint32_t address,const uint8_t *data,uint32_t len);
+static uint32_t FRAM_EventLock(void *ctx);
+static void FRAM_EventUnlock(void *ctx,uint32_t state);
+
 /*!
  *********************************************************************************
- * Initializes the FRAM
+ * Initializes the FRAM, a device of the I2C transaction queue. The FRAM has no
+ * write cycle, its transfers are not split. Events can be logged from now on,
+ * the event ring is recovered by the first flush (the I2C requests need the
+ * scheduler).
  * \return		1 if no error, else 0
  *********************************************************************************
 */
 int InitializeFRAM(void)
 {
+const EVR_Port_t	port = { FRAM_EventRead,FRAM_EventWrite,FRAM_EventLock,FRAM_EventUnlock,NULL };
+
+	if (!I2C_DeviceInit(&fram_dev,I2CQ_PRIO_NORMAL,0,0))
+		return 0;
+	fram_events_backoff = 0;
+	if (!EVR_Init(&fram_events,&port,FRAM_EVENT_ADDR,FRAM_EVENT_RECORDS))
+		return 0;
+	FRAM_LogEvent(EVR_SRC_RECORDER,EVR_EV_BOOT,RCM->SRS0 | ((uint32_t)RCM->SRS1 << 8));
 	return 1;
 }
 
@@ -23,22 +44,9 @@ int InitializeFRAM(void)
 */
 int FRAM_WriteI2C(uint8_t slave_address,uint16_t address,uint8_t *data,int len)
 {
-   volatile int i = 100;
-   while(i--);
-
-   i2c_master_transfer_t      xfer;
-   
-   xfer.slaveAddress = slave_address >> 1;
-   xfer.direction = kI2C_Write;
-   xfer.flags = kI2C_TransferDefaultFlag;
-   xfer.subaddress = address;
-   xfer.subaddressSize = sizeof(address);
-   xfer.data = data;
-   xfer.dataSize = len;
-   if (I2C_MasterTransferBlocking(FRAM_I2C_Base, &xfer) == kStatus_Success)
-      return 1;
-   else
-      return 0;
+	if (len < 0)
+		return 0;
+	return I2C_DeviceWrite(&fram_dev,slave_address,address,sizeof(address),data,len) ? 1 : 0;
 }
 
 /*!
@@ -53,22 +61,9 @@ int FRAM_WriteI2C(uint8_t slave_address,uint16_t address,uint8_t *data,int len)
 */
 int FRAM_ReadI2C(uint8_t slave_address,uint16_t address,uint8_t *data,int len)
 {
-   volatile int i = 100;
-   while(i--);
- 
-   i2c_master_transfer_t      xfer;
-   
-   xfer.slaveAddress = slave_address >> 1;
-   xfer.direction = kI2C_Read;
-   xfer.flags = kI2C_TransferDefaultFlag;
-   xfer.subaddress = address;
-   xfer.subaddressSize = sizeof(address);
-   xfer.data = data;
-   xfer.dataSize = len;
-   if (I2C_MasterTransferBlocking(FRAM_I2C_Base, &xfer) == kStatus_Success)
-      return 1;
-   else
-      return 0;
+	if (len < 0)
+		return 0;
+	return I2C_DeviceRead(&fram_dev,slave_address,address,sizeof(address),data,len) ? 1 : 0;
 }
 
 /*!
@@ -98,3 +93,107 @@ int ReadFRAM(uint16_t address,void *buf,int len)
 {
 	return FRAM_ReadI2C(FRAM_address,address,(uint8_t *)buf,len);
 }
+
+static bool FRAM_EventRead(void *ctx,uint32_t address,uint8_t *data,uint32_t len)
+{
+	return FRAM_ReadI2C(FRAM_address,(uint16_t)address,data,len) != 0;
+}
+
+static bool FRAM_EventWrite(void *ctx,uint32_t address,const uint8_t *data,uint32_t len)
+{
+	return FRAM_WriteI2C(FRAM_address,(uint16_t)address,(uint8_t *)data,len) != 0;
+}
+
+static uint32_t FRAM_EventLock(void *ctx)
+{
+	return DisableGlobalIRQ();
+}
+
+static void FRAM_EventUnlock(void *ctx,uint32_t state)
+{
+	EnableGlobalIRQ(state);
+}
+
+/*!
+ *********************************************************************************
+ * Records an event: it is staged in RAM and written to the FRAM by the
+ * communication task (FRAM_FlushEvents), which is woken up if the stage fills.
+ * May be called from tasks and interrupts.
+ * \param[in] 	source 		EVR_SRC_...
+ * \param[in]	code			event of the source
+ * \param[in]	value			argument of the event
+ *********************************************************************************
+*/
+void FRAM_LogEvent(uint8_t source,uint8_t code,uint32_t value)
+{
+BaseType_t		xHigherPriorityTaskWoken = pdFALSE;
+
+	if (fram_events.records == 0)
+		return;										// not initialized
+	if (EVR_Log(&fram_events,(uint32_t)(BOARD_getSystemTime_us() / 1000ULL),source,code,value) != FRAM_EVENT_FLUSH_LEVEL)
+		return;
+	if (TaskComm == NULL || xTaskGetSchedulerState() != taskSCHEDULER_RUNNING)
+		return;
+	if (__get_IPSR() != 0)
+	{
+		xTaskNotifyFromISR(TaskComm,(1 << 3),eSetBits,&xHigherPriorityTaskWoken);
+		portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+	}
+	else
+		xTaskNotify(TaskComm,(1 << 3),eSetBits);
+}
+
+/*!
+ *********************************************************************************
+ * Writes the staged events to the FRAM, recovers the event ring on the first
+ * call. Called by the communication task. After a failed access the FRAM is
+ * left alone for FRAM_EVENT_RETRY_MIN_MS, doubled by each further failure up
+ * to FRAM_EVENT_RETRY_MAX_MS: the I2C errors do not stall the task on each
+ * call. The events stay staged meanwhile, the dropped ones are counted.
+ * \return		1 if no error, else 0
+ *********************************************************************************
+*/
+int FRAM_FlushEvents(void)
+{
+TickType_t		now = xTaskGetTickCount();
+
+	if (fram_events_backoff != 0 && (int32_t)(now - fram_events_retry) < 0)
+		return 0;
+	if ((fram_events.loaded || EVR_Load(&fram_events)) && EVR_Flush(&fram_events))
+	{
+		fram_events_backoff = 0;
+		return 1;
+	}
+	if (fram_events_backoff == 0)
+		fram_events_backoff = FRAM_EVENT_RETRY_MIN_MS;
+	else if (fram_events_backoff < FRAM_EVENT_RETRY_MAX_MS / 2)
+		fram_events_backoff *= 2;
+	else
+		fram_events_backoff = FRAM_EVENT_RETRY_MAX_MS;
+	fram_events_retry = now + pdMS_TO_TICKS(fram_events_backoff);
+	return 0;
+}
+
+/*!
+ *********************************************************************************
+ * Reads recorded events, the staged ones are written before. Called by the
+ * communication task.
+ * \param[in] 	first 		sequence number of the first event
+ * \param[out]	records		events
+ * \param[in]	max			max number of events
+ * \param[out]	oldest		sequence number of the oldest event in the FRAM
+ * \param[out]	next			sequence number of the next event
+ * \return		number of events read, -1 if the FRAM cannot be read
+ *********************************************************************************
+*/
+int FRAM_ReadEvents(uint32_t first,EVR_Record_t *records,int max,uint32_t *oldest,uint32_t *next)
+{
+int		n;
+
+	FRAM_FlushEvents();
+	if ((n = EVR_Read(&fram_events,first,records,max)) < 0)
+		return -1;
+	*oldest = EVR_Oldest(&fram_events);
+	*next = fram_events.next;
+	return n;
+}
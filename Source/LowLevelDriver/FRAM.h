@@ -3,16 +3,44 @@
 
 #include <stdint.h>
 #include "board.h"
+#include "I2C.h"
 
-#define FRAM_I2C_Base				I2C0
+#include "EventRec.h"
 
 #define FRAM_address             0xA0     //!< Slave address of FRAM
 #define FRAM_MaxReadBufferLen    16       //!< Maximum Length of I2C Read Buffer
+#define FRAM_SIZE                0x2000   //!< 8 KiB
+
+#define FRAM_EVENT_ADDR          0x0000   //!< Event recorder (EventRec.h)
+#define FRAM_EVENT_RECORDS       500      //!< Records of the event ring
+#define FRAM_EVENT_FLUSH_LEVEL   (EVR_STAGE_SIZE / 2)	//!< Staged events waking up the communication task
+#define FRAM_EVENT_RETRY_MIN_MS  100      //!< First wait after a failed access of the event ring
+#define FRAM_EVENT_RETRY_MAX_MS  10000    //!< Longest wait after failed accesses
+
+#if FRAM_EVENT_ADDR + 32 + FRAM_EVENT_RECORDS * 16 > FRAM_SIZE
+#error "The event ring does not fit into the FRAM"
+#endif
+
+// Sources of the recorded events, the codes are given by the sources
+#define EVR_SRC_SAFETY           1        //!< Safety Manager error counter (code: eERRcnt, value: counter)
+#define EVR_SRC_CLEANING         2        //!< Cleaning Unit fatal error counter (code: 0, value: counter)
+#define EVR_SRC_LIFT             3        //!< Lift overcurrent stop (code: lift ID, value: current in mA)
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* __cplusplus */
 
 extern int InitializeFRAM(void);
 extern int SetWriteProtect(void);
 extern int ClrWriteProtect(void);
 extern int WriteFRAM(uint16_t address,void *buf,int len);
 extern int ReadFRAM(uint16_t address,void *buf,int len);
+extern void FRAM_LogEvent(uint8_t source,uint8_t code,uint32_t value);
+extern int FRAM_FlushEvents(void);
+extern int FRAM_ReadEvents(uint32_t first,EVR_Record_t *records,int max,uint32_t *oldest,uint32_t *next);
+
+#if defined(__cplusplus)
+}
+#endif /* __cplusplus */
 
 #endif		// FRAM_h
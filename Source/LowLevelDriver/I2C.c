@@ -5,6 +5,7 @@
  *      Author: martin
  */
 
+#include <string.h>
 #include "I2C.h"
 
 #include "FreeRTOS.h"
@@ -12,6 +13,244 @@
 
 static SemaphoreHandle_t	mI2C_Sema = NULL;
 
+enum
+{
+	I2C_PORT_IDLE = 0,
+	I2C_PORT_ADDR,				// address byte
+	I2C_PORT_WRITE,			// data bytes sent
+	I2C_PORT_READ				// data bytes received
+};
+
+typedef struct
+{
+	I2C_Type					*base;
+	volatile uint8_t		mode;
+	const uint8_t			*tx;
+	uint8_t					*rx;
+	uint32_t					count;			// bytes left
+	I2CQ_Bus_t				queue;
+} I2C_QueuePort_t;
+
+static I2C_QueuePort_t		i2c_port = { .base = I2C_QUEUE_BASE };
+static I2C_Device_t			i2c_any;			// requests of I2C_WriteI2C and I2C_ReadI2C
+
+/*!
+ *********************************************************************************
+ * Gets the controller of a channel for the blocking functions, the channel of the
+ * transaction queue is driven by its interrupt
+ * \param[in]	channel 		I2C Channel (0 or 1)
+ * \return		controller, NULL if the channel cannot be used
+ *********************************************************************************
+*/
+static I2C_Type *I2C_PolledPort(uint8_t channel)
+{
+I2C_Type		*port;
+
+	switch (channel) {
+		case 0:
+			port = I2C0;
+			break;
+		case 1:
+			port = I2C1;
+			break;
+		default:
+			return NULL;
+	}
+	return port == I2C_QUEUE_BASE ? NULL : port;
+}
+
+/*!
+ *********************************************************************************
+ * Queue port: issues a START condition, or a repeated START if the bus is owned,
+ * and sends the address byte. If the bus does not get free the request ends by
+ * the timeout of the queue.
+ *********************************************************************************
+*/
+static void I2C_PortStart(void *ctx,uint8_t address)
+{
+I2C_QueuePort_t	*port = (I2C_QueuePort_t *)ctx;
+I2C_Type				*base = port->base;
+
+	port->mode = I2C_PORT_ADDR;
+	if (base->C1 & I2C_C1_MST_MASK)
+		I2C_Bus_MasterRepeatedStart(base);
+	else
+	{
+		I2C_Bus_ClearFlags(base,I2C_CLEAR_FLAGS);
+		if (I2C_Bus_WaitUntilBusFree(base,1) != I2C_Stat_Success || I2C_Bus_MasterStart(base) != I2C_Stat_Success)
+		{
+			port->mode = I2C_PORT_IDLE;
+			return;
+		}
+	}
+	base->D = address;
+}
+
+/*!
+ *********************************************************************************
+ * Queue port: sends data bytes
+ *********************************************************************************
+*/
+static void I2C_PortWrite(void *ctx,const uint8_t *data,uint32_t len)
+{
+I2C_QueuePort_t	*port = (I2C_QueuePort_t *)ctx;
+
+	port->tx = data + 1;
+	port->count = len - 1;
+	port->mode = I2C_PORT_WRITE;
+	port->base->C1 |= I2C_C1_TX_MASK;
+	port->base->D = *data;
+}
+
+/*!
+ *********************************************************************************
+ * Queue port: receives data bytes, the last one is not acknowledged
+ *********************************************************************************
+*/
+static void I2C_PortRead(void *ctx,uint8_t *data,uint32_t len)
+{
+I2C_QueuePort_t	*port = (I2C_QueuePort_t *)ctx;
+I2C_Type				*base = port->base;
+volatile uint8_t	dummy;
+
+	port->rx = data;
+	port->count = len;
+	port->mode = I2C_PORT_READ;
+	base->C1 &= ~(I2C_C1_TX_MASK | I2C_C1_TXAK_MASK);
+	if (len == 1)
+		base->C1 |= I2C_C1_TXAK_MASK;
+	dummy = base->D;					// starts the reception of the first byte
+	(void)dummy;
+}
+
+/*!
+ *********************************************************************************
+ * Queue port: issues a STOP condition
+ *********************************************************************************
+*/
+static void I2C_PortStop(void *ctx)
+{
+I2C_QueuePort_t	*port = (I2C_QueuePort_t *)ctx;
+
+	port->mode = I2C_PORT_IDLE;
+	port->base->C1 &= ~(I2C_C1_MST_MASK | I2C_C1_TX_MASK | I2C_C1_TXAK_MASK);
+}
+
+/*!
+ *********************************************************************************
+ * Queue port: starts the one shot timer, stops it if us is 0
+ *********************************************************************************
+*/
+static void I2C_PortTimer(void *ctx,uint32_t us)
+{
+	PIT_StopTimer(PIT,I2C_QUEUE_PIT_CHANNEL);
+	PIT_ClearStatusFlags(PIT,I2C_QUEUE_PIT_CHANNEL,kPIT_TimerFlag);
+	NVIC_ClearPendingIRQ(I2C_QUEUE_PIT_IRQn);	// a timeout of the stopped timer must not reach the next request
+	if (us == 0)
+		return;
+	PIT_SetTimerPeriod(PIT,I2C_QUEUE_PIT_CHANNEL,USEC_TO_COUNT(us,CLOCK_GetBusClkFreq()));
+	PIT_StartTimer(PIT,I2C_QUEUE_PIT_CHANNEL);
+}
+
+/*!
+ *********************************************************************************
+ * Queue port: time in us
+ *********************************************************************************
+*/
+static uint32_t I2C_PortNow(void *ctx)
+{
+	return (uint32_t)(BOARD_getSystemTimeDirect() / 1000ULL);
+}
+
+/*!
+ *********************************************************************************
+ * Interrupt of the queued bus: a byte has been sent or received
+ *********************************************************************************
+*/
+void I2C1_IRQHandler(void)
+{
+I2C_QueuePort_t	*port = &i2c_port;
+I2C_Type				*base = port->base;
+uint8_t				status = base->S;
+
+	base->S = I2C_S_IICIF_MASK;
+	if (status & I2C_S_ARBL_MASK)
+	{
+		base->S = I2C_S_ARBL_MASK;
+		port->mode = I2C_PORT_IDLE;
+		I2CQ_Event(&port->queue,I2CQ_EV_ARB_LOST);
+	}
+	else switch (port->mode)
+	{
+		case I2C_PORT_ADDR:
+		case I2C_PORT_WRITE:
+			if (status & I2C_S_RXAK_MASK)
+			{
+				port->mode = I2C_PORT_IDLE;
+				I2CQ_Event(&port->queue,I2CQ_EV_NAK);
+			}
+			else if (port->mode == I2C_PORT_WRITE && port->count != 0)
+			{
+				port->count--;
+				base->D = *port->tx++;
+			}
+			else
+			{
+				port->mode = I2C_PORT_IDLE;
+				I2CQ_Event(&port->queue,I2CQ_EV_DONE);
+			}
+			break;
+		case I2C_PORT_READ:
+			port->count--;
+			if (port->count == 0)
+				base->C1 |= I2C_C1_TX_MASK;			// no clocks for another byte
+			else if (port->count == 1)
+				base->C1 |= I2C_C1_TXAK_MASK;			// NAK on the last byte
+			*port->rx++ = base->D;
+			if (port->count == 0)
+			{
+				port->mode = I2C_PORT_IDLE;
+				I2CQ_Event(&port->queue,I2CQ_EV_DONE);
+			}
+			break;
+		default:
+			break;
+	}
+#if defined __CORTEX_M && (__CORTEX_M == 4U)
+	__DSB();
+#endif
+}
+
+/*!
+ *********************************************************************************
+ * Timer interrupt of the queued bus
+ *********************************************************************************
+*/
+void PIT3_IRQHandler(void)
+{
+	if (!(PIT_GetStatusFlags(PIT,I2C_QUEUE_PIT_CHANNEL) & kPIT_TimerFlag))
+		return;									// stale request, the timer has been restarted or stopped
+	PIT_StopTimer(PIT,I2C_QUEUE_PIT_CHANNEL);
+	PIT_ClearStatusFlags(PIT,I2C_QUEUE_PIT_CHANNEL,kPIT_TimerFlag);
+	I2CQ_Event(&i2c_port.queue,I2CQ_EV_TIMER);
+#if defined __CORTEX_M && (__CORTEX_M == 4U)
+	__DSB();
+#endif
+}
+
+/*!
+ *********************************************************************************
+ * End of a request of a device, wakes up the waiting task
+ *********************************************************************************
+*/
+static void I2C_DeviceDone(I2CQ_Request_t *req)
+{
+BaseType_t		xHigherPriorityTaskWoken = pdFALSE;
+
+	xSemaphoreGiveFromISR(((I2C_Device_t *)req->arg)->done,&xHigherPriorityTaskWoken);
+	portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
 /*!
  *********************************************************************************
  * Writes a byte vector to the I2C Bus
@@ -25,23 +264,9 @@ static SemaphoreHandle_t	mI2C_Sema = NULL;
 */
 bool I2C_WriteI2C(uint8_t slave_address,uint16_t sub_address,uint16_t sub_size,uint8_t *data,int len)
 {
-	return I2C_WriteI2Cchannel(I2C_CHANNEL,slave_address,sub_address,sub_size,data,len);
-//   volatile int i = 100;
-//   while(i--);
-
-//   i2c_master_transfer_t      xfer;
-
-//   xfer.slaveAddress = slave_address >> 1;
-//   xfer.direction = kI2C_Write;
-//   xfer.flags = kI2C_TransferDefaultFlag;
-//   xfer.subaddress = sub_address;
-//   xfer.subaddressSize = sub_size;
-//   xfer.data = data;
-//   xfer.dataSize = len;
-//   if (I2C_MasterTransferBlocking(I2C1, &xfer) == kStatus_Success)
-//      return true;
-//   else
-//      return false;
+	if (len < 0)
+		return false;
+	return I2C_DeviceWrite(&i2c_any,slave_address,sub_address,sub_size,data,len);
 }
 
 
@@ -58,23 +283,9 @@ bool I2C_WriteI2C(uint8_t slave_address,uint16_t sub_address,uint16_t sub_size,u
 */
 bool I2C_ReadI2C(uint8_t slave_address,uint16_t sub_address,uint16_t sub_size,uint8_t *data,int len)
 {
-	return I2C_ReadI2Cchannel(I2C_CHANNEL,slave_address,sub_address,sub_size,data,len);
-//   volatile int i = 100;
-//   while(i--);
-
-//   i2c_master_transfer_t      xfer;
-
-//   xfer.slaveAddress = slave_address >> 1;
-//   xfer.direction = kI2C_Read;
-//   xfer.flags = kI2C_TransferDefaultFlag;
-//   xfer.subaddress = sub_address;
-//   xfer.subaddressSize = sub_size;
-//   xfer.data = data;
-//   xfer.dataSize = len;
-//   if (I2C_MasterTransferBlocking(I2C1, &xfer) == kStatus_Success)
-//      return true;
-//   else
-//      return false;
+	if (len < 0)
+		return false;
+	return I2C_DeviceRead(&i2c_any,slave_address,sub_address,sub_size,data,len);
 }
 
 // -------------------------------------------------------------------------------
@@ -88,13 +299,163 @@ bool I2C_ReadI2C(uint8_t slave_address,uint16_t sub_address,uint16_t sub_size,ui
 */
 bool I2C_Bus_Init(void)
 {
+const I2CQ_Port_t		port = { I2C_PortStart,I2C_PortWrite,I2C_PortRead,I2C_PortStop,I2C_PortTimer,I2C_PortNow,&i2c_port };
+const I2CQ_Config_t	config = {
+	I2C_TIMEOUT_MS * 1000,
+	(9 * 1000000 + I2C1_BAUD_RATE - 1) / I2C1_BAUD_RATE,
+	I2C_QUEUE_POLL_US,
+	I2C_WRITE_CYCLE_MS * 1000
+};
+
 	mI2C_Sema = xSemaphoreCreateBinary();
-	if (mI2C_Sema != NULL) {
-		xSemaphoreGive(mI2C_Sema);
-		return true;
-	} else {
+	if (mI2C_Sema == NULL)
+		return false;
+	xSemaphoreGive(mI2C_Sema);
+	I2CQ_Init(&i2c_port.queue,&port,&config);
+	I2C_QUEUE_BASE->C1 |= I2C_C1_IICIE_MASK;
+	NVIC_SetPriority(I2C_QUEUE_IRQn,I2C_QUEUE_INT_PRIORITY);
+	EnableIRQ(I2C_QUEUE_IRQn);
+	PIT_EnableInterrupts(PIT,I2C_QUEUE_PIT_CHANNEL,kPIT_TimerInterruptEnable);
+	NVIC_SetPriority(I2C_QUEUE_PIT_IRQn,I2C_QUEUE_INT_PRIORITY);
+	EnableIRQ(I2C_QUEUE_PIT_IRQn);
+	return I2C_DeviceInit(&i2c_any,I2CQ_PRIO_NORMAL,0,0);
+}
+
+/*!
+ *********************************************************************************
+ * Initializes a device of the queued bus
+ * \param[out]	dev				device
+ * \param[in]	priority		I2CQ_PRIO_HIGH, I2CQ_PRIO_NORMAL or I2CQ_PRIO_LOW
+ * \param[in]	flags			I2CQ_WRITE_CYCLE if the device does not answer while writing
+ * \param[in]	page_size		writes are split at page boundaries, 0 if none
+ * \return		true if success, false else
+ *********************************************************************************
+*/
+bool I2C_DeviceInit(I2C_Device_t *dev,uint8_t priority,uint8_t flags,uint16_t page_size)
+{
+	memset(dev,0,sizeof(*dev));
+	dev->req.priority = priority;
+	dev->req.page_size = page_size;
+	dev->req.callback = I2C_DeviceDone;
+	dev->req.arg = dev;
+	dev->req.status = I2C_Stat_Idle;
+	dev->flags = flags;
+	dev->mutex = xSemaphoreCreateMutex();
+	dev->done = xSemaphoreCreateBinary();
+	return dev->mutex != NULL && dev->done != NULL;
+}
+
+/*!
+ *********************************************************************************
+ * Queues a request of a device and waits until it is done. The task sleeps in
+ * the meantime, requests of other devices may be done before.
+ * \param[in]	dev				device
+ * \param[in]	flags			I2CQ_READ or 0
+ * \return		true if success, else false
+ *********************************************************************************
+*/
+static bool I2C_DeviceTransfer(I2C_Device_t *dev,uint8_t flags,uint8_t slave_address,uint32_t sub_address,
+		unsigned sub_size,uint8_t *data,uint32_t len)
+{
+uint32_t		primask;
+bool			result;
+
+	if (xTaskGetSchedulerState() != taskSCHEDULER_RUNNING || dev->mutex == NULL)
 		return false;
+	if (xSemaphoreTake(dev->mutex,I2C_DEVICE_WAIT_MS / portTICK_PERIOD_MS) != pdTRUE)
+		return false;
+	dev->req.address = slave_address;
+	dev->req.flags = dev->flags | flags;
+	dev->req.sub_address = sub_address;
+	dev->req.sub_size = sub_size;
+	dev->req.data = data;
+	dev->req.len = len;
+	xSemaphoreTake(dev->done,0);
+	primask = DisableGlobalIRQ();
+	result = I2CQ_Submit(&i2c_port.queue,&dev->req);
+	EnableGlobalIRQ(primask);
+	if (result && xSemaphoreTake(dev->done,I2C_DEVICE_WAIT_MS / portTICK_PERIOD_MS) != pdTRUE)
+	{
+		primask = DisableGlobalIRQ();
+		if (I2CQ_Cancel(&i2c_port.queue,&dev->req))
+			dev->req.status = I2C_Stat_Timeout;
+		EnableGlobalIRQ(primask);
 	}
+	result = result && dev->req.status == I2C_Stat_Success;
+	xSemaphoreGive(dev->mutex);
+	return result;
+}
+
+/*!
+ *********************************************************************************
+ * Reads from a device of the queued bus, waits until done
+ * \param[in]	dev				device
+ * \param[in] 	slave_address 	slave address of I2C device (8Bit-Address)
+ * \param[in]	sub_address		subaddress of device register
+ * \param[in]	sub_size		subaddress size of device register
+ * \param[out]	data			pointer to the data vector
+ * \param[in]	len				length of data vector
+ * \return		true if success, else false
+ *********************************************************************************
+*/
+bool I2C_DeviceRead(I2C_Device_t *dev,uint8_t slave_address,uint32_t sub_address,unsigned sub_size,uint8_t *data,uint32_t len)
+{
+	return I2C_DeviceTransfer(dev,I2CQ_READ,slave_address,sub_address,sub_size,data,len);
+}
+
+/*!
+ *********************************************************************************
+ * Writes to a device of the queued bus, waits until done (including the write
+ * cycles of the device)
+ * \param[in]	dev				device
+ * \param[in] 	slave_address 	slave address of I2C device (8Bit-Address)
+ * \param[in]	sub_address		subaddress of device register
+ * \param[in]	sub_size		subaddress size of device register
+ * \param[in]	data			pointer to the data vector
+ * \param[in]	len				length of data vector
+ * \return		true if success, else false
+ *********************************************************************************
+*/
+bool I2C_DeviceWrite(I2C_Device_t *dev,uint8_t slave_address,uint32_t sub_address,unsigned sub_size,uint8_t *data,uint32_t len)
+{
+	return I2C_DeviceTransfer(dev,0,slave_address,sub_address,sub_size,data,len);
+}
+
+/*!
+ *********************************************************************************
+ * Queues a request on the queued bus without waiting, its callback is called
+ * from the interrupt when it is done
+ * \param[in]	req				request, owned by the queue until it is done
+ * \return		true if queued, false if the request is invalid
+ *********************************************************************************
+*/
+bool I2C_Submit(I2CQ_Request_t *req)
+{
+uint32_t		primask;
+bool			result;
+
+	primask = DisableGlobalIRQ();
+	result = I2CQ_Submit(&i2c_port.queue,req);
+	EnableGlobalIRQ(primask);
+	return result;
+}
+
+/*!
+ *********************************************************************************
+ * Cancels a request of the queued bus
+ * \param[in]	req				request
+ * \return		true if cancelled, false if it was done
+ *********************************************************************************
+*/
+bool I2C_Cancel(I2CQ_Request_t *req)
+{
+uint32_t		primask;
+bool			result;
+
+	primask = DisableGlobalIRQ();
+	result = I2CQ_Cancel(&i2c_port.queue,req);
+	EnableGlobalIRQ(primask);
+	return result;
 }
 
 /*!
@@ -400,16 +761,8 @@ bool			result;
 			return false;
 	}
 #endif
-	switch (channel) {
-   		case 0:
-   			port = I2C0;
-   			break;
-   		case 1:
-   			port = I2C1;
-   			break;
-   		default:
-   			return false;
-	}
+	if ((port = I2C_PolledPort(channel)) == NULL)
+		return false;
 
 	while(i--);
 
@@ -450,16 +803,8 @@ bool			result;
 			return false;
 	}
 #endif
-	switch (channel) {
-		case 0:
-			port = I2C0;
-			break;
-		case 1:
-			port = I2C1;
-			break;
-		default:
-			return false;
-	}
+	if ((port = I2C_PolledPort(channel)) == NULL)
+		return false;
 
 	while(i--);
 
@@ -501,16 +846,8 @@ bool			result;
 			return false;
 	}
 #endif
-	switch (channel) {
-		case 0:
-			port = I2C0;
-			break;
-		case 1:
-			port = I2C1;
-			break;
-		default:
-			return false;
-	}
+	if ((port = I2C_PolledPort(channel)) == NULL)
+		return false;
 
 	while(i--);
 
@@ -556,16 +893,8 @@ bool					result,semaStatus;
 			return false;
 	}
 #endif
-	switch (channel) {
-		case 0:
-			base = I2C0;
-			break;
-		case 1:
-			base = I2C1;
-			break;
-		default:
-			return false;
-	}
+	if ((base = I2C_PolledPort(channel)) == NULL)
+		return false;
 
 	while(i--);
 
@@ -744,16 +1073,8 @@ bool			result;
 			return false;
 	}
 #endif
-	switch (channel) {
-   		case 0:
-   			port = I2C0;
-   			break;
-   		case 1:
-   			port = I2C1;
-   			break;
-   		default:
-   			return false;
-	}
+	if ((port = I2C_PolledPort(channel)) == NULL)
+		return false;
 
 	while(i--);
 
@@ -794,16 +1115,8 @@ uint8_t			*ptr = (uint8_t *)(&data);
 			return false;
 	}
 #endif
-	switch (channel) {
-		case 0:
-			port = I2C0;
-			break;
-		case 1:
-			port = I2C1;
-			break;
-		default:
-			return false;
-	}
+	if ((port = I2C_PolledPort(channel)) == NULL)
+		return false;
 
 	while(i--);
 
@@ -844,16 +1157,8 @@ uint8_t			*ptr = (uint8_t *)(&data);
 			return false;
 	}
 #endif
-	switch (channel) {
-   		case 0:
-   			port = I2C0;
-   			break;
-   		case 1:
-   			port = I2C1;
-   			break;
-   		default:
-   			return false;
-	}
+	if ((port = I2C_PolledPort(channel)) == NULL)
+		return false;
 
 	while(i--);
 
@@ -893,16 +1198,8 @@ bool			result;
 			return false;
 	}
 #endif
-	switch (channel) {
-		case 0:
-			port = I2C0;
-			break;
-		case 1:
-			port = I2C1;
-			break;
-		default:
-			return false;
-	}
+	if ((port = I2C_PolledPort(channel)) == NULL)
+		return false;
 
 	while(i--);
 
@@ -943,16 +1240,8 @@ uint8_t			*ptr = (uint8_t *)(&data);
 			return false;
 	}
 #endif
-	switch (channel) {
-		case 0:
-			port = I2C0;
-			break;
-		case 1:
-			port = I2C1;
-			break;
-		default:
-			return false;
-	}
+	if ((port = I2C_PolledPort(channel)) == NULL)
+		return false;
 
 	while(i--);
 
@@ -993,16 +1282,8 @@ uint8_t			*ptr = (uint8_t *)(&data);
 			return false;
 	}
 #endif
-	switch (channel) {
-		case 0:
-			port = I2C0;
-			break;
-		case 1:
-			port = I2C1;
-			break;
-		default:
-			return false;
-	}
+	if ((port = I2C_PolledPort(channel)) == NULL)
+		return false;
 
 	while(i--);
 
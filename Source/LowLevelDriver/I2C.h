@@ -10,7 +10,8 @@
 
 #include <stdint.h>
 #include <stdbool.h>
-#include "Board.h"
+#include "board.h"
+#include "I2C_Queue.h"
 
 #define I2C0_BAUD_RATE				400000
 #define I2C1_BAUD_RATE				400000
@@ -23,17 +24,29 @@
 
 #define I2C_USE_SEMAPHORE			0
 
-typedef enum
+#define I2C_QUEUE_BASE				I2C1				//!< Bus driven by the transaction queue (I2C_CHANNEL)
+#define I2C_QUEUE_IRQn				I2C1_IRQn
+#define I2C_QUEUE_PIT_CHANNEL		kPIT_Chnl_3		//!< Timer of the transaction queue
+#define I2C_QUEUE_PIT_IRQn			PIT3_IRQn
+#define I2C_QUEUE_INT_PRIORITY	I2C1_INT_PRIORITY	//!< Same priority for the bus and its timer
+
+#define I2C_QUEUE_POLL_US			500				//!< Interval of the polls of a device in its write cycle
+#define I2C_WRITE_CYCLE_MS			10					//!< Max duration of a write cycle
+#define I2C_DEVICE_WAIT_MS			500				//!< Max time of a request of a device
+
+/*!
+ *********************************************************************************
+ * A device of the queued bus: its request descriptor and the semaphores of the
+ * task waiting for it. The requests of a device are done one at a time.
+ *********************************************************************************
+*/
+typedef struct
 {
-	I2C_Stat_Success = 0,
-	I2C_Stat_Busy,            	//!< I2C is busy with current transfer
-	I2C_Stat_Idle,            	//!< Bus is Idle
-	I2C_Stat_Nak,            	//!< NAK received during transfer
-	I2C_Stat_ArbitrationLost, 	//!< Arbitration lost during transfer
-	I2C_Stat_Timeout,         	//!< Timeout poling status flags
-	I2C_Stat_Addr_Nak,        	//!< NAK received during the address probe
-	I2C_Stat_Invalid_Argument 	//!< Invalid argument
-} I2C_status_t;
+	I2CQ_Request_t			req;
+	uint8_t					flags;			//!< I2CQ_WRITE_CYCLE
+	SemaphoreHandle_t		mutex;
+	SemaphoreHandle_t		done;				//!< Given by the completion callback
+} I2C_Device_t;
 
 #define I2C_CLEAR_FLAGS 	(I2C_S_ARBL_MASK | I2C_S_IICIF_MASK | ((I2C_FLT_STARTF_MASK | I2C_FLT_STOPF_MASK) << 8))
 
@@ -371,6 +384,11 @@ bool I2C_WriteI2C(uint8_t slave_address,uint16_t sub_address,uint16_t sub_size,u
 bool I2C_ReadI2C(uint8_t slave_address,uint16_t sub_address,uint16_t sub_size,uint8_t *data,int len);
 
 bool I2C_Bus_Init(void);
+bool I2C_DeviceInit(I2C_Device_t *dev,uint8_t priority,uint8_t flags,uint16_t page_size);
+bool I2C_DeviceRead(I2C_Device_t *dev,uint8_t slave_address,uint32_t sub_address,unsigned sub_size,uint8_t *data,uint32_t len);
+bool I2C_DeviceWrite(I2C_Device_t *dev,uint8_t slave_address,uint32_t sub_address,unsigned sub_size,uint8_t *data,uint32_t len);
+bool I2C_Submit(I2CQ_Request_t *req);
+bool I2C_Cancel(I2CQ_Request_t *req);
 I2C_status_t I2C_Bus_MasterWriteBlocking(I2C_Type *base, const uint8_t *TXdata, unsigned TXsize, bool NoStop);
 I2C_status_t I2C_Bus_MasterReadBlocking(I2C_Type *base, uint8_t *RXdata, unsigned RXsize, bool NoStop);
 I2C_status_t I2C_WriteTransferBlocking(I2C_Type *base,uint8_t address,uint8_t *TXdata,unsigned TXsize);
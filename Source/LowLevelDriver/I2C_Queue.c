@@ -0,0 +1,395 @@
+/*
+ * I2C_Queue.c
+ *
+ *  Transaction queue of an I2C bus
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include "I2C_Queue.h"
+
+enum
+{
+	I2CQ_ST_IDLE = 0,
+	I2CQ_ST_ADDR_W,			// address byte of a write
+	I2CQ_ST_SUB,				// subaddress
+	I2CQ_ST_DATA_W,			// data of a write
+	I2CQ_ST_ADDR_R,			// address byte of a read
+	I2CQ_ST_DATA_R,			// data of a read
+	I2CQ_ST_POLL				// address byte probing a device in its write cycle
+};
+
+enum
+{
+	I2CQ_TIMER_OFF = 0,
+	I2CQ_TIMER_TIMEOUT,		// transfer in progress
+	I2CQ_TIMER_POLL			// next poll of the parked request
+};
+
+static void I2CQ_Schedule(I2CQ_Bus_t *bus);
+
+/*!
+ ******************************************************************************
+ *	Starts or stops the timer of the port
+ ******************************************************************************
+*/
+static void I2CQ_SetTimer(I2CQ_Bus_t *bus,uint8_t use,uint32_t us)
+{
+	if (use == I2CQ_TIMER_OFF && bus->timer == I2CQ_TIMER_OFF)
+		return;
+	bus->timer = use;
+	bus->port.timer(bus->port.ctx,use == I2CQ_TIMER_OFF ? 0 : (us != 0 ? us : 1));
+}
+
+/*!
+ ******************************************************************************
+ *	Removes a request from its queue
+ * \return     true if the request was queued
+ ******************************************************************************
+*/
+static bool I2CQ_Unlink(I2CQ_Bus_t *bus,I2CQ_Request_t *req)
+{
+I2CQ_Request_t		*prev = NULL,*r;
+
+	for (r = bus->head[req->priority];r != NULL;prev = r,r = r->next)
+	{
+		if (r != req)
+			continue;
+		if (prev == NULL)
+			bus->head[req->priority] = r->next;
+		else
+			prev->next = r->next;
+		if (bus->tail[req->priority] == r)
+			bus->tail[req->priority] = prev;
+		r->next = NULL;
+		return true;
+	}
+	return false;
+}
+
+/*!
+ ******************************************************************************
+ *	Checks if a queued request can be started while a request is parked: not
+ *	to the parked device, and no other write with a write cycle
+ ******************************************************************************
+*/
+static bool I2CQ_Ready(const I2CQ_Bus_t *bus,const I2CQ_Request_t *req)
+{
+	if (bus->parked == NULL)
+		return true;
+	if ((req->address & 0xFE) == (bus->parked->address & 0xFE))
+		return false;
+	return (req->flags & (I2CQ_READ | I2CQ_WRITE_CYCLE)) != I2CQ_WRITE_CYCLE;
+}
+
+/*!
+ ******************************************************************************
+ *	Starts a request, or the next page of a write
+ ******************************************************************************
+*/
+static void I2CQ_StartTransfer(I2CQ_Bus_t *bus,I2CQ_Request_t *req)
+{
+uint32_t		len,room;
+
+	if (req->flags & I2CQ_READ)
+		len = req->len;
+	else
+	{
+		len = req->len - req->done;
+		if (req->page_size != 0)
+		{
+			room = req->page_size - (req->sub_address + req->done) % req->page_size;
+			if (len > room)
+				len = room;
+		}
+		req->chunk = len;
+	}
+	bus->active = req;
+	I2CQ_SetTimer(bus,I2CQ_TIMER_TIMEOUT,bus->config.timeout_us + (len + req->sub_size + 2) * bus->config.byte_us);
+	if ((req->flags & I2CQ_READ) && req->sub_size == 0)
+	{
+		bus->state = I2CQ_ST_ADDR_R;
+		bus->port.start(bus->port.ctx,req->address | 1);
+	}
+	else
+	{
+		bus->state = I2CQ_ST_ADDR_W;
+		bus->port.start(bus->port.ctx,req->address & 0xFE);
+	}
+}
+
+/*!
+ ******************************************************************************
+ *	Polls the parked device, it acknowledges its address when its write cycle
+ *	is done
+ ******************************************************************************
+*/
+static void I2CQ_StartPoll(I2CQ_Bus_t *bus)
+{
+I2CQ_Request_t		*req = bus->parked;
+
+	bus->parked = NULL;
+	bus->active = req;
+	bus->state = I2CQ_ST_POLL;
+	bus->poll_us = bus->port.now(bus->port.ctx);
+	bus->polls++;
+	I2CQ_SetTimer(bus,I2CQ_TIMER_TIMEOUT,bus->config.timeout_us + 2 * bus->config.byte_us);
+	bus->port.start(bus->port.ctx,req->address & 0xFE);
+}
+
+/*!
+ ******************************************************************************
+ *	Parks the active request until its device is done with the write cycle
+ ******************************************************************************
+*/
+static void I2CQ_Park(I2CQ_Bus_t *bus,I2CQ_Request_t *req)
+{
+	bus->active = NULL;
+	bus->state = I2CQ_ST_IDLE;
+	bus->parked = req;
+	bus->poll_us = bus->port.now(bus->port.ctx);
+}
+
+/*!
+ ******************************************************************************
+ *	Ends a request and calls its callback
+ ******************************************************************************
+*/
+static void I2CQ_Finish(I2CQ_Bus_t *bus,I2CQ_Request_t *req,I2C_status_t status)
+{
+	if (bus->active == req)
+	{
+		bus->active = NULL;
+		bus->state = I2CQ_ST_IDLE;
+	}
+	bus->requests++;
+	if (status != I2C_Stat_Success)
+		bus->errors++;
+	req->status = status;
+	if (req->callback != NULL)
+		req->callback(req);
+}
+
+/*!
+ ******************************************************************************
+ *	Starts the next transfer if the bus is free: the poll of the parked
+ *	request when its interval is over, else the oldest ready request of the
+ *	highest priority. The timer waits for the next poll if nothing is ready.
+ ******************************************************************************
+*/
+static void I2CQ_Schedule(I2CQ_Bus_t *bus)
+{
+I2CQ_Request_t		*req;
+uint32_t				elapsed = 0;
+
+	if (bus->active != NULL)
+		return;
+	if (bus->parked != NULL)
+		elapsed = bus->port.now(bus->port.ctx) - bus->poll_us;
+	for (int p = 0;p < I2CQ_PRIORITIES;p++)
+	{
+		if (bus->parked != NULL && bus->parked->priority == p && elapsed >= bus->config.poll_us)
+		{
+			I2CQ_StartPoll(bus);
+			return;
+		}
+		for (req = bus->head[p];req != NULL;req = req->next)
+		{
+			if (I2CQ_Ready(bus,req))
+			{
+				I2CQ_Unlink(bus,req);
+				I2CQ_StartTransfer(bus,req);
+				return;
+			}
+		}
+	}
+	if (bus->parked != NULL)
+		I2CQ_SetTimer(bus,I2CQ_TIMER_POLL,elapsed < bus->config.poll_us ? bus->config.poll_us - elapsed : 0);
+	else
+		I2CQ_SetTimer(bus,I2CQ_TIMER_OFF,0);
+}
+
+/*!
+ ******************************************************************************
+ *	Initializes the queue of a bus
+ *	\param[out]	bus			bus
+ *	\param[in]	port			operations of the bus hardware
+ *	\param[in]	config		timing
+ ******************************************************************************
+*/
+void I2CQ_Init(I2CQ_Bus_t *bus,const I2CQ_Port_t *port,const I2CQ_Config_t *config)
+{
+	memset(bus,0,sizeof(*bus));
+	bus->port = *port;
+	bus->config = *config;
+}
+
+/*!
+ ******************************************************************************
+ *	Queues a request, it is started at once if the bus is free
+ *	\param[in]	bus			bus
+ *	\param[in]	req			request, owned by the queue until it is done
+ * \return     true if success, false if the request is invalid
+ ******************************************************************************
+*/
+bool I2CQ_Submit(I2CQ_Bus_t *bus,I2CQ_Request_t *req)
+{
+uint8_t		p = req->priority;
+
+	if (p >= I2CQ_PRIORITIES || req->sub_size > sizeof(bus->sub) || (req->len != 0 && req->data == NULL) ||
+		 ((req->flags & I2CQ_READ) && req->len == 0))
+	{
+		req->status = I2C_Stat_Invalid_Argument;
+		return false;
+	}
+	req->next = NULL;
+	req->done = 0;
+	req->chunk = 0;
+	req->status = I2C_Stat_Busy;
+	if (bus->head[p] == NULL)
+		bus->head[p] = req;
+	else
+		bus->tail[p]->next = req;
+	bus->tail[p] = req;
+	I2CQ_Schedule(bus);
+	return true;
+}
+
+/*!
+ ******************************************************************************
+ *	Cancels a request (timeout of the caller). A transfer in progress is
+ *	stopped, the callback is not called.
+ *	\param[in]	bus			bus
+ *	\param[in]	req			request
+ * \return     true if the request was cancelled, false if it was done
+ ******************************************************************************
+*/
+bool I2CQ_Cancel(I2CQ_Bus_t *bus,I2CQ_Request_t *req)
+{
+	if (req->status != I2C_Stat_Busy)
+		return false;
+	if (bus->active == req)
+	{
+		bus->port.stop(bus->port.ctx);
+		bus->active = NULL;
+		bus->state = I2CQ_ST_IDLE;
+	}
+	else if (bus->parked == req)
+		bus->parked = NULL;
+	else
+		I2CQ_Unlink(bus,req);
+	req->status = I2C_Stat_Idle;
+	I2CQ_Schedule(bus);
+	return true;
+}
+
+/*!
+ ******************************************************************************
+ *	Bus event, called by the port from its interrupts
+ *	\param[in]	bus			bus
+ *	\param[in]	event			event
+ ******************************************************************************
+*/
+void I2CQ_Event(I2CQ_Bus_t *bus,I2CQ_Event_t event)
+{
+I2CQ_Request_t		*req = bus->active;
+uint32_t				sub;
+uint8_t				use;
+
+	if (event == I2CQ_EV_TIMER)
+	{
+		use = bus->timer;
+		bus->timer = I2CQ_TIMER_OFF;
+		if (use == I2CQ_TIMER_TIMEOUT && req != NULL)
+		{
+			bus->port.stop(bus->port.ctx);
+			I2CQ_Finish(bus,req,I2C_Stat_Timeout);
+		}
+		I2CQ_Schedule(bus);
+		return;
+	}
+	if (req == NULL)
+		return;
+	if (event == I2CQ_EV_ARB_LOST)
+	{
+		bus->port.stop(bus->port.ctx);
+		I2CQ_Finish(bus,req,I2C_Stat_ArbitrationLost);
+	}
+	else if (event == I2CQ_EV_NAK)
+	{
+		bus->port.stop(bus->port.ctx);
+		if (bus->state != I2CQ_ST_POLL)
+			I2CQ_Finish(bus,req,(bus->state == I2CQ_ST_ADDR_W || bus->state == I2CQ_ST_ADDR_R) ? I2C_Stat_Addr_Nak : I2C_Stat_Nak);
+		else if (bus->port.now(bus->port.ctx) - req->start_us >= bus->config.write_time_us)
+			I2CQ_Finish(bus,req,I2C_Stat_Timeout);
+		else
+			I2CQ_Park(bus,req);		// still writing
+	}
+	else switch (bus->state)
+	{
+		case I2CQ_ST_ADDR_W:
+			if (req->sub_size != 0)
+			{
+				sub = req->sub_address + ((req->flags & I2CQ_READ) ? 0 : req->done);
+				for (int i = 0;i < req->sub_size;i++)
+					bus->sub[i] = (uint8_t)(sub >> ((req->sub_size - 1 - i) * 8));
+				bus->state = I2CQ_ST_SUB;
+				bus->port.write(bus->port.ctx,bus->sub,req->sub_size);
+				return;
+			}
+			/* fall through - no subaddress */
+		case I2CQ_ST_SUB:
+			if (req->flags & I2CQ_READ)
+			{
+				bus->state = I2CQ_ST_ADDR_R;
+				bus->port.start(bus->port.ctx,req->address | 1);		// repeated START
+				return;
+			}
+			bus->state = I2CQ_ST_DATA_W;
+			if (req->chunk != 0)
+			{
+				bus->port.write(bus->port.ctx,req->data + req->done,req->chunk);
+				return;
+			}
+			/* fall through - nothing to write */
+		case I2CQ_ST_DATA_W:
+			bus->port.stop(bus->port.ctx);
+			req->done += req->chunk;
+			if (req->flags & I2CQ_WRITE_CYCLE)
+			{
+				req->start_us = bus->port.now(bus->port.ctx);
+				I2CQ_Park(bus,req);
+			}
+			else if (req->done < req->len)
+			{
+				I2CQ_StartTransfer(bus,req);
+				return;
+			}
+			else
+				I2CQ_Finish(bus,req,I2C_Stat_Success);
+			break;
+		case I2CQ_ST_ADDR_R:
+			bus->state = I2CQ_ST_DATA_R;
+			bus->port.read(bus->port.ctx,req->data,req->len);
+			return;
+		case I2CQ_ST_DATA_R:
+			bus->port.stop(bus->port.ctx);
+			req->done = req->len;
+			I2CQ_Finish(bus,req,I2C_Stat_Success);
+			break;
+		case I2CQ_ST_POLL:
+			bus->port.stop(bus->port.ctx);
+			if (req->done < req->len)
+			{
+				I2CQ_StartTransfer(bus,req);
+				return;
+			}
+			I2CQ_Finish(bus,req,I2C_Stat_Success);
+			break;
+		default:
+			return;
+	}
+	I2CQ_Schedule(bus);
+}
@@ -0,0 +1,144 @@
+/*
+ * I2C_Queue.h
+ *
+ *  Transaction queue of an I2C bus
+ */
+
+#ifndef DRIVERS_I2C_QUEUE_H_
+#define DRIVERS_I2C_QUEUE_H_
+
+/*!
+ ******************************************************************************
+ *	The devices of a bus submit request descriptors, which are queued by
+ *	priority and run one at a time, driven by the events of the bus interrupt:
+ *	START and address, subaddress (MSB first), data, STOP. A read with a
+ *	subaddress uses a repeated START.
+ *	Writes to a device with a write cycle (EEPROM) are split at its page
+ *	boundaries. After each page the request is parked and the bus is free for
+ *	the other requests, the device is polled by an address write until it
+ *	acknowledges, then the next page is written. Requests to a parked device
+ *	wait until it is ready.
+ *	The completion callback is called from the bus interrupt.
+ *	All functions are called with the bus interrupts masked or from them.
+ *	The hardware is reached through a port, this file has no hardware
+ *	dependency.
+ ******************************************************************************
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum
+{
+	I2C_Stat_Success = 0,
+	I2C_Stat_Busy,            	//!< I2C is busy with current transfer
+	I2C_Stat_Idle,            	//!< Bus is Idle
+	I2C_Stat_Nak,            	//!< NAK received during transfer
+	I2C_Stat_ArbitrationLost, 	//!< Arbitration lost during transfer
+	I2C_Stat_Timeout,         	//!< Timeout poling status flags
+	I2C_Stat_Addr_Nak,        	//!< NAK received during the address probe
+	I2C_Stat_Invalid_Argument 	//!< Invalid argument
+} I2C_status_t;
+
+#define I2CQ_PRIORITIES				3				///< Number of priorities
+
+#define I2CQ_PRIO_HIGH				0				///< Short reads of sensors
+#define I2CQ_PRIO_NORMAL			1
+#define I2CQ_PRIO_LOW				2				///< Bulk transfers
+
+#define I2CQ_READ						0x01			///< Read request, else write
+#define I2CQ_WRITE_CYCLE			0x02			///< The device does not answer until a write is done
+
+typedef enum
+{
+	I2CQ_EV_DONE = 0,								//!< Operation of the port accomplished
+	I2CQ_EV_NAK,									//!< NAK received
+	I2CQ_EV_ARB_LOST,								//!< Arbitration lost
+	I2CQ_EV_TIMER									//!< Timer of the port expired
+} I2CQ_Event_t;
+
+/*!
+ ******************************************************************************
+ *	Operations of the bus hardware. start, write and read end with an event,
+ *	stop is done at once.
+ ******************************************************************************
+*/
+typedef struct {
+	void		(*start)(void *ctx,uint8_t address);					// START or repeated START, address byte
+	void		(*write)(void *ctx,const uint8_t *data,uint32_t len);	// len > 0
+	void		(*read)(void *ctx,uint8_t *data,uint32_t len);			// len > 0, the last byte is not acknowledged
+	void		(*stop)(void *ctx);
+	void		(*timer)(void *ctx,uint32_t us);						// one shot, 0 stops the timer
+	uint32_t	(*now)(void *ctx);										// free running time in us
+	void		*ctx;
+} I2CQ_Port_t;
+
+typedef struct {
+	uint32_t	timeout_us;			// time of a transfer without its bytes
+	uint32_t	byte_us;				// time of a byte on the bus
+	uint32_t	poll_us;				// interval of the polls of a device in its write cycle
+	uint32_t	write_time_us;		// max duration of a write cycle
+} I2CQ_Config_t;
+
+typedef struct I2CQ_Request_s I2CQ_Request_t;
+
+typedef void (*I2CQ_Callback_t)(I2CQ_Request_t *req);		///< End of a request, from the interrupt
+
+struct I2CQ_Request_s {
+	I2CQ_Request_t			*next;
+	uint8_t					address;			// 8 bit slave address
+	uint8_t					priority;		// I2CQ_PRIO_...
+	uint8_t					flags;			// I2CQ_READ, I2CQ_WRITE_CYCLE
+	uint8_t					sub_size;		// 0 .. 4 bytes
+	uint32_t					sub_address;
+	uint16_t					page_size;		// writes are split at page boundaries, 0 if none
+	uint8_t					*data;
+	uint32_t					len;
+	I2CQ_Callback_t		callback;		// may be NULL
+	void						*arg;
+	volatile I2C_status_t	status;			// I2C_Stat_Busy until the request is done
+	uint32_t					done;				// bytes transferred
+	uint32_t					chunk;			// bytes of the page being written
+	uint32_t					start_us;		// begin of the write cycle
+};
+
+typedef struct {
+	I2CQ_Port_t				port;
+	I2CQ_Config_t			config;
+	I2CQ_Request_t			*head[I2CQ_PRIORITIES];
+	I2CQ_Request_t			*tail[I2CQ_PRIORITIES];
+	I2CQ_Request_t			*active;			// request on the bus
+	I2CQ_Request_t			*parked;			// request waiting for the write cycle of its device
+	uint8_t					state;
+	uint8_t					timer;			// use of the timer of the port
+	uint8_t					sub[4];
+	uint32_t					poll_us;			// time of the last poll
+	uint32_t					requests;		// requests done
+	uint32_t					errors;			// requests failed
+	uint32_t					polls;			// polls of devices in their write cycle
+} I2CQ_Bus_t;
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* __cplusplus */
+
+void I2CQ_Init(I2CQ_Bus_t *bus,const I2CQ_Port_t *port,const I2CQ_Config_t *config);
+bool I2CQ_Submit(I2CQ_Bus_t *bus,I2CQ_Request_t *req);
+bool I2CQ_Cancel(I2CQ_Bus_t *bus,I2CQ_Request_t *req);
+void I2CQ_Event(I2CQ_Bus_t *bus,I2CQ_Event_t event);
+
+/*!
+ ******************************************************************************
+ *	Checks if a request is queued or in progress
+ ******************************************************************************
+*/
+static inline bool I2CQ_Pending(const I2CQ_Request_t *req)
+{
+	return req->status == I2C_Stat_Busy;
+}
+
+#if defined(__cplusplus)
+}
+#endif /* __cplusplus */
+
+#endif /* DRIVERS_I2C_QUEUE_H_ */
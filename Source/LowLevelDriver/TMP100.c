@@ -1,5 +1,20 @@
 #include "TMP100.h"
 
+static I2C_Device_t		tmp100_dev;
+
+/*!
+ *********************************************************************************
+ * Initializes the temperature sensors, a device of the I2C transaction queue
+ * with high priority, so that the short register reads are not delayed by the
+ * block transfers of the other devices
+ * \return		true if success, false else
+ *********************************************************************************
+*/
+bool TMP100_Init(void)
+{
+	return I2C_DeviceInit(&tmp100_dev,I2CQ_PRIO_HIGH,0,0);
+}
+
 static bool TMP100_WriteRegister(uint8_t channel,uint8_t SubAddr,uint8_t *values,unsigned size)
 {
 uint8_t	SlaveAddr;
@@ -19,7 +34,7 @@ uint8_t	SlaveAddr;
 		return false;
 	if (size < 1 || size > 2)
 		return false;
-	return I2C_WriteI2C(SlaveAddr,SubAddr,1,values,size);
+	return I2C_DeviceWrite(&tmp100_dev,SlaveAddr,SubAddr,1,values,size);
 }
 
 static bool TMP100_ReadRegister(uint8_t channel,uint8_t SubAddr,uint8_t *result,unsigned size)
@@ -41,7 +56,7 @@ uint8_t	SlaveAddr;
 		return false;
 	if (size < 1 || size > 2)
 		return false;
-	return I2C_ReadI2C(SlaveAddr,SubAddr,1,result,size);
+	return I2C_DeviceRead(&tmp100_dev,SlaveAddr,SubAddr,1,result,size);
 }
 
 bool TMP100_ReadTempReg(uint8_t channel,int *result)
@@ -22,6 +22,7 @@
 extern "C" {
 #endif /* __cplusplus */
 
+bool TMP100_Init(void);
 bool TMP100_ReadTempReg(uint8_t channel,int *result);
 bool TMP100_WriteConfReg(uint8_t channel,uint8_t value);
 bool TMP100_ReadConfReg(uint8_t channel,uint8_t *result);
@@ -15,22 +15,28 @@
 
 
 #include "common.h"
+#include "fsl_common.h"
 #include "crc.h"
+#include "crc16.h"
 
 //#define BYTE_ENABLES_7_E
 //#define BYTE_ENABLES_3_6_C
 //#define BYTE_ENABLES_1_2_4_8
 
+static volatile uint8_t		crc_busy = 0;		// the peripheral is computing a CRC
+
+static int CRC_Config(uint32_t poly,uint32_t tot,uint32_t totr,uint32_t fxor,uint32_t tcrc);
 
 /*!
  ******************************************************************************
- *	Initializes the CRC peripheral
+ *	Initializes the CRC peripheral for the CRC16-CCITT of CRC_Calc16
  ******************************************************************************
 */
 void CRC_init(void)
 {
    // Enable clock gating to CRC
    SIM->SCGC6 |= SIM_SCGC6_CRC_MASK;
+   CRC_Config(CRC16_CCITT_POLY,0,0,0,0);
 }
 
 /*!
@@ -44,7 +50,7 @@ void CRC_init(void)
  * \return        0 if success, error code else
  ******************************************************************************
 */
-int CRC_Config (uint32_t poly,uint32_t tot,uint32_t totr,uint32_t fxor,uint32_t tcrc)
+static int CRC_Config(uint32_t poly,uint32_t tot,uint32_t totr,uint32_t fxor,uint32_t tcrc)
 {
 uint32_t    ctrl_reg;
 int         error = CRC_ERR_SUCCESS;
@@ -81,20 +87,32 @@ int         error = CRC_ERR_SUCCESS;
 
 /*!
  ******************************************************************************
- *	Calculates a 16Bit CRC
+ *	Calculates the CRC16-CCITT of a buffer. The peripheral is fed with aligned
+ *	32-bit words (most significant byte first, i.e. in memory order after
+ *	__REV) plus the unaligned head and tail bytes. Short buffers, and calls
+ *	while the peripheral is in use (preempting task or interrupt), are
+ *	computed by the table of crc16.c: the result is the same.
  * \param[in]		seed	      starting value
  * \param[in]		msg	      Buffer with data
  * \param[in]		sizeBytes	Length of Buffer in Bytes
- * \param[in]		reverse	   if 1 the result is bit and byte reversed
  * \return        result of CRC calculation
  ******************************************************************************
 */
-uint32_t CRC_Cal_16(uint32_t seed,void *msg, uint32_t sizeBytes,uint8_t reverse)
+uint16_t CRC_Calc16(uint16_t seed,const void *msg,uint32_t sizeBytes)
 {
-uint32_t    ctrl_reg;
-uint32_t    i;
-uint8_t     *p;
+const uint8_t	*p = (const uint8_t *)msg;
+uint32_t       ctrl_reg,primask;
+uint16_t       crc;
+bool           busy;
 
+   if (sizeBytes < CRC_HW_MIN_LEN)
+      return CRC16_Update(seed,p,sizeBytes);
+   primask = DisableGlobalIRQ();
+   busy = crc_busy;
+   crc_busy = 1;
+   EnableGlobalIRQ(primask);
+   if (busy)
+      return CRC16_Update(seed,p,sizeBytes);
 
    // Input seed, Set WaS=1
    ctrl_reg = CRC0->CTRL;
@@ -103,15 +121,20 @@ uint8_t     *p;
 
    // Input data, Set WaS=0
    CRC0->CTRL = ctrl_reg & ~CRC_CTRL_WAS_MASK;
-
-   // Wait for calculation completion
-   p = (uint8_t *)msg;
-   for (i=0;i<sizeBytes;i++)
+   while (sizeBytes && ((uint32_t)p & 3))
    {
       CRC0->ACCESS8BIT.DATALL = *p++;
+      sizeBytes--;
    }
-   if (reverse)
-      return(CRC0->DATA >> 16);
-   else
-      return(CRC0->DATA);
+   while (sizeBytes >= 4)
+   {
+      CRC0->DATA = __REV(*(const uint32_t *)p);
+      p += 4;
+      sizeBytes -= 4;
+   }
+   while (sizeBytes--)
+      CRC0->ACCESS8BIT.DATALL = *p++;
+   crc = CRC0->ACCESS16BIT.DATAL;
+   crc_busy = 0;
+   return crc;
 }
@@ -21,9 +21,18 @@ typedef volatile uint8_t  vuint8_t;
 #define CRC_ERR_FXOR_VAL     (CRC_ERR_CODE_BASE+3)
 #define CRC_ERR_TCRC_VAL     (CRC_ERR_CODE_BASE+4)
 
+#define CRC_HW_MIN_LEN       16           ///< Shorter buffers are computed by the table of crc16.c
+
 // Prototypes
+#if defined(__cplusplus)
+extern "C" {
+#endif /* __cplusplus */
+
 void     CRC_init(void);
-int      CRC_Config(uint32_t poly,uint32_t tot,uint32_t totr,uint32_t fxor,uint32_t tcrc);
-uint32_t CRC_Cal_16(uint32_t seed,void *msg, uint32_t sizeBytes,uint8_t reverse);
+uint16_t CRC_Calc16(uint16_t seed,const void *msg,uint32_t sizeBytes);
+
+#if defined(__cplusplus)
+}
+#endif /* __cplusplus */
 
 #endif /* CRC_H_ */
@@ -0,0 +1,43 @@
+/*
+ * crc16.h
+ *
+ *  Table driven CRC16-CCITT (polynomial 0x1021, MSB first, no reflection, no
+ *  final XOR): the same CRC as the CRC peripheral computes as configured by
+ *  CRC_init. Used where the peripheral cannot be (interrupts, byte by byte
+ *  while a packet is received) and as fallback. This file has no hardware
+ *  dependency.
+ */
+
+#ifndef CRC16_H_
+#define CRC16_H_
+
+#include <stdint.h>
+
+#define	CRC16_CCITT_POLY		0x1021			///< Polynomial of the command interface and the EEPROM CRC
+
+extern const uint16_t		CRC16_Table[256];
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* __cplusplus */
+
+uint16_t CRC16_Update(uint16_t crc,const void *msg,uint32_t len);
+
+/*!
+ ******************************************************************************
+ *	Adds one byte to a CRC
+ *	\param[in]	crc			CRC of the previous bytes (seed for the first one)
+ *	\param[in]	ch				byte
+ * \return     CRC including ch
+ ******************************************************************************
+*/
+static inline uint16_t CRC16_UpdateByte(uint16_t crc,uint8_t ch)
+{
+	return (uint16_t)((crc << 8) ^ CRC16_Table[(uint8_t)((crc >> 8) ^ ch)]);
+}
+
+#if defined(__cplusplus)
+}
+#endif /* __cplusplus */
+
+#endif /* CRC16_H_ */
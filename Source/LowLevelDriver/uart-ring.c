@@ -0,0 +1,286 @@
+/*
+ * uart-ring.c
+ *
+ *  Ring buffers, packet framing and transmit segments of the DMA driven UART
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include "uart-ring.h"
+
+/*!
+ ******************************************************************************
+ *	Initializes a ring
+ *	\param[out]	ring			ring
+ *	\param[in]	buf			buffer, aligned to its size if a DMA wraps around it
+ *	\param[in]	size			size of the buffer, power of two
+ * \return     true if success, false if the size is not a power of two
+ ******************************************************************************
+*/
+bool UART_RingInit(UART_Ring_t *ring,uint8_t *buf,uint32_t size)
+{
+	if (ring == NULL || buf == NULL || size == 0 || (size & (size - 1)) != 0)
+		return false;
+	ring->buf = buf;
+	ring->size = size;
+	ring->head = 0;
+	ring->tail = 0;
+	return true;
+}
+
+/*!
+ ******************************************************************************
+ *	Writes bytes into a ring (single writer)
+ * \return     number of bytes written (limited by the free space)
+ ******************************************************************************
+*/
+uint32_t UART_RingWrite(UART_Ring_t *ring,const uint8_t *data,uint32_t len)
+{
+uint32_t		n,pos,first;
+
+	n = UART_RingFree(ring);
+	if (len > n)
+		len = n;
+	pos = ring->head & (ring->size - 1);
+	first = ring->size - pos;
+	if (first > len)
+		first = len;
+	memcpy(ring->buf + pos,data,first);
+	memcpy(ring->buf,data + first,len - first);
+	ring->head += len;
+	return len;
+}
+
+/*!
+ ******************************************************************************
+ *	Writes a packet as a frame into a ring: <SOP><stuffed packet and CRC><EOP>
+ *	\param[in]	ring			ring
+ *	\param[in]	packet		packet
+ *	\param[in]	len			length of the packet
+ *	\param[in]	crc			CRC of the packet, sent LSB first
+ * \return     frame length, 0 if the ring has not enough space (nothing written)
+ ******************************************************************************
+*/
+uint32_t UART_RingStuffPacket(UART_Ring_t *ring,const uint8_t *packet,int len,uint16_t crc)
+{
+uint8_t		out[2];
+uint32_t		head,mask,n;
+int			i,k;
+
+	if (len < 0 || UART_RingFree(ring) < (uint32_t)UART_STUFFED_MAX(len))
+		return 0;
+	mask = ring->size - 1;
+	head = ring->head;
+	ring->buf[head++ & mask] = UART_SOP;
+	for (i = 0;i < len + 2;i++)
+	{
+		uint8_t ch = (i < len) ? packet[i] : (uint8_t)(crc >> (8 * (i - len)));
+		n = UART_StuffByte(ch,out);
+		for (k = 0;k < (int)n;k++)
+			ring->buf[head++ & mask] = out[k];
+	}
+	ring->buf[head++ & mask] = UART_EOP;
+	n = head - ring->head;
+	ring->head = head;					// publish the frame
+	return n;
+}
+
+/*!
+ ******************************************************************************
+ *	Builds a frame in a caller buffer: <SOP><stuffed packet and CRC><EOP>
+ *	\param[out]	frame			frame buffer
+ *	\param[in]	max			size of the frame buffer
+ *	\param[in]	packet		packet
+ *	\param[in]	len			length of the packet
+ *	\param[in]	crc			CRC of the packet, sent LSB first
+ * \return     frame length, 0 if the buffer is too small
+ ******************************************************************************
+*/
+int UART_StuffFrame(uint8_t *frame,int max,const uint8_t *packet,int len,uint16_t crc)
+{
+int			i,n;
+
+	if (len < 0 || max < UART_STUFFED_MAX(len))
+		return 0;
+	n = 0;
+	frame[n++] = UART_SOP;
+	for (i = 0;i < len + 2;i++)
+		n += UART_StuffByte((i < len) ? packet[i] : (uint8_t)(crc >> (8 * (i - len))),frame + n);
+	frame[n++] = UART_EOP;
+	return n;
+}
+
+/*!
+ ******************************************************************************
+ *	Initializes a deframer
+ *	\param[out]	deframer		deframer
+ *	\param[in]	buf			packet buffer
+ *	\param[in]	max			size of the packet buffer
+ ******************************************************************************
+*/
+void UART_DeframerInit(UART_Deframer_t *deframer,uint8_t *buf,int max)
+{
+	deframer->buf = buf;
+	deframer->max = max;
+	deframer->len = 0;
+	deframer->state = 0;
+	deframer->crc = 0;
+}
+
+/*!
+ ******************************************************************************
+ *	Feeds one received byte to the deframer
+ *	\details	A premature SOP restarts the packet, a wrong escape sequence or a
+ *				packet longer than the buffer drops the packet. The CRC is computed
+ *				two bytes behind the received ones, so that it is the CRC of the
+ *				packet without its CRC when the EOP is received.
+ *	\param[in]	deframer		deframer
+ *	\param[in]	ch				received byte
+ * \return     packet length (CRC included) when ch completes a packet, 0 while
+ *					no packet is complete, UART_DEFRAME_ESCAPE_SEQ or
+ *					UART_DEFRAME_BUFFER_OVERFLOW when a packet is dropped
+ ******************************************************************************
+*/
+int UART_Deframe(UART_Deframer_t *deframer,uint8_t ch)
+{
+	switch (deframer->state)
+	{
+		case 0:										// waiting for SOP
+			if (ch == UART_SOP)
+			{
+				deframer->len = 0;
+				deframer->crc = 0;
+				deframer->state = 1;
+			}
+			return 0;
+		case 1:										// in packet
+			if (ch == UART_SOP)					// premature SOP, the packet restarts
+			{
+				deframer->len = 0;
+				deframer->crc = 0;
+				return 0;
+			}
+			if (ch == UART_EOP)
+			{
+				deframer->state = 0;
+				return deframer->len;
+			}
+			if (ch == UART_ESC)
+			{
+				deframer->state = 2;
+				return 0;
+			}
+			break;
+		default:										// decode the byte stuffed char
+			switch (ch)
+			{
+				case UART_ESC_ESC:
+					ch = UART_ESC;
+					break;
+				case UART_ESC_SOP:
+					ch = UART_SOP;
+					break;
+				case UART_ESC_EOP:
+					ch = UART_EOP;
+					break;
+				default:
+					deframer->state = 0;			// wrong escape sequence, packet is dropped
+					return UART_DEFRAME_ESCAPE_SEQ;
+			}
+			deframer->state = 1;
+			break;
+	}
+	if (deframer->len >= deframer->max)
+	{
+		deframer->state = 0;						// buffer overflow, packet is dropped
+		return UART_DEFRAME_BUFFER_OVERFLOW;
+	}
+	if (deframer->len >= 2)
+		deframer->crc = CRC16_UpdateByte(deframer->crc,deframer->buf[deframer->len - 2]);
+	deframer->buf[deframer->len++] = ch;
+	return 0;
+}
+
+/*!
+ ******************************************************************************
+ *	Initializes a transmit segment queue
+ ******************************************************************************
+*/
+void UART_TxQueueInit(UART_TxQueue_t *queue)
+{
+	memset(queue,0,sizeof(*queue));
+}
+
+/*!
+ ******************************************************************************
+ *	Queues a transmit segment
+ *	\details	A ring segment following a ring segment which is not being sent yet
+ *				extends it (the ring is written in order, so they are contiguous).
+ *	\param[in]	queue			queue
+ *	\param[in]	data			first byte
+ *	\param[in]	len			number of bytes
+ *	\param[in]	ring			true if the bytes are in the TX ring
+ *	\param[in]	done			called when a caller frame has been sent, may be NULL
+ * \return     true if success, false if the queue is full
+ ******************************************************************************
+*/
+bool UART_TxQueuePush(UART_TxQueue_t *queue,const uint8_t *data,uint32_t len,bool ring,
+							 void (*done)(const uint8_t *data))
+{
+UART_TxSegment_t		*seg;
+
+	if (len == 0 || len > UART_TX_MAX_SEGMENT_LEN)
+		return false;
+	if (ring && (queue->head - queue->tail) >= 2)
+	{
+		seg = &queue->seg[(queue->head - 1) & (UART_TX_MAX_SEGMENTS - 1)];
+		if (seg->ring && (seg->len + len) <= UART_TX_MAX_SEGMENT_LEN)
+		{
+			seg->len += len;
+			return true;
+		}
+	}
+	if (UART_TxQueueFull(queue))
+		return false;
+	seg = &queue->seg[queue->head & (UART_TX_MAX_SEGMENTS - 1)];
+	seg->data = data;
+	seg->len = len;
+	seg->ring = ring;
+	seg->done = done;
+	queue->head++;
+	return true;
+}
+
+/*!
+ ******************************************************************************
+ *	Gets the segment to send, NULL if the queue is empty
+ ******************************************************************************
+*/
+UART_TxSegment_t * UART_TxQueueFront(UART_TxQueue_t *queue)
+{
+	if (queue->head == queue->tail)
+		return NULL;
+	return &queue->seg[queue->tail & (UART_TX_MAX_SEGMENTS - 1)];
+}
+
+/*!
+ ******************************************************************************
+ *	Removes the segment which has been sent: releases its bytes in the ring or
+ *	reports the end of a caller frame
+ ******************************************************************************
+*/
+void UART_TxQueuePop(UART_TxQueue_t *queue,UART_Ring_t *ring)
+{
+UART_TxSegment_t		*seg = UART_TxQueueFront(queue);
+
+	if (seg == NULL)
+		return;
+	if (seg->ring)
+		ring->tail += seg->len;
+	else
+		if (seg->done != NULL)
+			seg->done(seg->data);
+	queue->tail++;
+}
@@ -0,0 +1,148 @@
+/*
+ * uart-ring.h
+ *
+ *  Ring buffers, packet framing and transmit segments of the DMA driven UART
+ */
+
+#ifndef UART_RING_H_
+#define UART_RING_H_
+
+/*!
+ ******************************************************************************
+ *	The DMA (see uart.c) only moves bytes between the UART and the buffers
+ *	handled here:
+ *	- RX: the DMA writes into a ring buffer, the driver hands the bytes written
+ *	  since the last call to the deframer (idle line, half and full interrupts)
+ *	- TX: packets are stuffed into a ring or supplied pre-stuffed by the caller
+ *	  (zero copy), each piece is queued as a segment which the DMA sends in order
+ *	This file has no hardware dependency.
+ ******************************************************************************
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "crc16.h"
+
+#define	UART_SOP				0xA0				///< Start of package
+#define	UART_EOP				0x05				///< End of package
+#define	UART_ESC				0xF0				///< Escape sequence
+#define	UART_ESC_ESC		0xF0				///< Byte stuffing of ESC
+#define	UART_ESC_SOP		0x01				///< Byte stuffing of SOP
+#define	UART_ESC_EOP		0x02				///< Byte stuffing of EOP
+
+#define	UART_STUFFED_MAX(len)		(2 * ((len) + 2) + 2)	///< Worst case frame length of a packet (CRC included)
+#define	UART_TX_MAX_SEGMENTS			8								///< Transmit segments in the queue (power of two)
+#define	UART_TX_MAX_SEGMENT_LEN		0x7FFF						///< Maximum major loop count of the DMA
+
+#define	UART_DEFRAME_BUFFER_OVERFLOW	(-0x02)						///< Packet dropped: -E_BUFFER_OVERFLOW of uart.h
+#define	UART_DEFRAME_ESCAPE_SEQ			(-0x03)						///< Packet dropped: -E_ESCAPE_SEQ of uart.h
+
+typedef struct {
+	uint8_t					*buf;
+	uint32_t					size;					// power of two
+	volatile uint32_t		head;					// free running write index
+	volatile uint32_t		tail;					// free running read index
+} UART_Ring_t;
+
+typedef struct {
+	uint8_t					*buf;					// packet buffer, stuffing removed
+	int						max;					// size of the packet buffer
+	int						len;					// bytes of the current packet
+	uint8_t					state;				// 0: wait for SOP, 1: in packet, 2: after ESC
+	uint16_t					crc;					// CRC of the bytes but the last two (the CRC once complete)
+} UART_Deframer_t;
+
+typedef struct {
+	const uint8_t			*data;
+	uint16_t					len;
+	bool						ring;					// data is in the TX ring (wraps around)
+	void						(*done)(const uint8_t *data);		// called when a caller frame has been sent
+} UART_TxSegment_t;
+
+typedef struct {
+	UART_TxSegment_t		seg[UART_TX_MAX_SEGMENTS];
+	volatile uint32_t		head;					// free running index of the next free segment
+	volatile uint32_t		tail;					// free running index of the segment being sent
+} UART_TxQueue_t;
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* __cplusplus */
+
+bool UART_RingInit(UART_Ring_t *ring,uint8_t *buf,uint32_t size);
+uint32_t UART_RingWrite(UART_Ring_t *ring,const uint8_t *data,uint32_t len);
+uint32_t UART_RingStuffPacket(UART_Ring_t *ring,const uint8_t *packet,int len,uint16_t crc);
+int UART_StuffFrame(uint8_t *frame,int max,const uint8_t *packet,int len,uint16_t crc);
+
+void UART_DeframerInit(UART_Deframer_t *deframer,uint8_t *buf,int max);
+int UART_Deframe(UART_Deframer_t *deframer,uint8_t ch);
+
+void UART_TxQueueInit(UART_TxQueue_t *queue);
+bool UART_TxQueuePush(UART_TxQueue_t *queue,const uint8_t *data,uint32_t len,bool ring,
+							 void (*done)(const uint8_t *data));
+UART_TxSegment_t * UART_TxQueueFront(UART_TxQueue_t *queue);
+void UART_TxQueuePop(UART_TxQueue_t *queue,UART_Ring_t *ring);
+
+/*!
+ ******************************************************************************
+ *	Gets the number of bytes in a ring
+ ******************************************************************************
+*/
+static inline uint32_t UART_RingUsed(const UART_Ring_t *ring)
+{
+	return ring->head - ring->tail;
+}
+
+/*!
+ ******************************************************************************
+ *	Gets the free space of a ring
+ ******************************************************************************
+*/
+static inline uint32_t UART_RingFree(const UART_Ring_t *ring)
+{
+	return ring->size - (ring->head - ring->tail);
+}
+
+/*!
+ ******************************************************************************
+ *	Byte stuffing of one byte
+ * \return     number of bytes stored in out (1 or 2)
+ ******************************************************************************
+*/
+static inline int UART_StuffByte(uint8_t ch,uint8_t *out)
+{
+	switch (ch)
+	{
+		case UART_SOP:
+			out[0] = UART_ESC;
+			out[1] = UART_ESC_SOP;
+			return 2;
+		case UART_EOP:
+			out[0] = UART_ESC;
+			out[1] = UART_ESC_EOP;
+			return 2;
+		case UART_ESC:
+			out[0] = UART_ESC;
+			out[1] = UART_ESC_ESC;
+			return 2;
+		default:
+			out[0] = ch;
+			return 1;
+	}
+}
+
+/*!
+ ******************************************************************************
+ *	Checks if a new segment can be queued
+ ******************************************************************************
+*/
+static inline bool UART_TxQueueFull(const UART_TxQueue_t *queue)
+{
+	return (queue->head - queue->tail) >= UART_TX_MAX_SEGMENTS;
+}
+
+#if defined(__cplusplus)
+}
+#endif /* __cplusplus */
+
+#endif /* UART_RING_H_ */
@@ -15,8 +15,11 @@
 
 #include <string.h>
 
-#include "Board.h"
+#include "board.h"
+#include "fsl_edma.h"
+#include "fsl_dmamux.h"
 #include "uart.h"
+#include "uart-ring.h"
 #include "CommandHandler.h"
 #include "crc.h"
 
@@ -56,6 +59,21 @@ UART_descriptor_t UART_descriptor[UART_NO_OF_UARTS] = {
 
 static UART_descriptor_t *Cmd_IF_Uart = &(UART_descriptor[0]);
 
+/*
+ * DMA driven command interface (UART0), see uart-ring.h. The rings are aligned
+ * to their size for the modulo addressing of the eDMA.
+ */
+static uint8_t             uart_rx_buf[UART_RX_RING_LEN] __attribute__((aligned(UART_RX_RING_LEN)));
+static uint8_t             uart_tx_buf[UART_TX_RING_LEN] __attribute__((aligned(UART_TX_RING_LEN)));
+static uint32_t            uart_rx_read = 0;
+static uint32_t            uart_rx_idle = 0;
+static UART_Ring_t         uart_tx_ring = { uart_tx_buf, UART_TX_RING_LEN, 0, 0 };
+static UART_TxQueue_t      uart_tx_queue;
+static volatile bool       uart_tx_busy = false;
+static volatile bool       uart_tx_writing = false;
+static bool                uart_dma_ready = false;
+static volatile uint32_t   uart_tx_dropped = 0;
+
 /*!
  ******************************************************************************
  *	Restores the default UART descriptors
@@ -275,24 +293,70 @@ static int UART_CheckAndHandleError(UART_Type *UART) {
 
 /*!
  ******************************************************************************
- *	UART command handler interrupt dispacher
+ *	Position of the RX DMA in the RX ring
+ ******************************************************************************
+ */
+static uint32_t UART_RxWriteIndex(void) {
+	return (DMA0->TCD[UART_DMA_RX_CHANNEL].DADDR - (uint32_t) uart_rx_buf)
+			& (UART_RX_RING_LEN - 1);
+}
+
+/*!
+ ******************************************************************************
+ *	Hands the bytes written by the RX DMA since the last call to the command
+ * interface. Called by the idle line and the RX DMA interrupts, which have the
+ * same priority.
+ ******************************************************************************
+ */
+static void UART_ReceiveDMA(void) {
+	uint32_t write, read;
+
+	write = UART_RxWriteIndex();
+	read = uart_rx_read;
+	if (write == read || Cmd_IF_Uart->IF_function != eUARTtype_CommandIF) {
+		uart_rx_read = write;
+		return;
+	}
+	if (write < read) {
+		UART_CmdIF_HandleRx(&uart_rx_buf[read], UART_RX_RING_LEN - read);
+		read = 0;
+	}
+	if (write > read)
+		UART_CmdIF_HandleRx(&uart_rx_buf[read], write - read);
+	uart_rx_read = write;
+}
+
+/*!
+ ******************************************************************************
+ *	UART command handler interrupt dispacher. The received bytes are moved by
+ * the DMA, the UART interrupts on an idle line (end of a burst) and on the
+ * first edges of the next burst.
  * \param[in]     UART     UART interface generating the interrupt
  ******************************************************************************
  */
 static void UART_CmdIF_IRQDispatcher(int IFnum) {
 	int status;
+	UART_Type *UART = UART_descriptor[IFnum].IF_ptr;
 
-	if ((status = UART_CheckAndHandleError(UART_descriptor[IFnum].IF_ptr))
-			== -1)
+	if ((status = UART_CheckAndHandleError(UART)) == -1)
 		return;
-	eUARTfunction_t UA_function = UART_descriptor[IFnum].IF_function;
-	if (status & UART_S1_RDRF_MASK) {
-		switch (UA_function) {
-		case eUARTtype_CommandIF:
-			UART_CmdIF_IRQHandler(&(UART_descriptor[IFnum]));
-			break;
-		case eUARTtype_None:
-			break;
+	if ((status & UART_S1_IDLE_MASK) && (UART->C2 & UART_C2_ILIE_MASK)) {
+		/* S1 has been read, the next read of D by the RX DMA clears IDLE. A read
+		 * of D here could take a byte from the DMA. Until then the idle interrupt
+		 * is masked and the RX edge interrupt waits for the next burst. */
+		UART->C2 &= ~UART_C2_ILIE_MASK;
+		UART->S2 = (UART->S2 & ~UART_S2_LBKDIF_MASK) | UART_S2_RXEDGIF_MASK;
+		UART->BDH |= UART_BDH_RXEDGIE_MASK;
+		UART_ReceiveDMA();
+		uart_rx_idle = uart_rx_read;
+	}
+	if ((UART->BDH & UART_BDH_RXEDGIE_MASK) && (UART->S2 & UART_S2_RXEDGIF_MASK)) {
+		UART->S2 = (UART->S2 & ~UART_S2_LBKDIF_MASK) | UART_S2_RXEDGIF_MASK;
+		/* The DMA has read D since the idle line: IDLE is cleared, the next one
+		 * ends this burst. A burst of a single byte waits for the next one. */
+		if (UART_RxWriteIndex() != uart_rx_idle) {
+			UART->BDH &= ~UART_BDH_RXEDGIE_MASK;
+			UART->C2 |= UART_C2_ILIE_MASK;
 		}
 	}
 }
@@ -321,6 +385,66 @@ void UART1_RX_TX_IRQHandler(void) {
 #endif
 }
 
+/*!
+ ******************************************************************************
+ *	Programs the TX DMA with the next segment if it is idle. Called with the
+ * interrupts disabled or from the TX DMA interrupt.
+ ******************************************************************************
+ */
+static void UART_TxKick(void) {
+	UART_TxSegment_t *seg;
+
+	if (uart_tx_busy || (seg = UART_TxQueueFront(&uart_tx_queue)) == NULL)
+		return;
+	uart_tx_busy = true;
+	DMA0->TCD[UART_DMA_TX_CHANNEL].SADDR = (uint32_t) seg->data;
+	DMA0->TCD[UART_DMA_TX_CHANNEL].ATTR = DMA_ATTR_SSIZE(kEDMA_TransferSize1Bytes)
+			| DMA_ATTR_DSIZE(kEDMA_TransferSize1Bytes)
+			| DMA_ATTR_SMOD(seg->ring ? UART_TX_RING_MODULO : kEDMA_ModuloDisable);
+	DMA0->TCD[UART_DMA_TX_CHANNEL].CITER_ELINKNO = DMA_CITER_ELINKNO_CITER(seg->len);
+	DMA0->TCD[UART_DMA_TX_CHANNEL].BITER_ELINKNO = DMA_BITER_ELINKNO_BITER(seg->len);
+	DMA0->TCD[UART_DMA_TX_CHANNEL].CSR = DMA_CSR_DREQ_MASK | DMA_CSR_INTMAJOR_MASK;
+	EDMA_EnableChannelRequest(DMA0, UART_DMA_TX_CHANNEL);
+}
+
+/*!
+ ******************************************************************************
+ *	End of a TX segment: releases it and starts the next one
+ ******************************************************************************
+ */
+static void UART_TxDone(void) {
+	EDMA_ClearChannelStatusFlags(DMA0, UART_DMA_TX_CHANNEL,
+			kEDMA_InterruptFlag | kEDMA_DoneFlag);
+	uart_tx_busy = false;
+	UART_TxQueuePop(&uart_tx_queue, &uart_tx_ring);
+	UART_TxKick();
+}
+
+/*!
+ ******************************************************************************
+ *	Command interface RX DMA interrupt routine (half and full ring)
+ ******************************************************************************
+ */
+void DMA6_IRQHandler(void) {
+	EDMA_ClearChannelStatusFlags(DMA0, UART_DMA_RX_CHANNEL, kEDMA_InterruptFlag);
+	UART_ReceiveDMA();
+#if defined __CORTEX_M && (__CORTEX_M == 4U)
+    __DSB();
+#endif
+}
+
+/*!
+ ******************************************************************************
+ *	Command interface TX DMA interrupt routine (end of a segment)
+ ******************************************************************************
+ */
+void DMA7_IRQHandler(void) {
+	UART_TxDone();
+#if defined __CORTEX_M && (__CORTEX_M == 4U)
+    __DSB();
+#endif
+}
+
 /*!
  ******************************************************************************
  *	Initializes an UART interrupt and sets its priority
@@ -482,9 +606,72 @@ int UART_GetParity(UART_descriptor_t *IFdesc) {
 		return PARITY_NONE;
 }
 
+/*!
+ ******************************************************************************
+ *	Sets up the DMA of the command interface:
+ * - RX: the channel writes into uart_rx_buf forever (destination modulo), it
+ *   interrupts at half and full ring, the UART interrupts on an idle line
+ * - TX: the channel sends one segment of uart_tx_queue and stops, see
+ *   UART_TxKick
+ * \param[in]  IFdesc   selected interface descriptor (UART0)
+ ******************************************************************************
+ */
+static void UART_InitDMA(UART_descriptor_t *IFdesc) {
+	edma_config_t edmaConfig;
+	edma_transfer_config_t transfer;
+	UART_Type *UART = IFdesc->IF_ptr;
+
+	uart_dma_ready = false;
+	DMAMUX_Init(DMAMUX0);
+	EDMA_GetDefaultConfig(&edmaConfig);
+	EDMA_Init(DMA0, &edmaConfig);
+
+	EDMA_ResetChannel(DMA0, UART_DMA_RX_CHANNEL);
+	transfer.srcAddr = UART_GetDataRegisterAddress(UART);
+	transfer.destAddr = (uint32_t) uart_rx_buf;
+	transfer.srcTransferSize = kEDMA_TransferSize1Bytes;
+	transfer.destTransferSize = kEDMA_TransferSize1Bytes;
+	transfer.srcOffset = 0;
+	transfer.destOffset = 1;
+	transfer.minorLoopBytes = 1;
+	transfer.majorLoopCounts = UART_RX_RING_LEN;
+	EDMA_SetTransferConfig(DMA0, UART_DMA_RX_CHANNEL, &transfer, NULL);
+	EDMA_SetModulo(DMA0, UART_DMA_RX_CHANNEL, kEDMA_ModuloDisable, UART_RX_RING_MODULO);
+	EDMA_EnableAutoStopRequest(DMA0, UART_DMA_RX_CHANNEL, false);
+	EDMA_EnableChannelInterrupts(DMA0, UART_DMA_RX_CHANNEL,
+			kEDMA_MajorInterruptEnable | kEDMA_HalfInterruptEnable);
+	uart_rx_read = 0;
+
+	EDMA_ResetChannel(DMA0, UART_DMA_TX_CHANNEL);
+	transfer.srcAddr = (uint32_t) uart_tx_buf;
+	transfer.destAddr = UART_GetDataRegisterAddress(UART);
+	transfer.srcOffset = 1;
+	transfer.destOffset = 0;
+	transfer.majorLoopCounts = 1;
+	EDMA_SetTransferConfig(DMA0, UART_DMA_TX_CHANNEL, &transfer, NULL);
+	UART_RingInit(&uart_tx_ring, uart_tx_buf, UART_TX_RING_LEN);
+	UART_TxQueueInit(&uart_tx_queue);
+	uart_tx_busy = false;
+
+	DMAMUX_SetSource(DMAMUX0, UART_DMA_RX_CHANNEL, kDmaRequestMux0UART0Rx);
+	DMAMUX_EnableChannel(DMAMUX0, UART_DMA_RX_CHANNEL);
+	DMAMUX_SetSource(DMAMUX0, UART_DMA_TX_CHANNEL, kDmaRequestMux0UART0Tx);
+	DMAMUX_EnableChannel(DMAMUX0, UART_DMA_TX_CHANNEL);
+	NVIC_SetPriority(UART_DMA_RX_IRQn, IFdesc->IRQ_priority);
+	EnableIRQ(UART_DMA_RX_IRQn);
+	NVIC_SetPriority(UART_DMA_TX_IRQn, IFdesc->IRQ_priority);
+	EnableIRQ(UART_DMA_TX_IRQn);
+
+	EDMA_EnableChannelRequest(DMA0, UART_DMA_RX_CHANNEL);
+	UART_EnableRxDMA(UART, true);
+	UART_EnableTxDMA(UART, true);
+	uart_dma_ready = true;
+}
+
 /*!
  ******************************************************************************
  *	Initialize the UART with interrupts disabled, and no hardware flow-control.
+ * UART0 (command interface) receives and sends by DMA, see UART_InitDMA.
  * If parameter modbus is set the interface is enable with 8Bits + even parity,
  * else with 8Bits no parity. In both cases 1 Stopbit is used.
  * enabling the corresponding IRQ
@@ -510,12 +697,14 @@ int UART_InitUart(UART_descriptor_t *IFdesc) {
 	uart_config.baudRate_Bps = IFdesc->baudrate;
 	uart_config.enableRxRTS = false;
 	uart_config.enableTxCTS = false;
-	uart_config.idleType = kUART_IdleTypeStartBit;
+	uart_config.idleType = kUART_IdleTypeStopBit;
 	UART_Init(IFdesc->IF_ptr, &uart_config, sysclk);
 	IFdesc->IF_ptr->PFIFO &= ~UART_PFIFO_RXFE_MASK;
-	if (IFdesc->IRQ_enabled)
-		UART_EnableInterrupts(IFdesc->IF_ptr,
-				kUART_RxDataRegFullInterruptEnable);
+	if (IFdesc->IF_ptr == UART0) {
+		UART_InitDMA(IFdesc);
+		if (IFdesc->IRQ_enabled)
+			UART_EnableInterrupts(IFdesc->IF_ptr, kUART_IdleLineInterruptEnable);
+	}
 	return 1;
 }
 #ifndef DEBUG_PROTOCOL
@@ -570,15 +759,142 @@ static void UART_SendChar(UART_Type *UART, uint8_t ch) {
 	UART->D = ch;
 }
 
+/*!
+ ******************************************************************************
+ *	Serializes the writers of the TX ring and queue. Tasks lock the scheduler,
+ * an interrupt gets the lock only if no task or other interrupt holds it.
+ * \param[out]    suspended   true if the scheduler has been suspended
+ * \return        true if the lock is taken, false else
+ ******************************************************************************
+ */
+static bool UART_TxLock(bool *suspended) {
+	uint32_t primask;
+	bool locked;
+
+	*suspended = false;
+	if (__get_IPSR() == 0 && xTaskGetSchedulerState() == taskSCHEDULER_RUNNING) {
+		vTaskSuspendAll();
+		*suspended = true;
+	}
+	primask = DisableGlobalIRQ();
+	locked = !uart_tx_writing;
+	uart_tx_writing = true;
+	EnableGlobalIRQ(primask);
+	if (!locked && *suspended) {
+		xTaskResumeAll();
+		*suspended = false;
+	}
+	return locked;
+}
+
+/*!
+ ******************************************************************************
+ *	Releases the lock taken by UART_TxLock
+ ******************************************************************************
+ */
+static void UART_TxUnlock(bool suspended) {
+	uart_tx_writing = false;
+	if (suspended)
+		xTaskResumeAll();
+}
+
+/*!
+ ******************************************************************************
+ *	Waits for the TX DMA to free space. Before the scheduler runs the interrupts
+ * may be masked, the end of the segment is then handled here.
+ * \return        true if waiting is possible, false in an interrupt
+ ******************************************************************************
+ */
+static bool UART_TxWait(void) {
+	uint32_t primask;
+
+	if (__get_IPSR() != 0)
+		return false;
+	if (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING) {
+		vTaskDelay(1);
+		return true;
+	}
+	primask = DisableGlobalIRQ();
+	if (uart_tx_busy
+			&& (EDMA_GetChannelStatusFlags(DMA0, UART_DMA_TX_CHANNEL) & kEDMA_DoneFlag))
+		UART_TxDone();
+	EnableGlobalIRQ(primask);
+	return true;
+}
+
+/*!
+ ******************************************************************************
+ *	Queues a TX segment and starts the DMA if it is idle
+ * \return        true if success, false if the queue is full
+ ******************************************************************************
+ */
+static bool UART_TxStart(const uint8_t *data, uint32_t len, bool ring,
+		void (*done)(const uint8_t *data)) {
+	uint32_t primask;
+	bool ret;
+
+	primask = DisableGlobalIRQ();
+	ret = UART_TxQueuePush(&uart_tx_queue, data, len, ring, done);
+	UART_TxKick();
+	EnableGlobalIRQ(primask);
+	return ret;
+}
+
+/*!
+ ******************************************************************************
+ *	Writes bytes into the TX ring and queues them, waits for space if needed
+ * \param[in]     packet      bytes, or packet if crc is not NULL
+ * \param[in]     len         number of bytes
+ * \param[in]     crc         CRC of the packet to stuff as a frame, NULL to
+ *                            send the bytes as they are
+ * \return        number of bytes queued (less than len if the wait failed)
+ ******************************************************************************
+ */
+static int UART_TxWrite(const uint8_t *packet, int len, const uint16_t *crc) {
+	uint32_t start, n, need;
+	int done = 0;
+	bool suspended;
+
+	if (crc != NULL && UART_STUFFED_MAX(len) > UART_TX_RING_LEN)
+		return 0;
+	while (done < len) {
+		if (!UART_TxLock(&suspended))
+			break;
+		need = (crc != NULL) ? UART_STUFFED_MAX(len) : 1;
+		n = 0;
+		if (UART_RingFree(&uart_tx_ring) >= need && !UART_TxQueueFull(&uart_tx_queue)) {
+			start = uart_tx_ring.head;
+			if (crc != NULL)
+				n = UART_RingStuffPacket(&uart_tx_ring, packet, len, *crc);
+			else
+				n = UART_RingWrite(&uart_tx_ring, packet + done, len - done);
+			UART_TxStart(&uart_tx_buf[start & (UART_TX_RING_LEN - 1)], n, true, NULL);
+			done = (crc != NULL) ? len : done + n;
+		}
+		UART_TxUnlock(suspended);
+		if (n == 0 && !UART_TxWait())
+			break;
+	}
+	/* Only an interrupt cannot take the lock or wait for space */
+	if (done < len)
+		uart_tx_dropped++;
+	return done;
+}
+
 /*!
  *********************************************************************************
- * Sends a packet via the specified interface
+ * Sends a packet via the specified interface. The command interface queues it
+ * for the TX DMA and returns as soon as it is in the TX ring.
  * \param[in]     desc     Pointer to UART descriptor
  * \param[in]		packet	Packet to send
  * \param[in]		len		Length of packet
  *********************************************************************************
  */
 void UART_SendPacket(UART_descriptor_t *desc, uint8_t *packet, int len) {
+	if (uart_dma_ready && desc->IF_ptr == UART0) {
+		UART_TxWrite(packet, len, NULL);
+		return;
+	}
 	while (len-- > 0) {
 		UART_SendChar(desc->IF_ptr, *packet++);
 	}
@@ -588,52 +904,100 @@ void UART_SendPacket(UART_descriptor_t *desc, uint8_t *packet, int len) {
  *********************************************************************************
  * Sends a command packet via RS232 or RS485 to the Command Interface
  * <SOP><Payload Byte> ... <16Byte Checksum><EOP>
+ * The frame is stuffed into the TX ring and sent by DMA, the function only
+ * waits if the ring is full.
  * \param[in]		packet	Packet to send
  * \param[in]		len		Length of packet
  *********************************************************************************
  */
 void UART_SendPacketCMD(uint8_t *packet, int len) {
 	uint16_t checksum;
+	uint8_t out[2];
 	register UART_Type *ptrIF;
 
-	CRC_Config(0x1021, 0, 0, 0, 0);
-	checksum = CRC_Cal_16(0, packet, len, 0);
+	checksum = CRC_Calc16(0, packet, len);
 	ptrIF = Cmd_IF_Uart->IF_ptr;
+	if (uart_dma_ready && ptrIF == UART0) {
+		UART_TxWrite(packet, len, &checksum);
+		return;
+	}
 	UART_SendChar(ptrIF, SOP);								// Start of Packet;
-	len += 2;
-	while (len) {
-		if (len == 2)
-			packet = (uint8_t*) (&checksum);
-		switch (*packet) {
-		case SOP:
-			UART_SendChar(ptrIF, ESC);
-			UART_SendChar(ptrIF, ESC_SOP);
-			break;
-		case EOP:
-			UART_SendChar(ptrIF, ESC);
-			UART_SendChar(ptrIF, ESC_EOP);
-			break;
-		case ESC:
-			UART_SendChar(ptrIF, ESC);
-			UART_SendChar(ptrIF, ESC_ESC);
-			break;
-		default:
-			UART_SendChar(ptrIF, *packet);
-		}
-		len--;
-		packet++;
+	for (int i = 0; i < len + 2; i++) {
+		int n = UART_StuffByte((i < len) ? packet[i] : (uint8_t) (checksum >> (8 * (i - len))), out);
+		for (int k = 0; k < n; k++)
+			UART_SendChar(ptrIF, out[k]);
 	}
 	UART_SendChar(ptrIF, EOP);								// End of Packet;
 }
 
+/*!
+ *********************************************************************************
+ * Builds the frame of a command packet for UART_SendFrameCMD
+ * \param[out]		frame		Frame buffer, UART_STUFFED_MAX(len) bytes are enough
+ * \param[in]		max		Size of the frame buffer
+ * \param[in]		packet	Packet
+ * \param[in]		len		Length of packet
+ * \return        frame length, 0 if the frame buffer is too small
+ *********************************************************************************
+ */
+int UART_StuffPacketCMD(uint8_t *frame, int max, const uint8_t *packet, int len) {
+	uint16_t checksum;
+
+	checksum = CRC_Calc16(0, packet, len);
+	return UART_StuffFrame(frame, max, packet, len, checksum);
+}
+
+/*!
+ *********************************************************************************
+ * Sends a frame built by UART_StuffPacketCMD without copying it. The frame must
+ * not be changed until done is called (from the TX DMA interrupt).
+ * \param[in]		frame		Frame to send
+ * \param[in]		len		Length of frame
+ * \param[in]		done		Called when the frame has been sent, may be NULL
+ * \return        1 if the frame is queued, 0 else
+ *********************************************************************************
+ */
+int UART_SendFrameCMD(const uint8_t *frame, int len, void (*done)(const uint8_t *frame)) {
+	bool suspended, queued = false;
+
+	if (!uart_dma_ready || len <= 0 || len > UART_TX_MAX_SEGMENT_LEN)
+		return 0;
+	while (UART_TxLock(&suspended)) {
+		if (!UART_TxQueueFull(&uart_tx_queue))
+			queued = UART_TxStart(frame, len, false, done);
+		UART_TxUnlock(suspended);
+		if (queued || !UART_TxWait())
+			break;
+	}
+	if (!queued)
+		uart_tx_dropped++;
+	return queued ? 1 : 0;
+}
+
+/*!
+ *********************************************************************************
+ * Number of packets, frames or characters of the command interface that could
+ * not be queued. An interrupt does not wait for the TX lock or for space.
+ * \return        dropped writes since the start
+ *********************************************************************************
+ */
+uint32_t UART_GetTxDropped(void) {
+	return uart_tx_dropped;
+}
+
 /*!
  ******************************************************************************
- *	Wait for space in the UART Tx FIFO and then send a character
+ *	Sends a character. On the command interface it is queued for the TX DMA,
+ * else the function waits for space in the UART Tx FIFO.
  *	\param[in]	channel  UART channel to send to
  *	\param[in]	ch       character to send
+ * \return     1 if success, 0 else
  ******************************************************************************
  */
 int UART_Putchar(UART_Type *channel, char ch) {
+	if (uart_dma_ready && channel == UART0)
+		return UART_TxWrite((const uint8_t*) &ch, 1, NULL);
+
 	/* Wait until space is available in the FIFO */
 	while (!(channel->S1 & UART_S1_TDRE_MASK))
 		;
@@ -9,16 +9,17 @@
 #define UART_H_
 
 #include "board.h"
+#include "uart-ring.h"
 
 #define     DEBUG_PROTOCOL
 #undef      DEBUG_PROTOCOL
 
-#define	SOP			         0xA0				///< Start of package
-#define	EOP			         0x05				///< End of package
-#define	ESC			         0xF0				///< Escape sequence
-#define	ESC_ESC		         0xF0				///< Byte stuffing of ESC
-#define	ESC_SOP		         0x01				///< Byte stuffing of SOP
-#define	ESC_EOP		         0x02				///< Byte stuffing of EOP
+#define	SOP			         UART_SOP			///< Start of package
+#define	EOP			         UART_EOP			///< End of package
+#define	ESC			         UART_ESC			///< Escape sequence
+#define	ESC_ESC		         UART_ESC_ESC	///< Byte stuffing of ESC
+#define	ESC_SOP		         UART_ESC_SOP	///< Byte stuffing of SOP
+#define	ESC_EOP		         UART_ESC_EOP	///< Byte stuffing of EOP
 
 #define 	E_NO_ERROR           0x00           ///< Packet Error: No Error
 #define	E_PREM_SOP	         0x01				///< Packet Error: Premature received SOP
@@ -32,6 +33,15 @@
 
 #define  RS232_BUFFER_LEN     128             	///< RS232 receiver buffer length
 
+#define  UART_DMA_RX_CHANNEL  6                 ///< eDMA channel of the command interface RX (0..5: ADC scan)
+#define  UART_DMA_TX_CHANNEL  7                 ///< eDMA channel of the command interface TX
+#define  UART_DMA_RX_IRQn     DMA6_IRQn
+#define  UART_DMA_TX_IRQn     DMA7_IRQn
+#define  UART_RX_RING_LEN     256               ///< RX ring length, also sets UART_RX_RING_MODULO
+#define  UART_RX_RING_MODULO  kEDMA_Modulo256bytes
+#define  UART_TX_RING_LEN     1024              ///< TX ring length, also sets UART_TX_RING_MODULO
+#define  UART_TX_RING_MODULO  kEDMA_Modulo1Kbytes
+
 #define		BAUDRATE_2400					    		1
 #define		BAUDRATE_4800					    		2
 #define		BAUDRATE_9600					    		3
@@ -91,6 +101,9 @@ int UART_GetParity(UART_descriptor_t *IFdesc);
 int UART_InitUart(UART_descriptor_t *IFdesc);
 void UART_SendPacket(UART_descriptor_t *desc,uint8_t *packet,int len);
 void UART_SendPacketCMD(uint8_t *packet,int len);
+int UART_StuffPacketCMD(uint8_t *frame,int max,const uint8_t *packet,int len);
+int UART_SendFrameCMD(const uint8_t *frame,int len,void (*done)(const uint8_t *frame));
+uint32_t UART_GetTxDropped(void);
 int UART_Putchar(UART_Type *channel, char ch);
 
 #endif /* UART_H_ */
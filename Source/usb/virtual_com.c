@@ -22,6 +22,7 @@
 
 #include "usb_device_descriptor.h"
 #include "virtual_com.h"
+#include "virtual_com_tx.h"
 #if (defined(FSL_FEATURE_SOC_SYSMPU_COUNT) && (FSL_FEATURE_SOC_SYSMPU_COUNT > 0U))
 #include "fsl_sysmpu.h"
 #endif /* FSL_FEATURE_SOC_SYSMPU_COUNT */
@@ -60,8 +61,9 @@ usb_status_t USB_DeviceCallback(usb_device_handle handle, uint32_t event, void *
 ******************************************************************************/
 
 static usb_status_t 	g_error = kStatus_USB_Success;
-static uint8_t			usb_packet_buf[DATA_BUFF_SIZE];
-static bool				g_send_flag = false;
+static VCOM_TxQueue_t	s_txQueue;
+static SemaphoreHandle_t	s_txSema = NULL;		// given on each end of transfer, a writer waits for a free buffer
+static SemaphoreHandle_t	s_txMutex = NULL;		// serializes the writers
 
 extern usb_device_endpoint_struct_t g_UsbDeviceCdcVcomDicEndpoints[];
 extern usb_device_class_struct_t g_UsbDeviceCdcVcomConfig;
@@ -91,9 +93,8 @@ USB_DMA_INIT_DATA_ALIGN(USB_DATA_ALIGN_SIZE) static uint8_t s_countryCode[COMM_F
 USB_DMA_NONINIT_DATA_ALIGN(USB_DATA_ALIGN_SIZE) static usb_cdc_acm_info_t s_usbCdcAcmInfo;
 /* Data buffer for receiving and sending*/
 USB_DMA_NONINIT_DATA_ALIGN(USB_DATA_ALIGN_SIZE) static uint8_t s_currRecvBuf[DATA_BUFF_SIZE];
-USB_DMA_NONINIT_DATA_ALIGN(USB_DATA_ALIGN_SIZE) static uint8_t s_currSendBuf[DATA_BUFF_SIZE];
+USB_DMA_NONINIT_DATA_ALIGN(USB_DATA_ALIGN_SIZE) static uint8_t s_currSendBuf[VCOM_TX_BUFFERS * VCOM_TX_BUFFER_LEN];
 volatile static uint32_t s_recvSize = 0;
-volatile static uint32_t s_sendSize = 0;
 
 /* USB device class information */
 static usb_device_class_config_struct_t s_cdcAcmConfig[1] = {{
@@ -191,33 +192,14 @@ usb_status_t USB_DeviceCdcVcomCallback(class_handle_t handle, uint32_t event, vo
     {
         case kUSB_DeviceCdcEventSendResponse:
         {
-            if ((epCbParam->length != 0) && (!(epCbParam->length % g_UsbDeviceCdcVcomDicEndpoints[0].maxPacketSize)))
-            {
-                /* If the last packet is the size of endpoint, then send also zero-ended packet,
-                 ** meaning that we want to inform the host that we do not have any additional
-                 ** data, so it can flush the output.
-                 */
-                error = USB_DeviceCdcAcmSend(handle, USB_CDC_VCOM_BULK_IN_ENDPOINT, NULL, 0);
-            }
-            else if ((1 == s_cdcVcom.attach) && (1 == s_cdcVcom.startTransactions))
-            {
-                if ((epCbParam->buffer != NULL) || ((epCbParam->buffer == NULL) && (epCbParam->length == 0)))
-                {
-                    /* User: add your own code for send complete event */
-                    /* Schedule buffer for next receive event */
-                    error = USB_DeviceCdcAcmRecv(handle, USB_CDC_VCOM_BULK_OUT_ENDPOINT, s_currRecvBuf,
-                                                 g_UsbDeviceCdcVcomDicEndpoints[0].maxPacketSize);
-#if defined(FSL_FEATURE_USB_KHCI_KEEP_ALIVE_ENABLED) && (FSL_FEATURE_USB_KHCI_KEEP_ALIVE_ENABLED > 0U) && \
-    defined(USB_DEVICE_CONFIG_KEEP_ALIVE_MODE) && (USB_DEVICE_CONFIG_KEEP_ALIVE_MODE > 0U) &&             \
-    defined(FSL_FEATURE_USB_KHCI_USB_RAM) && (FSL_FEATURE_USB_KHCI_USB_RAM > 0U)
-                    s_waitForDataReceive = 1;
-                    USB0->INTEN &= ~USB_INTEN_SOFTOKEN_MASK;
-#endif
-                }
-            }
-            else
-            {
-            }
+            /* Release the buffer, send the next one or a zero-ended packet (see virtual_com_tx.h) */
+            BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+            VCOM_TxComplete(&s_txQueue);
+            if (s_txSema != NULL)
+                xSemaphoreGiveFromISR(s_txSema, &xHigherPriorityTaskWoken);
+            portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+            error = kStatus_USB_Success;
         }
         break;
         case kUSB_DeviceCdcEventRecvResponse:
@@ -232,7 +214,15 @@ usb_status_t USB_DeviceCdcVcomCallback(class_handle_t handle, uint32_t event, vo
                 s_waitForDataReceive = 0;
                 USB0->INTEN |= USB_INTEN_SOFTOKEN_MASK;
 #endif
-                if (!s_recvSize)
+                if (s_recvSize && (s_cdcVcom.applicationTaskHandle != NULL))
+                {
+                    /* APPTask hands the data to the command handler and schedules the next receive */
+                    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+                    vTaskNotifyGiveFromISR(s_cdcVcom.applicationTaskHandle, &xHigherPriorityTaskWoken);
+                    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+                }
+                else
                 {
                     /* Schedule buffer for next receive event */
                     error = USB_DeviceCdcAcmRecv(handle, USB_CDC_VCOM_BULK_OUT_ENDPOINT, s_currRecvBuf,
@@ -402,6 +392,7 @@ usb_status_t USB_DeviceCdcVcomCallback(class_handle_t handle, uint32_t event, vo
                 if (1 == s_cdcVcom.attach)
                 {
                     s_cdcVcom.startTransactions = 0;
+                    VCOM_TxAbort(&s_txQueue);
                 }
             }
         }
@@ -437,6 +428,7 @@ usb_status_t USB_DeviceCallback(usb_device_handle handle, uint32_t event, void *
         case kUSB_DeviceEventBusReset:
         {
             s_cdcVcom.attach = 0;
+            VCOM_TxAbort(&s_txQueue);
 #if (defined(USB_DEVICE_CONFIG_EHCI) && (USB_DEVICE_CONFIG_EHCI > 0U)) || \
     (defined(USB_DEVICE_CONFIG_LPCIP3511HS) && (USB_DEVICE_CONFIG_LPCIP3511HS > 0U))
             /* Get USB speed to configure the device, including max packet size and interval of the endpoints. */
@@ -502,6 +494,22 @@ usb_status_t USB_DeviceCallback(usb_device_handle handle, uint32_t event, void *
     return error;
 }
 
+/*!
+ *********************************************************************************
+ * Starts a transfer on the bulk-IN endpoint (send function of s_txQueue)
+ * \param[in]		ctx		CDC ACM class handle
+ * \param[in]		buf		data, NULL for a zero length packet
+ * \param[in]		len		length of data
+ * \return        0 if success, -1 else
+ *********************************************************************************
+*/
+static int VCOM_TxSendEndpoint(void *ctx,uint8_t *buf,uint32_t len)
+{
+	if (USB_DeviceCdcAcmSend((class_handle_t)ctx,USB_CDC_VCOM_BULK_IN_ENDPOINT,buf,len) != kStatus_USB_Success)
+		return -1;
+	return 0;
+}
+
 /*!
  * @brief Application initialization function.
  *
@@ -530,6 +538,8 @@ void APPInit(void)
 		  usb_echo("USB: Initialize USB Device - CDC Virtual COM\r\n");
         s_cdcVcom.cdcAcmHandle = s_cdcAcmConfigList.config->classHandle;
     }
+    VCOM_TxInit(&s_txQueue, s_currSendBuf, VCOM_TX_BUFFER_LEN, FS_CDC_VCOM_BULK_IN_PACKET_SIZE,
+                VCOM_TxSendEndpoint, s_cdcVcom.cdcAcmHandle);
 
     USB_DeviceIsrEnable();
 
@@ -543,34 +553,82 @@ usb_status_t get_USB_Error(void)
 
 /*!
  *********************************************************************************
- * Sends a character via USB to the Command Interface
- * <SOP><Payload Byte> ... <16Byte Checksum><EOP>
- * \param[in]		ch			character to send
- * \param[in]		eof		1 = start of command, 2 = end of command, 0 else
+ * Appends bytes to the transmit queue and starts the endpoint. Waits for the
+ * end of a transfer when all buffers are used. The interrupts are masked only
+ * while the endpoint is claimed, not during the copy or USB_DeviceCdcAcmSend.
+ * \param[in]		data		bytes to send
+ * \param[in]		len		number of bytes
+ * \param[in]		flush		true to send the bytes as soon as the endpoint is idle,
+ *								false to let them be packed with the next ones
+ * \return        true if success, false if the host does not read
  *********************************************************************************
 */
-void USB_Putchar(uint8_t ch,int eof)
+static bool USB_TxWrite(const uint8_t *data,uint32_t len,bool flush)
 {
-static int		iPtr = 0;
+uint32_t		n,primask;
+int			index;
 
-	if (eof == 1)
-		iPtr = 0;
-	usb_packet_buf[iPtr++] = ch;
-	if (eof == 2 || iPtr == DATA_BUFF_SIZE)
+	for (;;)
 	{
-		g_send_flag = false;
-		memcpy(s_currSendBuf,usb_packet_buf,iPtr);
-		s_sendSize = iPtr;
-		iPtr = 0;
-		while (!g_send_flag)
-			vTaskDelay(5);
+		if ((1 != s_cdcVcom.attach) || (1 != s_cdcVcom.startTransactions))
+			return false;
+		n = VCOM_TxWrite(&s_txQueue,data,len);
+		if (n == len && flush)
+			VCOM_TxFlush(&s_txQueue);
+		for (;;)
+		{
+			primask = DisableGlobalIRQ();
+			index = VCOM_TxClaim(&s_txQueue);
+			EnableGlobalIRQ(primask);
+			if (index < 0 || VCOM_TxStart(&s_txQueue,index))
+				break;
+			primask = DisableGlobalIRQ();
+			VCOM_TxDrop(&s_txQueue);
+			EnableGlobalIRQ(primask);
+		}
+		data += n;
+		len -= n;
+		if (len == 0)
+			return true;
+		if (s_txSema == NULL || xTaskGetSchedulerState() != taskSCHEDULER_RUNNING ||
+			 xSemaphoreTake(s_txSema,(TickType_t)VCOM_TX_TIMEOUT) != pdTRUE)
+		{
+			if (VCOM_TxPending(&s_txQueue) == VCOM_TX_BUFFERS - 1)
+				return false;
+		}
 	}
 }
 
+/*!
+ *********************************************************************************
+ * Takes the writer lock of the transmit queue
+ * \return        true if the lock is taken
+ *********************************************************************************
+*/
+static bool USB_TxLock(void)
+{
+	if (xTaskGetSchedulerState() != taskSCHEDULER_RUNNING || s_txMutex == NULL)
+		return true;
+	return xSemaphoreTake(s_txMutex,(TickType_t)VCOM_TX_TIMEOUT) == pdTRUE;
+}
+
+/*!
+ *********************************************************************************
+ * Releases the writer lock of the transmit queue
+ *********************************************************************************
+*/
+static void USB_TxUnlock(void)
+{
+	if (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING && s_txMutex != NULL)
+		xSemaphoreGive(s_txMutex);
+}
+
 /*!
  *********************************************************************************
  * Sends a command packet via USB to the Command Interface
  * <SOP><Payload Byte> ... <16Byte Checksum><EOP>
+ * The frame is stuffed in chunks into the transmit queue, the function returns
+ * when the last chunk is queued.
  * \param[in]		packet	Packet to send
  * \param[in]		len		Length of packet
  *********************************************************************************
@@ -578,75 +636,46 @@ static int		iPtr = 0;
 void USB_SendPacketCMD(uint8_t *packet,int len)
 {
 uint16_t		         checksum;
-
-   CRC_Config(0x1021,0,0,0,0);
-	checksum = CRC_Cal_16(0,packet,len,0);
-	USB_Putchar(SOP,1);			// Start of Packet;
-   len += 2;
-	while (len)
+uint8_t					chunk[FS_CDC_VCOM_BULK_IN_PACKET_SIZE + 2];
+int						n = 0;
+bool						ok = true;
+
+	checksum = CRC_Calc16(0,packet,len);
+	if (!USB_TxLock())
+		return;
+	chunk[n++] = SOP;								// Start of Packet;
+	for (int i = 0;i < len + 2 && ok;i++)
 	{
-      if (len == 2)
-         packet = (uint8_t *)(&checksum);
-		switch(*packet)
+		n += UART_StuffByte((i < len) ? packet[i] : (uint8_t)(checksum >> (8 * (i - len))),chunk + n);
+		if (n >= FS_CDC_VCOM_BULK_IN_PACKET_SIZE)
 		{
-			case SOP:
-				USB_Putchar(ESC,0);
-				USB_Putchar(ESC_SOP,0);
-				break;
-			case EOP:
-				USB_Putchar(ESC,0);
-				USB_Putchar(ESC_EOP,0);
-				break;
-			case ESC:
-				USB_Putchar(ESC,0);
-				USB_Putchar(ESC_ESC,0);
-				break;
-			default:
-				USB_Putchar(*packet,0);
+			ok = USB_TxWrite(chunk,n,false);
+			n = 0;
 		}
-      len--;
-      packet++;
 	}
-	USB_Putchar(EOP,2);			// End of Packet;
+	chunk[n++] = EOP;								// End of Packet;
+	if (ok)
+		USB_TxWrite(chunk,n,true);
+	USB_TxUnlock();
 }
 
 /*!
  *********************************************************************************
- * Sends characters via USB
- * <SOP><Payload Byte> ... <16Byte Checksum><EOP>
+ * Sends characters via USB. The characters are sent at each new line or when a
+ * transmit buffer is full.
  * \param[in]		ch			character to send
+ * \return        true if success, false else
  *********************************************************************************
 */
 bool USB_PutcharComm(uint8_t ch)
 {
-static int		iPtr = 0;
+bool		ok;
 
-	if (ch != '\n')
-	{
-		if (iPtr < 64)
-			usb_packet_buf[iPtr++] = ch;
-		else
-		{
-			g_send_flag = false;
-			memcpy(s_currSendBuf,usb_packet_buf,iPtr);
-			s_sendSize = iPtr;
-			iPtr = 0;
-			g_send_flag = false;
-			while (!g_send_flag)
-				vTaskDelay(5);
-				
-		}
-	}
-	else
-	{
-		memcpy(s_currSendBuf,usb_packet_buf,iPtr);
-		s_sendSize = iPtr;
-		iPtr = 0;
-		g_send_flag = false;
-		while (!g_send_flag)
-			vTaskDelay(5);
-	}
-	return true;
+	if (!USB_TxLock())
+		return false;
+	ok = USB_TxWrite(&ch,1,ch == '\n');
+	USB_TxUnlock();
+	return ok;
 }
 
 
@@ -662,7 +691,8 @@ void APPTask(void *handle)
     APPInit();
 	 while (1)
 	 {
-		 usb_status_t error = kStatus_USB_Error;
+		 /* Woken by the receive callback */
+		 ulTaskNotifyTake(pdTRUE,portMAX_DELAY);
 		 if ((1 == s_cdcVcom.attach) && (1 == s_cdcVcom.startTransactions))
 		 {
 			  /* User Code */
@@ -670,20 +700,9 @@ void APPTask(void *handle)
 			  {
                 UART_CmdIF_HandleUSB(s_currRecvBuf,s_recvSize);
                 s_recvSize = 0;
-			  }
-
-			  if (s_sendSize)
-			  {
-					uint32_t size = s_sendSize;
-					s_sendSize = 0;
-
-					error = USB_DeviceCdcAcmSend(s_cdcVcom.cdcAcmHandle, USB_CDC_VCOM_BULK_IN_ENDPOINT, s_currSendBuf, size);
-				   g_send_flag = true;
-
-					if (error != kStatus_USB_Success)
-					{
-						 /* Failure to send Data Handling code here */
-					}
+                /* Schedule buffer for next receive event */
+                USB_DeviceCdcAcmRecv(s_cdcVcom.cdcAcmHandle, USB_CDC_VCOM_BULK_OUT_ENDPOINT, s_currRecvBuf,
+                                     g_UsbDeviceCdcVcomDicEndpoints[0].maxPacketSize);
 			  }
 	#if defined(FSL_FEATURE_USB_KHCI_KEEP_ALIVE_ENABLED) && (FSL_FEATURE_USB_KHCI_KEEP_ALIVE_ENABLED > 0U) && \
 		 defined(USB_DEVICE_CONFIG_KEEP_ALIVE_MODE) && (USB_DEVICE_CONFIG_KEEP_ALIVE_MODE > 0U) &&             \
@@ -715,12 +734,18 @@ void APPTask(void *handle)
 			  }
 	#endif
 		 }
-       vTaskDelay(3);
 	 }
 }
 
 int usb_main_init(void)
 {
+    s_txSema = xSemaphoreCreateBinary();
+    s_txMutex = xSemaphoreCreateMutex();
+    if (s_txSema == NULL || s_txMutex == NULL)
+    {
+		  usb_echo("USB: Semaphore creation failed!\r\n");
+        return 0;
+    }
     if (xTaskCreate(APPTask,                         /* pointer to the task                      */
                     "USB",                       /* task name for kernel awareness debugging */
                     8000L / sizeof(portSTACK_TYPE),  /* task stack size                          */
@@ -51,6 +51,10 @@
 #define LINE_CODING_PARITYTYPE (0x00)
 #define LINE_CODING_DATABITS (0x08)
 
+/* Transmit queue, see virtual_com_tx.h */
+#define VCOM_TX_BUFFER_LEN (512)      /* Bytes per transfer: 8 full speed packets */
+#define VCOM_TX_TIMEOUT (100)         /* Ticks a writer waits for a free buffer */
+
 /* Communications feature */
 #define COMM_FEATURE_DATA_SIZE (0x02)
 #define STATUS_ABSTRACT_STATE (0x0000)
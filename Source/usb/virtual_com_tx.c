@@ -0,0 +1,221 @@
+/*
+ * virtual_com_tx.c
+ *
+ *  Transmit queue of the USB CDC bulk-IN endpoint
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include "virtual_com_tx.h"
+
+#define	VCOM_TX_MASK		(VCOM_TX_BUFFERS - 1)
+
+/*!
+ ******************************************************************************
+ *	Closes the buffer being filled so that it is sent
+ *	\param[in]	queue			queue
+ * \return     true if success or nothing to close, false if no buffer is free
+ ******************************************************************************
+*/
+static bool VCOM_TxClose(VCOM_TxQueue_t *queue)
+{
+	if (queue->len[queue->head & VCOM_TX_MASK] == 0)
+		return true;
+	if (VCOM_TxPending(queue) >= VCOM_TX_BUFFERS - 1)
+		return false;
+	queue->len[(queue->head + 1) & VCOM_TX_MASK] = 0;
+	queue->head++;
+	return true;
+}
+
+/*!
+ ******************************************************************************
+ *	Initializes a transmit queue
+ *	\param[out]	queue				queue
+ *	\param[in]	buffers			VCOM_TX_BUFFERS buffers of size bytes, contiguous
+ *	\param[in]	size				size of one buffer
+ *	\param[in]	packet_size		max packet size of the endpoint
+ *	\param[in]	send				starts a transfer on the endpoint
+ *	\param[in]	ctx				argument of send
+ * \return     true if success, false else
+ ******************************************************************************
+*/
+bool VCOM_TxInit(VCOM_TxQueue_t *queue,uint8_t *buffers,uint32_t size,uint32_t packet_size,
+					  VCOM_TxSend_t send,void *ctx)
+{
+	memset(queue,0,sizeof(*queue));
+	if (buffers == NULL || send == NULL || size == 0 || packet_size == 0)
+		return false;
+	for (int i = 0;i < VCOM_TX_BUFFERS;i++)
+		queue->buf[i] = buffers + i * size;
+	queue->size = size;
+	queue->packet_size = packet_size;
+	queue->send = send;
+	queue->ctx = ctx;
+	return true;
+}
+
+/*!
+ ******************************************************************************
+ *	Appends bytes to the buffer being filled, full buffers are closed
+ *	\param[in]	queue			queue
+ *	\param[in]	data			bytes
+ *	\param[in]	len			number of bytes
+ * \return     number of bytes written, less than len if all buffers are used
+ ******************************************************************************
+*/
+uint32_t VCOM_TxWrite(VCOM_TxQueue_t *queue,const uint8_t *data,uint32_t len)
+{
+uint32_t		done = 0,n,fill;
+
+	queue->writing = true;						// the interrupt does not close the buffer meanwhile
+	while (done < len)
+	{
+		fill = queue->len[queue->head & VCOM_TX_MASK];
+		if (fill == queue->size)
+		{
+			if (!VCOM_TxClose(queue))
+				break;
+			continue;
+		}
+		n = queue->size - fill;
+		if (n > len - done)
+			n = len - done;
+		memcpy(queue->buf[queue->head & VCOM_TX_MASK] + fill,data + done,n);
+		queue->len[queue->head & VCOM_TX_MASK] = fill + n;
+		done += n;
+	}
+	queue->writing = false;
+	return done;
+}
+
+/*!
+ ******************************************************************************
+ *	Requests the bytes written so far to be sent. They are sent at once if the
+ *	endpoint is idle, else at the end of the transfer in progress together with
+ *	the bytes written until then.
+ ******************************************************************************
+*/
+void VCOM_TxFlush(VCOM_TxQueue_t *queue)
+{
+	queue->flush = true;
+}
+
+/*!
+ ******************************************************************************
+ *	Claims the idle endpoint for the oldest closed buffer, the flushed bytes are
+ *	closed first unless the writer is appending. Called with the completion
+ *	interrupt masked or from it, only the indices are updated.
+ * \return     index of the buffer to start with VCOM_TxStart, -1 if none
+ ******************************************************************************
+*/
+int VCOM_TxClaim(VCOM_TxQueue_t *queue)
+{
+	if (!queue->busy && queue->head == queue->tail && queue->flush && !queue->writing)
+	{
+		VCOM_TxClose(queue);
+		queue->flush = false;
+	}
+	if (queue->busy || queue->head == queue->tail)
+		return -1;
+	queue->busy = true;
+	return (int)(queue->tail & VCOM_TX_MASK);
+}
+
+/*!
+ ******************************************************************************
+ *	Starts the transfer of a claimed buffer. The completion interrupt may be
+ *	enabled: it does not touch the queue before the transfer ends.
+ *	\param[in]	queue			queue
+ *	\param[in]	index			buffer returned by VCOM_TxClaim
+ * \return     true if success, false if the buffer is to be dropped
+ ******************************************************************************
+*/
+bool VCOM_TxStart(VCOM_TxQueue_t *queue,int index)
+{
+	return queue->send(queue->ctx,queue->buf[index],queue->len[index]) == 0;
+}
+
+/*!
+ ******************************************************************************
+ *	Drops the claimed buffer which could not be started, called with the
+ *	completion interrupt masked or from it
+ ******************************************************************************
+*/
+void VCOM_TxDrop(VCOM_TxQueue_t *queue)
+{
+	if (!queue->busy)								// aborted meanwhile
+		return;
+	queue->busy = false;
+	queue->errors++;
+	queue->tail++;
+}
+
+/*!
+ ******************************************************************************
+ *	Starts the transfer of the oldest closed buffer if the endpoint is idle.
+ *	A buffer which cannot be started is dropped. Called from the completion
+ *	interrupt or with it masked.
+ * \return     true if a transfer is in progress
+ ******************************************************************************
+*/
+bool VCOM_TxKick(VCOM_TxQueue_t *queue)
+{
+int			index;
+
+	while ((index = VCOM_TxClaim(queue)) >= 0 && !VCOM_TxStart(queue,index))
+		VCOM_TxDrop(queue);
+	return queue->busy;
+}
+
+/*!
+ ******************************************************************************
+ *	End of a transfer: releases the buffer, sends a zero length packet if the
+ *	transfer ended on a packet boundary and nothing follows, else the next buffer
+ ******************************************************************************
+*/
+void VCOM_TxComplete(VCOM_TxQueue_t *queue)
+{
+uint32_t		len;
+
+	if (!queue->busy)
+		return;
+	queue->busy = false;
+	if (queue->zlp)
+		queue->zlp = false;
+	else
+	{
+		len = queue->len[queue->tail & VCOM_TX_MASK];
+		queue->bytes += len;
+		queue->transfers++;
+		queue->tail++;
+		if (queue->head == queue->tail && !(queue->flush && queue->len[queue->head & VCOM_TX_MASK] != 0) &&
+			 len != 0 && (len % queue->packet_size) == 0)
+		{
+			queue->busy = true;
+			queue->zlp = true;
+			if (queue->send(queue->ctx,NULL,0) == 0)
+				return;
+			queue->busy = false;
+			queue->zlp = false;
+			queue->errors++;
+		}
+	}
+	VCOM_TxKick(queue);
+}
+
+/*!
+ ******************************************************************************
+ *	Drops the closed buffers (bus reset, host closed the port). The buffer being
+ *	filled is kept until the next flush.
+ ******************************************************************************
+*/
+void VCOM_TxAbort(VCOM_TxQueue_t *queue)
+{
+	queue->tail = queue->head;
+	queue->flush = false;
+	queue->busy = false;
+	queue->zlp = false;
+}
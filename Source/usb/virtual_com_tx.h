@@ -0,0 +1,81 @@
+/*
+ * virtual_com_tx.h
+ *
+ *  Transmit queue of the USB CDC bulk-IN endpoint
+ */
+
+#ifndef _VIRTUAL_COM_TX_H_
+#define _VIRTUAL_COM_TX_H_
+
+/*!
+ ******************************************************************************
+ *	The writers append bytes to the buffer being filled. A buffer is closed
+ *	when it is full, or on a flush when the endpoint is idle: while a transfer
+ *	is in progress the flushed bytes wait for more, so that the next transfer
+ *	is made of full packets. The closed buffers are sent one transfer each, in
+ *	order. A transfer ending on a packet boundary is followed by a zero length
+ *	packet if nothing else is to be sent, so that the host completes its read.
+ *	There is one writer at a time. It appends and flushes with the completion
+ *	interrupt enabled, masks it only for VCOM_TxClaim and VCOM_TxDrop (index
+ *	updates) and starts the claimed transfer with VCOM_TxStart unmasked. The
+ *	completion interrupt calls VCOM_TxComplete, VCOM_TxKick or VCOM_TxAbort.
+ *	The endpoint is reached through a send function, this file has no hardware
+ *	dependency.
+ ******************************************************************************
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define	VCOM_TX_BUFFERS			4					///< Number of transmit buffers (power of two)
+
+typedef int (*VCOM_TxSend_t)(void *ctx,uint8_t *buf,uint32_t len);		///< Starts a transfer, 0 if success
+
+typedef struct {
+	uint8_t					*buf[VCOM_TX_BUFFERS];
+	volatile uint32_t		len[VCOM_TX_BUFFERS];
+	uint32_t					size;				// bytes per buffer
+	uint32_t					packet_size;	// max packet size of the endpoint
+	volatile uint32_t		head;				// free running index of the buffer being filled
+	volatile uint32_t		tail;				// free running index of the oldest closed buffer
+	volatile bool			busy;				// a transfer is in progress
+	volatile bool			zlp;				// the transfer in progress is a zero length packet
+	volatile bool			flush;			// the buffer being filled is to be sent
+	volatile bool			writing;			// the writer is appending to the buffer being filled
+	VCOM_TxSend_t			send;
+	void						*ctx;
+	uint32_t					bytes;			// bytes sent
+	uint32_t					transfers;		// transfers done
+	uint32_t					errors;			// transfers which could not be started
+} VCOM_TxQueue_t;
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* __cplusplus */
+
+bool VCOM_TxInit(VCOM_TxQueue_t *queue,uint8_t *buffers,uint32_t size,uint32_t packet_size,
+					  VCOM_TxSend_t send,void *ctx);
+uint32_t VCOM_TxWrite(VCOM_TxQueue_t *queue,const uint8_t *data,uint32_t len);
+void VCOM_TxFlush(VCOM_TxQueue_t *queue);
+int VCOM_TxClaim(VCOM_TxQueue_t *queue);
+bool VCOM_TxStart(VCOM_TxQueue_t *queue,int index);
+void VCOM_TxDrop(VCOM_TxQueue_t *queue);
+bool VCOM_TxKick(VCOM_TxQueue_t *queue);
+void VCOM_TxComplete(VCOM_TxQueue_t *queue);
+void VCOM_TxAbort(VCOM_TxQueue_t *queue);
+
+/*!
+ ******************************************************************************
+ *	Gets the number of closed buffers (queued or being sent)
+ ******************************************************************************
+*/
+static inline uint32_t VCOM_TxPending(const VCOM_TxQueue_t *queue)
+{
+	return queue->head - queue->tail;
+}
+
+#if defined(__cplusplus)
+}
+#endif /* __cplusplus */
+
+#endif /* _VIRTUAL_COM_TX_H_ */